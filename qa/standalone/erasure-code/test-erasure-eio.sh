@@ -444,6 +444,46 @@ function TEST_ec_recovery_multiple_errors() {
     delete_erasure_coded_pool $poolname
 }
 
+# Test a clay repair that has to swap a helper after an EIO: the new
+# helper is asked for the same sub-chunks as the others
+function TEST_ec_clay_recovery_helper_error() {
+    local dir=$1
+    local objname=myobject
+
+    setup_osds 8 || return 1
+
+    local poolname=pool-clay
+    ceph osd erasure-code-profile set myprofile \
+        plugin=clay \
+        k=4 m=3 d=5 \
+        crush-failure-domain=osd || return 1
+    create_pool $poolname 1 1 erasure myprofile || return 1
+    wait_for_clean || return 1
+
+    rados_put $dir $poolname $objname || return 1
+    inject_eio ec data $poolname $objname $dir 0 || return 1
+
+    local -a initial_osds=($(get_osds $poolname $objname))
+    local primary=${initial_osds[0]}
+    local last_osd=${initial_osds[-1]}
+    # Kill OSD
+    kill_daemons $dir TERM osd.${last_osd} >&2 < /dev/null || return 1
+    ceph osd down ${last_osd} || return 1
+    ceph osd out ${last_osd} || return 1
+
+    # Cluster should recover this object
+    wait_for_clean || return 1
+
+    # without reading any helper again in whole
+    CEPH_ARGS='' ceph --admin-daemon $(get_asok_path osd.$primary) log flush || return 1
+    ! grep -q "get_remaining_shards reading shard .* again in whole" \
+        $dir/osd.$primary.log || return 1
+
+    rados_get $dir $poolname myobject || return 1
+
+    delete_erasure_coded_pool $poolname
+}
+
 # Test recovery when there's only one shard to recover, but multiple
 # objects recovering in one RecoveryOp
 function TEST_ec_recovery_multiple_objects() {
@@ -0,0 +1,113 @@
+#!/usr/bin/env bash
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7233" # git grep '\<7233\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+function dump_trace() {
+    local id=$1
+    CEPH_ARGS='' ceph --admin-daemon $(get_asok_path osd.$id) \
+        dump_historic_ops_trace
+}
+
+function count_ops() {
+    local id=$1
+    dump_trace $id | jq '[.traceEvents[] | select(.cat == "op")] | length'
+}
+
+#
+# Sample every op, and check that each OSD keeps the last few of them,
+# with a stage event for each step of an op.
+#
+function TEST_historic_ops_trace() {
+    local dir=$1
+    local poolname=test
+
+    run_mon $dir a --osd_pool_default_size=2 || return 1
+    run_mgr $dir x || return 1
+    for id in 0 1 ; do
+        run_osd $dir $id --osd_op_history_sample_rate=1 \
+            --osd_op_history_sample_size=5 || return 1
+    done
+    create_pool $poolname 1 1 || return 1
+    wait_for_clean || return 1
+
+    echo foo > $dir/FOO
+    for i in $(seq 1 10) ; do
+        rados --pool $poolname put obj$i $dir/FOO || return 1
+    done
+
+    for id in 0 1 ; do
+        # the op history thread records the ops after they complete
+        local ops
+        for i in $(seq 1 10) ; do
+            ops=$(count_ops $id)
+            test $ops -eq 5 && break
+            sleep 1
+        done
+        test $ops -eq 5 || return 1
+
+        dump_trace $id > $dir/trace.$id
+        jq -e '.traceEvents[0].ph == "M" and
+               .traceEvents[0].args.name == "osd.'$id'"' \
+            $dir/trace.$id || return 1
+        # every op has stages, on the op's own track
+        jq -e '[.traceEvents[] | select(.cat == "op") | .tid] as $ops |
+               [.traceEvents[] | select(.cat == "stage") | .tid] as $stages |
+               $ops | all(. as $tid | $stages | any(. == $tid))' \
+            $dir/trace.$id || return 1
+    done
+
+    # the writes are sampled on the primary and on the replica
+    cat $dir/trace.0 $dir/trace.1 | grep -q 'osd_op(' || return 1
+    cat $dir/trace.0 $dir/trace.1 | grep -q 'osd_repop(' || return 1
+}
+
+function TEST_historic_ops_trace_off() {
+    local dir=$1
+    local poolname=test
+
+    run_mon $dir a --osd_pool_default_size=1 || return 1
+    run_mgr $dir x || return 1
+    run_osd $dir 0 || return 1
+    create_pool $poolname 1 1 || return 1
+    wait_for_clean || return 1
+
+    echo foo > $dir/FOO
+    rados --pool $poolname put obj $dir/FOO || return 1
+
+    # nothing is sampled by default
+    test $(count_ops 0) -eq 0 || return 1
+}
+
+main osd-op-trace "$@"
+
+# Local Variables:
+# compile-command: "make -j4 && ../qa/run-standalone.sh osd-op-trace.sh"
+# End:
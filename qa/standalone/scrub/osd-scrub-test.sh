@@ -107,6 +107,41 @@ function TEST_scrub_test() {
     teardown $dir || return 1
 }
 
+# Deep scrub of 8MB, in chunks of 1MB, with a budget of 1MB/s: all but the
+# last chunk's reads must be waited out, less the one second burst.
+function TEST_scrub_max_bytes_per_sec() {
+    local dir=$1
+    local poolname=test
+    local objects=8
+
+    setup $dir || return 1
+    run_mon $dir a --osd_pool_default_size=1 || return 1
+    run_mgr $dir x || return 1
+    run_osd $dir 0 --osd_scrub_max_bytes_per_sec=1048576 \
+        --osd_scrub_chunk_min=1 --osd_scrub_chunk_max=1 \
+        --osd_scrub_sleep=0 || return 1
+
+    create_pool $poolname 1 1
+    wait_for_clean || return 1
+    poolid=$(ceph osd dump | grep "^pool.*[']${poolname}[']" | awk '{ print $2 }')
+
+    dd if=/dev/urandom of=$dir/data bs=1048576 count=1 2>/dev/null
+    for i in $(seq 1 $objects)
+    do
+        rados -p $poolname put obj${i} $dir/data || return 1
+    done
+
+    local pgid="${poolid}.0"
+    local start=$(date +%s)
+    pg_deep_scrub "$pgid" || return 1
+    local took=$(expr $(date +%s) - $start)
+    echo "deep scrub of $objects objects took $took seconds"
+    test $took -ge 5 || return 1
+    grep -q "state is INACTIVE|NEW_CHUNK, sleeping" $dir/osd.0.log || return 1
+
+    teardown $dir || return 1
+}
+
 main osd-scrub-test "$@"
 
 # Local Variables:
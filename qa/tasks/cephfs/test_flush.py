@@ -1,8 +1,12 @@
 
+import logging
+import os
 from textwrap import dedent
 from tasks.cephfs.cephfs_test_case import CephFSTestCase
 from tasks.cephfs.filesystem import ObjectNotFound, ROOT_INO
 
+log = logging.getLogger(__name__)
+
 
 class TestFlush(CephFSTestCase):
     def test_flush(self):
@@ -111,3 +115,47 @@ class TestFlush(CephFSTestCase):
         with self.assertRaises(ObjectNotFound):
             self.fs.read_backtrace(file_ino)
         self.assertEqual(self.fs.list_dirfrag(ROOT_INO), [])
+
+    def test_group_commit(self):
+        """
+        That with mds_log_group_commit_interval set, the journal flushes of
+        concurrent updates are batched into fewer, larger flushes.
+        """
+        # without an early reply each create asks for its own flush
+        self.fs.mds_asok(["config", "set", "mds_early_reply", "false"])
+        self.fs.mds_asok(["config", "set", "mds_log_group_commit_interval", "0.5"])
+
+        def get_log_perf():
+            return self.fs.mds_asok(['perf', 'dump', 'mds_log'])['mds_log']
+
+        threads = 8
+        files_per_thread = 25
+        self.mount_a.run_shell(["mkdir", "groupdir"])
+        initial = get_log_perf()
+        self.mount_a.run_python(dedent("""
+            import os
+            import threading
+
+            def create(t):
+                for i in range({files_per_thread}):
+                    path = os.path.join("{path}", "file_{{0}}_{{1}}".format(t, i))
+                    open(path, 'w').close()
+
+            threads = [threading.Thread(target=create, args=(t,))
+                       for t in range({threads})]
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join()
+            """).format(path=os.path.join(self.mount_a.mountpoint, "groupdir"),
+                        threads=threads, files_per_thread=files_per_thread))
+        final = get_log_perf()
+
+        creates = threads * files_per_thread
+        flushes = final['flush'] - initial['flush']
+        events = final['flushev']['sum'] - initial['flushev']['sum']
+        log.info("{0} events in {1} flushes".format(events, flushes))
+        self.assertGreater(flushes, 0)
+        self.assertGreaterEqual(events, creates)
+        # the creates waiting on one deadline share its flush
+        self.assertLess(flushes, creates / 2)
@@ -29,6 +29,16 @@ class TestStrays(CephFSTestCase):
     def test_files_throttle(self):
         self._test_throttling(self.FILES_THROTTLE)
 
+    @for_teuthology
+    def test_files_throttle_scaled(self):
+        """
+        That the purge queue raises its file limit while purges complete
+        within mds_purge_latency_target, but not past
+        mds_purge_limit_max_scale times it
+        """
+        self.set_conf('mds', 'mds_purge_latency_target', "60")
+        self._test_throttling(self.FILES_THROTTLE, max_scale=4)
+
     def test_dir_deletion(self):
         """
         That when deleting a bunch of dentries and the containing
@@ -92,16 +102,16 @@ class TestStrays(CephFSTestCase):
         # That finally, the data objects are all gone
         self.await_data_pool_empty()
 
-    def _test_throttling(self, throttle_type):
+    def _test_throttling(self, throttle_type, max_scale=1):
         self.data_log = []
         try:
-            return self._do_test_throttling(throttle_type)
+            return self._do_test_throttling(throttle_type, max_scale)
         except:
             for l in self.data_log:
                 log.info(",".join([l_.__str__() for l_ in l]))
             raise
 
-    def _do_test_throttling(self, throttle_type):
+    def _do_test_throttling(self, throttle_type, max_scale):
         """
         That the mds_max_purge_ops setting is respected
         """
@@ -113,6 +123,7 @@ class TestStrays(CephFSTestCase):
             """
             self.set_conf('mds', 'mds_max_purge_files', "%d" % files)
             self.set_conf('mds', 'mds_max_purge_ops', "%d" % ops)
+            self.set_conf('mds', 'mds_purge_limit_max_scale', "%s" % max_scale)
 
             pgs = self.fs.mon_manager.get_pool_property(
                 self.fs.get_data_pool_name(),
@@ -178,6 +189,8 @@ class TestStrays(CephFSTestCase):
         total_inodes = file_multiplier * self.throttle_workload_size_range + 1
         mds_max_purge_ops = int(self.fs.get_config("mds_max_purge_ops", 'mds'))
         mds_max_purge_files = int(self.fs.get_config("mds_max_purge_files", 'mds'))
+        # the file limit may be raised up to this while purges are fast
+        max_purge_files = mds_max_purge_files * max_scale
 
         # During this phase we look for the concurrent ops to exceed half
         # the limit (a heuristic) and not exceed the limit (a correctness
@@ -220,9 +233,9 @@ class TestStrays(CephFSTestCase):
                             num_purge_ops, mds_max_purge_ops
                         ))
                 elif throttle_type == self.FILES_THROTTLE:
-                    if num_strays_purging > mds_max_purge_files:
+                    if num_strays_purging > max_purge_files:
                         raise RuntimeError("num_strays_purging violates threshold {0}/{1}".format(
-                            num_strays_purging, mds_max_purge_files
+                            num_strays_purging, max_purge_files
                         ))
                 else:
                     raise NotImplemented(throttle_type)
@@ -250,6 +263,10 @@ class TestStrays(CephFSTestCase):
                 raise RuntimeError("Files in flight high water is unexpectedly low ({0} / {1})".format(
                     ops_high_water, mds_max_purge_files
                 ))
+            if max_scale > 1 and files_high_water <= mds_max_purge_files:
+                raise RuntimeError("Files in flight never went past the file limit ({0} / {1})".format(
+                    files_high_water, mds_max_purge_files
+                ))
 
         # Sanity check all MDC stray stats
         stats = self.fs.mds_asok(['perf', 'dump'])
@@ -2150,6 +2150,25 @@ function test_mon_osd_pool_set()
       ceph osd pool get $TEST_POOL_GETSET $size | expect_false grep '.'
   done
 
+  ceph osd pool get $TEST_POOL_GETSET alloc_unit | expect_false grep '.'
+  ceph osd pool set $TEST_POOL_GETSET alloc_unit 4194304
+  ceph osd pool get $TEST_POOL_GETSET alloc_unit | grep '4194304'
+  expect_false ceph osd pool set $TEST_POOL_GETSET alloc_unit 100
+  ceph osd pool set $TEST_POOL_GETSET alloc_unit 0
+  ceph osd pool get $TEST_POOL_GETSET alloc_unit | expect_false grep '.'
+
+  ceph osd pool set $TEST_POOL_GETSET dedup_chunk_algorithm fastcdc
+  ceph osd pool get $TEST_POOL_GETSET dedup_chunk_algorithm | grep 'fastcdc'
+  expect_false ceph osd pool set $TEST_POOL_GETSET dedup_chunk_algorithm rabin
+  ceph osd pool set $TEST_POOL_GETSET dedup_chunk_algorithm unset
+  ceph osd pool get $TEST_POOL_GETSET dedup_chunk_algorithm | expect_false grep '.'
+  ceph osd pool set $TEST_POOL_GETSET dedup_cdc_chunk_size 8192
+  ceph osd pool get $TEST_POOL_GETSET dedup_cdc_chunk_size | grep '8192'
+  expect_false ceph osd pool set $TEST_POOL_GETSET dedup_cdc_chunk_size 1000
+  expect_false ceph osd pool set $TEST_POOL_GETSET dedup_cdc_chunk_size 2
+  ceph osd pool set $TEST_POOL_GETSET dedup_cdc_chunk_size 0
+  ceph osd pool get $TEST_POOL_GETSET dedup_cdc_chunk_size | expect_false grep '.'
+
   ceph osd pool set $TEST_POOL_GETSET nodelete 1
   expect_false ceph osd pool delete $TEST_POOL_GETSET $TEST_POOL_GETSET --yes-i-really-really-mean-it
   ceph osd pool set $TEST_POOL_GETSET nodelete 0
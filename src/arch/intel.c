@@ -23,6 +23,9 @@ int ceph_arch_intel_ssse3 = 0;
 int ceph_arch_intel_sse3 = 0;
 int ceph_arch_intel_sse2 = 0;
 int ceph_arch_intel_aesni = 0;
+int ceph_arch_intel_avx2 = 0;
+int ceph_arch_intel_avx512 = 0;
+int ceph_arch_intel_gfni = 0;
 
 #ifdef __x86_64__
 #include <cpuid.h>
@@ -36,6 +39,26 @@ int ceph_arch_intel_aesni = 0;
 #define CPUID_SSE3	(1)
 #define CPUID_SSE2	(1 << 26)
 #define CPUID_AESNI (1 << 25)
+#define CPUID_OSXSAVE	(1 << 27)
+#define CPUID_AVX	(1 << 28)
+
+/* http://en.wikipedia.org/wiki/CPUID#EAX.3D7.2C_ECX.3D0:_Extended_Features */
+
+#define CPUID7_AVX2	(1 << 5)
+#define CPUID7_AVX512F	(1 << 16)
+#define CPUID7_AVX512BW	(1 << 30)
+#define CPUID7_GFNI	(1 << 8)	/* in ecx */
+
+/* the register state the os saves and restores, from xgetbv */
+#define XCR0_AVX	0x06	/* xmm, ymm */
+#define XCR0_AVX512	0xe6	/* xmm, ymm, opmask, zmm */
+
+static unsigned int xgetbv0(void)
+{
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+	return eax;
+}
 
 int ceph_arch_intel_probe(void)
 {
@@ -66,6 +89,26 @@ int ceph_arch_intel_probe(void)
           ceph_arch_intel_aesni = 1;
   }
 
+	/* the wider registers are only usable if the os saves them */
+	unsigned int xcr0 = 0;
+	if ((ecx & CPUID_OSXSAVE) != 0 && (ecx & CPUID_AVX) != 0) {
+		xcr0 = xgetbv0();
+	}
+	if (__get_cpuid_max(0, NULL) >= 7) {
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+		if ((ebx & CPUID7_AVX2) != 0 &&
+		    (xcr0 & XCR0_AVX) == XCR0_AVX) {
+			ceph_arch_intel_avx2 = 1;
+		}
+		if ((ebx & CPUID7_AVX512F) != 0 && (ebx & CPUID7_AVX512BW) != 0 &&
+		    (xcr0 & XCR0_AVX512) == XCR0_AVX512) {
+			ceph_arch_intel_avx512 = 1;
+		}
+		if ((ecx & CPUID7_GFNI) != 0) {
+			ceph_arch_intel_gfni = 1;
+		}
+	}
+
 	return 0;
 }
 
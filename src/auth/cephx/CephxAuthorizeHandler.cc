@@ -32,7 +32,7 @@ bool CephxAuthorizeHandler::verify_authorizer(
 					 connection_secret_required_len,
 					 auth_ticket_info,
 					 challenge, connection_secret,
-					 authorizer_reply);
+					 authorizer_reply, &ticket_cache);
 
   if (isvalid) {
     *caps_info = auth_ticket_info.ticket.caps;
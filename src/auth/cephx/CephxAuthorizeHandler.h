@@ -16,6 +16,7 @@
 #define CEPH_CEPHXAUTHORIZEHANDLER_H
 
 #include "auth/AuthAuthorizeHandler.h"
+#include "CephxProtocol.h"
 
 class CephContext;
 
@@ -33,6 +34,9 @@ struct CephxAuthorizeHandler : public AuthAuthorizeHandler {
     std::string *connection_secret,
     std::unique_ptr<AuthAuthorizerChallenge> *challenge) override;
   int authorizer_session_crypto() override;
+
+private:
+  CephXServiceTicketCache ticket_cache;
 };
 
 
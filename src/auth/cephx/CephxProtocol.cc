@@ -397,7 +397,8 @@ bool cephx_verify_authorizer(CephContext *cct, const KeyStore& keys,
 			     CephXServiceTicketInfo& ticket_info,
 			     std::unique_ptr<AuthAuthorizerChallenge> *challenge,
 			     std::string *connection_secret,
-			     bufferlist *reply_bl)
+			     bufferlist *reply_bl,
+			     CephXServiceTicketCache *ticket_cache)
 {
   __u8 authorizer_v;
   uint32_t service_id;
@@ -419,32 +420,44 @@ bool cephx_verify_authorizer(CephContext *cct, const KeyStore& keys,
 	   << ceph_entity_type_name(service_id)
 	   << " secret_id=" << ticket.secret_id << dendl;
 
-  if (ticket.secret_id == (uint64_t)-1) {
-    EntityName name;
-    name.set_type(service_id);
-    if (!keys.get_secret(name, service_secret)) {
-      ldout(cct, 0) << "verify_authorizer could not get general service secret for service "
-	      << ceph_entity_type_name(service_id) << " secret_id=" << ticket.secret_id << dendl;
-      return false;
-    }
+  std::string error;
+  const utime_t now = ceph_clock_now();
+  if (ticket_cache &&
+      ticket_cache->find(service_id, ticket, now, &ticket_info)) {
+    ldout(cct, 20) << "verify_authorizer found the ticket in the cache" << dendl;
   } else {
-    if (!keys.get_service_secret(service_id, ticket.secret_id, service_secret)) {
-      ldout(cct, 0) << "verify_authorizer could not get service secret for service "
-	      << ceph_entity_type_name(service_id) << " secret_id=" << ticket.secret_id << dendl;
-      if (cct->_conf->auth_debug && ticket.secret_id == 0)
-	ceph_abort_msg("got secret_id=0");
+    if (ticket.secret_id == (uint64_t)-1) {
+      EntityName name;
+      name.set_type(service_id);
+      if (!keys.get_secret(name, service_secret)) {
+	ldout(cct, 0) << "verify_authorizer could not get general service secret for service "
+		<< ceph_entity_type_name(service_id) << " secret_id=" << ticket.secret_id << dendl;
+	return false;
+      }
+    } else {
+      if (!keys.get_service_secret(service_id, ticket.secret_id, service_secret)) {
+	ldout(cct, 0) << "verify_authorizer could not get service secret for service "
+		<< ceph_entity_type_name(service_id) << " secret_id=" << ticket.secret_id << dendl;
+	if (cct->_conf->auth_debug && ticket.secret_id == 0)
+	  ceph_abort_msg("got secret_id=0");
+	return false;
+      }
+    }
+    if (!service_secret.get_secret().length())
+      error = "invalid key";  // Bad key?
+    else
+      decode_decrypt_enc_bl(cct, ticket_info, service_secret, ticket.blob, error);
+    if (!error.empty()) {
+      ldout(cct, 0) << "verify_authorizer could not decrypt ticket info: error: "
+	<< error << dendl;
       return false;
     }
-  }
-  std::string error;
-  if (!service_secret.get_secret().length())
-    error = "invalid key";  // Bad key?
-  else
-    decode_decrypt_enc_bl(cct, ticket_info, service_secret, ticket.blob, error);
-  if (!error.empty()) {
-    ldout(cct, 0) << "verify_authorizer could not decrypt ticket info: error: "
-      << error << dendl;
-    return false;
+    if (ticket_cache) {
+      ticket_cache->add(
+	service_id, ticket, ticket_info, now,
+	cct->_conf.get_val<std::chrono::seconds>("auth_ticket_cache_ttl").count(),
+	cct->_conf.get_val<uint64_t>("auth_ticket_cache_size"));
+    }
   }
 
   if (ticket_info.ticket.global_id != global_id) {
@@ -515,6 +528,77 @@ bool cephx_verify_authorizer(CephContext *cct, const KeyStore& keys,
   return true;
 }
 
+std::string CephXServiceTicketCache::make_key(uint32_t service_id,
+					      const CephXTicketBlob& ticket)
+{
+  bufferlist bl;
+  encode(service_id, bl);
+  encode(ticket, bl);
+  return bl.to_str();
+}
+
+CephXServiceTicketCache::shard_t& CephXServiceTicketCache::get_shard(
+  const std::string& key)
+{
+  return shards[std::hash<std::string>{}(key) % NUM_SHARDS];
+}
+
+bool CephXServiceTicketCache::find(uint32_t service_id,
+				   const CephXTicketBlob& ticket,
+				   utime_t now,
+				   CephXServiceTicketInfo *info)
+{
+  const auto key = make_key(service_id, ticket);
+  auto& shard = get_shard(key);
+  std::lock_guard l{shard.lock};
+  auto p = shard.entries.find(key);
+  if (p == shard.entries.end()) {
+    return false;
+  }
+  if (p->second.expires <= now) {
+    shard.entries.erase(p);
+    return false;
+  }
+  *info = p->second.info;
+  return true;
+}
+
+void CephXServiceTicketCache::add(uint32_t service_id,
+				  const CephXTicketBlob& ticket,
+				  const CephXServiceTicketInfo& info,
+				  utime_t now, double ttl, size_t max_size)
+{
+  if (!max_size || ttl <= 0) {
+    return;
+  }
+  utime_t expires = now;
+  expires += ttl;
+  if (info.ticket.expires < expires) {
+    expires = info.ticket.expires;
+  }
+  if (expires <= now) {
+    return;
+  }
+  const size_t max_shard_size = (max_size + NUM_SHARDS - 1) / NUM_SHARDS;
+  const auto key = make_key(service_id, ticket);
+  auto& shard = get_shard(key);
+  std::lock_guard l{shard.lock};
+  if (shard.entries.size() >= max_shard_size &&
+      shard.entries.find(key) == shard.entries.end()) {
+    for (auto p = shard.entries.begin(); p != shard.entries.end();) {
+      if (p->second.expires <= now) {
+	p = shard.entries.erase(p);
+      } else {
+	++p;
+      }
+    }
+    if (shard.entries.size() >= max_shard_size) {
+      shard.entries.erase(shard.entries.begin());
+    }
+  }
+  shard.entries[key] = entry_t{info, expires};
+}
+
 bool CephXAuthorizer::verify_reply(bufferlist::const_iterator& indata,
 				   std::string *connection_secret)
 {
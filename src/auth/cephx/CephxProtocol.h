@@ -32,7 +32,10 @@
 
 #include "auth/Auth.h"
 #include <errno.h>
+#include <array>
 #include <sstream>
+#include <unordered_map>
+#include "common/ceph_mutex.h"
 
 class CephContext;
 
@@ -419,6 +422,42 @@ bool cephx_decode_ticket(CephContext *cct, KeyStore *keys,
 			 uint32_t service_id, CephXTicketBlob& ticket_blob,
 			 CephXServiceTicketInfo& ticket_info);
 
+/*
+ * The service tickets decrypted by cephx_verify_authorizer, by the ticket
+ * blob they came in, so that the connections that follow with the same
+ * ticket skip fetching the rotating secret and decrypting it.  The
+ * authorizer is still decrypted with the session key and checked every
+ * time, so holding a ticket without its session key is of no use.
+ * Entries go away when their ticket expires, or after
+ * auth_ticket_cache_ttl if that's sooner.
+ */
+class CephXServiceTicketCache {
+  static constexpr size_t NUM_SHARDS = 16;
+
+  struct entry_t {
+    CephXServiceTicketInfo info;
+    utime_t expires;
+  };
+  struct shard_t {
+    ceph::mutex lock = ceph::make_mutex("CephXServiceTicketCache::lock");
+    std::unordered_map<std::string, entry_t> entries;
+  };
+  std::array<shard_t, NUM_SHARDS> shards;
+
+  /// the whole blob, so that a match is the very same ticket
+  static std::string make_key(uint32_t service_id,
+			      const CephXTicketBlob& ticket);
+  shard_t& get_shard(const std::string& key);
+
+public:
+  bool find(uint32_t service_id, const CephXTicketBlob& ticket, utime_t now,
+	    CephXServiceTicketInfo *info);
+  /// max_size of 0 or a ttl <= 0 caches nothing
+  void add(uint32_t service_id, const CephXTicketBlob& ticket,
+	   const CephXServiceTicketInfo& info, utime_t now, double ttl,
+	   size_t max_size);
+};
+
 /*
  * Verify authorizer and generate reply authorizer
  */
@@ -430,7 +469,8 @@ extern bool cephx_verify_authorizer(
   CephXServiceTicketInfo& ticket_info,
   std::unique_ptr<AuthAuthorizerChallenge> *challenge,
   std::string *connection_secret,
-  bufferlist *reply_bl);
+  bufferlist *reply_bl,
+  CephXServiceTicketCache *ticket_cache = nullptr);
 
 
 
@@ -9214,14 +9214,9 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
   C_SaferCond onfinish("Client::_read_async flock");
   r = objectcacher->file_read(&in->oset, &in->layout, in->snapid,
 			      off, len, bl, 0, &onfinish);
-  if (r == 0) {
-    get_cap_ref(in, CEPH_CAP_FILE_CACHE);
-    client_lock.Unlock();
-    r = onfinish.wait();
-    client_lock.Lock();
-    put_cap_ref(in, CEPH_CAP_FILE_CACHE);
-  }
 
+  // start the readahead before waiting for the read, so that the reads
+  // of the objects past it are in flight along with it
   if(f->readahead.get_min_readahead_size() > 0) {
     pair<uint64_t, uint64_t> readahead_extent = f->readahead.update(off, len, in->size);
     if (readahead_extent.second > 0) {
@@ -9241,6 +9236,14 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
     }
   }
 
+  if (r == 0) {
+    get_cap_ref(in, CEPH_CAP_FILE_CACHE);
+    client_lock.Unlock();
+    r = onfinish.wait();
+    client_lock.Lock();
+    put_cap_ref(in, CEPH_CAP_FILE_CACHE);
+  }
+
   return r;
 }
 
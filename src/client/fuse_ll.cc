@@ -600,10 +600,20 @@ static void fuse_ll_read(fuse_req_t req, fuse_ino_t ino, size_t size, off_t off,
   Fh *fh = reinterpret_cast<Fh*>(fi->fh);
   bufferlist bl;
   int r = cfuse->client->ll_read(fh, off, size, &bl);
-  if (r >= 0)
-    fuse_reply_buf(req, bl.c_str(), bl.length());
-  else
+  if (r < 0) {
     fuse_reply_err(req, -r);
+  } else if (bl.get_num_buffers() > 1 && bl.get_num_buffers() < IOV_MAX) {
+    // reply from the buffers as they are, rather than copying them into
+    // one (one iovec is left for the reply header)
+    std::vector<struct iovec> iov;
+    iov.reserve(bl.get_num_buffers());
+    for (const auto& p : bl.buffers()) {
+      iov.push_back({const_cast<char*>(p.c_str()), p.length()});
+    }
+    fuse_reply_iov(req, iov.data(), iov.size());
+  } else {
+    fuse_reply_buf(req, bl.c_str(), bl.length());
+  }
 }
 
 static void fuse_ll_write(fuse_req_t req, fuse_ino_t ino, const char *buf,
@@ -1086,7 +1096,7 @@ int CephFuse::Handle::init(int argc, const char *argv[])
 
   // set up fuse argc/argv
   int newargc = 0;
-  const char **newargv = (const char **) malloc((argc + 10) * sizeof(char *));
+  const char **newargv = (const char **) malloc((argc + 16) * sizeof(char *));
   if(!newargv)
     return ENOMEM;
 
@@ -1119,10 +1129,10 @@ int CephFuse::Handle::init(int argc, const char *argv[])
     newargv[newargc++] = "-o";
     newargv[newargc++] = "big_writes";
   }
+  // must outlive fuse_parse_cmdline(), below
+  char strsplice[65];
   if (fuse_max_write > 0) {
-    char strsplice[65];
     newargv[newargc++] = "-o";
-    newargv[newargc++] = strsplice;
     sprintf(strsplice, "max_write=%zu", (size_t)fuse_max_write);
     newargv[newargc++] = strsplice;
   }
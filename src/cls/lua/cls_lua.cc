@@ -3,8 +3,11 @@
  */
 #include <errno.h>
 #include <setjmp.h>
+#include <list>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <unordered_map>
 #include <lua.hpp>
 #include "include/types.h"
 #include "objclass/objclass.h"
@@ -16,9 +19,10 @@ CLS_VER(1,0)
 CLS_NAME(lua)
 
 /*
- * Jump point for recovering from Lua panic.
+ * Jump point for recovering from Lua panic. Methods run concurrently, each
+ * thread jumps back to its own.
  */
-static jmp_buf cls_lua_panic_jump;
+static thread_local jmp_buf cls_lua_panic_jump;
 
 /*
  * Handle Lua panic.
@@ -55,6 +59,9 @@ struct clslua_hctx {
   string script;      // lua script
   string handler;     // lua handler
   bufferlist input;   // lua handler input
+
+  string bytecode;    // compiled script, if cached or compiled by this call
+  bool compiled;      // bytecode was compiled by this call
 };
 
 /* Lua registry key for method context */
@@ -760,7 +767,7 @@ static void clslua_setup_env(lua_State *L)
  *   "input": "..." # optional
  * }
  */
-static int unpack_json_command(lua_State *L, struct clslua_hctx *ctx,
+static int unpack_json_command(struct clslua_hctx *ctx,
     std::string& script, std::string& handler, std::string& input,
     size_t *input_len)
 {
@@ -826,34 +833,20 @@ static int unpack_json_command(lua_State *L, struct clslua_hctx *ctx,
 }
 
 /*
- * Runs the script, and calls handler.
+ * Deserialize the input that contains the script, the name of the handler
+ * to call, and the handler input.
  */
-static int clslua_eval(lua_State *L)
+static int clslua_unpack(struct clslua_hctx *ctx)
 {
-  struct clslua_hctx *ctx = __clslua_get_hctx(L);
-  ctx->ret = -EIO; /* assume failure */
-
-  /*
-   * Load modules, errno value constants, and other environment goodies. Must
-   * be done before loading/compiling the chunk.
-   */
-  clslua_setup_env(L);
-
-  /*
-   * Deserialize the input that contains the script, the name of the handler
-   * to call, and the handler input.
-   */
   switch (ctx->in_enc) {
     case JSON_ENC:
       {
         std::string input_str;
         size_t input_str_len = 0;
 
-        // if there is an error decoding json then ctx->ret will be set and we
-        // return normally from this function.
-        if (unpack_json_command(L, ctx, ctx->script, ctx->handler, input_str,
+        if (unpack_json_command(ctx, ctx->script, ctx->handler, input_str,
               &input_str_len))
-          return 0;
+          return ctx->ret;
 
         bufferptr bp(input_str.c_str(), input_str_len);
         ctx->input.push_back(bp);
@@ -869,8 +862,7 @@ static int clslua_eval(lua_State *L)
           decode(op, it);
         } catch (const buffer::error &err) {
           CLS_ERR("error: could not decode ceph encoded input");
-          ctx->ret = -EINVAL;
-          return 0;
+          return -EINVAL;
         }
 
         ctx->script.swap(op.script);
@@ -881,11 +873,100 @@ static int clslua_eval(lua_State *L)
 
     default:
       CLS_ERR("error: unknown encoding type");
-      ctx->ret = -EFAULT;
       ceph_abort();
-      return 0;
+      return -EFAULT;
+  }
+  return 0;
+}
+
+/*
+ * The compiled scripts are kept, so that the new state of each call loads
+ * the script from bytecode instead of compiling it again. They are keyed by
+ * the script, and the least recently used scripts go first once there are
+ * too many of them or they take too much memory. Only the bytecode is
+ * shared: every call still runs it in a new state of its own.
+ */
+static const size_t clslua_max_scripts = 128;
+static const size_t clslua_max_script_bytes = 8 << 20;
+
+class clslua_bytecode_cache {
+  struct entry {
+    std::list<std::string>::iterator lru_pos;
+    std::string bytecode;
+  };
+
+  std::mutex lock;
+  std::unordered_map<std::string, entry> scripts;
+  std::list<std::string> lru; // most recently used first
+  size_t bytes = 0;           // scripts and bytecode
+
+  void trim() {
+    while (scripts.size() > clslua_max_scripts ||
+           bytes > clslua_max_script_bytes) {
+      auto p = scripts.find(lru.back());
+      ceph_assert(p != scripts.end());
+      bytes -= p->first.size() + p->second.bytecode.size();
+      scripts.erase(p);
+      lru.pop_back();
+    }
   }
 
+public:
+  /*
+   * Returns the compiled script, if there is one.
+   */
+  bool get(const std::string& script, std::string *bytecode) {
+    std::lock_guard<std::mutex> l(lock);
+    auto p = scripts.find(script);
+    if (p == scripts.end())
+      return false;
+    lru.splice(lru.begin(), lru, p->second.lru_pos);
+    *bytecode = p->second.bytecode;
+    return true;
+  }
+
+  void put(const std::string& script, std::string&& bytecode) {
+    std::lock_guard<std::mutex> l(lock);
+    if (script.size() + bytecode.size() > clslua_max_script_bytes)
+      return;
+    auto p = scripts.find(script);
+    if (p != scripts.end()) {
+      /* compiled by a racing call as well */
+      lru.splice(lru.begin(), lru, p->second.lru_pos);
+      return;
+    }
+    lru.push_front(script);
+    auto& e = scripts[script];
+    e.lru_pos = lru.begin();
+    e.bytecode = std::move(bytecode);
+    bytes += script.size() + e.bytecode.size();
+    trim();
+  }
+};
+
+static clslua_bytecode_cache clslua_scripts;
+
+static int clslua_dump_writer(lua_State *L, const void *p, size_t sz,
+    void *ud)
+{
+  static_cast<std::string *>(ud)->append(static_cast<const char *>(p), sz);
+  return 0;
+}
+
+/*
+ * Runs the script, and calls handler.
+ */
+static int clslua_eval(lua_State *L)
+{
+  struct clslua_hctx *ctx = __clslua_get_hctx(L);
+  ctx->ret = -EIO; /* assume failure */
+
+  /*
+   * Load modules, errno value constants, and other environment goodies. Must
+   * be done before loading/compiling the chunk.
+   */
+  clslua_setup_env(L);
+
   /*
    * Create table to hold registered (valid) handlers.
    *
@@ -897,9 +978,19 @@ static int clslua_eval(lua_State *L)
   lua_newtable(L);
   lua_settable(L, LUA_REGISTRYINDEX);
 
-  /* load and compile chunk */
-  if (luaL_loadstring(L, ctx->script.c_str()))
-    return lua_error(L);
+  /* load the compiled chunk, or compile it */
+  if (ctx->bytecode.size()) {
+    if (luaL_loadbufferx(L, ctx->bytecode.data(), ctx->bytecode.size(),
+          ctx->script.c_str(), "b"))
+      return lua_error(L);
+  } else {
+    if (luaL_loadstring(L, ctx->script.c_str()))
+      return lua_error(L);
+    if (lua_dump(L, clslua_dump_writer, &ctx->bytecode, 0) == 0)
+      ctx->compiled = true;
+    else
+      ctx->bytecode.clear();
+  }
 
   /* execute chunk */
   lua_call(L, 0, 0);
@@ -957,8 +1048,16 @@ static int eval_generic(cls_method_context_t hctx, bufferlist *in, bufferlist *o
   ctx.in_enc = in_enc;
   ctx.outbl = out;
   ctx.error.error = false;
+  ctx.ret = -EIO;
+  ctx.compiled = false;
+
+  ret = clslua_unpack(&ctx);
+  if (ret < 0)
+    return ret;
+  ret = -EIO;
 
-  /* build lua vm state */
+  /* build lua vm state, with the compiled script if there is one */
+  clslua_scripts.get(ctx.script, &ctx.bytecode);
   L = luaL_newstate();
   if (!L) {
     CLS_ERR("error creating new Lua state");
@@ -1019,6 +1118,8 @@ static int eval_generic(cls_method_context_t hctx, bufferlist *in, bufferlist *o
   }
 
 out:
+  if (ctx.compiled)
+    clslua_scripts.put(ctx.script, std::move(ctx.bytecode));
   if (L)
     lua_close(L);
   return ret;
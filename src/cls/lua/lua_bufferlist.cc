@@ -2,6 +2,7 @@
  * Lua module wrapping librados::bufferlist
  */
 #include <errno.h>
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <math.h>
@@ -52,22 +53,107 @@ static int bl_new(lua_State *L)
   return 1;
 }
 
+/*
+ * Checks the (offset, length) arguments of a range of bufferlist at pos, the
+ * length defaulting to the rest of the bufferlist.
+ */
+static void bl_checkrange(lua_State *L, bufferlist *bl, int pos,
+    unsigned *off, unsigned *len)
+{
+  lua_Integer o = luaL_optinteger(L, pos, 0);
+  luaL_argcheck(L, o >= 0 && o <= (lua_Integer)bl->length(), pos,
+      "offset out of range");
+  lua_Integer l = luaL_optinteger(L, pos + 1, bl->length() - o);
+  luaL_argcheck(L, l >= 0, pos + 1, "negative length");
+  *off = o;
+  *len = std::min<lua_Integer>(l, bl->length() - o);
+}
+
+/*
+ * Copies a range of bufferlist into a Lua string, without flattening the
+ * bufferlist first.
+ */
+static void bl_pushrange(lua_State *L, bufferlist *bl, unsigned off,
+    unsigned len)
+{
+  if (!len) {
+    lua_pushliteral(L, "");
+    return;
+  }
+  auto p = bl->cbegin();
+  p.advance(off);
+  const char *data;
+  if (p.get_ptr_and_advance(len, &data) == len) {
+    lua_pushlstring(L, data, len);
+    return;
+  }
+  luaL_Buffer b;
+  char *dst = luaL_buffinitsize(L, &b, len);
+  bl->copy(off, len, dst);
+  luaL_pushresultsize(&b, len);
+}
+
 /*
  * Convert bufferlist to Lua string
  */
 static int bl_str(lua_State *L)
 {
   bufferlist *bl = clslua_checkbufferlist(L);
-  lua_pushlstring(L, bl->c_str(), bl->length());
+  bl_pushrange(L, bl, 0, bl->length());
+  return 1;
+}
+
+/*
+ * Convert a range of bufferlist to Lua string: bl:sub(offset [, length])
+ */
+static int bl_sub(lua_State *L)
+{
+  bufferlist *bl = clslua_checkbufferlist(L);
+  unsigned off, len;
+  bl_checkrange(L, bl, 2, &off, &len);
+  bl_pushrange(L, bl, off, len);
+  return 1;
+}
+
+/*
+ * A new bufferlist of a range of bufferlist, sharing its data:
+ * bl:view(offset [, length])
+ */
+static int bl_view(lua_State *L)
+{
+  bufferlist *bl = clslua_checkbufferlist(L);
+  unsigned off, len;
+  bl_checkrange(L, bl, 2, &off, &len);
+  bufferlist *ret = clslua_pushbufferlist(L, NULL);
+  ret->substr_of(*bl, off, len);
+  return 1;
+}
+
+/*
+ * The byte at offset in bufferlist: bl:byte(offset)
+ */
+static int bl_byte(lua_State *L)
+{
+  bufferlist *bl = clslua_checkbufferlist(L);
+  lua_Integer off = luaL_checkinteger(L, 2);
+  luaL_argcheck(L, off >= 0 && off < (lua_Integer)bl->length(), 2,
+      "offset out of range");
+  lua_pushinteger(L, (unsigned char)(*bl)[off]);
   return 1;
 }
 
 /*
- * Append a Lua string to bufferlist
+ * Append a Lua string, or the data of a bufferlist without copying it, to
+ * bufferlist
  */
 static int bl_append(lua_State *L)
 {
   bufferlist *bl = clslua_checkbufferlist(L);
+  if (lua_type(L, 2) == LUA_TUSERDATA) {
+    bufferlist other(*clslua_checkbufferlist(L, 2));
+    bl->claim_append(other);
+    return 0;
+  }
   luaL_checktype(L, 2, LUA_TSTRING);
 
   size_t len;
@@ -128,8 +214,8 @@ static int bl_concat(lua_State *L)
   bufferlist *bl1 = clslua_checkbufferlist(L, 1);
   bufferlist *bl2 = clslua_checkbufferlist(L, 2);
   bufferlist *ret = clslua_pushbufferlist(L, NULL);
-  ret->append(bl1->c_str(), bl1->length());
-  ret->append(bl2->c_str(), bl2->length());
+  ret->append(*bl1);
+  ret->append(*bl2);
   return 1;
 }
 
@@ -148,6 +234,9 @@ static int bl_gc(lua_State *L)
 
 static const struct luaL_Reg bufferlist_methods[] = {
   {"str", bl_str},
+  {"sub", bl_sub},
+  {"view", bl_view},
+  {"byte", bl_byte},
   {"append", bl_append},
   {"__concat", bl_concat},
   {"__len", bl_len},
@@ -1486,26 +1486,41 @@ int metadata_list_finish(bufferlist::const_iterator *it,
   return 0;
 }
 
-int metadata_get(librados::IoCtx *ioctx, const std::string &oid,
-                 const std::string &key, string *s)
+void metadata_get_start(librados::ObjectReadOperation *op,
+                        const std::string &key)
 {
-  ceph_assert(s);
-  bufferlist in, out;
+  bufferlist in;
   encode(key, in);
-  int r = ioctx->exec(oid, "rbd", "metadata_get", in, out);
-  if (r < 0)
-    return r;
+  op->exec("rbd", "metadata_get", in);
+}
 
-  auto iter = out.cbegin();
+int metadata_get_finish(bufferlist::const_iterator *it, std::string *s)
+{
+  ceph_assert(s);
   try {
-    decode(*s, iter);
+    decode(*s, *it);
   } catch (const buffer::error &err) {
     return -EBADMSG;
   }
-
   return 0;
 }
 
+int metadata_get(librados::IoCtx *ioctx, const std::string &oid,
+                 const std::string &key, string *s)
+{
+  librados::ObjectReadOperation op;
+  metadata_get_start(&op, key);
+
+  bufferlist out_bl;
+  int r = ioctx->operate(oid, &op, &out_bl);
+  if (r < 0) {
+    return r;
+  }
+
+  auto it = out_bl.cbegin();
+  return metadata_get_finish(&it, s);
+}
+
 void child_attach(librados::ObjectWriteOperation *op, snapid_t snap_id,
                   const cls::rbd::ChildImageSpec& child_image)
 {
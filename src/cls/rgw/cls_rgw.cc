@@ -822,34 +822,26 @@ static int read_key_entry(cls_method_context_t hctx, cls_rgw_obj_key& key,
   return 0;
 }
 
-int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+/*
+ * apply a complete op to its entry, updating the header in memory; sets
+ * *header_changed if the caller needs to write the header back. returns
+ * -EINVAL or -ENOENT before changing anything when the op doesn't apply
+ */
+static int complete_entry(cls_method_context_t hctx,
+                          rgw_bucket_dir_header& header,
+                          rgw_cls_obj_complete_op& op,
+                          bool *header_changed)
 {
-  // decode request
-  rgw_cls_obj_complete_op op;
-  auto iter = in->cbegin();
-  try {
-    decode(op, iter);
-  } catch (buffer::error& err) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to decode request\n");
-    return -EINVAL;
-  }
   CLS_LOG(1, "rgw_bucket_complete_op(): request: op=%d name=%s instance=%s ver=%lu:%llu tag=%s\n",
           op.op, op.key.name.c_str(), op.key.instance.c_str(),
           (unsigned long)op.ver.pool, (unsigned long long)op.ver.epoch,
           op.tag.c_str());
 
-  rgw_bucket_dir_header header;
-  int rc = read_bucket_header(hctx, &header);
-  if (rc < 0) {
-    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
-    return -EINVAL;
-  }
-
   rgw_bucket_dir_entry entry;
   bool ondisk = true;
 
   string idx;
-  rc = read_key_entry(hctx, op.key, &idx, &entry);
+  int rc = read_key_entry(hctx, op.key, &idx, &entry);
   if (rc == -ENOENT) {
     entry.key = op.key;
     entry.ver = op.ver;
@@ -902,7 +894,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
     }
 
     if (op.log_op && !header.syncstopped) {
-      return write_bucket_header(hctx, &header);
+      *header_changed = true;
     }
     return 0;
   }
@@ -962,6 +954,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
 
   list<cls_rgw_obj_key>::iterator remove_iter;
   CLS_LOG(20, "rgw_bucket_complete_op(): remove_objs.size()=%d\n", (int)op.remove_objs.size());
+  set<string> remove_keys; // removed with a single omap op below
   for (remove_iter = op.remove_objs.begin(); remove_iter != op.remove_objs.end(); ++remove_iter) {
     cls_rgw_obj_key& remove_key = *remove_iter;
     CLS_LOG(1, "rgw_bucket_complete_op(): removing entries, read_index_entry name=%s instance=%s\n",
@@ -974,7 +967,7 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
             remove_key.name.c_str(), remove_key.instance.c_str(), ret);
       continue;
     }
-    CLS_LOG(0,
+    CLS_LOG(20,
 	    "rgw_bucket_complete_op(): entry.name=%s entry.instance=%s entry.meta.category=%d\n",
             remove_entry.key.name.c_str(),
 	    remove_entry.key.instance.c_str(),
@@ -989,14 +982,101 @@ int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist
         continue;
     }
 
-    ret = cls_cxx_map_remove_key(hctx, k);
-    if (ret < 0) {
-      CLS_LOG(1, "rgw_bucket_complete_op(): cls_cxx_map_remove_key, failed to remove entry, name=%s instance=%s read_index_entry ret=%d\n", remove_key.name.c_str(), remove_key.instance.c_str(), rc);
+    remove_keys.insert(std::move(k));
+  }
+
+  if (!remove_keys.empty()) {
+    rc = cls_cxx_map_remove_keys(hctx, remove_keys);
+    if (rc < 0) {
+      CLS_LOG(1, "rgw_bucket_complete_op(): cls_cxx_map_remove_keys, failed to remove %d entries ret=%d\n", (int)remove_keys.size(), rc);
+    }
+  }
+
+  *header_changed = true;
+  return 0;
+}
+
+int rgw_bucket_complete_op(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  // decode request
+  rgw_cls_obj_complete_op op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_op(): failed to read header\n");
+    return -EINVAL;
+  }
+
+  bool header_changed = false;
+  rc = complete_entry(hctx, header, op, &header_changed);
+  if (rc < 0)
+    return rc;
+
+  if (header_changed)
+    return write_bucket_header(hctx, &header);
+  return 0;
+}
+
+/*
+ * apply a batch of complete ops with a single read and write of the
+ * header, all in the one transaction. an op that doesn't apply is
+ * skipped, as if it had been sent (and failed) on its own. the ops must
+ * be for distinct keys, since each reads its entry from the omap we
+ * haven't written yet
+ */
+int rgw_bucket_complete_ops(cls_method_context_t hctx, bufferlist *in, bufferlist *out)
+{
+  // decode request
+  rgw_cls_obj_complete_ops op;
+  auto iter = in->cbegin();
+  try {
+    decode(op, iter);
+  } catch (buffer::error& err) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_ops(): failed to decode request\n");
+    return -EINVAL;
+  }
+
+  set<string> keys;
+  for (auto& o : op.ops) {
+    string idx;
+    encode_obj_index_key(o.key, &idx);
+    if (!keys.insert(idx).second) {
+      CLS_LOG(1, "ERROR: rgw_bucket_complete_ops(): duplicate key name=%s instance=%s\n",
+              o.key.name.c_str(), o.key.instance.c_str());
+      return -EINVAL;
+    }
+  }
+
+  rgw_bucket_dir_header header;
+  int rc = read_bucket_header(hctx, &header);
+  if (rc < 0) {
+    CLS_LOG(1, "ERROR: rgw_bucket_complete_ops(): failed to read header\n");
+    return -EINVAL;
+  }
+
+  bool header_changed = false;
+  for (auto& o : op.ops) {
+    rc = complete_entry(hctx, header, o, &header_changed);
+    if (rc == -EINVAL || rc == -ENOENT) {
+      CLS_LOG(1, "rgw_bucket_complete_ops(): skipping op name=%s instance=%s ret=%d\n",
+              o.key.name.c_str(), o.key.instance.c_str(), rc);
       continue;
     }
+    if (rc < 0)
+      return rc;
   }
 
-  return write_bucket_header(hctx, &header);
+  if (header_changed)
+    return write_bucket_header(hctx, &header);
+  return 0;
 }
 
 template <class T>
@@ -3482,6 +3562,8 @@ static int rgw_cls_gc_list(cls_method_context_t hctx, bufferlist *in, bufferlist
 
 static int gc_remove(cls_method_context_t hctx, vector<string>& tags)
 {
+  // remove the keys of both indexes with a single omap op
+  set<string> keys;
   for (auto iter = tags.begin(); iter != tags.end(); ++iter) {
     string& tag = *iter;
     cls_rgw_gc_obj_info info;
@@ -3496,18 +3578,17 @@ static int gc_remove(cls_method_context_t hctx, vector<string>& tags)
 
     string time_key;
     get_time_key(info.time, &time_key);
-    ret = gc_omap_remove(hctx, GC_OBJ_TIME_INDEX, time_key);
-    if (ret < 0 && ret != -ENOENT)
-      return ret;
-    if (ret == -ENOENT) {
-      CLS_LOG(0, "couldn't find key in time index key=%s\n", time_key.c_str());
-    }
-
-    ret = gc_omap_remove(hctx, GC_OBJ_NAME_INDEX, tag);
-    if (ret < 0 && ret != -ENOENT)
-      return ret;
+    keys.insert(gc_index_prefixes[GC_OBJ_TIME_INDEX] + time_key);
+    keys.insert(gc_index_prefixes[GC_OBJ_NAME_INDEX] + tag);
   }
 
+  if (keys.empty())
+    return 0;
+
+  int ret = cls_cxx_map_remove_keys(hctx, keys);
+  if (ret < 0 && ret != -ENOENT)
+    return ret;
+
   return 0;
 }
 
@@ -3933,6 +4014,7 @@ CLS_INIT(rgw)
   cls_method_handle_t h_rgw_bucket_update_stats;
   cls_method_handle_t h_rgw_bucket_prepare_op;
   cls_method_handle_t h_rgw_bucket_complete_op;
+  cls_method_handle_t h_rgw_bucket_complete_ops;
   cls_method_handle_t h_rgw_bucket_link_olh;
   cls_method_handle_t h_rgw_bucket_unlink_instance_op;
   cls_method_handle_t h_rgw_bucket_read_olh_log;
@@ -3984,6 +4066,7 @@ CLS_INIT(rgw)
   cls_register_cxx_method(h_class, RGW_BUCKET_UPDATE_STATS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_update_stats, &h_rgw_bucket_update_stats);
   cls_register_cxx_method(h_class, RGW_BUCKET_PREPARE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_prepare_op, &h_rgw_bucket_prepare_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OP, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_op, &h_rgw_bucket_complete_op);
+  cls_register_cxx_method(h_class, RGW_BUCKET_COMPLETE_OPS, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_complete_ops, &h_rgw_bucket_complete_ops);
   cls_register_cxx_method(h_class, RGW_BUCKET_LINK_OLH, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_link_olh, &h_rgw_bucket_link_olh);
   cls_register_cxx_method(h_class, RGW_BUCKET_UNLINK_INSTANCE, CLS_METHOD_RD | CLS_METHOD_WR, rgw_bucket_unlink_instance, &h_rgw_bucket_unlink_instance_op);
   cls_register_cxx_method(h_class, RGW_BUCKET_READ_OLH_LOG, CLS_METHOD_RD, rgw_bucket_read_olh_log, &h_rgw_bucket_read_olh_log);
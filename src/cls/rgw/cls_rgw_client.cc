@@ -209,6 +209,16 @@ void cls_rgw_bucket_complete_op(ObjectWriteOperation& o, RGWModifyOp op, string&
   o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OP, in);
 }
 
+void cls_rgw_bucket_complete_ops(ObjectWriteOperation& o,
+                                 const list<rgw_cls_obj_complete_op>& ops)
+{
+  bufferlist in;
+  rgw_cls_obj_complete_ops call;
+  call.ops = ops;
+  encode(call, in);
+  o.exec(RGW_CLASS, RGW_BUCKET_COMPLETE_OPS, in);
+}
+
 void cls_rgw_bucket_list_op(librados::ObjectReadOperation& op,
                             const cls_rgw_obj_key& start_obj,
                             const std::string& filter_prefix,
@@ -309,6 +319,19 @@ int cls_rgw_bi_get(librados::IoCtx& io_ctx, const string oid,
   return 0;
 }
 
+void cls_rgw_bi_get_op(librados::ObjectReadOperation& op,
+                       BIIndexType index_type, const cls_rgw_obj_key& key,
+                       rgw_cls_bi_get_ret *result, int *ret)
+{
+  bufferlist in;
+  rgw_cls_bi_get_op call;
+  call.key = key;
+  call.type = index_type;
+  encode(call, in);
+  op.exec(RGW_CLASS, RGW_BI_GET, in,
+          new ClsBucketIndexOpCtx<rgw_cls_bi_get_ret>(result, ret));
+}
+
 int cls_rgw_bi_put(librados::IoCtx& io_ctx, const string oid, rgw_cls_bi_entry& entry)
 {
   bufferlist in, out;
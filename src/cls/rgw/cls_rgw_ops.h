@@ -162,6 +162,23 @@ struct rgw_cls_obj_complete_op
 };
 WRITE_CLASS_ENCODER(rgw_cls_obj_complete_op)
 
+struct rgw_cls_obj_complete_ops
+{
+  list<rgw_cls_obj_complete_op> ops; // for distinct keys
+
+  void encode(bufferlist &bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(ops, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator &bl) {
+    DECODE_START(1, bl);
+    decode(ops, bl);
+    DECODE_FINISH(bl);
+  }
+};
+WRITE_CLASS_ENCODER(rgw_cls_obj_complete_ops)
+
 struct rgw_cls_link_olh_op {
   cls_rgw_obj_key key;
   string olh_tag;
@@ -0,0 +1,20 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "CDC.h"
+#include "FastCDC.h"
+#include "FixedCDC.h"
+
+std::unique_ptr<CDC> CDC::create(const std::string& type, int bits)
+{
+  if (bits < MIN_BITS || bits > MAX_BITS) {
+    return nullptr;
+  }
+  if (type == "fixed") {
+    return std::make_unique<FixedCDC>(bits);
+  }
+  if (type == "fastcdc") {
+    return std::make_unique<FastCDC>(bits);
+  }
+  return nullptr;
+}
@@ -0,0 +1,40 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_COMMON_CDC_H
+#define CEPH_COMMON_CDC_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/buffer.h"
+
+/*
+ * Splits data into chunks for deduplication.
+ *
+ * The content defined flavours cut the data where its content says so,
+ * so that inserting or removing bytes only changes the chunks around
+ * the change and the rest still dedup against the earlier copies.
+ */
+class CDC {
+public:
+  virtual ~CDC() = default;
+
+  /// append the (offset, length) of the chunks of bl to chunks
+  virtual void calc_chunks(
+    const ceph::bufferlist& bl,
+    std::vector<std::pair<uint64_t, uint64_t>> *chunks) const = 0;
+
+  /// the range of bits create() takes; the largest chunks fastcdc cuts
+  /// have to fit the 32 bit lengths of a chunk_map
+  static constexpr int MIN_BITS = 2;
+  static constexpr int MAX_BITS = 29;
+
+  /// "fixed" or "fastcdc", with chunks of 2^bits bytes on average;
+  /// null if type is unknown or bits is out of range
+  static std::unique_ptr<CDC> create(const std::string& type, int bits);
+};
+
+#endif
@@ -4,6 +4,9 @@
 #ifndef CEPH_OS_BLUESTORE_CHECKSUMMER
 #define CEPH_OS_BLUESTORE_CHECKSUMMER
 
+#include <vector>
+
+#include "include/crc32c.h"
 #include "xxHash/xxhash.h"
 
 class Checksummer {
@@ -265,6 +268,94 @@ public:
     Alg::fini(&state);
     return -1;  // no errors
   }
+
+  /// Collects crc32c blocks, possibly of many blobs, so that they can
+  /// be hashed several at a time by ceph_crc32c_multi().  Both the data
+  /// and the csum buffers must stay put until flush().
+  class crc32c_batch {
+    struct item_t {
+      const unsigned char *data;
+      char *out;
+      int csum_type;
+    };
+    size_t block_size = 0;
+    std::vector<item_t> items;
+
+    static void store(int csum_type, char *out, uint32_t crc) {
+      switch (csum_type) {
+      case CSUM_CRC32C:
+	*reinterpret_cast<crc32c::value_t*>(out) = crc;
+	break;
+      case CSUM_CRC32C_16:
+	*reinterpret_cast<crc32c_16::value_t*>(out) = crc & 0xffff;
+	break;
+      case CSUM_CRC32C_8:
+	*reinterpret_cast<crc32c_8::value_t*>(out) = crc & 0xff;
+	break;
+      default:
+	ceph_abort();
+      }
+    }
+
+  public:
+    static bool is_batchable(int csum_type) {
+      return csum_type == CSUM_CRC32C ||
+	csum_type == CSUM_CRC32C_16 ||
+	csum_type == CSUM_CRC32C_8;
+    }
+
+    /// same arguments as calculate(), the csums are filled in on flush()
+    void add(int csum_type,
+	     size_t csum_block_size,
+	     size_t offset,
+	     size_t length,
+	     const bufferlist &bl,
+	     bufferptr* csum_data) {
+      ceph_assert(is_batchable(csum_type));
+      ceph_assert(length % csum_block_size == 0);
+      ceph_assert(bl.length() >= length);
+      size_t value_size = get_csum_value_size(csum_type);
+      ceph_assert(csum_data->length() >= (offset + length) / csum_block_size *
+		  value_size);
+      if (csum_block_size != block_size) {
+	flush();
+	block_size = csum_block_size;
+      }
+      char *pv = csum_data->c_str() + offset / csum_block_size * value_size;
+      bufferlist::const_iterator p = bl.begin();
+      for (size_t blocks = length / csum_block_size; blocks > 0; --blocks) {
+	const char *data;
+	size_t l = p.get_ptr_and_advance(csum_block_size, &data);
+	if (l == csum_block_size) {
+	  items.push_back(
+	    item_t{reinterpret_cast<const unsigned char*>(data), pv, csum_type});
+	} else {
+	  // block spans buffers, not worth gathering
+	  uint32_t crc = ceph_crc32c(
+	    -1, reinterpret_cast<const unsigned char*>(data), l);
+	  store(csum_type, pv, p.crc32c(csum_block_size - l, crc));
+	}
+	pv += value_size;
+      }
+    }
+
+    void flush() {
+      constexpr size_t group = 16;
+      const unsigned char *data[group];
+      uint32_t crc[group];
+      for (size_t i = 0; i < items.size(); i += group) {
+	size_t n = std::min(group, items.size() - i);
+	for (size_t j = 0; j < n; ++j) {
+	  data[j] = items[i + j].data;
+	}
+	ceph_crc32c_multi(-1, data, n, block_size, crc);
+	for (size_t j = 0; j < n; ++j) {
+	  store(items[i + j].csum_type, items[i + j].out, crc[j]);
+	}
+      }
+      items.clear();
+    }
+  };
 };
 
 #endif
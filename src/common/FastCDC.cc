@@ -0,0 +1,92 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <array>
+#include <random>
+
+#include "include/ceph_assert.h"
+#include "FastCDC.h"
+
+// the random value each byte adds to the hash; the seed is fixed, so
+// that the same data is always cut at the same places
+static const std::array<uint64_t, 256>& gear_table()
+{
+  static const std::array<uint64_t, 256> table = [] {
+    std::array<uint64_t, 256> t;
+    std::mt19937_64 gen(0x6765617263646321ull);
+    for (auto& v : t) {
+      v = gen();
+    }
+    return t;
+  }();
+  return table;
+}
+
+// the hash shifts left, so its high bits depend on the most bytes
+static uint64_t high_bits_mask(int bits)
+{
+  return bits <= 0 ? 0 : ~0ull << (64 - bits);
+}
+
+FastCDC::FastCDC(int bits, int normalization)
+  : min_size(1ull << (bits - 2)),
+    avg_size(1ull << bits),
+    max_size(1ull << (bits + 2)),
+    small_mask(high_bits_mask(bits + normalization)),
+    large_mask(high_bits_mask(bits - normalization))
+{
+  ceph_assert(bits >= 2 && bits + normalization < 64);
+}
+
+void FastCDC::calc_chunks(
+  const ceph::bufferlist& bl,
+  std::vector<std::pair<uint64_t, uint64_t>> *chunks) const
+{
+  const auto& gear = gear_table();
+  uint64_t start = 0;   // of the chunk being cut
+  uint64_t off = 0;     // of the buffer being scanned
+  uint64_t hash = 0;
+
+  for (const auto& b : bl.buffers()) {
+    const unsigned char *data = (const unsigned char *)b.c_str();
+    const uint64_t len = b.length();
+    uint64_t i = 0;
+    while (i < len) {
+      const uint64_t size = off + i - start;
+      if (size < min_size) {
+	i += std::min(min_size - size, len - i);
+	continue;
+      }
+      uint64_t mask, end;
+      if (size < avg_size) {
+	mask = small_mask;
+	end = i + std::min(avg_size - size, len - i);
+      } else {
+	mask = large_mask;
+	end = i + std::min(max_size - size, len - i);
+      }
+      uint64_t j = i;
+      for (; j < end; ++j) {
+	hash = (hash << 1) + gear[data[j]];
+	if (!(hash & mask)) {
+	  break;
+	}
+      }
+      if (j < end) {
+	i = j + 1;
+      } else {
+	i = end;
+	if (off + i - start < max_size) {
+	  continue;
+	}
+      }
+      chunks->emplace_back(start, off + i - start);
+      start = off + i;
+      hash = 0;
+    }
+    off += len;
+  }
+  if (start < off) {
+    chunks->emplace_back(start, off - start);
+  }
+}
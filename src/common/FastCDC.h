@@ -0,0 +1,33 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_COMMON_FASTCDC_H
+#define CEPH_COMMON_FASTCDC_H
+
+#include "CDC.h"
+
+/*
+ * FastCDC: content defined chunking with a gear hash, which takes a
+ * shift and an add per byte instead of the multiply and modulo of
+ * rabin. It doesn't hash the first min_size bytes of a chunk, cuts with
+ * a harder mask until avg_size and an easier one after it so that the
+ * sizes gather around the average, and forces a cut at max_size.
+ */
+class FastCDC : public CDC {
+  uint64_t min_size;
+  uint64_t avg_size;
+  uint64_t max_size;
+  uint64_t small_mask;  ///< used until avg_size
+  uint64_t large_mask;  ///< used after avg_size
+
+public:
+  /// chunks of 2^bits bytes on average, from 2^(bits-2) up to 2^(bits+2)
+  /// bytes; normalization is how far the masks stray from bits
+  explicit FastCDC(int bits, int normalization = 2);
+
+  void calc_chunks(
+    const ceph::bufferlist& bl,
+    std::vector<std::pair<uint64_t, uint64_t>> *chunks) const override;
+};
+
+#endif
@@ -45,13 +45,15 @@ void *Finisher::finisher_thread_entry()
 
   utime_t start;
   uint64_t count = 0;
+  // the queue and this batch trade places, so that both keep the memory
+  // they grew to instead of the queue starting from scratch each time
+  vector<pair<Context*,int>> ls;
   while (!finisher_stop) {
     /// Every time we are woken up, we process the queue until it is empty.
     while (!finisher_queue.empty()) {
       // To reduce lock contention, we swap out the queue to process.
       // This way other threads can submit new contexts to complete
       // while we are working.
-      vector<pair<Context*,int>> ls;
       ls.swap(finisher_queue);
       finisher_running = true;
       ul.unlock();
@@ -83,7 +85,9 @@ void *Finisher::finisher_thread_entry()
       break;
     
     ldout(cct, 10) << "finisher_thread sleeping" << dendl;
+    finisher_sleeping = true;
     finisher_cond.wait(ul);
+    finisher_sleeping = false;
   }
   // If we are exiting, we signal the thread waiting in stop(),
   // otherwise it would never unblock
@@ -44,6 +44,7 @@ class Finisher {
   bool         finisher_stop; ///< Set when the finisher should stop.
   bool         finisher_running; ///< True when the finisher is currently executing contexts.
   bool	       finisher_empty_wait; ///< True mean someone wait finisher empty.
+  bool         finisher_sleeping = false; ///< True while the worker waits for contexts.
 
   /// Queue for contexts for which complete(0) will be called.
   std::vector<std::pair<Context*,int>> finisher_queue;
@@ -66,7 +67,7 @@ class Finisher {
   /// Add a context to complete, optionally specifying a parameter for the complete function.
   void queue(Context *c, int r = 0) {
     std::unique_lock ul(finisher_lock);
-    if (finisher_queue.empty()) {
+    if (finisher_sleeping) {
       finisher_cond.notify_all();
     }
     finisher_queue.push_back(std::make_pair(c, r));
@@ -77,7 +78,7 @@ class Finisher {
   void queue(std::list<Context*>& ls) {
     {
       std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
+      if (finisher_sleeping) {
 	finisher_cond.notify_all();
       }
       for (auto i : ls) {
@@ -91,7 +92,7 @@ class Finisher {
   void queue(std::deque<Context*>& ls) {
     {
       std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
+      if (finisher_sleeping) {
 	finisher_cond.notify_all();
       }
       for (auto i : ls) {
@@ -105,7 +106,7 @@ class Finisher {
   void queue(std::vector<Context*>& ls) {
     {
       std::unique_lock ul(finisher_lock);
-      if (finisher_queue.empty()) {
+      if (finisher_sleeping) {
 	finisher_cond.notify_all();
       }
       for (auto i : ls) {
@@ -0,0 +1,15 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "FixedCDC.h"
+
+void FixedCDC::calc_chunks(
+  const ceph::bufferlist& bl,
+  std::vector<std::pair<uint64_t, uint64_t>> *chunks) const
+{
+  const uint64_t len = bl.length();
+  chunks->reserve(chunks->size() + (len + chunk_size - 1) / chunk_size);
+  for (uint64_t off = 0; off < len; off += chunk_size) {
+    chunks->emplace_back(off, std::min(chunk_size, len - off));
+  }
+}
@@ -0,0 +1,21 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_COMMON_FIXEDCDC_H
+#define CEPH_COMMON_FIXEDCDC_H
+
+#include "CDC.h"
+
+/// chunks of a fixed size, the last one may be shorter
+class FixedCDC : public CDC {
+  uint64_t chunk_size;
+
+public:
+  explicit FixedCDC(int bits) : chunk_size(1ull << bits) {}
+
+  void calc_chunks(
+    const ceph::bufferlist& bl,
+    std::vector<std::pair<uint64_t, uint64_t>> *chunks) const override;
+};
+
+#endif
@@ -386,6 +386,7 @@ void OutputDataSocket::append_output(bufferlist& bl)
 
   if (data_size + bl.length() > data_max_backlog) {
     ldout(m_cct, 20) << "dropping data output, max backlog reached" << dendl;
+    return;
   }
   data.push_back(bl);
 
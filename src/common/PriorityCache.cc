@@ -12,6 +12,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "PriorityCache.h"
 #include "common/dout.h"
 #include "perfglue/heap_profiler.h"
@@ -221,14 +223,31 @@ namespace PriorityCache
               "total bytes committed,", "c",
               PerfCountersBuilder::PRIO_CRITICAL, unit_t(UNIT_BYTES));
 
+    b.add_u64(cur_index + Extra::E_GHOST_HITS, "ghost_hits",
+              "misses since the last balance that a larger cache would have hit",
+              "g", PerfCountersBuilder::PRIO_USEFUL);
+
+    b.add_time(cur_index + Extra::E_MISS_LATENCY, "miss_latency",
+               "time spent serving a miss", "l",
+               PerfCountersBuilder::PRIO_USEFUL);
+
+    b.add_u64(cur_index + Extra::E_MISS_WEIGHT, "miss_weight",
+              "percentage the cache's ratio is scaled by for its miss cost",
+              "w", PerfCountersBuilder::PRIO_USEFUL);
+
     for (int i = 0; i < Extra::E_LAST+1; i++) {
       indexes[name][i] = cur_index + i;
     }
 
     auto l = b.create_perf_counters();
+    l->set(cur_index + Extra::E_MISS_WEIGHT, 100);
     loggers.emplace(name, l);
     cct->get_perfcounters_collection()->add(l);
 
+    miss_weight_t w;
+    c->get_miss_stats(&w.last);
+    miss_weights.emplace(name, w);
+
     cur_index = end;
   }
 
@@ -242,6 +261,7 @@ namespace PriorityCache
     }
     indexes.erase(name);
     caches.erase(name);
+    miss_weights.erase(name);
   }
 
   void Manager::clear()
@@ -254,10 +274,102 @@ namespace PriorityCache
     }
     indexes.clear();
     caches.clear();
+    miss_weights.clear();
+  }
+
+  double Manager::get_ratio(const std::string& name, const PriCache& c) const
+  {
+    auto p = miss_weights.find(name);
+    if (p == miss_weights.end()) {
+      return c.get_cache_ratio();
+    }
+    return c.get_cache_ratio() * p->second.weight;
+  }
+
+  double Manager::get_miss_weight(const std::string& name) const
+  {
+    auto p = miss_weights.find(name);
+    if (p == miss_weights.end()) {
+      return 1.0;
+    }
+    return p->second.weight;
+  }
+
+  void Manager::update_miss_weights()
+  {
+    if (max_miss_weight <= 1.0) {
+      // The caches don't keep their stats then, so don't ask for them.
+      for (auto& i : miss_weights) {
+        i.second.weight = 1.0;
+        auto l = loggers.find(i.first);
+        if (l != loggers.end()) {
+          l->second->set(indexes[i.first][Extra::E_MISS_WEIGHT], 100);
+        }
+      }
+      return;
+    }
+
+    // A cache's marginal utility is the time its ghost hits would have saved
+    // per byte of the ghost: what growing it by that much is worth.
+    std::unordered_map<std::string, double> utility;
+    double total_utility = 0;
+    for (auto& i : caches) {
+      auto& w = miss_weights[i.first];
+      MissStats cur;
+      if (!i.second->get_miss_stats(&cur)) {
+        continue;
+      }
+      uint64_t ghost_hits = cur.ghost_hits - w.last.ghost_hits;
+      uint64_t misses = cur.misses - w.last.misses;
+      if (misses > 0) {
+        w.latency = (cur.miss_time - w.last.miss_time) / misses;
+      }
+      w.last = cur;
+
+      double u = 0;
+      if (cur.ghost_bytes > 0) {
+        u = ghost_hits * w.latency / cur.ghost_bytes;
+      }
+      utility[i.first] = u;
+      total_utility += u;
+
+      utime_t latency;
+      latency.set_from_double(w.latency);
+      auto l = loggers.find(i.first);
+      l->second->set(indexes[i.first][Extra::E_GHOST_HITS], ghost_hits);
+      l->second->tset(indexes[i.first][Extra::E_MISS_LATENCY], latency);
+    }
+
+    for (auto& i : caches) {
+      auto& w = miss_weights[i.first];
+      auto u = utility.find(i.first);
+      if (u == utility.end()) {
+        w.weight = 1.0;
+      } else if (total_utility > 0) {
+        // Weigh against the mean, and move halfway there each balance so
+        // that one noisy interval doesn't swing the caches around.
+        double target = u->second * utility.size() / total_utility;
+        target = std::min(target, max_miss_weight);
+        target = std::max(target, 1.0 / max_miss_weight);
+        w.weight = (w.weight + target) / 2;
+      }
+      ldout(cct, 5) << __func__ << " " << i.first
+                    << " latency: " << w.latency
+                    << " ghost_bytes: " << w.last.ghost_bytes
+                    << " utility: "
+                    << (u == utility.end() ? 0 : u->second)
+                    << " weight: " << w.weight << dendl;
+
+      auto l = loggers.find(i.first);
+      l->second->set(indexes[i.first][Extra::E_MISS_WEIGHT],
+                     static_cast<uint64_t>(w.weight * 100));
+    }
   }
 
   void Manager::balance()
   {
+    update_miss_weights();
+
     int64_t mem_avail = tuned_mem;
     // Each cache is going to get a little extra from get_chunk, so shrink the
     // available memory here to compensate.
@@ -310,7 +422,7 @@ namespace PriorityCache
     // First, zero this priority's bytes, sum the initial ratios.
     for (auto it = caches.begin(); it != caches.end(); it++) {
       it->second->set_cache_bytes(pri, 0);
-      cur_ratios += it->second->get_cache_ratio();
+      cur_ratios += get_ratio(it->first, *it->second);
     }
 
     // For other priorities, loop until caches are satisified or we run out of
@@ -326,7 +438,7 @@ namespace PriorityCache
         // them an equal shot at the remaining memory for this priority.
         double ratio = 1.0 / tmp_caches.size();
         if (cur_ratios > 0) {
-          ratio = it->second->get_cache_ratio() / cur_ratios;
+          ratio = get_ratio(it->first, *it->second) / cur_ratios;
         }
         int64_t fair_share = static_cast<int64_t>(*mem_avail * ratio);
 
@@ -334,7 +446,7 @@ namespace PriorityCache
                        << " pri: " << (int) pri
                        << " round: " << round
                        << " wanted: " << cache_wants
-                       << " ratio: " << it->second->get_cache_ratio()
+                       << " ratio: " << get_ratio(it->first, *it->second)
                        << " cur_ratios: " << cur_ratios
                        << " fair_share: " << fair_share
                        << " mem_avail: " << *mem_avail
@@ -344,7 +456,7 @@ namespace PriorityCache
           // If we want too much, take what we can get but stick around for more
           it->second->add_cache_bytes(pri, fair_share);
           total_assigned += fair_share;
-          new_ratios += it->second->get_cache_ratio();
+          new_ratios += get_ratio(it->first, *it->second);
           ++it;
         } else {
           // Otherwise assign only what we want
@@ -367,9 +479,20 @@ namespace PriorityCache
     // If this is the last priority, divide up any remaining memory based
     // solely on the ratios.
     if (pri == Priority::LAST) {
+      // The weights shift the shares; they don't change how much of the
+      // memory the ratios hand out in total.
+      double ratios = 0;
+      double weighted_ratios = 0;
+      for (auto it = caches.begin(); it != caches.end(); it++) {
+        ratios += it->second->get_cache_ratio();
+        weighted_ratios += get_ratio(it->first, *it->second);
+      }
       uint64_t total_assigned = 0;
       for (auto it = caches.begin(); it != caches.end(); it++) {
         double ratio = it->second->get_cache_ratio();
+        if (weighted_ratios > 0) {
+          ratio = get_ratio(it->first, *it->second) * ratios / weighted_ratios;
+        }
         int64_t fair_share = static_cast<int64_t>(*mem_avail * ratio);
         it->second->set_cache_bytes(Priority::LAST, fair_share);
         total_assigned += fair_share;
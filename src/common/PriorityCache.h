@@ -17,6 +17,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <deque>
 #include <vector>
 #include <memory>
 #include <unordered_map>
@@ -57,11 +58,83 @@ namespace PriorityCache {
   enum Extra {
     E_RESERVED = Priority::LAST+1,
     E_COMMITTED,
-    E_LAST = E_COMMITTED,
+    E_GHOST_HITS,
+    E_MISS_LATENCY,
+    E_MISS_WEIGHT,
+    E_LAST = E_MISS_WEIGHT,
   };
 
   int64_t get_chunk(uint64_t usage, uint64_t total_bytes);
 
+  // The caches' ghosts remember this much of what they evict, relative to
+  // their size.
+  const double GHOST_RATIO = 0.125;
+
+  /* Remembers the keys a cache evicted most recently, up to a budget of
+   * their bytes, to tell which of its misses that much more memory would
+   * have turned into hits.  It holds no data, and it isn't thread safe:
+   * the cache calls it under its own lock. */
+  class GhostCache {
+    struct entry_t {
+      uint64_t key;
+      uint64_t seq;
+      uint64_t bytes;
+    };
+    std::deque<entry_t> fifo;
+    std::unordered_map<uint64_t, uint64_t> seqs; ///< key -> its newest entry
+    uint64_t max_bytes = 0;
+    uint64_t bytes = 0;
+    uint64_t seq = 0;
+
+    void trim() {
+      while (bytes > max_bytes && !fifo.empty()) {
+        auto& e = fifo.front();
+        auto p = seqs.find(e.key);
+        if (p != seqs.end() && p->second == e.seq) {
+          seqs.erase(p);
+        }
+        bytes -= e.bytes;
+        fifo.pop_front();
+      }
+    }
+
+  public:
+    void set_max_bytes(uint64_t m) {
+      max_bytes = m;
+      trim();
+    }
+    // Get the bytes of the evictions remembered.
+    uint64_t get_bytes() const {
+      return bytes;
+    }
+    void insert(uint64_t key, uint64_t b) {
+      fifo.push_back(entry_t{key, ++seq, b});
+      seqs[key] = seq;
+      bytes += b;
+      trim();
+    }
+    // Forget the key on a miss; true if it was evicted recently.
+    bool erase(uint64_t key) {
+      return seqs.erase(key) > 0;
+    }
+  };
+
+  // What a cache's misses cost, for the manager to weigh the caches by.
+  struct MissStats {
+    uint64_t ghost_hits = 0;  ///< misses ghost_bytes more memory would have hit
+    uint64_t misses = 0;      ///< misses whose latency was measured
+    double miss_time = 0;     ///< seconds spent serving the measured misses
+    uint64_t ghost_bytes = 0; ///< current size of the ghost, not cumulative
+
+    MissStats& operator+=(const MissStats& o) {
+      ghost_hits += o.ghost_hits;
+      misses += o.misses;
+      miss_time += o.miss_time;
+      ghost_bytes += o.ghost_bytes;
+      return *this;
+    }
+  };
+
   struct PriCache {
     virtual ~PriCache();
 
@@ -100,6 +173,13 @@ namespace PriorityCache {
 
     // Get the name of this cache.
     virtual std::string get_cache_name() const = 0;
+
+    /* Get the cache's cumulative miss statistics.  Returns false if the
+     * cache doesn't keep them, in which case the manager uses its ratio as
+     * is. */
+    virtual bool get_miss_stats(MissStats *stats) const {
+      return false;
+    }
   };
 
   class Manager {
@@ -109,6 +189,15 @@ namespace PriorityCache {
     std::unordered_map<std::string, std::vector<int>> indexes;
     std::unordered_map<std::string, std::shared_ptr<PriCache>> caches;
 
+    // How much the caches' ratios are scaled by what their misses cost.
+    struct miss_weight_t {
+      MissStats last;       ///< stats at the previous balance
+      double latency = 0;   ///< seconds per miss, last measured
+      double weight = 1.0;
+    };
+    std::unordered_map<std::string, miss_weight_t> miss_weights;
+    double max_miss_weight = 1.0;
+
     // Start perf counter slots after the malloc stats.
     int cur_index = MallocStats::M_LAST;
 
@@ -132,14 +221,25 @@ namespace PriorityCache {
     uint64_t get_tuned_mem() const {
       return tuned_mem;
     }
+    /* Let the caches' ratios be scaled by up to this factor either way,
+     * towards the caches where more memory saves the most time on misses.
+     * 1 keeps the ratios as they are. */
+    void set_max_miss_weight(double w) {
+      max_miss_weight = (w > 1.0) ? w : 1.0;
+    }
     void insert(const std::string& name, const std::shared_ptr<PriCache> c);
     void erase(const std::string& name);
     void clear();
     void tune_memory();
     void balance();
+    // Rescale the caches' ratios by what their misses cost since last time.
+    void update_miss_weights();
+    // Get the factor the named cache's ratio is scaled by.
+    double get_miss_weight(const std::string& name) const;
 
   private:
     void balance_priority(int64_t *mem_avail, Priority pri);
+    double get_ratio(const std::string& name, const PriCache& c) const;
   };
 }
 
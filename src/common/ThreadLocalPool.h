@@ -0,0 +1,77 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.	See file COPYING.
+ *
+ */
+
+#ifndef COMMON_THREADLOCALPOOL_H
+#define COMMON_THREADLOCALPOOL_H
+
+#include <cstddef>
+#include <new>
+
+/* Deriving T from ThreadLocalPool<T> gives it a class operator new/delete
+ * that recycle up to MAX freed instances per thread instead of going back
+ * to the allocator.  Meant for objects created and destroyed for every
+ * request on the same (worker) thread; an object freed on another thread
+ * simply lands in that thread's cache.  Allocations that are not exactly
+ * sizeof(T), i.e. for classes derived from T, bypass the cache.
+ */
+template<typename T, std::size_t MAX = 64>
+class ThreadLocalPool {
+public:
+  static void *operator new(std::size_t size) {
+    if (size == sizeof(T) && !cache.destructed && cache.head) {
+      Node *n = cache.head;
+      cache.head = n->next;
+      --cache.count;
+      return n;
+    }
+    return ::operator new(size);
+  }
+  static void operator delete(void *p, std::size_t size) {
+    if (size == sizeof(T) && !cache.destructed && cache.count < MAX) {
+      Node *n = static_cast<Node*>(p);
+      n->next = cache.head;
+      cache.head = n;
+      ++cache.count;
+      return;
+    }
+    ::operator delete(p);
+  }
+
+private:
+  struct Node {
+    Node *next;
+  };
+
+  /* As with CachedStackStringStream, the thread_local cache may be
+   * destructed before objects that are freed late in thread (or process)
+   * teardown; those go straight back to the allocator.
+   */
+  struct Cache {
+    Cache() {}
+    ~Cache() {
+      destructed = true;
+      while (head) {
+	Node *n = head;
+	head = n->next;
+	::operator delete(n);
+      }
+    }
+
+    Node *head = nullptr;
+    std::size_t count = 0;
+    bool destructed = false;
+  };
+
+  inline static thread_local Cache cache;
+};
+
+#endif
@@ -85,6 +85,18 @@ void Throttle::_reset_max(int64_t m)
   max = m;
 }
 
+bool Throttle::_get_without_wait(int64_t c)
+{
+  int64_t cur = count;
+  do {
+    // always wait behind other waiters.
+    if (num_waiters || _should_wait(c, cur)) {
+      return false;
+    }
+  } while (!count.compare_exchange_weak(cur, cur + c));
+  return true;
+}
+
 bool Throttle::_wait(int64_t c, std::unique_lock<std::mutex>& l)
 {
   mono_time start;
@@ -92,8 +104,12 @@ bool Throttle::_wait(int64_t c, std::unique_lock<std::mutex>& l)
   if (_should_wait(c) || !conds.empty()) { // always wait behind other waiters.
     {
       auto cv = conds.emplace(conds.end());
+      // put() looks at num_waiters after changing count, so either it sees
+      // this waiter and wakes it up, or the predicate below sees its count
+      ++num_waiters;
       auto w = make_scope_guard([this, cv]() {
 	  conds.erase(cv);
+	  --num_waiters;
 	});
       waited = true;
       ldout(cct, 2) << "_wait waiting..." << dendl;
@@ -136,16 +152,13 @@ int64_t Throttle::take(int64_t c)
   }
   ceph_assert(c >= 0);
   ldout(cct, 10) << "take " << c << dendl;
-  {
-    std::lock_guard l(lock);
-    count += c;
-  }
+  int64_t cur = count += c;
   if (logger) {
     logger->inc(l_throttle_take);
     logger->inc(l_throttle_take_sum, c);
-    logger->set(l_throttle_val, count);
+    logger->set(l_throttle_val, cur);
   }
-  return count;
+  return cur;
 }
 
 bool Throttle::get(int64_t c, int64_t m)
@@ -160,14 +173,24 @@ bool Throttle::get(int64_t c, int64_t m)
     logger->inc(l_throttle_get_started);
   }
   bool waited = false;
-  {
+  if ((m && m != max) || !_get_without_wait(c)) {
     std::unique_lock l(lock);
     if (m) {
       ceph_assert(m > 0);
       _reset_max(m);
     }
-    waited = _wait(c, l);
-    count += c;
+    // keep the lockless gets behind this one until it's done
+    ++num_waiters;
+    for (;;) {
+      waited |= _wait(c, l);
+      int64_t cur = count;
+      if (!_should_wait(c, cur) &&
+	  count.compare_exchange_strong(cur, cur + c)) {
+	break;
+      }
+      // a lockless get took the slots in between
+    }
+    --num_waiters;
   }
   if (logger) {
     logger->inc(l_throttle_get);
@@ -187,17 +210,15 @@ bool Throttle::get_or_fail(int64_t c)
   }
 
   assert (c >= 0);
-  std::lock_guard l(lock);
-  if (_should_wait(c) || !conds.empty()) {
+  if (!_get_without_wait(c)) {
     ldout(cct, 10) << "get_or_fail " << c << " failed" << dendl;
     if (logger) {
       logger->inc(l_throttle_get_or_fail_fail);
     }
     return false;
   } else {
-    ldout(cct, 10) << "get_or_fail " << c << " success (" << count.load()
-		   << " -> " << (count.load() + c) << ")" << dendl;
-    count += c;
+    ldout(cct, 10) << "get_or_fail " << c << " success (now "
+		   << count.load() << ")" << dendl;
     if (logger) {
       logger->inc(l_throttle_get_or_fail_success);
       logger->inc(l_throttle_get);
@@ -217,20 +238,23 @@ int64_t Throttle::put(int64_t c)
   ceph_assert(c >= 0);
   ldout(cct, 10) << "put " << c << " (" << count.load() << " -> "
 		 << (count.load()-c) << ")" << dendl;
-  std::lock_guard l(lock);
-  if (c) {
+  if (!c) {
+    return count;
+  }
+  int64_t cur = count -= c;
+  // if count goes negative, we failed somewhere!
+  ceph_assert(cur >= 0);
+  if (num_waiters) {
+    std::lock_guard l(lock);
     if (!conds.empty())
       conds.front().notify_one();
-    // if count goes negative, we failed somewhere!
-    ceph_assert(count >= c);
-    count -= c;
-    if (logger) {
-      logger->inc(l_throttle_put);
-      logger->inc(l_throttle_put_sum, c);
-      logger->set(l_throttle_val, count);
-    }
   }
-  return count;
+  if (logger) {
+    logger->inc(l_throttle_put);
+    logger->inc(l_throttle_put_sum, c);
+    logger->set(l_throttle_val, cur);
+  }
+  return cur;
 }
 
 void Throttle::reset()
@@ -24,6 +24,10 @@
  * This class defines the maximum number of slots currently taken away. The
  * excessive requests for more of them are delayed, until some slots are put
  * back, so @p get_current() drops below the limit after fulfills the requests.
+ *
+ * As long as nobody waits, slots are got and put back with atomic operations
+ * on @p count alone; the lock is only taken to wait, to wake up waiters, and
+ * to change the max.
  */
 class Throttle final : public ThrottleInterface {
   CephContext *cct;
@@ -32,6 +36,7 @@ class Throttle final : public ThrottleInterface {
   std::atomic<int64_t> count = { 0 }, max = { 0 };
   std::mutex lock;
   std::list<std::condition_variable> conds;
+  std::atomic<size_t> num_waiters = { 0 };  ///< conds.size(), for the lockless paths
   const bool use_perf;
 
 public:
@@ -40,16 +45,20 @@ public:
 
 private:
   void _reset_max(int64_t m);
-  bool _should_wait(int64_t c) const {
+  bool _should_wait(int64_t c, int64_t cur) const {
     int64_t m = max;
-    int64_t cur = count;
     return
       m &&
       ((c <= m && cur + c > m) || // normally stay under max
        (c >= m && cur > m));     // except for large c
   }
+  bool _should_wait(int64_t c) const {
+    return _should_wait(c, count);
+  }
 
   bool _wait(int64_t c, std::unique_lock<std::mutex>& l);
+  /// take c slots without the lock, if that needs no wait
+  bool _get_without_wait(int64_t c);
 
 public:
   /**
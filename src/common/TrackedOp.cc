@@ -67,6 +67,7 @@ void OpHistory::on_shutdown()
   arrived.clear();
   duration.clear();
   slow_op.clear();
+  sampled.clear();
   shutdown = true;
 }
 
@@ -80,6 +81,10 @@ void OpHistory::_insert_delayed(const utime_t& now, TrackedOpRef op)
   arrived.insert(make_pair(op->get_initiated(), op));
   if (opduration >= history_slow_op_threshold)
     slow_op.insert(make_pair(op->get_initiated(), op));
+  if (history_sample_rate &&
+      op->get_sample_key() % history_sample_rate == 0) {
+    sampled.push_back(op);
+  }
   cleanup(now);
 }
 
@@ -106,6 +111,10 @@ void OpHistory::cleanup(utime_t now)
 	slow_op.begin()->second->get_initiated(),
 	slow_op.begin()->second));
   }
+
+  while (sampled.size() > history_sample_size) {
+    sampled.pop_front();
+  }
 }
 
 void OpHistory::dump_ops(utime_t now, Formatter *f, set<string> filters, bool by_duration)
@@ -201,6 +210,38 @@ void OpHistory::dump_slow_ops(utime_t now, Formatter *f, set<string> filters)
   f->close_section();
 }
 
+void OpHistory::dump_trace(Formatter *f, int pid, std::string_view name)
+{
+  std::lock_guard history_lock(ops_history_lock);
+  f->open_object_section("trace");
+  f->open_array_section("traceEvents");
+  f->open_object_section("event");
+  f->dump_string("name", "process_name");
+  f->dump_string("ph", "M");
+  f->dump_int("pid", pid);
+  f->open_object_section("args");
+  f->dump_string("name", name);
+  f->close_section();
+  f->close_section();
+  for (auto& op : sampled) {
+    op->dump_trace(f, pid);
+  }
+  f->close_section();
+  f->dump_string("displayTimeUnit", "ms");
+  f->close_section();
+}
+
+bool OpTracker::dump_historic_ops_trace(Formatter *f, int pid,
+					std::string_view name)
+{
+  if (!tracking_enabled)
+    return false;
+
+  RWLock::RLocker l(lock);
+  history.dump_trace(f, pid, name);
+  return true;
+}
+
 bool OpTracker::dump_historic_slow_ops(Formatter *f, set<string> filters)
 {
   if (!tracking_enabled)
@@ -438,16 +479,27 @@ void TrackedOp::mark_event(std::string_view event, utime_t stamp)
 {
   if (!state)
     return;
+  _mark_event(Event(stamp, event));
+}
 
-  {
-    std::lock_guard l(lock);
-    events.emplace_back(stamp, event);
-  }
+void TrackedOp::mark_event(const char *event, utime_t stamp)
+{
+  if (!state)
+    return;
+  _mark_event(Event(stamp, event));
+}
+
+void TrackedOp::_mark_event(Event&& ev)
+{
   dout(6) << " seq: " << seq
-	  << ", time: " << stamp
-	  << ", event: " << event
+	  << ", time: " << ev.stamp
+	  << ", event: " << ev.get_name()
 	  << ", op: " << get_desc()
 	  << dendl;
+  {
+    std::lock_guard l(lock);
+    events.emplace_back(std::move(ev));
+  }
   _event_marked();
 }
 
@@ -466,3 +518,42 @@ void TrackedOp::dump(utime_t now, Formatter *f) const
     f->close_section();
   }
 }
+
+void TrackedOp::dump_trace(Formatter *f, int pid) const
+{
+  // Ignore if still in the constructor
+  if (!state)
+    return;
+  // the trace is in microseconds
+  auto us = [](utime_t from, utime_t to) -> uint64_t {
+    return to > from ? (to - from).to_nsec() / 1000 : 0;
+  };
+  const char *d = get_desc();
+  std::lock_guard l(lock);
+  if (events.empty())
+    return;
+  f->open_object_section("event");
+  f->dump_string("name", d);
+  f->dump_string("cat", "op");
+  f->dump_string("ph", "X");
+  f->dump_unsigned("ts", initiated_at.to_nsec() / 1000);
+  f->dump_unsigned("dur", us(initiated_at, events.back().stamp));
+  f->dump_int("pid", pid);
+  f->dump_unsigned("tid", seq);
+  f->close_section();
+  // each stage is named for the event that started it
+  for (size_t i = 0; i + 1 < events.size(); ++i) {
+    f->open_object_section("event");
+    f->dump_string("name", events[i].get_name());
+    f->dump_string("cat", "stage");
+    f->dump_string("ph", "X");
+    f->dump_unsigned("ts", events[i].stamp.to_nsec() / 1000);
+    f->dump_unsigned("dur", us(events[i].stamp, events[i + 1].stamp));
+    f->dump_int("pid", pid);
+    f->dump_unsigned("tid", seq);
+    f->open_object_section("args");
+    f->dump_string("until", events[i + 1].get_name());
+    f->close_section();
+    f->close_section();
+  }
+}
@@ -15,6 +15,7 @@
 #define TRACKEDREQUEST_H_
 
 #include <atomic>
+#include <deque>
 #include "common/histogram.h"
 #include "common/RWLock.h"
 #include "common/Thread.h"
@@ -57,12 +58,15 @@ class OpHistory {
   std::set<std::pair<utime_t, TrackedOpRef> > arrived;
   std::set<std::pair<double, TrackedOpRef> > duration;
   std::set<std::pair<utime_t, TrackedOpRef> > slow_op;
+  std::deque<TrackedOpRef> sampled; ///< 1 in history_sample_rate ops, oldest first
   ceph::mutex ops_history_lock = ceph::make_mutex("OpHistory::ops_history_lock");
   void cleanup(utime_t now);
   uint32_t history_size;
   uint32_t history_duration;
   uint32_t history_slow_op_size;
   uint32_t history_slow_op_threshold;
+  uint32_t history_sample_rate;
+  uint32_t history_sample_size;
   std::atomic_bool shutdown;
   OpHistoryServiceThread opsvc;
   friend class OpHistoryServiceThread;
@@ -71,6 +75,7 @@ public:
   OpHistory()
     : history_size(0), history_duration(0),
       history_slow_op_size(0), history_slow_op_threshold(0),
+      history_sample_rate(0), history_sample_size(0),
       shutdown(false), opsvc(this) {
     opsvc.create("OpHistorySvc");
   }
@@ -78,6 +83,7 @@ public:
     ceph_assert(arrived.empty());
     ceph_assert(duration.empty());
     ceph_assert(slow_op.empty());
+    ceph_assert(sampled.empty());
   }
   void insert(const utime_t& now, TrackedOpRef op)
   {
@@ -90,6 +96,7 @@ public:
   void _insert_delayed(const utime_t& now, TrackedOpRef op);
   void dump_ops(utime_t now, ceph::Formatter *f, std::set<std::string> filters = {""}, bool by_duration=false);
   void dump_slow_ops(utime_t now, ceph::Formatter *f, std::set<std::string> filters = {""});
+  void dump_trace(ceph::Formatter *f, int pid, std::string_view name);
   void on_shutdown();
   void set_size_and_duration(uint32_t new_size, uint32_t new_duration) {
     history_size = new_size;
@@ -99,6 +106,10 @@ public:
     history_slow_op_size = new_size;
     history_slow_op_threshold = new_threshold;
   }
+  void set_sample_rate_and_size(uint32_t new_rate, uint32_t new_size) {
+    history_sample_rate = new_rate;
+    history_sample_size = new_size;
+  }
 };
 
 struct ShardedTrackingData;
@@ -127,6 +138,9 @@ public:
   void set_history_slow_op_size_and_threshold(uint32_t new_size, uint32_t new_threshold) {
     history.set_slow_op_size_and_threshold(new_size, new_threshold);
   }
+  void set_history_sample_rate_and_size(uint32_t new_rate, uint32_t new_size) {
+    history.set_sample_rate_and_size(new_rate, new_size);
+  }
   bool is_tracking() const {
     return tracking_enabled;
   }
@@ -136,6 +150,8 @@ public:
   bool dump_ops_in_flight(ceph::Formatter *f, bool print_only_blocked = false, std::set<std::string> filters = {""});
   bool dump_historic_ops(ceph::Formatter *f, bool by_duration = false, std::set<std::string> filters = {""});
   bool dump_historic_slow_ops(ceph::Formatter *f, std::set<std::string> filters = {""});
+  /// the sampled ops, in Chrome's trace event format
+  bool dump_historic_ops_trace(ceph::Formatter *f, int pid, std::string_view name);
   bool register_inflight_op(TrackedOp *i);
   void unregister_inflight_op(TrackedOp *i);
   void record_history_op(TrackedOpRef&& i);
@@ -234,21 +250,27 @@ protected:
 
   struct Event {
     utime_t stamp;
-    std::string str;
+    const char *name = nullptr; ///< a string literal, not copied
+    std::string str;            ///< otherwise a copy of the name
 
+    Event(utime_t t, const char *s) : stamp(t), name(s) {}
     Event(utime_t t, std::string_view s) : stamp(t), str(s) {}
 
+    std::string_view get_name() const {
+      return name ? std::string_view(name) : std::string_view(str);
+    }
+
     int compare(const char *s) const {
-      return str.compare(s);
+      return get_name().compare(s);
     }
 
     const char *c_str() const {
-      return str.c_str();
+      return name ? name : str.c_str();
     }
 
     void dump(ceph::Formatter *f) const {
       f->dump_stream("time") << stamp;
-      f->dump_string("event", str);
+      f->dump_string("event", get_name());
     }
   };
 
@@ -280,6 +302,7 @@ protected:
   virtual void _dump(ceph::Formatter *f) const {}
   /// if you want something else to happen when events are marked, implement
   virtual void _event_marked() {}
+  void _mark_event(Event&& ev);
   /// return a unique descriptor of the Op; eg the message it's attached to
   virtual void _dump_op_descriptor_unlocked(std::ostream& stream) const = 0;
   /// called when the last non-OpTracker reference is dropped
@@ -287,6 +310,10 @@ protected:
 
   virtual bool filter_out(const std::set<std::string>& filters) { return true; }
 
+  /// ops are sampled for tracing by this; ops with the same key are
+  /// sampled together
+  virtual uint64_t get_sample_key() const { return seq; }
+
 public:
   ZTracer::Trace osd_trace;
   ZTracer::Trace pg_trace;
@@ -366,6 +393,9 @@ public:
   }
 
   void mark_event(std::string_view event, utime_t stamp=ceph_clock_now());
+  /// for event names that outlive the op, such as string literals,
+  /// which are only kept by pointer
+  void mark_event(const char *event, utime_t stamp=ceph_clock_now());
 
   void mark_nowarn() {
     warn_interval_multiplier = 0;
@@ -373,10 +403,12 @@ public:
 
   virtual std::string_view state_string() const {
     std::lock_guard l(lock);
-    return events.empty() ? std::string_view() : std::string_view(events.rbegin()->str);
+    return events.empty() ? std::string_view() : events.rbegin()->get_name();
   }
 
   void dump(utime_t now, ceph::Formatter *f) const;
+  /// one trace event for the op, and one for each stage between events
+  void dump_trace(ceph::Formatter *f, int pid) const;
 
   void tracking_start() {
     if (tracker->register_inflight_op(this)) {
@@ -21,6 +21,9 @@
 #include <boost/intrusive/rbtree.hpp>
 #include <boost/intrusive/avl_set.hpp>
 
+#include <random>
+#include <vector>
+
 #include "include/ceph_assert.h"
 
 namespace bi = boost::intrusive;
@@ -39,12 +42,58 @@ class MapKey
   }
 };
 
-template <typename T>
-class DelItem
+// Keeps the memory of the nodes that were disposed of for the next ones,
+// so that queueing an item doesn't go to the allocator once the queue
+// has been as deep before.
+template <typename N>
+class NodeCache
 {
+  static constexpr size_t max_free = 1024;
+  std::vector<void*> free;
   public:
-  void operator()(T* delete_this)
-    { delete delete_this; }
+  class Disposer
+  {
+    NodeCache *cache;
+    public:
+    explicit Disposer(NodeCache *c) : cache(c) {}
+    void operator()(N* n) const
+      { cache->destroy(n); }
+  };
+  NodeCache() = default;
+  NodeCache(const NodeCache&) = delete;
+  NodeCache& operator=(const NodeCache&) = delete;
+  ~NodeCache() {
+    for (auto p : free) {
+      ::operator delete(p);
+    }
+  }
+  template <typename... Args>
+  N* create(Args&&... args) {
+    void *p;
+    if (free.empty()) {
+      p = ::operator new(sizeof(N));
+    } else {
+      p = free.back();
+      free.pop_back();
+    }
+    try {
+      return new (p) N(std::forward<Args>(args)...);
+    } catch (...) {
+      free.push_back(p);
+      throw;
+    }
+  }
+  void destroy(N* n) {
+    n->~N();
+    if (free.size() < max_free) {
+      free.push_back(n);
+    } else {
+      ::operator delete(n);
+    }
+  }
+  Disposer disposer() {
+    return Disposer(this);
+  }
 };
 
 template <typename T, typename K>
@@ -65,14 +114,16 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
     {
       typedef bi::list<ListPair> ListPairs;
       typedef typename ListPairs::iterator Lit;
+      NodeCache<ListPair> *lp_cache;
       public:
         K key;		// klass
         ListPairs lp;
-        Klass(K& k) :
+        Klass(K& k, NodeCache<ListPair> *lpc) :
+          lp_cache(lpc),
           key(k) {
         }
         ~Klass() {
-          lp.clear_and_dispose(DelItem<ListPair>());
+          lp.clear_and_dispose(lp_cache->disposer());
         }
       friend bool operator< (const Klass &a, const Klass &b)
         { return a.key < b.key; }
@@ -82,9 +133,9 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
         { return a.key == b.key; }
       void insert(unsigned cost, T&& item, bool front) {
         if (front) {
-          lp.push_front(*new ListPair(cost, std::move(item)));
+          lp.push_front(*lp_cache->create(cost, std::move(item)));
         } else {
-          lp.push_back(*new ListPair(cost, std::move(item)));
+          lp.push_back(*lp_cache->create(cost, std::move(item)));
         }
       }
       //Get the cost of the next item to dequeue
@@ -95,7 +146,7 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
       T pop() {
 	ceph_assert(!lp.empty());
 	T ret = std::move(lp.begin()->item);
-        lp.erase_and_dispose(lp.begin(), DelItem<ListPair>());
+        lp.erase_and_dispose(lp.begin(), lp_cache->disposer());
         return ret;
       }
       bool empty() const {
@@ -109,7 +160,7 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
           if (out) {
             out->push_front(std::move(i->item));
           }
-          i = lp.erase_and_dispose(i, DelItem<ListPair>());
+          i = lp.erase_and_dispose(i, lp_cache->disposer());
           if (i == lp.begin()) {
             break;
           }
@@ -125,16 +176,20 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
           next = klasses.begin();
         }
       }
+      NodeCache<Klass> *klass_cache;
+      NodeCache<ListPair> *lp_cache;
       public:
 	unsigned key;	// priority
         Klasses klasses;
 	Kit next;
-	SubQueue(unsigned& p) :
+	SubQueue(unsigned& p, NodeCache<Klass> *kc, NodeCache<ListPair> *lpc) :
+	  klass_cache(kc),
+	  lp_cache(lpc),
 	  key(p),
 	  next(klasses.begin()) {
 	}
 	~SubQueue() {
-	  klasses.clear_and_dispose(DelItem<Klass>());
+	  klasses.clear_and_dispose(klass_cache->disposer());
 	}
       friend bool operator< (const SubQueue &a, const SubQueue &b)
         { return a.key < b.key; }
@@ -150,7 +205,8 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
       	std::pair<Kit, bool> ret =
           klasses.insert_unique_check(cl, MapKey<Klass, K>(), insert_data);
       	if (ret.second) {
-      	  ret.first = klasses.insert_unique_commit(*new Klass(cl), insert_data);
+      	  ret.first = klasses.insert_unique_commit(
+	    *klass_cache->create(cl, lp_cache), insert_data);
           check_end();
 	}
 	ret.first->insert(cost, std::move(item), front);
@@ -162,7 +218,7 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
       T pop() {
         T ret = next->pop();
         if (next->empty()) {
-          next = klasses.erase_and_dispose(next, DelItem<Klass>());
+          next = klasses.erase_and_dispose(next, klass_cache->disposer());
         } else {
 	  ++next;
 	}
@@ -173,7 +229,7 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
         Kit i = klasses.find(cl, MapKey<Klass, K>());
         if (i != klasses.end()) {
           i->filter_class(out);
-	  Kit tmp = klasses.erase_and_dispose(i, DelItem<Klass>());
+	  Kit tmp = klasses.erase_and_dispose(i, klass_cache->disposer());
 	  if (next == i) {
             next = tmp;
           }
@@ -198,16 +254,23 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
     class Queue {
       typedef bi::rbtree<SubQueue> SubQueues;
       typedef typename SubQueues::iterator Sit;
+      // declared before the queues, which dispose into them
+      NodeCache<ListPair> lp_cache;
+      NodeCache<Klass> klass_cache;
+      NodeCache<SubQueue> sq_cache;
       SubQueues queues;
       unsigned total_prio;
       unsigned max_cost;
+      // a generator of our own rather than rand(), which takes a lock
+      std::minstd_rand rng;
       public:
 	Queue() :
 	  total_prio(0),
-	  max_cost(0) {
+	  max_cost(0),
+	  rng(std::random_device{}()) {
 	}
 	~Queue() {
-	  queues.clear_and_dispose(DelItem<SubQueue>());
+	  queues.clear_and_dispose(sq_cache.disposer());
 	}
 	bool empty() const {
 	  return queues.empty();
@@ -217,7 +280,8 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
       	  std::pair<typename SubQueues::iterator, bool> ret =
       	    queues.insert_unique_check(p, MapKey<SubQueue, unsigned>(), insert_data);
       	  if (ret.second) {
-      	    ret.first = queues.insert_unique_commit(*new SubQueue(p), insert_data);
+      	    ret.first = queues.insert_unique_commit(
+	      *sq_cache.create(p, &klass_cache, &lp_cache), insert_data);
 	    total_prio += p;
       	  }
 	  ret.first->insert(cl, cost, std::move(item), front);
@@ -230,14 +294,14 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
 	  if (strict) {
 	    T ret = i->pop();
 	    if (i->empty()) {
-	      queues.erase_and_dispose(i, DelItem<SubQueue>());
+	      queues.erase_and_dispose(i, sq_cache.disposer());
 	    }
 	    return ret;
 	  }
 	  if (queues.size() > 1) {
 	    while (true) {
 	      // Pick a new priority out of the total priority.
-	      unsigned prio = rand() % total_prio + 1;
+	      unsigned prio = rng() % total_prio + 1;
 	      unsigned tp = total_prio - i->key;
 	      // Find the priority corresponding to the picked number.
 	      // Subtract high priorities to low priorities until the picked number
@@ -252,7 +316,7 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
 	      // The next op's cost is multiplied by .9 and subtracted from the
 	      // max cost seen. Ops with lower costs will have a larger value
 	      // and allow them to be selected easier than ops with high costs.
-	      if (max_cost == 0 || rand() % max_cost <=
+	      if (max_cost == 0 || rng() % max_cost <=
 		  (max_cost - ((i->get_cost() * 9) / 10))) {
 		break;
 	      }
@@ -262,7 +326,7 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
 	  T ret = i->pop();
 	  if (i->empty()) {
 	    total_prio -= i->key;
-	    queues.erase_and_dispose(i, DelItem<SubQueue>());
+	    queues.erase_and_dispose(i, sq_cache.disposer());
 	  }
 	  return ret;
 	}
@@ -271,7 +335,7 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
 	    i->filter_class(cl, out);
 	    if (i->empty()) {
 	      total_prio -= i->key;
-	      i = queues.erase_and_dispose(i, DelItem<SubQueue>());
+	      i = queues.erase_and_dispose(i, sq_cache.disposer());
 	    } else {
 	      ++i;
 	    }
@@ -304,9 +368,7 @@ class WeightedPriorityQueue :  public OpQueue <T, K>
     WeightedPriorityQueue(unsigned max_per, unsigned min_c) :
       strict(),
       normal()
-      {
-	std::srand(time(0));
-      }
+      {}
     void remove_by_class(K cl, std::list<T>* removed = 0) final {
       strict.filter_class(cl, removed);
       normal.filter_class(cl, removed);
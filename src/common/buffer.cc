@@ -1988,34 +1988,45 @@ __u32 buffer::list::crc32c(__u32 crc) const
   int cache_hits = 0;
   int cache_adjusts = 0;
 
-  for (const auto& node : _buffers) {
-    if (node.length()) {
-      raw* const r = node.get_raw();
-      pair<size_t, size_t> ofs(node.offset(), node.offset() + node.length());
-      pair<uint32_t, uint32_t> ccrc;
-      if (r->get_crc(ofs, &ccrc)) {
-	if (ccrc.first == crc) {
-	  // got it already
-	  crc = ccrc.second;
-	  cache_hits++;
-	} else {
-	  /* If we have cached crc32c(buf, v) for initial value v,
-	   * we can convert this to a different initial value v' by:
-	   * crc32c(buf, v') = crc32c(buf, v) ^ adjustment
-	   * where adjustment = crc32c(0*len(buf), v ^ v')
-	   *
-	   * http://crcutil.googlecode.com/files/crc-doc.1.0.pdf
-	   * note, u for our crc32c implementation is 0
-	   */
-	  crc = ccrc.second ^ ceph_crc32c(ccrc.first ^ crc, NULL, node.length());
-	  cache_adjusts++;
-	}
+  for (auto it = _buffers.begin(); it != _buffers.end(); ) {
+    if (!it->length()) {
+      ++it;
+      continue;
+    }
+    raw* const r = it->get_raw();
+    const char* const data = it->c_str();
+    pair<size_t, size_t> ofs(it->offset(), it->offset() + it->length());
+    // a run of ptrs that follow each other in the same raw, as appends
+    // leave behind once a buffer was appended by reference, is hashed
+    // (and its crc cached) as one range
+    for (++it; it != _buffers.end() && it->get_raw() == r &&
+	   it->offset() == ofs.second; ++it) {
+      ofs.second += it->length();
+    }
+    const unsigned len = ofs.second - ofs.first;
+    pair<uint32_t, uint32_t> ccrc;
+    if (r->get_crc(ofs, &ccrc)) {
+      if (ccrc.first == crc) {
+	// got it already
+	crc = ccrc.second;
+	cache_hits++;
       } else {
-	cache_misses++;
-	uint32_t base = crc;
-	crc = ceph_crc32c(crc, (unsigned char*)node.c_str(), node.length());
-	r->set_crc(ofs, make_pair(base, crc));
+	/* If we have cached crc32c(buf, v) for initial value v,
+	 * we can convert this to a different initial value v' by:
+	 * crc32c(buf, v') = crc32c(buf, v) ^ adjustment
+	 * where adjustment = crc32c(0*len(buf), v ^ v')
+	 *
+	 * http://crcutil.googlecode.com/files/crc-doc.1.0.pdf
+	 * note, u for our crc32c implementation is 0
+	 */
+	crc = ccrc.second ^ ceph_crc32c(ccrc.first ^ crc, NULL, len);
+	cache_adjusts++;
       }
+    } else {
+      cache_misses++;
+      uint32_t base = crc;
+      crc = ceph_crc32c(crc, (unsigned char*)data, len);
+      r->set_crc(ofs, make_pair(base, crc));
     }
   }
 
@@ -2170,6 +2181,61 @@ buffer::list buffer::list::static_from_string(string& s) {
   // const makes me generally sad.
 }
 
+namespace {
+// freed nodes, linked through their first word.  This is trivially
+// destructible so that nodes freed late in thread exit, after
+// ptr_node_cache_drain has run, are still safe to handle.
+struct ptr_node_cache_t {
+  static constexpr unsigned MAX = 128;
+  void *head = nullptr;
+  unsigned count = 0;
+  bool dead = false;
+};
+thread_local ptr_node_cache_t ptr_node_cache;
+
+struct ptr_node_cache_drain_t {
+  ~ptr_node_cache_drain_t() {
+    auto& c = ptr_node_cache;
+    while (c.head) {
+      void *p = c.head;
+      c.head = *static_cast<void**>(p);
+      ::operator delete(p);
+    }
+    c.count = 0;
+    c.dead = true;
+  }
+};
+thread_local ptr_node_cache_drain_t ptr_node_cache_drain;
+}
+
+void* buffer::ptr_node::operator new(size_t size)
+{
+  static_assert(sizeof(ptr_node) >= sizeof(void*));
+  auto& c = ptr_node_cache;
+  if (c.head && size == sizeof(ptr_node)) {
+    void *p = c.head;
+    c.head = *static_cast<void**>(p);
+    --c.count;
+    return p;
+  }
+  // touch the drainer so it is constructed, and so destroyed at exit
+  (void)&ptr_node_cache_drain;
+  return ::operator new(size);
+}
+
+void buffer::ptr_node::operator delete(void* p)
+{
+  auto& c = ptr_node_cache;
+  if (c.count < ptr_node_cache_t::MAX && !c.dead) {
+    // a node freed by another thread than allocated it just moves over
+    *static_cast<void**>(p) = c.head;
+    c.head = p;
+    ++c.count;
+    return;
+  }
+  ::operator delete(p);
+}
+
 bool buffer::ptr_node::dispose_if_hypercombined(
   buffer::ptr_node* const delete_this)
 {
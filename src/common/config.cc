@@ -952,6 +952,10 @@ Option::value_t md_config_t::get_val_generic(
   const ConfigValues& values,
   const std::string_view key) const
 {
+  // the keys given by the code are already normalized, spare them the copy
+  if (key.find_first_of(" \t\r\n\f\v\xa0") == key.npos) {
+    return _get_val(values, key);
+  }
   string k(ConfFile::normalize_key_name(key));
   return _get_val(values, k);
 }
@@ -966,9 +970,6 @@ Option::value_t md_config_t::_get_val(
     return Option::value_t(boost::blank());
   }
 
-  // In key names, leading and trailing whitespace are not significant.
-  string k(ConfFile::normalize_key_name(key));
-
   const Option *o = find_option(key);
   if (!o) {
     // not a valid config option
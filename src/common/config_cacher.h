@@ -15,24 +15,32 @@
 #ifndef CEPH_CONFIG_CACHER_H
 #define CEPH_CONFIG_CACHER_H
 
+#include <atomic>
+
 #include "common/config_obs.h"
 #include "common/config.h"
 
+/// a config value for the paths too hot for get_val<>(), which takes the
+/// config lock and looks the option up by name; reading it is a relaxed
+/// atomic load, and the observer keeps it up to date
 template <typename ValueT>
 class md_config_cacher_t : public md_config_obs_t {
   ConfigProxy& conf;
   const char* const option_name;
+  // per instance: a static would track the first cacher's option for all
+  // of the cachers of the same type
+  const char* keys[2];
   std::atomic<ValueT> value_cache;
 
   const char** get_tracked_conf_keys() const override {
-    const static char* keys[] = { option_name, nullptr };
-    return keys;
+    return const_cast<const char**>(keys);
   }
 
   void handle_conf_change(const ConfigProxy& conf,
                           const std::set<std::string>& changed) override {
     if (changed.count(option_name)) {
-      value_cache.store(conf.get_val<ValueT>(option_name));
+      value_cache.store(conf.get_val<ValueT>(option_name),
+                        std::memory_order_relaxed);
     }
   }
 
@@ -40,7 +48,8 @@ public:
   md_config_cacher_t(ConfigProxy& conf,
                      const char* const option_name)
     : conf(conf),
-      option_name(option_name) {
+      option_name(option_name),
+      keys{option_name, nullptr} {
     conf.add_observer(this);
     std::atomic_init(&value_cache,
                      conf.get_val<ValueT>(option_name));
@@ -51,7 +60,7 @@ public:
   }
 
   operator ValueT() const {
-    return value_cache.load();
+    return value_cache.load(std::memory_order_relaxed);
   }
 };
 
@@ -8,6 +8,7 @@
 #include "arch/ppc.h"
 #include "common/sctp_crc32.h"
 #include "common/crc32c_intel_fast.h"
+#include "common/crc32c_intel_multi.h"
 #include "common/crc32c_aarch64.h"
 #include "common/crc32c_ppc.h"
 
@@ -52,6 +53,23 @@ ceph_crc32c_func_t ceph_choose_crc32(void)
  */
 ceph_crc32c_func_t ceph_crc32c_func = ceph_choose_crc32();
 
+void ceph_crc32c_multi(uint32_t crc, unsigned char const * const *data,
+		       unsigned n, unsigned length, uint32_t *out)
+{
+#if defined(__x86_64__)
+  if (ceph_arch_intel_sse42) {
+    for (; n >= 4; n -= 4) {
+      ceph_crc32c_intel_multi4(crc, data, length, out);
+      data += 4;
+      out += 4;
+    }
+  }
+#endif
+  for (; n > 0; --n) {
+    *out++ = ceph_crc32c(crc, *data++, length);
+  }
+}
+
 
 /*
  * Look: http://crcutil.googlecode.com/files/crc-doc.1.0.pdf
@@ -0,0 +1,19 @@
+#ifndef CEPH_COMMON_CRC32C_INTEL_MULTI_H
+#define CEPH_COMMON_CRC32C_INTEL_MULTI_H
+
+#include "include/int_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* crc32c of four equally sized buffers at once; requires sse4.2 */
+extern void ceph_crc32c_intel_multi4(uint32_t crc,
+				     unsigned char const * const *data,
+				     unsigned len, uint32_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -103,6 +103,7 @@ string hobject_t::to_str() const
 
 void hobject_t::encode(bufferlist& bl) const
 {
+  // when changing this, remember to update encoded_size() too.
   ENCODE_START(4, 3, bl);
   encode(key, bl);
   encode(oid, bl);
@@ -115,6 +116,14 @@ void hobject_t::encode(bufferlist& bl) const
   ENCODE_FINISH(bl);
 }
 
+size_t hobject_t::encoded_size() const
+{
+  // encoding header + 3 string lengths, snap, hash, max and pool
+  size_t r = sizeof(ceph_le32) + 2 * sizeof(__u8) + 3 * sizeof(__u32) +
+    sizeof(uint64_t) + sizeof(uint32_t) + sizeof(bool) + sizeof(uint64_t);
+  return r + key.size() + oid.name.size() + nspace.size();
+}
+
 void hobject_t::decode(bufferlist::const_iterator& bl)
 {
   DECODE_START_LEGACY_COMPAT_LEN(4, 3, 3, bl);
@@ -295,6 +295,7 @@ public:
   void encode(ceph::buffer::list& bl) const;
   void decode(ceph::bufferlist::const_iterator& bl);
   void decode(json_spirit::Value& v);
+  size_t encoded_size() const;
   void dump(ceph::Formatter *f) const;
   static void generate_test_instances(std::list<hobject_t*>& o);
   friend int cmp(const hobject_t& l, const hobject_t& r);
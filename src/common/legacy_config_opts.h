@@ -104,6 +104,10 @@ OPTION(ms_cluster_type, OPT_STR)   // messenger backend
 OPTION(ms_learn_addr_from_peer, OPT_BOOL)
 OPTION(ms_tcp_nodelay, OPT_BOOL)
 OPTION(ms_tcp_rcvbuf, OPT_INT)
+OPTION(ms_tcp_zerocopy_min_size, OPT_U64)
+OPTION(ms_async_send_coalesce_bytes, OPT_U64)
+OPTION(ms_async_busy_poll_us, OPT_U32)
+OPTION(ms_tcp_busy_poll_us, OPT_U32)
 OPTION(ms_tcp_prefetch_max_size, OPT_U32) // max prefetch size, we limit this to avoid extra memcpy
 OPTION(ms_initial_backoff, OPT_DOUBLE)
 OPTION(ms_max_backoff, OPT_DOUBLE)
@@ -144,6 +148,9 @@ OPTION(ms_async_rdma_send_buffers, OPT_U32)
 OPTION(ms_async_rdma_receive_buffers, OPT_U32)
 // max number of wr in srq
 OPTION(ms_async_rdma_receive_queue_len, OPT_U32)
+OPTION(ms_async_rdma_receive_queue_len_per_worker, OPT_U32)
+OPTION(ms_async_rdma_zero_copy_receive_buffers, OPT_U32)
+OPTION(ms_async_rdma_send_reg_min_size, OPT_U64)
 // support srq
 OPTION(ms_async_rdma_support_srq, OPT_BOOL)
 OPTION(ms_async_rdma_port_num, OPT_U32)
@@ -376,6 +383,7 @@ OPTION(objecter_completion_locks_per_session, OPT_U64) // num of completion lock
 OPTION(objecter_inject_no_watch_ping, OPT_BOOL)   // suppress watch pings
 OPTION(objecter_retry_writes_after_first_reply, OPT_BOOL)   // ignore the first reply for each write, and resend the osd op instead
 OPTION(objecter_debug_inject_relock_delay, OPT_BOOL)
+OPTION(objecter_osdmap_client_only, OPT_BOOL)
 
 // Max number of deletes at once in a single Filer::purge call
 OPTION(filer_max_purge_ops, OPT_U32)
@@ -641,6 +649,9 @@ OPTION(osd_ignore_stale_divergent_priors, OPT_BOOL) // do not assert on divergen
 // If set to true even after reading enough shards to
 // decode the object, any error will be reported.
 OPTION(osd_read_ec_check_for_errors, OPT_BOOL) // return error if any ec shard has an error
+OPTION(osd_ec_read_slow_shard_ratio, OPT_DOUBLE)
+OPTION(osd_ec_read_hedge_shards, OPT_U64)
+OPTION(osd_ec_extent_cache_max_bytes, OPT_U64)
 
 // Only use clone_overlap for recovery if there are fewer than
 // osd_recover_clone_overlap_limit entries in the overlap set
@@ -669,6 +680,8 @@ OPTION(osd_heartbeat_min_size, OPT_INT) // the minimum size of OSD heartbeat mes
 
 // max number of parallel snap trims/pg
 OPTION(osd_pg_max_concurrent_snap_trims, OPT_U64)
+OPTION(osd_snap_trim_max_batch, OPT_U32)
+OPTION(osd_snap_trim_target_latency, OPT_DOUBLE)
 // max number of trimming pgs
 OPTION(osd_max_trimming_pgs, OPT_U64)
 
@@ -690,6 +703,8 @@ OPTION(osd_recovery_delay_start, OPT_FLOAT)
 OPTION(osd_recovery_max_active, OPT_U64)
 OPTION(osd_recovery_max_single_start, OPT_U64)
 OPTION(osd_recovery_max_chunk, OPT_U64)  // max size of push chunk
+OPTION(osd_recovery_batch_bytes, OPT_U64)
+OPTION(osd_recovery_dirty_extents, OPT_BOOL)
 OPTION(osd_recovery_max_omap_entries_per_chunk, OPT_U64) // max number of omap entries per chunk; 0 to disable limit
 OPTION(osd_copyfrom_max_chunk, OPT_U64)   // max size of a COPYFROM chunk
 OPTION(osd_push_per_object_cost, OPT_U64)  // push cost per object
@@ -709,6 +724,8 @@ OPTION(osd_scrub_backoff_ratio, OPT_DOUBLE)   // the probability to back off the
 OPTION(osd_scrub_chunk_min, OPT_INT)
 OPTION(osd_scrub_chunk_max, OPT_INT)
 OPTION(osd_scrub_sleep, OPT_FLOAT)   // sleep between [deep]scrub ops
+OPTION(osd_scrub_max_bytes_per_sec, OPT_SIZE)
+OPTION(osd_scrub_yield_client_ops, OPT_U32)
 OPTION(osd_scrub_auto_repair, OPT_BOOL)   // whether auto-repair inconsistencies upon deep-scrubbing
 OPTION(osd_scrub_auto_repair_num_errors, OPT_U32)   // only auto-repair when number of errors is below this threshold
 OPTION(osd_deep_scrub_interval, OPT_FLOAT) // once a week
@@ -836,6 +853,8 @@ OPTION(mon_rocksdb_options, OPT_STR)
 OPTION(osd_client_op_priority, OPT_U32)
 OPTION(osd_recovery_op_priority, OPT_U32)
 OPTION(osd_peering_op_priority, OPT_U32)
+OPTION(osd_peering_batch_delay, OPT_DOUBLE)
+OPTION(osd_peering_batch_max_pgs, OPT_U32)
 
 OPTION(osd_snap_trim_priority, OPT_U32)
 OPTION(osd_snap_trim_cost, OPT_U32) // set default cost equal to 1MB io
@@ -997,6 +1016,8 @@ OPTION(bluestore_max_blob_size_ssd, OPT_U32)
  * And ask for compressing at least 12.5%(1/8) off, by default.
  */
 OPTION(bluestore_compression_required_ratio, OPT_DOUBLE)
+OPTION(bluestore_compression_frame_size, OPT_U64)
+OPTION(bluestore_cache_decompressed, OPT_BOOL)
 OPTION(bluestore_extent_map_shard_max_size, OPT_U32)
 OPTION(bluestore_extent_map_shard_target_size, OPT_U32)
 OPTION(bluestore_extent_map_shard_min_size, OPT_U32)
@@ -1013,7 +1034,7 @@ OPTION(bluestore_cache_size_ssd, OPT_U64)
 OPTION(bluestore_cache_meta_ratio, OPT_DOUBLE)
 OPTION(bluestore_cache_kv_ratio, OPT_DOUBLE)
 OPTION(bluestore_kvbackend, OPT_STR)
-OPTION(bluestore_allocator, OPT_STR)     // stupid | bitmap
+OPTION(bluestore_allocator, OPT_STR)     // stupid | bitmap | avl | hybrid
 OPTION(bluestore_freelist_blocks_per_key, OPT_INT)
 OPTION(bluestore_bitmapallocator_blocks_per_zone, OPT_INT) // must be power of 2 aligned, e.g., 512, 1024, 2048...
 OPTION(bluestore_bitmapallocator_span_size, OPT_INT) // must be power of 2 aligned, e.g., 512, 1024, 2048...
@@ -1035,6 +1056,8 @@ OPTION(bluestore_throttle_cost_per_io, OPT_U64)
 OPTION(bluestore_deferred_batch_ops, OPT_U64)
 OPTION(bluestore_deferred_batch_ops_hdd, OPT_U64)
 OPTION(bluestore_deferred_batch_ops_ssd, OPT_U64)
+OPTION(bluestore_deferred_merge, OPT_BOOL)
+OPTION(bluestore_deferred_flush_window, OPT_DOUBLE)
 OPTION(bluestore_nid_prealloc, OPT_INT)
 OPTION(bluestore_blobid_prealloc, OPT_U64)
 OPTION(bluestore_clone_cow, OPT_BOOL)  // do copy-on-write for clones
@@ -1060,6 +1083,7 @@ OPTION(bluestore_warn_on_bluefs_spillover, OPT_BOOL)
 OPTION(bluestore_warn_on_legacy_statfs, OPT_BOOL)
 OPTION(bluestore_log_op_age, OPT_DOUBLE)
 OPTION(bluestore_log_omap_iterator_age, OPT_DOUBLE)
+OPTION(bluestore_pool_latency_histograms, OPT_BOOL)
 OPTION(bluestore_debug_enforce_settings, OPT_STR)
 
 OPTION(kstore_max_ops, OPT_U64)
@@ -1408,6 +1432,7 @@ OPTION(rgw_ops_log_data_backlog, OPT_INT) // max data backlog for ops log
 OPTION(rgw_fcgi_socket_backlog, OPT_INT) // socket  backlog for fcgi
 OPTION(rgw_usage_log_flush_threshold, OPT_INT) // threshold to flush pending log data
 OPTION(rgw_usage_log_tick_interval, OPT_INT) // flush pending log data every X seconds
+OPTION(rgw_usage_log_max_pending_entries, OPT_INT) // drop usage log data beyond this backlog
 OPTION(rgw_init_timeout, OPT_INT) // time in seconds
 OPTION(rgw_mime_types_file, OPT_STR)
 OPTION(rgw_gc_max_objs, OPT_INT)
@@ -1422,6 +1447,7 @@ OPTION(rgw_obj_stripe_size, OPT_INT)
 OPTION(rgw_extended_http_attrs, OPT_STR) // list of extended attrs that can be set on objects (beyond the default)
 OPTION(rgw_exit_timeout_secs, OPT_INT) // how many seconds to wait for process to go down before exiting unconditionally
 OPTION(rgw_get_obj_window_size, OPT_INT) // window size in bytes for single get obj request
+OPTION(rgw_get_obj_max_window_size, OPT_INT) // max window size in bytes for single get obj request
 OPTION(rgw_get_obj_max_req_size, OPT_INT) // max length of a single get obj rados op
 OPTION(rgw_relaxed_s3_bucket_names, OPT_BOOL) // enable relaxed bucket name rules for US region buckets
 OPTION(rgw_defer_to_bucket_acls, OPT_STR) // if the user has bucket perms)
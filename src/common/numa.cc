@@ -4,6 +4,7 @@
 #include "numa.h"
 
 #include <cstring>
+#include <dirent.h>
 #include <errno.h>
 #include <iostream>
 
@@ -134,6 +135,57 @@ int get_numa_node_cpu_set(
   return r;
 }
 
+int set_threads_affinity(
+  size_t cpu_set_size,
+  const cpu_set_t *cpu_set,
+  const std::function<bool(const std::string& name)>& filter)
+{
+  DIR *dir = ::opendir("/proc/self/task");
+  if (!dir) {
+    return -errno;
+  }
+  int r = 0;
+  int count = 0;
+  while (struct dirent *de = ::readdir(dir)) {
+    if (de->d_name[0] == '.') {
+      continue;
+    }
+    pid_t tid = atoi(de->d_name);
+    if (filter) {
+      std::string fn = "/proc/self/task/";
+      fn += de->d_name;
+      fn += "/comm";
+      int fd = ::open(fn.c_str(), O_RDONLY);
+      if (fd < 0) {
+	continue;  // exited meanwhile
+      }
+      char buf[32];
+      int n = safe_read(fd, buf, sizeof(buf) - 1);
+      ::close(fd);
+      if (n < 0) {
+	continue;
+      }
+      buf[n] = 0;
+      while (n > 0 && ::isspace(buf[n - 1])) {
+	buf[--n] = 0;
+      }
+      if (!filter(buf)) {
+	continue;
+      }
+    }
+    if (sched_setaffinity(tid, cpu_set_size, cpu_set) < 0) {
+      if (errno == ESRCH) {
+	continue;
+      }
+      r = -errno;
+      break;
+    }
+    ++count;
+  }
+  ::closedir(dir);
+  return r < 0 ? r : count;
+}
+
 #elif defined(__FreeBSD__)
 
 int parse_cpu_set_list(const char *s,
@@ -162,4 +214,12 @@ int get_numa_node_cpu_set(int node,
   return -ENOTSUP;
 }
 
+int set_threads_affinity(
+  size_t cpu_set_size,
+  const cpu_set_t *cpu_set,
+  const std::function<bool(const std::string& name)>& filter)
+{
+  return -ENOTSUP;
+}
+
 #endif
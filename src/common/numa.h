@@ -5,8 +5,10 @@
 
 #include <include/compat.h>
 #include <sched.h>
+#include <functional>
 #include <ostream>
 #include <set>
+#include <string>
 
 int parse_cpu_set_list(const char *s,
 		       size_t *cpu_set_size,
@@ -19,3 +21,11 @@ std::set<int> cpu_set_to_set(size_t cpu_set_size,
 int get_numa_node_cpu_set(int node,
 			  size_t *cpu_set_size,
 			  cpu_set_t *cpu_set);
+
+/// set the affinity of the running threads of the process whose name
+/// passes the filter (or of all of them), unlike sched_setaffinity(getpid())
+/// which only sets the main thread's; returns the number of threads set
+int set_threads_affinity(
+  size_t cpu_set_size,
+  const cpu_set_t *cpu_set,
+  const std::function<bool(const std::string& name)>& filter = {});
@@ -17,6 +17,7 @@
  */
 #include "include/compat.h"
 #include <pthread.h>
+#include <thread>
 #include "common/Cond.h"
 #include "obj_bencher.h"
 
@@ -283,6 +284,7 @@ int ObjBencher::aio_bench(
   data.max_latency = 0;
   data.avg_latency = 0;
   data.latency_diff_sum = 0;
+  data.latency_hist = bench_latency_histogram();
   data.object_contents = contentsChars;
   lock.unlock();
 
@@ -338,6 +340,56 @@ int ObjBencher::aio_bench(
   return r;
 }
 
+void bench_latency_histogram::dump(Formatter *f) const
+{
+  f->open_array_section("latency_histogram");
+  for (unsigned i = 0; i < counts.size(); ++i) {
+    if (!counts[i])
+      continue;
+    f->open_object_section("bucket");
+    f->dump_unsigned("max_us", bucket_max(i));
+    f->dump_unsigned("count", counts[i]);
+    f->close_section();
+  }
+  f->close_section();
+}
+
+mono_time ObjBencher::next_op_start()
+{
+  if (!rate)
+    return mono_clock::now();
+  // only this thread starts ops, no need for the lock
+  mono_time due = data.start_time +
+    std::chrono::duration_cast<mono_clock::duration>(
+      std::chrono::duration<double>((double)data.started / rate));
+  std::this_thread::sleep_until(due);
+  return due;
+}
+
+static const double LATENCY_PERCENTILES[] = {50, 90, 99, 99.9, 99.99};
+
+void ObjBencher::print_latency_percentiles(unsigned width)
+{
+  if (!formatter) {
+    for (auto p : LATENCY_PERCENTILES) {
+      ostringstream label;
+      label << "p" << p << " latency(s):";
+      cout << std::left << setw(width) << label.str() << std::right
+           << data.latency_hist.percentile(p) << std::endl;
+    }
+  } else {
+    formatter->open_object_section("latency_percentiles");
+    for (auto p : LATENCY_PERCENTILES) {
+      ostringstream label;
+      label << "p" << p;
+      formatter->dump_format(label.str().c_str(), "%f",
+                             data.latency_hist.percentile(p));
+    }
+    formatter->close_section();
+    data.latency_hist.dump(formatter);
+  }
+}
+
 struct lock_cond {
   explicit lock_cond(Mutex *_lock) : lock(_lock) {}
   Mutex *lock;
@@ -441,7 +493,7 @@ int ObjBencher::write_bench(int secondsToRun,
   data.start_time = mono_clock::now();
   lock.unlock();
   for (int i = 0; i<concurrentios; ++i) {
-    start_times[i] = mono_clock::now();
+    start_times[i] = next_op_start();
     r = create_completion(i, _aio_cb, (void *)&lc);
     if (r < 0)
       goto ERR;
@@ -500,6 +552,7 @@ int ObjBencher::write_bench(int secondsToRun,
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency);
     if( data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -513,7 +566,7 @@ int ObjBencher::write_bench(int secondsToRun,
     release_completion(slot);
 
     //write new stuff to backend
-    start_times[slot] = mono_clock::now();
+    start_times[slot] = next_op_start();
     r = create_completion(slot, _aio_cb, &lc);
     if (r < 0)
       goto ERR;
@@ -546,6 +599,7 @@ int ObjBencher::write_bench(int secondsToRun,
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency);
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -607,6 +661,7 @@ int ObjBencher::write_bench(int secondsToRun,
        << "Stddev Latency(s):      " << latency_stddev << std::endl
        << "Max latency(s):         " << data.max_latency << std::endl
        << "Min latency(s):         " << data.min_latency << std::endl;
+    print_latency_percentiles(24);
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_writes_made", "%d", data.finished);
@@ -624,6 +679,7 @@ int ObjBencher::write_bench(int secondsToRun,
     formatter->dump_format("stddev_latency", "%f", latency_stddev);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    print_latency_percentiles(0);
   }
   //write object size/number data for read benchmarks
   encode(data.object_size, b_write);
@@ -693,7 +749,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
   //start initial reads
   for (int i = 0; i < concurrentios; ++i) {
     index[i] = i;
-    start_times[i] = mono_clock::now();
+    start_times[i] = next_op_start();
     create_completion(i, _aio_cb, (void *)&lc);
     r = aio_read(name[i], i, contents[i].get(), data.op_size,
 		 data.op_size * (i % reads_per_object));
@@ -764,6 +820,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
       goto ERR;
     }
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency);
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -775,7 +832,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     release_completion(slot);
 
     //start new read and check data if requested
-    start_times[slot] = mono_clock::now();
+    start_times[slot] = next_op_start();
     create_completion(slot, _aio_cb, (void *)&lc);
     r = aio_read(newName, slot, contents[slot].get(), data.op_size,
 		 data.op_size * (data.started % reads_per_object));
@@ -802,6 +859,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency);
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -854,6 +912,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
        << "Average Latency(s):   " << data.avg_latency << std::endl
        << "Max latency(s):       " << data.max_latency << std::endl
        << "Min latency(s):       " << data.min_latency << std::endl;
+    print_latency_percentiles(22);
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_reads_made", "%d", data.finished);
@@ -867,6 +926,7 @@ int ObjBencher::seq_read_bench(int seconds_to_run, int num_objects, int concurre
     formatter->dump_format("average_latency", "%f", data.avg_latency);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    print_latency_percentiles(0);
   }
 
   completions_done();
@@ -930,7 +990,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
   //start initial reads
   for (int i = 0; i < concurrentios; ++i) {
     index[i] = i;
-    start_times[i] = mono_clock::now();
+    start_times[i] = next_op_start();
     create_completion(i, _aio_cb, (void *)&lc);
     r = aio_read(name[i], i, contents[i].get(), data.op_size,
 		 data.op_size * (i % reads_per_object));
@@ -988,6 +1048,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     }
 
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency);
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -1015,7 +1076,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     cur_contents->invalidate_crc();
 
     //start new read and check data if requested
-    start_times[slot] = mono_clock::now();
+    start_times[slot] = next_op_start();
     create_completion(slot, _aio_cb, (void *)&lc);
     r = aio_read(newName, slot, contents[slot].get(), data.op_size,
 		 data.op_size * (rand_id % reads_per_object));
@@ -1043,6 +1104,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     }
     data.cur_latency = mono_clock::now() - start_times[slot];
     total_latency += data.cur_latency.count();
+    data.latency_hist.add(data.cur_latency);
     if (data.cur_latency.count() > data.max_latency)
       data.max_latency = data.cur_latency.count();
     if (data.cur_latency.count() < data.min_latency)
@@ -1095,6 +1157,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
        << "Average Latency(s):   " << data.avg_latency << std::endl
        << "Max latency(s):       " << data.max_latency << std::endl
        << "Min latency(s):       " << data.min_latency << std::endl;
+    print_latency_percentiles(22);
   } else {
     formatter->dump_format("total_time_run", "%f", timePassed.count());
     formatter->dump_format("total_reads_made", "%d", data.finished);
@@ -1108,6 +1171,7 @@ int ObjBencher::rand_read_bench(int seconds_to_run, int num_objects, int concurr
     formatter->dump_format("average_latency", "%f", data.avg_latency);
     formatter->dump_format("max_latency", "%f", data.max_latency);
     formatter->dump_format("min_latency", "%f", data.min_latency);
+    print_latency_percentiles(0);
   }
   completions_done();
 
@@ -19,6 +19,8 @@
 #include "common/Formatter.h"
 #include "ceph_time.h"
 #include <cfloat>
+#include <cmath>
+#include <vector>
 
 using ceph::mono_clock;
 
@@ -35,6 +37,55 @@ struct bench_interval_data {
   double iops_diff_sum = 0;
 };
 
+/*
+ * Latencies in microseconds, counted in log-linear buckets that are at
+ * most 1/32 of their values wide, like an HDR histogram, so that the
+ * tail percentiles are as precise as the median.
+ */
+struct bench_latency_histogram {
+  static constexpr unsigned SUB_BITS = 5;
+  static constexpr uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+
+  std::vector<uint64_t> counts;
+  uint64_t total = 0;
+
+  static unsigned bucket_of(uint64_t us) {
+    if (us < SUB_BUCKETS)
+      return us;
+    unsigned shift = 63 - __builtin_clzll(us) - SUB_BITS;
+    return ((shift + 1) << SUB_BITS) + (us >> shift) - SUB_BUCKETS;
+  }
+  /// the highest latency of a bucket, in microseconds
+  static uint64_t bucket_max(unsigned bucket) {
+    if (bucket < SUB_BUCKETS)
+      return bucket;
+    unsigned shift = (bucket >> SUB_BITS) - 1;
+    uint64_t low = (SUB_BUCKETS + (bucket & (SUB_BUCKETS - 1))) << shift;
+    return low + (1ull << shift) - 1;
+  }
+
+  void add(std::chrono::duration<double> latency) {
+    double us = latency.count() * 1000000;
+    unsigned bucket = bucket_of(us > 0 ? (uint64_t)us : 0);
+    if (bucket >= counts.size())
+      counts.resize(bucket + 1);
+    ++counts[bucket];
+    ++total;
+  }
+  /// the latency that p percent of the ops took at most, in seconds
+  double percentile(double p) const {
+    uint64_t rank = std::max<uint64_t>(1, std::ceil(p / 100 * total));
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < counts.size(); ++i) {
+      seen += counts[i];
+      if (seen >= rank)
+        return (double)bucket_max(i) / 1000000;
+    }
+    return 0;
+  }
+  void dump(Formatter *f) const;
+};
+
 struct bench_data {
   bool done; //is the benchmark is done
   uint64_t object_size; //the size of the objects
@@ -49,6 +100,7 @@ struct bench_data {
   double avg_latency;
   struct bench_interval_data idata; // data that is updated by time intervals and not by events
   double latency_diff_sum;
+  bench_latency_histogram latency_hist;
   std::chrono::duration<double> cur_latency; //latency of last completed transaction - in seconds by default
   mono_time start_time; //start time for benchmark - use the monotonic clock as we'll measure the passage of time
   char *object_contents; //pointer to the contents written to each object
@@ -63,6 +115,7 @@ typedef std::pair<std::string, std::string> Object;
 
 class ObjBencher {
   bool show_time;
+  unsigned rate = 0;  ///< ops started per second, if not as fast as possible
   Formatter *formatter = NULL;
   ostream *outstream = NULL;
 public:
@@ -106,6 +159,11 @@ protected:
 
   ostream& out(ostream& os);
   ostream& out(ostream& os, utime_t& t);
+
+  /// when the next op is to start, waiting for it if ops are rate limited
+  mono_time next_op_start();
+  /// the text report has its values at width
+  void print_latency_percentiles(unsigned width);
 public:
   explicit ObjBencher(CephContext *cct_) : show_time(false), cct(cct_), lock("ObjBencher::lock"), data() {}
   virtual ~ObjBencher() {}
@@ -118,6 +176,15 @@ public:
   void set_show_time(bool dt) {
     show_time = dt;
   }
+  /**
+   * Start ops at a fixed rate rather than as soon as others complete.
+   * The latencies are then measured from when ops were due to start,
+   * so the ops that wait for one of the concurrent ios to be free are
+   * counted as slow rather than missing.
+   */
+  void set_rate(unsigned ops_per_sec) {
+    rate = ops_per_sec;
+  }
   void set_formatter(Formatter *f) {
     formatter = f;
   }
@@ -828,6 +828,13 @@ std::vector<Option> get_global_options() {
     .set_description("Enable internal performance metrics")
     .set_long_description("If enabled, collect and expose internal health metrics"),
 
+    Option("perf_counter_shards", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(8)
+    .set_min(1)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of per-thread shards of each perf counter and average")
+    .set_long_description("Threads add to perf counters and averages in their own shard, which is summed when the counter is read, so that busy threads don't contend on the same cache line. 1 disables the sharding."),
+
     Option("ms_type", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_flag(Option::FLAG_STARTUP)
     .set_default("async+posix")
@@ -911,6 +918,33 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description("Size of TCP socket receive buffer"),
 
+    Option("ms_async_send_coalesce_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_K)
+    .set_description("While more messages are queued on a connection, batch them into one send until this many bytes are pending (0 to send each message on its own)")
+    .set_long_description("This trades a syscall per message for one per batch when many small messages, such as op replies, are queued; a batch is flushed as soon as the queue drains."),
+
+    Option("ms_async_busy_poll_us", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("After handling events, keep polling for this many microseconds before blocking (0 to disable)")
+    .set_long_description("A worker that has just been busy checks for new events without sleeping, so a reply arriving soon after a request sends is handled without the wakeup latency.  This burns CPU while idle in the window; msgr_busy_poll_wasted_time counts the time spent polling that found nothing.")
+    .add_see_also("ms_tcp_busy_poll_us"),
+
+    Option("ms_async_rx_buffer_pool_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(32_M)
+    .set_description("Memory each async messenger worker keeps for reuse as receive buffers of large message segments (0 to disable)")
+    .set_long_description("Segments of 64 KiB or more, typically write data, are read into page aligned buffers taken from this pool.  The data can then go to O_DIRECT without being realigned, and the memory isn't faulted in anew for every message.  In an OSD whose BlueStore autotunes its cache (bluestore_cache_autotune), the pools are sized by the autotuner too, up to this size each, and shrink when memory runs short."),
+
+    Option("ms_tcp_zerocopy_min_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Send messages of at least this size with MSG_ZEROCOPY (0 to disable)")
+    .set_long_description("The kernel then transmits straight from the message buffers instead of copying them into the socket, and the buffers stay referenced until it reports completion.  Only the posix stack on Linux 4.14 or later supports this; it is turned off for a connection whose sends the kernel ends up copying anyway, such as over loopback."),
+
+    Option("ms_tcp_busy_poll_us", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Set SO_BUSY_POLL on sockets to this many microseconds (0 to leave unset)")
+    .set_long_description("The kernel then polls the network device queue for a socket with nothing to read instead of waiting for the interrupt.  Values above the net.core.busy_read sysctl need CAP_NET_ADMIN.")
+    .add_see_also("ms_async_busy_poll_us"),
+
     Option("ms_tcp_prefetch_max_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_K)
     .set_description("Maximum amount of data to prefetch out of the socket receive buffer"),
@@ -1079,6 +1113,21 @@ std::vector<Option> get_global_options() {
     .set_min_max(1, 24)
     .set_description("Threadpool size for AsyncMessenger (ms_type=async)"),
 
+    Option("ms_async_heartbeat_op_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min_max(0, 8)
+    .set_description("Threads of the heartbeat messengers (ms_type=async+posix)")
+    .set_long_description("The messengers created for heartbeats get threads of their own, so that pings aren't delayed by the other traffic. 0 makes them share the threads of the other messengers.")
+    .add_see_also("ms_async_op_threads")
+    .add_see_also("ms_async_heartbeat_nice"),
+
+    Option("ms_async_heartbeat_nice", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min_max(-20, 19)
+    .set_description("Nice value of the heartbeat messenger threads")
+    .set_long_description("A negative value needs CAP_SYS_NICE.")
+    .add_see_also("ms_async_heartbeat_op_threads"),
+
     Option("ms_async_max_op_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description("Maximum threadpool size of AsyncMessenger")
@@ -1108,6 +1157,24 @@ std::vector<Option> get_global_options() {
     .set_default(4096)
     .set_description(""),
 
+    Option("ms_async_rdma_receive_queue_len_per_worker", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Size the shared receive queue to this many receive buffers per worker thread (0 to use ms_async_rdma_receive_queue_len)")
+    .set_long_description("All connections of a messenger receive through one shared receive queue, so a single fixed depth runs short as connections and workers are added.  The depth is capped by the device and by half of ms_async_rdma_receive_buffers.")
+    .add_see_also("ms_async_op_threads")
+    .add_see_also("ms_async_rdma_receive_buffers"),
+
+    Option("ms_async_rdma_zero_copy_receive_buffers", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1024)
+    .set_description("Maximum number of receive buffers that zero-copy reads hand out at once (0 to always copy)")
+    .set_long_description("A zero-copy read returns data that points into the receive buffer, which is only reused once that data is released.  Past this limit reads copy the data out, so that slow readers can't drain the receive pool.")
+    .add_see_also("ms_async_rdma_receive_buffers"),
+
+    Option("ms_async_rdma_send_reg_min_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Register outgoing buffers of at least this size with the device and send them in place (0 to disable)")
+    .set_long_description("Smaller buffers are copied into the preregistered send buffers.  A registered buffer stays referenced until its send completes.  Registering costs a system call per buffer, so this only pays off for large buffers such as 4MB writes."),
+
     Option("ms_async_rdma_support_srq", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description(""),
@@ -1320,6 +1387,21 @@ std::vector<Option> get_global_options() {
     .add_service("mon")
     .set_description("granularity of PG placement calculation background work"),
 
+    Option("mon_osd_full_map_compression", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("none")
+    .set_enum_allowed({"none", "snappy", "zlib", "zstd", "lz4"})
+    .set_flag(Option::FLAG_RUNTIME)
+    .add_service("mon")
+    .set_description("compression algorithm for the full OSDMaps in the mon store")
+    .set_long_description("Full OSDMaps written from then on are compressed with this compressor plugin when it makes them smaller. Maps already stored are left as they are. Nothing is compressed until all the mons in the quorum support the osdmap-compression mon feature, which then stays set in the monmap."),
+
+    Option("mon_osd_propose_pending_changes", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .add_service("mon")
+    .set_description("propose a new OSDMap without waiting out paxos_propose_interval once this many OSDs changed state in it")
+    .set_long_description("During a large failure or boot storm, the pending OSDMap may carry thousands of OSD state changes by the time paxos_propose_interval runs out. Once it has this many, it is proposed right away instead. 0 disables this.")
+    .add_see_also("paxos_propose_interval"),
+
     Option("mon_osd_max_creating_pgs", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1024)
     .add_service("mon")
@@ -2140,6 +2222,18 @@ std::vector<Option> get_global_options() {
     .set_default(1_hr)
     .set_description(""),
 
+    Option("auth_ticket_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4096)
+    .set_description("Number of verified service tickets a daemon keeps")
+    .set_long_description("The connections presenting a ticket that was verified before skip decrypting it again. The authorizer is still checked with the ticket's session key every time. 0 disables the cache.")
+    .add_see_also("auth_ticket_cache_ttl"),
+
+    Option("auth_ticket_cache_ttl", Option::TYPE_SECS, Option::LEVEL_ADVANCED)
+    .set_default(10_min)
+    .set_description("How long a verified service ticket is kept at most")
+    .set_long_description("A ticket is never kept past its expiration.")
+    .add_see_also("auth_ticket_cache_size"),
+
     Option("auth_debug", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_description(""),
@@ -2234,6 +2328,11 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("objecter_osdmap_client_only", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Keep only the parts of the OSDMap a client uses")
+    .set_long_description("When decoding OSDMaps, skip per-OSD metadata the Objecter never reads (heartbeat and cluster addresses, osd_info, uuids, the removed snaps queue). This saves memory and decode time for plain librados clients. Do not enable it for daemons that inspect or re-encode the map, such as ceph-mgr."),
+
     Option("filer_max_purge_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description("Max in-flight operations for purging a striped range (e.g., MDS journal)"),
@@ -2291,6 +2390,12 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_STARTUP)
     .set_description("automatically set affinity to numa node when storage and network match"),
 
+    Option("osd_numa_split_affinity", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("when storage and network are on different numa nodes, set the affinity of the messenger threads to the network's node and of the objectstore threads to the storage's")
+    .add_see_also("osd_numa_auto_affinity"),
+
     Option("osd_numa_node", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(-1)
     .set_flag(Option::FLAG_STARTUP)
@@ -2353,6 +2458,23 @@ std::vector<Option> get_global_options() {
     .set_default(1000)
     .set_description("halflife of agent atime and temp histograms"),
 
+    Option("osd_agent_temp_sketch_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("counters per row of the in-memory sketch the agent estimates object temperatures with")
+    .set_long_description("If non-zero, the tier agent estimates how hot an "
+                          "object is from a count-min sketch of the accesses "
+                          "kept in memory by each PG, instead of looking it up "
+                          "in the archived hit sets it would otherwise have "
+                          "to read back. The sketch of a PG takes 8 bytes times this. "
+                          "Takes effect when the agent of a PG starts.")
+    .add_see_also("osd_agent_temp_sketch_halflife"),
+
+    Option("osd_agent_temp_sketch_halflife", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(600)
+    .set_min(1)
+    .set_description("seconds after which the access counts of the temperature sketch are halved")
+    .add_see_also("osd_agent_temp_sketch_size"),
+
     Option("osd_agent_slop", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(.02)
     .set_description("slop factor to avoid switching tiering flush and eviction mode"),
@@ -2407,6 +2529,27 @@ std::vector<Option> get_global_options() {
     .set_default(100)
     .set_description("maximum number of in-flight client requests"),
 
+    Option("osd_repop_batch_window_us", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("How long a replicated write may wait to be batched with others for the same replica (microseconds)")
+    .set_long_description("Replica sub-ops for the same peer OSD sent within this window are combined into one message, saving per-message framing and crc work on both sides at the cost of up to this much added write latency.  0 disables batching.  Only used once require_osd_release is at least octopus.")
+    .add_see_also("osd_repop_batch_max_ops")
+    .add_see_also("osd_repop_batch_max_bytes"),
+
+    Option("osd_repop_batch_max_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(16)
+    .set_min(1)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Send a replica sub-op batch once it holds this many ops")
+    .add_see_also("osd_repop_batch_window_us"),
+
+    Option("osd_repop_batch_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(256_K)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Send a replica sub-op batch once its transactions reach this size")
+    .add_see_also("osd_repop_batch_window_us"),
+
     Option("osd_crush_update_weight_set", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("update CRUSH weight-set weights when updating weights")
@@ -2577,6 +2720,14 @@ std::vector<Option> get_global_options() {
     .set_default(100000)
     .set_description(""),
 
+    Option("osd_hit_set_sample_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min_max(0.0, 1.0)
+    .set_description("fraction of the accesses recorded in the hit sets")
+    .set_long_description("The objects accessed often are still likely to be "
+                          "recorded when sampling, while each hit set fills up "
+                          "and is persisted less often."),
+
     Option("osd_hit_set_namespace", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default(".ceph-internal")
     .set_description(""),
@@ -2651,6 +2802,13 @@ std::vector<Option> get_global_options() {
     .set_default(40)
     .set_description(""),
 
+    Option("osd_map_peer_share_grace", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0.0)
+    .set_description("how long to wait for heartbeat peers to share newer maps before asking the mons for them")
+    .set_long_description("An OSD that hears from an up heartbeat peer about maps it doesn't have yet waits this many seconds for the peer to share them, as peers do with the OSDs they see behind, before subscribing to the mons. This keeps the mons from being asked for the same maps by every OSD after a partition heals, but each new map then reaches the OSD up to this much later, since peers only share maps when they hear the OSD's next ping. 0 disables this.")
+    .add_see_also("osd_map_share_max_epochs")
+    .add_see_also("osd_heartbeat_interval"),
+
     Option("osd_pg_epoch_max_lag_factor", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(2.0)
     .set_description("Max multiple of the map cache that PGs can lag before we throttle map injest")
@@ -2701,6 +2859,12 @@ std::vector<Option> get_global_options() {
     .set_description("")
     .add_see_also("osd_op_num_threads_per_shard"),
 
+    Option("osd_load_pgs_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Number of threads reading the pgs' state and logs at startup")
+    .set_long_description("0 uses one thread per op shard."),
+
     Option("osd_op_num_shards", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_flag(Option::FLAG_STARTUP)
@@ -2718,6 +2882,17 @@ std::vector<Option> get_global_options() {
     .set_description("")
     .add_see_also("osd_op_num_shards"),
 
+    Option("osd_op_run_to_completion", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Run client ops on the messenger thread that received them when their PG is idle")
+    .set_long_description("When the op's shard queue is empty and its PG is neither "
+      "busy nor waiting on anything, the op is executed directly by the "
+      "messenger worker instead of being handed to an op thread, saving two "
+      "thread handoffs per op.  This suits fast (NVMe) devices; on slow "
+      "ones a blocking read stalls every connection served by that messenger "
+      "worker.  At most one op per shard runs this way at a time.")
+    .add_see_also("osd_op_num_shards"),
+
     Option("osd_skip_data_digest", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
     .set_description("Do not store full-object checksums if the backend (bluestore) does its own checksums.  Only usable with all BlueStore OSDs."),
@@ -3052,6 +3227,20 @@ std::vector<Option> get_global_options() {
     .add_see_also("osd_op_queue_mclock_scrub_wgt")
     .add_see_also("osd_op_queue_mclock_anticipation_timeout"),
 
+    Option("osd_op_queue_mclock_cost_unit_hdd", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_M)
+    .set_description("bytes an op transfers to cost as much as one more op, on rotational devices")
+    .set_long_description("when osd_op_queue is either 'mclock_opclass' or 'mclock_client', a client or replica op of this many bytes is charged twice the cost of an empty one, so that the reservations, weights and limits account for the data moved as well as the number of ops; recovery, scrub, snap trim and pg deletion items are charged 1 each; 0 charges every op the same")
+    .add_see_also("osd_op_queue")
+    .add_see_also("osd_op_queue_mclock_cost_unit_ssd"),
+
+    Option("osd_op_queue_mclock_cost_unit_ssd", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(32_K)
+    .set_description("bytes an op transfers to cost as much as one more op, on non-rotational devices")
+    .set_long_description("when osd_op_queue is either 'mclock_opclass' or 'mclock_client', a client or replica op of this many bytes is charged twice the cost of an empty one, so that the reservations, weights and limits account for the data moved as well as the number of ops; recovery, scrub, snap trim and pg deletion items are charged 1 each; 0 charges every op the same")
+    .add_see_also("osd_op_queue")
+    .add_see_also("osd_op_queue_mclock_cost_unit_hdd"),
+
     Option("osd_op_queue_mclock_anticipation_timeout", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(0.0)
     .set_description("mclock anticipation timeout in seconds")
@@ -3201,6 +3390,24 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("osd_ec_read_slow_shard_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("Avoid reading EC shards from peers this many times slower than the median")
+    .set_long_description("When a client read can be decoded without them, skip shards on peers whose recent sub read latency exceeds this multiple of the median latency of the available shards.  0 disables.")
+    .add_see_also("osd_ec_read_hedge_shards"),
+
+    Option("osd_ec_read_hedge_shards", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Number of extra EC shards to read for a client read")
+    .set_long_description("Read this many shards beyond the minimum needed, picking the fastest peers, and complete the read as soon as enough of them have answered.  A lighter version of the pool fast_read flag, which reads all shards.")
+    .add_see_also("osd_ec_read_slow_shard_ratio"),
+
+    Option("osd_ec_extent_cache_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Bytes of recently written stripes kept per EC PG")
+    .set_long_description("On pools with overwrites enabled, keep up to this many bytes of the stripes written by completed writes, so that a later partial overwrite of the same stripe does not need to read it back from the shards.  0 disables."),
+
     Option("osd_recover_clone_overlap_limit", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_description(""),
@@ -3281,10 +3488,28 @@ std::vector<Option> get_global_options() {
     .set_default(2000)
     .set_description("Minimum heartbeat packet size in bytes. Will add dummy payload if heartbeat packet is smaller than this."),
 
+    Option("osd_heartbeat_nice", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min_max(-20, 19)
+    .set_description("Nice value of the thread sending the peer pings")
+    .set_long_description("A negative value needs CAP_SYS_NICE.")
+    .add_see_also("ms_async_heartbeat_nice"),
+
     Option("osd_pg_max_concurrent_snap_trims", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(2)
     .set_description(""),
 
+    Option("osd_snap_trim_max_batch", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(32)
+    .set_description("Most clones a PG trims in a single transaction (0 for a transaction per clone)")
+    .set_long_description("A snap trim round starts at osd_pg_max_concurrent_snap_trims clones, grows towards this while rounds commit within osd_snap_trim_target_latency and halves when they do not, but never below osd_pg_max_concurrent_snap_trims. Only clones that go to the same peers share a transaction.")
+    .add_see_also("osd_snap_trim_target_latency"),
+
+    Option("osd_snap_trim_target_latency", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.1)
+    .set_description("Commit latency, in seconds, a batched snap trim round should stay under")
+    .add_see_also("osd_snap_trim_max_batch"),
+
     Option("osd_max_trimming_pgs", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(2)
     .set_description(""),
@@ -3353,6 +3578,19 @@ std::vector<Option> get_global_options() {
     .set_default(8_M)
     .set_description(""),
 
+    Option("osd_recovery_batch_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Backfill small objects along with the recovery op of the object before them while their sizes add up to no more than this (0 for an op per object)")
+    .set_long_description("Each object counts for at least a page, so empty objects are batched in bounded numbers too.  Batched objects still count against osd_recovery_max_active, but a pg's recovery round may start them beyond the osd_recovery_max_single_start ops reserved for it.")
+    .add_see_also("osd_recovery_max_single_start")
+    .add_see_also("osd_recovery_max_active"),
+
+    Option("osd_recovery_dirty_extents", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Record the data ranges each write changes in its pg log entry, so log-based recovery pushes only those")
+    .set_long_description("Applies to replicated pools once require_osd_release is octopus.  An object without snapshots and omap is updated in place on the peer, or on a clone of the peer's copy when its dirty ranges since the peer's version take more than one recovery chunk; anything else is pushed whole.")
+    .add_see_also("osd_recovery_max_chunk"),
+
     Option("osd_recovery_max_omap_entries_per_chunk", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(8096)
     .set_description(""),
@@ -3371,7 +3609,8 @@ std::vector<Option> get_global_options() {
 
     Option("osd_max_push_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
-    .set_description(""),
+    .set_description("Most objects packed into one push message (0 to only bound them by osd_max_push_cost)")
+    .add_see_also("osd_max_push_cost"),
 
     Option("osd_max_scrubs", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(1)
@@ -3442,6 +3681,18 @@ std::vector<Option> get_global_options() {
     .set_default(0)
     .set_description("Duration to inject a delay during scrubbing"),
 
+    Option("osd_scrub_max_bytes_per_sec", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Limit on the bytes per second scrub reads from this OSD's store (0 for no limit)")
+    .set_long_description("Scrub charges what each object scan reads against this budget, shared by all PGs on the OSD, and sleeps between chunks until it is paid back.")
+    .add_see_also("osd_scrub_sleep"),
+
+    Option("osd_scrub_yield_client_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Delay the next scrub chunk while at least this many client ops are queued on the OSD (0 to never yield)")
+    .set_long_description("Scrub then sleeps for osd_scrub_sleep, or 100ms if that is shorter, before starting the chunk.")
+    .add_see_also("osd_scrub_sleep"),
+
     Option("osd_scrub_auto_repair", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("Automatically repair damaged objects detected during scrub"),
@@ -3714,6 +3965,23 @@ std::vector<Option> get_global_options() {
     .set_default(10.0)
     .set_description(""),
 
+    Option("osd_op_history_sample_rate", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Keep one op out of this many for dump_historic_ops_trace (0 to keep none)")
+    .set_long_description("Client ops are sampled by their request, so the OSDs that replicate a sampled write keep its repops as well, and their traces can be merged.")
+    .add_see_also("osd_op_history_sample_size"),
+
+    Option("osd_op_history_sample_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_description("Max number of sampled ops to keep for dump_historic_ops_trace")
+    .add_see_also("osd_op_history_sample_rate"),
+
+    Option("osd_perf_query_sample_interval", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1)
+    .set_min(1)
+    .set_description("Count only one client op out of this many in the mgr perf queries")
+    .set_long_description("The counters of the ops that are counted are scaled up to stand for the ones skipped, trading accuracy for the cost of evaluating the queries on busy OSDs. Takes effect when the queries are next set."),
+
     Option("osd_target_transaction_size", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(30)
     .set_description(""),
@@ -3854,6 +4122,14 @@ std::vector<Option> get_global_options() {
     .set_default("binned_lru")
     .set_description(""),
 
+    Option("rocksdb_cache_probation_ratio", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(.25)
+    .set_min_max(0.0, 1.0)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Ratio of the binned_lru block cache kept for the blocks not hit since they were read")
+    .set_long_description("Those blocks are evicted first, so that a scan, such as a bucket listing or a deep scrub, doesn't flush the blocks that are read over and over. With cache autotuning, the cache asks for their memory at a lower priority than for the blocks that were hit.  0 disables it.")
+    .add_see_also("rocksdb_cache_type"),
+
     Option("rocksdb_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_K)
     .set_description(""),
@@ -3876,7 +4152,9 @@ std::vector<Option> get_global_options() {
 
     Option("rocksdb_enable_rmrange", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
-    .set_description("Refer to github.com/facebook/rocksdb/wiki/DeleteRange-Implementation"),
+    .set_description("Use a single range tombstone to remove large key ranges")
+    .set_long_description("Ranges with more than rocksdb_max_items_rmrange keys (e.g. the omap of a large bucket index object) are removed with rocksdb DeleteRange, so clearing them costs one tombstone instead of one per key.  Refer to github.com/facebook/rocksdb/wiki/DeleteRange-Implementation")
+    .add_see_also("rocksdb_max_items_rmrange"),
 
     Option("rocksdb_max_items_rmrange", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1024)
@@ -3935,6 +4213,17 @@ std::vector<Option> get_global_options() {
     .set_default(255)
     .set_description(""),
 
+    Option("osd_peering_batch_delay", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Seconds to hold back peering messages so those of other PGs to the same peer go in the same message (0 to send right away)")
+    .set_long_description("Batching changes the order in which peering messages of different PGs reach a peer, though each PG's own messages stay in order.  A delay of a few milliseconds (e.g. .002) cuts the message count after a map change that touches many PGs.")
+    .add_see_also("osd_peering_batch_max_pgs"),
+
+    Option("osd_peering_batch_max_pgs", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(256)
+    .set_description("Send the held back peering messages once this many PGs have some")
+    .add_see_also("osd_peering_batch_delay"),
+
     Option("osd_snap_trim_priority", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description(""),
@@ -4012,6 +4301,53 @@ std::vector<Option> get_global_options() {
     .set_default(1_G)
     .set_description(""),
 
+    Option("osd_max_pg_omap_read_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1024)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Maximum number of objects read by one pg-omap-read op")
+    .set_long_description("The entries and bytes returned by the op are also "
+                          "bounded by osd_max_omap_entries_per_request and "
+                          "osd_max_omap_bytes_per_request, over all of its "
+                          "objects."),
+
+    Option("osd_omap_cursors_per_pg", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Number of omap iterators a PG keeps positioned past "
+                     "a truncated omap listing")
+    .set_long_description("A listing that goes on from the last key of such "
+                          "a page, on an object that didn't change since, "
+                          "uses the iterator instead of seeking a new one. "
+                          "Open iterators hold on to the store's data as it "
+                          "was when they were opened. 0 disables this.")
+    .add_see_also("osd_omap_cursors_max")
+    .add_see_also("osd_omap_cursor_ttl"),
+
+    Option("osd_omap_cursors_max", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(32)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Number of omap iterators all of the PGs of an OSD keep "
+                     "positioned past a truncated omap listing")
+    .set_long_description("A truncated listing gets no cursor while the OSD "
+                          "has this many, on top of the limit of "
+                          "osd_omap_cursors_per_pg.")
+    .add_see_also("osd_omap_cursors_per_pg"),
+
+    Option("osd_omap_cursor_ttl", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(5)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Seconds an omap iterator kept for a listing is kept "
+                     "without being used")
+    .add_see_also("osd_omap_cursors_per_pg"),
+
+    Option("osd_omap_scan_readahead", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(2_M)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Readahead asked of the object store for long omap scans")
+    .set_long_description("Used when loading the PG log and for omap "
+      "listings of at least 64 entries, e.g. RGW bucket listings. "
+      "0 disables readahead."),
+
     Option("osd_objectstore", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("bluestore")
     .set_enum_allowed({"bluestore", "filestore", "memstore", "kstore"})
@@ -4134,6 +4470,19 @@ std::vector<Option> get_global_options() {
     .set_default(16)
     .set_description(""),
 
+    Option("bdev_ioring", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Enables Linux io_uring API instead of libaio"),
+
+    Option("bdev_ioring_hipri", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Enables Linux io_uring API Use polled IO completions"),
+
+    Option("bdev_ioring_sqthread_poll", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Enables Linux io_uring API Offload submission/completion to kernel thread")
+    .set_long_description("With this enabled a kernel thread polls the submission queue, so that neither submission nor completion reaping needs a syscall while the device is busy."),
+
     Option("bdev_block_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_K)
     .set_description(""),
@@ -4214,6 +4563,18 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("bluefs_wal_envelope_mode", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Write rocksdb WAL files as checksummed envelopes")
+    .set_long_description("Each flush of a WAL file is written as a block aligned envelope carrying its own length and crc32c.  On replay the file size is recovered by walking the envelopes, so a WAL sync that fits in previously allocated space is a single data write without a BlueFS log update.  Each sync consumes at least one block.  Files written in this mode cannot be read by older releases.")
+    .add_see_also("bluefs_wal_envelope_alloc_size"),
+
+    Option("bluefs_wal_envelope_alloc_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(32_M)
+    .set_description("Allocation step for WAL files in envelope mode")
+    .set_long_description("Envelope WAL files grow by at least this much at a time, so that the BlueFS log only needs updating when a WAL file runs out of space.  Recycled WAL files keep their space, which together forms a preallocated journal ring.")
+    .add_see_also("bluefs_wal_envelope_mode"),
+
     Option("bluestore_bluefs", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(true)
     .set_flag(Option::FLAG_CREATE)
@@ -4281,6 +4642,11 @@ std::vector<Option> get_global_options() {
     .set_default(5)
     .set_description("Time period to wait if there is no completed I/O from polling"),
 
+    Option("bluestore_spdk_qpair_count", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(0)
+    .set_description("Number of NVMe I/O queue pairs per device, 0 means one per submitting thread")
+    .set_long_description("Each submitting thread (e.g. an OSD op shard thread) is pinned to one queue pair on its first I/O and polls that queue pair's completions inline.  Once this many queue pairs exist, further threads share them round robin.  Setting it to the number of OSD op shard threads gives every shard its own queue pair while staying within the controller's queue limits."),
+
     Option("bluestore_block_path", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("")
     .set_flag(Option::FLAG_CREATE)
@@ -4445,6 +4811,20 @@ std::vector<Option> get_global_options() {
     .set_description("Default value of bluestore_compression_max_blob_size for non-rotational (solid state) media")
     .add_see_also("bluestore_compression_max_blob_size"),
 
+    Option("bluestore_compression_frame_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Compress blobs in independent frames of this size (0 disables framing)")
+    .set_long_description("When non-zero, blobs of at least twice this size are compressed as a sequence of independently compressed frames, so that a small read only decompresses the frames it covers instead of the whole blob.  Framed blobs can not be read by releases that do not support them.")
+    .add_see_also("bluestore_compression_max_blob_size"),
+
+    Option("bluestore_cache_decompressed", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Cache decompressed data even for unbuffered reads")
+    .set_long_description("Decompressing a blob is expensive, so keep the decompressed result in the buffer cache unless the client passes a DONTNEED or NOCACHE hint.")
+    .add_see_also("bluestore_default_buffered_read"),
+
     Option("bluestore_gc_enable_blob_threshold", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(0)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4455,6 +4835,38 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_RUNTIME)
     .set_description(""),
 
+    Option("bluestore_defrag_enable", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Rewrite fragmented objects in the background")
+    .set_long_description("A background thread periodically walks all collections looking for objects whose extent maps have grown far beyond what their size calls for, and rewrites them into large contiguous blobs.  Objects sharing blobs with clones are left alone.  Progress is reported by the 'dump_objectstore_defrag_status' admin socket command.")
+    .add_see_also({"bluestore_defrag_min_extents", "bluestore_defrag_bytes_per_sec", "bluestore_defrag_interval"}),
+
+    Option("bluestore_defrag_min_extents", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Minimum number of logical extents for an object to be defragmented")
+    .set_long_description("Objects are also skipped unless they have at least twice as many extents as needed to hold their data in blobs of bluestore_max_blob_size.")
+    .add_see_also("bluestore_defrag_enable"),
+
+    Option("bluestore_defrag_bytes_per_sec", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(8_M)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Maximum rate at which object data is rewritten by defragmentation")
+    .add_see_also("bluestore_defrag_enable"),
+
+    Option("bluestore_defrag_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(3600)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Seconds to wait between two defragmentation passes")
+    .add_see_also("bluestore_defrag_enable"),
+
+    Option("bluestore_pool_latency_histograms", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Keep transaction state latency histograms per pool")
+    .set_long_description("The bluestore-pool-<id> perf counters then carry the same state_*_lat_hist histograms as the bluestore counters, for the transactions of that pool only.  Each pool costs about 100KB of memory."),
+
     Option("bluestore_max_blob_size", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(0)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4556,6 +4968,13 @@ std::vector<Option> get_global_options() {
     .add_see_also("bluestore_cache_autotune")
     .set_description("The number of seconds to wait between rebalances when cache autotune is enabled."),
 
+    Option("bluestore_cache_autotune_max_miss_weight", Option::TYPE_FLOAT, Option::LEVEL_DEV)
+    .set_default(1)
+    .set_min(1)
+    .add_see_also("bluestore_cache_autotune")
+    .set_description("Most the autotuner scales a cache's ratio by, either way, for what its misses cost")
+    .set_long_description("Each cache counts the misses that a little more memory would have turned into hits, and how long its misses take to serve. The ratios of the caches where more memory would save the most time are scaled up, and the others down, by up to this factor. 1, the default, keeps the configured ratios and doesn't keep the stats at all."),
+
     Option("bluestore_kvbackend", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("rocksdb")
     .set_flag(Option::FLAG_CREATE)
@@ -4563,10 +4982,26 @@ std::vector<Option> get_global_options() {
 
     Option("bluestore_allocator", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("bitmap")
-    .set_enum_allowed({"bitmap", "stupid"})
+    .set_enum_allowed({"bitmap", "stupid", "avl", "hybrid"})
     .set_description("Allocator policy")
     .set_long_description("Allocator to use for bluestore.  Stupid should only be used for testing."),
 
+    Option("bluestore_avl_alloc_bf_threshold", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(131072)
+    .set_description("Sets threshold at which shrinking max free chunk size triggers enabling best-fit mode.")
+    .set_long_description("AVL allocator works in two modes: near-fit and best-fit. By default, it uses very fast near-fit mode, in which it tries to fit a new block near the last allocated block of similar size. The second mode is much slower best-fit mode, in which it tries to find an exact match for the requested allocation. This mode is used when either the device gets fragmented or when it is low on free space. When the largest free block is smaller than 'bluestore_avl_alloc_bf_threshold', best-fit mode is used.")
+    .add_see_also("bluestore_avl_alloc_bf_free_pct"),
+
+    Option("bluestore_avl_alloc_bf_free_pct", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(4)
+    .set_description("Sets threshold at which shrinking free space (in %, integer) triggers enabling best-fit mode.")
+    .set_long_description("AVL allocator works in two modes: near-fit and best-fit. By default, it uses very fast near-fit mode, in which it tries to fit a new block near the last allocated block of similar size. The second mode is much slower best-fit mode, in which it tries to find an exact match for the requested allocation. This mode is used when either the device gets fragmented or when it is low on free space. When free space is smaller than 'bluestore_avl_alloc_bf_free_pct', best-fit mode is used.")
+    .add_see_also("bluestore_avl_alloc_bf_threshold"),
+
+    Option("bluestore_hybrid_alloc_mem_cap", Option::TYPE_UINT, Option::LEVEL_DEV)
+    .set_default(64_M)
+    .set_description("Maximum RAM hybrid allocator should use before enabling bitmap supplement"),
+
     Option("bluestore_freelist_blocks_per_key", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(128)
     .set_description("Block (and bits) per database key"),
@@ -4593,7 +5028,8 @@ std::vector<Option> get_global_options() {
 
     Option("bluestore_rocksdb_cfs", Option::TYPE_STR, Option::LEVEL_DEV)
     .set_default("M= P= L=")
-    .set_description("List of whitespace-separate key/value pairs where key is CF name and value is CF options"),
+    .set_description("List of whitespace-separate key/value pairs where key is CF name and value is CF options")
+    .set_long_description("A key of the form P(n) spreads prefix P over n column families (P-0 .. P-n-1) by key hash.  Values are rocksdb column family options, so each CF may carry its own block_based_table_factory (cache) and compaction settings.  The layout is fixed when the db is created; use 'ceph-bluestore-tool reshard --sharding' to change it on an existing store."),
 
     Option("bluestore_fsck_on_mount", Option::TYPE_BOOL, Option::LEVEL_DEV)
     .set_default(false)
@@ -4628,6 +5064,14 @@ std::vector<Option> get_global_options() {
     .set_flag(Option::FLAG_RUNTIME)
     .set_description("Maximum bytes read at once by deep fsck"),
 
+    Option("bluestore_fsck_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Number of threads checking objects during fsck")
+    .set_long_description("Onodes are decoded by a single thread walking the "
+      "object keyspace; faulting in extent shards, checking blobs and, for "
+      "deep fsck, reading the data is spread over this many threads.  0 "
+      "uses one thread per CPU, 1 checks everything inline."),
+
     Option("bluestore_throttle_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(64_M)
     .set_flag(Option::FLAG_RUNTIME)
@@ -4672,6 +5116,32 @@ std::vector<Option> get_global_options() {
     .set_description("Default bluestore_deferred_batch_ops for non-rotational (solid state) media")
     .add_see_also("bluestore_deferred_batch_ops"),
 
+    Option("bluestore_deferred_merge", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Flush deferred writes from all sequencers together")
+    .set_long_description("When several sequencers have deferred writes pending, sort and merge their extents into one device-wide flush so that adjacent small writes from different PGs become a single sequential I/O.")
+    .add_see_also("bluestore_deferred_batch_ops"),
+
+    Option("bluestore_deferred_flush_window", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Max seconds a deferred write waits to be merged before it is flushed")
+    .set_long_description("Pending deferred writes are normally flushed once bluestore_deferred_batch_ops of them have accumulated.  If this is non-zero they are also flushed once this much time has passed since the previous flush, so that a partial batch is not left pending on an idle device.  0 disables the time based flush.")
+    .add_see_also("bluestore_deferred_batch_ops")
+    .add_see_also("bluestore_deferred_merge"),
+
+    Option("bluestore_kv_sync_pipeline", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_flag(Option::FLAG_STARTUP)
+    .set_description("Pipeline kv commits across two threads")
+    .set_long_description("With this enabled the kv_sync thread only flushes the block device and submits each commit group; a separate kv_commit thread makes the group durable.  One group is then synced while the next one is flushed and submitted and a third is finalized."),
+
+    Option("bluestore_alloc_image", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Save the allocator state on clean umount and load it on mount")
+    .set_long_description("Rebuilding the allocator from the freelist walks every freelist key, which can take minutes on large devices.  With this enabled a checksummed image of the free extents is written on clean umount and used by the next mount.  The image is dropped as soon as the store is opened for writing, so after an unclean shutdown (or if the image does not match the device) the allocator is rebuilt from the freelist as before."),
+
     Option("bluestore_nid_prealloc", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(1024)
     .set_description("Number of unique object ids to preallocate at a time"),
@@ -4787,6 +5257,12 @@ std::vector<Option> get_global_options() {
     .set_description("Enforces specific hw profile settings")
     .set_long_description("'hdd' enforces settings intended for BlueStore above a rotational drive. 'ssd' enforces settings intended for BlueStore above a solid drive. 'default' - using settings for the actual hardware."),
 
+    Option("bluestore_debug_transaction_trace", Option::TYPE_STR, Option::LEVEL_DEV)
+    .set_default("")
+    .set_flag(Option::FLAG_RUNTIME)
+    .set_description("Append the transactions queued to this file")
+    .set_long_description("Each queue_transactions() call is appended, with its collection and the time it was queued, so that ceph_replay_objectstore can replay them against another store.  Set it with 'config set' through the admin socket to start tracing a running OSD, and clear it to stop."),
+
 
     // -----------------------------------------
     // kstore
@@ -5271,6 +5747,28 @@ std::vector<Option> get_global_options() {
     .set_default(false)
     .set_description(""),
 
+    Option("rados_striper_lockless_reads", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Read striped objects without taking their shared lock")
+    .set_long_description("The shared lock keeps a striped object from being "
+			  "truncated or removed while it is read. Skipping it "
+			  "saves two writes to the first object per read, and "
+			  "is safe for objects that are not changed once "
+			  "written."),
+
+    Option("rados_striper_write_lock_lease", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("Seconds a striped object's shared lock is kept for "
+		     "the writes that follow")
+    .set_long_description("A write takes the shared lock with this duration "
+			  "and keeps it, and the writes to the same object "
+			  "in the first half of it reuse it instead of "
+			  "locking, reading the layout and unlocking again. "
+			  "Other clients can't truncate or remove the object "
+			  "until the lock expires. 0 unlocks after every "
+			  "write."),
+
     Option("nss_db_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
     .set_default("")
     .set_description(""),
@@ -5315,6 +5813,12 @@ std::vector<Option> get_global_options() {
                           "if you simply do not require the most up to date "
                           "performance counter data."),
 
+    Option("mgr_py_snapshot_max_bytes", Option::TYPE_SIZE, Option::LEVEL_DEV)
+    .set_default(256_M)
+    .add_service("mgr")
+    .set_description("Memory for the marshalled OSDMap and PGMap dumps kept for mgr modules")
+    .set_long_description("A dump that modules ask for twice at the same map version is kept marshalled until the map changes, so that later requests skip building it. Dumps that would exceed this many bytes in total are not kept."),
+
     Option("mgr_client_bytes", Option::TYPE_SIZE, Option::LEVEL_DEV)
     .set_default(128_M)
     .add_service("mgr"),
@@ -5454,6 +5958,13 @@ std::vector<Option> get_rgw_options() {
     .set_default(1000)
     .set_description("Max number of objects in a single multi-object delete request"),
 
+    Option("rgw_delete_multi_obj_max_concurrency", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(8)
+    .set_min(1)
+    .set_description("Max number of objects deleted at once by a multi-object delete request")
+    .set_long_description("The deletions run in coroutines of the request, so they overlap only with a frontend that provides them (beast).")
+    .add_see_also("rgw_delete_multi_obj_max_num"),
+
     Option("rgw_website_routing_rules_max_num", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(50)
     .set_description("Max number of website routing rules in a single request"),
@@ -5492,6 +6003,25 @@ std::vector<Option> get_rgw_options() {
     .set_long_description("The window size may be dynamically adjusted, but will not surpass this value.")
     .add_see_also({"rgw_put_obj_min_window_size", "rgw_max_chunk_size"}),
 
+    Option("rgw_put_obj_filter_threads", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Number of threads that compress and encrypt uploaded data")
+    .set_long_description(
+        "The compression and encryption of the data of an upload are done by a pool "
+        "of this many threads shared by all requests, so that several chunks of an "
+        "object are processed at once. With 0, they are done on the thread of the "
+        "request, one chunk at a time. Changes take effect on restart.")
+    .add_see_also({"rgw_put_obj_filter_max_inflight"}),
+
+    Option("rgw_put_obj_filter_max_inflight", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(4)
+    .set_min(1)
+    .set_description("Max number of chunks of an upload compressed or encrypted at once")
+    .set_long_description(
+        "When rgw_put_obj_filter_threads is set, the request waits for the oldest of "
+        "its chunks once this many of them are being processed.")
+    .add_see_also({"rgw_put_obj_filter_threads"}),
+
     Option("rgw_max_put_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(5_G)
     .set_description("Max size (in bytes) of regular (non multi-part) object upload.")
@@ -5656,6 +6186,15 @@ std::vector<Option> get_rgw_options() {
           "concurrency of lifecycle maintenance, but requires multiple RGW processes "
           "running on the zone to be utilized."),
 
+    Option("rgw_lc_max_worker", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(3)
+    .set_min(1)
+    .set_description("Number of lifecycle worker threads")
+    .set_long_description(
+          "Number of threads in each RGW process that process lifecycle data shards, "
+          "and so buckets, in parallel.")
+    .add_see_also("rgw_lc_max_objs"),
+
     Option("rgw_lc_max_rules", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(1000)
     .set_description("Max number of lifecycle rules set on one bucket")
@@ -5843,6 +6382,32 @@ std::vector<Option> get_rgw_options() {
     .set_default(false)
     .set_description("Should S3 authentication use Keystone."),
 
+    Option("rgw_s3_signing_key_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(10000)
+    .set_description("Max number of AWS v4 signing keys to cache")
+    .set_long_description(
+        "A signing key is derived from a secret key and the credential scope "
+        "(date, region, service) of a request with four HMAC rounds. Caching "
+        "it spares those for the requests that follow with the same scope. "
+        "0 disables the cache. Takes effect on restart."),
+
+    Option("rgw_s3_auth_cache_ttl", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("Seconds to cache the users looked up by S3 access key")
+    .set_long_description(
+        "S3 requests authenticated with the credentials stored in RADOS look "
+        "up the user of their access key. With a ttl set, the user found is "
+        "reused for the requests that follow with the same key, for that many "
+        "seconds. A user, or key, that is changed or removed meanwhile may keep "
+        "being authenticated, by this gateway, until then. 0 disables the "
+        "cache. Takes effect on restart.")
+    .add_see_also("rgw_s3_auth_cache_size"),
+
+    Option("rgw_s3_auth_cache_size", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(10000)
+    .set_description("Max number of users cached by S3 access key")
+    .add_see_also("rgw_s3_auth_cache_ttl"),
+
     Option("rgw_s3_auth_order", Option::TYPE_STR, Option::LEVEL_ADVANCED)
      .set_default("sts, external, local")
      .set_description("Authentication strategy order to use for s3 authentication")
@@ -6216,6 +6781,17 @@ std::vector<Option> get_rgw_options() {
         "certain threshold.")
     .add_see_also({"rgw_enable_usage_log", "rgw_usage_log_flush_threshold"}),
 
+    Option("rgw_usage_log_max_pending_entries", Option::TYPE_INT, Option::LEVEL_ADVANCED)
+    .set_default(65536)
+    .set_min(1)
+    .set_description("Max number of usage log entries held before new ones are dropped")
+    .set_long_description(
+        "Usage log entries are held in memory until they are flushed to the backend. "
+        "If the flushes can't keep up, entries for users and buckets that have none "
+        "pending yet are dropped once this many are held, and counted in the "
+        "usage_log_dropped perf counter.")
+    .add_see_also({"rgw_enable_usage_log", "rgw_usage_log_flush_threshold"}),
+
     Option("rgw_init_timeout", Option::TYPE_INT, Option::LEVEL_BASIC)
     .set_default(300)
     .set_description("Initialization timeout")
@@ -6326,6 +6902,27 @@ std::vector<Option> get_rgw_options() {
     .set_description("RGW object read window size")
     .set_long_description("The window size in bytes for a single object read request"),
 
+    Option("rgw_get_obj_max_window_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(64_M)
+    .set_description("RGW object read maximum window size")
+    .set_long_description(
+        "A single object read request starts with a window of "
+        "rgw_get_obj_window_size bytes and doubles it, up to this size, "
+        "whenever it waited at least rgw_get_obj_window_grow_wait_us on "
+        "RADOS rather than on the client. A value no larger than "
+        "rgw_get_obj_window_size keeps the window fixed.")
+    .add_see_also("rgw_get_obj_window_size")
+    .add_see_also("rgw_get_obj_window_grow_wait_us"),
+
+    Option("rgw_get_obj_window_grow_wait_us", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(1000)
+    .set_description("RGW object read wait that grows its window (microseconds)")
+    .set_long_description(
+        "When a single object read request has a full window and waits at "
+        "least this long for one of its RADOS reads to complete, its window "
+        "doubles, up to rgw_get_obj_max_window_size.")
+    .add_see_also("rgw_get_obj_max_window_size"),
+
     Option("rgw_get_obj_max_req_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(4_M)
     .set_description("RGW object read chunk size")
@@ -6397,6 +6994,43 @@ std::vector<Option> get_rgw_options() {
         "there information about removed objects which is needed in order to prevent "
         "re-syncing of objects that were already removed."),
 
+    Option("rgw_bucket_existence_filter", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Answer reads of missing objects from per bucket bloom filters")
+    .set_long_description(
+        "RGW keeps a bloom filter of the object names of the buckets that are "
+        "read, built from their index, so that reads of objects a bucket never "
+        "had fail without a RADOS op. Writes through this gateway are seen at "
+        "once, writes through other gateways (or by radosgw-admin) only once "
+        "the filter is refreshed: until then, a read of an object just written "
+        "elsewhere may get a 404.")
+    .add_see_also("rgw_bucket_existence_filter_refresh_interval")
+    .add_see_also("rgw_bucket_existence_filter_max_buckets")
+    .add_see_also("rgw_bucket_existence_filter_max_objects"),
+
+    Option("rgw_bucket_existence_filter_refresh_interval", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(10)
+    .set_min(1)
+    .set_description("Seconds between checks of a filtered bucket's index for changes")
+    .set_long_description(
+        "A bucket whose index changed since its filter was built gets its "
+        "filter rebuilt. A bucket that wasn't read since the last check stops "
+        "being filtered.")
+    .add_see_also("rgw_bucket_existence_filter"),
+
+    Option("rgw_bucket_existence_filter_max_buckets", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(100)
+    .set_description("Max number of buckets to keep existence filters of")
+    .add_see_also("rgw_bucket_existence_filter"),
+
+    Option("rgw_bucket_existence_filter_max_objects", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(100000)
+    .set_description("Max number of objects of a bucket to keep an existence filter of")
+    .set_long_description(
+        "Building a filter lists the whole bucket index, so larger buckets are "
+        "not filtered.")
+    .add_see_also("rgw_bucket_existence_filter"),
+
     Option("rgw_data_log_window", Option::TYPE_INT, Option::LEVEL_ADVANCED)
     .set_default(30)
     .set_description("Data log time window")
@@ -6591,6 +7225,14 @@ std::vector<Option> get_rgw_options() {
     .set_default(true)
     .set_description("Should run sync thread"),
 
+    Option("rgw_bucket_sync_max_spawn_window", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_description("Max number of objects synced at once per bucket shard")
+    .set_long_description(
+        "Multisite bucket shard sync starts with 20 object syncs in flight and raises "
+        "that, up to this number, while doing so raises the rate at which objects "
+        "are synced."),
+
     Option("rgw_sync_lease_period", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(120)
     .set_description(""),
@@ -6994,6 +7636,16 @@ std::vector<Option> get_rgw_options() {
     .add_see_also("rgw_dmclock_metadata_res")
     .add_see_also("rgw_dmclock_metadata_wgt"),
 
+    Option("rgw_dmclock_qos_per_tenant", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("Schedule the requests of a tenant's users as one dmclock client")
+    .set_long_description(
+        "Users with a qos of their own (see radosgw-admin --qos-weight) are "
+        "each scheduled as a dmclock client of the beast frontend. With this "
+        "enabled, the users of a tenant share the one client, whose qos is "
+        "that of the user that last sent a request.")
+    .add_see_also("rgw_scheduler_type"),
+
   });
 }
 
@@ -7059,6 +7711,19 @@ static std::vector<Option> get_rbd_options() {
     .set_default(true)
     .set_description("process AIO ops from a dispatch thread to prevent blocking"),
 
+    Option("rbd_direct_dispatch_aio", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(false)
+    .set_description("send AIO ops from the caller's thread when nothing "
+                     "would make them wait")
+    .set_long_description("With rbd_non_blocking_aio, an op is still sent "
+                          "inline as long as no other op is queued, no "
+                          "write blockers, lock acquisition, refresh or QoS "
+                          "throttling are pending. This saves the hand-off "
+                          "to the dispatch thread for clients that issue IO "
+                          "from a thread of their own, at the cost of that "
+                          "thread doing the send.")
+    .add_see_also("rbd_non_blocking_aio"),
+
     Option("rbd_cache", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(true)
     .set_description("whether to enable caching (writeback unless rbd_cache_max_dirty is 0)"),
@@ -7078,6 +7743,24 @@ static std::vector<Option> get_rbd_options() {
     .set_default(32_M)
     .set_description("cache size in bytes"),
 
+    Option("rbd_persistent_cache_path", Option::TYPE_STR, Option::LEVEL_ADVANCED)
+    .set_default("")
+    .set_description("directory for the persistent write-back cache logs")
+    .set_long_description("If set, writes to images with the exclusive-lock "
+                          "feature complete once they are durable in a log "
+                          "file in this directory (on a local SSD or a DAX "
+                          "mounted pmem device), and are written back to the "
+                          "cluster in the background. A log left behind by a "
+                          "crash is replayed the next time the image is "
+                          "opened, and until then the image can't be opened "
+                          "with the cache on another host.")
+    .add_see_also("rbd_persistent_cache_size"),
+
+    Option("rbd_persistent_cache_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_G)
+    .set_description("size of a new persistent write-back cache log")
+    .add_see_also("rbd_persistent_cache_path"),
+
     Option("rbd_cache_max_dirty", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(24_M)
     .set_description("dirty limit in bytes - set to 0 for write-through caching"),
@@ -7098,11 +7781,25 @@ static std::vector<Option> get_rbd_options() {
     .set_default(false)
     .set_description("whether to block writes to the cache before the aio_write call completes"),
 
+    Option("rbd_cache_bypass_min_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(1_M)
+    .set_description("page aligned reads and writes of at least this size bypass the cache - set to 0 to cache all I/O")
+    .set_long_description("Large sequential I/O doesn't benefit from the cache but pays for copying and merging its buffers. Such writes are sent straight to the OSDs once any writeback of the range has completed, and such reads are once any dirty data in the range has been flushed, unless they can be served from the cache."),
+
     Option("rbd_concurrent_management_ops", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
     .set_default(10)
     .set_min(1)
     .set_description("how many operations can be in flight for a management operation like deleting or resizing an image"),
 
+    Option("rbd_concurrent_deep_copy_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_description("how much data can be in flight for a deep copy")
+    .set_long_description("If non-zero, the number of objects copied at once "
+                          "by a deep copy or migration is limited by the data "
+                          "each object copy may buffer (an object per "
+                          "snapshot copied) rather than by "
+                          "rbd_concurrent_management_ops."),
+
     Option("rbd_balance_snap_reads", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
     .set_default(false)
     .set_description("distribute snap read requests to random OSD"),
@@ -7490,6 +8187,24 @@ static std::vector<Option> get_immutable_object_cache_options() {
     Option("immutable_object_cache_watermark", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(0.1)
     .set_description("immutable object cache water mark"),
+
+    Option("immutable_object_cache_promote_hits", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(2)
+    .set_min(1)
+    .set_description("number of misses of an object before it is promoted")
+    .set_long_description("An object is promoted to the cache once it is missed "
+                          "this many times within immutable_object_cache_promote_window, "
+                          "so that reading an image once does not evict everything else. "
+                          "1 promotes objects on their first miss.")
+    .add_see_also("immutable_object_cache_promote_window"),
+
+    Option("immutable_object_cache_promote_window", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(60)
+    .set_min(0)
+    .set_description("seconds the misses of an object count towards promoting it")
+    .set_long_description("0 counts them until the object is promoted or forgotten "
+                          "to make room for others.")
+    .add_see_also("immutable_object_cache_promote_hits"),
   });
 }
 
@@ -7546,6 +8261,12 @@ std::vector<Option> get_mds_options() {
     .set_default(16384)
     .set_description("number of directory entries to read in one RADOS operation"),
 
+    Option("mds_dir_prefetch", Option::TYPE_BOOL, Option::LEVEL_ADVANCED)
+    .set_default(true)
+    .set_description("fetch the next fragment of a directory while a client reads one")
+    .set_long_description("When a client starts reading a fragment of a directory, the MDS begins loading the next fragment from the metadata pool if it is not cached, so that readdir of large fragmented directories doesn't stall on each fragment in turn.")
+    .add_see_also("mds_dir_keys_per_op"),
+
     Option("mds_decay_halflife", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(5)
     .set_description("rate of decay for temperature counters on each directory for balancing"),
@@ -7582,6 +8303,11 @@ std::vector<Option> get_mds_options() {
     .set_default(5000)
     .set_description("maximum number of caps to recall from client session in single recall"),
 
+    Option("mds_recall_min_caps", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(100)
+    .set_description("minimum number of caps to recall from client session in single recall")
+    .set_long_description("Outside of enforcing mds_max_caps_per_client, the caps recalled under cache pressure are shared among the client sessions by the number of caps each holds. A session whose share is smaller than this is asked for this many caps instead, so that clients are not sent many recalls of a few caps each."),
+
     Option("mds_recall_max_decay_rate", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
     .set_default(2.5)
     .set_description("decay rate for throttle on recalled caps on a session"),
@@ -7654,6 +8380,24 @@ std::vector<Option> get_mds_options() {
     .set_default(1024)
     .set_description("maximum number of events in an MDS journal segment"),
 
+    Option("mds_log_group_commit_interval", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(0)
+    .set_min(0)
+    .set_description("how long (in seconds) a journal flush may wait for more events")
+    .set_long_description("When non-zero, a flush of the MDS journal is delayed by up to this long so that the events journaled meanwhile are written with it, as fewer and larger writes. This trades some latency of each update for throughput under a storm of them. 0 flushes right away.")
+    .add_see_also("mds_log_group_commit_max_bytes"),
+
+    Option("mds_log_group_commit_max_bytes", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
+    .set_default(4_M)
+    .set_description("flush a delayed journal flush early once this many bytes are journaled")
+    .add_see_also("mds_log_group_commit_interval"),
+
+    Option("mds_log_replay_batch_events", Option::TYPE_UINT, Option::LEVEL_ADVANCED)
+    .set_default(64)
+    .set_min(1)
+    .set_description("number of decoded journal events replayed per acquisition of the MDS lock")
+    .set_long_description("Replay decodes the journal events as they are read, without the MDS lock, and applies them in batches of up to this many, ending a batch early when it has to wait for the journal or a new segment starts."),
+
     Option("mds_log_segment_size", Option::TYPE_SIZE, Option::LEVEL_ADVANCED)
     .set_default(0)
     .set_description("size in bytes of each MDS log segment"),
@@ -7734,7 +8478,9 @@ std::vector<Option> get_mds_options() {
 
     Option("mds_bal_mode", Option::TYPE_INT, Option::LEVEL_DEV)
     .set_default(0)
-    .set_description(""),
+    .set_min_max(0, 3)
+    .set_description("how the balancer rates the load of an MDS")
+    .set_long_description("0 weighs subtree popularity, request rate and queue length; 1 uses the request rate and queue length; 2 uses the CPU time of the MDS; 3 uses the time spent serving the requests on each subtree, plus what the queued requests will take, and moves subtrees by that same measure."),
 
     Option("mds_bal_min_rebalance", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(.1)
@@ -7936,6 +8682,19 @@ std::vector<Option> get_mds_options() {
     .set_default(0.5)
     .set_description("number of parallel purge operations performed per PG"),
 
+    Option("mds_purge_limit_max_scale", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(4.0)
+    .set_min(1.0)
+    .set_description("how far the purge queue may raise its file and op limits while purges complete quickly")
+    .set_long_description("While the purge queue is held back by mds_max_purge_files or mds_max_purge_ops_per_pg and its purges complete within mds_purge_latency_target, it raises both limits, up to this multiple of them. It halves the multiple whenever a purge takes longer. mds_max_purge_ops still caps the ops in flight. 1 disables this.")
+    .add_see_also({"mds_purge_latency_target", "mds_max_purge_files", "mds_max_purge_ops_per_pg"}),
+
+    Option("mds_purge_latency_target", Option::TYPE_FLOAT, Option::LEVEL_ADVANCED)
+    .set_default(1.0)
+    .set_min(0.0)
+    .set_description("seconds a round of a purge's object deletes may take before the purge queue stops raising its limits")
+    .add_see_also("mds_purge_limit_max_scale"),
+
     Option("mds_purge_queue_busy_flush_period", Option::TYPE_FLOAT, Option::LEVEL_DEV)
     .set_default(1.0)
     .set_description(""),
@@ -16,6 +16,7 @@
 #include "common/perf_counters.h"
 #include "common/dout.h"
 #include "common/valgrind.h"
+#include "include/intarith.h"
 
 using std::ostringstream;
 
@@ -152,6 +153,18 @@ PerfCounters::~PerfCounters()
 {
 }
 
+PerfCounters::perf_counter_shard_t *
+PerfCounters::perf_counter_data_any_d::get_shard()
+{
+  if (!shards) {
+    return nullptr;
+  }
+  // threads take the shards in turn, so that the busy ones rarely share
+  static std::atomic<uint32_t> next_thread_shard = { 0 };
+  thread_local uint32_t thread_shard = next_thread_shard++;
+  return &shards[(thread_shard % num_shards) * shard_stride];
+}
+
 void PerfCounters::inc(int idx, uint64_t amt)
 {
 #ifndef WITH_SEASTAR
@@ -164,7 +177,9 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
+  if (auto shard = data.get_shard(); shard) {
+    shard->add(amt, data.type & PERFCOUNTER_LONGRUNAVG);
+  } else if (data.type & PERFCOUNTER_LONGRUNAVG) {
     data.avgcount++;
     data.u64 += amt;
     data.avgcount2++;
@@ -186,7 +201,11 @@ void PerfCounters::dec(int idx, uint64_t amt)
   ceph_assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64 -= amt;
+  if (auto shard = data.get_shard(); shard) {
+    shard->u64 -= amt;
+  } else {
+    data.u64 -= amt;
+  }
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -205,11 +224,14 @@ void PerfCounters::set(int idx, uint64_t amt)
   ANNOTATE_BENIGN_RACE_SIZED(&data.u64, sizeof(data.u64),
                              "perf counter atomic");
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
+    // the shards' count moves to the base, which counts this set too
+    const uint64_t count = data.clear_shards() + 1;
+    data.avgcount += count;
     data.u64 = amt;
-    data.avgcount2++;
+    data.avgcount2 += count;
   } else {
     data.u64 = amt;
+    data.clear_shards();
   }
 }
 
@@ -225,7 +247,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64;
+  return data.read_u64();
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -240,7 +262,9 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
+  if (auto shard = data.get_shard(); shard) {
+    shard->add(amt.to_nsec(), data.type & PERFCOUNTER_LONGRUNAVG);
+  } else if (data.type & PERFCOUNTER_LONGRUNAVG) {
     data.avgcount++;
     data.u64 += amt.to_nsec();
     data.avgcount2++;
@@ -261,7 +285,9 @@ void PerfCounters::tinc(int idx, ceph::timespan amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
+  if (auto shard = data.get_shard(); shard) {
+    shard->add(amt.count(), data.type & PERFCOUNTER_LONGRUNAVG);
+  } else if (data.type & PERFCOUNTER_LONGRUNAVG) {
     data.avgcount++;
     data.u64 += amt.count();
     data.avgcount2++;
@@ -283,6 +309,7 @@ void PerfCounters::tset(int idx, utime_t amt)
   if (!(data.type & PERFCOUNTER_TIME))
     return;
   data.u64 = amt.to_nsec();
+  data.clear_shards();
   if (data.type & PERFCOUNTER_LONGRUNAVG)
     ceph_abort();
 }
@@ -299,7 +326,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64;
+  uint64_t v = data.read_u64();
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -447,7 +474,7 @@ void PerfCounters::dump_formatted_generic(Formatter *f, bool schema,
         d->histogram->dump_formatted(f);
         f->close_section();
       } else {
-	uint64_t v = d->u64;
+	uint64_t v = d->read_u64();
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -578,6 +605,41 @@ PerfCounters *PerfCountersBuilder::create_perf_counters()
     ceph_assert(d->type & (PERFCOUNTER_U64 | PERFCOUNTER_TIME));
   }
 
+#ifndef WITH_SEASTAR
+  // seastar runs a reactor per core, with counters of its own
+  const uint64_t num_shards = m_perf_counters->m_cct ?
+    m_perf_counters->m_cct->_conf.get_val<uint64_t>("perf_counter_shards") : 1;
+  if (num_shards > 1) {
+    auto& vec = m_perf_counters->m_data;
+    auto is_sharded = [](const PerfCounters::perf_counter_data_any_d& d) {
+      return !(d.type & PERFCOUNTER_HISTOGRAM) &&
+	(d.type & (PERFCOUNTER_COUNTER | PERFCOUNTER_LONGRUNAVG));
+    };
+    const uint32_t num_sharded = std::count_if(vec.begin(), vec.end(),
+					       is_sharded);
+    if (num_sharded > 0) {
+      // pad each shard to whole cache lines: 8 counters of 24 bytes are 3
+      static_assert(sizeof(PerfCounters::perf_counter_shard_t) == 24);
+      static_assert(PerfCounters::SHARD_ALIGN == 64);
+      const uint32_t stride = p2roundup(num_sharded, 8u);
+      const size_t n = num_shards * stride;
+      auto p = static_cast<PerfCounters::perf_counter_shard_t*>(
+	::operator new[](n * sizeof(PerfCounters::perf_counter_shard_t),
+			 std::align_val_t(PerfCounters::SHARD_ALIGN)));
+      std::uninitialized_default_construct_n(p, n);
+      m_perf_counters->m_shards.reset(p);
+      uint32_t i = 0;
+      for (auto& d : vec) {
+	if (is_sharded(d)) {
+	  d.shards = &m_perf_counters->m_shards[i++];
+	  d.num_shards = num_shards;
+	  d.shard_stride = stride;
+	}
+      }
+    }
+  }
+#endif
+
   PerfCounters *ret = m_perf_counters;
   m_perf_counters = NULL;
   return ret;
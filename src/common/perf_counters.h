@@ -150,6 +150,34 @@ private:
 class PerfCounters
 {
 public:
+  /// the shards are allocated aligned to this, a cache line
+  static constexpr std::size_t SHARD_ALIGN = 64;
+
+  /** One thread's part of a sharded counter; see perf_counter_data_any_d. */
+  struct perf_counter_shard_t {
+    std::atomic<uint64_t> u64 = { 0 };
+    std::atomic<uint64_t> avgcount = { 0 };
+    std::atomic<uint64_t> avgcount2 = { 0 };
+
+    void add(uint64_t amt, bool avg) {
+      if (avg) {
+	avgcount++;
+	u64 += amt;
+	avgcount2++;
+      } else {
+	u64 += amt;
+      }
+    }
+    std::pair<uint64_t,uint64_t> read_avg() const {
+      uint64_t sum, count;
+      do {
+	count = avgcount2;
+	sum = u64;
+      } while (avgcount != count);
+      return { sum, count };
+    }
+  };
+
   /** Represents a PerfCounters data element. */
   struct perf_counter_data_any_d {
     perf_counter_data_any_d()
@@ -186,18 +214,56 @@ public:
     std::atomic<uint64_t> avgcount2 = { 0 };
     std::unique_ptr<PerfHistogram<>> histogram;
 
+    /**
+     * Counters and averages are only ever added to, so each thread adds
+     * to its own shard of them instead of u64 and avgcount, and a read
+     * sums the shards. Shard i of this counter is shards[i * shard_stride].
+     * Null for gauges and histograms, and when sharding is disabled.
+     */
+    perf_counter_shard_t *shards = nullptr;
+    uint32_t num_shards = 0;
+    uint32_t shard_stride = 0;
+
+    /// the calling thread's shard, or null if not sharded
+    perf_counter_shard_t *get_shard();
+    /// zero the shards, for set() and tset(); return the count they held
+    uint64_t clear_shards() {
+      uint64_t count = 0;
+      for (uint32_t i = 0; i < num_shards; ++i) {
+	auto& shard = shards[i * shard_stride];
+	count += shard.avgcount.exchange(0);
+	shard.u64 = 0;
+	shard.avgcount2 = 0;
+      }
+      return count;
+    }
+
     void reset()
     {
       if (type != PERFCOUNTER_U64) {
 	    u64 = 0;
 	    avgcount = 0;
 	    avgcount2 = 0;
+	    for (uint32_t i = 0; i < num_shards; ++i) {
+	      auto& shard = shards[i * shard_stride];
+	      shard.u64 = 0;
+	      shard.avgcount = 0;
+	      shard.avgcount2 = 0;
+	    }
       }
       if (histogram) {
         histogram->reset();
       }
     }
 
+    uint64_t read_u64() const {
+      uint64_t v = u64;
+      for (uint32_t i = 0; i < num_shards; ++i) {
+	v += shards[i * shard_stride].u64;
+      }
+      return v;
+    }
+
     // read <sum, count> safely by making sure the post- and pre-count
     // are identical; in other words the whole loop needs to be run
     // without any intervening calls to inc, set, or tinc.
@@ -207,6 +273,12 @@ public:
 	count = avgcount2;
 	sum = u64;
       } while (avgcount != count);
+      // each shard's pair is consistent on its own
+      for (uint32_t i = 0; i < num_shards; ++i) {
+	auto a = shards[i * shard_stride].read_avg();
+	sum += a.first;
+	count += a.second;
+      }
       return { sum, count };
     }
   };
@@ -293,6 +365,14 @@ private:
 
   perf_counter_data_vec_t m_data;
 
+  struct shards_deleter {
+    void operator()(perf_counter_shard_t *p) const {
+      ::operator delete[](p, std::align_val_t(SHARD_ALIGN));
+    }
+  };
+  /// the shards of the sharded counters in m_data, by shard and then counter
+  std::unique_ptr<perf_counter_shard_t[], shards_deleter> m_shards;
+
   friend class PerfCountersBuilder;
   friend class PerfCountersCollectionImpl;
 };
@@ -12,20 +12,45 @@
  *
  */
 
+#include <map>
+#include <memory>
+
 #include "QatAccel.h"
 
 /* Estimate data expansion after decompression */
 static const unsigned int expansion_ratio[] = {5, 20, 50, 100, 200};
 
-QatAccel::~QatAccel() {
-  if (NULL != session.internal) {
-    qzTeardownSession(&session);
-    qzClose(&session);
+struct qat_session_deleter {
+  void operator()(QzSession_T *session) const {
+    qzTeardownSession(session);
+    qzClose(session);
+    delete session;
   }
+};
+typedef std::unique_ptr<QzSession_T, qat_session_deleter> qat_session_ptr;
+
+static qat_session_ptr open_session(QzSessionParams_T *params) {
+  qat_session_ptr session(new QzSession_T({0}));
+  int rc = qzInit(session.get(), QZ_SW_BACKUP_DEFAULT);
+  if (rc != QZ_OK && rc != QZ_DUPLICATE && rc != QZ_NO_HW)
+    return nullptr;
+
+  rc = qzSetupSession(session.get(), params);
+  if (rc != QZ_OK && rc != QZ_DUPLICATE && rc != QZ_NO_HW)
+    return nullptr;
+  return session;
+}
+
+QzSession_T *QatAccel::get_session() {
+  // by algorithm, the only parameter that differs between the users
+  static thread_local std::map<int, qat_session_ptr> sessions;
+  auto& session = sessions[params.comp_algorithm];
+  if (!session)
+    session = open_session(&params);
+  return session.get();
 }
 
 bool QatAccel::init(const std::string &alg) {
-  QzSessionParams_T params = {(QzHuffmanHdr_T)0,};
   int rc;
 
   rc = qzGetDefaults(&params);
@@ -45,28 +70,21 @@ bool QatAccel::init(const std::string &alg) {
   if (rc != QZ_OK)
       return false;
 
-  rc = qzInit(&session, QZ_SW_BACKUP_DEFAULT);
-  if (rc != QZ_OK && rc != QZ_DUPLICATE && rc != QZ_NO_HW)
-    return false;
-
-  rc = qzSetupSession(&session, &params);
-  if (rc != QZ_OK && rc != QZ_DUPLICATE && rc != QZ_NO_HW ) {
-    qzTeardownSession(&session);
-    qzClose(&session);
-    return false;
-  }
-
-  return true;
+  // make sure a session can be set up at all
+  return get_session() != nullptr;
 }
 
 int QatAccel::compress(const bufferlist &in, bufferlist &out) {
+  QzSession_T *session = get_session();
+  if (!session)
+    return -1;
   for (auto &i : in.buffers()) {
     const unsigned char* c_in = (unsigned char*) i.c_str();
     unsigned int len = i.length();
     unsigned int out_len = qzMaxCompressedLength(len);
 
     bufferptr ptr = buffer::create_small_page_aligned(out_len);
-    int rc = qzCompress(&session, c_in, &len, (unsigned char *)ptr.c_str(), &out_len, 1);
+    int rc = qzCompress(session, c_in, &len, (unsigned char *)ptr.c_str(), &out_len, 1);
     if (rc != QZ_OK)
       return -1;
     out.append(ptr, 0, out_len);
@@ -83,6 +101,9 @@ int QatAccel::decompress(const bufferlist &in, bufferlist &out) {
 int QatAccel::decompress(bufferlist::const_iterator &p,
 		 size_t compressed_len,
 		 bufferlist &dst) {
+  QzSession_T *session = get_session();
+  if (!session)
+    return -1;
   unsigned int ratio_idx = 0;
   bool read_more = false;
   bool joint = false;
@@ -106,9 +127,9 @@ int QatAccel::decompress(bufferlist::const_iterator &p,
     bufferptr ptr = buffer::create_small_page_aligned(out_len);
 
     if (joint)
-      rc = qzDecompress(&session, (const unsigned char*)tmp.c_str(), &len, (unsigned char*)ptr.c_str(), &out_len);
+      rc = qzDecompress(session, (const unsigned char*)tmp.c_str(), &len, (unsigned char*)ptr.c_str(), &out_len);
     else
-      rc = qzDecompress(&session, (const unsigned char*)cur_ptr.c_str(), &len, (unsigned char*)ptr.c_str(), &out_len);
+      rc = qzDecompress(session, (const unsigned char*)cur_ptr.c_str(), &len, (unsigned char*)ptr.c_str(), &out_len);
     if (rc == QZ_DATA_ERROR) {
       if (!joint) {
         tmp.append(cur_ptr.c_str(), cur_ptr.length());
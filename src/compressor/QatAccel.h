@@ -18,12 +18,19 @@
 #include <qatzip.h>
 #include "include/buffer.h"
 
+/*
+ * A QATzip session serves one request at a time, so each thread gets
+ * its own, set up on first use: the threads compressing at once then
+ * all have their requests in flight on the accelerator, instead of
+ * taking turns on a single session.
+ */
 class QatAccel {
-  QzSession_T session;
+  QzSessionParams_T params = {(QzHuffmanHdr_T)0,};
+
+  QzSession_T *get_session();
 
  public:
-  QatAccel() : session({0}) {}
-  ~QatAccel();
+  QatAccel() {}
 
   bool init(const std::string &alg);
 
@@ -18,6 +18,8 @@
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd/lib/zstd.h"
 
+#include <memory>
+
 #include "include/buffer.h"
 #include "include/encoding.h"
 #include "compressor/Compressor.h"
@@ -29,7 +31,10 @@ class ZstdCompressor : public Compressor {
   ZstdCompressor() : Compressor(COMP_ALG_ZSTD, "zstd") {}
 
   int compress(const bufferlist &src, bufferlist &dst) override {
-    ZSTD_CStream *s = ZSTD_createCStream();
+    ZSTD_CStream *s = get_cstream();
+    if (!s) {
+      return -ENOMEM;
+    }
     ZSTD_initCStream_srcSize(s, COMPRESSION_LEVEL, src.length());
     auto p = src.begin();
     size_t left = src.length();
@@ -55,8 +60,6 @@ class ZstdCompressor : public Compressor {
     }
     ceph_assert(p.end());
 
-    ZSTD_freeCStream(s);
-
     // prefix with decompressed length
     encode((uint32_t)src.length(), dst);
     dst.append(outptr, 0, outbuf.pos);
@@ -83,7 +86,10 @@ class ZstdCompressor : public Compressor {
     outbuf.dst = dstptr.c_str();
     outbuf.size = dstptr.length();
     outbuf.pos = 0;
-    ZSTD_DStream *s = ZSTD_createDStream();
+    ZSTD_DStream *s = get_dstream();
+    if (!s) {
+      return -ENOMEM;
+    }
     ZSTD_initDStream(s);
     while (compressed_len > 0) {
       if (p.end()) {
@@ -96,11 +102,35 @@ class ZstdCompressor : public Compressor {
       ZSTD_decompressStream(s, &outbuf, &inbuf);
       compressed_len -= inbuf.size;
     }
-    ZSTD_freeDStream(s);
 
     dst.append(dstptr, 0, outbuf.pos);
     return 0;
   }
+
+ private:
+  // the streams are reset before each use, so keep one of each per
+  // thread rather than allocating and setting them up on every call
+  struct cstream_deleter {
+    void operator()(ZSTD_CStream *s) const {
+      ZSTD_freeCStream(s);
+    }
+  };
+  struct dstream_deleter {
+    void operator()(ZSTD_DStream *s) const {
+      ZSTD_freeDStream(s);
+    }
+  };
+
+  static ZSTD_CStream *get_cstream() {
+    static thread_local std::unique_ptr<ZSTD_CStream, cstream_deleter> s{
+      ZSTD_createCStream()};
+    return s.get();
+  }
+  static ZSTD_DStream *get_dstream() {
+    static thread_local std::unique_ptr<ZSTD_DStream, dstream_deleter> s{
+      ZSTD_createDStream()};
+    return s.get();
+  }
 };
 
 #endif
@@ -260,11 +260,11 @@ seastar::future<> ProtocolV2::read_frame_payload()
         logger().debug("{} cannot allocate {} aligned buffer at segment desc index {}",
                        conn, cur_rx_desc.alignment, rx_segments_data.size());
       }
-      // TODO: create aligned and contiguous buffer from socket
-      return read_exactly(cur_rx_desc.length)
-      .then([this] (auto tmp_bl) {
-        bufferlist data;
-        data.append(buffer::create(std::move(tmp_bl)));
+      // read() keeps the segment in the buffers it arrived in, where
+      // read_exactly() would copy a segment spanning several of them
+      // into a contiguous one, which is most of the larger ones
+      return read(cur_rx_desc.length)
+      .then([this] (auto data) {
         logger().debug("{} read frame segment[{}], length={}",
                        conn, rx_segments_data.size(), data.length());
         if (session_stream_handlers.rx) {
@@ -982,6 +982,13 @@ PG::do_osd_op(const object_info_t& oi, OSDOp* osd_op)
       osd_op->outdata = std::move(bl);
       return seastar::now();
     });
+  case CEPH_OSD_OP_STAT:
+    if (oi.is_whiteout()) {
+      return seastar::make_exception_future<>(object_not_found{});
+    }
+    encode(oi.size, osd_op->outdata);
+    encode(oi.mtime, osd_op->outdata);
+    return seastar::now();
   default:
     return seastar::now();
   }
@@ -992,16 +999,26 @@ seastar::future<Ref<MOSDOpReply>> PG::do_osd_ops(Ref<MOSDOp> m)
   // todo: issue requests in parallel if they don't write,
   // with writes being basically a synchronization barrier
   return seastar::do_with(std::move(m), [this](auto& m) {
-    return seastar::do_for_each(begin(m->ops), end(m->ops),
-                                [m,this](OSDOp& osd_op) {
-      const auto oid = (m->get_snapid() == CEPH_SNAPDIR ?
-                        m->get_hobj().get_head() :
-                        m->get_hobj());
-      return backend->get_object(oid).then([&osd_op,this](auto oi) {
-        return do_osd_op(*oi, &osd_op);
-      }).handle_exception_type([&osd_op](const object_not_found&) {
-        osd_op.rval = -ENOENT;
-        throw;
+    const auto oid = (m->get_snapid() == CEPH_SNAPDIR ?
+                      m->get_hobj().get_head() :
+                      m->get_hobj());
+    // all ops of a message are on the same object, so look it up once
+    return backend->get_object(oid).handle_exception_type(
+      [m](const object_not_found&) -> PGBackend::cached_oi_t {
+      if (!m->ops.empty()) {
+        m->ops.front().rval = -ENOENT;
+      }
+      throw;
+    }).then([m,this](auto oi) {
+      return seastar::do_with(std::move(oi), [m,this](auto& oi) {
+        return seastar::do_for_each(begin(m->ops), end(m->ops),
+                                    [&oi,this](OSDOp& osd_op) {
+          return do_osd_op(*oi, &osd_op).handle_exception_type(
+            [&osd_op](const object_not_found&) {
+            osd_op.rval = -ENOENT;
+            throw;
+          });
+        });
       });
     }).then([=] {
       auto reply = make_message<MOSDOpReply>(m.get(), 0, get_osdmap_epoch(),
@@ -8,13 +8,12 @@
 #include <type_traits>
 #include <boost/lockfree/queue.hpp>
 #include <boost/optional.hpp>
+#include <seastar/core/alien.hh>
 #include <seastar/core/future.hh>
 #include <seastar/core/gate.hh>
 #include <seastar/core/semaphore.hh>
 #include <seastar/core/sharded.hh>
 
-#include "Condition.h"
-
 namespace ceph::thread {
 
 struct WorkItem {
@@ -26,10 +25,14 @@ template<typename Func, typename T = std::invoke_result_t<Func>>
 struct Task final : WorkItem {
   Func func;
   seastar::future_state<T> state;
-  ceph::thread::Condition on_done;
+  // the reactor that submitted the task, and is told when it is done
+  // through its (lock-free) queue of messages from alien threads
+  const unsigned shard;
+  seastar::promise<> on_done;
 public:
   explicit Task(Func&& f)
-    : func(std::move(f))
+    : func(std::move(f)),
+      shard(seastar::engine().cpu_id())
   {}
   void process() override {
     try {
@@ -37,10 +40,12 @@ public:
     } catch (...) {
       state.set_exception(std::current_exception());
     }
-    on_done.notify();
+    seastar::alien::run_on(shard, [this] {
+      on_done.set_value();
+    });
   }
   seastar::future<T> get_future() {
-    return on_done.wait().then([this] {
+    return on_done.get_future().then([this] {
       return seastar::make_ready_future<T>(state.get0(std::move(state).get()));
     });
   }
@@ -84,9 +89,6 @@ public:
    *                 multiple of the number of cores.
    * @param n_threads the number of threads in this thread pool.
    * @param cpu the CPU core to which this thread pool is assigned
-   * @note each @c Task has its own ceph::thread::Condition, which possesses
-   * possesses an fd, so we should keep the size of queue under a reasonable
-   * limit.
    */
   ThreadPool(size_t n_threads, size_t queue_sz, unsigned cpu);
   ~ThreadPool();
@@ -2,8 +2,10 @@
 // vim: ts=8 sw=2 smarttab
 
 #include <algorithm>
+#include <cmath>
 #include <cstdlib>
 #include <iostream>
+#include <thread>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/icl/interval_map.hpp>
@@ -474,6 +476,118 @@ void CrushTester::check_overlapped_rules() const
   }
 }
 
+int CrushTester::get_rule_failure_domain_type(int ruleno) const
+{
+  int type = 0;
+  for (int s = 0; s < crush.get_rule_len(ruleno); s++) {
+    switch (crush.get_rule_op(ruleno, s)) {
+    case CRUSH_RULE_CHOOSE_FIRSTN:
+    case CRUSH_RULE_CHOOSE_INDEP:
+    case CRUSH_RULE_CHOOSELEAF_FIRSTN:
+    case CRUSH_RULE_CHOOSELEAF_INDEP:
+      if (crush.get_rule_arg2(ruleno, s) > 0)
+	type = crush.get_rule_arg2(ruleno, s);
+      break;
+    }
+  }
+  return type;
+}
+
+void CrushTester::map_objects(const CrushWrapper& c, int ruleno, int nr,
+			      bool hash_pool, const vector<__u32>& weight,
+			      int first_x, int last_x,
+			      vector<vector<int>> *out) const
+{
+  out->clear();
+  if (last_x < first_x)
+    return;
+  const int num_objects = last_x - first_x + 1;
+  vector<int> xs(num_objects);
+  for (int i = 0; i < num_objects; i++) {
+    uint32_t real_x = first_x + i;
+    if (hash_pool && pool_id != -1) {
+      real_x = crush_hash32_2(CRUSH_HASH_RJENKINS1, real_x, (uint32_t)pool_id);
+    }
+    xs[i] = real_x;
+  }
+  out->resize(num_objects);
+
+  // the choose tries profile is shared by all the mappings
+  const int threads = output_choose_tries ? 1 :
+    std::max(1, std::min(num_threads, num_objects));
+  const int per_thread = (num_objects + threads - 1) / threads;
+  auto map_range = [&](int first) {
+    const int last = std::min(first + per_thread, num_objects);
+    vector<int> batch(xs.begin() + first, xs.begin() + last);
+    vector<vector<int>> batch_out;
+    c.do_rule_multi(ruleno, batch, &batch_out, nr, weight, 0);
+    std::move(batch_out.begin(), batch_out.end(), out->begin() + first);
+  };
+  vector<std::thread> mappers;
+  for (int t = 1; t < threads; t++) {
+    mappers.emplace_back(map_range, t * per_thread);
+  }
+  map_range(0);
+  for (auto& t : mappers) {
+    t.join();
+  }
+}
+
+void CrushTester::print_imbalance(int ruleno, int nr, const vector<int>& per,
+				  const vector<float>& expected)
+{
+  const int type = get_rule_failure_domain_type(ruleno);
+  // stored and expected placements, by failure domain
+  map<int, std::pair<int, float>> domains;
+  for (unsigned i = 0; i < per.size(); i++) {
+    if (expected[i] <= 0 && per[i] == 0)
+      continue;
+    int domain = i;
+    if (type > 0) {
+      domain = crush.get_parent_of_type(i, type, ruleno);
+      if (domain == 0)
+	continue;
+    }
+    domains[domain].first += per[i];
+    domains[domain].second += expected[i];
+  }
+  if (domains.empty())
+    return;
+
+  double sum = 0, sum_sq = 0;
+  double min_ratio = 0, max_ratio = 0;
+  int min_domain = 0, max_domain = 0;
+  int n = 0;
+  for (const auto& [domain, stored] : domains) {
+    if (stored.second <= 0)
+      continue;
+    const double ratio = stored.first / stored.second;
+    if (n == 0 || ratio < min_ratio) {
+      min_ratio = ratio;
+      min_domain = domain;
+    }
+    if (n == 0 || ratio > max_ratio) {
+      max_ratio = ratio;
+      max_domain = domain;
+    }
+    sum += ratio;
+    sum_sq += ratio * ratio;
+    n++;
+  }
+  if (n == 0)
+    return;
+  const double mean = sum / n;
+  const double stddev = std::sqrt(std::max(0.0, sum_sq / n - mean * mean));
+  err << "rule " << ruleno << " (" << crush.get_rule_name(ruleno)
+      << ") num_rep " << nr << " " << n << " "
+      << (type > 0 ? crush.get_type_name(type) : "device")
+      << " stored/expected: min " << min_ratio
+      << " (" << crush.get_item_name(min_domain) << ")"
+      << " max " << max_ratio
+      << " (" << crush.get_item_name(max_domain) << ")"
+      << " stddev " << stddev << std::endl;
+}
+
 int CrushTester::test()
 {
   if (min_rule < 0 || max_rule < 0) {
@@ -484,6 +598,11 @@ int CrushTester::test()
     min_x = 0;
     max_x = 1023;
   }
+  if (min_x > max_x) {
+    err << "min_x " << min_x << " is greater than max_x " << max_x
+	<< std::endl;
+    return -EINVAL;
+  }
 
   // initial osd weights
   vector<__u32> weight;
@@ -594,6 +713,10 @@ int CrushTester::test()
       for (unsigned i = 0; i < num_devices; i++)
         num_objects_expected[i] = (proportional_weights[i]*expected_objects);
 
+      // the crush mappings of x = mapped_min.., at most one batch at a time
+      vector<vector<int>> mapped;
+      int mapped_min = min_x;
+
       for (int current_batch = 0; current_batch < num_batches; current_batch++) {
         if (current_batch == (num_batches - 1)) {
           batch_max = max_x;
@@ -616,11 +739,13 @@ int CrushTester::test()
           if (use_crush) {
             if (output_mappings)
 	      err << "CRUSH"; // prepend CRUSH to placement output
-            uint32_t real_x = x;
-            if (pool_id != -1) {
-              real_x = crush_hash32_2(CRUSH_HASH_RJENKINS1, x, (uint32_t)pool_id);
+            if (x == batch_min || x - mapped_min == (int)mapped.size()) {
+              mapped_min = x;
+              map_objects(crush, r, nr, true, weight, x,
+                          x + std::min(batch_max - x, MAX_MAPPED_OBJECTS - 1),
+                          &mapped);
             }
-            crush.do_rule(r, real_x, out, nr, weight, 0);
+            out = std::move(mapped[x - mapped_min]);
           } else {
             if (output_mappings)
 	      err << "RNG"; // prepend RNG to placement output to denote simulation
@@ -705,6 +830,9 @@ int CrushTester::test()
         }
       }
 
+      if (output_imbalance)
+        print_imbalance(r, nr, per, num_objects_expected);
+
       string rule_tag = crush.get_rule_name(r);
 
       if (output_csv)
@@ -739,6 +867,11 @@ int CrushTester::compare(CrushWrapper& crush2)
     min_x = 0;
     max_x = 1023;
   }
+  if (min_x > max_x) {
+    err << "min_x " << min_x << " is greater than max_x " << max_x
+	<< std::endl;
+    return -EINVAL;
+  }
 
   // initial osd weights
   vector<__u32> weight;
@@ -779,15 +912,33 @@ int CrushTester::compare(CrushWrapper& crush2)
       maxr = crush.get_rule_mask_max_size(r);
     }
     int bad = 0;
+    // placements that are on a device in this map but not in the other
+    int64_t placed = 0, moved = 0;
     for (int nr = minr; nr <= maxr; nr++) {
-      for (int x = min_x; x <= max_x; ++x) {
-	vector<int> out;
-	crush.do_rule(r, x, out, nr, weight, 0);
-	vector<int> out2;
-	crush2.do_rule(r, x, out2, nr, weight, 0);
-	if (out != out2) {
-	  ++bad;
+      vector<vector<int>> outs, outs2;
+      for (int first = min_x; ; ) {
+	const int last = first + std::min(max_x - first, MAX_MAPPED_OBJECTS - 1);
+	map_objects(crush, r, nr, false, weight, first, last, &outs);
+	map_objects(crush2, r, nr, false, weight, first, last, &outs2);
+	for (unsigned i = 0; i < outs.size(); ++i) {
+	  const vector<int>& out = outs[i];
+	  const vector<int>& out2 = outs2[i];
+	  if (out != out2) {
+	    ++bad;
+	  }
+	  if (output_movement) {
+	    for (auto osd : out) {
+	      if (osd == CRUSH_ITEM_NONE)
+		continue;
+	      ++placed;
+	      if (std::find(out2.begin(), out2.end(), osd) == out2.end())
+		++moved;
+	    }
+	  }
 	}
+	if (last == max_x)
+	  break;
+	first = last + 1;
       }
     }
     if (bad) {
@@ -797,6 +948,11 @@ int CrushTester::compare(CrushWrapper& crush2)
     double ratio = (double)bad / (double)max;
     cout << "rule " << r << " had " << bad << "/" << max
 	 << " mismatched mappings (" << ratio << ")" << std::endl;
+    if (output_movement) {
+      cout << "rule " << r << " moved " << moved << "/" << placed
+	   << " placements (" << (placed ? (double)moved / placed : 0.0)
+	   << ")" << std::endl;
+    }
   }
   if (ret) {
     cerr << "warning: maps are NOT equivalent" << std::endl;
@@ -21,6 +21,7 @@ class CrushTester {
 
   int num_batches;
   bool use_crush;
+  int num_threads;
 
   float mark_down_device_ratio;
   float mark_down_bucket_ratio;
@@ -31,6 +32,8 @@ class CrushTester {
   bool output_mappings;
   bool output_bad_mappings;
   bool output_choose_tries;
+  bool output_imbalance;
+  bool output_movement;
 
   bool output_data_file;
   bool output_csv;
@@ -48,6 +51,31 @@ class CrushTester {
    */
   int get_maximum_affected_by_rule(int ruleno);
 
+  /*
+   * Get the type of the buckets the rule spreads replicas across, 0 if it
+   * picks devices directly.
+   */
+  int get_rule_failure_domain_type(int ruleno) const;
+
+  /*
+   * The most inputs mapped in one go, so a large x range isn't held in
+   * memory at once.
+   */
+  static const int MAX_MAPPED_OBJECTS = 1 << 16;
+
+  /*
+   * Map x = first_x..last_x with the rule, split across num_threads.
+   */
+  void map_objects(const CrushWrapper& c, int ruleno, int nr, bool hash_pool,
+		   const std::vector<__u32>& weight, int first_x, int last_x,
+		   std::vector<std::vector<int>> *out) const;
+
+  /*
+   * Print how far the failure domains are from their expected share.
+   */
+  void print_imbalance(int ruleno, int nr, const std::vector<int>& per,
+		       const std::vector<float>& expected);
+
   /*
    * for maps where in devices have non-sequential id numbers, return a mapping of device id
    * to a sequential id number. For example, if we have devices with id's 0 1 4 5 6 return a map
@@ -175,6 +203,7 @@ public:
       pool_id(-1),
       num_batches(1),
       use_crush(true),
+      num_threads(1),
       mark_down_device_ratio(0.0),
       mark_down_bucket_ratio(1.0),
       output_utilization(false),
@@ -183,6 +212,8 @@ public:
       output_mappings(false),
       output_bad_mappings(false),
       output_choose_tries(false),
+      output_imbalance(false),
+      output_movement(false),
       output_data_file(false),
       output_csv(false),
       output_data_file_name("")
@@ -252,6 +283,27 @@ public:
     return output_choose_tries;
   }
 
+  void set_output_imbalance(bool b) {
+    output_imbalance = b;
+  }
+  bool get_output_imbalance() const {
+    return output_imbalance;
+  }
+
+  void set_output_movement(bool b) {
+    output_movement = b;
+  }
+  bool get_output_movement() const {
+    return output_movement;
+  }
+
+  void set_num_threads(int n) {
+    num_threads = n;
+  }
+  int get_num_threads() const {
+    return num_threads;
+  }
+
   void set_batches(int b) {
     num_batches = b;
   }
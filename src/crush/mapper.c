@@ -1103,3 +1103,32 @@ int crush_do_rule(const struct crush_map *map,
 
 	return result_len;
 }
+
+/**
+ * crush_do_rule_multi - map several inputs with the same rule
+ * @map: the crush_map
+ * @ruleno: the rule id
+ * @xs: hash inputs
+ * @nx: number of hash inputs
+ * @results: pointer to nx result vectors of result_max items each
+ * @result_lens: pointer to nx result sizes
+ * @result_max: maximum result size
+ * @weight: weight vector (for map leaves)
+ * @weight_max: size of weight vector
+ * @cwin: Pointer to at least map->working_size bytes of memory, set up
+ *        by crush_init_workspace and shared by all the inputs.
+ */
+void crush_do_rule_multi(const struct crush_map *map,
+			 int ruleno, const int *xs, int nx,
+			 int *results, int *result_lens, int result_max,
+			 const __u32 *weight, int weight_max,
+			 void *cwin, const struct crush_choose_arg *choose_args)
+{
+	int i;
+
+	for (i = 0; i < nx; i++)
+		result_lens[i] = crush_do_rule(map, ruleno, xs[i],
+					       results + i * result_max,
+					       result_max, weight, weight_max,
+					       cwin, choose_args);
+}
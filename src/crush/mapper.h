@@ -78,6 +78,30 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/**
+ * Map each of __nx__ inputs with the same rule, as __crush_do_rule__
+ * would one at a time, sharing one workspace.  The mapping of
+ * __xs[i]__ is written to __results[i * result_max]__ and its length
+ * to __result_lens[i]__.  Setting up the workspace walks every bucket
+ * in the map, so mapping many inputs (all the PGs of a pool, say)
+ * through one call is much cheaper than initializing a workspace for
+ * each of them.
+ *
+ * @param xs the values to map
+ * @param nx the number of values in __xs__
+ * @param results an array of __nx__ * __result_max__ items
+ * @param result_lens an array of __nx__ result sizes
+ *
+ * The other parameters are as for __crush_do_rule__.
+ */
+extern void crush_do_rule_multi(const struct crush_map *map,
+				int ruleno,
+				const int *xs, int nx,
+				int *results, int *result_lens, int result_max,
+				const __u32 *weights, int weight_max,
+				void *cwin,
+				const struct crush_choose_arg *choose_args);
+
 /* Returns the exact amount of workspace that will need to be used
    for a given combination of crush_map and result_max. The caller can
    then allocate this much on its own, either on the stack, in a
@@ -208,6 +208,61 @@ int ErasureCode::encode_chunks(const set<int> &want_to_encode,
 {
   ceph_abort_msg("ErasureCode::encode_chunks not implemented");
 }
+
+int ErasureCode::encode_stripes(const set<int> &want_to_encode,
+                                unsigned stripe_width,
+                                const bufferlist &in,
+                                map<int, bufferlist> *encoded)
+{
+  ceph_assert(stripe_width > 0);
+  ceph_assert(in.length() % stripe_width == 0);
+  unsigned stripes = in.length() / stripe_width;
+  if (!supports_concatenated_stripes() || stripes <= 1) {
+    for (unsigned i = 0; i < stripes; i++) {
+      bufferlist stripe;
+      stripe.substr_of(in, i * stripe_width, stripe_width);
+      map<int, bufferlist> stripe_encoded;
+      int r = encode(want_to_encode, stripe, &stripe_encoded);
+      if (r)
+        return r;
+      for (auto& j : stripe_encoded)
+        (*encoded)[j.first].claim_append(j.second);
+    }
+    return 0;
+  }
+
+  // lay the chunks of all the stripes out one after the other, as
+  // encode_prepare() does for one stripe, and encode them in one go
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  unsigned blocksize = get_chunk_size(stripe_width);
+  vector<bufferptr> chunks;
+  chunks.reserve(k + m);
+  for (unsigned int i = 0; i < k + m; i++)
+    chunks.push_back(buffer::create_aligned(stripes * blocksize, SIMD_ALIGN));
+  auto p = in.begin();
+  for (unsigned s = 0; s < stripes; s++) {
+    unsigned left = stripe_width;
+    for (unsigned int i = 0; i < k; i++) {
+      unsigned len = std::min(left, blocksize);
+      char *dest = chunks[i].c_str() + s * blocksize;
+      p.copy(len, dest);
+      if (len < blocksize)
+        memset(dest + len, 0, blocksize - len);
+      left -= len;
+    }
+  }
+  for (unsigned int i = 0; i < k + m; i++)
+    (*encoded)[chunk_index(i)].push_back(std::move(chunks[i]));
+  int r = encode_chunks(want_to_encode, encoded);
+  if (r)
+    return r;
+  for (unsigned int i = 0; i < k + m; i++) {
+    if (want_to_encode.count(i) == 0)
+      encoded->erase(i);
+  }
+  return 0;
+}
  
 int ErasureCode::_decode(const set<int> &want_to_read,
 			 const map<int, bufferlist> &chunks,
@@ -261,6 +316,32 @@ int ErasureCode::decode_chunks(const set<int> &want_to_read,
   ceph_abort_msg("ErasureCode::decode_chunks not implemented");
 }
 
+int ErasureCode::decode_stripes(const set<int> &want_to_read,
+                                const map<int, bufferlist> &chunks,
+                                map<int, bufferlist> *decoded,
+                                int chunk_size)
+{
+  ceph_assert(!chunks.empty());
+  ceph_assert(chunk_size > 0);
+  unsigned length = chunks.begin()->second.length();
+  ceph_assert(length % chunk_size == 0);
+  if (supports_concatenated_stripes() || length <= (unsigned)chunk_size)
+    return decode(want_to_read, chunks, decoded, chunk_size);
+
+  for (unsigned off = 0; off < length; off += chunk_size) {
+    map<int, bufferlist> stripe;
+    for (auto& i : chunks)
+      stripe[i.first].substr_of(i.second, off, chunk_size);
+    map<int, bufferlist> stripe_decoded;
+    int r = decode(want_to_read, stripe, &stripe_decoded, chunk_size);
+    if (r)
+      return r;
+    for (auto& i : stripe_decoded)
+      (*decoded)[i.first].claim_append(i.second);
+  }
+  return 0;
+}
+
 int ErasureCode::parse(const ErasureCodeProfile &profile,
 		       ostream *ss)
 {
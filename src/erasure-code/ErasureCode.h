@@ -82,6 +82,17 @@ namespace ceph {
     int encode_chunks(const std::set<int> &want_to_encode,
                               std::map<int, bufferlist> *encoded) override;
 
+    int encode_stripes(const std::set<int> &want_to_encode,
+                       unsigned stripe_width,
+                       const bufferlist &in,
+                       std::map<int, bufferlist> *encoded) override;
+
+    /// true if encoding or decoding chunks made of several stripes'
+    /// chunks gives the chunks of each stripe, one after the other
+    virtual bool supports_concatenated_stripes() const {
+      return false;
+    }
+
     int decode(const std::set<int> &want_to_read,
                 const std::map<int, bufferlist> &chunks,
                 std::map<int, bufferlist> *decoded, int chunk_size) override;
@@ -94,6 +105,11 @@ namespace ceph {
                               const std::map<int, bufferlist> &chunks,
                               std::map<int, bufferlist> *decoded) override;
 
+    int decode_stripes(const std::set<int> &want_to_read,
+                       const std::map<int, bufferlist> &chunks,
+                       std::map<int, bufferlist> *decoded,
+                       int chunk_size) override;
+
     const std::vector<int> &get_chunk_mapping() const override;
 
     int to_mapping(const ErasureCodeProfile &profile,
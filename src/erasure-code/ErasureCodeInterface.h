@@ -370,6 +370,26 @@ namespace ceph {
     virtual int encode_chunks(const std::set<int> &want_to_encode,
                               std::map<int, bufferlist> *encoded) = 0;
 
+    /**
+     * Encode **in**, made of stripes of **stripe_width** bytes each,
+     * as if calling **encode** on every stripe in turn and appending
+     * the chunks of each to the chunks of the previous ones, so that
+     * every buffer in **encoded** is made of one chunk per stripe.
+     *
+     * The plugins whose coding works the same way at any offset of a
+     * chunk encode all the stripes in a single pass.
+     *
+     * @param [in] want_to_encode chunk indexes to be encoded
+     * @param [in] stripe_width size of a stripe
+     * @param [in] in data to be encoded, a multiple of **stripe_width**
+     * @param [out] encoded map chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_stripes(const std::set<int> &want_to_encode,
+                               unsigned stripe_width,
+                               const bufferlist &in,
+                               std::map<int, bufferlist> *encoded) = 0;
+
     /**
      * Decode the **chunks** and store at least **want_to_read**
      * chunks in **decoded**.
@@ -412,6 +432,22 @@ namespace ceph {
                               const std::map<int, bufferlist> &chunks,
                               std::map<int, bufferlist> *decoded) = 0;
 
+    /**
+     * Decode **chunks** made of one chunk of **chunk_size** bytes per
+     * stripe, as if calling **decode** on every stripe in turn and
+     * appending the chunks decoded for each.
+     *
+     * @param [in] want_to_read chunk indexes to be decoded
+     * @param [in] chunks map chunk indexes to the chunks of all stripes
+     * @param [out] decoded map chunk indexes to chunk data
+     * @param [in] chunk_size chunk size
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int decode_stripes(const std::set<int> &want_to_read,
+                               const std::map<int, bufferlist> &chunks,
+                               std::map<int, bufferlist> *decoded,
+                               int chunk_size) = 0;
+
     /**
      * Return the ordered list of chunks or an empty vector
      * if no remapping is necessary.
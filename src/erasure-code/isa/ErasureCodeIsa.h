@@ -76,6 +76,10 @@ public:
   int encode_chunks(const std::set<int> &want_to_encode,
                     std::map<int, ceph::buffer::list> *encoded) override;
 
+  bool supports_concatenated_stripes() const override {
+    return true;
+  }
+
   int decode_chunks(const std::set<int> &want_to_read,
                             const std::map<int, ceph::buffer::list> &chunks,
                             std::map<int, ceph::buffer::list> *decoded) override;
@@ -14,6 +14,9 @@
 #include "xor_op.h"
 #include <stdio.h>
 #include <string.h>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
 #include "arch/intel.h"
 
 #include "include/ceph_assert.h"
@@ -90,16 +93,22 @@ region_xor(unsigned char** src,
       is_aligned(parity, EC_ISA_VECTOR_OP_WORDSIZE)) {
 
 #ifdef __x86_64__
-    if (ceph_arch_intel_sse2) {
-      // -----------------------------
-      // use SSE2 region xor function
-      // -----------------------------
+    if (ceph_arch_intel_avx512 || ceph_arch_intel_avx2 ||
+        ceph_arch_intel_sse2) {
+      // -------------------------------------------------
+      // use the widest region xor function the cpu allows
+      // -------------------------------------------------
       unsigned region_size =
         (size / EC_ISA_VECTOR_SSE2_WORDSIZE) * EC_ISA_VECTOR_SSE2_WORDSIZE;
 
       size_left -= region_size;
       // 64-byte region xor
-      region_sse2_xor((char**) src, (char*) parity, src_size, region_size);
+      if (ceph_arch_intel_avx512)
+        region_avx512_xor((char**) src, (char*) parity, src_size, region_size);
+      else if (ceph_arch_intel_avx2)
+        region_avx2_xor((char**) src, (char*) parity, src_size, region_size);
+      else
+        region_sse2_xor((char**) src, (char*) parity, src_size, region_size);
     } else
 #endif
     {
@@ -181,3 +190,76 @@ region_sse2_xor(char** src,
 #endif // __x86_64__
   return;
 }
+
+// -----------------------------------------------------------------------------
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+#endif
+void
+// -----------------------------------------------------------------------------
+region_avx2_xor(char** src,
+                char* parity,
+                int src_size,
+                unsigned size)
+// -----------------------------------------------------------------------------
+{
+#ifdef __x86_64__
+  ceph_assert(!(size % EC_ISA_VECTOR_SSE2_WORDSIZE));
+  for (unsigned i = 0; i < size; i += EC_ISA_VECTOR_SSE2_WORDSIZE) {
+    __m256i p0 = _mm256_loadu_si256((const __m256i*) (src[0] + i));
+    __m256i p1 = _mm256_loadu_si256((const __m256i*) (src[0] + i + 32));
+    for (int d = 1; d < src_size; d++) {
+      p0 = _mm256_xor_si256(p0,
+                            _mm256_loadu_si256((const __m256i*) (src[d] + i)));
+      p1 = _mm256_xor_si256(p1,
+                            _mm256_loadu_si256((const __m256i*) (src[d] + i + 32)));
+    }
+    _mm256_storeu_si256((__m256i*) (parity + i), p0);
+    _mm256_storeu_si256((__m256i*) (parity + i + 32), p1);
+  }
+#endif // __x86_64__
+}
+
+// -----------------------------------------------------------------------------
+
+#ifdef __x86_64__
+__attribute__((target("avx512f")))
+#endif
+void
+// -----------------------------------------------------------------------------
+region_avx512_xor(char** src,
+                  char* parity,
+                  int src_size,
+                  unsigned size)
+// -----------------------------------------------------------------------------
+{
+#ifdef __x86_64__
+  ceph_assert(!(size % EC_ISA_VECTOR_SSE2_WORDSIZE));
+  for (unsigned i = 0; i < size; i += EC_ISA_VECTOR_SSE2_WORDSIZE) {
+    __m512i p = _mm512_loadu_si512(src[0] + i);
+    for (int d = 1; d < src_size; d++) {
+      p = _mm512_xor_si512(p, _mm512_loadu_si512(src[d] + i));
+    }
+    _mm512_storeu_si512(parity + i, p);
+  }
+#endif // __x86_64__
+}
+
+// -----------------------------------------------------------------------------
+
+const char*
+// -----------------------------------------------------------------------------
+region_xor_kernel()
+// -----------------------------------------------------------------------------
+{
+#ifdef __x86_64__
+  if (ceph_arch_intel_avx512)
+    return "avx512";
+  if (ceph_arch_intel_avx2)
+    return "avx2";
+  if (ceph_arch_intel_sse2)
+    return "sse2";
+#endif
+  return "vector";
+}
@@ -83,5 +83,25 @@ region_sse2_xor(char** src /* array of 64-byte aligned source pointer to xor */,
                 int src_size /* size of the source pointer array */,
                 unsigned size /* size of the region to xor */);
 
+// -------------------------------------------------------------------------
+// the same using AVX2 or AVX-512 operations, if the cpu has them
+// -------------------------------------------------------------------------
+void
+region_avx2_xor(char** src /* array of 16-byte aligned source pointer to xor */,
+                char* parity /* 16-byte aligned output pointer containing the parity */,
+                int src_size /* size of the source pointer array */,
+                unsigned size /* size of the region to xor, a multiple of 64 */);
+
+void
+region_avx512_xor(char** src /* array of 16-byte aligned source pointer to xor */,
+                  char* parity /* 16-byte aligned output pointer containing the parity */,
+                  int src_size /* size of the source pointer array */,
+                  unsigned size /* size of the region to xor, a multiple of 64 */);
+
+// -------------------------------------------------------------------------
+// name of the vector extension region_xor uses on this cpu
+// -------------------------------------------------------------------------
+const char*
+region_xor_kernel();
 
 #endif // EC_ISA_XOR_OP_H
@@ -400,6 +400,11 @@ inline namespace v14_2_0 {
 
     ~ptr_node() = default;
 
+    // nodes come and go with every append and splice; they are
+    // recycled through a small per-thread cache
+    static void* operator new(size_t size);
+    static void operator delete(void* p);
+
     static std::unique_ptr<ptr_node, disposer>
     create(ceph::unique_leakable_ptr<raw> r) {
       return create_hypercombined(std::move(r));
@@ -1108,6 +1113,9 @@ inline namespace v14_2_0 {
 					 unsigned max_buffers = 0);
     bool rebuild_page_aligned();
 
+    /// make sure the append buffer has prealloc bytes free, so the next
+    /// prealloc bytes of appends (e.g. encoding a whole object) take no
+    /// allocation
     void reserve(size_t prealloc);
 
     // assignment-op with move semantics
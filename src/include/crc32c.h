@@ -50,6 +50,21 @@ static inline uint32_t ceph_crc32c(uint32_t crc, unsigned char const *data, unsi
   return ceph_crc32c_func(crc, data, length);
 }
 
+/**
+ * calculate crc32c of several buffers of the same length
+ *
+ * Buffers are hashed several at a time where the CPU allows it; the
+ * results are the same as calling ceph_crc32c() on each.
+ *
+ * @param crc initial value for every buffer
+ * @param data n pointers to buffers, none of them NULL
+ * @param n number of buffers
+ * @param length length of each buffer
+ * @param out n results
+ */
+void ceph_crc32c_multi(uint32_t crc, unsigned char const * const *data,
+		       unsigned n, unsigned length, uint32_t *out);
+
 #ifdef __cplusplus
 }
 #endif
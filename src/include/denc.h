@@ -921,11 +921,26 @@ struct denc_traits<
 };
 
 namespace _denc {
+  // on little-endian hosts a vector of integers is encoded just the way it
+  // is laid out in memory, so it can be copied in one go instead of an
+  // element at a time.
+  template<typename Container, typename T>
+  inline constexpr bool is_bulk_copyable_v =
+#if defined(CEPH_LITTLE_ENDIAN)
+    std::is_same_v<Container,
+		   std::vector<T, typename Container::allocator_type>> &&
+    ((std::is_integral_v<T> && !std::is_same_v<T, bool>) ||
+     is_any_of<T, ceph_le64, ceph_le32, ceph_le16>);
+#else
+    false;
+#endif
+
   template<template<class...> class C, typename Details, typename ...Ts>
   struct container_base {
   private:
     using container = C<Ts...>;
     using T = typename Details::T;
+    static constexpr bool bulk = is_bulk_copyable_v<container, T>;
 
   public:
     using traits = denc_traits<T>;
@@ -989,6 +1004,13 @@ namespace _denc {
     // nohead
     static void encode_nohead(const container& s, ceph::buffer::list::contiguous_appender& p,
 			      uint64_t f = 0) {
+      if constexpr (bulk) {
+	const size_t len = s.size() * sizeof(T);
+	if (len) {
+	  memcpy(p.get_pos_add(len), s.data(), len);
+	}
+	return;
+      }
       for (const T& e : s) {
         if constexpr (traits::featured) {
           denc(e, p, f);
@@ -1000,6 +1022,16 @@ namespace _denc {
     static void decode_nohead(size_t num, container& s,
 			      ceph::buffer::ptr::const_iterator& p,
 			      uint64_t f=0) {
+      if constexpr (bulk) {
+	// get_pos_add() checks the length before the vector grows
+	const size_t len = num * sizeof(T);
+	const char *pos = p.get_pos_add(len);
+	s.resize(num);
+	if (len) {
+	  memcpy(s.data(), pos, len);
+	}
+	return;
+      }
       s.clear();
       Details::reserve(s, num);
       while (num--) {
@@ -1012,6 +1044,17 @@ namespace _denc {
     static std::enable_if_t<!!sizeof(U) && !need_contiguous>
     decode_nohead(size_t num, container& s,
 		  ceph::buffer::list::const_iterator& p) {
+      if constexpr (bulk) {
+	const size_t len = num * sizeof(T);
+	if (len > p.get_remaining()) {
+	  throw ceph::buffer::end_of_buffer();
+	}
+	s.resize(num);
+	if (len) {
+	  p.copy(len, reinterpret_cast<char*>(s.data()));
+	}
+	return;
+      }
       s.clear();
       Details::reserve(s, num);
       while (num--) {
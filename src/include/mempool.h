@@ -24,6 +24,7 @@
 #include <mutex>
 #include <atomic>
 #include <typeinfo>
+#include <sched.h>
 #include <boost/container/flat_set.hpp>
 #include <boost/container/flat_map.hpp>
 
@@ -247,6 +248,17 @@ public:
   void adjust_count(ssize_t items, ssize_t bytes);
 
   shard_t* pick_a_shard() {
+#ifdef __linux__
+    // The cpu we run on, so that the threads running at the same time
+    // use different shards. pthread_self() addresses are a thread stack
+    // size apart, so they mostly hash to the same shard. A thread moving
+    // to another cpu before it updates the shard only costs a cacheline
+    // bounce.
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+      return &shard[cpu & (num_shards - 1)];
+    }
+#endif
     // Dirt cheap, see:
     //   http://fossies.org/dox/glibc-2.24/pthread__self_8c_source.html
     size_t me = (size_t)pthread_self();
@@ -355,7 +355,8 @@ extern int ceph_release_from_features(uint64_t features);
 	f(PG_HITSET_GET, __CEPH_OSD_OP(RD, PG, 4),	"pg-hitset-get")    \
 	f(PGNLS,	__CEPH_OSD_OP(RD, PG, 5),	"pgnls")	    \
 	f(PGNLS_FILTER,	__CEPH_OSD_OP(RD, PG, 6),	"pgnls-filter")     \
-	f(SCRUBLS, __CEPH_OSD_OP(RD, PG, 7), "scrubls")
+	f(SCRUBLS, __CEPH_OSD_OP(RD, PG, 7), "scrubls")		    \
+	f(PG_OMAP_READ,	__CEPH_OSD_OP(RD, PG, 8),	"pg-omap-read")
 
 enum {
 #define GENERATE_ENUM_ENTRY(op, opcode, str)	CEPH_OSD_OP_##op = (opcode),
@@ -519,6 +520,12 @@ enum {
 	CEPH_OSD_WATCH_OP_PING = 7,
 };
 
+enum {
+	/* complete once sent to the connected watchers, without waiting
+	   for their acks */
+	CEPH_OSD_NOTIFY_FLAG_NO_ACK = 1,
+};
+
 enum {
 	CEPH_OSD_CHECKSUM_OP_TYPE_XXHASH32 = 0,
 	CEPH_OSD_CHECKSUM_OP_TYPE_XXHASH64 = 1,
@@ -971,6 +971,22 @@ inline namespace v14_2_0 {
     int hit_set_get(uint32_t hash, AioCompletion *c, time_t stamp,
 		    bufferlist *pbl);
 
+    /**
+     * Read the omap of many objects in one op
+     *
+     * The objects must all be in the PG of the first one; the results
+     * of the others are -EXDEV. The vals read are bounded over all of
+     * the objects, so check omap_read_result_t::more and read on from
+     * the last val of the objects that have it.
+     *
+     * @param c [in] completion
+     * @param reads [in] what to read from each object
+     * @param results [out] the results, in the order of the reads
+     */
+    int aio_pg_omap_read(AioCompletion *c,
+			 const std::vector<omap_read_t>& reads,
+			 std::vector<omap_read_result_t> *results);
+
     uint64_t get_last_version();
 
     int aio_read(const std::string& oid, AioCompletion *c,
@@ -1187,6 +1203,18 @@ inline namespace v14_2_0 {
                    bufferlist& bl,         ///< optional broadcast payload
                    uint64_t timeout_ms,    ///< timeout (in ms)
                    bufferlist *pbl);       ///< reply buffer
+    /**
+     * Send a notify event to watchers without waiting for their acks
+     *
+     * The notify completes once the OSD has sent it to the watchers that
+     * are connected, e.g. for cache invalidations that are best effort.
+     * The reply payload is encoded as for notify2, with no acks, and the
+     * watchers it could not be sent to listed as timeouts.  Older OSDs
+     * wait for the acks as notify2 does.
+     */
+    int notify_no_ack(const std::string& o, ///< object
+		      bufferlist& bl,       ///< optional broadcast payload
+		      bufferlist *pbl);     ///< reply buffer
 
     int list_watchers(const std::string& o, std::list<obj_watch_t> *out_watchers);
     int list_snaps(const std::string& o, snap_set_t *out_snaps);
@@ -314,6 +314,25 @@ struct inconsistent_snapset_t {
   }
 };
 
+/**
+ * The omap to read from one object of a batch, see IoCtx::aio_pg_omap_read()
+ */
+struct omap_read_t {
+  std::string oid;
+  std::string locator;          ///< empty for the IoCtx's own locator
+  bool want_header = false;
+  std::string start_after;
+  std::string filter_prefix;
+  uint64_t max_return = 0;      ///< 0 to read no vals
+};
+
+struct omap_read_result_t {
+  int rval = 0;                 ///< -ENOENT if the object doesn't exist, etc.
+  ceph::bufferlist header;
+  std::map<std::string, ceph::bufferlist> vals;
+  bool more = false;            ///< the vals were cut short, read on from the last
+};
+
 /**
  * @var all_nspaces
  * Pass as nspace argument to IoCtx::set_namespace()
@@ -233,8 +233,7 @@ bool ObjectRecorder::flush_appends(bool force) {
   if (m_append_buffers.empty() ||
       (!force &&
        m_size + m_pending_bytes < m_soft_max_size &&
-       (m_flush_interval > 0 && m_append_buffers.size() < m_flush_interval) &&
-       (m_flush_bytes > 0 && m_pending_bytes < m_flush_bytes))) {
+       !is_batch_full(m_append_buffers.size(), m_pending_bytes))) {
     return false;
   }
 
@@ -245,6 +244,15 @@ bool ObjectRecorder::flush_appends(bool force) {
   return true;
 }
 
+bool ObjectRecorder::is_batch_full(size_t count, uint64_t bytes) const {
+  if (m_flush_interval == 0 && m_flush_bytes == 0) {
+    // only the flush age (if any) batches appends
+    return m_flush_age == 0;
+  }
+  return ((m_flush_interval > 0 && count >= m_flush_interval) ||
+          (m_flush_bytes > 0 && bytes >= m_flush_bytes));
+}
+
 void ObjectRecorder::handle_append_flushed(uint64_t tid, int r) {
   ldout(m_cct, 10) << __func__ << ": " << m_oid << " tid=" << tid
                    << ", r=" << r << dendl;
@@ -382,8 +390,23 @@ void ObjectRecorder::send_appends_aio() {
       return;
     }
 
-    if (m_max_in_flight_appends != 0 &&
-        m_in_flight_tids.size() >= m_max_in_flight_appends) {
+    // when batching is configured, appends queued behind an in-flight
+    // append are held back until it completes (or the batch is full) so
+    // that they go out as a single op
+    uint32_t max_in_flight_appends = m_max_in_flight_appends;
+    if (max_in_flight_appends == 0 &&
+        (m_flush_interval > 0 || m_flush_bytes > 0 || m_flush_age > 0)) {
+      uint64_t pending_bytes = 0;
+      for (auto &append_buffer : m_pending_buffers) {
+        pending_bytes += append_buffer.second.length();
+      }
+      if (!is_batch_full(m_pending_buffers.size(), pending_bytes)) {
+        max_in_flight_appends = 1;
+      }
+    }
+
+    if (max_in_flight_appends != 0 &&
+        m_in_flight_tids.size() >= max_in_flight_appends) {
       ldout(m_cct, 20) << __func__ << ": " << m_oid
                        << " max in flight appends reached" << dendl;
       return;
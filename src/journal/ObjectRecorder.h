@@ -154,6 +154,7 @@ private:
 
   bool append(const AppendBuffer &append_buffer, bool *schedule_append);
   bool flush_appends(bool force);
+  bool is_batch_full(size_t count, uint64_t bytes) const;
   void handle_append_flushed(uint64_t tid, int r);
   void append_overflowed();
   void send_appends(AppendBuffers *append_buffers);
@@ -7,6 +7,7 @@
 #include <ostream>
 #include <set>
 #include <map>
+#include <optional>
 #include <string>
 #include <boost/scoped_ptr.hpp>
 #include "include/encoding.h"
@@ -26,13 +27,16 @@ public:
   /*
    *  See RocksDB's definition of a column family(CF) and how to use it.
    *  The interfaces of KeyValueDB is extended, when a column family is created.
-   *  Prefix will be the name of column family to use.
+   *  Prefix will be the name of column family to use.  A prefix may also
+   *  be spread over several column families by key hash (shards > 1).
    */
   struct ColumnFamily {
     string name;      //< name of this individual column family
     string option;    //< configure option string for this CF
-    ColumnFamily(const string &name, const string &option)
-      : name(name), option(option) {}
+    unsigned shards;  //< number of hashed column families for this prefix
+    ColumnFamily(const string &name, const string &option,
+		 unsigned shards = 1)
+      : name(name), option(option), shards(shards) {}
   };
 
   class TransactionImpl {
@@ -171,6 +175,13 @@ public:
   /// Try to repair K/V database. leveldb and rocksdb require that database must be not opened.
   virtual int repair(std::ostream &out) { return 0; }
 
+  /// Move all keys into the given column family layout.  The database
+  /// must be closed and reopened afterwards.
+  virtual int reshard(const std::vector<ColumnFamily>& cfs,
+		      std::ostream &out) {
+    return -EOPNOTSUPP;
+  }
+
   virtual Transaction get_transaction() = 0;
   virtual int submit_transaction(Transaction) = 0;
   virtual int submit_transaction_sync(Transaction t) {
@@ -239,6 +250,16 @@ public:
   };
   typedef std::shared_ptr< IteratorImpl > Iterator;
 
+  /// key range (within a prefix) an iterator will never leave.  Backends
+  /// can stop at the bound instead of stepping over deleted keys past it.
+  /// The scan hints may be ignored.
+  struct IteratorBounds {
+    std::optional<std::string> lower_bound;  ///< inclusive
+    std::optional<std::string> upper_bound;  ///< exclusive
+    uint64_t readahead = 0;  ///< bytes to read ahead for long scans, 0 = none
+    bool fill_cache = true;  ///< false for one-off scans
+  };
+
   // This is the low-level iterator implemented by the underlying KV store.
   class WholeSpaceIteratorImpl {
   public:
@@ -331,7 +352,18 @@ public:
       prefix,
       get_wholespace_iterator());
   }
+  virtual Iterator get_iterator(const std::string &prefix,
+				const IteratorBounds& bounds) {
+    return get_iterator(prefix);
+  }
 
+protected:
+  Iterator make_prefix_iterator(const std::string &prefix,
+				WholeSpaceIterator iter) {
+    return std::make_shared<PrefixIteratorImpl>(prefix, iter);
+  }
+
+public:
   void add_column_family(const std::string& cf_name, void *handle) {
     cf_handles.insert(std::make_pair(cf_name, handle));
   }
@@ -25,6 +25,7 @@ using std::string;
 #include "include/str_list.h"
 #include "include/stringify.h"
 #include "include/str_map.h"
+#include "include/ceph_hash.h"
 #include "KeyValueDB.h"
 #include "RocksDBStore.h"
 
@@ -77,6 +78,9 @@ public:
     for (auto& p : store.cf_handles) {
       names.erase(p.first);
     }
+    for (auto& p : store.cf_shards) {
+      names.erase(p.first);
+    }
     for (auto& p : names) {
       store.assoc_name += '.';
       store.assoc_name += p.first;
@@ -310,6 +314,73 @@ int RocksDBStore::install_cf_mergeop(
   return 0;
 }
 
+void RocksDBStore::add_cf_handle(
+  const string &cf_name,
+  rocksdb::ColumnFamilyHandle *cf)
+{
+  string prefix;
+  unsigned shard;
+  if (parse_cf_shard_name(cf_name, &prefix, &shard)) {
+    auto& shards = cf_shards[prefix];
+    if (shards.size() <= shard) {
+      shards.resize(shard + 1, nullptr);
+    }
+    shards[shard] = cf;
+  } else {
+    add_column_family(cf_name, static_cast<void*>(cf));
+  }
+}
+
+bool RocksDBStore::parse_cf_shard_name(
+  const string &name,
+  string *prefix,
+  unsigned *shard)
+{
+  auto pos = name.rfind('-');
+  if (pos == string::npos || pos == 0 || pos + 1 == name.size()) {
+    return false;
+  }
+  unsigned v = 0;
+  for (auto i = pos + 1; i < name.size(); ++i) {
+    if (name[i] < '0' || name[i] > '9') {
+      return false;
+    }
+    v = v * 10 + (name[i] - '0');
+  }
+  *prefix = name.substr(0, pos);
+  *shard = v;
+  return true;
+}
+
+rocksdb::ColumnFamilyHandle *RocksDBStore::get_cf_handle(
+  const string &prefix,
+  const char *key, size_t keylen)
+{
+  if (!cf_shards.empty()) {
+    auto p = cf_shards.find(prefix);
+    if (p != cf_shards.end()) {
+      auto& shards = p->second;
+      return shards[ceph_str_hash_rjenkins(key, keylen) % shards.size()];
+    }
+  }
+  return get_cf_handle(prefix);
+}
+
+std::vector<rocksdb::ColumnFamilyHandle*> RocksDBStore::get_cf_handles(
+  const string &prefix)
+{
+  auto p = cf_shards.find(prefix);
+  if (p != cf_shards.end()) {
+    return p->second;
+  }
+  std::vector<rocksdb::ColumnFamilyHandle*> cfs;
+  auto cf = get_cf_handle(prefix);
+  if (cf) {
+    cfs.push_back(cf);
+  }
+  return cfs;
+}
+
 int RocksDBStore::create_and_open(ostream &out,
 				  const vector<ColumnFamily>& cfs)
 {
@@ -393,7 +464,10 @@ int RocksDBStore::load_rocksdb_options(bool create_if_missing, rocksdb::Options&
     bbt_opts.block_cache = rocksdb_cache::NewBinnedLRUCache(
       cct,
       block_cache_size,
-      g_conf()->rocksdb_cache_shard_bits);
+      g_conf()->rocksdb_cache_shard_bits,
+      false,
+      0.0,
+      cct->_conf.get_val<double>("rocksdb_cache_probation_ratio"));
   } else if (g_conf()->rocksdb_cache_type == "lru") {
     bbt_opts.block_cache = rocksdb::NewLRUCache(
       block_cache_size,
@@ -497,15 +571,19 @@ int RocksDBStore::do_open(ostream &out,
 	  return -EINVAL;
 	}
 	install_cf_mergeop(p.name, &cf_opt);
-	rocksdb::ColumnFamilyHandle *cf;
-	status = db->CreateColumnFamily(cf_opt, p.name, &cf);
-	if (!status.ok()) {
-	  derr << __func__ << " Failed to create rocksdb column family: "
-	       << p.name << dendl;
-	  return -EINVAL;
+	for (unsigned i = 0; i < std::max(p.shards, 1u); ++i) {
+	  string cf_name =
+	    p.shards > 1 ? get_cf_shard_name(p.name, i) : p.name;
+	  rocksdb::ColumnFamilyHandle *cf;
+	  status = db->CreateColumnFamily(cf_opt, cf_name, &cf);
+	  if (!status.ok()) {
+	    derr << __func__ << " Failed to create rocksdb column family: "
+		 << cf_name << dendl;
+	    return -EINVAL;
+	  }
+	  // store the new CF handle
+	  add_cf_handle(cf_name, cf);
 	}
-	// store the new CF handle
-	add_column_family(p.name, static_cast<void*>(cf));
       }
     }
     default_cf = db->DefaultColumnFamily();
@@ -532,15 +610,32 @@ int RocksDBStore::do_open(ostream &out,
       // we cannot change column families for a created database.  so, map
       // what options we are given to whatever cf's already exist.
       std::vector<rocksdb::ColumnFamilyDescriptor> column_families;
+      // the shard count of each sharded prefix in the db
+      map<string, unsigned> existing_shards;
+      bool sharding_mismatch = false;
       for (auto& n : existing_cfs) {
 	// copy default CF settings, block cache, merge operators as
 	// the base for new CF
 	rocksdb::ColumnFamilyOptions cf_opt(opt);
+	// shards of a prefix share the prefix' options and merge operator
+	string prefix = n;
+	unsigned shard;
+	bool sharded = parse_cf_shard_name(n, &prefix, &shard);
+	if (sharded) {
+	  existing_shards[prefix] = std::max(existing_shards[prefix], shard + 1);
+	}
 	bool found = false;
 	if (cfs) {
 	  for (auto& i : *cfs) {
-	    if (i.name == n) {
+	    if (i.name == prefix) {
 	      found = true;
+	      if ((i.shards > 1) != sharded ||
+		  (sharded && shard >= i.shards)) {
+		derr << __func__ << " column family '" << n
+		     << "' does not match configured sharding of '"
+		     << i.name << "'" << dendl;
+		sharding_mismatch = true;
+	      }
 	      status = rocksdb::GetColumnFamilyOptionsFromString(
 		cf_opt, i.option, &cf_opt);
 	      if (!status.ok()) {
@@ -552,7 +647,7 @@ int RocksDBStore::do_open(ostream &out,
 	  }
 	}
 	if (n != rocksdb::kDefaultColumnFamilyName) {
-	  install_cf_mergeop(n, &cf_opt);
+	  install_cf_mergeop(prefix, &cf_opt);
 	}
 	column_families.push_back(rocksdb::ColumnFamilyDescriptor(n, cf_opt));
 	if (!found && n != rocksdb::kDefaultColumnFamilyName) {
@@ -560,6 +655,24 @@ int RocksDBStore::do_open(ostream &out,
 		  << "' exists but not expected" << dendl;
 	}
       }
+      if (cfs) {
+	for (auto& i : *cfs) {
+	  auto p = existing_shards.find(i.name);
+	  if (p != existing_shards.end() && i.shards > 1 &&
+	      p->second != i.shards) {
+	    derr << __func__ << " prefix '" << i.name << "' has " << p->second
+		 << " column families, configured " << i.shards << dendl;
+	    sharding_mismatch = true;
+	  }
+	}
+      }
+      // the db keeps its own layout, not the configured one; only open it
+      // like that to reshard it
+      if (sharding_mismatch && !kv_options.count("allow_sharding_mismatch")) {
+	derr << __func__ << " column families do not match the configured "
+	     << "layout; reshard to apply it" << dendl;
+	return -EINVAL;
+      }
       std::vector<rocksdb::ColumnFamilyHandle*> handles;
       if (open_readonly) {
         status = rocksdb::DB::OpenForReadOnly(rocksdb::DBOptions(opt),
@@ -578,7 +691,16 @@ int RocksDBStore::do_open(ostream &out,
 	  default_cf = handles[i];
 	  must_close_default_cf = true;
 	} else {
-	  add_column_family(existing_cfs[i], static_cast<void*>(handles[i]));
+	  add_cf_handle(existing_cfs[i], handles[i]);
+	}
+      }
+      for (auto& p : cf_shards) {
+	for (unsigned i = 0; i < p.second.size(); ++i) {
+	  if (!p.second[i]) {
+	    derr << __func__ << " column family '"
+		 << get_cf_shard_name(p.first, i) << "' is missing" << dendl;
+	    return -EINVAL;
+	  }
 	}
       }
     }
@@ -634,6 +756,12 @@ RocksDBStore::~RocksDBStore()
       static_cast<rocksdb::ColumnFamilyHandle*>(p.second));
     p.second = nullptr;
   }
+  for (auto& p : cf_shards) {
+    for (auto& cf : p.second) {
+      db->DestroyColumnFamilyHandle(cf);
+      cf = nullptr;
+    }
+  }
   if (must_close_default_cf) {
     db->DestroyColumnFamilyHandle(default_cf);
     must_close_default_cf = false;
@@ -682,6 +810,156 @@ int RocksDBStore::repair(std::ostream &out)
   }
 }
 
+int RocksDBStore::reshard(const vector<ColumnFamily>& cfs, std::ostream &out)
+{
+  ceph_assert(db);
+  rocksdb::Options opt;
+  int r = load_rocksdb_options(false, opt);
+  if (r) {
+    out << "load rocksdb options failed" << std::endl;
+    return r;
+  }
+
+  // every CF currently open, by name
+  std::map<string, rocksdb::ColumnFamilyHandle*> existing;
+  for (auto& p : cf_handles) {
+    existing[p.first] = static_cast<rocksdb::ColumnFamilyHandle*>(p.second);
+  }
+  for (auto& p : cf_shards) {
+    for (unsigned i = 0; i < p.second.size(); ++i) {
+      existing[get_cf_shard_name(p.first, i)] = p.second[i];
+    }
+  }
+
+  // open or create the target layout
+  std::map<string, rocksdb::ColumnFamilyHandle*> target_names;
+  std::unordered_map<string,
+		     std::vector<rocksdb::ColumnFamilyHandle*>> target;
+  for (auto& p : cfs) {
+    auto& shards = target[p.name];
+    for (unsigned i = 0; i < std::max(p.shards, 1u); ++i) {
+      string cf_name = p.shards > 1 ? get_cf_shard_name(p.name, i) : p.name;
+      rocksdb::ColumnFamilyHandle *cf;
+      auto e = existing.find(cf_name);
+      if (e != existing.end()) {
+	cf = e->second;
+      } else {
+	rocksdb::ColumnFamilyOptions cf_opt(opt);
+	auto status = rocksdb::GetColumnFamilyOptionsFromString(
+	  cf_opt, p.option, &cf_opt);
+	if (!status.ok()) {
+	  out << "invalid column family options for " << p.name << ": "
+	      << p.option << std::endl;
+	  return -EINVAL;
+	}
+	install_cf_mergeop(p.name, &cf_opt);
+	status = db->CreateColumnFamily(cf_opt, cf_name, &cf);
+	if (!status.ok()) {
+	  out << "failed to create column family " << cf_name << ": "
+	      << status.ToString() << std::endl;
+	  return -EINVAL;
+	}
+	out << "created column family " << cf_name << std::endl;
+      }
+      shards.push_back(cf);
+      target_names[cf_name] = cf;
+    }
+  }
+
+  // move every key whose column family changes
+  const uint64_t batch_bytes = 64 << 20;
+  rocksdb::WriteOptions woptions;
+  woptions.sync = true;
+  uint64_t moved = 0;
+  auto move_cf = [&](rocksdb::ColumnFamilyHandle *from,
+		     const string *cf_prefix) -> int {
+    std::unique_ptr<rocksdb::Iterator> it(
+      db->NewIterator(rocksdb::ReadOptions(), from));
+    rocksdb::WriteBatch bat;
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+      string prefix, key;
+      if (cf_prefix) {
+	prefix = *cf_prefix;
+	key = it->key().ToString();
+      } else if (split_key(it->key(), &prefix, &key) < 0) {
+	continue;
+      }
+      rocksdb::ColumnFamilyHandle *to = default_cf;
+      auto t = target.find(prefix);
+      if (t != target.end()) {
+	auto& shards = t->second;
+	to = shards[ceph_str_hash_rjenkins(key.data(), key.size()) %
+		    shards.size()];
+      }
+      if (to == from) {
+	continue;
+      }
+      if (to == default_cf) {
+	bat.Put(to, combine_strings(prefix, key), it->value());
+      } else {
+	bat.Put(to, key, it->value());
+      }
+      bat.Delete(from, it->key());
+      ++moved;
+      if (bat.GetDataSize() >= batch_bytes) {
+	auto status = db->Write(woptions, &bat);
+	if (!status.ok()) {
+	  out << "write failed: " << status.ToString() << std::endl;
+	  return -EIO;
+	}
+	bat.Clear();
+      }
+    }
+    if (!it->status().ok()) {
+      out << "iteration failed: " << it->status().ToString() << std::endl;
+      return -EIO;
+    }
+    if (bat.Count()) {
+      auto status = db->Write(woptions, &bat);
+      if (!status.ok()) {
+	out << "write failed: " << status.ToString() << std::endl;
+	return -EIO;
+      }
+    }
+    return 0;
+  };
+  r = move_cf(default_cf, nullptr);
+  if (r < 0) {
+    return r;
+  }
+  for (auto& p : existing) {
+    string prefix = p.first;
+    unsigned shard;
+    parse_cf_shard_name(p.first, &prefix, &shard);
+    r = move_cf(p.second, &prefix);
+    if (r < 0) {
+      return r;
+    }
+  }
+  out << "moved " << moved << " keys" << std::endl;
+
+  // drop column families the new layout no longer uses
+  for (auto& p : existing) {
+    if (target_names.count(p.first)) {
+      continue;
+    }
+    auto status = db->DropColumnFamily(p.second);
+    if (!status.ok()) {
+      out << "failed to drop column family " << p.first << ": "
+	  << status.ToString() << std::endl;
+      return -EINVAL;
+    }
+    db->DestroyColumnFamilyHandle(p.second);
+    out << "dropped column family " << p.first << std::endl;
+  }
+  cf_handles.clear();
+  cf_shards.clear();
+  for (auto& p : target_names) {
+    add_cf_handle(p.first, p.second);
+  }
+  return 0;
+}
+
 void RocksDBStore::split_stats(const std::string &s, char delim, std::vector<std::string> &elems) {
     std::stringstream ss;
     ss.str(s);
@@ -693,16 +971,20 @@ void RocksDBStore::split_stats(const std::string &s, char delim, std::vector<std
 
 int64_t RocksDBStore::estimate_prefix_size(const string& prefix)
 {
-  auto cf = get_cf_handle(prefix);
+  auto cfs = get_cf_handles(prefix);
   uint64_t size = 0;
   uint8_t flags =
     //rocksdb::DB::INCLUDE_MEMTABLES |  // do not include memtables...
     rocksdb::DB::INCLUDE_FILES;
-  if (cf) {
+  if (!cfs.empty()) {
     string start(1, '\x00');
     string limit("\xff\xff\xff\xff");
     rocksdb::Range r(start, limit);
-    db->GetApproximateSizes(cf, &r, 1, &size, flags);
+    for (auto cf : cfs) {
+      uint64_t cf_size = 0;
+      db->GetApproximateSizes(cf, &r, 1, &cf_size, flags);
+      size += cf_size;
+    }
   } else {
     string limit = prefix + "\xff\xff\xff\xff";
     rocksdb::Range r(prefix, limit);
@@ -879,7 +1161,7 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const string &k,
   const bufferlist &to_set_bl)
 {
-  auto cf = db->get_cf_handle(prefix);
+  auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     put_bat(bat, cf, k, to_set_bl);
   } else {
@@ -893,7 +1175,7 @@ void RocksDBStore::RocksDBTransactionImpl::set(
   const char *k, size_t keylen,
   const bufferlist &to_set_bl)
 {
-  auto cf = db->get_cf_handle(prefix);
+  auto cf = db->get_cf_handle(prefix, k, keylen);
   if (cf) {
     string key(k, keylen);  // fixme?
     put_bat(bat, cf, key, to_set_bl);
@@ -907,7 +1189,7 @@ void RocksDBStore::RocksDBTransactionImpl::set(
 void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const string &k)
 {
-  auto cf = db->get_cf_handle(prefix);
+  auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     bat.Delete(cf, rocksdb::Slice(k));
   } else {
@@ -919,7 +1201,7 @@ void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 					         const char *k,
 						 size_t keylen)
 {
-  auto cf = db->get_cf_handle(prefix);
+  auto cf = db->get_cf_handle(prefix, k, keylen);
   if (cf) {
     bat.Delete(cf, rocksdb::Slice(k, keylen));
   } else {
@@ -932,7 +1214,7 @@ void RocksDBStore::RocksDBTransactionImpl::rmkey(const string &prefix,
 void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 					                 const string &k)
 {
-  auto cf = db->get_cf_handle(prefix);
+  auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     bat.SingleDelete(cf, k);
   } else {
@@ -942,35 +1224,41 @@ void RocksDBStore::RocksDBTransactionImpl::rm_single_key(const string &prefix,
 
 void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix)
 {
-  auto cf = db->get_cf_handle(prefix);
-  if (cf) {
+  auto cfs = db->get_cf_handles(prefix);
+  if (!cfs.empty()) {
     if (db->enable_rmrange) {
       string endprefix("\xff\xff\xff\xff");  // FIXME: this is cheating...
       if (db->max_items_rmrange) {
         uint64_t cnt = db->max_items_rmrange;
         bat.SetSavePoint();
-        auto it = db->get_iterator(prefix);
+        auto it = db->get_iterator(prefix, KeyValueDB::IteratorBounds());
         for (it->seek_to_first();
         it->valid();
         it->next()) {
           if (!cnt) {
             bat.RollbackToSavePoint();
-            bat.DeleteRange(cf, string(), endprefix);
+            for (auto cf : cfs) {
+              bat.DeleteRange(cf, string(), endprefix);
+            }
             return;
           }
-          bat.Delete(cf, rocksdb::Slice(it->key()));
+          bat.Delete(db->get_cf_handle(prefix, it->key()),
+                     rocksdb::Slice(it->key()));
           --cnt;
         }
         bat.PopSavePoint();
       } else {
-        bat.DeleteRange(cf, string(), endprefix);
+        for (auto cf : cfs) {
+          bat.DeleteRange(cf, string(), endprefix);
+        }
       }
     } else {
-      auto it = db->get_iterator(prefix);
+      auto it = db->get_iterator(prefix, KeyValueDB::IteratorBounds());
       for (it->seek_to_first();
 	   it->valid();
 	   it->next()) {
-	bat.Delete(cf, rocksdb::Slice(it->key()));
+	bat.Delete(db->get_cf_handle(prefix, it->key()),
+		   rocksdb::Slice(it->key()));
       }
     }
   } else {
@@ -980,7 +1268,7 @@ void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix
       if (db->max_items_rmrange) {
         uint64_t cnt = db->max_items_rmrange;
         bat.SetSavePoint();
-        auto it = db->get_iterator(prefix);
+        auto it = db->get_iterator(prefix, KeyValueDB::IteratorBounds());
         for (it->seek_to_first();
              it->valid();
              it->next()) {
@@ -1001,7 +1289,7 @@ void RocksDBStore::RocksDBTransactionImpl::rmkeys_by_prefix(const string &prefix
             combine_strings(endprefix, string()));
       }
     } else {
-      auto it = db->get_iterator(prefix);
+      auto it = db->get_iterator(prefix, KeyValueDB::IteratorBounds());
       for (it->seek_to_first();
 	   it->valid();
 	   it->next()) {
@@ -1015,12 +1303,12 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
                                                          const string &start,
                                                          const string &end)
 {
-  auto cf = db->get_cf_handle(prefix);
-  if (cf) {
+  auto cfs = db->get_cf_handles(prefix);
+  if (!cfs.empty()) {
     if (db->enable_rmrange) {
       if (db->max_items_rmrange) {
         uint64_t cnt = db->max_items_rmrange;
-        auto it = db->get_iterator(prefix);
+        auto it = db->get_iterator(prefix, KeyValueDB::IteratorBounds{start, end});
         bat.SetSavePoint();
         it->lower_bound(start);
         while (it->valid()) {
@@ -1029,25 +1317,31 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
           }
           if (!cnt) {
             bat.RollbackToSavePoint();
-            bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+            for (auto cf : cfs) {
+              bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+            }
             return;
           }
-          bat.Delete(cf, rocksdb::Slice(it->key()));
+          bat.Delete(db->get_cf_handle(prefix, it->key()),
+                     rocksdb::Slice(it->key()));
           it->next();
           --cnt;
         }
         bat.PopSavePoint();
       } else {
-        bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+        for (auto cf : cfs) {
+          bat.DeleteRange(cf, rocksdb::Slice(start), rocksdb::Slice(end));
+        }
       }
     } else {
-      auto it = db->get_iterator(prefix);
+      auto it = db->get_iterator(prefix, KeyValueDB::IteratorBounds{start, end});
       it->lower_bound(start);
       while (it->valid()) {
 	if (it->key() >= end) {
 	  break;
 	}
-	bat.Delete(cf, rocksdb::Slice(it->key()));
+	bat.Delete(db->get_cf_handle(prefix, it->key()),
+		   rocksdb::Slice(it->key()));
 	it->next();
       }
     }
@@ -1055,7 +1349,7 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
     if (db->enable_rmrange) {
       if (db->max_items_rmrange) {
         uint64_t cnt = db->max_items_rmrange;
-        auto it = db->get_iterator(prefix);
+        auto it = db->get_iterator(prefix, KeyValueDB::IteratorBounds{start, end});
         bat.SetSavePoint();
         it->lower_bound(start);
         while (it->valid()) {
@@ -1083,7 +1377,7 @@ void RocksDBStore::RocksDBTransactionImpl::rm_range_keys(const string &prefix,
             rocksdb::Slice(combine_strings(prefix, end)));
       }
     } else {
-      auto it = db->get_iterator(prefix);
+      auto it = db->get_iterator(prefix, KeyValueDB::IteratorBounds{start, end});
       it->lower_bound(start);
       while (it->valid()) {
 	if (it->key() >= end) {
@@ -1102,7 +1396,7 @@ void RocksDBStore::RocksDBTransactionImpl::merge(
   const string &k,
   const bufferlist &to_set_bl)
 {
-  auto cf = db->get_cf_handle(prefix);
+  auto cf = db->get_cf_handle(prefix, k);
   if (cf) {
     // bufferlist::c_str() is non-constant, so we can't call c_str()
     if (to_set_bl.is_contiguous() && to_set_bl.length() > 0) {
@@ -1143,12 +1437,11 @@ int RocksDBStore::get(
     std::map<string, bufferlist> *out)
 {
   utime_t start = ceph_clock_now();
-  auto cf = get_cf_handle(prefix);
-  if (cf) {
+  if (!get_cf_handles(prefix).empty()) {
     for (auto& key : keys) {
       std::string value;
       auto status = db->Get(rocksdb::ReadOptions(),
-			    cf,
+			    get_cf_handle(prefix, key),
 			    rocksdb::Slice(key),
 			    &value);
       if (status.ok()) {
@@ -1188,7 +1481,7 @@ int RocksDBStore::get(
   int r = 0;
   string value;
   rocksdb::Status s;
-  auto cf = get_cf_handle(prefix);
+  auto cf = get_cf_handle(prefix, key);
   if (cf) {
     s = db->Get(rocksdb::ReadOptions(),
 		cf,
@@ -1225,7 +1518,7 @@ int RocksDBStore::get(
   int r = 0;
   string value;
   rocksdb::Status s;
-  auto cf = get_cf_handle(prefix);
+  auto cf = get_cf_handle(prefix, key, keylen);
   if (cf) {
     s = db->Get(rocksdb::ReadOptions(),
 		cf,
@@ -1283,6 +1576,24 @@ void RocksDBStore::compact()
       static_cast<rocksdb::ColumnFamilyHandle*>(cf.second),
       nullptr, nullptr);
   }
+  for (auto& p : cf_shards) {
+    for (auto cf : p.second) {
+      db->CompactRange(options, cf, nullptr, nullptr);
+    }
+  }
+}
+
+void RocksDBStore::compact_prefix(const string& prefix)
+{
+  auto cfs = get_cf_handles(prefix);
+  if (cfs.empty()) {
+    compact_range(prefix, past_prefix(prefix));
+    return;
+  }
+  rocksdb::CompactRangeOptions options;
+  for (auto cf : cfs) {
+    db->CompactRange(options, cf, nullptr, nullptr);
+  }
 }
 
 
@@ -1369,6 +1680,39 @@ void RocksDBStore::compact_range(const string& start, const string& end)
   db->CompactRange(options, &cstart, &cend);
 }
 
+RocksDBStore::BoundedReadOptions::BoundedReadOptions(
+  const IteratorBounds& bounds,
+  const std::string *prefix)
+{
+  if (prefix) {
+    lower = combine_strings(*prefix, bounds.lower_bound.value_or(string()));
+    upper = bounds.upper_bound ? combine_strings(*prefix, *bounds.upper_bound)
+      : past_prefix(*prefix);
+  } else {
+    lower = bounds.lower_bound.value_or(string());
+    upper = bounds.upper_bound.value_or(string());
+  }
+  lower_slice = rocksdb::Slice(lower);
+  upper_slice = rocksdb::Slice(upper);
+  if (prefix || bounds.lower_bound) {
+    options.iterate_lower_bound = &lower_slice;
+  }
+  if (prefix || bounds.upper_bound) {
+    options.iterate_upper_bound = &upper_slice;
+  }
+  options.readahead_size = bounds.readahead;
+  options.fill_cache = bounds.fill_cache;
+}
+
+RocksDBStore::RocksDBWholeSpaceIteratorImpl::RocksDBWholeSpaceIteratorImpl(
+  std::unique_ptr<BoundedReadOptions> b,
+  rocksdb::DB *db,
+  rocksdb::ColumnFamilyHandle *cf)
+  : bounds(std::move(b)),
+    dbiter(db->NewIterator(bounds->options, cf))
+{
+}
+
 RocksDBStore::RocksDBWholeSpaceIteratorImpl::~RocksDBWholeSpaceIteratorImpl()
 {
   delete dbiter;
@@ -1507,11 +1851,18 @@ RocksDBStore::WholeSpaceIterator RocksDBStore::get_wholespace_iterator()
 class CFIteratorImpl : public KeyValueDB::IteratorImpl {
 protected:
   string prefix;
+  std::unique_ptr<RocksDBStore::BoundedReadOptions> bounds;
   rocksdb::Iterator *dbiter;
 public:
   explicit CFIteratorImpl(const std::string& p,
 				 rocksdb::Iterator *iter)
     : prefix(p), dbiter(iter) { }
+  CFIteratorImpl(const std::string& p,
+		 std::unique_ptr<RocksDBStore::BoundedReadOptions> b,
+		 rocksdb::DB *db,
+		 rocksdb::ColumnFamilyHandle *cf)
+    : prefix(p), bounds(std::move(b)),
+      dbiter(db->NewIterator(bounds->options, cf)) { }
   ~CFIteratorImpl() {
     delete dbiter;
   }
@@ -1569,15 +1920,183 @@ public:
   }
 };
 
+// Iterates a prefix hashed over several column families by merging
+// the per-shard iterators in key order.
+class ShardMergeIteratorImpl : public KeyValueDB::IteratorImpl {
+  string prefix;
+  std::unique_ptr<RocksDBStore::BoundedReadOptions> bounds;
+  std::vector<rocksdb::Iterator*> iters;
+  int cur = -1;          ///< iterator at the current key, -1 if invalid
+  bool forward = true;   ///< others are past cur in this direction
+
+  void pick() {
+    cur = -1;
+    for (unsigned i = 0; i < iters.size(); ++i) {
+      if (!iters[i]->Valid()) {
+	continue;
+      }
+      if (cur < 0) {
+	cur = i;
+	continue;
+      }
+      int c = iters[i]->key().compare(iters[cur]->key());
+      if (forward ? c < 0 : c > 0) {
+	cur = i;
+      }
+    }
+  }
+public:
+  ShardMergeIteratorImpl(const std::string& p,
+			 std::unique_ptr<RocksDBStore::BoundedReadOptions> b,
+			 rocksdb::DB *db,
+			 const std::vector<rocksdb::ColumnFamilyHandle*>& cfs)
+    : prefix(p), bounds(std::move(b)) {
+    for (auto cf : cfs) {
+      iters.push_back(db->NewIterator(bounds->options, cf));
+    }
+  }
+  ~ShardMergeIteratorImpl() {
+    for (auto it : iters) {
+      delete it;
+    }
+  }
+
+  int seek_to_first() override {
+    for (auto it : iters) {
+      it->SeekToFirst();
+    }
+    forward = true;
+    pick();
+    return status();
+  }
+  int seek_to_last() override {
+    for (auto it : iters) {
+      it->SeekToLast();
+    }
+    forward = false;
+    pick();
+    return status();
+  }
+  int upper_bound(const string &after) override {
+    lower_bound(after);
+    if (valid() && (key() == after)) {
+      next();
+    }
+    return status();
+  }
+  int lower_bound(const string &to) override {
+    rocksdb::Slice slice_bound(to);
+    for (auto it : iters) {
+      it->Seek(slice_bound);
+    }
+    forward = true;
+    pick();
+    return status();
+  }
+  int next() override {
+    if (!valid()) {
+      return status();
+    }
+    if (!forward) {
+      // each key lives in exactly one shard, so the others land past it
+      string k = key();
+      for (unsigned i = 0; i < iters.size(); ++i) {
+	if ((int)i != cur) {
+	  iters[i]->Seek(k);
+	}
+      }
+      forward = true;
+    }
+    iters[cur]->Next();
+    pick();
+    return status();
+  }
+  int prev() override {
+    if (!valid()) {
+      return status();
+    }
+    if (forward) {
+      string k = key();
+      for (unsigned i = 0; i < iters.size(); ++i) {
+	if ((int)i == cur) {
+	  continue;
+	}
+	iters[i]->Seek(k);
+	if (iters[i]->Valid()) {
+	  iters[i]->Prev();
+	} else {
+	  iters[i]->SeekToLast();
+	}
+      }
+      forward = false;
+    }
+    iters[cur]->Prev();
+    pick();
+    return status();
+  }
+  bool valid() override {
+    return cur >= 0;
+  }
+  string key() override {
+    return iters[cur]->key().ToString();
+  }
+  std::pair<std::string, std::string> raw_key() override {
+    return make_pair(prefix, key());
+  }
+  bufferlist value() override {
+    return to_bufferlist(iters[cur]->value());
+  }
+  bufferptr value_as_ptr() override {
+    rocksdb::Slice val = iters[cur]->value();
+    return bufferptr(val.data(), val.size());
+  }
+  int status() override {
+    for (auto it : iters) {
+      if (!it->status().ok()) {
+	return -1;
+      }
+    }
+    return 0;
+  }
+};
+
 KeyValueDB::Iterator RocksDBStore::get_iterator(const std::string& prefix)
 {
-  rocksdb::ColumnFamilyHandle *cf_handle =
-    static_cast<rocksdb::ColumnFamilyHandle*>(get_cf_handle(prefix));
-  if (cf_handle) {
+  auto cfs = get_cf_handles(prefix);
+  if (cfs.size() > 1) {
+    return std::make_shared<ShardMergeIteratorImpl>(
+      prefix,
+      std::make_unique<BoundedReadOptions>(IteratorBounds(), nullptr),
+      db, cfs);
+  } else if (cfs.size() == 1) {
     return std::make_shared<CFIteratorImpl>(
       prefix,
-      db->NewIterator(rocksdb::ReadOptions(), cf_handle));
+      db->NewIterator(rocksdb::ReadOptions(), cfs[0]));
   } else {
     return KeyValueDB::get_iterator(prefix);
   }
 }
+
+KeyValueDB::Iterator RocksDBStore::get_iterator(
+  const std::string& prefix,
+  const IteratorBounds& bounds)
+{
+  auto cfs = get_cf_handles(prefix);
+  if (cfs.size() > 1) {
+    return std::make_shared<ShardMergeIteratorImpl>(
+      prefix,
+      std::make_unique<BoundedReadOptions>(bounds, nullptr),
+      db, cfs);
+  } else if (cfs.size() == 1) {
+    return std::make_shared<CFIteratorImpl>(
+      prefix,
+      std::make_unique<BoundedReadOptions>(bounds, nullptr),
+      db, cfs[0]);
+  } else {
+    return make_prefix_iterator(
+      prefix,
+      std::make_shared<RocksDBWholeSpaceIteratorImpl>(
+	std::make_unique<BoundedReadOptions>(bounds, &prefix),
+	db, default_cf));
+  }
+}
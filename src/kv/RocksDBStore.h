@@ -87,8 +87,14 @@ class RocksDBStore : public KeyValueDB {
   bool must_close_default_cf = false;
   rocksdb::ColumnFamilyHandle *default_cf = nullptr;
 
+  /// prefixes spread over several column families, indexed by key hash
+  std::unordered_map<std::string,
+		     std::vector<rocksdb::ColumnFamilyHandle*>> cf_shards;
+
   int submit_common(rocksdb::WriteOptions& woptions, KeyValueDB::Transaction t);
   int install_cf_mergeop(const string &cf_name, rocksdb::ColumnFamilyOptions *cf_opt);
+  /// register an opened CF, as a shard of its prefix if named so
+  void add_cf_handle(const string &cf_name, rocksdb::ColumnFamilyHandle *cf);
   int create_db_dir();
   int do_open(ostream &out, bool create_if_missing, bool open_readonly,
 	      const vector<ColumnFamily>* cfs = nullptr);
@@ -132,9 +138,7 @@ public:
   static int _test_init(const string& dir);
   int init(string options_str) override;
   /// compact rocksdb for all keys with a given prefix
-  void compact_prefix(const string& prefix) override {
-    compact_range(prefix, past_prefix(prefix));
-  }
+  void compact_prefix(const string& prefix) override;
   void compact_prefix_async(const string& prefix) override {
     compact_range_async(prefix, past_prefix(prefix));
   }
@@ -188,6 +192,25 @@ public:
     else
       return static_cast<rocksdb::ColumnFamilyHandle*>(iter->second);
   }
+  /// CF holding key, or nullptr if the prefix lives in the default CF
+  rocksdb::ColumnFamilyHandle *get_cf_handle(const std::string& prefix,
+					     const char *key, size_t keylen);
+  rocksdb::ColumnFamilyHandle *get_cf_handle(const std::string& prefix,
+					     const std::string& key) {
+    return get_cf_handle(prefix, key.data(), key.size());
+  }
+  /// all CFs holding prefix, empty if it lives in the default CF
+  std::vector<rocksdb::ColumnFamilyHandle*> get_cf_handles(
+    const std::string& prefix);
+  /// name of the i-th hashed CF of a sharded prefix
+  static std::string get_cf_shard_name(const std::string& prefix, unsigned i) {
+    return prefix + "-" + std::to_string(i);
+  }
+  /// split a CF name into prefix and shard, return false if not sharded
+  static bool parse_cf_shard_name(const std::string& name,
+				  std::string *prefix, unsigned *shard);
+
+  int reshard(const std::vector<ColumnFamily>& cfs, std::ostream &out) override;
   int repair(std::ostream &out) override;
   void split_stats(const std::string &s, char delim, std::vector<std::string> &elems);
   void get_statistics(Formatter *f) override;
@@ -358,13 +381,29 @@ public:
     bufferlist *out) override;
 
 
+  /// read options confining an iterator to bounds; owns the bound keys
+  struct BoundedReadOptions {
+    std::string lower, upper;
+    rocksdb::Slice lower_slice, upper_slice;
+    rocksdb::ReadOptions options;
+    /// prefix is set when the keys live combined in the default CF
+    BoundedReadOptions(const IteratorBounds& bounds,
+		       const std::string *prefix);
+    BoundedReadOptions(const BoundedReadOptions&) = delete;
+    BoundedReadOptions& operator=(const BoundedReadOptions&) = delete;
+  };
+
   class RocksDBWholeSpaceIteratorImpl :
     public KeyValueDB::WholeSpaceIteratorImpl {
   protected:
+    std::unique_ptr<BoundedReadOptions> bounds;  ///< must outlive dbiter
     rocksdb::Iterator *dbiter;
   public:
     explicit RocksDBWholeSpaceIteratorImpl(rocksdb::Iterator *iter) :
       dbiter(iter) { }
+    RocksDBWholeSpaceIteratorImpl(std::unique_ptr<BoundedReadOptions> b,
+				  rocksdb::DB *db,
+				  rocksdb::ColumnFamilyHandle *cf);
     //virtual ~RocksDBWholeSpaceIteratorImpl() { }
     ~RocksDBWholeSpaceIteratorImpl() override;
 
@@ -388,6 +427,8 @@ public:
   };
 
   Iterator get_iterator(const std::string& prefix) override;
+  Iterator get_iterator(const std::string& prefix,
+			const IteratorBounds& bounds) override;
 
   /// Utility
   static string combine_strings(const string &prefix, const string &value) {
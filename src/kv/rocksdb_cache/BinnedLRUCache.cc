@@ -17,6 +17,8 @@
 #include <stdlib.h>
 #include <string>
 
+#include "common/ceph_time.h"
+
 #define dout_context cct
 #define dout_subsys ceph_subsys_rocksdb
 #undef dout_prefix
@@ -24,6 +26,18 @@
 
 namespace rocksdb_cache {
 
+namespace {
+// The block a thread last missed on.  RocksDB reads a missed block and
+// inserts it on the same thread, so the insert can tell how long the read
+// took.
+struct pending_miss_t {
+  const void* shard = nullptr;
+  uint32_t hash = 0;
+  ceph::mono_time start;
+};
+thread_local pending_miss_t pending_miss;
+}
+
 BinnedLRUHandleTable::BinnedLRUHandleTable() : list_(nullptr), length_(0), elems_(0) {
   Resize();
 }
@@ -102,18 +116,22 @@ void BinnedLRUHandleTable::Resize() {
 }
 
 BinnedLRUCacheShard::BinnedLRUCacheShard(size_t capacity, bool strict_capacity_limit,
-                             double high_pri_pool_ratio)
+                             double high_pri_pool_ratio,
+                             double probation_pool_ratio)
     : capacity_(0),
       high_pri_pool_usage_(0),
+      probation_pool_usage_(0),
       strict_capacity_limit_(strict_capacity_limit),
       high_pri_pool_ratio_(high_pri_pool_ratio),
       high_pri_pool_capacity_(0),
+      probation_pool_ratio_(probation_pool_ratio),
       usage_(0),
       lru_usage_(0) {
   // Make empty circular linked list
   lru_.next = &lru_;
   lru_.prev = &lru_;
   lru_low_pri_ = &lru_;
+  lru_probation_ = &lru_;
   SetCapacity(capacity);
 }
 
@@ -187,12 +205,20 @@ size_t BinnedLRUCacheShard::GetHighPriPoolUsage() const {
   return high_pri_pool_usage_;
 }
 
+size_t BinnedLRUCacheShard::GetProbationPoolUsage() const {
+  std::lock_guard<std::mutex> l(mutex_);
+  return probation_pool_usage_;
+}
+
 void BinnedLRUCacheShard::LRU_Remove(BinnedLRUHandle* e) {
   ceph_assert(e->next != nullptr);
   ceph_assert(e->prev != nullptr);
   if (lru_low_pri_ == e) {
     lru_low_pri_ = e->prev;
   }
+  if (lru_probation_ == e) {
+    lru_probation_ = e->prev;
+  }
   e->next->prev = e->prev;
   e->prev->next = e->next;
   e->prev = e->next = nullptr;
@@ -201,6 +227,10 @@ void BinnedLRUCacheShard::LRU_Remove(BinnedLRUHandle* e) {
     ceph_assert(high_pri_pool_usage_ >= e->charge);
     high_pri_pool_usage_ -= e->charge;
   }
+  if (e->InProbationPool()) {
+    ceph_assert(probation_pool_usage_ >= e->charge);
+    probation_pool_usage_ -= e->charge;
+  }
 }
 
 void BinnedLRUCacheShard::LRU_Insert(BinnedLRUHandle* e) {
@@ -213,8 +243,26 @@ void BinnedLRUCacheShard::LRU_Insert(BinnedLRUHandle* e) {
     e->prev->next = e;
     e->next->prev = e;
     e->SetInHighPriPool(true);
+    e->SetInProbationPool(false);
     high_pri_pool_usage_ += e->charge;
+    lru_usage_ += e->charge;
     MaintainPoolSize();
+  } else if (probation_pool_ratio_ > 0 && !e->HasHit()) {
+    // Insert "e" to the head of probation pool, if it was not hit since it
+    // was inserted.
+    e->next = lru_probation_->next;
+    e->prev = lru_probation_;
+    e->prev->next = e;
+    e->next->prev = e;
+    e->SetInHighPriPool(false);
+    e->SetInProbationPool(true);
+    probation_pool_usage_ += e->charge;
+    lru_usage_ += e->charge;
+    if (lru_low_pri_ == lru_probation_) {
+      // the protected part is empty
+      lru_low_pri_ = e;
+    }
+    lru_probation_ = e;
   } else {
     // Insert "e" to the head of low-pri pool. Note that when
     // high_pri_pool_ratio is 0, head of low-pri pool is also head of LRU list.
@@ -223,9 +271,11 @@ void BinnedLRUCacheShard::LRU_Insert(BinnedLRUHandle* e) {
     e->prev->next = e;
     e->next->prev = e;
     e->SetInHighPriPool(false);
+    e->SetInProbationPool(false);
+    lru_usage_ += e->charge;
     lru_low_pri_ = e;
   }
-  lru_usage_ += e->charge;
+  MaintainProbationPoolSize();
 }
 
 void BinnedLRUCacheShard::MaintainPoolSize() {
@@ -238,6 +288,23 @@ void BinnedLRUCacheShard::MaintainPoolSize() {
   }
 }
 
+void BinnedLRUCacheShard::MaintainProbationPoolSize() {
+  if (probation_pool_ratio_ <= 0) {
+    return;
+  }
+  double low_pri_pool_capacity = capacity_ - high_pri_pool_capacity_;
+  double protected_capacity = low_pri_pool_capacity * (1 - probation_pool_ratio_);
+  while (lru_usage_ - high_pri_pool_usage_ - probation_pool_usage_ >
+         protected_capacity) {
+    // Demote last entry in the protected part to probation pool.
+    lru_probation_ = lru_probation_->next;
+    ceph_assert(lru_probation_ != &lru_);
+    ceph_assert(!lru_probation_->InHighPriPool());
+    lru_probation_->SetInProbationPool(true);
+    probation_pool_usage_ += lru_probation_->charge;
+  }
+}
+
 void BinnedLRUCacheShard::EvictFromLRU(size_t charge,
                                  ceph::autovector<BinnedLRUHandle*>* deleted) {
   while (usage_ + charge > capacity_ && lru_.next != &lru_) {
@@ -249,6 +316,7 @@ void BinnedLRUCacheShard::EvictFromLRU(size_t charge,
     old->SetInCache(false);
     Unref(old);
     usage_ -= old->charge;
+    ghost_.insert(old->hash, old->charge);
     deleted->push_back(old);
   }
 }
@@ -259,7 +327,9 @@ void BinnedLRUCacheShard::SetCapacity(size_t capacity) {
     std::lock_guard<std::mutex> l(mutex_);
     capacity_ = capacity;
     high_pri_pool_capacity_ = capacity_ * high_pri_pool_ratio_;
+    ghost_.set_max_bytes(capacity_ * PriorityCache::GHOST_RATIO);
     EvictFromLRU(0, &last_reference_list);
+    MaintainProbationPoolSize();
   }
   // we free the entries here outside of mutex for
   // performance reasons
@@ -283,6 +353,11 @@ rocksdb::Cache::Handle* BinnedLRUCacheShard::Lookup(const rocksdb::Slice& key, u
     }
     e->refs++;
     e->SetHit();
+  } else {
+    if (ghost_.erase(hash)) {
+      miss_stats_.ghost_hits++;
+    }
+    pending_miss = pending_miss_t{this, hash, ceph::mono_clock::now()};
   }
   return reinterpret_cast<rocksdb::Cache::Handle*>(e);
 }
@@ -302,6 +377,7 @@ void BinnedLRUCacheShard::SetHighPriPoolRatio(double high_pri_pool_ratio) {
   high_pri_pool_ratio_ = high_pri_pool_ratio;
   high_pri_pool_capacity_ = capacity_ * high_pri_pool_ratio_;
   MaintainPoolSize();
+  MaintainProbationPoolSize();
 }
 
 bool BinnedLRUCacheShard::Release(rocksdb::Cache::Handle* handle, bool force_erase) {
@@ -327,6 +403,9 @@ bool BinnedLRUCacheShard::Release(rocksdb::Cache::Handle* handle, bool force_era
         e->SetInCache(false);
         Unref(e);
         usage_ -= e->charge;
+        if (!force_erase) {
+          ghost_.insert(e->hash, e->charge);
+        }
         last_reference = true;
       } else {
         // put the item on the list to be potentially freed
@@ -365,8 +444,19 @@ rocksdb::Status BinnedLRUCacheShard::Insert(const rocksdb::Slice& key, uint32_t
   e->SetPriority(priority);
   std::copy_n(key.data(), e->key_length, e->key_data);
 
+  double miss_time = -1;
+  if (pending_miss.shard == this && pending_miss.hash == hash) {
+    miss_time = std::chrono::duration<double>(
+      ceph::mono_clock::now() - pending_miss.start).count();
+    pending_miss.shard = nullptr;
+  }
+
   {
     std::lock_guard<std::mutex> l(mutex_);
+    if (miss_time >= 0) {
+      miss_stats_.misses++;
+      miss_stats_.miss_time += miss_time;
+    }
     // Free the space following strict LRU policy until enough space
     // is freed or the lru list is empty
     EvictFromLRU(charge, &last_reference_list);
@@ -457,8 +547,9 @@ std::string BinnedLRUCacheShard::GetPrintableOptions() const {
   char buffer[kBufferSize];
   {
     std::lock_guard<std::mutex> l(mutex_);
-    snprintf(buffer, kBufferSize, "    high_pri_pool_ratio: %.3lf\n",
-             high_pri_pool_ratio_);
+    snprintf(buffer, kBufferSize, "    high_pri_pool_ratio: %.3lf\n"
+             "    probation_pool_ratio: %.3lf\n",
+             high_pri_pool_ratio_, probation_pool_ratio_);
   }
   return std::string(buffer);
 }
@@ -467,7 +558,8 @@ BinnedLRUCache::BinnedLRUCache(CephContext *c,
                                size_t capacity, 
                                int num_shard_bits,
                                bool strict_capacity_limit, 
-                               double high_pri_pool_ratio)
+                               double high_pri_pool_ratio,
+                               double probation_pool_ratio)
     : ShardedCache(capacity, num_shard_bits, strict_capacity_limit), cct(c) {
   num_shards_ = 1 << num_shard_bits;
   // TODO: Switch over to use mempool
@@ -480,7 +572,8 @@ BinnedLRUCache::BinnedLRUCache(CephContext *c,
   size_t per_shard = (capacity + (num_shards_ - 1)) / num_shards_;
   for (int i = 0; i < num_shards_; i++) {
     new (&shards_[i])
-        BinnedLRUCacheShard(per_shard, strict_capacity_limit, high_pri_pool_ratio);
+        BinnedLRUCacheShard(per_shard, strict_capacity_limit, high_pri_pool_ratio,
+                            probation_pool_ratio);
   }
 }
 
@@ -549,6 +642,20 @@ size_t BinnedLRUCache::GetHighPriPoolUsage() const {
   return usage;
 }
 
+size_t BinnedLRUCache::GetProbationPoolUsage() const {
+  size_t usage = 0;
+  for (int s = 0; s < num_shards_; s++) {
+    usage += shards_[s].GetProbationPoolUsage();
+  }
+  return usage;
+}
+
+void BinnedLRUCacheShard::AddMissStats(PriorityCache::MissStats* stats) const {
+  std::lock_guard<std::mutex> l(mutex_);
+  *stats += miss_stats_;
+  stats->ghost_bytes += ghost_.get_bytes();
+}
+
 // PriCache
 
 int64_t BinnedLRUCache::request_cache_bytes(PriorityCache::Priority pri, uint64_t total_cache) const
@@ -563,11 +670,19 @@ int64_t BinnedLRUCache::request_cache_bytes(PriorityCache::Priority pri, uint64_
       request = GetHighPriPoolUsage();
       break;
     }
-  // All other cache items are currently shoved into the PRI1 priority. 
+  // PRI1 is for the items that were hit since they were inserted
   case PriorityCache::Priority::PRI1:
     {
       request = GetUsage();
       request -= GetHighPriPoolUsage();
+      request -= GetProbationPoolUsage();
+      break;
+    }
+  // PRI2 is for the items still on probation, which have yet to show they
+  // are worth more than the other caches' PRI1
+  case PriorityCache::Priority::PRI2:
+    {
+      request = GetProbationPoolUsage();
       break;
     }
   default:
@@ -600,12 +715,21 @@ int64_t BinnedLRUCache::commit_cache_size(uint64_t total_bytes)
   return new_bytes;
 }
 
+bool BinnedLRUCache::get_miss_stats(PriorityCache::MissStats *stats) const
+{
+  for (int s = 0; s < num_shards_; s++) {
+    shards_[s].AddMissStats(stats);
+  }
+  return true;
+}
+
 std::shared_ptr<rocksdb::Cache> NewBinnedLRUCache(
     CephContext *c, 
     size_t capacity,
     int num_shard_bits,
     bool strict_capacity_limit,
-    double high_pri_pool_ratio) {
+    double high_pri_pool_ratio,
+    double probation_pool_ratio) {
   if (num_shard_bits >= 20) {
     return nullptr;  // the cache cannot be sharded into too many fine pieces
   }
@@ -613,11 +737,16 @@ std::shared_ptr<rocksdb::Cache> NewBinnedLRUCache(
     // invalid high_pri_pool_ratio
     return nullptr;
   }
+  if (probation_pool_ratio < 0.0 || probation_pool_ratio > 1.0) {
+    // invalid probation_pool_ratio
+    return nullptr;
+  }
   if (num_shard_bits < 0) {
     num_shard_bits = GetDefaultCacheShardBits(capacity);
   }
   return std::make_shared<BinnedLRUCache>(
-      c, capacity, num_shard_bits, strict_capacity_limit, high_pri_pool_ratio);
+      c, capacity, num_shard_bits, strict_capacity_limit, high_pri_pool_ratio,
+      probation_pool_ratio);
 }
 
 }  // namespace rocksdb_cache
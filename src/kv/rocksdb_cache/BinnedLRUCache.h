@@ -52,7 +52,8 @@ std::shared_ptr<rocksdb::Cache> NewBinnedLRUCache(
     size_t capacity,
     int num_shard_bits = -1,
     bool strict_capacity_limit = false,
-    double high_pri_pool_ratio = 0.0);
+    double high_pri_pool_ratio = 0.0,
+    double probation_pool_ratio = 0.0);
 
 struct BinnedLRUHandle {
   void* value;
@@ -69,6 +70,8 @@ struct BinnedLRUHandle {
   //   in_cache:    whether this entry is referenced by the hash table.
   //   is_high_pri: whether this entry is high priority entry.
   //   in_high_pri_pool: whether this entry is in high-pri pool.
+  //   has_hit:     whether this entry was looked up since it was inserted.
+  //   in_probation_pool: whether this entry is in the probation pool.
   char flags;
 
   uint32_t hash;     // Hash of key(); used for fast sharding and comparisons
@@ -89,6 +92,7 @@ struct BinnedLRUHandle {
   bool IsHighPri() { return flags & 2; }
   bool InHighPriPool() { return flags & 4; }
   bool HasHit() { return flags & 8; }
+  bool InProbationPool() { return flags & 16; }
 
   void SetInCache(bool in_cache) {
     if (in_cache) {
@@ -116,6 +120,14 @@ struct BinnedLRUHandle {
 
   void SetHit() { flags |= 8; }
 
+  void SetInProbationPool(bool in_probation_pool) {
+    if (in_probation_pool) {
+      flags |= 16;
+    } else {
+      flags &= ~16;
+    }
+  }
+
   void Free() {
     ceph_assert((refs == 1 && InCache()) || (refs == 0 && !InCache()));
     if (deleter) {
@@ -172,7 +184,7 @@ class BinnedLRUHandleTable {
 class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
  public:
   BinnedLRUCacheShard(size_t capacity, bool strict_capacity_limit,
-                double high_pri_pool_ratio);
+                double high_pri_pool_ratio, double probation_pool_ratio);
   virtual ~BinnedLRUCacheShard();
 
   // Separate from constructor so caller can easily make an array of BinnedLRUCache
@@ -224,6 +236,12 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Retrieves high pri pool usage
   size_t GetHighPriPoolUsage() const;
 
+  // Retrieves probation pool usage
+  size_t GetProbationPoolUsage() const;
+
+  // Adds this shard's miss statistics to stats
+  void AddMissStats(PriorityCache::MissStats* stats) const;
+
  private:
   void LRU_Remove(BinnedLRUHandle* e);
   void LRU_Insert(BinnedLRUHandle* e);
@@ -232,6 +250,11 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // high-pri pool is no larger than the size specify by high_pri_pool_pct.
   void MaintainPoolSize();
 
+  // Demote the last entry in the protected part of the low-pri pool to the
+  // probation pool until the protected part leaves probation_pool_ratio of
+  // the low-pri pool to it.
+  void MaintainProbationPoolSize();
+
   // Just reduce the reference count by 1.
   // Return true if last reference
   bool Unref(BinnedLRUHandle* e);
@@ -248,6 +271,9 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Memory size for entries in high-pri pool.
   size_t high_pri_pool_usage_;
 
+  // Memory size for entries in probation pool.
+  size_t probation_pool_usage_;
+
   // Whether to reject insertion if cache reaches its full capacity.
   bool strict_capacity_limit_;
 
@@ -258,6 +284,12 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Remember the value to avoid recomputing each time.
   double high_pri_pool_capacity_;
 
+  // Ratio of the low-pri pool kept for entries that have not been hit since
+  // they were inserted. They are evicted before the ones that have, so a
+  // scan can only evict what it inserted itself and what aged out of the
+  // protected part. 0 disables it.
+  double probation_pool_ratio_;
+
   // Dummy head of LRU list.
   // lru.prev is newest entry, lru.next is oldest entry.
   // LRU contains items which can be evicted, ie reference only by cache
@@ -266,6 +298,10 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Pointer to head of low-pri pool in LRU list.
   BinnedLRUHandle* lru_low_pri_;
 
+  // Pointer to head of probation pool in LRU list, which is the oldest
+  // part of the low-pri pool.
+  BinnedLRUHandle* lru_probation_;
+
   // ------------^^^^^^^^^^^^^-----------
   // Not frequently modified data members
   // ------------------------------------
@@ -285,6 +321,10 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
   // Memory size for entries residing only in the LRU list
   size_t lru_usage_;
 
+  // Hashes of the entries evicted lately, and the misses they caught.
+  PriorityCache::GhostCache ghost_;
+  PriorityCache::MissStats miss_stats_;
+
   // mutex_ protects the following state.
   // We don't count mutex_ as the cache's internal state so semantically we
   // don't mind mutex_ invoking the non-const actions.
@@ -294,7 +334,8 @@ class alignas(CACHE_LINE_SIZE) BinnedLRUCacheShard : public CacheShard {
 class BinnedLRUCache : public ShardedCache {
  public:
   BinnedLRUCache(CephContext *c, size_t capacity, int num_shard_bits,
-      bool strict_capacity_limit, double high_pri_pool_ratio);
+      bool strict_capacity_limit, double high_pri_pool_ratio,
+      double probation_pool_ratio);
   virtual ~BinnedLRUCache();
   virtual const char* Name() const override { return "BinnedLRUCache"; }
   virtual CacheShard* GetShard(int shard) override;
@@ -312,6 +353,8 @@ class BinnedLRUCache : public ShardedCache {
   double GetHighPriPoolRatio() const;
   // Retrieves high pri pool usage
   size_t GetHighPriPoolUsage() const;
+  // Retrieves probation pool usage
+  size_t GetProbationPoolUsage() const;
 
   // PriorityCache
   virtual int64_t request_cache_bytes(
@@ -323,6 +366,7 @@ class BinnedLRUCache : public ShardedCache {
   virtual std::string get_cache_name() const {
     return "RocksDB Binned LRU Cache";
   }
+  virtual bool get_miss_stats(PriorityCache::MissStats *stats) const;
 
  private:
   CephContext *cct;
@@ -1248,6 +1248,45 @@ int librados::IoCtxImpl::hit_set_get(uint32_t hash, AioCompletionImpl *c,
   return 0;
 }
 
+int librados::IoCtxImpl::aio_pg_omap_read(
+  AioCompletionImpl *c,
+  const std::vector<omap_read_t>& reads,
+  std::vector<omap_read_result_t> *results)
+{
+  if (reads.empty()) {
+    return -EINVAL;
+  }
+  std::vector<pg_omap_read_t> pg_reads(reads.size());
+  for (unsigned i = 0; i < reads.size(); ++i) {
+    auto& pg_read = pg_reads[i];
+    pg_read.oid = reads[i].oid;
+    pg_read.key = reads[i].locator.empty() ? oloc.key : reads[i].locator;
+    pg_read.want_header = reads[i].want_header;
+    pg_read.start_after = reads[i].start_after;
+    pg_read.filter_prefix = reads[i].filter_prefix;
+    pg_read.max_return = reads[i].max_return;
+  }
+  // the op goes to the PG of the first object
+  const auto& first = pg_reads.front();
+  int64_t hash = objecter->get_object_hash_position(
+    poolid, first.key.empty() ? first.oid.name : first.key, oloc.nspace);
+  if (hash < 0) {
+    return hash;
+  }
+
+  Context *oncomplete = new C_aio_Complete(c);
+  c->is_read = true;
+  c->io = this;
+
+  ::ObjectOperation rd;
+  rd.pg_omap_read(pg_reads, results, &c->rval);
+  object_locator_t pg_oloc(poolid, oloc.nspace);
+  Objecter::Op *o = objecter->prepare_pg_read_op(
+    hash, pg_oloc, rd, NULL, 0, oncomplete, NULL, NULL);
+  objecter->op_submit(o, &c->tid);
+  return 0;
+}
+
 int librados::IoCtxImpl::remove(const object_t& oid)
 {
   ::ObjectOperation op;
@@ -1771,7 +1810,8 @@ int librados::IoCtxImpl::aio_unwatch(uint64_t cookie, AioCompletionImpl *c)
 int librados::IoCtxImpl::notify(const object_t& oid, bufferlist& bl,
 				uint64_t timeout_ms,
 				bufferlist *preply_bl,
-				char **preply_buf, size_t *preply_buf_len)
+				char **preply_buf, size_t *preply_buf_len,
+				uint32_t flags)
 {
   Objecter::LingerOp *linger_op = objecter->linger_register(oid, oloc, 0);
 
@@ -1789,7 +1829,7 @@ int librados::IoCtxImpl::notify(const object_t& oid, bufferlist& bl,
   ::ObjectOperation rd;
   prepare_assert_ops(&rd);
   bufferlist inbl;
-  rd.notify(linger_op->get_cookie(), 1, timeout, bl, &inbl);
+  rd.notify(linger_op->get_cookie(), 1, timeout, bl, &inbl, flags);
 
   // Issue RADOS op
   C_SaferCond onack;
@@ -228,6 +228,10 @@ struct librados::IoCtxImpl {
   int hit_set_get(uint32_t hash, AioCompletionImpl *c, time_t stamp,
 		  bufferlist *pbl);
 
+  int aio_pg_omap_read(AioCompletionImpl *c,
+		       const std::vector<omap_read_t>& reads,
+		       std::vector<omap_read_result_t> *results);
+
   int get_inconsistent_objects(const pg_t& pg,
 			       const librados::object_id_t& start_after,
 			       uint64_t max_to_get,
@@ -257,7 +261,8 @@ struct librados::IoCtxImpl {
   int unwatch(uint64_t cookie);
   int aio_unwatch(uint64_t cookie, AioCompletionImpl *c);
   int notify(const object_t& oid, bufferlist& bl, uint64_t timeout_ms,
-	     bufferlist *preplybl, char **preply_buf, size_t *preply_buf_len);
+	     bufferlist *preplybl, char **preply_buf, size_t *preply_buf_len,
+	     uint32_t flags = 0);
   int notify_ack(const object_t& oid, uint64_t notify_id, uint64_t cookie,
 		 bufferlist& bl);
   int aio_notify(const object_t& oid, AioCompletionImpl *c, bufferlist& bl,
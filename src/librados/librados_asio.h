@@ -16,6 +16,7 @@
 
 #include "include/rados/librados.hpp"
 #include "common/async/completion.h"
+#include "include/ceph_assert.h"
 
 /// Defines asynchronous librados operations that satisfy all of the
 /// "Requirements on asynchronous operations" imposed by the C++ Networking TS
@@ -32,12 +33,33 @@ namespace librados {
 
 namespace detail {
 
-/// unique_ptr with custom deleter for AioCompletion
-struct AioCompletionDeleter {
-  void operator()(AioCompletion *c) { c->release(); }
+/// Owns a completion created through the C API, with its AioCompletion
+/// handle stored inline rather than allocated by
+/// Rados::aio_create_completion(), so each op allocates one object fewer.
+class unique_aio_completion_ptr {
+  AioCompletion c{nullptr};
+ public:
+  unique_aio_completion_ptr() = default;
+  unique_aio_completion_ptr(unique_aio_completion_ptr&& o) noexcept
+    : c(o.c.pc) {
+    o.c.pc = nullptr;
+  }
+  unique_aio_completion_ptr& operator=(unique_aio_completion_ptr&& o) noexcept {
+    std::swap(c.pc, o.c.pc);
+    return *this;
+  }
+  ~unique_aio_completion_ptr() { reset(); }
+
+  /// take ownership of a completion from rados_aio_create_completion()
+  void reset(rados_completion_t pc = nullptr) {
+    if (c.pc) {
+      rados_aio_release(c.pc);
+    }
+    c.pc = static_cast<AioCompletionImpl*>(pc);
+  }
+  AioCompletion* get() { return &c; }
+  AioCompletion* operator->() { return &c; }
 };
-using unique_aio_completion_ptr =
-    std::unique_ptr<AioCompletion, AioCompletionDeleter>;
 
 /// Invokes the given completion handler. When the type of Result is not void,
 /// storage is provided for it and that result is passed as an additional
@@ -64,6 +86,7 @@ struct Invoker<void> {
 template <typename Result>
 struct AsyncOp : Invoker<Result> {
   unique_aio_completion_ptr aio_completion;
+  uint64_t *pver = nullptr; ///< where to report the object version, if set
 
   using Signature = typename Invoker<Result>::Signature;
   using Completion = ceph::async::Completion<Signature, AsyncOp<Result>>;
@@ -74,6 +97,9 @@ struct AsyncOp : Invoker<Result> {
     // move result out of Completion memory being freed
     auto op = std::move(p->user_data);
     const int ret = op.aio_completion->get_return_value();
+    if (op.pver) {
+      *op.pver = op.aio_completion->get_version64();
+    }
     boost::system::error_code ec;
     if (ret < 0) {
       ec.assign(-ret, boost::system::system_category());
@@ -84,8 +110,10 @@ struct AsyncOp : Invoker<Result> {
   template <typename Executor1, typename CompletionHandler>
   static auto create(const Executor1& ex1, CompletionHandler&& handler) {
     auto p = Completion::create(ex1, std::move(handler));
-    p->user_data.aio_completion.reset(
-        Rados::aio_create_completion(p.get(), nullptr, aio_dispatch));
+    rados_completion_t c;
+    int r = rados_aio_create_completion(p.get(), nullptr, aio_dispatch, &c);
+    ceph_assert(r == 0);
+    p->user_data.aio_completion.reset(c);
     return p;
   }
 };
@@ -140,16 +168,18 @@ auto async_write(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
 
 /// Calls IoCtx::aio_operate() and arranges for the AioCompletion to call a
 /// given handler with signature (boost::system::error_code, bufferlist).
+/// The object version is stored to *pver, if given, before the handler runs.
 template <typename ExecutionContext, typename CompletionToken>
 auto async_operate(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
                    ObjectReadOperation *read_op, int flags,
-                   CompletionToken&& token)
+                   CompletionToken&& token, uint64_t *pver = nullptr)
 {
   using Op = detail::AsyncOp<bufferlist>;
   using Signature = typename Op::Signature;
   boost::asio::async_completion<CompletionToken, Signature> init(token);
   auto p = Op::create(ctx.get_executor(), init.completion_handler);
   auto& op = p->user_data;
+  op.pver = pver;
 
   int ret = io.aio_operate(oid, op.aio_completion.get(), read_op,
                            flags, &op.result);
@@ -164,16 +194,18 @@ auto async_operate(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
 
 /// Calls IoCtx::aio_operate() and arranges for the AioCompletion to call a
 /// given handler with signature (boost::system::error_code).
+/// The object version is stored to *pver, if given, before the handler runs.
 template <typename ExecutionContext, typename CompletionToken>
 auto async_operate(ExecutionContext& ctx, IoCtx& io, const std::string& oid,
                    ObjectWriteOperation *write_op, int flags,
-                   CompletionToken &&token)
+                   CompletionToken &&token, uint64_t *pver = nullptr)
 {
   using Op = detail::AsyncOp<void>;
   using Signature = typename Op::Signature;
   boost::asio::async_completion<CompletionToken, Signature> init(token);
   auto p = Op::create(ctx.get_executor(), init.completion_handler);
   auto& op = p->user_data;
+  op.pver = pver;
 
   int ret = io.aio_operate(oid, op.aio_completion.get(), write_op, flags);
   if (ret < 0) {
@@ -1851,6 +1851,13 @@ int librados::IoCtx::hit_set_get(uint32_t hash,  AioCompletion *c, time_t stamp,
   return io_ctx_impl->hit_set_get(hash, c->pc, stamp, pbl);
 }
 
+int librados::IoCtx::aio_pg_omap_read(AioCompletion *c,
+				      const std::vector<omap_read_t>& reads,
+				      std::vector<omap_read_result_t> *results)
+{
+  return io_ctx_impl->aio_pg_omap_read(c->pc, reads, results);
+}
+
 
 
 uint64_t librados::IoCtx::get_last_version()
@@ -2101,6 +2108,14 @@ int librados::IoCtx::aio_notify(const string& oid, AioCompletion *c,
                                  NULL);
 }
 
+int librados::IoCtx::notify_no_ack(const string& oid, bufferlist& bl,
+				   bufferlist *preplybl)
+{
+  object_t obj(oid);
+  return io_ctx_impl->notify(obj, bl, 0, preplybl, NULL, NULL,
+			     CEPH_OSD_NOTIFY_FLAG_NO_ACK);
+}
+
 void librados::IoCtx::notify_ack(const std::string& o,
 				 uint64_t notify_id, uint64_t handle,
 				 bufferlist& bl)
@@ -57,6 +57,12 @@
  * data operations are happening and vice versa. It thus makes sure that the layout
  * of a striped object does not change during data operation, which is essential for
  * data consistency.
+ * Two options trade some of that safety for fewer round trips to the first object :
+ *  - rados_striper_lockless_reads makes reads skip the shared lock, for striped
+ *    objects which are not truncated or removed while they are read
+ *  - rados_striper_write_lock_lease makes writes keep their shared lock for
+ *    that long, and reuse it for the writes that follow instead of locking,
+ *    loading the layout and unlocking every time
  *
  * Still the writing to a striped object is not atomic. This means in particular that
  * the size of an object may not be in sync with its content at all times.
@@ -251,6 +257,8 @@ struct WriteCompletionData : CompletionData {
   librados::AioCompletion *m_unlockCompletion;
   /// return code of write completion, to be remembered until unlocking happened
   int m_writeRc;
+  /// whether the lock was kept as a lease rather than unlocked
+  bool m_keptLock;
   /// constructor
   WriteCompletionData(libradosstriper::RadosStriperImpl * striper,
 		      const std::string& soid,
@@ -274,7 +282,7 @@ WriteCompletionData::WriteCompletionData
  librados::AioCompletionImpl *userCompletion,
  int n) :
   CompletionData(striper, soid, lockCookie, userCompletion, n), m_safe(0),
-  m_unlockCompletion(0), m_writeRc(0) {
+  m_unlockCompletion(0), m_writeRc(0), m_keptLock(false) {
   if (userCompletion) {
     m_safe = new librados::IoCtxImpl::C_aio_Complete(userCompletion);
   }
@@ -439,7 +447,15 @@ struct RadosRemoveCompletionData : RefCountedObject {
 
 libradosstriper::RadosStriperImpl::RadosStriperImpl(librados::IoCtx& ioctx, librados::IoCtxImpl *ioctx_impl) :
   m_refCnt(0),lock("RadosStriper Refcont", false, false), m_radosCluster(ioctx), m_ioCtx(ioctx), m_ioCtxImpl(ioctx_impl),
-  m_layout(default_file_layout) {}
+  m_layout(default_file_layout), m_leaseLock("RadosStriper leases", false, false) {}
+
+libradosstriper::RadosStriperImpl::~RadosStriperImpl()
+{
+  // no write is in flight anymore, give up all leases
+  for (auto& lease : m_writeLeases) {
+    unlockObject(lease.first, lease.second.cookie);
+  }
+}
 
 ///////////////////////// layout /////////////////////////////
 
@@ -624,6 +640,15 @@ static void rados_read_aio_unlock_complete(rados_striper_multi_completion_t c, v
 static void striper_read_aio_req_complete(rados_striper_multi_completion_t c, void *arg)
 {
   auto cdata = reinterpret_cast<ReadCompletionData*>(arg);
+  if (cdata->m_lockCookie.empty()) {
+    // lockless read, nothing to unlock
+    libradosstriper::MultiAioCompletionImpl *comp =
+      reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
+    cdata->complete_read(comp->rval);
+    cdata->complete_unlock(0);
+    cdata->put();
+    return;
+  }
   // launch the async unlocking of the object
   cdata->m_striper->aio_unlockObject(cdata->m_soid, cdata->m_lockCookie, cdata->m_unlockCompletion);
   // complete the read part in parallel
@@ -994,6 +1019,7 @@ int libradosstriper::RadosStriperImpl::aio_remove(const std::string& soid,
 {
   // the RemoveCompletionData object will lock the given soid for the duration
   // of the removal
+  dropWriteLease(soid);
   std::string lockCookie = getUUID();
   int rc = m_ioCtx.lock_exclusive(getObjectId(soid, 0), RADOS_LOCK_NAME, lockCookie, "", 0, 0);
   if (rc) return rc;
@@ -1089,6 +1115,7 @@ int libradosstriper::RadosStriperImpl::internal_aio_remove(
 int libradosstriper::RadosStriperImpl::trunc(const std::string& soid, uint64_t size)
 {
   // lock the object in exclusive mode
+  dropWriteLease(soid);
   std::string firstObjOid = getObjectId(soid, 0);
   librados::ObjectWriteOperation op;
   op.assert_exists();
@@ -1142,6 +1169,90 @@ void libradosstriper::RadosStriperImpl::aio_unlockObject(const std::string& soid
   m_ioCtx.aio_unlock(firstObjOid, RADOS_LOCK_NAME, lockCookie, c);
 }
 
+bool libradosstriper::RadosStriperImpl::getWriteLease(const std::string& soid,
+						      ceph_file_layout *layout,
+						      std::string *lockCookie)
+{
+  Mutex::Locker l(m_leaseLock);
+  auto it = m_writeLeases.find(soid);
+  if (it == m_writeLeases.end() ||
+      it->second.expires <= ceph::mono_clock::now()) {
+    return false;
+  }
+  it->second.refs++;
+  *layout = it->second.layout;
+  *lockCookie = it->second.cookie;
+  return true;
+}
+
+void libradosstriper::RadosStriperImpl::addWriteLease(const std::string& soid,
+						      const ceph_file_layout& layout,
+						      const std::string& lockCookie,
+						      ceph::timespan duration)
+{
+  const auto now = ceph::mono_clock::now();
+  std::vector<std::pair<std::string, std::string>> stale;
+  {
+    Mutex::Locker l(m_leaseLock);
+    // give up the leases nobody uses anymore, the writes holding a
+    // reference on a replaced one will unlock it themselves
+    for (auto it = m_writeLeases.begin(); it != m_writeLeases.end();) {
+      if (it->first == soid || (it->second.expires <= now && !it->second.refs)) {
+	if (!it->second.refs) {
+	  stale.emplace_back(it->first, it->second.cookie);
+	}
+	it = m_writeLeases.erase(it);
+      } else {
+	++it;
+      }
+    }
+    // leave the writes using it half the duration to complete
+    auto& lease = m_writeLeases[soid];
+    lease.cookie = lockCookie;
+    lease.layout = layout;
+    lease.expires = now + duration / 2;
+    lease.refs = 1;
+  }
+  for (auto& s : stale) {
+    librados::AioCompletion *c = librados::Rados::aio_create_completion();
+    aio_unlockObject(s.first, s.second, c);
+    c->release();
+  }
+}
+
+bool libradosstriper::RadosStriperImpl::putWriteLease(const std::string& soid,
+						      const std::string& lockCookie)
+{
+  Mutex::Locker l(m_leaseLock);
+  auto it = m_writeLeases.find(soid);
+  if (it == m_writeLeases.end() || it->second.cookie != lockCookie) {
+    return true;
+  }
+  ceph_assert(it->second.refs > 0);
+  it->second.refs--;
+  return false;
+}
+
+void libradosstriper::RadosStriperImpl::dropWriteLease(const std::string& soid)
+{
+  std::string lockCookie;
+  {
+    Mutex::Locker l(m_leaseLock);
+    auto it = m_writeLeases.find(soid);
+    if (it == m_writeLeases.end()) {
+      return;
+    }
+    // writes still using it will unlock it once they complete
+    if (!it->second.refs) {
+      lockCookie = it->second.cookie;
+    }
+    m_writeLeases.erase(it);
+  }
+  if (!lockCookie.empty()) {
+    unlockObject(soid, lockCookie);
+  }
+}
+
 static void rados_write_aio_unlock_complete(rados_striper_multi_completion_t c, void *arg)
 {
   auto cdata = reinterpret_cast<WriteCompletionData*>(arg);
@@ -1154,6 +1265,18 @@ static void rados_write_aio_unlock_complete(rados_striper_multi_completion_t c,
 static void striper_write_aio_req_complete(rados_striper_multi_completion_t c, void *arg)
 {
   auto cdata = reinterpret_cast<WriteCompletionData*>(arg);
+  if (!cdata->m_striper->putWriteLease(cdata->m_soid, cdata->m_lockCookie)) {
+    // the lock is a lease, it stays for the writes that follow
+    libradosstriper::MultiAioCompletionImpl *comp =
+      reinterpret_cast<libradosstriper::MultiAioCompletionImpl*>(c);
+    cdata->m_keptLock = true;
+    cdata->complete_write(comp->rval);
+    cdata->complete_unlock(0);
+    // drop the reference of the unlocking, which won't happen, and ours
+    cdata->put();
+    cdata->put();
+    return;
+  }
   // launch the async unlocking of the object
   cdata->m_striper->aio_unlockObject(cdata->m_soid, cdata->m_lockCookie, cdata->m_unlockCompletion);
   // complete the write part in parallel
@@ -1199,7 +1322,9 @@ int libradosstriper::RadosStriperImpl::write_in_open_object(const std::string& s
     c->wait_for_complete_and_cb();
     c->wait_for_safe_and_cb();
     // wait for the unlocking
-    unlock_completion->wait_for_complete();
+    if (!cdata->m_keptLock) {
+      unlock_completion->wait_for_complete();
+    }
     // return result
     rc = c->get_return_value();
   }
@@ -1376,6 +1501,12 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForRead(
   uint64_t *size,
   std::string *lockCookie)
 {
+  std::string firstObjOid = getObjectId(soid, 0);
+  if (cct()->_conf.get_val<bool>("rados_striper_lockless_reads")) {
+    // an empty cookie tells the read completion not to unlock
+    lockCookie->clear();
+    return internal_get_layout_and_size(firstObjOid, layout, size);
+  }
   // take a lock the first rados object, if it exists and gets its size
   // check, lock and size reading must be atomic and are thus done within a single operation
   librados::ObjectWriteOperation op;
@@ -1383,7 +1514,6 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForRead(
   *lockCookie = getUUID();
   utime_t dur = utime_t();
   rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, *lockCookie, "Tag", "", dur, 0);
-  std::string firstObjOid = getObjectId(soid, 0);
   int rc = m_ioCtx.operate(firstObjOid, &op);
   if (rc) {
     // error case (including -ENOENT)
@@ -1407,10 +1537,14 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForWrite(const std::stri
 {
   // take a lock the first rados object, if it exists
   // check and lock must be atomic and are thus done within a single operation
+  // appends need the current size anyway, so only writes keep their lock
+  const double lease = isFileSizeAbsolute ?
+    cct()->_conf.get_val<double>("rados_striper_write_lock_lease") : 0;
   librados::ObjectWriteOperation op;
   op.assert_exists();
   *lockCookie = getUUID();
   utime_t dur = utime_t();
+  dur.set_from_double(lease);
   rados::cls::lock::lock(&op, RADOS_LOCK_NAME, LOCK_SHARED, *lockCookie, "Tag", "", dur, 0);
   std::string firstObjOid = getObjectId(soid, 0);
   int rc = m_ioCtx.operate(firstObjOid, &op);
@@ -1438,34 +1572,57 @@ int libradosstriper::RadosStriperImpl::openStripedObjectForWrite(const std::stri
   // atomically update object size, only if smaller than current one
   if (!isFileSizeAbsolute)
     *size += curSize;
-  librados::ObjectWriteOperation writeOp;
-  writeOp.cmpxattr(XATTR_SIZE, LIBRADOS_CMPXATTR_OP_GT, *size);
-  std::ostringstream oss;
-  oss << *size;
-  bufferlist bl;
-  bl.append(oss.str());
-  writeOp.setxattr(XATTR_SIZE, bl);
-  rc = m_ioCtx.operate(firstObjOid, &writeOp);
+  rc = growStripedObjectSize(firstObjOid, *size);
   // return current size
   *size = curSize;
-  // handle case where objectsize is already bigger than size
-  if (-ECANCELED == rc) 
-    rc = 0;
   if (rc) {
     unlockObject(soid, *lockCookie);
     lderr(cct()) << "RadosStriperImpl::openStripedObjectForWrite : "
 		   << "could not set new size for "
 		   << soid << " : rc = " << rc << dendl;
+    return rc;
+  }
+  if (lease > 0) {
+    addWriteLease(soid, *layout, *lockCookie, ceph::make_timespan(lease));
   }
   return rc;
 }
 
+int libradosstriper::RadosStriperImpl::growStripedObjectSize(const std::string& firstObjOid,
+							     uint64_t size)
+{
+  librados::ObjectWriteOperation writeOp;
+  writeOp.cmpxattr(XATTR_SIZE, LIBRADOS_CMPXATTR_OP_GT, size);
+  std::ostringstream oss;
+  oss << size;
+  bufferlist bl;
+  bl.append(oss.str());
+  writeOp.setxattr(XATTR_SIZE, bl);
+  int rc = m_ioCtx.operate(firstObjOid, &writeOp);
+  // handle case where objectsize is already bigger than size
+  if (-ECANCELED == rc)
+    rc = 0;
+  return rc;
+}
+
 int libradosstriper::RadosStriperImpl::createAndOpenStripedObject(const std::string& soid,
 								  ceph_file_layout *layout,
 								  uint64_t size,
 								  std::string *lockCookie,
 								  bool isFileSizeAbsolute)
 {
+  // a lease means the object exists and can't change layout, so only its
+  // size needs updating
+  if (isFileSizeAbsolute && getWriteLease(soid, layout, lockCookie)) {
+    int rc = growStripedObjectSize(getObjectId(soid, 0), size);
+    if (rc) {
+      putWriteLease(soid, *lockCookie);
+      lderr(cct()) << "RadosStriperImpl::createAndOpenStripedObject : "
+		   << "could not set new size for "
+		   << soid << " : rc = " << rc << dendl;
+    }
+    return rc;
+  }
   // build atomic write operation
   librados::ObjectWriteOperation writeOp;
   writeOp.create(true);
@@ -15,6 +15,7 @@
 #ifndef CEPH_LIBRADOSSTRIPER_RADOSSTRIPERIMPL_H
 #define CEPH_LIBRADOSSTRIPER_RADOSSTRIPERIMPL_H
 
+#include <map>
 #include <string>
 
 #include "include/rados/librados.h"
@@ -26,6 +27,7 @@
 #include "librados/IoCtxImpl.h"
 #include "librados/AioCompletionImpl.h"
 #include "common/RefCountedObj.h"
+#include "common/ceph_time.h"
 
 namespace libradosstriper {
 
@@ -51,7 +53,7 @@ struct RadosStriperImpl {
    */
   RadosStriperImpl(librados::IoCtx& ioctx, librados::IoCtxImpl *ioctx_impl);
   /// Destructor
-  ~RadosStriperImpl() {};
+  ~RadosStriperImpl();
 
   // configuration
   int setObjectLayoutStripeUnit(unsigned int stripe_unit);
@@ -137,6 +139,41 @@ struct RadosStriperImpl {
                         const std::string& lockCookie,
                         librados::AioCompletion *c);
 
+  /**
+   * shared locks kept past the write that took them, see
+   * rados_striper_write_lock_lease
+   */
+  struct WriteLease {
+    std::string cookie;
+    ceph_file_layout layout;
+    /// new writes stop using the lease after this
+    ceph::mono_time expires;
+    /// writes in flight with the lease
+    unsigned refs = 0;
+  };
+
+  /**
+   * looks for a lease on the given striped object and takes a reference
+   * on it if it is still young enough to be reused
+   * @return true if it found one, with layout and lockCookie filled
+   */
+  bool getWriteLease(const std::string& soid,
+		     ceph_file_layout *layout,
+		     std::string *lockCookie);
+  /// records the lock a write just took as a lease it holds a reference on
+  void addWriteLease(const std::string& soid,
+		     const ceph_file_layout& layout,
+		     const std::string& lockCookie,
+		     ceph::timespan duration);
+  /**
+   * drops the reference a completed write held on its lock
+   * @return true if the lock is not a lease and should be unlocked
+   */
+  bool putWriteLease(const std::string& soid,
+		     const std::string& lockCookie);
+  /// stops using the lease of the given object, before locking it exclusively
+  void dropWriteLease(const std::string& soid);
+
   // internal versions of IO method
   int write_in_open_object(const std::string& soid,
 			   const ceph_file_layout& layout,
@@ -170,6 +207,9 @@ struct RadosStriperImpl {
 				   ceph_file_layout *layout,
 				   uint64_t *size);
 
+  /// atomically sets the size of a striped object, unless it is already bigger
+  int growStripedObjectSize(const std::string& firstObjOid, uint64_t size);
+
   int internal_aio_remove(const std::string& soid,
 			  MultiAioCompletionImplPtr multi_completion,
 			  int flags=0);
@@ -269,6 +309,10 @@ struct RadosStriperImpl {
 
   // Default layout
   ceph_file_layout m_layout;
+
+  // write leases, by striped object
+  Mutex m_leaseLock;
+  std::map<std::string, WriteLease> m_writeLeases;
 };
 }
 #endif
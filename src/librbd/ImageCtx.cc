@@ -283,6 +283,10 @@ public:
     plb.add_u64_counter(l_librbd_readahead, "readahead", "Read ahead");
     plb.add_u64_counter(l_librbd_readahead_bytes, "readahead_bytes", "Data size in read ahead", NULL, 0, unit_t(UNIT_BYTES));
     plb.add_u64_counter(l_librbd_invalidate_cache, "invalidate_cache", "Cache invalidates");
+    plb.add_u64_counter(l_librbd_io_sched_delayed, "io_sched_delayed",
+                        "Writes delayed by the IO scheduler to merge them");
+    plb.add_u64_counter(l_librbd_io_sched_merged, "io_sched_merged",
+                        "Delayed writes merged into another write");
 
     plb.add_time(l_librbd_opened_time, "opened_time", "Opened time",
                  "ots", perf_prio);
@@ -759,6 +763,7 @@ public:
 
     bool skip_partial_discard = true;
     ASSIGN_OPTION(non_blocking_aio, bool);
+    ASSIGN_OPTION(direct_dispatch_aio, bool);
     ASSIGN_OPTION(cache, bool);
     ASSIGN_OPTION(sparse_read_threshold_bytes, Option::size_t);
     ASSIGN_OPTION(readahead_max_bytes, Option::size_t);
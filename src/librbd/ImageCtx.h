@@ -178,6 +178,7 @@ namespace librbd {
 
     /// Cached latency-sensitive configuration settings
     bool non_blocking_aio;
+    bool direct_dispatch_aio;
     bool cache;
     uint64_t sparse_read_threshold_bytes;
     uint64_t readahead_max_bytes;
@@ -49,6 +49,9 @@ enum {
 
   l_librbd_invalidate_cache,
 
+  l_librbd_io_sched_delayed,
+  l_librbd_io_sched_merged,
+
   l_librbd_opened_time,
   l_librbd_lock_acquired_time,
 
@@ -56,6 +56,22 @@ struct DiffContext {
   }
 };
 
+// whether the parent shows through any part of the object
+bool intersects_parent_diff(const DiffContext &diff_context, uint64_t offset,
+                            const std::vector<ObjectExtent> &object_extents) {
+  if (diff_context.from_snap_id != 0 || diff_context.parent_diff.empty()) {
+    return false;
+  }
+  for (auto &q : object_extents) {
+    for (auto &r : q.buffer_extents) {
+      if (diff_context.parent_diff.intersects(offset + r.first, r.second)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
 class C_DiffObject : public Context {
 public:
   template <typename I>
@@ -305,16 +321,20 @@ int DiffIterate<I>::execute() {
 
   int r;
   bool fast_diff_enabled = false;
+  bool object_diff_valid = false;
   BitVector<2> object_diff_state;
   {
     RWLock::RLocker image_locker(m_image_ctx.image_lock);
-    if (m_whole_object && (m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
+    if ((m_image_ctx.features & RBD_FEATURE_FAST_DIFF) != 0) {
       r = diff_object_map(from_snap_id, end_snap_id, &object_diff_state);
       if (r < 0) {
         ldout(cct, 5) << "fast diff disabled" << dendl;
       } else {
+        // a whole object diff comes from the object map alone, otherwise
+        // it still rules out the objects that did not change
         ldout(cct, 5) << "fast diff enabled" << dendl;
-        fast_diff_enabled = true;
+        fast_diff_enabled = m_whole_object;
+        object_diff_valid = true;
       }
     }
   }
@@ -356,6 +376,23 @@ int DiffIterate<I>::execute() {
     uint64_t period_off = off - (off % period);
     uint64_t read_len = min(period_off + period - off, left);
 
+    if (fast_diff_enabled && m_image_ctx.get_stripe_count() == 1) {
+      // without fancy striping a period is one object: skip the mapping
+      const uint64_t object_no = off / period;
+      if (object_no < object_diff_state.size() &&
+          object_diff_state[object_no] != OBJECT_DIFF_STATE_NONE) {
+        bool updated = (object_diff_state[object_no] ==
+                          OBJECT_DIFF_STATE_UPDATED);
+        r = m_callback(off, read_len, updated, m_callback_arg);
+        if (r < 0) {
+          return r;
+        }
+      }
+      left -= read_len;
+      off += read_len;
+      continue;
+    }
+
     // map to extents
     map<object_t,vector<ObjectExtent> > object_extents;
     Striper::file_to_extents(cct, m_image_ctx.format_string,
@@ -382,6 +419,14 @@ int DiffIterate<I>::execute() {
           }
         }
       } else {
+        const uint64_t object_no = p->second.front().objectno;
+        if (object_diff_valid && object_no < object_diff_state.size() &&
+            object_diff_state[object_no] == OBJECT_DIFF_STATE_NONE &&
+            !intersects_parent_diff(diff_context, off, p->second)) {
+          ldout(cct, 20) << "object " << p->first << ": unchanged" << dendl;
+          continue;
+        }
+
         C_DiffObject *diff_object = new C_DiffObject(m_image_ctx, head_ctx,
                                                      diff_context,
                                                      p->first.name, off,
@@ -113,13 +113,16 @@ void ObjectCacherObjectDispatch<I>::init() {
     m_image_ctx->config.template get_val<bool>("rbd_cache_block_writes_upfront");
   auto max_dirty_object =
     m_image_ctx->config.template get_val<uint64_t>("rbd_cache_max_dirty_object");
+  m_bypass_min_size =
+    m_image_ctx->config.template get_val<Option::size_t>("rbd_cache_bypass_min_size");
 
   ldout(cct, 5) << "Initial cache settings:"
                 << " size=" << cache_size
                 << " num_objects=" << 10
                 << " max_dirty=" << init_max_dirty
                 << " target_dirty=" << target_dirty
-                << " max_dirty_age=" << max_dirty_age << dendl;
+                << " max_dirty_age=" << max_dirty_age
+                << " bypass_min_size=" << m_bypass_min_size << dendl;
 
   m_object_cacher = new ObjectCacher(cct, m_image_ctx->perfcounter->get_name(),
                                      *m_writeback_handler, m_cache_lock,
@@ -176,6 +179,14 @@ void ObjectCacherObjectDispatch<I>::shut_down(Context* on_finish) {
   m_cache_lock.Unlock();
 }
 
+template <typename I>
+bool ObjectCacherObjectDispatch<I>::should_bypass(uint64_t object_off,
+                                                  uint64_t object_len) const {
+  return (m_bypass_min_size > 0 && object_len >= m_bypass_min_size &&
+          (object_off & ~CEPH_PAGE_MASK) == 0 &&
+          (object_len & ~CEPH_PAGE_MASK) == 0);
+}
+
 template <typename I>
 bool ObjectCacherObjectDispatch<I>::read(
     const std::string &oid, uint64_t object_no, uint64_t object_off,
@@ -203,9 +214,24 @@ bool ObjectCacherObjectDispatch<I>::read(
   rd->extents.push_back(extent);
 
   ZTracer::Trace trace(parent_trace);
-  *dispatch_result = io::DISPATCH_RESULT_COMPLETE;
 
   m_cache_lock.Lock();
+  if (should_bypass(object_off, object_len) &&
+      !m_object_cacher->is_cached(m_object_set, rd->extents, snap_id)) {
+    ldout(cct, 20) << "bypassing cache" << dendl;
+    delete rd;
+
+    // flush any dirty data in the range and read it from the OSD
+    *dispatch_result = io::DISPATCH_RESULT_CONTINUE;
+    ObjectExtents object_extents;
+    object_extents.emplace_back(oid, object_no, object_off, object_len, 0);
+    m_object_cacher->flush_set(m_object_set, object_extents, &trace,
+                               on_dispatched);
+    m_cache_lock.Unlock();
+    return true;
+  }
+
+  *dispatch_result = io::DISPATCH_RESULT_COMPLETE;
   int r = m_object_cacher->readx(rd, m_object_set, on_dispatched, &trace);
   m_cache_lock.Unlock();
   if (r != 0) {
@@ -270,6 +296,34 @@ bool ObjectCacherObjectDispatch<I>::write(
   on_dispatched = util::create_async_context_callback(*m_image_ctx,
                                                       on_dispatched);
 
+  if (should_bypass(object_off, data.length())) {
+    ldout(cct, 20) << "bypassing cache" << dendl;
+
+    // as with a discard: the write replaces whatever the cache holds for
+    // the range, once writeback of it has completed, and the data read
+    // into the cache meanwhile is dropped when the write commits
+    ObjectExtents object_extents;
+    object_extents.emplace_back(oid, object_no, object_off, data.length(), 0);
+
+    auto ctx = *on_finish;
+    *on_finish = new FunctionContext(
+      [this, object_extents, ctx](int r) {
+        m_cache_lock.Lock();
+        m_object_cacher->discard_set(m_object_set, object_extents);
+        m_cache_lock.Unlock();
+
+        ctx->complete(r);
+      });
+
+    *dispatch_result = io::DISPATCH_RESULT_CONTINUE;
+
+    m_cache_lock.Lock();
+    m_object_cacher->discard_writeback(m_object_set, object_extents,
+                                       on_dispatched);
+    m_cache_lock.Unlock();
+    return true;
+  }
+
   m_image_ctx->image_lock.get_read();
   ObjectCacher::OSDWrite *wr = m_object_cacher->prepare_write(
     snapc, data, ceph::real_time::min(), op_flags, *journal_tid);
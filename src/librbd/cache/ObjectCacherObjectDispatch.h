@@ -108,6 +108,10 @@ private:
 
   bool m_user_flushed = false;
 
+  uint64_t m_bypass_min_size = 0;
+
+  bool should_bypass(uint64_t object_off, uint64_t object_len) const;
+
 };
 
 } // namespace cache
@@ -0,0 +1,1189 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "WriteLogImageCache.h"
+#include "include/buffer.h"
+#include "include/compat.h"
+#include "include/intarith.h"
+#include "include/random.h"
+#include "include/stringify.h"
+#include "cls/rbd/cls_rbd_client.h"
+#include "common/Formatter.h"
+#include "common/dout.h"
+#include "common/errno.h"
+#include "common/hostname.h"
+#include "common/safe_io.h"
+#include "common/Thread.h"
+#include "common/WorkQueue.h"
+#include "json_spirit/json_spirit.h"
+#include "librbd/ExclusiveLock.h"
+#include "librbd/ImageCtx.h"
+#include "librbd/Utils.h"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#define dout_subsys ceph_subsys_rbd
+#undef dout_prefix
+#define dout_prefix *_dout << "librbd::cache::WriteLogImageCache: " << this \
+                           << " " <<  __func__ << ": "
+
+namespace librbd {
+namespace cache {
+
+namespace {
+
+const uint32_t SUPERBLOCK_MAGIC = 0x52424c53; // "RBLS"
+const uint32_t ENTRY_MAGIC = 0x52424c45;      // "RBLE"
+const uint8_t LOG_VERSION = 1;
+
+// header length, magic, log id, log seq, extent count, data length,
+// data crc and header crc, then 16 bytes per extent
+const uint64_t ENTRY_HEADER_BASE = 4 + 4 + 8 + 8 + 4 + 4 + 4 + 4;
+const uint64_t ENTRY_HEADER_PER_EXTENT = 16;
+
+// image metadata key for the cache state
+const std::string IMAGE_CACHE_STATE(".rbd_persistent_cache_state");
+
+/// which log holds the image's writes, and if they are all written back
+struct CacheState {
+  bool clean = true;
+  std::string host;
+  std::string path;
+  uint64_t log_id = 0;
+
+  std::string to_json() const {
+    JSONFormatter f;
+    f.open_object_section("state");
+    f.dump_bool("clean", clean);
+    f.dump_string("host", host);
+    f.dump_string("path", path);
+    f.dump_string("log_id", stringify(log_id));
+    f.close_section();
+    std::ostringstream oss;
+    f.flush(oss);
+    return oss.str();
+  }
+
+  bool from_json(const std::string &s) {
+    json_spirit::mValue json_root;
+    if (!json_spirit::read(s, json_root)) {
+      return false;
+    }
+    try {
+      auto &json_obj = json_root.get_obj();
+      clean = json_obj.at("clean").get_bool();
+      host = json_obj.at("host").get_str();
+      path = json_obj.at("path").get_str();
+      log_id = std::stoull(json_obj.at("log_id").get_str());
+    } catch (std::exception&) {
+      return false;
+    }
+    return true;
+  }
+};
+
+bool overlaps(const ImageCache::Extents &a, const ImageCache::Extents &b) {
+  for (auto &x : a) {
+    for (auto &y : b) {
+      if (x.first < y.first + y.second && y.first < x.first + x.second) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// copy the parts of a write that a read covers over the data it read
+void overlay(const ImageCache::Extents &read_extents, bufferlist *read_bl,
+             const ImageCache::Extents &write_extents,
+             const bufferlist &write_bl) {
+  uint64_t read_length = 0;
+  for (auto &extent : read_extents) {
+    read_length += extent.second;
+  }
+  if (read_bl->length() < read_length) {
+    read_bl->append_zero(read_length - read_bl->length());
+  }
+  char *dst = read_bl->c_str();
+
+  uint64_t read_off = 0;
+  for (auto &r : read_extents) {
+    uint64_t write_off = 0;
+    for (auto &w : write_extents) {
+      uint64_t start = std::max(r.first, w.first);
+      uint64_t end = std::min(r.first + r.second, w.first + w.second);
+      if (start < end) {
+        auto p = write_bl.cbegin();
+        p.advance(write_off + start - w.first);
+        p.copy(end - start, dst + read_off + start - r.first);
+      }
+      write_off += w.second;
+    }
+    read_off += r.second;
+  }
+}
+
+int read_fd(int fd, uint64_t offset, uint64_t length, bufferlist *bl) {
+  bufferptr bp = buffer::create(length);
+  int r = safe_pread_exact(fd, bp.c_str(), length, offset);
+  if (r < 0) {
+    return r;
+  }
+  bl->append(std::move(bp));
+  return 0;
+}
+
+} // anonymous namespace
+
+template <typename I>
+WriteLogImageCache<I>::WriteLogImageCache(I &image_ctx,
+                                          const std::string &path,
+                                          uint64_t size)
+  : m_image_ctx(image_ctx), m_image_writeback(image_ctx), m_path(path),
+    m_host(ceph_get_short_hostname()), m_size(size) {
+}
+
+template <typename I>
+WriteLogImageCache<I>::~WriteLogImageCache() {
+  ceph_assert(!m_log_thread.joinable());
+  ceph_assert(m_fd < 0);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_read(Extents &&image_extents, bufferlist *bl,
+                                     int fadvise_flags, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  // the writes still in the log that the read overlaps, oldest first,
+  // are copied over what the image has
+  std::vector<std::pair<Extents, bufferlist>> overlays;
+  int r = 0;
+  {
+    RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
+    bool lock_owner = (m_image_ctx.exclusive_lock != nullptr &&
+                       m_image_ctx.exclusive_lock->is_lock_owner());
+
+    std::lock_guard locker{m_lock};
+    bool pass_through = false;
+    for (auto &entry : m_entries) {
+      if (entry->state == ENTRY_DESTAGED) {
+        continue;
+      } else if (entry->pass_through) {
+        pass_through = true;
+        break;
+      } else if (overlaps(entry->image_extents, image_extents)) {
+        overlays.emplace_back(entry->image_extents, entry->bl);
+      }
+    }
+
+    if (pass_through) {
+      // a pass-through op can't be applied on top: wait until the latest
+      // entry the read depends on is destaged, which only the lock owner
+      // does
+      uint64_t seq = 0;
+      for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it) {
+        auto &entry = *it;
+        if (entry->state == ENTRY_DESTAGED) {
+          continue;
+        }
+        if (entry->pass_through ||
+            overlaps(entry->image_extents, image_extents)) {
+          seq = entry->seq;
+          break;
+        }
+      }
+      if (!lock_owner) {
+        lderr(cct) << "not the lock owner, cannot wait for seq=" << seq
+                   << dendl;
+        r = -EROFS;
+      } else {
+        ldout(cct, 20) << "waiting for seq=" << seq << dendl;
+        m_destage_waiters.emplace_back(seq, new FunctionContext(
+          [this, image_extents=std::move(image_extents), bl, fadvise_flags,
+           on_finish](int r) mutable {
+            if (r < 0) {
+              on_finish->complete(r);
+              return;
+            }
+            m_image_writeback.aio_read(std::move(image_extents), bl,
+                                       fadvise_flags, on_finish);
+          }));
+        return;
+      }
+    }
+  }
+
+  if (r < 0) {
+    m_image_ctx.op_work_queue->queue(on_finish, r);
+    return;
+  }
+  if (!overlays.empty()) {
+    ldout(cct, 20) << "reading " << overlays.size() << " entries from the log"
+                   << dendl;
+    Extents read_extents = image_extents;
+    on_finish = new FunctionContext(
+      [read_extents=std::move(read_extents), bl,
+       overlays=std::move(overlays), on_finish](int r) {
+        if (r >= 0) {
+          for (auto &o : overlays) {
+            overlay(read_extents, bl, o.first, o.second);
+          }
+        }
+        on_finish->complete(r);
+      });
+  }
+  m_image_writeback.aio_read(std::move(image_extents), bl, fadvise_flags,
+                             on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_write(Extents &&image_extents,
+                                      bufferlist&& bl,
+                                      int fadvise_flags,
+                                      Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  if (entry_length(image_extents, bl.length()) > m_size - SUPERBLOCK_SIZE) {
+    // too large for the log: write it through, in order
+    queue_pass_through(
+      [this, image_extents=std::move(image_extents), bl=std::move(bl),
+       fadvise_flags](Context *ctx) mutable {
+        m_image_writeback.aio_write(std::move(image_extents), std::move(bl),
+                                    fadvise_flags, ctx);
+      }, on_finish);
+    return;
+  }
+
+  auto entry = std::make_unique<LogEntry>();
+  entry->image_extents = std::move(image_extents);
+  entry->bl = std::move(bl);
+  entry->fadvise_flags = fadvise_flags;
+  entry->on_finish = on_finish;
+
+  std::lock_guard locker{m_lock};
+  entry->seq = m_next_seq++;
+  m_append_queue.push_back(entry.get());
+  m_entries.push_back(std::move(entry));
+  m_cond.notify_all();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_discard(uint64_t offset, uint64_t length,
+                                        uint32_t discard_granularity_bytes,
+                                        Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  queue_pass_through(
+    [this, offset, length, discard_granularity_bytes](Context *ctx) {
+      m_image_writeback.aio_discard(offset, length, discard_granularity_bytes,
+                                    ctx);
+    }, on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "on_finish=" << on_finish << dendl;
+
+  {
+    std::lock_guard locker{m_lock};
+    uint64_t seq = m_next_seq - 1;
+    if (first_appending_seq() <= seq) {
+      m_durable_waiters.emplace_back(seq, on_finish);
+      return;
+    }
+  }
+  m_image_ctx.op_work_queue->queue(on_finish, 0);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_writesame(uint64_t offset, uint64_t length,
+                                          bufferlist&& bl, int fadvise_flags,
+                                          Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "offset=" << offset << ", "
+                 << "length=" << length << ", "
+                 << "data_len=" << bl.length() << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  queue_pass_through(
+    [this, offset, length, bl=std::move(bl),
+     fadvise_flags](Context *ctx) mutable {
+      m_image_writeback.aio_writesame(offset, length, std::move(bl),
+                                      fadvise_flags, ctx);
+    }, on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::aio_compare_and_write(Extents &&image_extents,
+                                                  bufferlist&& cmp_bl,
+                                                  bufferlist&& bl,
+                                                  uint64_t *mismatch_offset,
+                                                  int fadvise_flags,
+                                                  Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "image_extents=" << image_extents << ", "
+                 << "on_finish=" << on_finish << dendl;
+
+  queue_pass_through(
+    [this, image_extents=std::move(image_extents), cmp_bl=std::move(cmp_bl),
+     bl=std::move(bl), mismatch_offset, fadvise_flags](Context *ctx) mutable {
+      m_image_writeback.aio_compare_and_write(
+        std::move(image_extents), std::move(cmp_bl), std::move(bl),
+        mismatch_offset, fadvise_flags, ctx);
+    }, on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::init(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << "path=" << m_path << dendl;
+
+  m_fd = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (m_fd < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to open " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    m_image_ctx.op_work_queue->queue(on_finish, r);
+    return;
+  }
+
+  // another client on this host may have the log open
+  if (::flock(m_fd, LOCK_EX | LOCK_NB) < 0) {
+    int r = -errno;
+    lderr(cct) << "failed to lock " << m_path << ": " << cpp_strerror(r)
+               << dendl;
+    close_log();
+    m_image_ctx.op_work_queue->queue(on_finish,
+                                     r == -EWOULDBLOCK ? -EBUSY : r);
+    return;
+  }
+
+  get_state(on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::get_state(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << dendl;
+
+  librados::ObjectReadOperation op;
+  cls_client::metadata_get_start(&op, IMAGE_CACHE_STATE);
+
+  m_out_bl.clear();
+  librados::AioCompletion *comp = util::create_rados_callback(
+    new FunctionContext([this, on_finish](int r) {
+        handle_get_state(r, on_finish);
+      }));
+  int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid, comp, &op,
+                                         &m_out_bl);
+  ceph_assert(r == 0);
+  comp->release();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::handle_get_state(int r, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  CacheState state;
+  if (r == 0) {
+    std::string value;
+    auto it = m_out_bl.cbegin();
+    r = cls_client::metadata_get_finish(&it, &value);
+    if (r == 0 && !state.from_json(value)) {
+      r = -EBADMSG;
+    }
+  } else if (r == -ENOENT) {
+    r = 0;
+  }
+  if (r < 0) {
+    lderr(cct) << "failed to get cache state: " << cpp_strerror(r) << dendl;
+    close_log();
+    on_finish->complete(r);
+    return;
+  }
+
+  if (!state.clean) {
+    // only the log the state names holds the writes still to write back
+    if (state.host != m_host || state.path != m_path) {
+      lderr(cct) << "image has writes not written back in the cache at "
+                 << state.host << ":" << state.path << dendl;
+      close_log();
+      on_finish->complete(-EBUSY);
+      return;
+    }
+
+    uint64_t tail_offset;
+    uint64_t tail_log_seq;
+    r = read_superblock(&tail_offset, &tail_log_seq);
+    if (r < 0 || m_log_id != state.log_id) {
+      lderr(cct) << "image has writes not written back in a log lost from "
+                 << m_path << ", remove its " << IMAGE_CACHE_STATE
+                 << " metadata to discard them" << dendl;
+      close_log();
+      on_finish->complete(-EINVAL);
+      return;
+    }
+  } else {
+    ldout(cct, 5) << "formatting a new log" << dendl;
+    r = format_log();
+    if (r < 0) {
+      lderr(cct) << "failed to format " << m_path << ": " << cpp_strerror(r)
+                 << dendl;
+      close_log();
+      on_finish->complete(r);
+      return;
+    }
+  }
+
+  // the log is ours before it takes any writes
+  set_state(false, new FunctionContext([this, on_finish](int r) {
+      handle_set_state(r, on_finish);
+    }));
+}
+
+template <typename I>
+void WriteLogImageCache<I>::handle_set_state(int r, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "r=" << r << dendl;
+
+  if (r < 0) {
+    lderr(cct) << "failed to set cache state: " << cpp_strerror(r) << dendl;
+    close_log();
+    on_finish->complete(r);
+    return;
+  }
+
+  uint64_t tail_offset;
+  uint64_t tail_log_seq;
+  r = read_superblock(&tail_offset, &tail_log_seq);
+  ceph_assert(r == 0);
+
+  load_log(tail_offset, tail_log_seq);
+  m_log_thread = make_named_thread(
+    "rbd_wlog", &WriteLogImageCache<I>::log_thread_entry, this);
+
+  if (!m_entries.empty()) {
+    ldout(cct, 5) << "replaying " << m_entries.size() << " entries" << dendl;
+
+    // the replayed writes are destaged once we own the lock
+    RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
+    if (m_image_ctx.exclusive_lock != nullptr &&
+        !m_image_ctx.exclusive_lock->is_lock_owner()) {
+      m_async_op_tracker.start_op();
+      m_image_ctx.exclusive_lock->acquire_lock(new FunctionContext(
+        [this](int r) {
+          if (r < 0) {
+            lderr(m_image_ctx.cct) << "failed to acquire exclusive lock: "
+                                   << cpp_strerror(r) << dendl;
+          }
+          schedule_destage();
+          m_async_op_tracker.finish_op();
+        }));
+    }
+  }
+
+  schedule_destage();
+  on_finish->complete(0);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::set_state(bool clean, Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 10) << "clean=" << clean << dendl;
+
+  CacheState state;
+  state.clean = clean;
+  state.host = m_host;
+  state.path = m_path;
+  state.log_id = m_log_id;
+
+  std::map<std::string, bufferlist> data;
+  data[IMAGE_CACHE_STATE].append(state.to_json());
+  librados::ObjectWriteOperation op;
+  cls_client::metadata_set(&op, data);
+
+  librados::AioCompletion *comp = util::create_rados_callback(on_finish);
+  int r = m_image_ctx.md_ctx.aio_operate(m_image_ctx.header_oid, comp, &op);
+  ceph_assert(r == 0);
+  comp->release();
+}
+
+template <typename I>
+int WriteLogImageCache<I>::format_log() {
+  m_log_id = ceph::util::generate_random_number<uint64_t>();
+  if (::ftruncate(m_fd, m_size) < 0) {
+    return -errno;
+  }
+  int r = write_superblock(SUPERBLOCK_SIZE, 1);
+  if (r < 0) {
+    return r;
+  }
+  if (::fdatasync(m_fd) < 0) {
+    return -errno;
+  }
+  return 0;
+}
+
+template <typename I>
+void WriteLogImageCache<I>::close_log() {
+  // closing it drops the flock
+  VOID_TEMP_FAILURE_RETRY(::close(m_fd));
+  m_fd = -1;
+}
+
+template <typename I>
+void WriteLogImageCache<I>::shut_down(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 5) << dendl;
+
+  // releasing the exclusive lock already destaged the log; whatever is
+  // left (the lock was never acquired) is replayed by the next open
+  {
+    std::lock_guard locker{m_lock};
+    m_stopping = true;
+    m_cond.notify_all();
+  }
+  m_log_thread.join();
+
+  m_async_op_tracker.wait_for_ops(new FunctionContext(
+    [this, on_finish](int) {
+      int r = 0;
+      bool clean;
+      uint64_t tail_offset;
+      uint64_t tail_log_seq;
+      {
+        std::lock_guard locker{m_lock};
+        m_trim_pending = false;
+        size_t trim_count = find_tail(&tail_offset, &tail_log_seq);
+        clean = (trim_count == m_entries.size());
+        if (trim_count > 0) {
+          r = write_superblock(tail_offset, tail_log_seq);
+          if (r == 0 && ::fdatasync(m_fd) < 0) {
+            r = -errno;
+          }
+        }
+      }
+      if (r < 0) {
+        lderr(m_image_ctx.cct) << "failed to trim log: " << cpp_strerror(r)
+                               << dendl;
+      }
+      if (r < 0 || !clean) {
+        close_log();
+        on_finish->complete(r);
+        return;
+      }
+
+      // nothing is left to write back: any client may use its own log now
+      set_state(true, new FunctionContext([this, on_finish](int r) {
+          if (r < 0) {
+            lderr(m_image_ctx.cct) << "failed to set cache state: "
+                                   << cpp_strerror(r) << dendl;
+          }
+          close_log();
+          on_finish->complete(r);
+        }));
+    }));
+}
+
+template <typename I>
+void WriteLogImageCache<I>::invalidate(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << dendl;
+
+  // the log only holds writes: destaging them drops it all
+  flush(on_finish);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::flush(Context *on_finish) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "on_finish=" << on_finish << dendl;
+
+  {
+    // retry the write that failed to destage, if any
+    std::lock_guard locker{m_lock};
+    m_destage_error = 0;
+  }
+  wait_for_destage(new FunctionContext([this, on_finish](int r) {
+      if (r < 0) {
+        on_finish->complete(r);
+        return;
+      }
+      m_image_writeback.aio_flush(on_finish);
+    }));
+}
+
+template <typename I>
+void WriteLogImageCache<I>::log_thread_entry() {
+  CephContext *cct = m_image_ctx.cct;
+  std::unique_lock locker{m_lock};
+  while (true) {
+    std::vector<LogEntry*> batch;
+    while (!m_append_queue.empty() && place_entry(m_append_queue.front())) {
+      batch.push_back(m_append_queue.front());
+      m_append_queue.pop_front();
+    }
+
+    // the superblock moves past the destaged entries at the front; their
+    // space is only reused once that is durable
+    size_t trim_count = 0;
+    uint64_t tail_offset = 0;
+    uint64_t tail_log_seq = 0;
+    if (m_trim_pending) {
+      m_trim_pending = false;
+      trim_count = find_tail(&tail_offset, &tail_log_seq);
+    }
+
+    if (batch.empty() && trim_count == 0) {
+      if (m_stopping) {
+        break;
+      }
+      m_cond.wait(locker);
+      continue;
+    }
+
+    std::vector<bufferlist> encoded(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+      encode_entry(*batch[i], &encoded[i]);
+    }
+    m_appending_seq = batch.empty() ? 0 : batch.front()->seq;
+    locker.unlock();
+
+    // one sync covers the whole batch and the trim
+    int r = 0;
+    for (size_t i = 0; i < batch.size() && r == 0; ++i) {
+      r = encoded[i].write_fd(m_fd, batch[i]->log_offset);
+    }
+    if (r == 0 && trim_count > 0) {
+      r = write_superblock(tail_offset, tail_log_seq);
+    }
+    if (r == 0 && ::fdatasync(m_fd) < 0) {
+      r = -errno;
+    }
+
+    locker.lock();
+    m_appending_seq = 0;
+    if (r < 0) {
+      lderr(cct) << "failed to write log: " << cpp_strerror(r) << dendl;
+    }
+
+    std::vector<Context*> on_finish;
+    for (auto entry : batch) {
+      // a write that did not make it to the log fails; its space is
+      // reclaimed like a destaged entry's
+      entry->state = (r < 0 ? ENTRY_DESTAGED : ENTRY_DURABLE);
+      on_finish.push_back(entry->on_finish);
+      entry->on_finish = nullptr;
+    }
+    if (r < 0) {
+      m_trim_pending = m_trim_pending || !batch.empty();
+    } else {
+      for (size_t i = 0; i < trim_count; ++i) {
+        m_entries.pop_front();
+      }
+    }
+    ldout(cct, 20) << "appended " << batch.size() << " entries, "
+                   << "trimmed " << (r < 0 ? 0 : trim_count) << dendl;
+    locker.unlock();
+
+    for (auto ctx : on_finish) {
+      m_image_ctx.op_work_queue->queue(ctx, r);
+    }
+    complete_waiters();
+    schedule_destage();
+    locker.lock();
+  }
+}
+
+template <typename I>
+size_t WriteLogImageCache<I>::find_tail(uint64_t *tail_offset,
+                                       uint64_t *tail_log_seq) const {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+  size_t trim_count = 0;
+  while (trim_count < m_entries.size() &&
+         m_entries[trim_count]->state == ENTRY_DESTAGED) {
+    ++trim_count;
+  }
+
+  *tail_offset = m_head;
+  *tail_log_seq = m_next_log_seq;
+  for (size_t i = trim_count; i < m_entries.size(); ++i) {
+    if (m_entries[i]->log_seq != 0) {
+      *tail_offset = m_entries[i]->log_offset;
+      *tail_log_seq = m_entries[i]->log_seq;
+      break;
+    }
+  }
+  return trim_count;
+}
+
+template <typename I>
+int WriteLogImageCache<I>::read_superblock(uint64_t *tail_offset,
+                                           uint64_t *tail_log_seq) {
+  bufferlist bl;
+  int r = read_fd(m_fd, 0, SUPERBLOCK_SIZE, &bl);
+  if (r < 0) {
+    return r;
+  }
+
+  try {
+    using ceph::decode;
+    auto p = bl.cbegin();
+    uint32_t magic;
+    decode(magic, p);
+    if (magic != SUPERBLOCK_MAGIC) {
+      return -EINVAL;
+    }
+    uint8_t version;
+    uint64_t log_id;
+    uint64_t size;
+    decode(version, p);
+    decode(log_id, p);
+    decode(size, p);
+    decode(*tail_offset, p);
+    decode(*tail_log_seq, p);
+    auto crc_length = p.get_off();
+    uint32_t crc;
+    decode(crc, p);
+
+    bufferlist covered;
+    covered.substr_of(bl, 0, crc_length);
+    if (covered.crc32c(-1) != crc || version != LOG_VERSION ||
+        size <= SUPERBLOCK_SIZE || *tail_offset < SUPERBLOCK_SIZE ||
+        *tail_offset > size) {
+      return -EINVAL;
+    }
+    m_log_id = log_id;
+    m_size = size;
+  } catch (const buffer::error &err) {
+    return -EINVAL;
+  }
+  return 0;
+}
+
+template <typename I>
+int WriteLogImageCache<I>::write_superblock(uint64_t tail_offset,
+                                            uint64_t tail_log_seq) {
+  using ceph::encode;
+  bufferlist bl;
+  encode(SUPERBLOCK_MAGIC, bl);
+  encode(LOG_VERSION, bl);
+  encode(m_log_id, bl);
+  encode(m_size, bl);
+  encode(tail_offset, bl);
+  encode(tail_log_seq, bl);
+  encode(bl.crc32c(-1), bl);
+  return bl.write_fd(m_fd, 0);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::load_log(uint64_t tail_offset,
+                                     uint64_t tail_log_seq) {
+  uint64_t offset = tail_offset;
+  uint64_t log_seq = tail_log_seq;
+  while (true) {
+    auto entry = std::make_unique<LogEntry>();
+    int r = read_entry(offset, log_seq, entry.get());
+    if (r < 0 && offset != SUPERBLOCK_SIZE) {
+      // the log may have wrapped here
+      offset = SUPERBLOCK_SIZE;
+      r = read_entry(offset, log_seq, entry.get());
+    }
+    if (r < 0) {
+      break;
+    }
+
+    entry->seq = m_next_seq++;
+    entry->state = ENTRY_DURABLE;
+    offset = entry->log_offset + entry->log_length;
+    ++log_seq;
+    m_entries.push_back(std::move(entry));
+  }
+
+  m_head = m_entries.empty() ? tail_offset : offset;
+  m_next_log_seq = log_seq;
+}
+
+template <typename I>
+int WriteLogImageCache<I>::read_entry(uint64_t offset, uint64_t log_seq,
+                                      LogEntry *entry) {
+  using ceph::decode;
+  if (offset + ENTRY_HEADER_BASE > m_size) {
+    return -EINVAL;
+  }
+
+  bufferlist bl;
+  int r = read_fd(m_fd, offset, sizeof(uint32_t), &bl);
+  if (r < 0) {
+    return r;
+  }
+  uint32_t header_length;
+  auto p = bl.cbegin();
+  decode(header_length, p);
+  if (header_length < ENTRY_HEADER_BASE - sizeof(uint32_t) ||
+      offset + sizeof(uint32_t) + header_length > m_size) {
+    return -EINVAL;
+  }
+
+  // check the header before trusting any length it holds
+  bufferlist header;
+  r = read_fd(m_fd, offset + sizeof(uint32_t), header_length, &header);
+  if (r < 0) {
+    return r;
+  }
+  uint32_t header_crc;
+  p = header.cbegin();
+  p.advance(header_length - sizeof(uint32_t));
+  decode(header_crc, p);
+  bufferlist covered;
+  covered.substr_of(header, 0, header_length - sizeof(uint32_t));
+  if (covered.crc32c(-1) != header_crc) {
+    return -EINVAL;
+  }
+
+  uint32_t magic;
+  uint64_t log_id;
+  uint64_t seq;
+  Extents image_extents;
+  uint32_t data_length;
+  uint32_t data_crc;
+  try {
+    p = header.cbegin();
+    decode(magic, p);
+    decode(log_id, p);
+    decode(seq, p);
+    decode(image_extents, p);
+    decode(data_length, p);
+    decode(data_crc, p);
+  } catch (const buffer::error &err) {
+    return -EINVAL;
+  }
+  if (magic != ENTRY_MAGIC || log_id != m_log_id || seq != log_seq ||
+      header_length != ENTRY_HEADER_BASE - sizeof(uint32_t) +
+                       ENTRY_HEADER_PER_EXTENT * image_extents.size()) {
+    return -EINVAL;
+  }
+  uint64_t extents_length = 0;
+  for (auto &extent : image_extents) {
+    extents_length += extent.second;
+  }
+  uint64_t length = entry_length(image_extents, data_length);
+  if (extents_length != data_length || offset + length > m_size) {
+    return -EINVAL;
+  }
+
+  bufferlist data;
+  r = read_fd(m_fd, offset + sizeof(uint32_t) + header_length, data_length,
+              &data);
+  if (r < 0) {
+    return r;
+  }
+  if (data.crc32c(-1) != data_crc) {
+    return -EINVAL;
+  }
+
+  entry->log_seq = log_seq;
+  entry->log_offset = offset;
+  entry->log_length = length;
+  entry->image_extents = std::move(image_extents);
+  entry->bl = std::move(data);
+  return 0;
+}
+
+template <typename I>
+void WriteLogImageCache<I>::encode_entry(const LogEntry &entry,
+                                         bufferlist *out) const {
+  using ceph::encode;
+  bufferlist header;
+  encode(ENTRY_MAGIC, header);
+  encode(m_log_id, header);
+  encode(entry.log_seq, header);
+  encode(entry.image_extents, header);
+  encode(static_cast<uint32_t>(entry.bl.length()), header);
+  encode(entry.bl.crc32c(-1), header);
+  encode(header.crc32c(-1), header);
+
+  encode(static_cast<uint32_t>(header.length()), *out);
+  out->claim_append(header);
+  out->append(entry.bl);
+  ceph_assert(out->length() <= entry.log_length);
+  out->append_zero(entry.log_length - out->length());
+}
+
+template <typename I>
+uint64_t WriteLogImageCache<I>::entry_length(const Extents &image_extents,
+                                             uint64_t len) {
+  return p2roundup(ENTRY_HEADER_BASE +
+                   ENTRY_HEADER_PER_EXTENT * image_extents.size() + len,
+                   ENTRY_ALIGN);
+}
+
+template <typename I>
+bool WriteLogImageCache<I>::place_entry(LogEntry *entry) {
+  uint64_t length = entry_length(entry->image_extents, entry->bl.length());
+
+  // the oldest entry still in the log bounds the free space
+  const LogEntry *tail = nullptr;
+  for (auto &e : m_entries) {
+    if (e->log_seq != 0) {
+      tail = e.get();
+      break;
+    }
+  }
+
+  uint64_t offset = m_head;
+  if (tail == nullptr || tail->log_offset < m_head) {
+    // free from the head to the end, then from the start to the tail
+    if (offset + length > m_size) {
+      offset = SUPERBLOCK_SIZE;
+      if (offset + length > (tail != nullptr ? tail->log_offset : m_size)) {
+        return false;
+      }
+    }
+  } else if (offset + length > tail->log_offset) {
+    return false;
+  }
+
+  entry->log_seq = m_next_log_seq++;
+  entry->log_offset = offset;
+  entry->log_length = length;
+  entry->state = ENTRY_APPENDING;
+  m_head = offset + length;
+  return true;
+}
+
+template <typename I>
+void WriteLogImageCache<I>::queue_pass_through(
+    std::function<void(Context*)> &&op, Context *on_finish) {
+  auto entry = std::make_unique<LogEntry>();
+  entry->state = ENTRY_DURABLE;
+  entry->pass_through = std::move(op);
+  entry->on_finish = on_finish;
+  {
+    std::lock_guard locker{m_lock};
+    entry->seq = m_next_seq++;
+    m_entries.push_back(std::move(entry));
+  }
+  schedule_destage();
+}
+
+template <typename I>
+void WriteLogImageCache<I>::schedule_destage() {
+  m_async_op_tracker.start_op();
+  m_image_ctx.op_work_queue->queue(new FunctionContext([this](int r) {
+      dispatch_destage();
+      m_async_op_tracker.finish_op();
+    }), 0);
+}
+
+template <typename I>
+void WriteLogImageCache<I>::dispatch_destage() {
+  CephContext *cct = m_image_ctx.cct;
+
+  RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
+  if (m_image_ctx.exclusive_lock == nullptr ||
+      !m_image_ctx.exclusive_lock->is_lock_owner()) {
+    ldout(cct, 20) << "not the lock owner" << dendl;
+    return;
+  }
+
+  // entries go in seq order, and none while an earlier one it overlaps
+  // is in flight
+  std::vector<LogEntry*> entries;
+  {
+    std::lock_guard locker{m_lock};
+    if (m_destage_error < 0) {
+      ldout(cct, 20) << "destage failed, waiting for a flush to retry"
+                     << dendl;
+      return;
+    }
+    std::vector<const Extents*> in_flight;
+    for (auto &entry : m_entries) {
+      if (entry->state == ENTRY_DESTAGED) {
+        continue;
+      } else if (entry->state == ENTRY_DESTAGING) {
+        if (entry->pass_through) {
+          break;
+        }
+        in_flight.push_back(&entry->image_extents);
+        continue;
+      } else if (entry->state != ENTRY_DURABLE) {
+        break;
+      }
+
+      if (entry->pass_through) {
+        // only once everything before it is done and trimmed
+        if (entry == m_entries.front() && m_destage_in_flight == 0) {
+          entry->state = ENTRY_DESTAGING;
+          ++m_destage_in_flight;
+          entries.push_back(entry.get());
+        }
+        break;
+      }
+      if (m_destage_in_flight >= MAX_DESTAGE_IN_FLIGHT) {
+        break;
+      }
+      bool overlapping = false;
+      for (auto extents : in_flight) {
+        if (overlaps(*extents, entry->image_extents)) {
+          overlapping = true;
+          break;
+        }
+      }
+      if (overlapping) {
+        break;
+      }
+
+      entry->state = ENTRY_DESTAGING;
+      ++m_destage_in_flight;
+      in_flight.push_back(&entry->image_extents);
+      entries.push_back(entry.get());
+    }
+  }
+
+  for (auto entry : entries) {
+    ldout(cct, 20) << "seq=" << entry->seq << dendl;
+    m_async_op_tracker.start_op();
+    auto ctx = new FunctionContext([this, entry](int r) {
+        handle_destage(entry, r);
+      });
+    if (entry->pass_through) {
+      entry->pass_through(ctx);
+      continue;
+    }
+
+    Extents image_extents = entry->image_extents;
+    bufferlist bl = entry->bl;
+    m_image_writeback.aio_write(std::move(image_extents), std::move(bl),
+                                entry->fadvise_flags, ctx);
+  }
+}
+
+template <typename I>
+void WriteLogImageCache<I>::handle_destage(LogEntry *entry, int r) {
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "seq=" << entry->seq << ", r=" << r << dendl;
+
+  Context *on_finish = nullptr;
+  {
+    std::lock_guard locker{m_lock};
+    bool failed = false;
+    if (entry->pass_through) {
+      on_finish = entry->on_finish;
+      entry->on_finish = nullptr;
+    } else if (r < 0) {
+      // the write was already acked, so it stays in the log; destaging
+      // stops until the next internal flush retries it
+      lderr(cct) << "failed to destage seq=" << entry->seq << ": "
+                 << cpp_strerror(r) << dendl;
+      if (m_destage_error == 0) {
+        m_destage_error = r;
+      }
+      failed = true;
+    }
+    --m_destage_in_flight;
+    if (failed) {
+      entry->state = ENTRY_DURABLE;
+    } else {
+      entry->state = ENTRY_DESTAGED;
+      m_trim_pending = true;
+      m_cond.notify_all();
+    }
+  }
+
+  if (on_finish != nullptr) {
+    on_finish->complete(r);
+  }
+  complete_waiters();
+  schedule_destage();
+  m_async_op_tracker.finish_op();
+}
+
+template <typename I>
+uint64_t WriteLogImageCache<I>::first_pending_seq() const {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+  for (auto &entry : m_entries) {
+    if (entry->state != ENTRY_DESTAGED) {
+      return entry->seq;
+    }
+  }
+  return m_next_seq;
+}
+
+template <typename I>
+uint64_t WriteLogImageCache<I>::first_appending_seq() const {
+  ceph_assert(ceph_mutex_is_locked(m_lock));
+  if (m_appending_seq != 0) {
+    return m_appending_seq;
+  } else if (!m_append_queue.empty()) {
+    return m_append_queue.front()->seq;
+  }
+  return m_next_seq;
+}
+
+template <typename I>
+void WriteLogImageCache<I>::complete_waiters() {
+  std::vector<std::pair<Context*, int>> ctxs;
+  {
+    std::lock_guard locker{m_lock};
+    uint64_t appending_seq = first_appending_seq();
+    while (!m_durable_waiters.empty() &&
+           m_durable_waiters.front().first < appending_seq) {
+      ctxs.emplace_back(m_durable_waiters.front().second, 0);
+      m_durable_waiters.pop_front();
+    }
+
+    // reads wait on the entry they overlap, so these are not in order;
+    // none gets destaged after a failure until a flush retries
+    uint64_t pending_seq = first_pending_seq();
+    for (auto it = m_destage_waiters.begin();
+         it != m_destage_waiters.end(); ) {
+      if (it->first < pending_seq) {
+        ctxs.emplace_back(it->second, 0);
+        it = m_destage_waiters.erase(it);
+      } else if (m_destage_error < 0 && m_destage_in_flight == 0) {
+        ctxs.emplace_back(it->second, m_destage_error);
+        it = m_destage_waiters.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  for (auto &ctx : ctxs) {
+    m_image_ctx.op_work_queue->queue(ctx.first, ctx.second);
+  }
+}
+
+template <typename I>
+void WriteLogImageCache<I>::wait_for_destage(Context *on_finish) {
+  {
+    std::lock_guard locker{m_lock};
+    uint64_t seq = m_next_seq - 1;
+    if (first_pending_seq() <= seq) {
+      m_destage_waiters.emplace_back(seq, on_finish);
+      on_finish = nullptr;
+    }
+  }
+
+  if (on_finish != nullptr) {
+    m_image_ctx.op_work_queue->queue(on_finish, 0);
+  } else {
+    schedule_destage();
+  }
+}
+
+} // namespace cache
+} // namespace librbd
+
+template class librbd::cache::WriteLogImageCache<librbd::ImageCtx>;
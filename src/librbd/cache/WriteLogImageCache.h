@@ -0,0 +1,186 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
+#define CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
+
+#include "ImageCache.h"
+#include "ImageWriteback.h"
+#include "include/buffer.h"
+#include "common/AsyncOpTracker.h"
+#include "common/ceph_mutex.h"
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace librbd {
+
+struct ImageCtx;
+
+namespace cache {
+
+/**
+ * Write-back image cache persisted in a local write log
+ *
+ * Writes are appended to a log file on a local device (an SSD, or pmem
+ * through a DAX file system) and complete once the log is durable;
+ * a flush then has nothing more to wait for.  The log is destaged to
+ * the image in write order, a few writes at a time, and its space
+ * reused as a ring once the superblock records that the destaged
+ * entries are gone.  After a crash, init() replays what the log still
+ * holds.
+ *
+ * Reads of data that is still in the log get it from the log's entries,
+ * on top of what the image has.  Discard, writesame and
+ * compare-and-write are passed through in order, once everything logged
+ * before them is destaged and trimmed; reads behind one wait for it.
+ * A write that fails to destage stays in the log and stops destaging
+ * until the next internal flush, which retries it and reports the error
+ * if it fails again.
+ *
+ * A log is only valid for the client that wrote it, so the cache is
+ * only used with the exclusive lock.  The log file is flocked while it
+ * is open, and the image's metadata records which host and log hold
+ * writes not yet written back: an image whose state names another
+ * host's log, or a log that isn't there any more, fails to open.  A
+ * local log the state doesn't name (or names as clean) is discarded.
+ *
+ * @verbatim
+ * log file:  | superblock (4K) | entry | entry | ... | entry | (free) |
+ * entry:     | u32 header length | header | data | padding to 512 |
+ * @endverbatim
+ */
+template <typename ImageCtxT = librbd::ImageCtx>
+class WriteLogImageCache : public ImageCache {
+public:
+  static WriteLogImageCache* create(ImageCtxT &image_ctx,
+                                    const std::string &path,
+                                    uint64_t size) {
+    return new WriteLogImageCache(image_ctx, path, size);
+  }
+
+  WriteLogImageCache(ImageCtxT &image_ctx, const std::string &path,
+                     uint64_t size);
+  ~WriteLogImageCache() override;
+
+  /// client AIO methods
+  void aio_read(Extents&& image_extents, ceph::bufferlist *bl,
+                int fadvise_flags, Context *on_finish) override;
+  void aio_write(Extents&& image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) override;
+  void aio_discard(uint64_t offset, uint64_t length,
+                   uint32_t discard_granularity_bytes,
+                   Context *on_finish) override;
+  void aio_flush(Context *on_finish) override;
+  void aio_writesame(uint64_t offset, uint64_t length,
+                     ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) override;
+  void aio_compare_and_write(Extents&& image_extents,
+                             ceph::bufferlist&& cmp_bl, ceph::bufferlist&& bl,
+                             uint64_t *mismatch_offset,int fadvise_flags,
+                             Context *on_finish) override;
+
+  /// internal state methods
+  void init(Context *on_finish) override;
+  void shut_down(Context *on_finish) override;
+
+  void invalidate(Context *on_finish) override;
+  void flush(Context *on_finish) override;
+
+private:
+  static constexpr uint64_t SUPERBLOCK_SIZE = 4096;
+  static constexpr uint64_t ENTRY_ALIGN = 512;
+  static constexpr unsigned MAX_DESTAGE_IN_FLIGHT = 16;
+
+  enum entry_state_t {
+    ENTRY_QUEUED,     ///< waiting for log space
+    ENTRY_APPENDING,  ///< being written to the log
+    ENTRY_DURABLE,    ///< in the log (or nothing to log), not yet destaged
+    ENTRY_DESTAGING,
+    ENTRY_DESTAGED,
+  };
+
+  struct LogEntry {
+    uint64_t seq = 0;       ///< order among all entries
+    uint64_t log_seq = 0;   ///< order among logged entries, 0 if not logged
+    uint64_t log_offset = 0;
+    uint64_t log_length = 0;
+    entry_state_t state = ENTRY_QUEUED;
+    Extents image_extents;
+    ceph::bufferlist bl;
+    int fadvise_flags = 0;
+    /// completes a write once it is durable, a pass-through op once done
+    Context *on_finish = nullptr;
+    /// set for an op passed through in order instead of being logged;
+    /// it is called with the context to complete when the op is done
+    std::function<void(Context*)> pass_through;
+  };
+  typedef std::deque<std::unique_ptr<LogEntry>> LogEntries;
+  typedef std::list<std::pair<uint64_t, Context*>> Waiters;
+
+  ImageCtxT &m_image_ctx;
+  ImageWriteback<ImageCtxT> m_image_writeback;
+  const std::string m_path;
+  const std::string m_host;
+  uint64_t m_size;
+  int m_fd = -1;
+  uint64_t m_log_id = 0;          ///< tells our entries from a past log's
+  ceph::bufferlist m_out_bl;
+
+  ceph::mutex m_lock = ceph::make_mutex("librbd::cache::WriteLogImageCache");
+  ceph::condition_variable m_cond;
+  std::thread m_log_thread;
+  bool m_stopping = false;
+  AsyncOpTracker m_async_op_tracker;
+
+  LogEntries m_entries;           ///< in seq order, until trimmed
+  std::deque<LogEntry*> m_append_queue;
+  uint64_t m_next_seq = 1;
+  uint64_t m_next_log_seq = 1;
+  uint64_t m_head = SUPERBLOCK_SIZE;  ///< where the next entry goes
+  uint64_t m_appending_seq = 0;   ///< first seq being appended, if any
+  bool m_trim_pending = false;    ///< destaged entries to trim from the log
+  unsigned m_destage_in_flight = 0;
+  int m_destage_error = 0;       ///< a destage failed, until a flush retries
+
+  Waiters m_durable_waiters;      ///< flushes, by the last seq they cover
+  Waiters m_destage_waiters;      ///< reads and internal flushes
+
+  void get_state(Context *on_finish);
+  void handle_get_state(int r, Context *on_finish);
+  void handle_set_state(int r, Context *on_finish);
+  void set_state(bool clean, Context *on_finish);
+  int format_log();
+  void close_log();
+
+  void log_thread_entry();
+  int read_superblock(uint64_t *tail_offset, uint64_t *tail_log_seq);
+  int write_superblock(uint64_t tail_offset, uint64_t tail_log_seq);
+  size_t find_tail(uint64_t *tail_offset, uint64_t *tail_log_seq) const;
+  void load_log(uint64_t tail_offset, uint64_t tail_log_seq);
+  int read_entry(uint64_t offset, uint64_t log_seq, LogEntry *entry);
+  void encode_entry(const LogEntry &entry, ceph::bufferlist *out) const;
+  static uint64_t entry_length(const Extents &image_extents, uint64_t len);
+
+  bool place_entry(LogEntry *entry);
+  void queue_pass_through(std::function<void(Context*)> &&op,
+                          Context *on_finish);
+  void schedule_destage();
+  void dispatch_destage();
+  void handle_destage(LogEntry *entry, int r);
+  uint64_t first_pending_seq() const;
+  uint64_t first_appending_seq() const;
+  void complete_waiters();
+  void wait_for_destage(Context *on_finish);
+
+};
+
+} // namespace cache
+} // namespace librbd
+
+extern template class librbd::cache::WriteLogImageCache<librbd::ImageCtx>;
+
+#endif // CEPH_LIBRBD_CACHE_WRITE_LOG_IMAGE_CACHE
@@ -76,15 +76,27 @@ void ImageCopyRequest<I>::send_object_copies() {
   }
   m_end_object_no = Striper::get_num_objects(m_dst_image_ctx->layout, size);
 
+  // an object copy buffers up to an object's worth of data for each
+  // snapshot it copies before writing any of it out
+  uint64_t max_ops = m_src_image_ctx->config.template get_val<uint64_t>(
+    "rbd_concurrent_management_ops");
+  uint64_t max_bytes = m_src_image_ctx->config.template get_val<Option::size_t>(
+    "rbd_concurrent_deep_copy_bytes");
+  if (max_bytes > 0) {
+    // the snap map may be empty, and an object still takes a buffer
+    uint64_t object_bytes = m_dst_image_ctx->layout.object_size *
+                            std::max<size_t>(1, m_snap_map.size());
+    max_ops = std::max<uint64_t>(1, max_bytes / object_bytes);
+  }
+
   ldout(m_cct, 20) << "start_object=" << m_object_no << ", "
-                   << "end_object=" << m_end_object_no << dendl;
+                   << "end_object=" << m_end_object_no << ", "
+                   << "max_ops=" << max_ops << dendl;
 
   bool complete;
   {
     Mutex::Locker locker(m_lock);
-    for (uint64_t i = 0;
-         i < m_src_image_ctx->config.template get_val<uint64_t>("rbd_concurrent_management_ops");
-         ++i) {
+    for (uint64_t i = 0; i < max_ops; ++i) {
       send_next_object_copy();
       if (m_ret_val < 0 && m_current_ops == 0) {
         break;
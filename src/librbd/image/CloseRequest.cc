@@ -10,6 +10,7 @@
 #include "librbd/ImageWatcher.h"
 #include "librbd/ObjectMap.h"
 #include "librbd/Utils.h"
+#include "librbd/cache/ImageCache.h"
 #include "librbd/io/AioCompletion.h"
 #include "librbd/io/ImageDispatchSpec.h"
 #include "librbd/io/ImageRequestWQ.h"
@@ -227,6 +228,36 @@ void CloseRequest<I>::handle_flush_readahead(int r) {
   CephContext *cct = m_image_ctx->cct;
   ldout(cct, 10) << this << " " << __func__ << ": r=" << r << dendl;
 
+  send_shut_down_image_cache();
+}
+
+template <typename I>
+void CloseRequest<I>::send_shut_down_image_cache() {
+  if (m_image_ctx->image_cache == nullptr) {
+    send_shut_down_object_dispatcher();
+    return;
+  }
+
+  CephContext *cct = m_image_ctx->cct;
+  ldout(cct, 10) << this << " " << __func__ << dendl;
+
+  m_image_ctx->image_cache->shut_down(create_context_callback<
+    CloseRequest<I>, &CloseRequest<I>::handle_shut_down_image_cache>(this));
+}
+
+template <typename I>
+void CloseRequest<I>::handle_shut_down_image_cache(int r) {
+  CephContext *cct = m_image_ctx->cct;
+  ldout(cct, 10) << this << " " << __func__ << ": r=" << r << dendl;
+
+  save_result(r);
+  if (r < 0) {
+    lderr(cct) << "failed to shut down image cache: " << cpp_strerror(r)
+               << dendl;
+  }
+
+  delete m_image_ctx->image_cache;
+  m_image_ctx->image_cache = nullptr;
   send_shut_down_object_dispatcher();
 }
 
@@ -4,11 +4,13 @@
 #include "librbd/image/OpenRequest.h"
 #include "common/dout.h"
 #include "common/errno.h"
+#include "include/stringify.h"
 #include "cls/rbd/cls_rbd_client.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/Utils.h"
 #include "librbd/cache/ObjectCacherObjectDispatch.h"
 #include "librbd/cache/WriteAroundObjectDispatch.h"
+#include "librbd/cache/WriteLogImageCache.h"
 #include "librbd/image/CloseRequest.h"
 #include "librbd/image/RefreshRequest.h"
 #include "librbd/image/SetSnapRequest.h"
@@ -585,6 +587,54 @@ Context *OpenRequest<I>::handle_register_watch(int *result) {
     return nullptr;
   }
 
+  return send_init_image_cache(result);
+}
+
+template <typename I>
+Context *OpenRequest<I>::send_init_image_cache(int *result) {
+  // the write log needs the exclusive lock to stay valid
+  auto path = m_image_ctx->config.template get_val<std::string>(
+    "rbd_persistent_cache_path");
+  if (path.empty() || m_image_ctx->read_only ||
+      m_image_ctx->child != nullptr ||
+      m_image_ctx->snap_name.length() > 0 ||
+      m_image_ctx->open_snap_id != CEPH_NOSNAP ||
+      !m_image_ctx->test_features(RBD_FEATURE_EXCLUSIVE_LOCK)) {
+    return send_set_snap(result);
+  }
+
+  CephContext *cct = m_image_ctx->cct;
+  ldout(cct, 10) << this << " " << __func__ << dendl;
+
+  path += "/rbd-wlog." + stringify(m_image_ctx->md_ctx.get_id()) + "." +
+          m_image_ctx->id;
+  auto size = m_image_ctx->config.template get_val<Option::size_t>(
+    "rbd_persistent_cache_size");
+  ceph_assert(m_image_ctx->image_cache == nullptr);
+  m_image_ctx->image_cache = cache::WriteLogImageCache<I>::create(
+    *m_image_ctx, path, size);
+
+  using klass = OpenRequest<I>;
+  Context *ctx = create_context_callback<
+    klass, &klass::handle_init_image_cache>(this);
+  m_image_ctx->image_cache->init(ctx);
+  return nullptr;
+}
+
+template <typename I>
+Context *OpenRequest<I>::handle_init_image_cache(int *result) {
+  CephContext *cct = m_image_ctx->cct;
+  ldout(cct, 10) << this << " " << __func__ << ": r=" << *result << dendl;
+
+  if (*result < 0) {
+    lderr(cct) << "failed to init image cache: " << cpp_strerror(*result)
+               << dendl;
+    delete m_image_ctx->image_cache;
+    m_image_ctx->image_cache = nullptr;
+    send_close_image(*result);
+    return nullptr;
+  }
+
   return send_set_snap(result);
 }
 
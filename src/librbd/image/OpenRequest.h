@@ -67,6 +67,9 @@ private:
    *                                             REGISTER_WATCH (skip if
    *                                                |            read-only)
    *                                                v
+   *                                             INIT_IMAGE_CACHE (skip if
+   *                                                |              disabled)
+   *                                                v
    *                                             SET_SNAP (skip if no snap)
    *                                                |
    *                                                v
@@ -125,6 +128,9 @@ private:
   Context *send_register_watch(int *result);
   Context *handle_register_watch(int *result);
 
+  Context *send_init_image_cache(int *result);
+  Context *handle_init_image_cache(int *result);
+
   Context *send_set_snap(int *result);
   Context *handle_set_snap(int *result);
 
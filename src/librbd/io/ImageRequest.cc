@@ -83,26 +83,24 @@ void readahead(I *ictx, const Extents& image_extents) {
   if (readahead_length > 0) {
     ldout(ictx->cct, 20) << "(readahead logical) " << readahead_offset << "~"
                          << readahead_length << dendl;
-    std::map<object_t, std::vector<ObjectExtent> > readahead_object_extents;
+    std::vector<ObjectExtent> readahead_object_extents;
     Striper::file_to_extents(ictx->cct, ictx->format_string, &ictx->layout,
                              readahead_offset, readahead_length, 0,
                              readahead_object_extents);
-    for (auto& readahead_object_extent : readahead_object_extents) {
-      for (auto& object_extent : readahead_object_extent.second) {
-        ldout(ictx->cct, 20) << "(readahead) oid " << object_extent.oid << " "
-                             << object_extent.offset << "~"
-                             << object_extent.length << dendl;
-
-        auto req_comp = new C_RBD_Readahead<I>(ictx, object_extent.oid,
-                                               object_extent.offset,
-                                               object_extent.length);
-        auto req = io::ObjectDispatchSpec::create_read(
-          ictx, io::OBJECT_DISPATCH_LAYER_NONE, object_extent.oid.name,
-          object_extent.objectno, object_extent.offset, object_extent.length,
-          snap_id, 0, {}, &req_comp->read_data, &req_comp->extent_map,
-          req_comp);
-        req->send();
-      }
+    for (auto& object_extent : readahead_object_extents) {
+      ldout(ictx->cct, 20) << "(readahead) oid " << object_extent.oid << " "
+                           << object_extent.offset << "~"
+                           << object_extent.length << dendl;
+
+      auto req_comp = new C_RBD_Readahead<I>(ictx, object_extent.oid,
+                                             object_extent.offset,
+                                             object_extent.length);
+      auto req = io::ObjectDispatchSpec::create_read(
+        ictx, io::OBJECT_DISPATCH_LAYER_NONE, object_extent.oid.name,
+        object_extent.objectno, object_extent.offset, object_extent.length,
+        snap_id, 0, {}, &req_comp->read_data, &req_comp->extent_map,
+        req_comp);
+      req->send();
     }
 
     ictx->perfcounter->inc(l_librbd_readahead);
@@ -720,7 +718,13 @@ void ImageFlushRequest<I>::send_image_cache_request() {
   AioCompletion *aio_comp = this->m_aio_comp;
   aio_comp->set_request_count(1);
   C_AioRequest *req_comp = new C_AioRequest(aio_comp);
-  image_ctx.image_cache->aio_flush(req_comp);
+  if (m_flush_source == FLUSH_SOURCE_USER) {
+    image_ctx.image_cache->aio_flush(req_comp);
+  } else {
+    // internal flushes (lock release, snapshots, ...) need the data
+    // written back, not just durable in the cache
+    image_ctx.image_cache->flush(req_comp);
+  }
 }
 
 template <typename I>
@@ -286,9 +286,12 @@ void ImageRequestWQ<I>::aio_read(AioCompletion *c, uint64_t off, uint64_t len,
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
   if (m_image_ctx.non_blocking_aio || writes_blocked() || !writes_empty() ||
       require_lock_on_read()) {
-    queue(ImageDispatchSpec<I>::create_read_request(
-            m_image_ctx, c, {{off, len}}, std::move(read_result), op_flags,
-            trace));
+    auto req = ImageDispatchSpec<I>::create_read_request(
+      m_image_ctx, c, {{off, len}}, std::move(read_result), op_flags,
+      trace);
+    if (!dispatch_direct(req)) {
+      queue(req);
+    }
   } else {
     c->start_op();
     ImageRequest<I>::aio_read(&m_image_ctx, c, {{off, len}},
@@ -325,8 +328,11 @@ void ImageRequestWQ<I>::aio_write(AioCompletion *c, uint64_t off, uint64_t len,
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
   if (m_image_ctx.non_blocking_aio || writes_blocked()) {
-    queue(ImageDispatchSpec<I>::create_write_request(
-            m_image_ctx, c, {{off, len}}, std::move(bl), op_flags, trace));
+    auto req = ImageDispatchSpec<I>::create_write_request(
+      m_image_ctx, c, {{off, len}}, std::move(bl), op_flags, trace);
+    if (!dispatch_direct(req)) {
+      queue(req);
+    }
   } else {
     c->start_op();
     ImageRequest<I>::aio_write(&m_image_ctx, c, {{off, len}},
@@ -364,8 +370,11 @@ void ImageRequestWQ<I>::aio_discard(AioCompletion *c, uint64_t off,
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
   if (m_image_ctx.non_blocking_aio || writes_blocked()) {
-    queue(ImageDispatchSpec<I>::create_discard_request(
-            m_image_ctx, c, off, len, discard_granularity_bytes, trace));
+    auto req = ImageDispatchSpec<I>::create_discard_request(
+      m_image_ctx, c, off, len, discard_granularity_bytes, trace);
+    if (!dispatch_direct(req)) {
+      queue(req);
+    }
   } else {
     c->start_op();
     ImageRequest<I>::aio_discard(&m_image_ctx, c, {{off, len}},
@@ -399,8 +408,11 @@ void ImageRequestWQ<I>::aio_flush(AioCompletion *c, bool native_async) {
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
   if (m_image_ctx.non_blocking_aio || writes_blocked() || !writes_empty()) {
-    queue(ImageDispatchSpec<I>::create_flush_request(
-            m_image_ctx, c, FLUSH_SOURCE_USER, trace));
+    auto req = ImageDispatchSpec<I>::create_flush_request(
+      m_image_ctx, c, FLUSH_SOURCE_USER, trace);
+    if (!dispatch_direct(req)) {
+      queue(req);
+    }
   } else {
     c->start_op();
     ImageRequest<I>::aio_flush(&m_image_ctx, c, FLUSH_SOURCE_USER, trace);
@@ -437,8 +449,11 @@ void ImageRequestWQ<I>::aio_writesame(AioCompletion *c, uint64_t off,
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
   if (m_image_ctx.non_blocking_aio || writes_blocked()) {
-    queue(ImageDispatchSpec<I>::create_write_same_request(
-            m_image_ctx, c, off, len, std::move(bl), op_flags, trace));
+    auto req = ImageDispatchSpec<I>::create_write_same_request(
+      m_image_ctx, c, off, len, std::move(bl), op_flags, trace);
+    if (!dispatch_direct(req)) {
+      queue(req);
+    }
   } else {
     c->start_op();
     ImageRequest<I>::aio_writesame(&m_image_ctx, c, {{off, len}}, std::move(bl),
@@ -478,9 +493,12 @@ void ImageRequestWQ<I>::aio_compare_and_write(AioCompletion *c,
 
   RWLock::RLocker owner_locker(m_image_ctx.owner_lock);
   if (m_image_ctx.non_blocking_aio || writes_blocked()) {
-    queue(ImageDispatchSpec<I>::create_compare_and_write_request(
-            m_image_ctx, c, {{off, len}}, std::move(cmp_bl), std::move(bl),
-            mismatch_off, op_flags, trace));
+    auto req = ImageDispatchSpec<I>::create_compare_and_write_request(
+      m_image_ctx, c, {{off, len}}, std::move(cmp_bl), std::move(bl),
+      mismatch_off, op_flags, trace);
+    if (!dispatch_direct(req)) {
+      queue(req);
+    }
   } else {
     c->start_op();
     ImageRequest<I>::aio_compare_and_write(&m_image_ctx, c, {{off, len}},
@@ -882,6 +900,47 @@ bool ImageRequestWQ<I>::is_lock_required(bool write_op) const {
           (!write_op && m_require_lock_on_read));
 }
 
+template <typename I>
+bool ImageRequestWQ<I>::dispatch_direct(ImageDispatchSpec<I> *req) {
+  ceph_assert(m_image_ctx.owner_lock.is_locked());
+
+  // send from the caller's thread only if nothing is queued ahead (to
+  // keep IO ordered) and nothing would stall the request in the queue
+  if (!m_image_ctx.direct_dispatch_aio || m_io_blockers.load() > 0 ||
+      m_io_throttled.load() > 0 || m_queued_reads.load() > 0 ||
+      m_queued_writes.load() > 0 ||
+      m_image_ctx.state->is_refresh_required()) {
+    return false;
+  }
+
+  bool write_op = req->is_write_op();
+  {
+    RWLock::RLocker locker(m_lock);
+    if (m_qos_enabled_flag != 0 || is_lock_required(write_op) ||
+        (write_op && m_write_blockers > 0)) {
+      return false;
+    }
+    if (write_op) {
+      // block_writes() waits for it like for a dequeued write
+      m_in_flight_writes++;
+    }
+  }
+
+  CephContext *cct = m_image_ctx.cct;
+  ldout(cct, 20) << "ictx=" << &m_image_ctx << ", "
+                 << "req=" << req << dendl;
+
+  req->start_op();
+  req->send();
+  if (write_op) {
+    finish_in_flight_write();
+  }
+  delete req;
+
+  finish_in_flight_io();
+  return true;
+}
+
 template <typename I>
 void ImageRequestWQ<I>::queue(ImageDispatchSpec<I> *req) {
   ceph_assert(m_image_ctx.owner_lock.is_locked());
@@ -133,6 +133,7 @@ private:
   void finish_in_flight_io();
   void fail_in_flight_io(int r, ImageDispatchSpec<ImageCtxT> *req);
 
+  bool dispatch_direct(ImageDispatchSpec<ImageCtxT> *req);
   void queue(ImageDispatchSpec<ImageCtxT> *req);
 
   void handle_acquire_lock(int r, ImageDispatchSpec<ImageCtxT> *req);
@@ -5,7 +5,9 @@
 #include "common/Timer.h"
 #include "common/WorkQueue.h"
 #include "common/errno.h"
+#include "common/perf_counters.h"
 #include "librbd/ImageCtx.h"
+#include "librbd/Types.h"
 #include "librbd/Utils.h"
 #include "librbd/io/ObjectDispatchSpec.h"
 #include "librbd/io/ObjectDispatcher.h"
@@ -27,6 +29,8 @@ namespace io {
 using namespace boost::accumulators;
 
 static const int LATENCY_STATS_WINDOW_SIZE = 10;
+static const int MERGE_STATS_WINDOW_SIZE = 10;
+static const uint64_t MERGE_PROBE_INTERVAL = 16;
 
 class LatencyStats {
 private:
@@ -55,6 +59,26 @@ public:
   }
 };
 
+class MergeStats {
+private:
+  accumulator_set<uint64_t, stats<tag::rolling_count, tag::rolling_sum>> m_acc;
+
+public:
+  MergeStats()
+    : m_acc(tag::rolling_window::window_size = MERGE_STATS_WINDOW_SIZE) {
+  }
+
+  void add(uint64_t merged_requests) {
+    m_acc(merged_requests);
+  }
+
+  // false once none of the recent delays merged anything
+  bool is_merging() const {
+    return rolling_count(m_acc) < MERGE_STATS_WINDOW_SIZE ||
+           rolling_sum(m_acc) > 0;
+  }
+};
+
 template <typename I>
 bool SimpleSchedulerObjectDispatch<I>::ObjectRequests::try_delay_request(
     uint64_t object_off, ceph::bufferlist&& data, const ::SnapContext &snapc,
@@ -138,11 +162,13 @@ void SimpleSchedulerObjectDispatch<I>::ObjectRequests::try_merge_delayed_request
 }
 
 template <typename I>
-void SimpleSchedulerObjectDispatch<I>::ObjectRequests::dispatch_delayed_requests(
+uint64_t SimpleSchedulerObjectDispatch<I>::ObjectRequests::dispatch_delayed_requests(
     I *image_ctx, LatencyStats *latency_stats, Mutex *latency_stats_lock) {
+  uint64_t merged = 0;
   for (auto &it : m_delayed_requests) {
     auto offset = it.first;
     auto &merged_requests = it.second;
+    merged += merged_requests.requests.size() - 1;
 
     auto ctx = new FunctionContext(
         [this, requests=std::move(merged_requests.requests), latency_stats,
@@ -167,6 +193,7 @@ void SimpleSchedulerObjectDispatch<I>::ObjectRequests::dispatch_delayed_requests
   }
 
   m_dispatch_time = utime_t();
+  return merged;
 }
 
 template <typename I>
@@ -185,6 +212,7 @@ SimpleSchedulerObjectDispatch<I>::SimpleSchedulerObjectDispatch(
   if (m_max_delay == 0) {
     m_latency_stats = std::make_unique<LatencyStats>();
   }
+  m_merge_stats = std::make_unique<MergeStats>();
 }
 
 template <typename I>
@@ -357,12 +385,23 @@ bool SimpleSchedulerObjectDispatch<I>::try_delay_write(
     return false;
   }
 
+  // delaying only adds latency if the writes don't merge; keep an
+  // occasional delay to notice when they start to
+  if (!m_merge_stats->is_merging() &&
+      ++m_unmerged_skips % MERGE_PROBE_INTERVAL != 0) {
+    ldout(cct, 20) << "recent delays did not merge" << dendl;
+    return false;
+  }
+
   auto &object_requests = it->second;
   bool delayed = object_requests->try_delay_request(
       object_off, std::move(data), snapc, op_flags, object_dispatch_flags,
       on_dispatched);
 
   ldout(cct, 20) << "delayed: " << delayed << dendl;
+  if (delayed) {
+    m_image_ctx->perfcounter->inc(l_librbd_io_sched_delayed);
+  }
 
   // schedule dispatch on the first request added
   if (delayed && !object_requests->is_scheduled_dispatch()) {
@@ -456,8 +495,12 @@ void SimpleSchedulerObjectDispatch<I>::dispatch_delayed_requests(
     return;
   }
 
-  object_requests->dispatch_delayed_requests(m_image_ctx, m_latency_stats.get(),
-                                             &m_lock);
+  auto merged = object_requests->dispatch_delayed_requests(
+    m_image_ctx, m_latency_stats.get(), &m_lock);
+  m_merge_stats->add(merged);
+  if (merged > 0) {
+    m_image_ctx->perfcounter->inc(l_librbd_io_sched_merged, merged);
+  }
 
   ceph_assert(!m_dispatch_queue.empty());
   if (m_dispatch_queue.front() == object_requests) {
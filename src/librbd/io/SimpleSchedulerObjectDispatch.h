@@ -23,6 +23,7 @@ class ImageCtx;
 namespace io {
 
 class LatencyStats;
+class MergeStats;
 
 /**
  * Simple scheduler plugin for object dispatcher layer.
@@ -151,9 +152,10 @@ private:
                            const ::SnapContext &snapc, int op_flags,
                            int object_dispatch_flags, Context* on_dispatched);
 
-    void dispatch_delayed_requests(ImageCtxT *image_ctx,
-                                   LatencyStats *latency_stats,
-                                   Mutex *latency_stats_lock);
+    /// returns the number of requests merged into others
+    uint64_t dispatch_delayed_requests(ImageCtxT *image_ctx,
+                                       LatencyStats *latency_stats,
+                                       Mutex *latency_stats_lock);
 
   private:
     uint64_t m_object_no;
@@ -185,6 +187,8 @@ private:
   std::list<ObjectRequestsRef> m_dispatch_queue;
   Context *m_timer_task = nullptr;
   std::unique_ptr<LatencyStats> m_latency_stats;
+  std::unique_ptr<MergeStats> m_merge_stats;
+  uint64_t m_unmerged_skips = 0;
 
   bool try_delay_write(uint64_t object_no, uint64_t object_off,
                        ceph::bufferlist&& data, const ::SnapContext &snapc,
@@ -184,6 +184,7 @@ Replay<I>::~Replay() {
   ceph_assert(m_aio_modify_safe_contexts.empty());
   ceph_assert(m_op_events.empty());
   ceph_assert(m_in_flight_op_events == 0);
+  ceph_assert(m_on_aio_acked == nullptr);
 }
 
 template <typename I>
@@ -206,6 +207,33 @@ void Replay<I>::process(const EventEntry &event_entry,
 
   on_ready = util::create_async_context_callback(m_image_ctx, on_ready);
 
+  {
+    Mutex::Locker locker(m_lock);
+    if (m_in_flight_aio_unacked > 0 && !is_aio_modify_event(event_entry)) {
+      // ops and flushes are applied once all prior IO has been applied
+      ldout(cct, 20) << ": waiting for " << m_in_flight_aio_unacked
+                     << " in-flight IOs" << dendl;
+      ceph_assert(m_on_aio_acked == nullptr);
+      m_on_aio_acked = new FunctionContext(
+        [this, event_entry, on_ready, on_safe](int r) {
+          if (r < 0) {
+            on_ready->complete(0);
+            m_image_ctx.op_work_queue->queue(on_safe, r);
+            return;
+          }
+          process_event(event_entry, on_ready, on_safe);
+        });
+      return;
+    }
+  }
+
+  process_event(event_entry, on_ready, on_safe);
+}
+
+template <typename I>
+void Replay<I>::process_event(const EventEntry &event_entry,
+                              Context *on_ready, Context *on_safe) {
+  CephContext *cct = m_image_ctx.cct;
   RWLock::RLocker owner_lock(m_image_ctx.owner_lock);
   if (m_image_ctx.exclusive_lock == nullptr ||
       !m_image_ctx.exclusive_lock->accept_ops()) {
@@ -262,6 +290,15 @@ void Replay<I>::shut_down(bool cancel_ops, Context *on_finish) {
     ceph_assert(!m_shut_down);
     m_shut_down = true;
 
+    if (m_on_aio_acked != nullptr) {
+      // the event waiting for in-flight IO is dropped like any other
+      // event after shut down
+      ldout(cct, 5) << ": ignoring event after shut down" << dendl;
+      Context *on_aio_acked = nullptr;
+      std::swap(on_aio_acked, m_on_aio_acked);
+      on_aio_acked->complete(-ESHUTDOWN);
+    }
+
     ceph_assert(m_flush_ctx == nullptr);
     if (m_in_flight_op_events > 0 || flush_comp != nullptr) {
       std::swap(m_flush_ctx, on_finish);
@@ -342,7 +379,7 @@ void Replay<I>::handle_event(const journal::AioDiscardEvent &event,
   ldout(cct, 20) << ": AIO discard event" << dendl;
 
   bool flush_required;
-  auto aio_comp = create_aio_modify_completion(on_ready, on_safe,
+  auto aio_comp = create_aio_modify_completion(&on_ready, on_safe,
                                                io::AIO_TYPE_DISCARD,
                                                &flush_required,
                                                {});
@@ -356,6 +393,11 @@ void Replay<I>::handle_event(const journal::AioDiscardEvent &event,
                                      event.discard_granularity_bytes, {});
   }
 
+  if (on_ready != nullptr) {
+    // later IO can be issued while this IO is in flight
+    on_ready->complete(0);
+  }
+
   if (flush_required) {
     m_lock.Lock();
     auto flush_comp = create_aio_flush_completion(nullptr);
@@ -376,7 +418,7 @@ void Replay<I>::handle_event(const journal::AioWriteEvent &event,
 
   bufferlist data = event.data;
   bool flush_required;
-  auto aio_comp = create_aio_modify_completion(on_ready, on_safe,
+  auto aio_comp = create_aio_modify_completion(&on_ready, on_safe,
                                                io::AIO_TYPE_WRITE,
                                                &flush_required,
                                                {});
@@ -390,6 +432,11 @@ void Replay<I>::handle_event(const journal::AioWriteEvent &event,
                                    std::move(data), 0, {});
   }
 
+  if (on_ready != nullptr) {
+    // later IO can be issued while this IO is in flight
+    on_ready->complete(0);
+  }
+
   if (flush_required) {
     m_lock.Lock();
     auto flush_comp = create_aio_flush_completion(nullptr);
@@ -429,7 +476,7 @@ void Replay<I>::handle_event(const journal::AioWriteSameEvent &event,
 
   bufferlist data = event.data;
   bool flush_required;
-  auto aio_comp = create_aio_modify_completion(on_ready, on_safe,
+  auto aio_comp = create_aio_modify_completion(&on_ready, on_safe,
                                                io::AIO_TYPE_WRITESAME,
                                                &flush_required,
                                                {});
@@ -443,6 +490,11 @@ void Replay<I>::handle_event(const journal::AioWriteSameEvent &event,
                                        std::move(data), 0, {});
   }
 
+  if (on_ready != nullptr) {
+    // later IO can be issued while this IO is in flight
+    on_ready->complete(0);
+  }
+
   if (flush_required) {
     m_lock.Lock();
     auto flush_comp = create_aio_flush_completion(nullptr);
@@ -464,7 +516,7 @@ void Replay<I>::handle_event(const journal::AioWriteSameEvent &event,
   bufferlist cmp_data = event.cmp_data;
   bufferlist write_data = event.write_data;
   bool flush_required;
-  auto aio_comp = create_aio_modify_completion(on_ready, on_safe,
+  auto aio_comp = create_aio_modify_completion(&on_ready, on_safe,
                                                io::AIO_TYPE_COMPARE_AND_WRITE,
                                                &flush_required,
                                                {-EILSEQ});
@@ -477,6 +529,11 @@ void Replay<I>::handle_event(const journal::AioWriteSameEvent &event,
                                                nullptr, 0, {});
   }
 
+  if (on_ready != nullptr) {
+    // later IO can be issued while this IO is in flight
+    on_ready->complete(0);
+  }
+
   if (flush_required) {
     m_lock.Lock();
     auto flush_comp = create_aio_flush_completion(nullptr);
@@ -892,6 +949,13 @@ void Replay<I>::handle_aio_modify_complete(Context *on_ready, Context *on_safe,
     on_ready->complete(0);
   }
 
+  ceph_assert(m_in_flight_aio_unacked > 0);
+  if (--m_in_flight_aio_unacked == 0 && m_on_aio_acked != nullptr) {
+    Context *on_aio_acked = nullptr;
+    std::swap(on_aio_acked, m_on_aio_acked);
+    m_image_ctx.op_work_queue->queue(on_aio_acked, 0);
+  }
+
   if (filters.find(r) != filters.end())
     r = 0;
 
@@ -1064,7 +1128,7 @@ void Replay<I>::handle_op_complete(uint64_t op_tid, int r) {
 
 template <typename I>
 io::AioCompletion *
-Replay<I>::create_aio_modify_completion(Context *on_ready,
+Replay<I>::create_aio_modify_completion(Context **on_ready,
                                         Context *on_safe,
                                         io::aio_type_t aio_type,
                                         bool *flush_required,
@@ -1075,12 +1139,14 @@ Replay<I>::create_aio_modify_completion(Context *on_ready,
 
   if (m_shut_down) {
     ldout(cct, 5) << ": ignoring event after shut down" << dendl;
-    on_ready->complete(0);
+    (*on_ready)->complete(0);
+    *on_ready = nullptr;
     m_image_ctx.op_work_queue->queue(on_safe, -ESHUTDOWN);
     return nullptr;
   }
 
   ++m_in_flight_aio_modify;
+  ++m_in_flight_aio_unacked;
   m_aio_modify_unsafe_contexts.push_back(on_safe);
 
   // FLUSH if we hit the low-water mark -- on_safe contexts are
@@ -1103,14 +1169,15 @@ Replay<I>::create_aio_modify_completion(Context *on_ready,
     ldout(cct, 10) << ": hit AIO replay high-water mark: pausing replay"
                    << dendl;
     ceph_assert(m_on_aio_ready == nullptr);
-    std::swap(m_on_aio_ready, on_ready);
+    std::swap(m_on_aio_ready, *on_ready);
   }
 
-  // when the modification is ACKed by librbd, we can process the next
-  // event. when flushed, the completion of the next flush will fire the
-  // on_safe callback
+  // otherwise the caller can process the next event as soon as the
+  // modification has been issued: librbd keeps overlapping IO in order.
+  // when flushed, the completion of the next flush will fire the on_safe
+  // callback
   auto aio_comp = io::AioCompletion::create_and_start<Context>(
-    new C_AioModifyComplete(this, on_ready, on_safe, std::move(filters)),
+    new C_AioModifyComplete(this, nullptr, on_safe, std::move(filters)),
     util::get_image_ctx(&m_image_ctx), aio_type);
   return aio_comp;
 }
@@ -123,6 +123,7 @@ private:
 
   uint64_t m_in_flight_aio_flush = 0;
   uint64_t m_in_flight_aio_modify = 0;
+  uint64_t m_in_flight_aio_unacked = 0;
   Contexts m_aio_modify_unsafe_contexts;
   ContextSet m_aio_modify_safe_contexts;
 
@@ -132,6 +133,22 @@ private:
   bool m_shut_down = false;
   Context *m_flush_ctx = nullptr;
   Context *m_on_aio_ready = nullptr;
+  Context *m_on_aio_acked = nullptr;
+
+  static bool is_aio_modify_event(const EventEntry &event_entry) {
+    switch (event_entry.get_event_type()) {
+    case EVENT_TYPE_AIO_DISCARD:
+    case EVENT_TYPE_AIO_WRITE:
+    case EVENT_TYPE_AIO_WRITESAME:
+    case EVENT_TYPE_AIO_COMPARE_AND_WRITE:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  void process_event(const EventEntry &event_entry,
+                     Context *on_ready, Context *on_safe);
 
   void handle_event(const AioDiscardEvent &event, Context *on_ready,
                     Context *on_safe);
@@ -185,7 +202,7 @@ private:
                                       Context *on_safe, OpEvent **op_event);
   void handle_op_complete(uint64_t op_tid, int r);
 
-  io::AioCompletion *create_aio_modify_completion(Context *on_ready,
+  io::AioCompletion *create_aio_modify_completion(Context **on_ready,
                                                   Context *on_safe,
                                                   io::aio_type_t aio_type,
                                                   bool *flush_required,
@@ -187,12 +187,21 @@ void Log::submit_entry(Entry&& e)
   while (is_started() &&
 	 m_new.size() > m_max_new) {
     if (m_stop) break; // force addition
+    ++m_loggers_waiting;
     m_cond_loggers.wait(lock);
+    --m_loggers_waiting;
   }
 
   m_new.emplace_back(std::move(e));
-  m_cond_flusher.notify_all();
+  // the flush thread only sleeps with m_new empty, so it needs a wakeup
+  // just for the first entry of a batch, not for every entry
+  const bool wake = m_flusher_sleeping;
+  m_flusher_sleeping = false;
   m_queue_mutex_holder = 0;
+  lock.unlock();
+  if (wake) {
+    m_cond_flusher.notify_one();
+  }
 }
 
 void Log::flush()
@@ -205,7 +214,9 @@ void Log::flush()
     m_queue_mutex_holder = pthread_self();
     assert(m_flush.empty());
     m_flush.swap(m_new);
-    m_cond_loggers.notify_all();
+    if (m_loggers_waiting) {
+      m_cond_loggers.notify_all();
+    }
     m_queue_mutex_holder = 0;
   }
 
@@ -420,7 +431,9 @@ void *Log::entry()
         continue;
       }
 
+      m_flusher_sleeping = true;
       m_cond_flusher.wait(lock);
+      m_flusher_sleeping = false;
     }
     m_queue_mutex_holder = 0;
   }
@@ -45,6 +45,9 @@ class Log : private Thread
   pthread_t m_queue_mutex_holder;
   pthread_t m_flush_mutex_holder;
 
+  bool m_flusher_sleeping = false; ///< the flush thread waits for entries
+  std::size_t m_loggers_waiting = 0; ///< submitters waiting for room in m_new
+
   EntryVector m_new;    ///< new entries
   EntryRing m_recent; ///< recent (less new) entries we've already written at low detail
   EntryVector m_flush; ///< entries to be flushed (here to optimize heap allocations)
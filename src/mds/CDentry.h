@@ -353,7 +353,7 @@ public:
   SimpleLock lock; // FIXME referenced containers not in mempool
   LocalLock versionlock; // FIXME referenced containers not in mempool
 
-  mempool::mds_co::map<client_t,ClientLease*> client_lease_map;
+  mempool::mds_co::compact_map<client_t,ClientLease*> client_lease_map;
 
 
 protected:
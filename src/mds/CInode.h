@@ -615,7 +615,7 @@ public:
   // -- distributed state --
 protected:
   // file capabilities
-  using mempool_cap_map = mempool::mds_co::map<client_t, Capability>;
+  using mempool_cap_map = mempool::mds_co::compact_map<client_t, Capability>;
   mempool_cap_map client_caps;         // client -> caps
   mempool::mds_co::compact_map<int32_t, int32_t>      mds_caps_wanted;     // [auth] mds -> caps wanted
   int replica_caps_wanted = 0; // [replica] what i've requested from auth
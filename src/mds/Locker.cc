@@ -1992,7 +1992,7 @@ bool Locker::issue_caps(CInode *in, Capability *only_cap)
   int nissued = 0;        
 
   // client caps
-  map<client_t, Capability>::iterator it;
+  CInode::mempool_cap_map::iterator it;
   if (only_cap)
     it = in->client_caps.find(only_cap->get_client());
   else
@@ -2488,7 +2488,7 @@ void Locker::share_inode_max_size(CInode *in, Capability *only_cap)
    * the cap later.
    */
   dout(10) << "share_inode_max_size on " << *in << dendl;
-  map<client_t, Capability>::iterator it;
+  CInode::mempool_cap_map::iterator it;
   if (only_cap)
     it = in->client_caps.find(only_cap->get_client());
   else
@@ -3801,7 +3801,7 @@ void Locker::revoke_client_leases(SimpleLock *lock)
 {
   int n = 0;
   CDentry *dn = static_cast<CDentry*>(lock->get_parent());
-  for (map<client_t, ClientLease*>::iterator p = dn->client_lease_map.begin();
+  for (auto p = dn->client_lease_map.begin();
        p != dn->client_lease_map.end();
        ++p) {
     ClientLease *l = p->second;
@@ -217,6 +217,17 @@ public:
 };
 
 
+/*
+ * The load of a subtree, in the units the balancer compares and moves:
+ * the weighted popularity, or in mode 3 the request service time.
+ */
+static double subtree_load(const dirfrag_load_vec_t& pop)
+{
+  if (g_conf()->mds_bal_mode == 3)
+    return pop.svc_load();
+  return pop.meta_load();
+}
+
 double mds_load_t::mds_load() const
 {
   switch(g_conf()->mds_bal_mode) {
@@ -233,6 +244,16 @@ double mds_load_t::mds_load() const
   case 2:
     return cpu_load_avg;
 
+  case 3:
+    {
+      // the time spent serving requests, plus what the queued ones
+      // will take at the current average
+      double svc = auth.svc_load();
+      double reqs = auth.get(META_POP_IRD).get() +
+                    auth.get(META_POP_IWR).get() +
+                    auth.get(META_POP_READDIR).get();
+      return svc + (reqs > 0 ? queue_len * svc / reqs : 0.0);
+    }
   }
   ceph_abort();
   return 0;
@@ -382,7 +403,7 @@ void MDBalancer::send_heartbeat()
     mds_rank_t from = im->inode->authority().first;
     if (from == mds->get_nodeid()) continue;
     if (im->get_inode()->is_stray()) continue;
-    import_map[from] += im->pop_auth_subtree.meta_load();
+    import_map[from] += subtree_load(im->pop_auth_subtree);
   }
   mds_import_map[ mds->get_nodeid() ] = import_map;
 
@@ -638,7 +659,7 @@ void MDBalancer::prep_rebalance(int beat)
     double load_fac = 1.0;
     map<mds_rank_t, mds_load_t>::iterator m = mds_load.find(whoami);
     if ((m != mds_load.end()) && (m->second.mds_load() > 0)) {
-      double metald = m->second.auth.meta_load();
+      double metald = subtree_load(m->second.auth);
       double mdsld = m->second.mds_load();
       load_fac = metald / mdsld;
       dout(7) << " load_fac is " << load_fac
@@ -853,7 +874,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
       continue;  // export pbly already in progress
 
     mds_rank_t from = diri->authority().first;
-    double pop = dir->pop_auth_subtree.meta_load();
+    double pop = subtree_load(dir->pop_auth_subtree);
     if (g_conf()->mds_bal_idle_threshold > 0 &&
 	pop < g_conf()->mds_bal_idle_threshold &&
 	diri != mds->mdcache->get_root() &&
@@ -988,7 +1009,7 @@ void MDBalancer::try_rebalance(balance_state_t& state)
 
     for (const auto& dir : exports) {
       dout(5) << "   - exporting " << dir->pop_auth_subtree
-	      << " " << dir->pop_auth_subtree.meta_load()
+	      << " " << subtree_load(dir->pop_auth_subtree)
 	      << " to mds." << target << " " << *dir << dendl;
       mds->mdcache->migrator->export_dir_nicely(dir, target);
     }
@@ -1026,7 +1047,7 @@ void MDBalancer::find_exports(CDir *dir,
   std::vector<CDir*> bigger_rep, bigger_unrep;
   multimap<double, CDir*> smaller;
 
-  double dir_pop = dir->pop_auth_subtree.meta_load();
+  double dir_pop = subtree_load(dir->pop_auth_subtree);
   dout(7) << " find_exports in " << dir_pop << " " << *dir << " need " << need << " (" << needmin << " - " << needmax << ")" << dendl;
 
   double subdir_sum = 0;
@@ -1052,7 +1073,7 @@ void MDBalancer::find_exports(CDir *dir,
 	continue;  // can't export this right now!
 
       // how popular?
-      double pop = subdir->pop_auth_subtree.meta_load();
+      double pop = subtree_load(subdir->pop_auth_subtree);
       subdir_sum += pop;
       dout(15) << "   subdir pop " << pop << " " << *subdir << dendl;
 
@@ -9471,6 +9471,9 @@ void MDCache::do_realm_invalidate_and_update_notify(CInode *in, int snapop, bool
 
   set<SnapRealm*> past_children;
   map<client_t, ref_t<MClientSnap>> updates;
+  // every client gets the same update; encode it once, and hand out
+  // messages sharing its payload instead of copying split_inos per client
+  ref_t<MClientSnap> shared_update;
   list<SnapRealm*> q;
   q.push_back(in->snaprealm);
   while (!q.empty()) {
@@ -9488,11 +9491,20 @@ void MDCache::do_realm_invalidate_and_update_notify(CInode *in, int snapop, bool
 
         auto em = updates.emplace(std::piecewise_construct, std::forward_as_tuple(client), std::forward_as_tuple());
         if (em.second) {
+	  if (!shared_update) {
+	    shared_update = make_message<MClientSnap>(CEPH_SNAP_OP_SPLIT);
+	    shared_update->head.split = in->ino();
+	    shared_update->split_inos = std::move(split_inos);
+	    shared_update->split_realms = std::move(split_realms);
+	    shared_update->bl = in->snaprealm->get_snap_trace();
+	    shared_update->encode_payload(0);
+	    dout(10) << " split " << shared_update->split_inos.size() << " inos "
+		     << shared_update->split_realms.size() << " realms" << dendl;
+	  }
           auto update = make_message<MClientSnap>(CEPH_SNAP_OP_SPLIT);
-	  update->head.split = in->ino();
-	  update->split_inos = split_inos;
-	  update->split_realms = split_realms;
-	  update->bl = in->snaprealm->get_snap_trace();
+	  update->head = shared_update->head;
+	  bufferlist payload = shared_update->get_payload();
+	  update->set_payload(payload);
 	  em.first->second = std::move(update);
 	}
       }
@@ -66,12 +66,19 @@ void MDLog::create_logger()
   plb.add_u64(l_mdl_segexd, "segexd", "Current expired segments");
   plb.add_u64_counter(l_mdl_replayed, "replayed", "Events replayed",
 		      "repl", PerfCountersBuilder::PRIO_INTERESTING);
+  plb.add_u64_counter(l_mdl_replayed_bytes, "replayed_bytes",
+		      "Bytes of events replayed", NULL, 0, unit_t(UNIT_BYTES));
+  plb.add_time_avg(l_mdl_replay_wait, "replay_wait",
+		   "Time replay waited for the journal to be read");
   plb.add_time_avg(l_mdl_jlat, "jlat", "Journaler flush latency");
   plb.add_u64_counter(l_mdl_evex, "evex", "Total expired events");
   plb.add_u64_counter(l_mdl_evtrm, "evtrm", "Trimmed events");
   plb.add_u64_counter(l_mdl_segadd, "segadd", "Segments added");
   plb.add_u64_counter(l_mdl_segex, "segex", "Total expired segments");
   plb.add_u64_counter(l_mdl_segtrm, "segtrm", "Trimmed segments");
+  plb.add_u64_counter(l_mdl_flush, "flush", "Journal flushes");
+  plb.add_u64_avg(l_mdl_flushev, "flushev", "Events per journal flush");
+  plb.add_u64_avg(l_mdl_flushsz, "flushsz", "Bytes per journal flush");
 
   plb.set_prio_default(PerfCountersBuilder::PRIO_DEBUGONLY);
   plb.add_u64(l_mdl_expos, "expos", "Journaler xpire position");
@@ -350,6 +357,28 @@ public:
   }
 };
 
+void MDLog::_request_flush(double interval)
+{
+  ceph_assert(submit_mutex.is_locked_by_me());
+  if (!flush_requested) {
+    flush_requested = true;
+    flush_deadline = ceph_clock_now();
+    flush_deadline += interval;
+  }
+}
+
+void MDLog::_note_flush()
+{
+  ceph_assert(submit_mutex.is_locked_by_me());
+  if (logger && batch_events) {
+    logger->inc(l_mdl_flush);
+    logger->inc(l_mdl_flushev, batch_events);
+    logger->inc(l_mdl_flushsz, batch_bytes);
+  }
+  batch_events = 0;
+  batch_bytes = 0;
+}
+
 void MDLog::_submit_thread()
 {
   dout(10) << "_submit_thread start" << dendl;
@@ -362,9 +391,27 @@ void MDLog::_submit_thread()
       continue;
     }
 
+    const double interval =
+      g_conf().get_val<double>("mds_log_group_commit_interval");
+    if (flush_requested &&
+	(interval <= 0 || ceph_clock_now() >= flush_deadline ||
+	 batch_bytes >= g_conf().get_val<Option::size_t>("mds_log_group_commit_max_bytes"))) {
+      dout(10) << "_submit_thread group flush of " << batch_events
+	       << " events, " << batch_bytes << " bytes" << dendl;
+      flush_requested = false;
+      _note_flush();
+      submit_mutex.Unlock();
+      journaler->flush();
+      submit_mutex.Lock();
+      continue;
+    }
+
     map<uint64_t,list<PendingEvent> >::iterator it = pending_events.begin();
     if (it == pending_events.end()) {
-      submit_cond.Wait(submit_mutex);
+      if (flush_requested)
+	submit_cond.WaitUntil(submit_mutex, flush_deadline);
+      else
+	submit_cond.Wait(submit_mutex);
       continue;
     }
 
@@ -376,6 +423,9 @@ void MDLog::_submit_thread()
     int64_t features = mdsmap_up_features;
     PendingEvent data = it->second.front();
     it->second.pop_front();
+    // batch the flush with the events that follow
+    const bool batch = data.flush && interval > 0;
+    uint64_t len = 0;
 
     submit_mutex.Unlock();
 
@@ -385,6 +435,7 @@ void MDLog::_submit_thread()
       // encode it, with event type
       bufferlist bl;
       le->encode_with_header(bl, features);
+      len = bl.length();
 
       uint64_t write_pos = journaler->get_write_pos();
 
@@ -410,7 +461,7 @@ void MDLog::_submit_thread()
 
       journaler->wait_for_flush(fin);
 
-      if (data.flush)
+      if (data.flush && !batch)
 	journaler->flush();
 
       if (logger)
@@ -426,14 +477,22 @@ void MDLog::_submit_thread()
 	fin2->set_write_pos(journaler->get_write_pos());
 	journaler->wait_for_flush(fin2);
       }
-      if (data.flush)
+      if (data.flush && !batch)
 	journaler->flush();
     }
 
     submit_mutex.Lock();
-    if (data.flush)
+    if (data.le) {
+      batch_events++;
+      batch_bytes += len;
+    }
+    if (data.flush) {
       unflushed = 0;
-    else if (data.le)
+      if (batch)
+	_request_flush(interval);
+      else
+	_note_flush();
+    } else if (data.le)
       unflushed++;
   }
 
@@ -467,6 +526,17 @@ void MDLog::flush()
     pending_events.rbegin()->second.push_back(PendingEvent(NULL, NULL, true));
     do_flush = false;
     submit_cond.Signal();
+  } else if (do_flush) {
+    const double interval =
+      g_conf().get_val<double>("mds_log_group_commit_interval");
+    if (interval > 0) {
+      // leave it to the submit thread, with the events to come
+      _request_flush(interval);
+      do_flush = false;
+      submit_cond.Signal();
+    } else {
+      _note_flush();
+    }
   }
 
   submit_mutex.Unlock();
@@ -1298,16 +1368,55 @@ void MDLog::_replay_thread()
 {
   dout(10) << "_replay_thread start" << dendl;
 
+  // events are decoded as they are read, and applied in batches so that
+  // the mds_lock is taken once per batch rather than once per event
+  const uint64_t batch_events =
+    g_conf().get_val<uint64_t>("mds_log_replay_batch_events");
+  std::vector<std::unique_ptr<LogEvent>> batch;
+  batch.reserve(batch_events);
+  uint64_t batch_bytes = 0;
+  auto replay_batch = [&]() {
+    if (batch.empty()) {
+      return true;
+    }
+    std::lock_guard l(mds->mds_lock);
+    if (mds->is_daemon_stopping()) {
+      return false;
+    }
+    for (auto& le : batch) {
+      le->replay(mds);
+    }
+    logger->inc(l_mdl_replayed, batch.size());
+    logger->inc(l_mdl_replayed_bytes, batch_bytes);
+    batch.clear();
+    batch_bytes = 0;
+    return true;
+  };
+
   // loop
   int r = 0;
   while (1) {
+    // apply what was decoded before waiting for more, or handling an error
+    if (batch.size() >= batch_events ||
+	!journaler->is_readable() || journaler->get_error()) {
+      if (!replay_batch()) {
+	return;
+      }
+    }
+
     // wait for read?
-    while (!journaler->is_readable() &&
-	   journaler->get_read_pos() < journaler->get_write_pos() &&
-	   !journaler->get_error()) {
-      C_SaferCond readable_waiter;
-      journaler->wait_for_readable(&readable_waiter);
-      r = readable_waiter.wait();
+    if (!journaler->is_readable() &&
+	journaler->get_read_pos() < journaler->get_write_pos() &&
+	!journaler->get_error()) {
+      utime_t start = ceph_clock_now();
+      while (!journaler->is_readable() &&
+	     journaler->get_read_pos() < journaler->get_write_pos() &&
+	     !journaler->get_error()) {
+	C_SaferCond readable_waiter;
+	journaler->wait_for_readable(&readable_waiter);
+	r = readable_waiter.wait();
+      }
+      logger->tinc(l_mdl_replay_wait, ceph_clock_now() - start);
     }
     if (journaler->get_error()) {
       r = journaler->get_error();
@@ -1407,6 +1516,11 @@ void MDLog::_replay_thread()
     // new segment?
     if (le->get_type() == EVENT_SUBTREEMAP ||
 	le->get_type() == EVENT_RESETJOURNAL) {
+      // the events of the current segment go first, batches don't span
+      // segments
+      if (!replay_batch()) {
+	return;
+      }
       auto sle = dynamic_cast<ESubtreeMap*>(le.get());
       if (sle && sle->event_seq > 0)
 	event_seq = sle->event_seq;
@@ -1430,19 +1544,17 @@ void MDLog::_replay_thread()
       le->_segment->end = journaler->get_read_pos();
       num_events++;
 
-      {
-        std::lock_guard l(mds->mds_lock);
-        if (mds->is_daemon_stopping()) {
-          return;
-        }
-        logger->inc(l_mdl_replayed);
-        le->replay(mds);
-      }
+      batch_bytes += bl.length();
+      batch.push_back(std::move(le));
     }
 
     logger->set(l_mdl_rdpos, pos);
   }
 
+  if (!replay_batch()) {
+    return;
+  }
+
   // done!
   if (r == 0) {
     ceph_assert(journaler->get_read_pos() == journaler->get_write_pos());
@@ -35,6 +35,11 @@ enum {
   l_mdl_rdpos,
   l_mdl_jlat,
   l_mdl_replayed,
+  l_mdl_replayed_bytes,
+  l_mdl_replay_wait,
+  l_mdl_flush,
+  l_mdl_flushev,
+  l_mdl_flushsz,
   l_mdl_last,
 };
 
@@ -140,6 +145,16 @@ protected:
   Mutex submit_mutex;
   Cond submit_cond;
 
+  // group commit: with mds_log_group_commit_interval set, a flush waits
+  // for the events that follow it until flush_deadline, or until
+  // mds_log_group_commit_max_bytes were journaled since the last one
+  bool flush_requested;
+  utime_t flush_deadline;
+  uint64_t batch_events; // journaled since the last flush
+  uint64_t batch_bytes;
+  void _request_flush(double interval);
+  void _note_flush();
+
   void set_safe_pos(uint64_t pos)
   {
     std::lock_guard l(submit_mutex);
@@ -206,6 +221,8 @@ public:
                       event_seq(0), expiring_events(0), expired_events(0),
 		      mdsmap_up_features(0),
                       submit_mutex("MDLog::submit_mutex"),
+                      flush_requested(false),
+                      batch_events(0), batch_bytes(0),
                       submit_thread(this),
                       cur_event(NULL) { }		  
   ~MDLog();
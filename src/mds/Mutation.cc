@@ -352,6 +352,15 @@ void MDRequestImpl::set_filepath2(const filepath& fp)
   more()->filepath2 = fp;
 }
 
+void MDRequestImpl::end_dispatch()
+{
+  if (dispatch_start != ceph::mono_time()) {
+    service_time += std::chrono::duration<double>(
+      ceph::mono_clock::now() - dispatch_start).count();
+    dispatch_start = ceph::mono_time();
+  }
+}
+
 bool MDRequestImpl::is_queued_for_replay() const
 {
   return client_request ? client_request->is_queued_for_replay() : false;
@@ -264,6 +264,8 @@ struct MDRequestImpl : public MutationImpl {
   bool did_early_reply = false;
   bool o_trunc = false;		///< request is an O_TRUNC mutation
   bool has_completed = false;	///< request has already completed
+  ceph::mono_time dispatch_start;	///< start of the current dispatch, if any
+  double service_time = 0;	///< seconds spent dispatching the request
 
   bufferlist reply_extra_bl;
 
@@ -398,6 +400,8 @@ struct MDRequestImpl : public MutationImpl {
   void set_filepath(const filepath& fp);
   void set_filepath2(const filepath& fp);
   bool is_queued_for_replay() const;
+  void start_dispatch() { dispatch_start = ceph::mono_clock::now(); }
+  void end_dispatch();
 
   void print(ostream &out) const override;
   void dump(Formatter *f) const override;
@@ -1015,6 +1015,36 @@ void OpenFileTable::_open_ino_finish(inodeno_t ino, int r)
   }
 }
 
+class C_OFT_FetchFileInos: public MDSContext {
+  OpenFileTable *oft;
+  std::vector<inodeno_t> inos;
+  MDSRank *get_mds() override { return oft->mds; }
+public:
+  C_OFT_FetchFileInos(OpenFileTable *t, std::vector<inodeno_t>&& i) :
+    oft(t), inos(std::move(i)) {}
+  void finish(int r) override {
+    oft->_fetch_file_inos_finish(inos);
+  }
+};
+
+void OpenFileTable::_open_file_ino(inodeno_t ino)
+{
+  num_opening_inodes++;
+  mds->mdcache->open_ino(ino, mds->mdsmap->get_first_data_pool(),
+			 new C_OFT_OpenInoFinish(this, ino), false);
+}
+
+void OpenFileTable::_fetch_file_inos_finish(const std::vector<inodeno_t>& inos)
+{
+  // whatever the dirfrag didn't have (renamed, hard links...) is looked
+  // up by its backtrace
+  for (auto ino : inos) {
+    if (!mds->mdcache->get_inode(ino))
+      _open_file_ino(ino);
+  }
+  _open_ino_finish(inodeno_t(0), 0);
+}
+
 void OpenFileTable::_prefetch_dirfrags()
 {
   dout(10) << __func__ << dendl;
@@ -1102,6 +1132,9 @@ void OpenFileTable::_prefetch_inodes()
       destroyed_inos_set.insert(it.second.begin(), it.second.end());
   }
 
+  // open file inodes to read from their dirfrags, by dirfrag
+  std::map<CDir*, std::vector<inodeno_t> > dir_fetches;
+
   for (auto& it : loaded_anchor_map) {
     if (destroyed_inos_set.count(it.first))
 	continue;
@@ -1125,6 +1158,24 @@ void OpenFileTable::_prefetch_inodes()
     if (in)
       continue;
 
+    if (prefetch_state == FILE_INODES) {
+      // read the file's dentry out of its parent dirfrag, along with the
+      // others open in it, rather than its backtrace out of the data pool
+      CInode *diri = mdcache->get_inode(it.second.dirino);
+      if (diri && diri->is_dir() &&
+	  !diri->state_test(CInode::STATE_REJOINUNDEF)) {
+	frag_t fg = diri->pick_dirfrag(it.second.d_name);
+	CDir *dir = diri->get_dirfrag(fg);
+	if (!dir && diri->is_auth())
+	  dir = diri->get_or_open_dirfrag(mdcache, fg);
+	if (dir && dir->is_auth() && !dir->is_complete() &&
+	    !dir->state_test(CDir::STATE_REJOINUNDEF)) {
+	  dir_fetches[dir].push_back(it.first);
+	  continue;
+	}
+      }
+    }
+
     num_opening_inodes++;
     mdcache->open_ino(it.first, pool, new C_OFT_OpenInoFinish(this, it.first), false);
 
@@ -1132,6 +1183,28 @@ void OpenFileTable::_prefetch_inodes()
       mds->heartbeat_reset();
   }
 
+  const size_t keys_per_fetch = g_conf()->mds_dir_keys_per_op;
+  int num_fetches = 0;
+  for (auto& p : dir_fetches) {
+    CDir *dir = p.first;
+    auto& inos = p.second;
+    for (size_t i = 0; i < inos.size(); i += keys_per_fetch) {
+      std::vector<inodeno_t> batch(inos.begin() + i,
+				   inos.begin() + std::min(inos.size(), i + keys_per_fetch));
+      std::set<dentry_key_t> keys;
+      for (auto ino : batch) {
+	auto& anchor = loaded_anchor_map.at(ino);
+	keys.insert(dentry_key_t(CEPH_NOSNAP, anchor.d_name,
+				 dir->get_inode()->hash_dentry_name(anchor.d_name)));
+      }
+      num_opening_inodes++;
+      dir->fetch(new C_OFT_FetchFileInos(this, std::move(batch)), keys);
+
+      if (!(++num_fetches % 1000))
+	mds->heartbeat_reset();
+    }
+  }
+
   _open_ino_finish(inodeno_t(0), 0);
 }
 
@@ -132,6 +132,8 @@ protected:
   unsigned num_opening_inodes = 0;
   MDSContext::vec waiting_for_prefetch;
   void _open_ino_finish(inodeno_t ino, int r);
+  void _open_file_ino(inodeno_t ino);
+  void _fetch_file_inos_finish(const std::vector<inodeno_t>& inos);
   void _prefetch_inodes();
   void _prefetch_dirfrags();
 
@@ -143,6 +145,7 @@ protected:
   friend class C_IO_OFT_Save;
   friend class C_IO_OFT_Journal;
   friend class C_OFT_OpenInoFinish;
+  friend class C_OFT_FetchFileInos;
 };
 
 #endif
@@ -70,8 +70,6 @@ void PurgeItem::decode(bufferlist::const_iterator &p)
   DECODE_FINISH(p);
 }
 
-// TODO: if Objecter has any slow requests, take that as a hint and
-// slow down our rate of purging (keep accepting pushes though)
 PurgeQueue::PurgeQueue(
       CephContext *cct_,
       mds_rank_t rank_,
@@ -354,6 +352,57 @@ uint32_t PurgeQueue::_calculate_ops(const PurgeItem &item) const
   return ops_required;
 }
 
+uint64_t PurgeQueue::_get_max_purge_ops() const
+{
+  if (draining || limit_scale == 1.0) {
+    return max_purge_ops;
+  }
+  uint64_t ops = max_purge_ops * limit_scale;
+  if (cct->_conf->mds_max_purge_ops) {
+    ops = std::min(ops, cct->_conf->mds_max_purge_ops);
+  }
+  return ops;
+}
+
+uint64_t PurgeQueue::_get_max_purge_files() const
+{
+  return cct->_conf->mds_max_purge_files * limit_scale;
+}
+
+/**
+ * Additive increase, multiplicative decrease: the purges completing
+ * quickly while we're throttled say the OSDs have room for more, a slow
+ * one says they're busy (with our deletes or with client IO).
+ */
+void PurgeQueue::_update_limit_scale(ceph::timespan round_latency)
+{
+  const double max_scale = cct->_conf.get_val<double>(
+    "mds_purge_limit_max_scale");
+  const auto target = ceph::make_timespan(
+    cct->_conf.get_val<double>("mds_purge_latency_target"));
+  if (max_scale <= 1.0) {
+    limit_scale = 1.0;
+  } else if (round_latency > target) {
+    // the purges completing right after a slow one were most likely
+    // slowed by the same thing, back off only once for all of them
+    const auto now = ceph::mono_clock::now();
+    if (limit_scale > 1.0 && now - last_scale_down > target) {
+      limit_scale = std::max(1.0, limit_scale / 2);
+      last_scale_down = now;
+      dout(10) << "purge took " << round_latency << " per round, scaling limits"
+               << " down to " << limit_scale << "x" << dendl;
+    }
+  } else if (throttled && limit_scale < max_scale) {
+    // by about 1x for each round of purges in flight
+    limit_scale = std::min(
+      max_scale,
+      limit_scale + 1.0 / std::max<uint64_t>(_get_max_purge_files(), 1));
+    dout(20) << "scaling limits up to " << limit_scale << "x" << dendl;
+  }
+  limit_scale = std::min(limit_scale, std::max(max_scale, 1.0));
+  throttled = false;
+}
+
 bool PurgeQueue::_can_consume()
 {
   if (readonly) {
@@ -361,8 +410,10 @@ bool PurgeQueue::_can_consume()
     return false;
   }
 
-  dout(20) << ops_in_flight << "/" << max_purge_ops << " ops, "
-           << in_flight.size() << "/" << g_conf()->mds_max_purge_files
+  const uint64_t max_ops = _get_max_purge_ops();
+  const uint64_t max_files = _get_max_purge_files();
+  dout(20) << ops_in_flight << "/" << max_ops << " ops, "
+           << in_flight.size() << "/" << max_files
            << " files" << dendl;
 
   if (in_flight.size() == 0 && cct->_conf->mds_max_purge_files > 0) {
@@ -373,15 +424,17 @@ bool PurgeQueue::_can_consume()
     return true;
   }
 
-  if (ops_in_flight >= max_purge_ops) {
+  if (ops_in_flight >= max_ops) {
     dout(20) << "Throttling on op limit " << ops_in_flight << "/"
-             << max_purge_ops << dendl;
+             << max_ops << dendl;
+    throttled = true;
     return false;
   }
 
-  if (in_flight.size() >= cct->_conf->mds_max_purge_files) {
+  if (in_flight.size() >= max_files) {
     dout(20) << "Throttling on item limit " << in_flight.size()
-             << "/" << cct->_conf->mds_max_purge_files << dendl;
+             << "/" << max_files << dendl;
+    throttled = true;
     return false;
   } else {
     return true;
@@ -476,6 +529,8 @@ void PurgeQueue::_execute_item(
   logger->set(l_pq_executing_ops, ops_in_flight);
 
   SnapContext nullsnapc;
+  // Filer deletes a file's objects filer_max_purge_ops at a time
+  uint64_t rounds = 1;
 
   C_GatherBuilder gather(cct);
   if (item.action == PurgeItem::PURGE_FILE) {
@@ -486,6 +541,8 @@ void PurgeQueue::_execute_item(
       filer.purge_range(item.ino, &item.layout, item.snapc,
                         0, num, ceph::real_clock::now(), 0,
                         gather.new_sub());
+      rounds = div_round_up(num, std::max<uint64_t>(
+        g_conf()->filer_max_purge_ops, 1));
     }
 
     // remove the backtrace object if it was not purged
@@ -531,6 +588,8 @@ void PurgeQueue::_execute_item(
       filer.purge_range(item.ino, &item.layout, item.snapc,
 			1, num - 1, ceph::real_clock::now(),
 			0, gather.new_sub());
+      rounds = div_round_up(num - 1, std::max<uint64_t>(
+        g_conf()->filer_max_purge_ops, 1));
     }
     filer.zero(item.ino, &item.layout, item.snapc,
 	       0, item.layout.object_size,
@@ -547,10 +606,12 @@ void PurgeQueue::_execute_item(
   }
   ceph_assert(gather.has_subs());
 
+  const auto start = ceph::mono_clock::now();
   gather.set_finisher(new C_OnFinisher(
-                      new FunctionContext([this, expire_to](int r){
+                      new FunctionContext([this, expire_to, start, rounds](int r){
     std::lock_guard l(lock);
     _execute_item_complete(expire_to);
+    _update_limit_scale((ceph::mono_clock::now() - start) / rounds);
 
     _consume();
 
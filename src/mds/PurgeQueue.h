@@ -15,6 +15,7 @@
 #ifndef PURGE_QUEUE_H_
 #define PURGE_QUEUE_H_
 
+#include "common/ceph_time.h"
 #include "include/compact_set.h"
 #include "mds/MDSMap.h"
 #include "osdc/Journaler.h"
@@ -133,7 +134,17 @@ protected:
   // Dynamic op limit per MDS based on PG count
   uint64_t max_purge_ops;
 
+  // Multiple of the file and op limits currently allowed, raised while
+  // the OSDs keep up with the purges and lowered when they fall behind
+  double limit_scale = 1.0;
+  ceph::mono_time last_scale_down;
+  // Has _can_consume() held back on a limit since the last purge completed?
+  bool throttled = false;
+
   uint32_t _calculate_ops(const PurgeItem &item) const;
+  uint64_t _get_max_purge_ops() const;
+  uint64_t _get_max_purge_files() const;
+  void _update_limit_scale(ceph::timespan round_latency);
 
   bool _can_consume();
 
@@ -43,6 +43,7 @@
 
 #include "include/stringify.h"
 #include "include/filepath.h"
+#include "include/scope_guard.h"
 #include "common/errno.h"
 #include "common/Timer.h"
 #include "common/perf_counters.h"
@@ -1543,6 +1544,7 @@ std::pair<bool, uint64_t> Server::recall_client_state(MDSGatherBuilder* gather,
   const auto recall_global_max_decay_threshold = g_conf().get_val<Option::size_t>("mds_recall_global_max_decay_threshold");
   const auto recall_max_caps = g_conf().get_val<Option::size_t>("mds_recall_max_caps");
   const auto recall_max_decay_threshold = g_conf().get_val<Option::size_t>("mds_recall_max_decay_threshold");
+  const auto recall_min_caps = g_conf().get_val<Option::size_t>("mds_recall_min_caps");
 
   dout(7) << __func__ << ":"
            << " min=" << min_caps_per_client
@@ -1553,14 +1555,28 @@ std::pair<bool, uint64_t> Server::recall_client_state(MDSGatherBuilder* gather,
 
   /* trim caps of sessions with the most caps first */
   std::multimap<uint64_t, Session*> caps_session;
-  auto f = [&caps_session, enforce_max, max_caps_per_client](auto& s) {
+  uint64_t total_caps = 0;
+  auto f = [&caps_session, &total_caps, enforce_max, max_caps_per_client](auto& s) {
     auto num_caps = s->caps.size();
     if (!enforce_max || num_caps > max_caps_per_client) {
       caps_session.emplace(std::piecewise_construct, std::forward_as_tuple(num_caps), std::forward_as_tuple(s));
+      total_caps += num_caps;
     }
   };
   mds->sessionmap.get_client_sessions(std::move(f));
 
+  /* Outside of enforcing the per-client maximum, share what the global
+   * throttle has left among the sessions by the number of caps they hold,
+   * so that the clients caching the most give back the most, and the ones
+   * caching little aren't sent recalls of a handful of caps each.
+   */
+  uint64_t recall_budget = 0;
+  if (!enforce_max) {
+    const uint64_t global_recall_throttle = recall_throttle.get();
+    if (global_recall_throttle < recall_global_max_decay_threshold)
+      recall_budget = recall_global_max_decay_threshold - global_recall_throttle;
+  }
+
   std::pair<bool, uint64_t> result = {false, 0};
   auto& [throttled, caps_recalled] = result;
   last_recall_state = now;
@@ -1585,6 +1601,10 @@ std::pair<bool, uint64_t> Server::recall_client_state(MDSGatherBuilder* gather,
     if (num_caps > newlim) {
       /* now limit the number of caps we recall at a time to prevent overloading ourselves */
       uint64_t recall = std::min<uint64_t>(recall_max_caps, num_caps-newlim);
+      if (!enforce_max && total_caps > 0) {
+        const uint64_t share = (double)recall_budget * num_caps / total_caps;
+        recall = std::min<uint64_t>(recall, std::max<uint64_t>(share, recall_min_caps));
+      }
       newlim = num_caps-recall;
       const uint64_t session_recall_throttle = session->get_recall_caps_throttle();
       const uint64_t session_recall_throttle2o = session->get_recall_caps_throttle2o();
@@ -1911,6 +1931,19 @@ void Server::reply_client_request(MDRequestRef& mdr, const ref_t<MClientReply> &
 
   mdr->mark_event("replying");
 
+  // charge the dirfrag of the request's target for the time spent on it
+  mdr->end_dispatch();
+  if (mdr->service_time > 0 && g_conf()->mds_bal_mode == 3) {
+    CDir *dir = nullptr;
+    if (!mdr->dn[0].empty())
+      dir = mdr->dn[0].back()->get_dir();
+    else if (mdr->in[0])
+      dir = mdr->in[0]->get_parent_dir();
+    if (dir && dir->is_auth())
+      mds->balancer->hit_dir(dir, META_POP_SVC, -1, mdr->service_time);
+    mdr->service_time = 0;
+  }
+
   Session *session = mdr->session;
 
   // note successful request in session map?
@@ -2252,6 +2285,11 @@ void Server::dispatch_client_request(MDRequestRef& mdr)
 
   const cref_t<MClientRequest> &req = mdr->client_request;
 
+  // the time the request takes to serve, for the balancer (mode 3 only)
+  if (g_conf()->mds_bal_mode == 3)
+    mdr->start_dispatch();
+  auto end_dispatch = make_scope_guard([&mdr] { mdr->end_dispatch(); });
+
   if (logger) logger->inc(l_mdss_dispatch_client_request);
 
   dout(7) << "dispatch_client_request " << *req << dendl;
@@ -3489,6 +3527,31 @@ CDir* Server::try_open_auth_dirfrag(CInode *diri, frag_t fg, MDRequestRef& mdr)
   return dir;
 }
 
+/*
+ * Start fetching the dirfrag after dir while the client reads this one,
+ * so that its readdir of the next one doesn't wait for the whole fetch.
+ */
+void Server::prefetch_next_dirfrag(CInode *diri, CDir *dir)
+{
+  if (!g_conf().get_val<bool>("mds_dir_prefetch") ||
+      dir->get_frag().is_rightmost())
+    return;
+
+  frag_t fg = diri->dirfragtree[dir->get_frag().next().value()];
+  CDir *next = diri->get_dirfrag(fg);
+  if (!next) {
+    if (!diri->is_auth() || diri->is_frozen())
+      return;
+    next = diri->get_or_open_dirfrag(mdcache, fg);
+  }
+  if (!next->is_auth() || next->is_complete() || next->is_frozen() ||
+      next->state_test(CDir::STATE_FETCHING) || !next->can_auth_pin())
+    return;
+
+  dout(10) << "prefetch_next_dirfrag " << *next << dendl;
+  next->fetch(nullptr);
+}
+
 
 // ===============================================================================
 // STAT
@@ -4406,6 +4469,10 @@ void Server::handle_client_readdir(MDRequestRef& mdr)
     flags |= CEPH_READDIR_HASH_ORDER | CEPH_READDIR_OFFSET_HASH;
   }
   
+  // the client moves on to the next frag once it's done with this one
+  if (start)
+    prefetch_next_dirfrag(diri, dir);
+
   // finish final blob
   encode(numfiles, dirbl);
   encode(flags, dirbl);
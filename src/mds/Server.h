@@ -223,6 +223,7 @@ public:
 				    file_layout_t **layout=nullptr);
 
   CDir* try_open_auth_dirfrag(CInode *diri, frag_t fg, MDRequestRef& mdr);
+  void prefetch_next_dirfrag(CInode *diri, CDir *dir);
 
 
   // requests on existing inodes.
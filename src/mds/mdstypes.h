@@ -1519,6 +1519,7 @@ namespace std {
 #define META_POP_READDIR 2
 #define META_POP_FETCH   3
 #define META_POP_STORE   4
+#define META_POP_SVC     5 // seconds spent serving requests
 #define META_NPOP        5
 
 class inode_load_vec_t {
@@ -1557,31 +1558,37 @@ class dirfrag_load_vec_t {
 public:
   using time = DecayCounter::time;
   using clock = DecayCounter::clock;
-  static const size_t NUM = 5;
+  static const size_t NUM = 6;
 
   dirfrag_load_vec_t() :
       vec{DecayCounter(DecayRate()),
           DecayCounter(DecayRate()),
           DecayCounter(DecayRate()),
           DecayCounter(DecayRate()),
+          DecayCounter(DecayRate()),
           DecayCounter(DecayRate())
          }
   {}
   dirfrag_load_vec_t(const DecayRate &rate) : 
-      vec{DecayCounter(rate), DecayCounter(rate), DecayCounter(rate), DecayCounter(rate), DecayCounter(rate)}
+      vec{DecayCounter(rate), DecayCounter(rate), DecayCounter(rate), DecayCounter(rate), DecayCounter(rate), DecayCounter(rate)}
   {}
 
   void encode(bufferlist &bl) const {
-    ENCODE_START(2, 2, bl);
+    ENCODE_START(3, 2, bl);
     for (const auto &i : vec) {
       encode(i, bl);
     }
     ENCODE_FINISH(bl);
   }
   void decode(bufferlist::const_iterator &p) {
-    DECODE_START_LEGACY_COMPAT_LEN(2, 2, 2, p);
-    for (auto &i : vec) {
-      decode(i, p);
+    DECODE_START_LEGACY_COMPAT_LEN(3, 2, 2, p);
+    for (size_t i = 0; i < META_POP_SVC; i++) {
+      decode(vec[i], p);
+    }
+    if (struct_v >= 3) {
+      decode(vec[META_POP_SVC], p);
+    } else {
+      vec[META_POP_SVC].reset();
     }
     DECODE_FINISH(p);
   }
@@ -1613,6 +1620,10 @@ public:
       2*vec[META_POP_FETCH].get() +
       4*vec[META_POP_STORE].get();
   }
+  // what mds_bal_mode 3 balances: the time spent serving the requests
+  double svc_load() const {
+    return vec[META_POP_SVC].get();
+  }
 
   void add(dirfrag_load_vec_t& r) {
     for (size_t i=0; i<dirfrag_load_vec_t::NUM; i++)
@@ -1649,6 +1660,7 @@ inline std::ostream& operator<<(std::ostream& out, const dirfrag_load_vec_t& dl)
      << " RDR:" << dl.vec[2]
      << " FET:" << dl.vec[3]
      << " STR:" << dl.vec[4]
+     << " SVC:" << dl.vec[5]
      << " *LOAD:" << dl.meta_load() << "]";
   return out << ss.str() << std::endl;
 }
@@ -62,8 +62,22 @@ public:
     }
   }
 
+  size_t payload_size_hint() const {
+    // the transaction's data and ops are appended by reference, so
+    // this is its indexes (mostly op.soid) and the rest of the message
+    size_t r = 256 + 2 * op.soid.encoded_size() + sizeof(pg_stat_t);
+    for (auto& e : op.log_entries)
+      r += 128 + e.soid.encoded_size();
+    for (auto& o : op.temp_added)
+      r += o.encoded_size();
+    for (auto& o : op.temp_removed)
+      r += o.encoded_size();
+    return r;
+  }
+
   void encode_payload(uint64_t features) override {
     using ceph::encode;
+    reserve_payload(payload_size_hint());
     encode(pgid, payload);
     encode(map_epoch, payload);
     encode(op, payload);
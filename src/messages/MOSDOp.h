@@ -246,12 +246,21 @@ public:
   }
 
   // marshalling
+  size_t payload_size_hint() const {
+    // the fixed size fields, with room for the trace and the
+    // struct headers, then the variable ones
+    return 192 + hobj.oid.name.length() + hobj.get_key().length() +
+      hobj.nspace.length() + ops.size() * sizeof(ceph_osd_op) +
+      snaps.size() * sizeof(snapid_t);
+  }
+
   void encode_payload(uint64_t features) override {
     using ceph::encode;
     if( false == bdata_encode ) {
       OSDOp::merge_osd_op_vector_in_data(ops, data);
       bdata_encode = true;
     }
+    reserve_payload(payload_size_hint());
 
     if ((features & CEPH_FEATURE_OBJECTLOCATOR) == 0) {
       // here is the old structure we are encoding to: //
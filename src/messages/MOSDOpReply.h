@@ -156,12 +156,20 @@ private:
   ~MOSDOpReply() override {}
 
 public:
+  size_t payload_size_hint() const {
+    // the fixed size fields, with room for the trace, then the
+    // variable ones; a redirect is rare, so it may spill over
+    return 128 + oid.name.length() +
+      ops.size() * (sizeof(ceph_osd_op) + sizeof(int32_t));
+  }
+
   void encode_payload(uint64_t features) override {
     using ceph::encode;
     if(false == bdata_encode) {
       OSDOp::merge_osd_op_vector_out_data(ops, data);
       bdata_encode = true;
     }
+    reserve_payload(payload_size_hint());
 
     if ((features & CEPH_FEATURE_PGID64) == 0) {
       header.version = 1;
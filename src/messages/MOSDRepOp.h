@@ -114,8 +114,16 @@ public:
     final_decode_needed = false;
   }
 
+  size_t payload_size_hint() const {
+    // logbl is appended by reference; pg_stat_t encodes to about its
+    // in-memory size
+    return 160 + poid.encoded_size() + new_temp_oid.encoded_size() +
+      discard_temp_oid.encoded_size() + sizeof(pg_stat_t);
+  }
+
   void encode_payload(uint64_t features) override {
     using ceph::encode;
+    reserve_payload(payload_size_hint());
     encode(map_epoch, payload);
     if (HAVE_FEATURE(features, SERVER_LUMINOUS)) {
       header.version = HEAD_VERSION;
@@ -0,0 +1,94 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MOSDREPOPBATCH_H
+#define CEPH_MOSDREPOPBATCH_H
+
+#include "msg/Message.h"
+
+/*
+ * Several MOSDRepOps for the same peer osd, in send order.  The inner
+ * messages are carried without their own crcs; the batch's cover them.
+ * The receiver decodes them back into MOSDRepOps (see
+ * OSD::handle_fast_repop_batch) and dispatches them one by one.
+ */
+class MOSDRepOpBatch : public Message {
+private:
+  static constexpr int HEAD_VERSION = 1;
+  static constexpr int COMPAT_VERSION = 1;
+
+public:
+  struct item_t {
+    ceph_msg_header header;
+    bufferlist front, middle, data;
+  };
+
+  std::vector<Message*> ops;   ///< sender: messages to encode
+  std::vector<item_t> items;   ///< receiver: undecoded messages
+
+  MOSDRepOpBatch()
+    : Message{MSG_OSD_REPOP_BATCH, HEAD_VERSION, COMPAT_VERSION} {}
+  explicit MOSDRepOpBatch(std::vector<Message*>&& o)
+    : Message{MSG_OSD_REPOP_BATCH, HEAD_VERSION, COMPAT_VERSION},
+      ops(std::move(o)) {}
+private:
+  ~MOSDRepOpBatch() override {
+    for (auto m : ops) {
+      m->put();
+    }
+  }
+
+public:
+  void encode_payload(uint64_t features) override {
+    using ceph::encode;
+    // we may be re-encoded after a reconnect
+    data.clear();
+    encode((uint32_t)ops.size(), payload);
+    for (auto m : ops) {
+      m->encode(features, 0);
+      encode(m->get_header(), payload);
+      encode(m->get_payload(), payload);
+      encode(m->get_middle(), payload);
+      bufferlist d = m->get_data();
+      encode((uint32_t)d.length(), payload);
+      data.claim_append(d);
+    }
+  }
+  void decode_payload() override {
+    using ceph::decode;
+    auto p = payload.cbegin();
+    auto q = data.cbegin();
+    uint32_t n;
+    decode(n, p);
+    items.resize(n);
+    for (auto& i : items) {
+      decode(i.header, p);
+      decode(i.front, p);
+      decode(i.middle, p);
+      uint32_t len;
+      decode(len, p);
+      q.copy(len, i.data);
+    }
+  }
+
+  std::string_view get_type_name() const override { return "osd_repop_batch"; }
+  void print(ostream& out) const override {
+    out << "osd_repop_batch(" << std::max(ops.size(), items.size())
+	<< " ops)";
+  }
+
+private:
+  template<class T, typename... Args>
+  friend boost::intrusive_ptr<T> ceph::make_message(Args&&... args);
+};
+
+#endif
@@ -13,6 +13,8 @@
 
 // Include this first to get python headers earlier
 #include "Gil.h"
+#include "Python.h"
+#include <marshal.h>
 
 #include "common/errno.h"
 #include "include/stringify.h"
@@ -164,6 +166,63 @@ PyObject *ActivePyModules::get_daemon_status_python(
   return f.get();
 }
 
+std::shared_ptr<const std::string> ActivePyModules::get_snapshot(
+  const std::string &what, version_t version, bool *store)
+{
+  std::lock_guard l(snapshot_lock);
+  auto& s = snapshots[what];
+  if (s.version == version) {
+    // asked for again: keep it this time, unless already tried
+    *store = !s.marshalled;
+    s.marshalled = true;
+    return s.data;
+  }
+  // a new version; remember it, but marshal it only if asked for again
+  if (s.data) {
+    snapshot_bytes -= s.data->size();
+  }
+  s.version = version;
+  s.marshalled = false;
+  s.data.reset();
+  *store = false;
+  return nullptr;
+}
+
+void ActivePyModules::put_snapshot(const std::string &what, version_t version,
+				   PyObject *obj)
+{
+  // GIL must be held
+  PyObject *marshalled = PyMarshal_WriteObjectToString(obj, Py_MARSHAL_VERSION);
+  if (marshalled == nullptr) {
+    PyErr_Clear();
+    return;
+  }
+  char *data = nullptr;
+  Py_ssize_t len = 0;
+  if (PyBytes_AsStringAndSize(marshalled, &data, &len) == 0) {
+    const uint64_t max_bytes =
+      g_conf().get_val<Option::size_t>("mgr_py_snapshot_max_bytes");
+    std::lock_guard l(snapshot_lock);
+    auto i = snapshots.find(what);
+    if (i != snapshots.end() && i->second.version == version &&
+	!i->second.data && snapshot_bytes + len <= max_bytes) {
+      i->second.data = std::make_shared<const std::string>(data, len);
+      snapshot_bytes += len;
+    }
+  } else {
+    PyErr_Clear();
+  }
+  Py_DECREF(marshalled);
+}
+
+PyObject *ActivePyModules::load_snapshot(const std::string &data)
+{
+  // GIL must be held; unmarshalling builds new objects, so the modules
+  // are free to modify what they get as before
+  return PyMarshal_ReadObjectFromString(const_cast<char*>(data.data()),
+					data.size());
+}
+
 PyObject *ActivePyModules::get_python(const std::string &what)
 {
   PyFormatter f;
@@ -187,9 +246,18 @@ PyObject *ActivePyModules::get_python(const std::string &what)
     });
     std::string crush_text = rdata.to_str();
     return PyString_FromString(crush_text.c_str());
-  } else if (what.substr(0, 7) == "osd_map") {
-    cluster_state.with_osdmap([&f, &what, &tstate](const OSDMap &osd_map){
+  } else if (what == "osd_map" || what == "osd_map_tree" ||
+	     what == "osd_map_crush") {
+    std::shared_ptr<const std::string> snapshot;
+    version_t version = 0;
+    bool store = false;
+    cluster_state.with_osdmap([&](const OSDMap &osd_map){
+      version = osd_map.get_epoch();
+      snapshot = get_snapshot(what, version, &store);
       PyEval_RestoreThread(tstate);
+      if (snapshot) {
+        return;
+      }
       if (what == "osd_map") {
         osd_map.dump(&f);
       } else if (what == "osd_map_tree") {
@@ -198,7 +266,14 @@ PyObject *ActivePyModules::get_python(const std::string &what)
         osd_map.crush->dump(&f);
       }
     });
-    return f.get();
+    if (snapshot) {
+      return load_snapshot(*snapshot);
+    }
+    PyObject *obj = f.get();
+    if (store) {
+      put_snapshot(what, version, obj);
+    }
+    return obj;
   } else if (what.substr(0, 6) == "config") {
     PyEval_RestoreThread(tstate);
     if (what == "config_options") {
@@ -292,14 +367,33 @@ PyObject *ActivePyModules::get_python(const std::string &what)
         }
     );
     return f.get();
-  } else if (what == "pg_dump") {
+  } else if (what == "pg_dump" || what == "osd_stats") {
+    std::shared_ptr<const std::string> snapshot;
+    version_t version = 0;
+    bool store = false;
     cluster_state.with_pgmap(
-      [&f, &tstate](const PGMap &pg_map) {
+      [&](const PGMap &pg_map) {
+        version = pg_map.get_version();
+        snapshot = get_snapshot(what, version, &store);
         PyEval_RestoreThread(tstate);
-	pg_map.dump(&f);
+        if (snapshot) {
+          return;
+        }
+        if (what == "pg_dump") {
+          pg_map.dump(&f);
+        } else {
+          pg_map.dump_osd_stats(&f);
+        }
       }
     );
-    return f.get();
+    if (snapshot) {
+      return load_snapshot(*snapshot);
+    }
+    PyObject *obj = f.get();
+    if (store) {
+      put_snapshot(what, version, obj);
+    }
+    return obj;
   } else if (what == "devices") {
     daemon_state.with_devices2(
       [&tstate, &f]() {
@@ -337,13 +431,6 @@ PyObject *ActivePyModules::get_python(const std::string &what)
         pg_map.dump_pool_stats_full(osd_map, nullptr, &f, true);
       });
     return f.get();
-  } else if (what == "osd_stats") {
-    cluster_state.with_pgmap(
-        [&f, &tstate](const PGMap &pg_map) {
-      PyEval_RestoreThread(tstate);
-      pg_map.dump_osd_stats(&f);
-    });
-    return f.get();
   } else if (what == "osd_pool_stats") {
     int64_t poolid = -ENOENT;
     string pool_name;
@@ -801,6 +888,70 @@ PyObject* ActivePyModules::get_perf_schema_python(
   return f.get();
 }
 
+PyObject* ActivePyModules::get_perf_counters_python(
+    int64_t prio_limit,
+    const std::set<std::string> &svc_types)
+{
+  PyThreadState *tstate = PyEval_SaveThread();
+  std::lock_guard l(lock);
+  auto daemons = daemon_state.get_all();
+  PyEval_RestoreThread(tstate);
+
+  // The schema and latest value of every counter of the daemons in one
+  // go, rather than a call per daemon and counter
+  PyFormatter f;
+  for (const auto &statepair : daemons) {
+    const auto &key = statepair.first;
+    const auto &state = statepair.second;
+    if (svc_types.count(key.first) == 0) {
+      continue;
+    }
+
+    std::ostringstream daemon_name;
+    daemon_name << key.first << "." << key.second;
+    bool opened = false;
+
+    std::lock_guard l(state->lock);
+    for (const auto &ctr_inst_iter : state->perf_counters.instances) {
+      const auto &counter_name = ctr_inst_iter.first;
+      const auto &counter_instance = ctr_inst_iter.second;
+      auto type_iter = state->perf_counters.types.find(counter_name);
+      if (type_iter == state->perf_counters.types.end()) {
+        continue;
+      }
+      const auto &type = type_iter->second;
+      if (type.priority < prio_limit) {
+        continue;
+      }
+      if (!opened) {
+        f.open_object_section(daemon_name.str().c_str());
+        opened = true;
+      }
+      f.open_object_section(counter_name.c_str());
+      f.dump_string("description", type.description);
+      if (!type.nick.empty()) {
+        f.dump_string("nick", type.nick);
+      }
+      f.dump_unsigned("type", type.type);
+      f.dump_unsigned("priority", type.priority);
+      f.dump_unsigned("units", type.unit);
+      if (type.type & PERFCOUNTER_LONGRUNAVG) {
+        const auto &avg_data = counter_instance.get_data_avg();
+        f.dump_unsigned("value", avg_data.empty() ? 0 : avg_data.back().s);
+        f.dump_unsigned("count", avg_data.empty() ? 0 : avg_data.back().c);
+      } else {
+        const auto &data = counter_instance.get_data();
+        f.dump_unsigned("value", data.empty() ? 0 : data.back().v);
+      }
+      f.close_section();
+    }
+    if (opened) {
+      f.close_section();
+    }
+  }
+  return f.get();
+}
+
 PyObject *ActivePyModules::get_context()
 {
   PyThreadState *tstate = PyEval_SaveThread();
@@ -57,6 +57,28 @@ private:
 
   mutable Mutex lock{"ActivePyModules::lock"};
 
+  // The marshalled results of the larger dumps handed to the modules, by
+  // name, with the map version they were made from.  A version is only
+  // marshalled once it is asked for a second time, and no more than
+  // mgr_py_snapshot_max_bytes are kept.
+  struct snapshot_t {
+    version_t version = 0;
+    bool marshalled = false;  ///< data was (or is being) made for version
+    std::shared_ptr<const std::string> data;
+  };
+  Mutex snapshot_lock{"ActivePyModules::snapshot_lock"};
+  std::map<std::string, snapshot_t> snapshots;
+  uint64_t snapshot_bytes = 0;
+
+  /// the snapshot of @what at @version, or null; *store is set if
+  /// the caller should put_snapshot() what it builds instead
+  std::shared_ptr<const std::string> get_snapshot(const std::string &what,
+						  version_t version,
+						  bool *store);
+  void put_snapshot(const std::string &what, version_t version,
+		    PyObject *obj);
+  static PyObject *load_snapshot(const std::string &data);
+
 public:
   ActivePyModules(PyModuleConfig &module_config,
             std::map<std::string, std::string> store_data,
@@ -88,6 +110,9 @@ public:
   PyObject *get_perf_schema_python(
      const std::string &svc_type,
      const std::string &svc_id);
+  PyObject *get_perf_counters_python(
+     int64_t prio_limit,
+     const std::set<std::string> &svc_types);
   PyObject *get_context();
   PyObject *get_osdmap();
   PyObject *with_perf_counters(
@@ -608,6 +608,35 @@ get_perf_schema(BaseMgrModule *self, PyObject *args)
   return self->py_modules->get_perf_schema_python(type_str, svc_id);
 }
 
+static PyObject*
+get_perf_counters(BaseMgrModule *self, PyObject *args)
+{
+  long long prio_limit = 0;
+  PyObject *svc_types_list = nullptr;
+  if (!PyArg_ParseTuple(args, "LO:get_perf_counters", &prio_limit,
+                                                      &svc_types_list)) {
+    return nullptr;
+  }
+  PyObject *seq = PySequence_Fast(svc_types_list,
+                                  "svc_types must be a sequence");
+  if (seq == nullptr) {
+    return nullptr;
+  }
+  std::set<std::string> svc_types;
+  for (Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE(seq); ++i) {
+    PyObject *item = PySequence_Fast_GET_ITEM(seq, i);
+    if (!PyString_Check(item)) {
+      Py_DECREF(seq);
+      PyErr_SetString(PyExc_TypeError, "svc_types must be strings");
+      return nullptr;
+    }
+    svc_types.insert(PyString_AsString(item));
+  }
+  Py_DECREF(seq);
+
+  return self->py_modules->get_perf_counters_python(prio_limit, svc_types);
+}
+
 static PyObject *
 ceph_get_osdmap(BaseMgrModule *self, PyObject *args)
 {
@@ -1050,6 +1079,9 @@ PyMethodDef BaseMgrModule_methods[] = {
   {"_ceph_get_perf_schema", (PyCFunction)get_perf_schema, METH_VARARGS,
     "Get the performance counter schema"},
 
+  {"_ceph_get_perf_counters", (PyCFunction)get_perf_counters, METH_VARARGS,
+    "Get the schema and latest value of the daemons' performance counters"},
+
   {"_ceph_log", (PyCFunction)ceph_log, METH_VARARGS,
    "Emit a (local) log message"},
 
@@ -2752,6 +2752,7 @@ void DaemonServer::_send_configure(ConnectionRef c)
   auto configure = make_message<MMgrConfigure>();
   configure->stats_period = g_conf().get_val<int64_t>("mgr_stats_period");
   configure->stats_threshold = g_conf().get_val<int64_t>("mgr_stats_threshold");
+  configure->delta_reports = true;
 
   if (c->peer_is_osd()) {
     configure->osd_perf_metric_queries =
@@ -289,7 +289,15 @@ void DaemonPerfCounters::update(const MMgrReport& report)
 
   // Parse packed data according to declared set of types
   auto p = report.packed.cbegin();
-  DECODE_START(1, p);
+  DECODE_START(2, p);
+  // From v2 only the counters at these indexes of the declared set are
+  // sent; the others kept their last value
+  std::vector<uint32_t> changed;
+  if (struct_v >= 2) {
+    decode(changed, p);
+  }
+  auto next_changed = changed.cbegin();
+  uint32_t idx = 0;
   for (const auto &t_path : session->declared_types) {
     const auto &t = types.at(t_path);
     auto instances_it = instances.find(t_path);
@@ -299,6 +307,16 @@ void DaemonPerfCounters::update(const MMgrReport& report)
     if (instances_it == instances.end()) {
       instances_it = instances.insert({t_path, t.type}).first;
     }
+    if (struct_v >= 2) {
+      const bool is_changed = (next_changed != changed.cend() &&
+                               *next_changed == idx);
+      ++idx;
+      if (!is_changed) {
+        instances_it->second.push_unchanged(now);
+        continue;
+      }
+      ++next_changed;
+    }
     uint64_t val = 0;
     uint64_t avgcount = 0;
     uint64_t avgcount2 = 0;
@@ -320,6 +338,19 @@ void PerfCounterInstance::push(utime_t t, uint64_t const &v)
   buffer.push_back({t, v});
 }
 
+void PerfCounterInstance::push_unchanged(utime_t t)
+{
+  // only the buffer for the counter's type has room
+  if (!avg_buffer.empty()) {
+    const auto last = avg_buffer.back();
+    avg_buffer.push_back({t, last.s, last.c});
+  }
+  if (!buffer.empty()) {
+    const auto v = buffer.back().v;
+    buffer.push_back({t, v});
+  }
+}
+
 void PerfCounterInstance::push_avg(utime_t t, uint64_t const &s,
                                    uint64_t const &c)
 {
@@ -88,6 +88,8 @@ class PerfCounterInstance
   }
   void push(utime_t t, uint64_t const &v);
   void push_avg(utime_t t, uint64_t const &s, uint64_t const &c);
+  /// repeat the latest value, for a report that left the counter out
+  void push_unchanged(utime_t t);
 
   PerfCounterInstance(enum perfcounter_type_d type)
   {
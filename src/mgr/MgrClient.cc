@@ -120,6 +120,7 @@ void MgrClient::reconnect()
     session->con->mark_down();
     session.reset();
     stats_period = 0;
+    delta_reports = false;
     if (report_callback != nullptr) {
       timer.cancel_event(report_callback);
       report_callback = nullptr;
@@ -277,9 +278,15 @@ void MgrClient::_send_report()
       report->undeclare_types.push_back(path);
       ldout(cct,20) << " undeclare " << path << dendl;
       session->declared.erase(path);
+      session->sent.erase(path);
     };
 
-    ENCODE_START(1, 1, report->packed);
+    // With delta reports, only the values of the counters that changed
+    // since the last report are sent, after the indexes of those
+    // counters among the declared ones
+    std::vector<uint32_t> changed;
+    bufferlist values;
+    uint32_t idx = 0;
 
     // Find counters that no longer exist, and undeclare them
     for (auto p = session->declared.begin(); p != session->declared.end(); ) {
@@ -320,16 +327,42 @@ void MgrClient::_send_report()
 	session->declared.insert(path);
       }
 
-      encode(static_cast<uint64_t>(data.u64), report->packed);
+      std::array<uint64_t, 3> value = {data.read_u64(), 0, 0};
       if (data.type & PERFCOUNTER_LONGRUNAVG) {
-        encode(static_cast<uint64_t>(data.avgcount), report->packed);
-        encode(static_cast<uint64_t>(data.avgcount2), report->packed);
+        auto a = data.read_avg();
+        value[0] = a.first;
+        value[1] = a.second;
+        value[2] = a.second;
+      }
+      auto [sent, inserted] = session->sent.emplace(path, value);
+      if (delta_reports && !inserted && sent->second == value) {
+        ++idx;
+        continue;
+      }
+      sent->second = value;
+      changed.push_back(idx++);
+
+      encode(value[0], values);
+      if (data.type & PERFCOUNTER_LONGRUNAVG) {
+        encode(value[1], values);
+        encode(value[2], values);
       }
     }
-    ENCODE_FINISH(report->packed);
+
+    if (delta_reports) {
+      ENCODE_START(2, 2, report->packed);
+      encode(changed, report->packed);
+      report->packed.claim_append(values);
+      ENCODE_FINISH(report->packed);
+    } else {
+      ENCODE_START(1, 1, report->packed);
+      report->packed.claim_append(values);
+      ENCODE_FINISH(report->packed);
+    }
 
     ldout(cct, 20) << "sending " << session->declared.size() << " counters ("
                       "of possible " << by_path.size() << "), "
+		   << changed.size() << " changed, "
 		   << report->declare_types.size() << " new, "
                    << report->undeclare_types.size() << " removed"
                    << dendl;
@@ -392,6 +425,8 @@ bool MgrClient::handle_mgr_configure(ref_t<MMgrConfigure> m)
     stats_threshold = m->stats_threshold;
   }
 
+  delta_reports = m->delta_reports;
+
   if (set_perf_queries_cb) {
     set_perf_queries_cb(m->osd_perf_metric_queries);
   }
@@ -14,6 +14,8 @@
 #ifndef MGR_CLIENT_H_
 #define MGR_CLIENT_H_
 
+#include <array>
+
 #include "msg/Connection.h"
 #include "msg/Dispatcher.h"
 #include "mon/MgrMap.h"
@@ -39,6 +41,9 @@ class MgrSessionState
   // Which performance counters have we already transmitted schema for?
   std::set<std::string> declared;
 
+  // The values last transmitted for them, to send only what changed
+  std::map<std::string, std::array<uint64_t, 3>> sent;
+
   // Our connection to the mgr
   ConnectionRef con;
 };
@@ -65,6 +70,8 @@ protected:
 
   uint32_t stats_period = 0;
   uint32_t stats_threshold = 0;
+  // May send only the counters that changed since the last report
+  bool delta_reports = false;
   SafeTimer timer;
 
   CommandTable<MgrCommand> command_table;
@@ -75,7 +75,12 @@ static PyObject *osdmap_apply_incremental(BasePyOSDMap *self,
   }
 
   bufferlist bl;
-  self->osdmap->encode(bl, CEPH_FEATURES_ALL|CEPH_FEATURE_RESERVED);
+  if (self->osdmap->encode(bl, CEPH_FEATURES_ALL|CEPH_FEATURE_RESERVED) < 0) {
+    derr << __func__ << " cannot encode client-only map "
+         << self->osdmap << dendl;
+    PyErr_SetString(PyExc_RuntimeError, "cannot encode a client-only OSDMap");
+    return nullptr;
+  }
   OSDMap *next = new OSDMap;
   next->decode(bl);
   next->apply_incremental(*(incobj->inc));
@@ -166,16 +171,16 @@ static PyObject *osdmap_map_pool_pgs_up(BasePyOSDMap* self, PyObject *args)
   auto pi = self->osdmap->get_pg_pool(poolid);
   if (!pi)
     return nullptr;
-  map<pg_t,vector<int>> pm;
-  for (unsigned ps = 0; ps < pi->get_pg_num(); ++ps) {
-    pg_t pgid(ps, poolid);
-    self->osdmap->pg_to_up_acting_osds(pgid, &pm[pgid], nullptr, nullptr, nullptr);
-  }
+  vector<vector<int>> up, acting;
+  vector<int> up_primary, acting_primary;
+  self->osdmap->pg_range_to_up_acting_osds(
+    poolid, 0, pi->get_pg_num(),
+    &up, &up_primary, &acting, &acting_primary);
   PyFormatter f;
-  for (auto p : pm) {
-    string pg = stringify(p.first);
+  for (unsigned ps = 0; ps < up.size(); ++ps) {
+    string pg = stringify(pg_t(ps, poolid));
     f.open_array_section(pg.c_str());
-    for (auto o : p.second) {
+    for (auto o : up[ps]) {
       f.dump_int("osd", o);
     }
     f.close_section();
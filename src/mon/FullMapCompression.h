@@ -0,0 +1,74 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include <string>
+
+#include "compressor/Compressor.h"
+#include "include/buffer.h"
+#include "include/encoding.h"
+
+// The full OSDMaps the OSDMonitor stores compressed start with this, the
+// compressor in use and the raw length. No OSDMap encoding starts with it:
+// the modern ones start with their struct_v, the classic ones with a small
+// version.
+static constexpr uint8_t FULL_MAP_COMPRESSED = 0xff;
+
+/// compress a full map for the store with the given compressor, if that
+/// makes it smaller. -ENOENT if the compressor can't be loaded.
+inline int compress_full_map(CephContext *cct, const std::string& type,
+			     ceph::buffer::list& bl)
+{
+  auto alg = Compressor::get_comp_alg_type(type);
+  CompressorRef compressor;
+  if (alg) {
+    compressor = Compressor::create(cct, *alg);
+  }
+  if (!compressor) {
+    return -ENOENT;
+  }
+  ceph::buffer::list compressed;
+  if (compressor->compress(bl, compressed) < 0 ||
+      compressed.length() >= bl.length()) {
+    return 0;
+  }
+  ceph::buffer::list out;
+  using ceph::encode;
+  encode(FULL_MAP_COMPRESSED, out);
+  encode((uint8_t)*alg, out);
+  encode((uint32_t)bl.length(), out);
+  out.claim_append(compressed);
+  bl.swap(out);
+  return 0;
+}
+
+/// undo compress_full_map(), if it compressed the map
+inline int decompress_full_map(CephContext *cct, ceph::buffer::list& bl)
+{
+  if (bl.length() == 0 || (uint8_t)bl[0] != FULL_MAP_COMPRESSED) {
+    return 0;
+  }
+  uint8_t marker, alg;
+  uint32_t len;
+  auto p = bl.cbegin();
+  try {
+    using ceph::decode;
+    decode(marker, p);
+    decode(alg, p);
+    decode(len, p);
+  } catch (const ceph::buffer::error&) {
+    return -EIO;
+  }
+  CompressorRef compressor = Compressor::create(cct, alg);
+  if (!compressor) {
+    return -ENOENT;
+  }
+  ceph::buffer::list out;
+  int r = compressor->decompress(p, p.get_remaining(), out);
+  if (r < 0 || out.length() != len) {
+    return -EIO;
+  }
+  bl.swap(out);
+  return 0;
+}
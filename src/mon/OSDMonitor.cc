@@ -23,6 +23,7 @@
 #include <sstream>
 
 #include "mon/OSDMonitor.h"
+#include "mon/FullMapCompression.h"
 #include "mon/Monitor.h"
 #include "mon/MDSMonitor.h"
 #include "mon/MgrStatMonitor.h"
@@ -68,6 +69,7 @@
 
 #include "erasure-code/ErasureCodePlugin.h"
 #include "compressor/Compressor.h"
+#include "common/CDC.h"
 #include "common/Checksummer.h"
 
 #include "include/compat.h"
@@ -393,6 +395,9 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
   dout(15) << "update_from_paxos paxos e " << version
 	   << ", my e " << osdmap.epoch << dendl;
 
+  // the mapping is brought forward below, so no job may still be
+  // writing to it; abort() waits for the shards in flight, and a job
+  // that is done has run _finish() under its lock
   if (mapping_job) {
     if (!mapping_job->is_done()) {
       dout(1) << __func__ << " mapping job "
@@ -499,15 +504,18 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     if (!f)
       f = -1;
     bufferlist full_bl;
-    osdmap.encode(full_bl, f | CEPH_FEATURE_RESERVED);
+    int r = osdmap.encode(full_bl, f | CEPH_FEATURE_RESERVED);
+    ceph_assert(r == 0);
     tx_size += full_bl.length();
 
+    bool canonical_reset = false;
     bufferlist orig_full_bl;
     get_version_full(osdmap.epoch, orig_full_bl);
     if (orig_full_bl.length()) {
       // the primary provided the full map
       ceph_assert(inc.have_crc);
       if (inc.full_crc != osdmap.crc) {
+	canonical_reset = true;
 	// This will happen if the mons were running mixed versions in
 	// the past or some other circumstance made the full encoded
 	// maps divergent.  Reloading here will bring us back into
@@ -538,10 +546,24 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
       }
     } else {
       ceph_assert(!inc.have_crc);
+      compress_full_map(full_bl);
       put_version_full(t, osdmap.epoch, full_bl);
     }
     put_version_latest_full(t, osdmap.epoch);
 
+    // most epochs only mark a few osds down or adjust pg_temp/upmaps;
+    // bring the mapping forward for those without recomputing every pg.
+    // the finish event of the last job, C_UpdateCreatingPGs, may still be
+    // reading the mapping from the mapper's thread, under creating_pgs_lock
+    if (!canonical_reset) {
+      std::lock_guard<std::mutex> l(creating_pgs_lock);
+      if (mapping.update(osdmap, inc,
+			 g_conf()->mon_osd_mapping_pgs_per_chunk)) {
+	dout(10) << __func__ << " updated mapping incrementally to e"
+		 << osdmap.epoch << dendl;
+      }
+    }
+
     // share
     dout(1) << osdmap << dendl;
 
@@ -614,7 +636,13 @@ void OSDMonitor::start_mapping()
 	     << dendl;
     mapping_job->abort();
   }
-  if (!osdmap.get_pools().empty()) {
+  if (!osdmap.get_pools().empty() &&
+      mapping.get_epoch() == osdmap.get_epoch()) {
+    dout(10) << __func__ << " mapping is current, no mapping job" << dendl;
+    mapping_job = nullptr;
+    update_creating_pgs();
+    check_pg_creates_subs();
+  } else if (!osdmap.get_pools().empty()) {
     auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
     mapping_job = mapping.start_update(osdmap, mapper,
 				       g_conf()->mon_osd_mapping_pgs_per_chunk);
@@ -1142,6 +1170,12 @@ void OSDMonitor::encode_pending(MonitorDBStore::TransactionRef t)
 	maybe_prime_pg_temp();
       }
     } 
+  } else if (mapping.get_epoch() == osdmap.get_epoch() &&
+	     !osdmap.get_pools().empty()) {
+    // the mapping was brought forward incrementally
+    if (g_conf()->mon_osd_prime_pg_temp) {
+      maybe_prime_pg_temp();
+    }
   } else if (g_conf()->mon_osd_prime_pg_temp) {
     dout(1) << __func__ << " skipping prime_pg_temp; mapping job did not start"
 	    << dendl;
@@ -1556,6 +1590,7 @@ void OSDMonitor::encode_pending(MonitorDBStore::TransactionRef t)
     // include full map in the txn.  note that old monitors will
     // overwrite this.  new ones will now skip the local full map
     // encode and reload from this.
+    compress_full_map(fullbl);
     put_version_full(t, pending_inc.epoch, fullbl);
   }
 
@@ -1827,6 +1862,7 @@ void OSDMonitor::encode_trim_extra(MonitorDBStore::TransactionRef tx,
   dout(10) << __func__ << " including full map for e " << first << dendl;
   bufferlist bl;
   get_version_full(first, bl);
+  compress_full_map(bl);
   put_version_full(tx, first, bl);
 
   if (has_osdmap_manifest &&
@@ -2316,7 +2352,19 @@ bool OSDMonitor::should_propose(double& delay)
     return true;
   }
 
-  return PaxosService::should_propose(delay);
+  bool r = PaxosService::should_propose(delay);
+
+  // don't let a storm of failures or boots pile up for the whole interval
+  const auto max_changes =
+    g_conf().get_val<uint64_t>("mon_osd_propose_pending_changes");
+  const auto changes = pending_inc.new_state.size() +
+    pending_inc.new_up_client.size() + pending_inc.new_weight.size();
+  if (r && max_changes && changes >= max_changes) {
+    dout(10) << " " << changes << " pending osd changes, proposing now"
+	     << dendl;
+    delay = 0.0;
+  }
+  return r;
 }
 
 
@@ -3828,6 +3876,40 @@ MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to, uint64_t featur
   return m;
 }
 
+MOSDMap *OSDMonitor::build_incremental(epoch_t from, epoch_t to,
+				       uint64_t features,
+				       shared_incrementals_t *shared)
+{
+  if (!shared) {
+    return build_incremental(from, to, features);
+  }
+  // encode the maps once, and hand out copies sharing that payload, whose
+  // crc the buffers then cache as well
+  auto key = std::make_tuple(from, to,
+			     OSDMap::get_significant_features(features));
+  auto i = shared->find(key);
+  if (i == shared->end()) {
+    MOSDMap *m = build_incremental(from, to, features);
+    m->encode_payload(features);
+    i = shared->emplace(key, MessageRef{m, false}).first;
+  } else {
+    dout(20) << __func__ << " [" << from << ".." << to << "] already encoded"
+	     << dendl;
+  }
+  auto orig = static_cast<const MOSDMap*>(i->second.get());
+  MOSDMap *m = new MOSDMap(orig->fsid, features);
+  m->oldest_map = orig->oldest_map;
+  m->newest_map = orig->newest_map;
+  m->incremental_maps = orig->incremental_maps;
+  m->maps = orig->maps;
+  bufferlist payload = orig->get_payload();
+  m->set_payload(payload);
+  // encode_payload() may have picked an older encoding for the features
+  m->get_header().version = orig->get_header().version;
+  m->get_header().compat_version = orig->get_header().compat_version;
+  return m;
+}
+
 void OSDMonitor::send_full(MonOpRequestRef op)
 {
   op->mark_osdmon_event(__func__);
@@ -3859,7 +3941,8 @@ void OSDMonitor::send_incremental(MonOpRequestRef op, epoch_t first)
 void OSDMonitor::send_incremental(epoch_t first,
 				  MonSession *session,
 				  bool onetime,
-				  MonOpRequestRef req)
+				  MonOpRequestRef req,
+				  shared_incrementals_t *shared)
 {
   dout(5) << "send_incremental [" << first << ".." << osdmap.get_epoch() << "]"
 	  << " to " << session->name << dendl;
@@ -3906,7 +3989,7 @@ void OSDMonitor::send_incremental(epoch_t first,
   while (first <= osdmap.get_epoch()) {
     epoch_t last = std::min<epoch_t>(first + g_conf()->osd_map_message_max - 1,
 				     osdmap.get_epoch());
-    MOSDMap *m = build_incremental(first, last, features);
+    MOSDMap *m = build_incremental(first, last, features, shared);
 
     if (req) {
       // send some maps.  it may not be all of them, but it will get them
@@ -3987,7 +4070,42 @@ void OSDMonitor::reencode_full_map(bufferlist& bl, uint64_t features)
   dout(20) << __func__ << " " << m.get_epoch() << " with features " << f
 	   << dendl;
   bl.clear();
-  m.encode(bl, f | CEPH_FEATURE_RESERVED);
+  int r = m.encode(bl, f | CEPH_FEATURE_RESERVED);
+  ceph_assert(r == 0);
+}
+
+void OSDMonitor::compress_full_map(bufferlist& bl)
+{
+  const auto& type = g_conf().get_val<std::string>(
+    "mon_osd_full_map_compression");
+  if (type.empty() || type == "none") {
+    return;
+  }
+  // every mon that may read the store has to be able to decompress it
+  if (!mon->get_required_mon_features().contains_all(
+	ceph::features::mon::FEATURE_OSDMAP_COMPRESSION)) {
+    dout(10) << __func__ << " not all mons support compressed full maps"
+	     << dendl;
+    return;
+  }
+  const auto len = bl.length();
+  if (::compress_full_map(g_ceph_context, type, bl) < 0) {
+    dout(1) << __func__ << " unable to load compressor " << type << dendl;
+    return;
+  }
+  dout(20) << __func__ << " " << len << " -> " << bl.length()
+	   << " bytes" << dendl;
+}
+
+int OSDMonitor::decompress_full_map(bufferlist& bl)
+{
+  int r = ::decompress_full_map(g_ceph_context, bl);
+  if (r < 0) {
+    derr << __func__ << " failed to decompress full map: "
+	 << cpp_strerror(r) << dendl;
+    return -EIO;
+  }
+  return 0;
 }
 
 int OSDMonitor::get_version(version_t ver, uint64_t features, bufferlist& bl)
@@ -4059,6 +4177,9 @@ int OSDMonitor::get_full_from_pinned_map(version_t ver, bufferlist& bl)
 
   if (!has_cached_osdmap) {
     int err = PaxosService::get_version_full(closest_pinned, osdm_bl);
+    if (err == 0) {
+      err = decompress_full_map(osdm_bl);
+    }
     if (err != 0) {
       derr << __func__ << " closest pinned map ver " << closest_pinned
            << " not available! error: " << cpp_strerror(err) << dendl;
@@ -4100,7 +4221,8 @@ int OSDMonitor::get_full_from_pinned_map(version_t ver, bufferlist& bl)
 
       // encode osdmap to force calculating crcs
       bufferlist tbl;
-      osdm.encode(tbl, f | CEPH_FEATURE_RESERVED);
+      err = osdm.encode(tbl, f | CEPH_FEATURE_RESERVED);
+      ceph_assert(err == 0);
       // decode osdmap to compare crcs with what's expected by incremental
       OSDMap tosdm;
       tosdm.decode(tbl);
@@ -4124,9 +4246,7 @@ int OSDMonitor::get_full_from_pinned_map(version_t ver, bufferlist& bl)
     encode_features =
       (mon->quorum_con_features ? mon->quorum_con_features : -1);
   }
-  osdm.encode(bl, encode_features | CEPH_FEATURE_RESERVED);
-
-  return 0;
+  return osdm.encode(bl, encode_features | CEPH_FEATURE_RESERVED);
 }
 
 int OSDMonitor::get_version_full(version_t ver, bufferlist& bl)
@@ -4142,7 +4262,9 @@ int OSDMonitor::get_version_full(version_t ver, uint64_t features,
     return 0;
   }
   int ret = PaxosService::get_version_full(ver, bl);
-  if (ret == -ENOENT) {
+  if (ret == 0) {
+    ret = decompress_full_map(bl);
+  } else if (ret == -ENOENT) {
     // build map?
     ret = get_full_from_pinned_map(ver, bl);
   }
@@ -4198,21 +4320,26 @@ void OSDMonitor::check_osdmap_subs()
   if (osdmap_subs == mon->session_map.subs.end()) {
     return;
   }
+  // most subscribers are just one epoch behind, and share the encoding of
+  // the maps they are sent
+  shared_incrementals_t shared;
   auto p = osdmap_subs->second->begin();
   while (!p.end()) {
     auto sub = *p;
     ++p;
-    check_osdmap_sub(sub);
+    check_osdmap_sub(sub, &shared);
   }
 }
 
-void OSDMonitor::check_osdmap_sub(Subscription *sub)
+void OSDMonitor::check_osdmap_sub(Subscription *sub,
+				  shared_incrementals_t *shared)
 {
   dout(10) << __func__ << " " << sub << " next " << sub->next
 	   << (sub->onetime ? " (onetime)":" (ongoing)") << dendl;
   if (sub->next <= osdmap.get_epoch()) {
     if (sub->next >= 1)
-      send_incremental(sub->next, sub->session, sub->incremental_onetime);
+      send_incremental(sub->next, sub->session, sub->incremental_onetime,
+		       MonOpRequestRef(), shared);
     else
       sub->session->con->send_message(build_latest_full(sub->session->con_features));
     if (sub->onetime)
@@ -4694,7 +4821,8 @@ namespace {
     COMPRESSION_MAX_BLOB_SIZE, COMPRESSION_MIN_BLOB_SIZE,
     CSUM_TYPE, CSUM_MAX_BLOCK, CSUM_MIN_BLOCK, FINGERPRINT_ALGORITHM,
     PG_AUTOSCALE_MODE, PG_NUM_MIN, TARGET_SIZE_BYTES, TARGET_SIZE_RATIO,
-    PG_AUTOSCALE_BIAS };
+    PG_AUTOSCALE_BIAS, ALLOC_UNIT, DEDUP_CHUNK_ALGORITHM,
+    DEDUP_CDC_CHUNK_SIZE };
 
   std::set<osd_pool_get_choices>
     subtract_second_from_first(const std::set<osd_pool_get_choices>& first,
@@ -5395,6 +5523,9 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
       {"target_size_bytes", TARGET_SIZE_BYTES},
       {"target_size_ratio", TARGET_SIZE_RATIO},
       {"pg_autoscale_bias", PG_AUTOSCALE_BIAS},
+      {"alloc_unit", ALLOC_UNIT},
+      {"dedup_chunk_algorithm", DEDUP_CHUNK_ALGORITHM},
+      {"dedup_cdc_chunk_size", DEDUP_CDC_CHUNK_SIZE},
     };
 
     typedef std::set<osd_pool_get_choices> choices_set_t;
@@ -5611,6 +5742,9 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	  case TARGET_SIZE_BYTES:
 	  case TARGET_SIZE_RATIO:
 	  case PG_AUTOSCALE_BIAS:
+	  case ALLOC_UNIT:
+	  case DEDUP_CHUNK_ALGORITHM:
+	  case DEDUP_CDC_CHUNK_SIZE:
             pool_opts_t::key_t key = pool_opts_t::get_opt_desc(i->first).key;
             if (p->opts.is_set(key)) {
               if(*it == CSUM_TYPE) {
@@ -5768,6 +5902,9 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	  case TARGET_SIZE_BYTES:
 	  case TARGET_SIZE_RATIO:
 	  case PG_AUTOSCALE_BIAS:
+	  case ALLOC_UNIT:
+	  case DEDUP_CHUNK_ALGORITHM:
+	  case DEDUP_CDC_CHUNK_SIZE:
 	    for (i = ALL_CHOICES.begin(); i != ALL_CHOICES.end(); ++i) {
 	      if (i->second == *it)
 		break;
@@ -7738,6 +7875,33 @@ int OSDMonitor::prepare_command_pool_set(const cmdmap_t& cmdmap,
         ss << "error parsing int value '" << val << "': " << interr;
         return -EINVAL;
       }
+    } else if (var == "alloc_unit") {
+      if (interr.length()) {
+        ss << "error parsing int value '" << val << "': " << interr;
+        return -EINVAL;
+      }
+      if (n < 0 || (n & (n - 1))) {
+        ss << "alloc_unit must be a power of 2: '" << val << "'";
+        return -EINVAL;
+      }
+    } else if (var == "dedup_chunk_algorithm") {
+      if (!unset && !CDC::create(val, CDC::MIN_BITS)) {
+        ss << "unrecognized dedup_chunk_algorithm '" << val << "'";
+        return -EINVAL;
+      }
+    } else if (var == "dedup_cdc_chunk_size") {
+      if (interr.length()) {
+        ss << "error parsing int value '" << val << "': " << interr;
+        return -EINVAL;
+      }
+      if (n != 0 &&
+	  (n < (1ll << CDC::MIN_BITS) || n > (1ll << CDC::MAX_BITS) ||
+	   (n & (n - 1)))) {
+        ss << "dedup_cdc_chunk_size must be a power of 2 between "
+	   << (1ll << CDC::MIN_BITS) << " and " << (1ll << CDC::MAX_BITS)
+	   << ": '" << val << "'";
+        return -EINVAL;
+      }
     } else if (var == "fingerprint_algorithm") {
       if (!unset) {
         auto alg = pg_pool_t::get_fingerprint_from_str(val);
@@ -13255,7 +13419,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap mappings for this pool
-  for (auto& p : osdmap.pg_upmap) {
+  for (auto& p : *osdmap.pg_upmap) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap "
@@ -13278,7 +13442,7 @@ int OSDMonitor::_prepare_remove_pool(
     }
   }
   // remove any pg_upmap_items mappings for this pool
-  for (auto& p : osdmap.pg_upmap_items) {
+  for (auto& p : *osdmap.pg_upmap_items) {
     if (p.first.pool() == pool) {
       dout(10) << __func__ << " " << pool
                << " removing obsolete pg_upmap_items " << p.first
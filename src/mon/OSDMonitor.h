@@ -350,11 +350,20 @@ private:
   MOSDMap *build_incremental(epoch_t first, epoch_t last, uint64_t features);
   void send_full(MonOpRequestRef op);
   void send_incremental(MonOpRequestRef op, epoch_t first);
+
+  /// encoded MOSDMaps by first and last epoch and significant features,
+  /// for the subscribers that are sent the same maps
+  typedef std::map<std::tuple<epoch_t, epoch_t, uint64_t>, MessageRef>
+    shared_incrementals_t;
+  MOSDMap *build_incremental(epoch_t first, epoch_t last, uint64_t features,
+			     shared_incrementals_t *shared);
 public:
   // @param req an optional op request, if the osdmaps are replies to it. so
   //            @c Monitor::send_reply() can mark_event with it.
+  // @param shared optional encoded maps to reuse, and add to
   void send_incremental(epoch_t first, MonSession *session, bool onetime,
-			MonOpRequestRef req = MonOpRequestRef());
+			MonOpRequestRef req = MonOpRequestRef(),
+			shared_incrementals_t *shared = nullptr);
 
 private:
   void print_utilization(ostream &out, Formatter *f, bool tree) const;
@@ -551,6 +560,8 @@ private:
 
   void reencode_incremental_map(bufferlist& bl, uint64_t features);
   void reencode_full_map(bufferlist& bl, uint64_t features);
+  void compress_full_map(bufferlist& bl);
+  int decompress_full_map(bufferlist& bl);
 public:
   void count_metadata(const string& field, map<string,int> *out);
 protected:
@@ -680,7 +691,8 @@ public:
   int dump_osd_metadata(int osd, Formatter *f, ostream *err);
   void print_nodes(Formatter *f);
 
-  void check_osdmap_sub(Subscription *sub);
+  void check_osdmap_sub(Subscription *sub,
+			shared_incrementals_t *shared = nullptr);
   void check_pg_creates_sub(Subscription *sub);
 
   void do_application_enable(int64_t pool_id, const std::string &app_name,
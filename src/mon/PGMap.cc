@@ -1118,14 +1118,27 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
 
     auto pg_stat_iter = pg_stat.find(update_pg);
     pool_stat_t &pool_sum_ref = pg_pool_sum[update_pool];
+    // most updates leave the mapping alone, and then the per-osd
+    // aggregates needn't be touched
+    bool sameosds = false;
     if (pg_stat_iter == pg_stat.end()) {
       pg_stat.insert(make_pair(update_pg, update_stat));
+      purged_snaps_dirty.insert(update_pool);
     } else {
-      stat_pg_sub(update_pg, pg_stat_iter->second);
-      pool_sum_ref.sub(pg_stat_iter->second);
+      const pg_stat_t &old_stat = pg_stat_iter->second;
+      sameosds = (old_stat.acting == update_stat.acting &&
+		  old_stat.up == update_stat.up &&
+		  old_stat.up_primary == update_stat.up_primary &&
+		  old_stat.blocked_by == update_stat.blocked_by);
+      if ((old_stat.state == 0) != (update_stat.state == 0) ||
+	  !(old_stat.purged_snaps == update_stat.purged_snaps)) {
+	purged_snaps_dirty.insert(update_pool);
+      }
+      stat_pg_sub(update_pg, old_stat, sameosds);
+      pool_sum_ref.sub(old_stat);
       pg_stat_iter->second = update_stat;
     }
-    stat_pg_add(update_pg, update_stat);
+    stat_pg_add(update_pg, update_stat, sameosds);
     pool_sum_ref.add(update_stat);
   }
 
@@ -1173,6 +1186,7 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
     if (s != pg_stat.end()) {
       pool_erased = stat_pg_sub(removed_pg, s->second);
       pg_stat.erase(s);
+      purged_snaps_dirty.insert(removed_pg.pool());
       if (pool_erased) {
         deleted_pools.insert(removed_pg.pool());
       }
@@ -1187,10 +1201,12 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
       stat_osd_sub(t->first, t->second);
       osd_stat.erase(t);
     }
-    for (auto i = pool_statfs.begin();  i != pool_statfs.end(); ++i) {
+    for (auto i = pool_statfs.begin();  i != pool_statfs.end();) {
       if (i->first.second == *p) {
 	pg_pool_sum[i->first.first].sub(i->second);
-	pool_statfs.erase(i);
+	i = pool_statfs.erase(i);
+      } else {
+	++i;
       }
     }
   }
@@ -1232,6 +1248,8 @@ void PGMap::apply_incremental(CephContext *cct, const Incremental& inc)
 
 void PGMap::calc_stats()
 {
+  purged_snaps_valid = false;
+  purged_snaps_dirty.clear();
   num_pg = 0;
   num_pg_active = 0;
   num_pg_unknown = 0;
@@ -1402,9 +1420,23 @@ bool PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s,
 
 void PGMap::calc_purged_snaps()
 {
-  purged_snaps.clear();
+  // only the pools with a pg whose purged_snaps may have changed since the
+  // last time are recomputed
+  if (purged_snaps_valid && purged_snaps_dirty.empty()) {
+    return;
+  }
+  if (purged_snaps_valid) {
+    for (auto pool : purged_snaps_dirty) {
+      purged_snaps.erase(pool);
+    }
+  } else {
+    purged_snaps.clear();
+  }
   set<int64_t> unknown;
   for (auto& i : pg_stat) {
+    if (purged_snaps_valid && !purged_snaps_dirty.count(i.first.pool())) {
+      continue;
+    }
     if (i.second.state == 0) {
       unknown.insert(i.first.pool());
       purged_snaps.erase(i.first.pool());
@@ -1420,6 +1452,8 @@ void PGMap::calc_purged_snaps()
       j->second.intersection_of(i.second.purged_snaps);
     }
   }
+  purged_snaps_dirty.clear();
+  purged_snaps_valid = true;
 }
 
 void PGMap::calc_osd_sum_by_class(const OSDMap& osdmap)
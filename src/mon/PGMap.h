@@ -299,6 +299,11 @@ public:
 
   utime_t stamp;
 
+  // pools whose purged_snaps calc_purged_snaps() has to recompute, unless
+  // it has to go over all of them anyway
+  mempool::pgmap::set<int64_t> purged_snaps_dirty;
+  bool purged_snaps_valid = false;
+
   void update_pool_deltas(
     CephContext *cct,
     const utime_t ts,
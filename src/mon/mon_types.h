@@ -496,6 +496,7 @@ namespace ceph {
       constexpr mon_feature_t FEATURE_OSDMAP_PRUNE (1ULL << 3);
       constexpr mon_feature_t FEATURE_NAUTILUS(    (1ULL << 4));
       constexpr mon_feature_t FEATURE_OCTOPUS(    (1ULL << 5));
+      constexpr mon_feature_t FEATURE_OSDMAP_COMPRESSION (1ULL << 6);
 
       constexpr mon_feature_t FEATURE_RESERVED(   (1ULL << 63));
       constexpr mon_feature_t FEATURE_NONE(       (0ULL));
@@ -513,6 +514,7 @@ namespace ceph {
           FEATURE_OSDMAP_PRUNE |
 	  FEATURE_NAUTILUS |
 	  FEATURE_OCTOPUS |
+	  FEATURE_OSDMAP_COMPRESSION |
 	  FEATURE_NONE
 	  );
       }
@@ -534,6 +536,7 @@ namespace ceph {
 	  FEATURE_NAUTILUS |
 	  FEATURE_OSDMAP_PRUNE |
 	  FEATURE_OCTOPUS |
+	  FEATURE_OSDMAP_COMPRESSION |
 	  FEATURE_NONE
 	  );
       }
@@ -541,6 +544,7 @@ namespace ceph {
       constexpr mon_feature_t get_optional() {
         return (
           FEATURE_OSDMAP_PRUNE |
+          FEATURE_OSDMAP_COMPRESSION |
           FEATURE_NONE
           );
       }
@@ -585,6 +589,8 @@ static inline const char *ceph::features::mon::get_feature_name(uint64_t b) {
     return "nautilus";
   } else if (f == FEATURE_OCTOPUS) {
     return "octopus";
+  } else if (f == FEATURE_OSDMAP_COMPRESSION) {
+    return "osdmap-compression";
   } else if (f == FEATURE_RESERVED) {
     return "reserved";
   }
@@ -605,6 +611,8 @@ inline mon_feature_t ceph::features::mon::get_feature_by_name(const std::string
     return FEATURE_NAUTILUS;
   } else if (n == "octopus") {
     return FEATURE_OCTOPUS;
+  } else if (n == "osdmap-compression") {
+    return FEATURE_OSDMAP_COMPRESSION;
   } else if (n == "reserved") {
     return FEATURE_RESERVED;
   }
@@ -128,6 +128,7 @@
 #define MSG_OSD_SCRUB2          121
 
 #define MSG_OSD_PG_READY_TO_MERGE 122
+#define MSG_OSD_REPOP_BATCH     123
 
 // *** MDS ***
 
@@ -297,6 +298,14 @@ protected:
 
   friend class Messenger;
 
+  /// set aside one buffer for a payload of about len bytes, for
+  /// encode_payload() to fill, rather than have it grow a chain of
+  /// page sized append buffers
+  void reserve_payload(size_t len) {
+    if (payload.length() == 0 && len)
+      payload.reserve(len);
+  }
+
 public:
   Message() {
     memset(&header, 0, sizeof(header));
@@ -382,6 +391,22 @@ public:
     msg_throttler = nullptr;
   }
 
+  /**
+   * Charge a message carried inside this one to our throttlers, so that
+   * it holds them until it is destroyed, as if it came in on its own.
+   */
+  void share_message_throttle(Message *m) {
+    if (byte_throttler) {
+      byte_throttler->take(m->payload.length() + m->middle.length() +
+			   m->data.length());
+      m->byte_throttler = byte_throttler;
+    }
+    if (msg_throttler) {
+      msg_throttler->take();
+      m->msg_throttler = msg_throttler;
+    }
+  }
+
   bool empty_payload() const { return payload.length() == 0; }
   ceph::buffer::list& get_payload() { return payload; }
   const ceph::buffer::list& get_payload() const { return payload; }
@@ -28,7 +28,8 @@ Messenger *Messenger::create(CephContext *cct, const string &type,
     //r = ceph::util::generate_random_number(0, 1);
   }
   if (r == 0 || type.find("async") != std::string::npos)
-    return new AsyncMessenger(cct, name, type, std::move(lname), nonce);
+    return new AsyncMessenger(cct, name, type, std::move(lname), nonce,
+			      cflags);
   lderr(cct) << "unrecognized ms_type '" << type << "'" << dendl;
   return nullptr;
 }
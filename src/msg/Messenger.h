@@ -46,6 +46,7 @@ class Timer;
 
 class AuthClient;
 class AuthServer;
+namespace PriorityCache { struct PriCache; }
 
 #ifdef UNIT_TESTS_BUILT
 
@@ -273,6 +274,14 @@ public:
    */
   virtual double get_dispatch_queue_max_age(utime_t now) = 0;
 
+  /**
+   * Get the memory this Messenger keeps for reuse, as a cache that a
+   * memory autotuner may size (nullptr if it keeps none).
+   */
+  virtual std::shared_ptr<PriorityCache::PriCache> get_rx_buffer_cache() {
+    return nullptr;
+  }
+
   /**
    * @} // Accessors
    */
@@ -14,6 +14,7 @@
  *
  */
 
+#include <climits>
 #include <unistd.h>
 
 #include "include/Context.h"
@@ -351,6 +352,18 @@ ssize_t AsyncConnection::_try_send(bool more)
   return outcoming_bl.length();
 }
 
+/**
+ * While more messages are queued behind this one, leave a small batch
+ * in outcoming_bl: it goes out with the next ones in a single writev,
+ * and whatever is left is flushed once the queue is drained.
+ */
+bool AsyncConnection::_coalesce_send(bool more) const
+{
+  return more &&
+    outcoming_bl.length() < async_msgr->cct->_conf->ms_async_send_coalesce_bytes &&
+    outcoming_bl.get_num_buffers() < IOV_MAX / 2;
+}
+
 void AsyncConnection::inject_delay() {
   if (async_msgr->cct->_conf->ms_inject_internal_delays) {
     ldout(async_msgr->cct, 10) << __func__ << " sleep for " <<
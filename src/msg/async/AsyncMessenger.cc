@@ -249,9 +249,12 @@ struct StackSingleton {
   std::shared_ptr<NetworkStack> stack;
 
   explicit StackSingleton(CephContext *c): cct(c) {}
-  void ready(std::string &type) {
-    if (!stack)
-      stack = NetworkStack::create(cct, type);
+  void ready(std::string &type, unsigned num_workers = 0,
+             unsigned first_worker = 0, int nice = 0) {
+    if (!stack) {
+      stack = NetworkStack::create(cct, type, num_workers, first_worker);
+      stack->set_thread_nice(nice);
+    }
   }
   ~StackSingleton() {
     stack->stop();
@@ -275,7 +278,8 @@ class C_handle_reap : public EventCallback {
  */
 
 AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
-                               const std::string &type, string mname, uint64_t _nonce)
+                               const std::string &type, string mname, uint64_t _nonce,
+                               uint64_t cflags)
   : SimplePolicyMessenger(cct, name,mname, _nonce),
     dispatch_queue(cct, this, mname),
     lock("AsyncMessenger::lock"),
@@ -289,9 +293,26 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
   else if (type.find("dpdk") != std::string::npos)
     transport_type = "dpdk";
 
-  auto single = &cct->lookup_or_create_singleton_object<StackSingleton>(
-    "AsyncMessenger::NetworkStack::" + transport_type, true, cct);
-  single->ready(transport_type);
+  // the heartbeat messengers get workers of their own, numbered after the
+  // shared ones, so that pings aren't queued behind the client and
+  // replication traffic
+  const unsigned hb_workers =
+    cct->_conf.get_val<uint64_t>("ms_async_heartbeat_op_threads");
+  const unsigned first_hb_worker = cct->_conf->ms_async_op_threads;
+  StackSingleton *single;
+  if ((cflags & Messenger::HEARTBEAT) && transport_type == "posix" &&
+      hb_workers > 0 &&
+      first_hb_worker + hb_workers <= EventCenter::MAX_EVENTCENTER) {
+    single = &cct->lookup_or_create_singleton_object<StackSingleton>(
+      "AsyncMessenger::NetworkStack::" + transport_type + "::heartbeat",
+      true, cct);
+    single->ready(transport_type, hb_workers, first_hb_worker,
+                  cct->_conf.get_val<int64_t>("ms_async_heartbeat_nice"));
+  } else {
+    single = &cct->lookup_or_create_singleton_object<StackSingleton>(
+      "AsyncMessenger::NetworkStack::" + transport_type, true, cct);
+    single->ready(transport_type);
+  }
   stack = single->stack.get();
   stack->start();
   local_worker = stack->get_worker();
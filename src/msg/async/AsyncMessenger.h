@@ -81,9 +81,10 @@ public:
    * @param name The name to assign ourselves
    * _nonce A unique ID to use for this AsyncMessenger. It should not
    * be a value that will be repeated if the daemon restarts.
+   * @param cflags Messenger::HEARTBEAT gives it workers of its own
    */
   AsyncMessenger(CephContext *cct, entity_name_t name, const std::string &type,
-                 string mname, uint64_t _nonce);
+                 string mname, uint64_t _nonce, uint64_t cflags = 0);
 
   /**
    * Destroy the AsyncMessenger. Pretty simple since all the work is done
@@ -104,6 +105,10 @@ public:
   double get_dispatch_queue_max_age(utime_t now) override {
     return dispatch_queue.get_max_age(now);
   }
+
+  std::shared_ptr<PriorityCache::PriCache> get_rx_buffer_cache() override {
+    return stack->get_rx_buffer_cache();
+  }
   /** @} Accessors */
 
   /**
@@ -107,6 +107,7 @@ int EventCenter::init(int n, unsigned i, const std::string &t)
 
   type = t;
   idx = i;
+  busy_poll_us = cct->_conf->ms_async_busy_poll_us;
 
   if (t == "dpdk") {
 #ifdef HAVE_DPDK
@@ -284,19 +285,170 @@ void EventCenter::delete_file_event(int fd, int mask)
                  << " original mask is " << event->mask << dendl;
 }
 
+void EventCenter::time_list_push(uint32_t list, uint32_t i)
+{
+  TimeEvent &e = time_events[i];
+  e.list = list;
+  e.prev = TIME_NIL;
+  e.next = time_lists[list];
+  if (e.next != TIME_NIL)
+    time_events[e.next].prev = i;
+  time_lists[list] = i;
+  if (list < TIME_EXPIRED)
+    wheel_used[list / WHEEL_SLOTS][list % WHEEL_SLOTS / 64] |= 1ull << (list % 64);
+}
+
+void EventCenter::time_list_unlink(uint32_t i)
+{
+  TimeEvent &e = time_events[i];
+  if (e.prev != TIME_NIL)
+    time_events[e.prev].next = e.next;
+  else
+    time_lists[e.list] = e.next;
+  if (e.next != TIME_NIL)
+    time_events[e.next].prev = e.prev;
+  if (e.list < TIME_EXPIRED && time_lists[e.list] == TIME_NIL)
+    wheel_used[e.list / WHEEL_SLOTS][e.list % WHEEL_SLOTS / 64] &=
+      ~(1ull << (e.list % 64));
+}
+
+// put the timer on the level whose slots are the finest that still
+// reach its expiry
+void EventCenter::wheel_insert(uint32_t i)
+{
+  uint64_t expire = std::max(time_events[i].expire, wheel_now);
+  uint64_t delta = expire - wheel_now;
+  if (delta >> (WHEEL_BITS * WHEEL_LEVELS)) {
+    // beyond the top wheel: park in its furthest slot, to be placed
+    // again when that cascades
+    delta = (1ull << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    expire = wheel_now + delta;
+  }
+  unsigned level = 0;
+  while (level < WHEEL_LEVELS - 1 && delta >> (WHEEL_BITS * (level + 1)))
+    ++level;
+  unsigned slot = (expire >> (WHEEL_BITS * level)) & WHEEL_MASK;
+  time_list_push(level * WHEEL_SLOTS + slot, i);
+}
+
+// distance from slot 'from' (cyclically) to the first used slot of the
+// level, or -1
+int EventCenter::wheel_next_used(unsigned level, unsigned from) const
+{
+  const auto &used = wheel_used[level];
+  for (unsigned d = 0; d < WHEEL_SLOTS; ) {
+    unsigned slot = (from + d) & WHEEL_MASK;
+    uint64_t word = used[slot / 64] >> (slot % 64);
+    if (word) {
+      d += __builtin_ctzll(word);
+      return d < WHEEL_SLOTS ? d : -1;
+    }
+    d += 64 - slot % 64;
+  }
+  return -1;
+}
+
+// move every timer due by tick 'to' to the expired list
+void EventCenter::wheel_advance(uint64_t to)
+{
+  if (!num_time_events) {
+    wheel_now = std::max(wheel_now, to + 1);
+    return;
+  }
+  while (wheel_now <= to) {
+    if (!(wheel_now & WHEEL_MASK)) {
+      // entering a new round of level 0: bring down what the upper
+      // levels hold for it, the highest first
+      unsigned top = 1;
+      while (top < WHEEL_LEVELS - 1 &&
+	     !((wheel_now >> (WHEEL_BITS * top)) & WHEEL_MASK))
+	++top;
+      for (unsigned level = top; level > 0; --level) {
+	uint32_t list = level * WHEEL_SLOTS +
+	  ((wheel_now >> (WHEEL_BITS * level)) & WHEEL_MASK);
+	uint32_t i = time_lists[list];
+	time_lists[list] = TIME_NIL;
+	wheel_used[level][list % WHEEL_SLOTS / 64] &= ~(1ull << (list % 64));
+	while (i != TIME_NIL) {
+	  uint32_t next = time_events[i].next;
+	  wheel_insert(i);
+	  i = next;
+	}
+      }
+    }
+
+    uint32_t list = wheel_now & WHEEL_MASK;
+    uint32_t i = time_lists[list];
+    time_lists[list] = TIME_NIL;
+    wheel_used[0][list / 64] &= ~(1ull << (list % 64));
+    while (i != TIME_NIL) {
+      uint32_t next = time_events[i].next;
+      time_list_push(TIME_EXPIRED, i);
+      i = next;
+    }
+    ++wheel_now;
+
+    // skip the empty slots left in this round
+    if (wheel_now & WHEEL_MASK) {
+      int d = wheel_next_used(0, wheel_now & WHEEL_MASK);
+      uint64_t next = (wheel_now | WHEEL_MASK) + 1;
+      if (d >= 0 && (wheel_now & WHEEL_MASK) + d < WHEEL_SLOTS)
+	next = wheel_now + d;
+      wheel_now = std::min(next, to + 1);
+    }
+  }
+}
+
+// when the wheel next has something to do: fire a slot or cascade one
+bool EventCenter::next_time_event(clock_type::time_point *when) const
+{
+  if (!num_time_events)
+    return false;
+  uint64_t tick = UINT64_MAX;
+  for (unsigned level = 0; level < WHEEL_LEVELS; ++level) {
+    unsigned shift = WHEEL_BITS * level;
+    // the first round of this level that is still to come
+    uint64_t first = (wheel_now + (1ull << shift) - 1) >> shift;
+    int d = wheel_next_used(level, first & WHEEL_MASK);
+    if (d >= 0)
+      tick = std::min(tick, (first + d) << shift);
+  }
+  ceph_assert(tick != UINT64_MAX);
+  *when = wheel_base + tick * WHEEL_TICK;
+  return true;
+}
+
 uint64_t EventCenter::create_time_event(uint64_t microseconds, EventCallbackRef ctxt)
 {
   ceph_assert(in_thread());
-  uint64_t id = time_event_next_id++;
+  uint32_t i = time_lists[TIME_FREE];
+  if (i != TIME_NIL) {
+    time_list_unlink(i);
+  } else {
+    i = time_events.size();
+    ceph_assert(i < TIME_NIL);
+    time_events.emplace_back();
+  }
+  // the serial is 32 bits and wraps. skip 0, so that no id is 0, which
+  // delete_time_event() takes as no timer at all
+  uint32_t serial = time_event_next_id++;
+  if (!serial)
+    serial = time_event_next_id++;
+  uint64_t id = (uint64_t(serial) << 32) | i;
 
   ldout(cct, 30) << __func__ << " id=" << id << " trigger after " << microseconds << "us"<< dendl;
-  EventCenter::TimeEvent event;
-  clock_type::time_point expire = clock_type::now() + std::chrono::microseconds(microseconds);
+  auto now = clock_type::now();
+  clock_type::time_point expire = now + std::chrono::microseconds(microseconds);
+  if (!num_time_events)
+    wheel_now = std::max<uint64_t>(wheel_now, (now - wheel_base) / WHEEL_TICK);
+  TimeEvent &event = time_events[i];
   event.id = id;
   event.time_cb = ctxt;
-  std::multimap<clock_type::time_point, TimeEvent>::value_type s_val(expire, event);
-  auto it = time_events.insert(std::move(s_val));
-  event_map[id] = it;
+  // round up, so that it never fires early
+  event.expire = (expire - wheel_base + WHEEL_TICK - clock_type::duration(1)) /
+    WHEEL_TICK;
+  wheel_insert(i);
+  ++num_time_events;
 
   return id;
 }
@@ -305,17 +457,19 @@ void EventCenter::delete_time_event(uint64_t id)
 {
   ceph_assert(in_thread());
   ldout(cct, 30) << __func__ << " id=" << id << dendl;
-  if (id >= time_event_next_id || id == 0)
+  if (id == 0)
     return ;
 
-  auto it = event_map.find(id);
-  if (it == event_map.end()) {
+  uint32_t i = id & TIME_NIL;
+  if (i >= time_events.size() || time_events[i].id != id) {
     ldout(cct, 10) << __func__ << " id=" << id << " not found" << dendl;
     return ;
   }
 
-  time_events.erase(it->second);
-  event_map.erase(it);
+  time_list_unlink(i);
+  time_events[i] = TimeEvent();
+  time_list_push(TIME_FREE, i);
+  --num_time_events;
 }
 
 void EventCenter::wakeup()
@@ -342,37 +496,48 @@ int EventCenter::process_time_events()
   clock_type::time_point now = clock_type::now();
   ldout(cct, 30) << __func__ << " cur time is " << now << dendl;
 
-  while (!time_events.empty()) {
-    auto it = time_events.begin();
-    if (now >= it->first) {
-      TimeEvent &e = it->second;
-      EventCallbackRef cb = e.time_cb;
-      uint64_t id = e.id;
-      time_events.erase(it);
-      event_map.erase(id);
-      ldout(cct, 30) << __func__ << " process time event: id=" << id << dendl;
-      processed++;
-      cb->do_request(id);
-    } else {
-      break;
-    }
+  wheel_advance((now - wheel_base) / WHEEL_TICK);
+  while (time_lists[TIME_EXPIRED] != TIME_NIL) {
+    uint32_t i = time_lists[TIME_EXPIRED];
+    EventCallbackRef cb = time_events[i].time_cb;
+    uint64_t id = time_events[i].id;
+    time_list_unlink(i);
+    time_events[i] = TimeEvent();
+    time_list_push(TIME_FREE, i);
+    --num_time_events;
+    ldout(cct, 30) << __func__ << " process time event: id=" << id << dendl;
+    processed++;
+    cb->do_request(id);
   }
 
   return processed;
 }
 
-int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *working_dur)
+int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *working_dur,
+                                ceph::timespan *spin_dur)
 {
   struct timeval tv;
   int numevents;
   bool trigger_time = false;
   auto now = clock_type::now();
 
-  auto it = time_events.begin();
+  clock_type::time_point next_time;
+  bool have_time = next_time_event(&next_time);
   bool blocking = pollers.empty() && !external_num_events.load();
+  // Busy polling: for a while after the last event, keep looking for the
+  // next one rather than sleeping, to save the wakeup latency
+  bool spinning = false;
+  ceph::mono_clock::time_point spin_start;
+  if (blocking && busy_poll_us) {
+    spin_start = ceph::mono_clock::now();
+    if (spin_start - last_active < std::chrono::microseconds(busy_poll_us)) {
+      blocking = false;
+      spinning = true;
+    }
+  }
   // If exists external events or poller, don't block
   if (!blocking) {
-    if (it != time_events.end() && now >= it->first)
+    if (have_time && now >= next_time)
       trigger_time = true;
     tv.tv_sec = 0;
     tv.tv_usec = 0;
@@ -380,9 +545,9 @@ int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *
     clock_type::time_point shortest;
     shortest = now + std::chrono::microseconds(timeout_microseconds); 
 
-    if (it != time_events.end() && shortest >= it->first) {
-      ldout(cct, 30) << __func__ << " shortest is " << shortest << " it->first is " << it->first << dendl;
-      shortest = it->first;
+    if (have_time && shortest >= next_time) {
+      ldout(cct, 30) << __func__ << " shortest is " << shortest << " next_time is " << next_time << dendl;
+      shortest = next_time;
       trigger_time = true;
       if (shortest > now) {
         timeout_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
@@ -448,6 +613,14 @@ int EventCenter::process_events(unsigned timeout_microseconds,  ceph::timespan *
       numevents += pollers[i]->poll();
   }
 
+  if (spin_dur)
+    *spin_dur = ceph::timespan::zero();
+  if (busy_poll_us && numevents) {
+    last_active = ceph::mono_clock::now();
+  } else if (spinning && spin_dur) {
+    // a spin that found nothing was time taken from other threads
+    *spin_dur = ceph::mono_clock::now() - spin_start;
+  }
   if (working_dur)
     *working_dur = ceph::mono_clock::now() - working_start;
   return numevents;
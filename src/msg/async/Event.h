@@ -37,6 +37,7 @@
 #endif
 #endif
 
+#include <array>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
@@ -106,11 +107,13 @@ class EventCenter {
     FileEvent(): mask(0), read_cb(NULL), write_cb(NULL) {}
   };
 
+  /// a timer; lives in time_events, at the index in its id's low bits
   struct TimeEvent {
-    uint64_t id;
-    EventCallbackRef time_cb;
-
-    TimeEvent(): id(0), time_cb(NULL) {}
+    uint64_t id = 0;                  ///< 0 while the entry is free
+    EventCallbackRef time_cb = nullptr;
+    uint64_t expire = 0;              ///< in wheel ticks
+    uint32_t list = 0;                ///< wheel slot (or TIME_EXPIRED) it is on
+    uint32_t prev = UINT32_MAX, next = UINT32_MAX;  ///< TIME_NIL at the ends
   };
 
  public:
@@ -161,12 +164,35 @@ class EventCenter {
   deque<EventCallbackRef> external_events;
   vector<FileEvent> file_events;
   EventDriver *driver;
-  std::multimap<clock_type::time_point, TimeEvent> time_events;
+
+  // Timers live on a hierarchical timing wheel: WHEEL_LEVELS wheels of
+  // WHEEL_SLOTS slots, a slot of level L spanning WHEEL_SLOTS^L ticks.
+  // Each slot is a list threaded through time_events, whose free entries
+  // are recycled, so arming and cancelling are O(1) and don't allocate.
+  static constexpr unsigned WHEEL_BITS = 8;
+  static constexpr unsigned WHEEL_SLOTS = 1 << WHEEL_BITS;
+  static constexpr unsigned WHEEL_MASK = WHEEL_SLOTS - 1;
+  static constexpr unsigned WHEEL_LEVELS = 4;
+  static constexpr uint32_t TIME_NIL = UINT32_MAX;
+  static constexpr uint32_t TIME_EXPIRED = WHEEL_LEVELS * WHEEL_SLOTS;
+  static constexpr uint32_t TIME_FREE = TIME_EXPIRED + 1;
+  static constexpr auto WHEEL_TICK = std::chrono::milliseconds(1);
+
+  std::vector<TimeEvent> time_events;
+  /// list heads: the wheel slots, then the expired and free lists
+  std::array<uint32_t, TIME_FREE + 1> time_lists;
+  /// which slots of each level are non-empty
+  std::array<std::array<uint64_t, WHEEL_SLOTS / 64>, WHEEL_LEVELS> wheel_used = {};
+  clock_type::time_point wheel_base;
+  uint64_t wheel_now = 0;      ///< the next tick to process
+  unsigned num_time_events = 0;
+  /// keep polling without blocking for this long after the last event
+  unsigned busy_poll_us = 0;
+  ceph::mono_clock::time_point last_active;
   // Keeps track of all of the pollers currently defined.  We don't
   // use an intrusive list here because it isn't reentrant: we need
   // to add/remove elements while the center is traversing the list.
   std::vector<Poller*> pollers;
-  std::map<uint64_t, std::multimap<clock_type::time_point, TimeEvent>::iterator> event_map;
   uint64_t time_event_next_id;
   int notify_receive_fd;
   int notify_send_fd;
@@ -176,6 +202,12 @@ class EventCenter {
   AssociatedCenters *global_centers = nullptr;
 
   int process_time_events();
+  void time_list_push(uint32_t list, uint32_t i);
+  void time_list_unlink(uint32_t i);
+  void wheel_insert(uint32_t i);
+  void wheel_advance(uint64_t to);
+  int wheel_next_used(unsigned level, unsigned from) const;
+  bool next_time_event(clock_type::time_point *when) const;
   FileEvent *_get_file_event(int fd) {
     ceph_assert(fd < nevent);
     return &file_events[fd];
@@ -185,9 +217,11 @@ class EventCenter {
   explicit EventCenter(CephContext *c):
     cct(c), nevent(0),
     external_num_events(0),
-    driver(NULL), time_event_next_id(1),
+    driver(NULL), wheel_base(clock_type::now()), time_event_next_id(1),
     notify_receive_fd(-1), notify_send_fd(-1), net(c),
-    notify_handler(NULL), idx(0) { }
+    notify_handler(NULL), idx(0) {
+    time_lists.fill(TIME_NIL);
+  }
   ~EventCenter();
   ostream& _event_prefix(std::ostream *_dout);
 
@@ -203,7 +237,8 @@ class EventCenter {
   uint64_t create_time_event(uint64_t milliseconds, EventCallbackRef ctxt);
   void delete_file_event(int fd, int mask);
   void delete_time_event(uint64_t id);
-  int process_events(unsigned timeout_microseconds, ceph::timespan *working_dur = nullptr);
+  int process_events(unsigned timeout_microseconds, ceph::timespan *working_dur = nullptr,
+                     ceph::timespan *spin_dur = nullptr);
   void wakeup();
 
   // Used by external thread
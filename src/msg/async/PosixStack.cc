@@ -21,6 +21,12 @@
 #include <errno.h>
 
 #include <algorithm>
+#include <deque>
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define HAVE_MSG_ZEROCOPY
+#endif
 
 #include "PosixStack.h"
 
@@ -37,15 +43,155 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "PosixStack "
 
+// MSG_ZEROCOPY: a send of at least zerocopy_min bytes leaves the data
+// in our buffers, so hold on to them until the kernel reports (on the
+// socket's error queue) that it is done with every sendmsg involved.
+struct zerocopy_pin_t {
+  uint32_t first_id;   ///< id of the first sendmsg
+  uint32_t count;      ///< of this many
+  uint32_t pending;    ///< not yet completed
+  bufferlist bl;
+};
+
+// drain fd's error queue, unpinning what has completed.  *copied is
+// set if the kernel reports it copied the data after all.
+static void reap_zerocopy(int fd, std::deque<zerocopy_pin_t> &pinned,
+			  bool *copied)
+{
+#ifdef HAVE_MSG_ZEROCOPY
+  for (;;) {
+    char control[128];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+      break;  // nothing (more) completed
+    for (auto cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+	  !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+	continue;
+      auto ee = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+      if (ee->ee_errno != 0 || ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+	continue;
+      if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+	*copied = true;
+      // ids [lo, hi] are done; they may complete out of order, but each
+      // is reported once, so counting the overlap with every pin will do
+      int64_t n = uint32_t(ee->ee_data - ee->ee_info) + 1;
+      for (auto& pin : pinned) {
+	int64_t a = int32_t(pin.first_id - ee->ee_info);
+	int64_t overlap = std::min<int64_t>(a + pin.count, n) -
+	  std::max<int64_t>(a, 0);
+	if (overlap > 0)
+	  pin.pending -= overlap;
+      }
+      while (!pinned.empty() && !pinned.front().pending)
+	pinned.pop_front();
+    }
+  }
+#endif
+}
+
+// A socket closed with zerocopy sends in flight.  The kernel may still
+// be reading our buffers, and only the error queue of this very socket
+// tells when it stops, so the socket stays open (and the buffers pinned)
+// until every completion is in.  A peer that doesn't ack for
+// linger_us gets a reset, which drops whatever is still queued.
+class PosixZerocopyLinger final : public EventCallback {
+  static constexpr uint64_t linger_us = 30 * 1000 * 1000;
+
+  class C_expire : public EventCallback {
+    PosixZerocopyLinger *linger;
+   public:
+    explicit C_expire(PosixZerocopyLinger *l) : linger(l) {}
+    void do_request(uint64_t id) override {
+      linger->timer = 0;
+      linger->finish(true);
+    }
+  };
+
+  EventCenter *center;
+  int fd;
+  std::deque<zerocopy_pin_t> pinned;
+  bool armed = false;
+  C_expire expire_handler{this};
+  uint64_t timer = 0;
+
+  void finish(bool reset) {
+    if (reset) {
+      struct linger l = {1, 0};
+      ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+    }
+    center->delete_file_event(fd, EVENT_READABLE);
+    if (timer)
+      center->delete_time_event(timer);
+    ::close(fd);
+    delete this;
+  }
+
+ public:
+  PosixZerocopyLinger(EventCenter *c, int fd, std::deque<zerocopy_pin_t> &&p)
+    : center(c), fd(fd), pinned(std::move(p)) {}
+
+  // dispatched to the center's thread first, then woken by the
+  // completions (EPOLLERR) and by whatever else the peer sends; the
+  // timer has its own handler
+  void do_request(uint64_t fd_or_id) override {
+    if (!armed) {
+      if (!center->in_thread()) {
+	// the center is going away
+	::close(fd);
+	delete this;
+	return;
+      }
+      armed = true;
+      center->create_file_event(fd, EVENT_READABLE, this);
+      timer = center->create_time_event(linger_us, &expire_handler);
+    }
+    // nobody reads this socket any more, so throw away what arrives
+    char buf[4096];
+    while (::recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+      ;
+    bool copied = false;
+    reap_zerocopy(fd, pinned, &copied);
+    if (pinned.empty())
+      finish(false);
+  }
+};
+
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   NetHandler &handler;
   int _fd;
   entity_addr_t sa;
   bool connected;
 
+  EventCenter *center;
+  uint64_t zerocopy_min = 0;  ///< 0: off
+  uint32_t zerocopy_next_id = 0;
+  std::deque<zerocopy_pin_t> zerocopy_pinned;
+
+  void reap_zerocopy() {
+    bool copied = false;
+    ::reap_zerocopy(_fd, zerocopy_pinned, &copied);
+    if (copied) {
+      // the kernel had to copy anyway (e.g. loopback); stop paying for
+      // the notifications
+      zerocopy_min = 0;
+    }
+  }
+
  public:
-  explicit PosixConnectedSocketImpl(NetHandler &h, const entity_addr_t &sa, int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+  explicit PosixConnectedSocketImpl(NetHandler &h, const entity_addr_t &sa, int f, bool connected,
+				    EventCenter *c = nullptr, uint64_t zerocopy_min = 0)
+      : handler(h), _fd(f), sa(sa), connected(connected), center(c) {
+#ifdef HAVE_MSG_ZEROCOPY
+    int on = 1;
+    if (zerocopy_min && center &&
+	::setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0)
+      this->zerocopy_min = zerocopy_min;
+#endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -67,6 +213,9 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+    // completions raise EPOLLERR, which wakes the reader
+    if (!zerocopy_pinned.empty())
+      reap_zerocopy();
     ssize_t r = ::read(_fd, buf, len);
     if (r < 0)
       r = -errno;
@@ -75,21 +224,34 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 
   // return the sent length
   // < 0 means error occurred
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  // *zerocopy_sends counts the sendmsg calls made with MSG_ZEROCOPY
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    bool zerocopy = false, uint32_t *zerocopy_sends = nullptr)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+#ifdef HAVE_MSG_ZEROCOPY
+      if (zerocopy)
+	flags |= MSG_ZEROCOPY;
+#endif
+      r = ::sendmsg(fd, &msg, flags);
       if (r < 0) {
         if (errno == EINTR) {
           continue;
         } else if (errno == EAGAIN) {
           break;
-        }
+        } else if (errno == ENOBUFS && zerocopy) {
+	  // out of notification memory (optmem); copy this time
+	  zerocopy = false;
+	  continue;
+	}
         return -errno;
       }
+      if (zerocopy)
+	++*zerocopy_sends;
 
       sent += r;
       if (len == sent) break;
@@ -111,6 +273,11 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t send(bufferlist &bl, bool more) override {
+    if (!zerocopy_pinned.empty())
+      reap_zerocopy();
+    // small frames aren't worth the pinning and the notification
+    bool zerocopy = zerocopy_min && bl.length() >= zerocopy_min;
+    uint32_t zerocopy_sends = 0;
     size_t sent_bytes = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = std::size(bl.buffers());
@@ -129,7 +296,8 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 	msglen += pb->length();
 	++pb;
       }
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more,
+			     zerocopy, &zerocopy_sends);
       if (r < 0)
         return r;
 
@@ -140,7 +308,17 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
       // only "r" == 0 continue
     }
 
-    if (sent_bytes) {
+    if (zerocopy_sends) {
+      // the sent part stays pinned, the rest is left in bl
+      bufferlist rest;
+      if (sent_bytes < bl.length())
+        bl.splice(sent_bytes, bl.length()-sent_bytes, &rest);
+      zerocopy_pinned.push_back(
+	zerocopy_pin_t{zerocopy_next_id, zerocopy_sends, zerocopy_sends,
+		       std::move(bl)});
+      zerocopy_next_id += zerocopy_sends;
+      bl.swap(rest);
+    } else if (sent_bytes) {
       bufferlist swapped;
       if (sent_bytes < bl.length()) {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
@@ -156,6 +334,14 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     ::shutdown(_fd, SHUT_RDWR);
   }
   void close() override {
+    if (!zerocopy_pinned.empty())
+      reap_zerocopy();
+    if (!zerocopy_pinned.empty()) {
+      // hand the socket over, the buffers must outlive the sends
+      center->dispatch_event_external(
+	new PosixZerocopyLinger(center, _fd, std::move(zerocopy_pinned)));
+      return;
+    }
     ::close(_fd);
   }
   int fd() const override {
@@ -214,7 +400,9 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(
+      handler, *out, sd, true, &w->center,
+      w->cct->_conf->ms_tcp_zerocopy_min_size));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -283,11 +471,15 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(
+	net, addr, sd, !opts.nonblock, &center,
+	cct->_conf->ms_tcp_zerocopy_min_size)));
   return 0;
 }
 
-PosixNetworkStack::PosixNetworkStack(CephContext *c, const string &t)
-    : NetworkStack(c, t)
+PosixNetworkStack::PosixNetworkStack(CephContext *c, const string &t,
+                                     unsigned num_workers,
+                                     unsigned first_worker)
+    : NetworkStack(c, t, num_workers, first_worker)
 {
 }
@@ -353,6 +353,8 @@ void ProtocolV1::write_event() {
     // if r > 0 mean data still lefted, so no need _try_send.
     if (r == 0) {
       uint64_t left = ack_left;
+      // what write_message coalesced goes out with the ack, or on its own
+      uint64_t queued = 0;
       if (left) {
         ceph_le64 s;
         s = in_seq;
@@ -362,10 +364,15 @@ void ProtocolV1::write_event() {
                        << " messages" << dendl;
         ack_left -= left;
         left = ack_left;
+        queued = connection->outcoming_bl.length();
         r = connection->_try_send(left);
       } else if (is_queued()) {
+        queued = connection->outcoming_bl.length();
         r = connection->_try_send();
       }
+      if (r >= 0 && queued)
+        connection->logger->inc(
+	  l_msgr_send_bytes, queued - connection->outcoming_bl.length());
     }
 
     connection->logger->tinc(l_msgr_running_send_time,
@@ -1151,7 +1158,7 @@ ssize_t ProtocolV1::write_message(Message *m, bufferlist &bl, bool more) {
   ldout(cct, 20) << __func__ << " sending " << m->get_seq() << " " << m
                  << dendl;
   ssize_t total_send_size = connection->outcoming_bl.length();
-  ssize_t rc = connection->_try_send(more);
+  ssize_t rc = connection->_coalesce_send(more) ? 0 : connection->_try_send(more);
   if (rc < 0) {
     ldout(cct, 1) << __func__ << " error sending " << m << ", "
                   << cpp_strerror(rc) << dendl;
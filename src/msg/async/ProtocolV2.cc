@@ -519,7 +519,7 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
                  << " off=" << header2.data_off
                  << dendl;
   ssize_t total_send_size = connection->outcoming_bl.length();
-  ssize_t rc = connection->_try_send(more);
+  ssize_t rc = connection->_coalesce_send(more) ? 0 : connection->_try_send(more);
   if (rc < 0) {
     ldout(cct, 1) << __func__ << " error sending " << m << ", "
                   << cpp_strerror(rc) << dendl;
@@ -633,6 +633,8 @@ void ProtocolV2::write_event() {
     // if r > 0 mean data still lefted, so no need _try_send.
     if (r == 0) {
       uint64_t left = ack_left;
+      // what write_message coalesced goes out with the ack, or on its own
+      uint64_t queued = 0;
       if (left) {
         auto ack = AckFrame::Encode(in_seq);
         connection->outcoming_bl.append(ack.get_buffer(session_stream_handlers));
@@ -640,10 +642,15 @@ void ProtocolV2::write_event() {
                        << " messages" << dendl;
         ack_left -= left;
         left = ack_left;
+        queued = connection->outcoming_bl.length();
         r = connection->_try_send(left);
       } else if (is_queued()) {
+        queued = connection->outcoming_bl.length();
         r = connection->_try_send();
       }
+      if (r >= 0 && queued)
+        connection->logger->inc(
+	  l_msgr_send_bytes, queued - connection->outcoming_bl.length());
     }
     connection->write_lock.unlock();
 
@@ -1148,8 +1155,14 @@ CtPtr ProtocolV2::read_frame_segment() {
   const auto& cur_rx_desc = rx_segments_desc.at(rx_segments_data.size());
   rx_buffer_t rx_buffer;
   try {
-    rx_buffer = buffer::ptr_node::create(buffer::create_aligned(
-      get_onwire_size(cur_rx_desc.length), cur_rx_desc.alignment));
+    const auto onwire_len = get_onwire_size(cur_rx_desc.length);
+    if (auto raw = connection->worker->rx_buffer_pool->get(
+	  onwire_len, cur_rx_desc.alignment)) {
+      rx_buffer = buffer::ptr_node::create(raw);
+    } else {
+      rx_buffer = buffer::ptr_node::create(buffer::create_aligned(
+	onwire_len, cur_rx_desc.alignment));
+    }
   } catch (std::bad_alloc&) {
     // Catching because of potential issues with satisfying alignment.
     ldout(cct, 20) << __func__ << " can't allocate aligned rx_buffer "
@@ -1181,9 +1194,10 @@ CtPtr ProtocolV2::handle_read_frame_segment(rx_buffer_t &&rx_buffer, int r) {
 
     auto& new_seg = rx_segments_data.back();
     if (new_seg.length()) {
-      auto padded = session_stream_handlers.rx->authenticated_decrypt_update(
-          std::move(new_seg), segment_t::DEFAULT_ALIGNMENT);
+      // keep the alignment the sender asked for (page, for message data)
       const auto idx = rx_segments_data.size() - 1;
+      auto padded = session_stream_handlers.rx->authenticated_decrypt_update(
+          std::move(new_seg), rx_segments_desc[idx].alignment);
       new_seg.clear();
       padded.splice(0, rx_segments_desc[idx].length, &new_seg);
 
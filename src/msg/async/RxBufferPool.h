@@ -0,0 +1,250 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_MSG_ASYNC_RXBUFFERPOOL_H
+#define CEPH_MSG_ASYNC_RXBUFFERPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "include/buffer.h"
+#include "include/buffer_raw.h"
+#include "include/spinlock.h"
+#include "common/PriorityCache.h"
+#include "common/deleter.h"
+
+/**
+ * RxBufferPool - page aligned buffers for large message segments
+ *
+ * A large segment (typically write data) is read into one of these, so
+ * it is already aligned for O_DIRECT when it reaches the object store,
+ * and the memory is recycled rather than mapped and faulted in afresh
+ * for every message.  A buffer comes back when its last reference goes
+ * away, from whatever thread that happens on; the pool keeps at most
+ * max_bytes of them, by size.
+ *
+ * The free buffers of a size are linked through their own first bytes,
+ * and map nodes are made and freed outside the lock, so nothing is
+ * allocated or freed while holding it.
+ */
+class RxBufferPool : public std::enable_shared_from_this<RxBufferPool> {
+  static constexpr unsigned MIN_SIZE = 64 << 10;
+
+  /// size -> the first of the free buffers of that size
+  using free_map_t = std::map<size_t, char*>;
+
+  const size_t conf_max_bytes;
+  std::atomic<size_t> max_bytes;
+  ceph::spinlock lock;
+  free_map_t free_by_size;
+  size_t free_bytes = 0;
+
+  static size_t round_up(unsigned len) {
+    return (len + CEPH_PAGE_SIZE - 1) & CEPH_PAGE_MASK;
+  }
+  static char*& next_of(char *buf) {
+    return *reinterpret_cast<char**>(buf);
+  }
+
+  /// under lock: unlink buffers of other sizes than keep_size until at most
+  /// target bytes are free, onto *drop, and the emptied sizes onto *emptied
+  void _evict(size_t target, size_t keep_size, char **drop,
+	      free_map_t *emptied) {
+    auto p = free_by_size.begin();
+    while (free_bytes > target && p != free_by_size.end()) {
+      if (p->first == keep_size) {
+	++p;
+	continue;
+      }
+      while (p->second && free_bytes > target) {
+	char *b = p->second;
+	p->second = next_of(b);
+	next_of(b) = *drop;
+	*drop = b;
+	free_bytes -= p->first;
+      }
+      if (!p->second)
+	emptied->insert(free_by_size.extract(p++));
+    }
+  }
+
+  static void free_all(char *drop) {
+    while (drop) {
+      char *b = drop;
+      drop = next_of(b);
+      ::free(b);
+    }
+  }
+
+  void put(char *buf, size_t size) {
+    free_map_t spare, emptied;
+    spare.emplace(size, nullptr);
+    char *drop = nullptr;
+    {
+      std::lock_guard l(lock);
+      const size_t max = max_bytes;
+      if (size <= max) {
+	// make room by dropping buffers of other sizes, which the traffic
+	// may no longer use
+	_evict(max - size, size, &drop, &emptied);
+      }
+      if (free_bytes + size <= max) {
+	auto p = free_by_size.find(size);
+	if (p == free_by_size.end())
+	  p = free_by_size.insert(spare.extract(spare.begin())).position;
+	next_of(buf) = p->second;
+	p->second = buf;
+	free_bytes += size;
+	buf = nullptr;
+      }
+    }
+    free_all(drop);
+    ::free(buf);
+  }
+
+public:
+  explicit RxBufferPool(size_t max_bytes)
+    : conf_max_bytes(max_bytes), max_bytes(max_bytes) {}
+  ~RxBufferPool() {
+    for (auto& p : free_by_size)
+      free_all(p.second);
+  }
+
+  size_t get_conf_max_bytes() const {
+    return conf_max_bytes;
+  }
+  size_t get_free_bytes() {
+    std::lock_guard l(lock);
+    return free_bytes;
+  }
+  /// keep at most m bytes (and no more than configured) from now on
+  void set_max_bytes(size_t m) {
+    m = std::min(m, conf_max_bytes);
+    max_bytes = m;
+    free_map_t emptied;
+    char *drop = nullptr;
+    {
+      std::lock_guard l(lock);
+      _evict(m, 0, &drop, &emptied);
+    }
+    free_all(drop);
+  }
+
+  /// a buffer of len bytes aligned to align, or nullptr if the pool
+  /// doesn't serve this size
+  ceph::buffer::raw *get(unsigned len, unsigned align) {
+    if (!max_bytes || len < MIN_SIZE || align > CEPH_PAGE_SIZE)
+      return nullptr;
+    size_t size = round_up(len);
+    char *buf = nullptr;
+    free_map_t emptied;
+    {
+      std::lock_guard l(lock);
+      auto p = free_by_size.find(size);
+      if (p != free_by_size.end()) {
+	buf = p->second;
+	p->second = next_of(buf);
+	free_bytes -= size;
+	if (!p->second)
+	  emptied.insert(free_by_size.extract(p));
+      }
+    }
+    if (!buf) {
+      void *m = nullptr;
+      if (::posix_memalign(&m, CEPH_PAGE_SIZE, size))
+	return nullptr;
+      buf = static_cast<char*>(m);
+    }
+    return ceph::buffer::claim_buffer(
+      len, buf,
+      make_deleter([pool = shared_from_this(), buf, size] {
+	pool->put(buf, size);
+      }));
+  }
+};
+
+/**
+ * RxBufferCache - the rx buffer pools of a stack's workers, as one cache
+ * of a PriorityCache::Manager
+ *
+ * The pools ask for what they are configured to keep, at the top
+ * priority but with no ratio of their own, so they only get memory the
+ * ratioed caches there leave over.  What the manager commits is split
+ * evenly among the pools.
+ */
+class RxBufferCache : public PriorityCache::PriCache {
+  const std::vector<std::shared_ptr<RxBufferPool>> pools;
+  int64_t cache_bytes[PriorityCache::Priority::LAST+1] = {0};
+  int64_t committed_bytes = 0;
+  double cache_ratio = 0;
+
+public:
+  explicit RxBufferCache(std::vector<std::shared_ptr<RxBufferPool>> p)
+    : pools(std::move(p)) {}
+
+  int64_t request_cache_bytes(PriorityCache::Priority pri,
+			      uint64_t total_cache) const override {
+    if (pri != PriorityCache::Priority::PRI0) {
+      return 0;
+    }
+    int64_t request = 0;
+    for (auto& p : pools) {
+      request += p->get_conf_max_bytes();
+    }
+    int64_t assigned = get_cache_bytes(pri);
+    return request > assigned ? request - assigned : 0;
+  }
+  int64_t get_cache_bytes(PriorityCache::Priority pri) const override {
+    return cache_bytes[pri];
+  }
+  int64_t get_cache_bytes() const override {
+    int64_t total = 0;
+    for (int i = 0; i < PriorityCache::Priority::LAST + 1; i++) {
+      total += cache_bytes[i];
+    }
+    return total;
+  }
+  void set_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] = bytes;
+  }
+  void add_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] += bytes;
+  }
+  int64_t commit_cache_size(uint64_t total_cache) override {
+    committed_bytes = PriorityCache::get_chunk(get_cache_bytes(), total_cache);
+    if (!pools.empty()) {
+      const size_t per_pool = get_cache_bytes() / pools.size();
+      for (auto& p : pools) {
+	p->set_max_bytes(per_pool);
+      }
+    }
+    return committed_bytes;
+  }
+  int64_t get_committed_size() const override {
+    return committed_bytes;
+  }
+  double get_cache_ratio() const override {
+    return cache_ratio;
+  }
+  void set_cache_ratio(double ratio) override {
+    cache_ratio = ratio;
+  }
+  std::string get_cache_name() const override {
+    return "Messenger Rx Buffers";
+  }
+};
+
+#endif
@@ -15,10 +15,12 @@
  */
 
 #include <mutex>
+#include <sys/resource.h>
 
 #include "include/compat.h"
 #include "common/Cond.h"
 #include "common/errno.h"
+#include "common/Thread.h"
 #include "PosixStack.h"
 #ifdef HAVE_RDMA
 #include "rdma/RDMAStack.h"
@@ -41,6 +43,12 @@ std::function<void ()> NetworkStack::add_thread(unsigned i)
       char tp_name[16];
       sprintf(tp_name, "msgr-worker-%u", w->id);
       ceph_pthread_setname(pthread_self(), tp_name);
+      if (thread_nice &&
+          setpriority(PRIO_PROCESS, ceph_gettid(), thread_nice) < 0) {
+        int r = -errno;
+        lderr(cct) << __func__ << " failed to set nice " << thread_nice
+                   << ": " << cpp_strerror(r) << dendl;
+      }
       const unsigned EventMaxWaitUs = 30000000;
       w->center.set_owner();
       ldout(cct, 10) << __func__ << " starting" << dendl;
@@ -49,24 +57,30 @@ std::function<void ()> NetworkStack::add_thread(unsigned i)
       while (!w->done) {
         ldout(cct, 30) << __func__ << " calling event process" << dendl;
 
-        ceph::timespan dur;
-        int r = w->center.process_events(EventMaxWaitUs, &dur);
+        ceph::timespan dur, spin;
+        int r = w->center.process_events(EventMaxWaitUs, &dur, &spin);
         if (r < 0) {
           ldout(cct, 20) << __func__ << " process events failed: "
                          << cpp_strerror(errno) << dendl;
           // TODO do something?
         }
         w->perf_logger->tinc(l_msgr_running_total_time, dur);
+        if (spin != ceph::timespan::zero())
+          w->perf_logger->tinc(l_msgr_busy_poll_wasted_time, spin);
       }
       w->reset();
       w->destroy();
   };
 }
 
-std::shared_ptr<NetworkStack> NetworkStack::create(CephContext *c, const string &t)
+std::shared_ptr<NetworkStack> NetworkStack::create(
+  CephContext *c, const string &t,
+  unsigned num_workers, unsigned first_worker)
 {
+  ceph_assert(t == "posix" || (!num_workers && !first_worker));
   if (t == "posix")
-    return std::make_shared<PosixNetworkStack>(c, t);
+    return std::make_shared<PosixNetworkStack>(c, t, num_workers,
+                                               first_worker);
 #ifdef HAVE_RDMA
   else if (t == "rdma")
     return std::make_shared<RDMAStack>(c, t);
@@ -101,25 +115,31 @@ Worker* NetworkStack::create_worker(CephContext *c, const string &type, unsigned
   return nullptr;
 }
 
-NetworkStack::NetworkStack(CephContext *c, const string &t): type(t), started(false), cct(c)
+NetworkStack::NetworkStack(CephContext *c, const string &t,
+                           unsigned _num_workers, unsigned first_worker)
+  : type(t), started(false), cct(c)
 {
   ceph_assert(cct->_conf->ms_async_op_threads > 0);
 
   const int InitEventNumber = 5000;
-  num_workers = cct->_conf->ms_async_op_threads;
-  if (num_workers >= EventCenter::MAX_EVENTCENTER) {
+  num_workers = _num_workers ? _num_workers : cct->_conf->ms_async_op_threads;
+  ceph_assert(first_worker < EventCenter::MAX_EVENTCENTER);
+  if (first_worker + num_workers >= EventCenter::MAX_EVENTCENTER) {
     ldout(cct, 0) << __func__ << " max thread limit is "
                   << EventCenter::MAX_EVENTCENTER << ", switching to this now. "
                   << "Higher thread values are unnecessary and currently unsupported."
                   << dendl;
-    num_workers = EventCenter::MAX_EVENTCENTER;
+    num_workers = EventCenter::MAX_EVENTCENTER - first_worker;
   }
 
+  std::vector<std::shared_ptr<RxBufferPool>> rx_pools;
   for (unsigned i = 0; i < num_workers; ++i) {
-    Worker *w = create_worker(cct, type, i);
-    w->center.init(InitEventNumber, i, type);
+    Worker *w = create_worker(cct, type, first_worker + i);
+    w->center.init(InitEventNumber, first_worker + i, type);
     workers.push_back(w);
+    rx_pools.push_back(w->rx_buffer_pool);
   }
+  rx_buffer_cache = std::make_shared<RxBufferCache>(std::move(rx_pools));
 }
 
 void NetworkStack::start()
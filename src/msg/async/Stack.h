@@ -21,6 +21,7 @@
 #include "common/perf_counters.h"
 #include "msg/msg_types.h"
 #include "msg/async/Event.h"
+#include "msg/async/RxBufferPool.h"
 
 class Worker;
 class ConnectedSocketImpl {
@@ -210,6 +211,7 @@ enum {
   l_msgr_running_send_time,
   l_msgr_running_recv_time,
   l_msgr_running_fast_dispatch_time,
+  l_msgr_busy_poll_wasted_time,
 
   l_msgr_send_messages_queue_lat,
   l_msgr_handle_ack_lat,
@@ -231,12 +233,16 @@ class Worker {
 
   std::atomic_uint references;
   EventCenter center;
+  /// for the large segments read by this worker's connections
+  std::shared_ptr<RxBufferPool> rx_buffer_pool;
 
   Worker(const Worker&) = delete;
   Worker& operator=(const Worker&) = delete;
 
   Worker(CephContext *c, unsigned i)
-    : cct(c), perf_logger(NULL), id(i), references(0), center(c) {
+    : cct(c), perf_logger(NULL), id(i), references(0), center(c),
+      rx_buffer_pool(std::make_shared<RxBufferPool>(
+	cct->_conf.get_val<Option::size_t>("ms_async_rx_buffer_pool_size"))) {
     char name[128];
     sprintf(name, "AsyncMessenger::Worker-%u", id);
     // initialize perf_logger
@@ -253,6 +259,7 @@ class Worker {
     plb.add_time(l_msgr_running_send_time, "msgr_running_send_time", "The total time of message sending");
     plb.add_time(l_msgr_running_recv_time, "msgr_running_recv_time", "The total time of message receiving");
     plb.add_time(l_msgr_running_fast_dispatch_time, "msgr_running_fast_dispatch_time", "The total time of fast dispatch");
+    plb.add_time(l_msgr_busy_poll_wasted_time, "msgr_busy_poll_wasted_time", "The total time of busy polling that found no event");
 
     plb.add_time_avg(l_msgr_send_messages_queue_lat, "msgr_send_messages_queue_lat", "Network sent messages lat");
     plb.add_time_avg(l_msgr_handle_ack_lat, "msgr_handle_ack_lat", "Connection handle ack lat");
@@ -308,14 +315,20 @@ class NetworkStack {
   unsigned num_workers = 0;
   ceph::spinlock pool_spin;
   bool started = false;
+  int thread_nice = 0;
 
   std::function<void ()> add_thread(unsigned i);
 
  protected:
   CephContext *cct;
   vector<Worker*> workers;
+  /// the workers' rx buffer pools, for a memory autotuner to size
+  std::shared_ptr<RxBufferCache> rx_buffer_cache;
 
-  explicit NetworkStack(CephContext *c, const string &t);
+  /// the workers are numbered from first_worker, so that the event
+  /// centers of all of the stacks of a type have their own ids
+  explicit NetworkStack(CephContext *c, const string &t,
+                        unsigned num_workers = 0, unsigned first_worker = 0);
  public:
   NetworkStack(const NetworkStack &) = delete;
   NetworkStack& operator=(const NetworkStack &) = delete;
@@ -324,8 +337,11 @@ class NetworkStack {
       delete w;
   }
 
+  /// num_workers defaults to ms_async_op_threads; only posix stacks can
+  /// be created with other worker numbers
   static std::shared_ptr<NetworkStack> create(
-          CephContext *c, const string &type);
+          CephContext *c, const string &type,
+          unsigned num_workers = 0, unsigned first_worker = 0);
 
   static Worker* create_worker(
           CephContext *c, const string &t, unsigned i);
@@ -340,6 +356,10 @@ class NetworkStack {
   virtual bool support_local_listen_table() const { return false; }
   virtual bool nonblock_connect_need_writable_event() const { return true; }
 
+  /// the nice value of the worker threads, set before start()
+  void set_thread_nice(int nice) {
+    thread_nice = nice;
+  }
   void start();
   void stop();
   virtual Worker *get_worker();
@@ -350,6 +370,9 @@ class NetworkStack {
   unsigned get_num_worker() const {
     return num_workers;
   }
+  std::shared_ptr<RxBufferCache> get_rx_buffer_cache() const {
+    return rx_buffer_cache;
+  }
 
   // direct is used in tests only
   virtual void spawn_worker(unsigned i, std::function<void ()> &&) = 0;
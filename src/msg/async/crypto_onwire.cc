@@ -200,8 +200,26 @@ ceph::bufferlist AES128GCM_OnWireRxHandler::authenticated_decrypt_update(
   ceph_assert(ciphertext.length() > 0);
   //ceph_assert(ciphertext.length() % AESGCM_BLOCK_LEN == 0);
 
-  // NOTE: we might consider in-place transformations in the future. AFAIK
-  // OpenSSL's might sustain that but lack of clear confirmation postpones.
+  // the usual case: the segment was read into a buffer of its own, so
+  // decrypt it in place (GCM allows out == in) rather than into a fresh
+  // one.
+  if (ciphertext.get_num_buffers() == 1 &&
+      ciphertext.front().raw_nref() == 1 &&
+      ciphertext.front().is_aligned(alignment)) {
+    auto* buf = reinterpret_cast<unsigned char*>(ciphertext.c_str());
+    int update_len = 0;
+    if (1 != EVP_DecryptUpdate(ectx.get(),
+	buf,
+	&update_len,
+	buf,
+	ciphertext.length())) {
+      throw std::runtime_error("EVP_DecryptUpdate failed");
+    }
+    ceph_assert_always(update_len >= 0);
+    ceph_assert(ciphertext.length() == static_cast<unsigned>(update_len));
+    return std::move(ciphertext);
+  }
+
   auto plainnode = ceph::buffer::ptr_node::create(buffer::create_aligned(
     ciphertext.length(), alignment));
   auto* plainbuf = reinterpret_cast<unsigned char*>(plainnode->c_str());
@@ -232,7 +232,10 @@ private:
     ceph::crypto::onwire::rxtx_t &session_stream_handlers,
     std::index_sequence<Is...>)
   {
-    session_stream_handlers.tx->reset_tx_handler({ segments[Is].length()... });
+    // the epilogue is ciphered too; count it so the whole ciphertext
+    // comes out in the one buffer
+    session_stream_handlers.tx->reset_tx_handler(
+      { segments[Is].length()..., sizeof(epilogue_secure_block_t) });
   }
 
 public:
@@ -103,6 +103,17 @@ int NetHandler::set_socket_options(int sd, bool nodelay, int size)
       ldout(cct, 0) << "couldn't set SO_RCVBUF to " << size << ": " << cpp_strerror(r) << dendl;
     }
   }
+#ifdef SO_BUSY_POLL
+  // let the kernel poll the device queue for a blocking read or poll
+  // with nothing ready, rather than wait for the interrupt.  Raising it
+  // above net.core.busy_read needs CAP_NET_ADMIN, so failing is not fatal.
+  if (int busy_poll = cct->_conf->ms_tcp_busy_poll_us; busy_poll > 0) {
+    if (::setsockopt(sd, SOL_SOCKET, SO_BUSY_POLL, (void*)&busy_poll, sizeof(busy_poll)) < 0) {
+      ldout(cct, 0) << "couldn't set SO_BUSY_POLL to " << busy_poll << ": "
+                    << cpp_strerror(errno) << dendl;
+    }
+  }
+#endif
 
   // block ESIGPIPE
 #ifdef CEPH_USE_SO_NOSIGPIPE
@@ -784,12 +784,17 @@ Infiniband::MemoryManager::MemoryManager(CephContext *c, Device *d, ProtectionDo
                   (c->_conf->ms_async_rdma_receive_buffers < 2 * c->_conf->ms_async_rdma_receive_queue_len ?
                    c->_conf->ms_async_rdma_receive_buffers :  2 * c->_conf->ms_async_rdma_receive_queue_len) :
                   // rx pool is infinite, we can set any initial size that we want
-                   2 * c->_conf->ms_async_rdma_receive_queue_len)
+                   2 * c->_conf->ms_async_rdma_receive_queue_len),
+    reged_lock("MemoryManager::reged_lock")
 {
 }
 
 Infiniband::MemoryManager::~MemoryManager()
 {
+  for (auto& i : reged_tx_buffers) {
+    ibv_dereg_mr(i.first->mr);
+    delete i.first;
+  }
   if (send)
     delete send;
 }
@@ -855,6 +860,39 @@ int Infiniband::MemoryManager::get_send_buffers(std::vector<Chunk*> &c, size_t b
   return send->get_buffers(c, bytes);
 }
 
+Infiniband::MemoryManager::Chunk *Infiniband::MemoryManager::reg_tx_buffer(const bufferptr &p)
+{
+  char *b = const_cast<char*>(p.c_str());
+  ibv_mr *m = ibv_reg_mr(pd->pd, b, p.length(), IBV_ACCESS_LOCAL_WRITE);
+  if (!m) {
+    ldout(cct, 1) << __func__ << " failed to register " << p.length()
+                  << " bytes: " << cpp_strerror(errno) << dendl;
+    return nullptr;
+  }
+  Chunk *chunk = new Chunk(m, p.length(), b);
+  chunk->set_offset(p.length());
+  Mutex::Locker l(reged_lock);
+  reged_tx_buffers.emplace(chunk, p);
+  return chunk;
+}
+
+bool Infiniband::MemoryManager::put_reged_tx_buffer(Chunk *chunk)
+{
+  bufferptr p;
+  {
+    Mutex::Locker l(reged_lock);
+    auto it = reged_tx_buffers.find(chunk);
+    if (it == reged_tx_buffers.end())
+      return false;
+    p = std::move(it->second);
+    reged_tx_buffers.erase(it);
+  }
+  int r = ibv_dereg_mr(chunk->mr);
+  ceph_assert(r == 0);
+  delete chunk;
+  return true;
+}
+
 static std::atomic<bool> init_prereq = {false};
 
 void Infiniband::verify_prereq(CephContext *cct) {
@@ -936,6 +974,27 @@ void Infiniband::init()
     ceph_abort();
   }
 
+  // all workers share the srq, so size it for all of them; keep at
+  // least half of the receive buffers out of it for the data being read
+  if (support_srq && cct->_conf->ms_async_rdma_receive_queue_len_per_worker) {
+    uint64_t want = cct->_conf->ms_async_rdma_receive_queue_len_per_worker *
+                    cct->_conf->ms_async_op_threads;
+    uint64_t limit = device->device_attr.max_srq_wr;
+    if (cct->_conf->ms_async_rdma_receive_buffers > 0)
+      limit = std::min<uint64_t>(limit, cct->_conf->ms_async_rdma_receive_buffers / 2);
+    if (want > limit) {
+      ldout(cct, 0) << __func__ << " receive queue length of " << want <<
+                    " for " << cct->_conf->ms_async_op_threads <<
+                    " workers is too big. Setting " << limit << dendl;
+      want = limit;
+    }
+    if (want > rx_queue_len) {
+      rx_queue_len = want;
+      ldout(cct, 1) << __func__ << " receive queue length is " << rx_queue_len <<
+                    " for " << cct->_conf->ms_async_op_threads << " workers" << dendl;
+    }
+  }
+
   tx_queue_len = device->device_attr.max_qp_wr;
   if (tx_queue_len > cct->_conf->ms_async_rdma_send_buffers) {
     tx_queue_len = cct->_conf->ms_async_rdma_send_buffers;
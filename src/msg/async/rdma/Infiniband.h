@@ -25,9 +25,11 @@
 #include <rdma/rdma_cma.h>
 
 #include <atomic>
+#include <map>
 #include <string>
 #include <vector>
 
+#include "include/buffer.h"
 #include "include/int_types.h"
 #include "include/page.h"
 #include "common/debug.h"
@@ -138,6 +140,7 @@ enum {
   l_msgr_rdma_inflight_tx_chunks,
   l_msgr_rdma_rx_bufs_in_use,
   l_msgr_rdma_rx_bufs_total,
+  l_msgr_rdma_rx_bufs_lent,
 
   l_msgr_rdma_tx_total_wc,
   l_msgr_rdma_tx_total_wc_errors,
@@ -321,6 +324,16 @@ class Infiniband {
     Chunk *get_tx_chunk_by_buffer(const char *c) {
       return send->get_chunk_by_buffer(c);
     }
+    /**
+     * Register an outgoing buffer with the device so it can be sent
+     * without copying it into a tx chunk. The returned chunk keeps the
+     * buffer alive until put_reged_tx_buffer().
+     *
+     * @return the chunk to post, or nullptr if registration failed
+     */
+    Chunk *reg_tx_buffer(const bufferptr &p);
+    /// release a chunk from reg_tx_buffer(); false if @p chunk isn't one
+    bool put_reged_tx_buffer(Chunk *chunk);
     uint32_t get_tx_buffer_size() const {
       return send->buffer_size;
     }
@@ -347,6 +360,9 @@ class Infiniband {
     ProtectionDomain *pd;
     MemPoolContext rxbuf_pool_ctx;
     mem_pool     rxbuf_pool;
+    Mutex reged_lock; // protect `reged_tx_buffers`
+    // chunks from reg_tx_buffer() -> the buffers they pin until sent
+    std::map<Chunk*, bufferptr> reged_tx_buffers;
 
 
     void* huge_pages_malloc(size_t size);
@@ -14,6 +14,7 @@
  *
  */
 #include "RDMAStack.h"
+#include "common/deleter.h"
 
 #define dout_subsys ceph_subsys_ms
 #undef dout_prefix
@@ -363,51 +364,69 @@ ssize_t RDMAConnectedSocketImpl::read_buffers(char* buf, size_t len)
   return read;
 }
 
+/*
+ * Hand out the next received chunk as a bufferptr pointing straight into
+ * it; the chunk goes back to the pool when the last reference is dropped.
+ * Once ms_async_rdma_zero_copy_receive_buffers are out, copy instead.
+ */
 ssize_t RDMAConnectedSocketImpl::zero_copy_read(bufferptr &data)
 {
-  if (error)
-    return -error;
-  static const int MAX_COMPLETIONS = 16;
-  ibv_wc wc[MAX_COMPLETIONS];
-  ssize_t size = 0;
-
-  ibv_wc*  response;
-  Chunk* chunk;
-  bool loaded = false;
-  auto iter = buffers.begin();
-  if (iter != buffers.end()) {
-    chunk = *iter;
-    // FIXME need to handle release
-    // auto del = std::bind(&Chunk::post_srq, std::move(chunk), infiniband);
-    buffers.erase(iter);
-    loaded = true;
-    size = chunk->bound;
-  }
+  uint64_t i = 0;
+  int r = ::read(notify_fd, &i, sizeof(i));
+  ldout(cct, 20) << __func__ << " notify_fd : " << i << " in " << my_msg.qpn << " r = " << r << dendl;
+
+  if (!active || 0 == connected)
+    return -EAGAIN;
 
   std::vector<ibv_wc> cqe;
   get_wc(cqe);
-  if (cqe.empty())
-    return size == 0 ? -EAGAIN : size;
-
-  ldout(cct, 20) << __func__ << " pool completion queue got " << cqe.size() << " responses."<< dendl;
-
-  for (size_t i = 0; i < cqe.size(); ++i) {
-    response = &wc[i];
-    chunk = reinterpret_cast<Chunk*>(response->wr_id);
-    chunk->prepare_read(response->byte_len);
-    if (!loaded && i == 0) {
-      // FIXME need to handle release
-      // auto del = std::bind(&Chunk::post_srq, std::move(chunk), infiniband);
-      size = chunk->bound;
-      continue;
+  if (!cqe.empty()) {
+    ldout(cct, 20) << __func__ << " poll queue got " << cqe.size() << " responses. QP: " << my_msg.qpn << dendl;
+    for (auto& response : cqe) {
+      ceph_assert(response.status == IBV_WC_SUCCESS);
+      Chunk* chunk = reinterpret_cast<Chunk *>(response.wr_id);
+      chunk->prepare_read(response.byte_len);
+      worker->perf_logger->inc(l_msgr_rdma_rx_bytes, response.byte_len);
+      if (response.byte_len == 0) {
+        dispatcher->perf_logger->inc(l_msgr_rdma_rx_fin);
+        if (connected) {
+          error = ECONNRESET;
+          ldout(cct, 20) << __func__ << " got remote close msg..." << dendl;
+        }
+        dispatcher->post_chunk_to_pool(chunk);
+      } else {
+        buffers.push_back(chunk);
+      }
+    }
+    worker->perf_logger->inc(l_msgr_rdma_rx_chunks, cqe.size());
+    if (is_server && connected == 0) {
+      connected = 1;
+      cleanup();
+      submit(false);
     }
-    buffers.push_back(chunk);
-    iter++;
   }
 
-  if (size == 0)
-    return -EAGAIN;
-  return size;
+  if (buffers.empty())
+    return error ? -error : -EAGAIN;
+
+  Chunk* chunk = buffers.front();
+  buffers.erase(buffers.begin());
+  uint32_t len = chunk->get_bound() - chunk->get_offset();
+  if (dispatcher->lend_rx_chunk()) {
+    RDMADispatcher* d = dispatcher;
+    data = bufferptr(buffer::claim_buffer(
+      len, chunk->buffer + chunk->get_offset(),
+      make_deleter([d, chunk] { d->return_rx_chunk(chunk); })));
+  } else {
+    data = buffer::create(len);
+    chunk->read(data.c_str(), len);
+    dispatcher->post_chunk_to_pool(chunk);
+  }
+  update_post_backlog();
+
+  if (!buffers.empty())
+    notify();
+  return len;
 }
 
 ssize_t RDMAConnectedSocketImpl::send(bufferlist &bl, bool more)
@@ -481,13 +500,16 @@ ssize_t RDMAConnectedSocketImpl::submit(bool more)
     return total_copied;
   };
 
+  // buffers at least this big are registered and sent as they are
+  const uint64_t reg_min_size = cct->_conf->ms_async_rdma_send_reg_min_size;
   std::vector<Chunk*> tx_buffers;
   auto it = std::cbegin(pending_bl.buffers());
   auto copy_it = it;
   unsigned total = 0;
   unsigned need_reserve_bytes = 0;
   while (it != pending_bl.buffers().end()) {
-    if (infiniband->is_tx_buffer(it->raw_c_str())) {
+    bool is_tx_buffer = infiniband->is_tx_buffer(it->raw_c_str());
+    if (is_tx_buffer || (reg_min_size && it->length() >= reg_min_size)) {
       if (need_reserve_bytes) {
         unsigned copied = fill_tx_via_copy(tx_buffers, need_reserve_bytes, copy_it, it);
         total += copied;
@@ -496,9 +518,16 @@ ssize_t RDMAConnectedSocketImpl::submit(bool more)
         need_reserve_bytes = 0;
       }
       ceph_assert(copy_it == it);
-      tx_buffers.push_back(infiniband->get_tx_chunk_by_buffer(it->raw_c_str()));
-      total += it->length();
-      ++copy_it;
+      Chunk *chunk = is_tx_buffer ?
+        infiniband->get_tx_chunk_by_buffer(it->raw_c_str()) :
+        infiniband->get_memory_manager()->reg_tx_buffer(*it);
+      if (chunk) {
+        tx_buffers.push_back(chunk);
+        total += it->length();
+        ++copy_it;
+      } else {
+        need_reserve_bytes += it->length();
+      }
     } else {
       need_reserve_bytes += it->length();
     }
@@ -578,7 +607,12 @@ int RDMAConnectedSocketImpl::post_work_request(std::vector<Chunk*> &tx_buffers)
                   << " (most probably should be peer not ready): "
                   << cpp_strerror(errno) << dendl;
     worker->perf_logger->inc(l_msgr_rdma_tx_failed);
-    return -errno;
+    int r = -errno;
+    // nothing from the bad request on was posted, so no completion will
+    // release the registered buffers among them
+    for (auto wr = bad_tx_work_request; wr; wr = wr->next)
+      infiniband->get_memory_manager()->put_reged_tx_buffer(reinterpret_cast<Chunk*>(wr->wr_id));
+    return r;
   }
   qp->add_tx_wr(num);
   worker->perf_logger->inc(l_msgr_rdma_tx_chunks, tx_buffers.size());
@@ -39,6 +39,8 @@ RDMADispatcher::~RDMADispatcher()
   ceph_assert(num_qp_conn == 0);
   ceph_assert(dead_queue_pairs.empty());
   ceph_assert(num_dead_queue_pair == 0);
+  // a lent chunk would come back to a dispatcher and pool that are gone
+  ceph_assert(rx_lent == 0);
 
   delete async_handler;
 }
@@ -53,6 +55,7 @@ RDMADispatcher::RDMADispatcher(CephContext* c, RDMAStack* s)
   plb.add_u64_counter(l_msgr_rdma_inflight_tx_chunks, "inflight_tx_chunks", "The number of inflight tx chunks");
   plb.add_u64_counter(l_msgr_rdma_rx_bufs_in_use, "rx_bufs_in_use", "The number of rx buffers that are holding data and being processed");
   plb.add_u64_counter(l_msgr_rdma_rx_bufs_total, "rx_bufs_total", "The total number of rx buffers");
+  plb.add_u64_counter(l_msgr_rdma_rx_bufs_lent, "rx_bufs_lent", "The number of rx buffers held by zero-copy reads");
 
   plb.add_u64_counter(l_msgr_rdma_tx_total_wc, "tx_total_wc", "The number of tx work comletions");
   plb.add_u64_counter(l_msgr_rdma_tx_total_wc_errors, "tx_total_wc_errors", "The number of tx errors");
@@ -165,6 +168,30 @@ void RDMADispatcher::post_chunk_to_pool(Chunk* chunk)
   perf_logger->dec(l_msgr_rdma_rx_bufs_in_use);
 }
 
+/**
+ * Account for a rx chunk given out by zero_copy_read, so that readers
+ * holding on to their data can't drain the receive pool.
+ *
+ * \return
+ *      false if ms_async_rdma_zero_copy_receive_buffers are already lent
+ */
+bool RDMADispatcher::lend_rx_chunk()
+{
+  if (++rx_lent > cct->_conf->ms_async_rdma_zero_copy_receive_buffers) {
+    --rx_lent;
+    return false;
+  }
+  perf_logger->inc(l_msgr_rdma_rx_bufs_lent);
+  return true;
+}
+
+void RDMADispatcher::return_rx_chunk(Chunk* chunk)
+{
+  post_chunk_to_pool(chunk);
+  perf_logger->dec(l_msgr_rdma_rx_bufs_lent);
+  --rx_lent;
+}
+
 int RDMADispatcher::post_chunks_to_rq(int num, ibv_qp *qp)
 {
   Mutex::Locker l(lock);
@@ -416,6 +443,8 @@ void RDMADispatcher::handle_tx_event(ibv_wc *cqe, int n)
     //In the case of 'fin' wr_id points to the QueuePair.
     if (get_stack()->get_infiniband().get_memory_manager()->is_tx_buffer(chunk->buffer)) {
       tx_chunks.push_back(chunk);
+    } else if (get_stack()->get_infiniband().get_memory_manager()->put_reged_tx_buffer(chunk)) {
+      ldout(cct, 30) << __func__ << " released registered buffer " << chunk << dendl;
     } else if (reinterpret_cast<QueuePair*>(response->wr_id)->get_local_qp_number() == response->qp_num ) {
       ldout(cct, 1) << __func__ << " sending of the disconnect msg completed" << dendl;
     } else {
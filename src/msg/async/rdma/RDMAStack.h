@@ -117,8 +117,12 @@ class RDMADispatcher {
   void post_tx_buffer(std::vector<Chunk*> &chunks);
 
   std::atomic<uint64_t> inflight = {0};
+  // rx chunks handed out by zero_copy_read and not returned yet
+  std::atomic<uint64_t> rx_lent = {0};
 
   void post_chunk_to_pool(Chunk* chunk);
+  bool lend_rx_chunk();
+  void return_rx_chunk(Chunk* chunk);
   int post_chunks_to_rq(int num, ibv_qp *qp=NULL);
 };
 
@@ -345,7 +349,7 @@ class RDMAStack : public NetworkStack {
  public:
   explicit RDMAStack(CephContext *cct, const string &t);
   virtual ~RDMAStack();
-  virtual bool support_zero_copy_read() const override { return false; }
+  virtual bool support_zero_copy_read() const override { return true; }
   virtual bool nonblock_connect_need_writable_event() const override { return false; }
 
   virtual void spawn_worker(unsigned i, std::function<void ()> &&func) override;
@@ -48,6 +48,7 @@ namespace ceph {
 
 class Logger;
 class ContextQueue;
+namespace PriorityCache { struct PriCache; }
 
 static inline void encode(const std::map<std::string,ceph::buffer::ptr> *attrset, ceph::buffer::list &bl) {
   using ceph::encode;
@@ -1470,6 +1471,7 @@ public:
   virtual int flush_cache(std::ostream *os = NULL) { return -1; }
   virtual void dump_perf_counters(ceph::Formatter *f) {}
   virtual void dump_cache_stats(ceph::Formatter *f) {}
+  virtual void dump_defrag_status(ceph::Formatter *f) {}
   virtual void dump_cache_stats(std::ostream& os) {}
 
   virtual std::string get_type() = 0;
@@ -1487,6 +1489,11 @@ public:
 
   virtual void set_cache_shards(unsigned num) { }
 
+  /// let the store's memory autotuner, if it has one, size this cache of
+  /// another part of the process along with its own
+  virtual void add_pri_cache(const std::string& name,
+			     std::shared_ptr<PriorityCache::PriCache> c) { }
+
   /**
    * Returns 0 if the hobject is valid, -error otherwise
    *
@@ -1684,6 +1691,39 @@ public:
      ceph::buffer::list& bl,
      uint32_t op_flags = 0) = 0;
 
+  /**
+   * read_crc32c -- crc32c of a byte range of data of an object
+   *
+   * Reads like read() but only returns ceph_crc32c(seed, data).  A
+   * store that keeps crc32c checksums of the data can derive the
+   * result from those as it verifies them, instead of hashing the
+   * bytes a second time.
+   *
+   * @param cid collection for object
+   * @param oid oid of object
+   * @param offset location offset of first byte to be read
+   * @param len number of bytes to be read
+   * @param seed crc32c to continue from
+   * @param crc output crc32c
+   * @param op_flags is CEPH_OSD_OP_FLAG_*
+   * @returns number of bytes read on success, or negative error code on failure.
+   */
+  virtual int read_crc32c(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t seed,
+    uint32_t *crc,
+    uint32_t op_flags = 0) {
+    ceph::buffer::list bl;
+    int r = read(c, oid, offset, len, bl, op_flags);
+    if (r >= 0) {
+      *crc = bl.crc32c(seed);
+    }
+    return r;
+  }
+
   /**
    * fiemap -- get extent std::map of data of an object
    *
@@ -1892,6 +1932,22 @@ public:
     const ghobject_t &oid  ///< [in] object
     ) = 0;
 
+  /// how an omap iterator is going to be used; backends may ignore it
+  struct omap_iter_hints_t {
+    uint64_t readahead = 0;  ///< bytes to read ahead for long scans, 0 = none
+    bool fill_cache = true;  ///< false for one-off scans
+    std::optional<std::string> upper_bound;  ///< no keys at or past this
+  };
+
+  /// as above, with hints about the scan to come
+  virtual ObjectMap::ObjectMapIterator get_omap_iterator(
+    CollectionHandle &c,   ///< [in] collection
+    const ghobject_t &oid, ///< [in] object
+    const omap_iter_hints_t &hints ///< [in] scan hints
+    ) {
+    return get_omap_iterator(c, oid);
+  }
+
   virtual int flush_journal() { return -EOPNOTSUPP; }
 
   virtual int dump_journal(std::ostream& out) { return -EOPNOTSUPP; }
@@ -0,0 +1,74 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_OS_TRANSACTIONTRACE_H
+#define CEPH_OS_TRANSACTIONTRACE_H
+
+#include "common/safe_io.h"
+#include "os/ObjectStore.h"
+
+/**
+ * One ObjectStore::queue_transactions() call, as recorded to a trace
+ * file (see bluestore_debug_transaction_trace) and replayed by
+ * ceph_replay_objectstore.
+ *
+ * A trace is a sequence of these, each preceded by its encoded length
+ * in a little-endian __u32.
+ */
+struct transaction_trace_record_t {
+  utime_t stamp;
+  coll_t cid;
+  std::vector<ObjectStore::Transaction> tls;
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(stamp, bl);
+    encode(cid, bl);
+    encode(tls, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator& p) {
+    DECODE_START(1, p);
+    decode(stamp, p);
+    decode(cid, p);
+    decode(tls, p);
+    DECODE_FINISH(p);
+  }
+
+  /// frame and append to a trace
+  int write(int fd) const {
+    bufferlist payload;
+    encode(payload);
+    bufferlist bl;
+    ceph::encode((__u32)payload.length(), bl);
+    bl.claim_append(payload);
+    return bl.write_fd(fd);
+  }
+  /// read the next record; 0 on success, -ENOENT at the end of the trace
+  int read(int fd) {
+    ceph_le32 len;
+    ssize_t r = safe_read_exact(fd, &len, sizeof(len));
+    if (r == -EDOM) {
+      return -ENOENT;
+    } else if (r < 0) {
+      return r;
+    }
+    bufferlist bl;
+    r = bl.read_fd(fd, len);
+    if (r < 0) {
+      return r;
+    } else if (r != (ssize_t)len) {
+      return -EIO;
+    }
+    try {
+      auto p = bl.cbegin();
+      decode(p);
+    } catch (buffer::error&) {
+      return -EIO;
+    }
+    return 0;
+  }
+};
+WRITE_CLASS_ENCODER(transaction_trace_record_t)
+
+#endif
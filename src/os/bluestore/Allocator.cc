@@ -4,6 +4,8 @@
 #include "Allocator.h"
 #include "StupidAllocator.h"
 #include "BitmapAllocator.h"
+#include "AvlAllocator.h"
+#include "HybridAllocator.h"
 #include "common/debug.h"
 
 #define dout_subsys ceph_subsys_bluestore
@@ -15,6 +17,11 @@ Allocator *Allocator::create(CephContext* cct, string type,
     return new StupidAllocator(cct);
   } else if (type == "bitmap") {
     return new BitmapAllocator(cct, size, block_size);
+  } else if (type == "avl") {
+    return new AvlAllocator(cct, size, block_size);
+  } else if (type == "hybrid") {
+    return new HybridAllocator(cct, size, block_size,
+      cct->_conf.get_val<uint64_t>("bluestore_hybrid_alloc_mem_cap"));
   }
   lderr(cct) << "Allocator::" << __func__ << " unknown alloc type "
 	     << type << dendl;
@@ -12,6 +12,7 @@
 #ifndef CEPH_OS_BLUESTORE_ALLOCATOR_H
 #define CEPH_OS_BLUESTORE_ALLOCATOR_H
 
+#include <functional>
 #include <ostream>
 #include "include/ceph_assert.h"
 #include "os/bluestore/bluestore_types.h"
@@ -44,6 +45,8 @@ public:
   void release(const PExtentVector& release_set);
 
   virtual void dump() = 0;
+  /// report every free extent, in no particular order
+  virtual void dump(std::function<void(uint64_t offset, uint64_t length)> notify) = 0;
 
   virtual void init_add_free(uint64_t offset, uint64_t length) = 0;
   virtual void init_rm_free(uint64_t offset, uint64_t length) = 0;
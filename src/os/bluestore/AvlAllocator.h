@@ -0,0 +1,201 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_OS_BLUESTORE_AVLALLOCATOR_H
+#define CEPH_OS_BLUESTORE_AVLALLOCATOR_H
+
+#include <boost/intrusive/avl_set.hpp>
+
+#include "Allocator.h"
+#include "os/bluestore/bluestore_types.h"
+#include "include/mempool.h"
+#include "common/ceph_mutex.h"
+
+struct range_seg_t {
+  MEMPOOL_CLASS_HELPERS();  ///< memory monitoring
+  uint64_t start;   ///< starting offset of this segment
+  uint64_t end;     ///< ending offset (non-inclusive)
+
+  range_seg_t(uint64_t start, uint64_t end)
+    : start{start},
+      end{end}
+  {}
+  uint64_t length() const {
+    return end - start;
+  }
+
+  // offset tree: non-overlapping segments, ordered by offset
+  struct before_t {
+    template<typename KeyLeft, typename KeyRight>
+    bool operator()(const KeyLeft& lhs, const KeyRight& rhs) const {
+      return lhs.end <= rhs.start;
+    }
+  };
+  boost::intrusive::avl_set_member_hook<> offset_hook;
+
+  // size tree: ordered by length, then by offset
+  struct shorter_t {
+    template<typename KeyType>
+    bool operator()(const range_seg_t& lhs, const KeyType& rhs) const {
+      auto lhs_size = lhs.end - lhs.start;
+      auto rhs_size = rhs.end - rhs.start;
+      if (lhs_size != rhs_size) {
+	return lhs_size < rhs_size;
+      }
+      return lhs.start < rhs.start;
+    }
+  };
+  boost::intrusive::avl_set_member_hook<> size_hook;
+};
+
+/*
+ * Free space is kept as extents in two AVL trees: one by offset, used for
+ * coalescing and first-fit allocation, and one by size, used for best-fit
+ * allocation once the device gets full or fragmented.
+ */
+class AvlAllocator : public Allocator {
+  struct dispose_rs {
+    void operator()(range_seg_t* p) {
+      delete p;
+    }
+  };
+
+protected:
+  /*
+   * ctor intended for the usage from descendant class(es) which
+   * provides handling for spilled over entries
+   * (when entry count >= max_entries)
+   */
+  AvlAllocator(CephContext* cct, int64_t device_size, int64_t block_size,
+    uint64_t max_mem);
+
+public:
+  AvlAllocator(CephContext* cct, int64_t device_size, int64_t block_size);
+  ~AvlAllocator() override;
+
+  int64_t allocate(
+    uint64_t want_size, uint64_t alloc_unit, uint64_t max_alloc_size,
+    int64_t hint, PExtentVector *extents) override;
+
+  void release(const interval_set<uint64_t>& release_set) override;
+
+  uint64_t get_free() override;
+  double get_fragmentation(uint64_t alloc_unit) override;
+
+  void dump() override;
+  void dump(std::function<void(uint64_t offset, uint64_t length)> notify) override;
+
+  void init_add_free(uint64_t offset, uint64_t length) override;
+  void init_rm_free(uint64_t offset, uint64_t length) override;
+
+  void shutdown() override;
+
+private:
+  template<class Tree>
+  uint64_t _block_picker(const Tree& t, uint64_t *cursor, uint64_t size,
+			 uint64_t align);
+  int _allocate_extent(uint64_t size, uint64_t unit, uint64_t *offset,
+		       uint64_t *length);
+
+  using range_tree_t =
+    boost::intrusive::avl_set<
+      range_seg_t,
+      boost::intrusive::compare<range_seg_t::before_t>,
+      boost::intrusive::member_hook<
+	range_seg_t,
+	boost::intrusive::avl_set_member_hook<>,
+	&range_seg_t::offset_hook>>;
+  range_tree_t range_tree;    ///< main range tree
+
+  using range_size_tree_t =
+    boost::intrusive::avl_multiset<
+      range_seg_t,
+      boost::intrusive::compare<range_seg_t::shorter_t>,
+      boost::intrusive::member_hook<
+	range_seg_t,
+	boost::intrusive::avl_set_member_hook<>,
+	&range_seg_t::size_hook>,
+      boost::intrusive::constant_time_size<true>>;
+  range_size_tree_t range_size_tree;
+
+  const int64_t num_total;   ///< device size
+  const uint64_t block_size; ///< block size
+  uint64_t num_free = 0;     ///< total bytes in freelist
+
+  /*
+   * This value defines the number of elements in the lbas array.
+   * The value of 64 was chosen to cover all power of 2 buckets
+   * up to UINT64_MAX.
+   */
+  static constexpr unsigned MAX_LBAS = 64;
+  /// first-fit cursor per alignment bucket
+  uint64_t lbas[MAX_LBAS] = {0};
+
+  /*
+   * Minimum size which forces the dynamic allocator to change
+   * it's allocation strategy.  Once the allocator cannot satisfy
+   * an allocation of this size then it switches to using more
+   * aggressive strategy (i.e search by size rather than offset).
+   */
+  uint64_t range_size_alloc_threshold = 0;
+  /*
+   * The minimum free space, in percent, which must be available
+   * in allocator to continue allocations in a first-fit fashion.
+   * Once the allocator's free space drops below this level we dynamically
+   * switch to using best-fit allocations.
+   */
+  int range_size_alloc_free_pct = 0;
+
+  /*
+   * Max amount of range entries allowed. 0 - unlimited
+   */
+  uint64_t range_count_cap = 0;
+
+protected:
+  CephContext* cct;
+  ceph::mutex lock = ceph::make_mutex("AvlAllocator::lock");
+
+  uint64_t _get_free() const {
+    return num_free;
+  }
+  uint64_t _get_block_size() const {
+    return block_size;
+  }
+  int64_t _get_total() const {
+    return num_total;
+  }
+  double _get_fragmentation(uint64_t alloc_unit) const;
+  /// allocate as much of want as possible, return bytes allocated
+  uint64_t _allocate(
+    uint64_t want,
+    uint64_t unit,
+    uint64_t max_alloc_size,
+    int64_t  hint,
+    PExtentVector *extents);
+
+  void _release(const interval_set<uint64_t>& release_set);
+  void _dump() const;
+  void _dump(std::function<void(uint64_t offset, uint64_t length)> notify) const;
+  void _shutdown();
+
+  void _add_to_tree(uint64_t start, uint64_t size);
+  void _remove_from_tree(uint64_t start, uint64_t size);
+  /// remove whatever part of the range is in the tree; report the gaps
+  void _try_remove_from_tree(uint64_t start, uint64_t size,
+    std::function<void(uint64_t offset, uint64_t length)> not_found);
+  void _remove_from_tree(range_tree_t::iterator rs,
+			 uint64_t start, uint64_t end);
+
+  size_t _num_extents() const {
+    return range_tree.size();
+  }
+  /// drop the smallest extent, handing it to the descendant
+  void _spillover_smallest();
+  virtual void _spillover_range(uint64_t start, uint64_t end) {
+    // this should be overriden when range count cap is present,
+    // i.e. (range_count_cap > 0)
+    ceph_assert(false);
+  }
+};
+
+#endif
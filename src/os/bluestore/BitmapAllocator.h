@@ -36,6 +36,10 @@ public:
   }
 
   void dump() override;
+  void dump(std::function<void(uint64_t offset, uint64_t length)> notify) override
+  {
+    AllocatorLevel02<AllocatorLevel01Loose>::dump(notify);
+  }
   double get_fragmentation(uint64_t) override
   {
     return _get_fragmentation();
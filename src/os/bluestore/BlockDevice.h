@@ -160,6 +160,8 @@ public:
     CephContext* cct, const std::string& path, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv);
   virtual bool supported_bdev_label() { return true; }
   virtual bool is_rotational() { return rotational; }
+  /// writes of any length/alignment are durable once write() returns
+  virtual bool is_byte_addressable() const { return false; }
 
   virtual void aio_submit(IOContext *ioc) = 0;
 
@@ -1332,6 +1332,10 @@ int BlueFS::_read_random(
            << " 0x" << std::hex << off << "~" << len << std::dec
 	   << " from " << h->file->fnode << dendl;
 
+  if (h->file->fnode.is_envelope()) {
+    return _read_envelope(h, off, len, nullptr, out);
+  }
+
   ++h->file->num_reading;
 
   if (!h->ignore_eof &&
@@ -1378,6 +1382,10 @@ int BlueFS::_read(
            << " 0x" << std::hex << off << "~" << len << std::dec
 	   << " from " << h->file->fnode << dendl;
 
+  if (h->file->fnode.is_envelope()) {
+    return _read_envelope(h, off, len, outbl, out);
+  }
+
   ++h->file->num_reading;
 
   if (!h->ignore_eof &&
@@ -1451,11 +1459,168 @@ int BlueFS::_read(
   return ret;
 }
 
+int BlueFS::_read_physical(File *f, uint64_t off, uint64_t len, char *out)
+{
+  if (off + len > f->fnode.get_allocated()) {
+    return -ERANGE;
+  }
+  while (len > 0) {
+    uint64_t x_off = 0;
+    auto p = f->fnode.seek(off, &x_off);
+    uint64_t l = std::min(p->length - x_off, len);
+    int r = bdev[p->bdev]->read_random(p->offset + x_off, l, out,
+				       cct->_conf->bluefs_buffered_io);
+    if (r < 0) {
+      return r;
+    }
+    off += l;
+    len -= l;
+    out += l;
+  }
+  return 0;
+}
+
+int BlueFS::_read_envelope(
+  FileReader *h,         ///< [in] read from here
+  uint64_t off,          ///< [in] logical offset
+  size_t len,            ///< [in] this many bytes
+  bufferlist *outbl,     ///< [out] optional: reference the result here
+  char *out)             ///< [out] optional: or copy it here
+{
+  File *f = h->file.get();
+  ceph_assert(f->envelope_scanned);
+  ++f->num_reading;
+
+  if (off + len > f->envelope_size) {
+    len = off > f->envelope_size ? 0 : f->envelope_size - off;
+    dout(20) << __func__ << " reaching (or past) eof, len clipped to 0x"
+	     << std::hex << len << std::dec << dendl;
+  }
+  bufferptr bp;
+  if (outbl) {
+    outbl->clear();
+    if (len) {
+      bp = buffer::create(len);
+      out = bp.c_str();
+    }
+  }
+
+  int ret = 0;
+  if (len) {
+    auto p = f->envelope_map.upper_bound(off);
+    ceph_assert(p != f->envelope_map.begin());
+    --p;
+    while (len > 0) {
+      ceph_assert(p != f->envelope_map.end());
+      auto next = std::next(p);
+      uint64_t env_end = next == f->envelope_map.end() ?
+	f->envelope_size : next->first;
+      uint64_t l = std::min<uint64_t>(env_end - off, len);
+      dout(20) << __func__ << " read 0x" << std::hex << off << "~" << l
+	       << " from envelope at 0x" << p->second << std::dec << dendl;
+      int r = _read_physical(f, p->second + off - p->first, l, out);
+      ceph_assert(r == 0);
+      off += l;
+      len -= l;
+      ret += l;
+      out += l;
+      p = next;
+    }
+  }
+  if (outbl && bp.length()) {
+    outbl->append(std::move(bp));
+  }
+  dout(20) << __func__ << " got " << ret << dendl;
+  --f->num_reading;
+  return ret;
+}
+
+// Rebuild the envelope map of a file from disk.  Envelopes must follow
+// each other and carry this file's ino and current generation; the first
+// one that does not (or fails its crc) marks the end of the file.
+void BlueFS::_envelope_scan(File *f)
+{
+  f->envelope_map.clear();
+  f->envelope_size = 0;
+  f->envelope_next = 0;
+  f->envelope_scanned = true;
+
+  uint64_t allocated = f->fnode.get_allocated();
+  uint64_t phys = 0;
+  bufferptr bp = buffer::create_page_aligned(super.block_size);
+  while (phys + super.block_size <= allocated) {
+    int r = _read_physical(f, phys, super.block_size, bp.c_str());
+    if (r < 0) {
+      derr << __func__ << " " << f->fnode << " read error at 0x" << std::hex
+	   << phys << std::dec << ": " << cpp_strerror(r) << dendl;
+      break;
+    }
+    bufferlist bl;
+    bl.append(bp);
+    auto p = bl.cbegin();
+    bluefs_wal_envelope_t env;
+    if (!env.decode_header(p) ||
+	env.ino != f->fnode.ino ||
+	env.gen != f->fnode.envelope_gen ||
+	env.offset != f->envelope_size) {
+      break;
+    }
+    uint64_t disk_len = env.get_disk_len(super.block_size);
+    if (phys + disk_len > allocated) {
+      break;
+    }
+    if (disk_len > super.block_size) {
+      bufferptr full = buffer::create_page_aligned(disk_len);
+      r = _read_physical(f, phys, disk_len, full.c_str());
+      if (r < 0) {
+	break;
+      }
+      bl.clear();
+      bl.append(full);
+    }
+    uint32_t crc_len = bluefs_wal_envelope_t::HEADER_LEN + env.length;
+    bufferlist t;
+    t.substr_of(bl, 0, crc_len);
+    uint32_t crc, expected_crc = t.crc32c(-1);
+    auto q = bl.cbegin();
+    q.advance(crc_len);
+    decode(crc, q);
+    if (crc != expected_crc) {
+      dout(10) << __func__ << " bad crc at 0x" << std::hex << phys
+	       << std::dec << dendl;
+      break;
+    }
+    f->envelope_map[env.offset] = phys + bluefs_wal_envelope_t::HEADER_LEN;
+    f->envelope_size += env.length;
+    phys += disk_len;
+  }
+  f->envelope_next = phys;
+  dout(10) << __func__ << " " << f->fnode << " has "
+	   << f->envelope_map.size() << " envelopes, size 0x" << std::hex
+	   << f->envelope_size << " next 0x" << f->envelope_next << std::dec
+	   << dendl;
+}
+
+uint64_t BlueFS::_get_file_size(File *f)
+{
+  if (!f->fnode.is_envelope()) {
+    return f->fnode.size;
+  }
+  if (!f->envelope_scanned) {
+    _envelope_scan(f);
+  }
+  return f->envelope_size;
+}
+
 void BlueFS::_invalidate_cache(FileRef f, uint64_t offset, uint64_t length)
 {
   dout(10) << __func__ << " file " << f->fnode
 	   << " 0x" << std::hex << offset << "~" << length << std::dec
            << dendl;
+  if (f->fnode.is_envelope()) {
+    // offsets are logical; not worth translating for the WAL
+    return;
+  }
   if (offset & ~super.block_mask()) {
     offset &= super.block_mask();
     length = round_up_to(length, super.block_size);
@@ -2018,6 +2183,32 @@ int BlueFS::_flush_and_sync_log(std::unique_lock<ceph::mutex>& l,
   return 0;
 }
 
+void BlueFS::_dirty_file(File *f)
+{
+  f->fnode.mtime = ceph_clock_now();
+  ceph_assert(f->fnode.ino >= 1);
+  if (f->dirty_seq == 0) {
+    f->dirty_seq = log_seq + 1;
+    dirty_files[f->dirty_seq].push_back(*f);
+    dout(20) << __func__ << " dirty_seq = " << log_seq + 1
+	     << " (was clean)" << dendl;
+  } else {
+    if (f->dirty_seq != log_seq + 1) {
+      // need re-dirty, erase from list first
+      ceph_assert(dirty_files.count(f->dirty_seq));
+      auto it = dirty_files[f->dirty_seq].iterator_to(*f);
+      dirty_files[f->dirty_seq].erase(it);
+      f->dirty_seq = log_seq + 1;
+      dirty_files[f->dirty_seq].push_back(*f);
+      dout(20) << __func__ << " dirty_seq = " << log_seq + 1
+	       << " (was " << f->dirty_seq << ")" << dendl;
+    } else {
+      dout(20) << __func__ << " dirty_seq = " << log_seq + 1
+	       << " (unchanged, do nothing) " << dendl;
+    }
+  }
+}
+
 int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
 {
   dout(10) << __func__ << " " << h << " pos 0x" << std::hex << h->pos
@@ -2026,6 +2217,10 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   ceph_assert(!h->file->deleted);
   ceph_assert(h->file->num_readers.load() == 0);
 
+  if (h->file->fnode.is_envelope()) {
+    return _flush_range_envelope(h, offset, length);
+  }
+
   h->buffer_appender.flush();
 
   bool buffered;
@@ -2087,28 +2282,7 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
     }
   }
   if (must_dirty) {
-    h->file->fnode.mtime = ceph_clock_now();
-    ceph_assert(h->file->fnode.ino >= 1);
-    if (h->file->dirty_seq == 0) {
-      h->file->dirty_seq = log_seq + 1;
-      dirty_files[h->file->dirty_seq].push_back(*h->file);
-      dout(20) << __func__ << " dirty_seq = " << log_seq + 1
-	       << " (was clean)" << dendl;
-    } else {
-      if (h->file->dirty_seq != log_seq + 1) {
-        // need re-dirty, erase from list first
-        ceph_assert(dirty_files.count(h->file->dirty_seq));
-        auto it = dirty_files[h->file->dirty_seq].iterator_to(*h->file);
-        dirty_files[h->file->dirty_seq].erase(it);
-        h->file->dirty_seq = log_seq + 1;
-        dirty_files[h->file->dirty_seq].push_back(*h->file);
-        dout(20) << __func__ << " dirty_seq = " << log_seq + 1
-                 << " (was " << h->file->dirty_seq << ")" << dendl;
-      } else {
-        dout(20) << __func__ << " dirty_seq = " << log_seq + 1
-                 << " (unchanged, do nothing) " << dendl;
-      }
-    }
+    _dirty_file(h->file.get());
   }
   dout(20) << __func__ << " file now " << h->file->fnode << dendl;
 
@@ -2168,10 +2342,25 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   uint64_t bytes_written_slow = 0;
   while (length > 0) {
     uint64_t x_len = std::min(p->length - x_off, length);
+    uint64_t w_off = p->offset + x_off;
     bufferlist t;
-    t.substr_of(bl, bloff, x_len);
+    // Byte-addressable media need neither the rewrite of the partial
+    // block we already persisted nor the padding behind it.  The log
+    // (ino 1) is always padded, replay depends on it.
+    bool byte_writes = h->file->fnode.ino > 1 &&
+      bdev[p->bdev]->is_byte_addressable();
+    if (byte_writes && bloff == 0 && partial) {
+      t.substr_of(bl, partial, x_len - partial);
+      w_off += partial;
+    } else {
+      t.substr_of(bl, bloff, x_len);
+    }
     unsigned tail = x_len & ~super.block_mask();
-    if (tail) {
+    if (tail && byte_writes) {
+      dout(20) << __func__ << " caching tail of 0x"
+	       << std::hex << tail << std::dec << dendl;
+      h->tail_block.substr_of(bl, bl.length() - tail, tail);
+    } else if (tail) {
       size_t zlen = super.block_size - tail;
       dout(20) << __func__ << " caching tail of 0x"
                << std::hex << tail
@@ -2196,9 +2385,9 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
       }
     }
     if (cct->_conf->bluefs_sync_write) {
-      bdev[p->bdev]->write(p->offset + x_off, t, buffered, h->write_hint);
+      bdev[p->bdev]->write(w_off, t, buffered, h->write_hint);
     } else {
-      bdev[p->bdev]->aio_write(p->offset + x_off, t, h->iocv[p->bdev], buffered, h->write_hint);
+      bdev[p->bdev]->aio_write(w_off, t, h->iocv[p->bdev], buffered, h->write_hint);
     }
     h->dirty_devs[p->bdev] = true;
     if (p->bdev == BDEV_SLOW) {
@@ -2223,6 +2412,123 @@ int BlueFS::_flush_range(FileWriter *h, uint64_t offset, uint64_t length)
   return 0;
 }
 
+// Write one envelope holding the next length bytes of the buffer.  The
+// file is only dirtied when it has to grow; a sync that fits in the space
+// already allocated is a single data write with no BlueFS log update.
+int BlueFS::_flush_range_envelope(FileWriter *h, uint64_t offset,
+				  uint64_t length)
+{
+  h->buffer_appender.flush();
+
+  if (offset + length <= h->pos)
+    return 0;
+  if (offset < h->pos) {
+    length -= h->pos - offset;
+    offset = h->pos;
+  }
+  // envelopes are appended in order; there is no overwrite
+  ceph_assert(offset == h->pos);
+  ceph_assert(length <= h->buffer.length());
+  ceph_assert(h->file->envelope_scanned);
+
+  File *f = h->file.get();
+  bluefs_wal_envelope_t env;
+  env.length = length;
+  env.ino = f->fnode.ino;
+  env.gen = f->fnode.envelope_gen;
+  env.offset = offset;
+
+  bufferlist bl;
+  env.encode_header(bl);
+  if (length == h->buffer.length()) {
+    bl.claim_append(h->buffer);
+  } else {
+    bufferlist t;
+    h->buffer.splice(0, length, &t);
+    bl.claim_append(t);
+  }
+  uint32_t crc = bl.crc32c(-1);
+  encode(crc, bl);
+  uint64_t used_len = bl.length();
+  uint64_t disk_len = env.get_disk_len(super.block_size);
+  bl.append_zero(disk_len - bl.length());
+
+  uint64_t phys = f->envelope_next;
+  uint64_t allocated = f->fnode.get_allocated();
+  if (allocated < phys + disk_len) {
+    // grow in large steps so that allocations (and with them log
+    // updates) stay rare
+    uint64_t want = std::max<uint64_t>(
+      phys + disk_len - allocated,
+      cct->_conf.get_val<Option::size_t>("bluefs_wal_envelope_alloc_size"));
+    int r = _allocate(f->fnode.prefer_bdev, want, &f->fnode);
+    if (r < 0 && want > phys + disk_len - allocated) {
+      r = _allocate(f->fnode.prefer_bdev, phys + disk_len - allocated,
+		    &f->fnode);
+    }
+    if (r < 0) {
+      derr << __func__ << " allocated: 0x" << std::hex << allocated
+	   << " need: 0x" << phys + disk_len << std::dec << dendl;
+      ceph_abort_msg("bluefs enospc");
+      return r;
+    }
+    _dirty_file(f);
+  }
+
+  logger->inc(l_bluefs_bytes_written_wal, length);
+
+  uint64_t x_off = 0;
+  auto p = f->fnode.seek(phys, &x_off);
+  ceph_assert(p != f->fnode.extents.end());
+  uint64_t bloff = 0;
+  uint64_t left = disk_len;
+  uint64_t bytes_written_slow = 0;
+  while (left > 0) {
+    ceph_assert(p != f->fnode.extents.end());
+    uint64_t x_len = std::min(p->length - x_off, left);
+    uint64_t w_len = x_len;
+    if (bdev[p->bdev]->is_byte_addressable()) {
+      // the padding is never read back, leave it out
+      w_len = bloff < used_len ? std::min(x_len, used_len - bloff) : 0;
+    }
+    if (w_len) {
+      bufferlist t;
+      t.substr_of(bl, bloff, w_len);
+      if (cct->_conf->bluefs_sync_write) {
+	bdev[p->bdev]->write(p->offset + x_off, t,
+			     cct->_conf->bluefs_buffered_io, h->write_hint);
+      } else {
+	bdev[p->bdev]->aio_write(p->offset + x_off, t, h->iocv[p->bdev],
+				 cct->_conf->bluefs_buffered_io, h->write_hint);
+      }
+      h->dirty_devs[p->bdev] = true;
+      if (p->bdev == BDEV_SLOW) {
+	bytes_written_slow += t.length();
+      }
+    }
+    bloff += x_len;
+    left -= x_len;
+    ++p;
+    x_off = 0;
+  }
+  logger->inc(l_bluefs_bytes_written_slow, bytes_written_slow);
+  for (unsigned i = 0; i < MAX_BDEV; ++i) {
+    if (bdev[i]) {
+      if (h->iocv[i] && h->iocv[i]->has_pending_aios()) {
+        bdev[i]->aio_submit(h->iocv[i]);
+      }
+    }
+  }
+
+  f->envelope_map[offset] = phys + bluefs_wal_envelope_t::HEADER_LEN;
+  f->envelope_next = phys + disk_len;
+  f->envelope_size = offset + length;
+  h->pos = offset + length;
+  dout(20) << __func__ << " h " << h << " pos now 0x" << std::hex << h->pos
+	   << " envelope 0x" << phys << "~" << disk_len << std::dec << dendl;
+  return 0;
+}
+
 #ifdef HAVE_LIBAIO
 // we need to retire old completed aios so they don't stick around in
 // memory indefinitely (along with their bufferlist refs).
@@ -2271,7 +2577,8 @@ int BlueFS::_flush(FileWriter *h, bool force)
   dout(10) << __func__ << " " << h << " 0x"
            << std::hex << offset << "~" << length << std::dec
 	   << " to " << h->file->fnode << dendl;
-  ceph_assert(h->pos <= h->file->fnode.size);
+  ceph_assert(h->file->fnode.is_envelope() ||
+	      h->pos <= h->file->fnode.size);
   return _flush_range(h, offset, length);
 }
 
@@ -2304,6 +2611,16 @@ int BlueFS::_truncate(FileWriter *h, uint64_t offset)
     if (r < 0)
       return r;
   }
+  if (h->file->fnode.is_envelope()) {
+    if (offset == h->file->envelope_size) {
+      return 0;
+    }
+    // there is no way to drop envelopes without rewriting the file
+    derr << __func__ << " cannot truncate envelope file " << h->file->fnode
+	 << " from 0x" << std::hex << h->file->envelope_size << " to 0x"
+	 << offset << std::dec << dendl;
+    return -EOPNOTSUPP;
+  }
   if (offset == h->file->fnode.size) {
     return 0;  // no-op!
   }
@@ -2629,6 +2946,26 @@ int BlueFS::open_for_write(
   dout(20) << __func__ << " mapping " << dirname << "/" << filename
 	   << " to bdev " << (int)file->fnode.prefer_bdev << dendl;
 
+  bool envelope = cct->_conf.get_val<bool>("bluefs_wal_envelope_mode") &&
+    boost::algorithm::ends_with(filename, ".log");
+  if (envelope) {
+    // a new generation invalidates whatever envelopes are on disk from
+    // the previous use of this (recycled) file
+    file->fnode.type = bluefs_fnode_t::TYPE_WAL_ENVELOPE;
+    ++file->fnode.envelope_gen;
+    file->fnode.size = 0;
+    file->envelope_map.clear();
+    file->envelope_size = 0;
+    file->envelope_next = 0;
+    file->envelope_scanned = true;
+    // the new generation must be durable before the first sync returns
+    _dirty_file(file.get());
+  } else if (file->fnode.is_envelope()) {
+    file->fnode.type = bluefs_fnode_t::TYPE_NORMAL;
+    file->envelope_map.clear();
+    file->envelope_scanned = false;
+  }
+
   log_t.op_file_update(file->fnode);
   if (create)
     log_t.op_dir_link(dirname, filename, file->fnode.ino);
@@ -2700,6 +3037,9 @@ int BlueFS::open_for_read(
     return -ENOENT;
   }
   File *file = q->second.get();
+  if (file->fnode.is_envelope() && !file->envelope_scanned) {
+    _envelope_scan(file);
+  }
 
   *h = new FileReader(file, random ? 4096 : cct->_conf->bluefs_max_prefetch,
 		      random, false);
@@ -2820,7 +3160,7 @@ int BlueFS::stat(const string& dirname, const string& filename,
   dout(10) << __func__ << " " << dirname << "/" << filename
 	   << " " << file->fnode << dendl;
   if (size)
-    *size = file->fnode.size;
+    *size = _get_file_size(file);
   if (mtime)
     *mtime = file->fnode.mtime;
   return 0;
@@ -83,6 +83,13 @@ public:
     std::atomic_int num_readers, num_writers;
     std::atomic_int num_reading;
 
+    // envelope mode only (fnode.is_envelope()); see bluefs_wal_envelope_t
+    bool envelope_scanned = false;  ///< below is valid
+    uint64_t envelope_size = 0;     ///< logical file size
+    uint64_t envelope_next = 0;     ///< physical offset of the next envelope
+    /// logical offset -> physical offset of each envelope's payload
+    mempool::bluefs::map<uint64_t,uint64_t> envelope_map;
+
     File()
       : RefCountedObject(NULL, 0),
 	refs(0),
@@ -308,7 +315,9 @@ private:
   int _allocate_without_fallback(uint8_t id, uint64_t len,
 				 PExtentVector* extents);
 
+  void _dirty_file(File *f);
   int _flush_range(FileWriter *h, uint64_t offset, uint64_t length);
+  int _flush_range_envelope(FileWriter *h, uint64_t offset, uint64_t length);
   int _flush(FileWriter *h, bool force);
   int _fsync(FileWriter *h, std::unique_lock<ceph::mutex>& l);
 
@@ -362,6 +371,16 @@ private:
     size_t len,      ///< [in] this many bytes
     char *out);      ///< [out] optional: or copy it here
 
+  int _read_physical(File *f, uint64_t offset, uint64_t len, char *out);
+  int _read_envelope(
+    FileReader *h,   ///< [in] read from here
+    uint64_t offset, ///< [in] logical offset
+    size_t len,      ///< [in] this many bytes
+    bufferlist *outbl,   ///< [out] optional: reference the result here
+    char *out);      ///< [out] optional: or copy it here
+  void _envelope_scan(File *f);
+  uint64_t _get_file_size(File *f);
+
   void _invalidate_cache(FileRef f, uint64_t offset, uint64_t length);
 
   int _open_super();
@@ -235,6 +235,9 @@ class BlueRocksWritableFile : public rocksdb::WritableFile {
    * Get the size of valid data in the file.
    */
   uint64_t GetFileSize() override {
+    if (h->file->fnode.is_envelope()) {
+      return h->get_effective_write_pos();
+    }
     return h->file->fnode.size + h->buffer.length();;
   }
 
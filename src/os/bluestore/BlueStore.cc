@@ -30,6 +30,7 @@
 #include "common/errno.h"
 #include "common/safe_io.h"
 #include "common/PriorityCache.h"
+#include "common/Thread.h"
 #include "Allocator.h"
 #include "FreelistManager.h"
 #include "BlueFS.h"
@@ -39,6 +40,7 @@
 #include "perfglue/heap_profiler.h"
 #include "common/blkdev.h"
 #include "common/numa.h"
+#include "os/TransactionTrace.h"
 
 #define dout_context cct
 #define dout_subsys ceph_subsys_bluestore
@@ -75,6 +77,7 @@ const string PREFIX_DEFERRED = "L";    // id -> deferred_transaction_t
 const string PREFIX_ALLOC = "B";       // u64 offset -> u64 length (freelist)
 const string PREFIX_ALLOC_BITMAP = "b";// (see BitmapFreelistManager)
 const string PREFIX_SHARED_BLOB = "X"; // u64 offset -> shared_blob_t
+const string PREFIX_ALLOC_IMAGE = "a"; // u32 chunk -> free extents (+ header)
 
 const string BLUESTORE_GLOBAL_STATFS_KEY = "bluestore_statfs";
 
@@ -565,6 +568,19 @@ static void get_omap_tail(uint64_t id, string *out)
   out->push_back('~');
 }
 
+// confine an iterator to one object's omap so it stops at the tail
+// rather than stepping over the tombstones of removed neighbours
+static KeyValueDB::IteratorBounds get_omap_bounds(uint64_t id)
+{
+  KeyValueDB::IteratorBounds bounds;
+  string head, tail;
+  get_omap_header(id, &head);
+  get_omap_tail(id, &tail);
+  bounds.lower_bound = std::move(head);
+  bounds.upper_bound = std::move(tail);
+  return bounds;
+}
+
 static void get_deferred_key(uint64_t seq, string *out)
 {
   _key_encode_u64(seq, out);
@@ -833,6 +849,8 @@ BlueStore::Cache *BlueStore::Cache::create(CephContext* cct, string type,
 void BlueStore::Cache::trim(uint64_t onode_max, uint64_t buffer_max)
 {
   std::lock_guard l(lock);
+  onode_ghost.set_max_bytes(onode_max * PriorityCache::GHOST_RATIO);
+  buffer_ghost.set_max_bytes(buffer_max * PriorityCache::GHOST_RATIO);
   _trim(onode_max, buffer_max);
 }
 
@@ -842,6 +860,118 @@ void BlueStore::Cache::trim_all()
   _trim(0, 0);
 }
 
+// buffers are remembered by the 64k pieces of their blob they covered
+static const unsigned BUFFER_GHOST_SHIFT = 16;
+
+static uint64_t buffer_ghost_key(BlueStore::BufferSpace *space, uint32_t offset)
+{
+  return reinterpret_cast<uintptr_t>(space) ^
+    ((uint64_t)(offset >> BUFFER_GHOST_SHIFT) * 0x9e3779b97f4a7c15ull);
+}
+
+void BlueStore::Cache::_ghost_onode(Onode *o)
+{
+  if (!track_misses)
+    return;
+  onode_ghost.insert(std::hash<ghobject_t>()(o->oid), 1);
+}
+
+void BlueStore::Cache::_ghost_buffer(Buffer *b)
+{
+  if (!track_misses)
+    return;
+  uint32_t pos = b->offset;
+  uint32_t end = b->end();
+  while (pos < end) {
+    uint32_t next = p2align<uint32_t>(pos, 1u << BUFFER_GHOST_SHIFT) +
+      (1u << BUFFER_GHOST_SHIFT);
+    next = std::min(next, end);
+    buffer_ghost.insert(buffer_ghost_key(b->space, pos), next - pos);
+    pos = next;
+  }
+}
+
+void BlueStore::Cache::_note_buffer_miss(BufferSpace *space, uint32_t offset)
+{
+  if (buffer_ghost.erase(buffer_ghost_key(space, offset))) {
+    buffer_miss_stats.ghost_hits++;
+  }
+}
+
+void BlueStore::Cache::_note_onode_miss(const ghobject_t& oid, double seconds)
+{
+  if (onode_ghost.erase(std::hash<ghobject_t>()(oid))) {
+    onode_miss_stats.ghost_hits++;
+  }
+  onode_miss_stats.misses++;
+  onode_miss_stats.miss_time += seconds;
+}
+
+void BlueStore::Cache::note_buffer_misses(unsigned n, double seconds)
+{
+  std::lock_guard l(lock);
+  buffer_miss_stats.misses += n;
+  buffer_miss_stats.miss_time += seconds;
+}
+
+void BlueStore::Cache::add_miss_stats(PriorityCache::MissStats *onode,
+				      PriorityCache::MissStats *buffer)
+{
+  std::lock_guard l(lock);
+  *onode += onode_miss_stats;
+  onode->ghost_bytes += onode_ghost.get_bytes();
+  *buffer += buffer_miss_stats;
+  buffer->ghost_bytes += buffer_ghost.get_bytes();
+}
+
+void BlueStore::Cache::_trim_onodes(onode_lru_list_t& onode_lru,
+				    uint64_t onode_max)
+{
+  if (onode_max >= onode_lru.size()) {
+    return; // don't even try
+  }
+  uint64_t num = onode_lru.size() - onode_max;
+
+  // walk each onode that is on the lru now exactly once.  onodes hit
+  // since the last trim get a second chance at the front; that is the
+  // lru reordering the lookup path skipped to stay off our lock.
+  uint64_t to_visit = onode_lru.size();
+  auto p = onode_lru.end();
+  --p;
+  int skipped = 0;
+  int max_skipped = g_conf()->bluestore_cache_trim_max_skip_pinned;
+  while (num > 0 && to_visit > 0) {
+    Onode *o = &*p;
+    --to_visit;
+    auto next = to_visit ? std::prev(p) : p;
+    if (o->lru_touched.exchange(false, std::memory_order_relaxed)) {
+      dout(30) << __func__ << "  " << o->oid << " touched, requeue" << dendl;
+      onode_lru.erase(p);
+      onode_lru.push_front(*o);
+      p = next;
+      continue;
+    }
+    OnodeRef ref = o->c->onode_map.trim_unpinned(o);
+    if (!ref) {
+      dout(20) << __func__ << "  " << o->oid << " has " << o->nref.load()
+	       << " refs, skipping" << dendl;
+      if (++skipped >= max_skipped) {
+        dout(20) << __func__ << " maximum skip pinned reached; stopping with "
+                 << num << " left to trim" << dendl;
+        break;
+      }
+      p = next;
+      num--;
+      continue;
+    }
+    dout(30) << __func__ << "  rm " << o->oid << dendl;
+    _ghost_onode(o);
+    onode_lru.erase(p);
+    p = next;
+    --num;
+  }
+}
+
 // LRUCache
 #undef dout_prefix
 #define dout_prefix *_dout << "bluestore.LRUCache(" << this << ") "
@@ -872,52 +1002,12 @@ void BlueStore::LRUCache::_trim(uint64_t onode_max, uint64_t buffer_max)
     Buffer *b = &*i;
     ceph_assert(b->is_clean());
     dout(20) << __func__ << " rm " << *b << dendl;
+    _ghost_buffer(b);
     b->space->_rm_buffer(this, b);
   }
 
   // onodes
-  if (onode_max >= onode_lru.size()) {
-    return; // don't even try
-  }
-  uint64_t num = onode_lru.size() - onode_max;
-
-  auto p = onode_lru.end();
-  ceph_assert(p != onode_lru.begin());
-  --p;
-  int skipped = 0;
-  int max_skipped = g_conf()->bluestore_cache_trim_max_skip_pinned;
-  while (num > 0) {
-    Onode *o = &*p;
-    int refs = o->nref.load();
-    if (refs > 1) {
-      dout(20) << __func__ << "  " << o->oid << " has " << refs
-	       << " refs, skipping" << dendl;
-      if (++skipped >= max_skipped) {
-        dout(20) << __func__ << " maximum skip pinned reached; stopping with "
-                 << num << " left to trim" << dendl;
-        break;
-      }
-
-      if (p == onode_lru.begin()) {
-        break;
-      } else {
-        p--;
-        num--;
-        continue;
-      }
-    }
-    dout(30) << __func__ << "  rm " << o->oid << dendl;
-    if (p != onode_lru.begin()) {
-      onode_lru.erase(p--);
-    } else {
-      onode_lru.erase(p);
-      ceph_assert(num == 1);
-    }
-    o->get();  // paranoia
-    o->c->onode_map.remove(o->oid);
-    o->put();
-    --num;
-  }
+  _trim_onodes(onode_lru, onode_max);
 }
 
 #ifdef DEBUG_CACHE
@@ -1123,6 +1213,7 @@ void BlueStore::TwoQCache::_trim(uint64_t onode_max, uint64_t buffer_max)
       buffer_list_bytes[BUFFER_WARM_IN] -= b->length;
       to_evict_bytes -= b->length;
       evicted += b->length;
+      _ghost_buffer(b);
       b->state = Buffer::STATE_EMPTY;
       b->data.clear();
       buffer_warm_in.erase(buffer_warm_in.iterator_to(*b));
@@ -1153,6 +1244,7 @@ void BlueStore::TwoQCache::_trim(uint64_t onode_max, uint64_t buffer_max)
       // adjust evict size before buffer goes invalid
       to_evict_bytes -= b->length;
       evicted += b->length;
+      _ghost_buffer(b);
       b->space->_rm_buffer(this, b);
     }
 
@@ -1173,49 +1265,7 @@ void BlueStore::TwoQCache::_trim(uint64_t onode_max, uint64_t buffer_max)
   }
 
   // onodes
-  if (onode_max >= onode_lru.size()) {
-    return; // don't even try
-  }
-  uint64_t num = onode_lru.size() - onode_max;
-
-  auto p = onode_lru.end();
-  ceph_assert(p != onode_lru.begin());
-  --p;
-  int skipped = 0;
-  int max_skipped = g_conf()->bluestore_cache_trim_max_skip_pinned;
-  while (num > 0) {
-    Onode *o = &*p;
-    dout(20) << __func__ << " considering " << o << dendl;
-    int refs = o->nref.load();
-    if (refs > 1) {
-      dout(20) << __func__ << "  " << o->oid << " has " << refs
-	       << " refs; skipping" << dendl;
-      if (++skipped >= max_skipped) {
-        dout(20) << __func__ << " maximum skip pinned reached; stopping with "
-                 << num << " left to trim" << dendl;
-        break;
-      }
-
-      if (p == onode_lru.begin()) {
-        break;
-      } else {
-        p--;
-        num--;
-        continue;
-      }
-    }
-    dout(30) << __func__ << " " << o->oid << " num=" << num <<" lru size="<<onode_lru.size()<< dendl;
-    if (p != onode_lru.begin()) {
-      onode_lru.erase(p--);
-    } else {
-      onode_lru.erase(p);
-      ceph_assert(num == 1);
-    }
-    o->get();  // paranoia
-    o->c->onode_map.remove(o->oid);
-    o->put();
-    --num;
-  }
+  _trim_onodes(onode_lru, onode_max);
 }
 
 #ifdef DEBUG_CACHE
@@ -1358,9 +1408,15 @@ void BlueStore::BufferSpace::read(
 {
   res.clear();
   res_intervals.clear();
+  uint32_t want_offset = offset;
   uint32_t want_bytes = length;
   uint32_t end = offset + length;
 
+  // Hits are returned as bufferptrs sharing the cached raw buffers; no
+  // data is copied.  Clean and writing buffers are never modified in
+  // place (overwrites replace them), and trimming only drops the cache's
+  // reference, so the raw stays pinned by the reader's refs until the
+  // reply has been sent.
   {
     std::lock_guard l(cache->lock);
     for (auto i = _data_lower_bound(offset);
@@ -1412,6 +1468,15 @@ void BlueStore::BufferSpace::read(
         }
       }
     }
+
+    if (cache->track_misses && res_intervals.size() < want_bytes) {
+      interval_set<uint32_t> missed;
+      missed.insert(want_offset, want_bytes);
+      missed.subtract(res_intervals);
+      for (auto p = missed.begin(); p != missed.end(); ++p) {
+	cache->_note_buffer_miss(this, p.get_start());
+      }
+    }
   }
 
   uint64_t hit_bytes = res_intervals.size();
@@ -1508,9 +1573,15 @@ void BlueStore::BufferSpace::split(Cache* cache, size_t pos, BlueStore::BufferSp
 #undef dout_prefix
 #define dout_prefix *_dout << "bluestore.OnodeSpace(" << this << " in " << cache << ") "
 
-BlueStore::OnodeRef BlueStore::OnodeSpace::add(const ghobject_t& oid, OnodeRef o)
+BlueStore::OnodeRef BlueStore::OnodeSpace::add(const ghobject_t& oid,
+					       OnodeRef o,
+					       double miss_seconds)
 {
   std::lock_guard l(cache->lock);
+  if (miss_seconds >= 0) {
+    cache->_note_onode_miss(oid, miss_seconds);
+  }
+  std::unique_lock ml(map_lock);
   auto p = onode_map.find(oid);
   if (p != onode_map.end()) {
     ldout(cache->cct, 30) << __func__ << " " << oid << " " << o
@@ -1529,32 +1600,53 @@ BlueStore::OnodeRef BlueStore::OnodeSpace::lookup(const ghobject_t& oid)
   ldout(cache->cct, 30) << __func__ << dendl;
   OnodeRef o;
   bool hit = false;
+  PerfCounters *logger;
 
   {
-    std::lock_guard l(cache->lock);
+    std::shared_lock l(map_lock);
+    logger = cache->logger;
     ceph::unordered_map<ghobject_t,OnodeRef>::iterator p = onode_map.find(oid);
     if (p == onode_map.end()) {
       ldout(cache->cct, 30) << __func__ << " " << oid << " miss" << dendl;
     } else {
       ldout(cache->cct, 30) << __func__ << " " << oid << " hit " << p->second
 			    << dendl;
-      cache->_touch_onode(p->second);
+      // avoid dirtying the cacheline on every hit of a hot onode
+      if (!p->second->lru_touched.load(std::memory_order_relaxed)) {
+	p->second->lru_touched.store(true, std::memory_order_relaxed);
+      }
       hit = true;
       o = p->second;
     }
   }
 
   if (hit) {
-    cache->logger->inc(l_bluestore_onode_hits);
+    logger->inc(l_bluestore_onode_hits);
   } else {
-    cache->logger->inc(l_bluestore_onode_misses);
+    logger->inc(l_bluestore_onode_misses);
   }
   return o;
 }
 
+BlueStore::OnodeRef BlueStore::OnodeSpace::trim_unpinned(Onode *o)
+{
+  // lookup takes its ref under the shared lock, so with the lock held
+  // exclusively a single ref means only the map still knows about o
+  std::unique_lock l(map_lock);
+  if (o->nref.load() > 1) {
+    return OnodeRef();
+  }
+  auto p = onode_map.find(o->oid);
+  ceph_assert(p != onode_map.end());
+  OnodeRef ref = std::move(p->second);
+  onode_map.erase(p);
+  return ref;
+}
+
 void BlueStore::OnodeSpace::clear()
 {
   std::lock_guard l(cache->lock);
+  std::unique_lock ml(map_lock);
   ldout(cache->cct, 10) << __func__ << dendl;
   for (auto &p : onode_map) {
     cache->_rm_onode(p.second);
@@ -1564,7 +1656,7 @@ void BlueStore::OnodeSpace::clear()
 
 bool BlueStore::OnodeSpace::empty()
 {
-  std::lock_guard l(cache->lock);
+  std::shared_lock l(map_lock);
   return onode_map.empty();
 }
 
@@ -1575,6 +1667,7 @@ void BlueStore::OnodeSpace::rename(
   const mempool::bluestore_cache_other::string& new_okey)
 {
   std::lock_guard l(cache->lock);
+  std::unique_lock ml(map_lock);
   ldout(cache->cct, 30) << __func__ << " " << old_oid << " -> " << new_oid
 			<< dendl;
   ceph::unordered_map<ghobject_t,OnodeRef>::iterator po, pn;
@@ -1605,7 +1698,7 @@ void BlueStore::OnodeSpace::rename(
 
 bool BlueStore::OnodeSpace::map_any(std::function<bool(OnodeRef)> f)
 {
-  std::lock_guard l(cache->lock);
+  std::shared_lock l(map_lock);
   ldout(cache->cct, 20) << __func__ << dendl;
   for (auto& i : onode_map) {
     if (f(i.second)) {
@@ -2804,6 +2897,10 @@ void BlueStore::ExtentMap::fault_range(
   auto cct = onode->c->store->cct; //used by dout
   dout(30) << __func__ << " 0x" << std::hex << offset << "~" << length
 	   << std::dec << dendl;
+  if (shards.empty()) {
+    load_inline();
+    return;
+  }
   auto start = seek_shard(offset);
   auto last = seek_shard(offset + length);
 
@@ -2856,6 +2953,7 @@ void BlueStore::ExtentMap::dirty_range(
 	   << std::dec << dendl;
   if (shards.empty()) {
     dout(20) << __func__ << " mark inline shard dirty" << dendl;
+    load_inline();
     inline_bl.clear();
     return;
   }
@@ -3416,7 +3514,14 @@ BlueStore::OnodeRef BlueStore::Collection::get_onode(
 			<< pretty_binary_string(key) << dendl;
 
   bufferlist v;
+  // the miss is noted when the onode is added, under the lock add takes
+  const bool track_misses = cache->track_misses;
+  mono_clock::time_point start;
+  if (track_misses)
+    start = mono_clock::now();
   int r = store->db->get(PREFIX_OBJ, key.c_str(), key.size(), &v);
+  double miss_seconds = track_misses ?
+    std::chrono::duration<double>(mono_clock::now() - start).count() : -1;
   ldout(store->cct, 20) << " r " << r << " v.len " << v.length() << dendl;
   Onode *on;
   if (v.length() == 0) {
@@ -3438,19 +3543,21 @@ BlueStore::OnodeRef BlueStore::Collection::get_onode(
       i.second.reassign_to_mempool(mempool::mempool_bluestore_cache_other);
     }
 
-    // initialize extent_map
+    // initialize extent_map.  the inline map is only decoded once a read
+    // or write faults it in, so that attr and stat lookups don't pay
+    // for it.
     on->extent_map.decode_spanning_blobs(p);
     if (on->onode.extent_map_shards.empty()) {
       denc(on->extent_map.inline_bl, p);
-      on->extent_map.decode_some(on->extent_map.inline_bl);
       on->extent_map.inline_bl.reassign_to_mempool(
 	mempool::mempool_bluestore_cache_other);
+      on->extent_map.inline_pending = true;
     } else {
       on->extent_map.init_shards(false, false);
     }
   }
   o.reset(on);
-  return onode_map.add(oid, o);
+  return onode_map.add(oid, o, miss_seconds);
 }
 
 void BlueStore::Collection::split_cache(
@@ -3462,6 +3569,8 @@ void BlueStore::Collection::split_cache(
   std::lock(cache->lock, dest->cache->lock);
   std::lock_guard l(cache->lock, std::adopt_lock);
   std::lock_guard l2(dest->cache->lock, std::adopt_lock);
+  std::unique_lock ml(onode_map.map_lock);
+  std::unique_lock ml2(dest->onode_map.map_lock);
 
   int destbits = dest->cnode.bits;
   spg_t destpg;
@@ -3558,6 +3667,9 @@ void *BlueStore::MempoolThread::entry()
     pcm->insert("kv", binned_kv_cache);
     pcm->insert("meta", meta_cache);
     pcm->insert("data", data_cache);
+    for (auto& c : other_caches) {
+      pcm->insert(c.first, c.second);
+    }
   }
 
   utime_t next_balance = ceph_clock_now();
@@ -3610,6 +3722,15 @@ void BlueStore::MempoolThread::_adjust_cache_settings()
   }
   meta_cache->set_cache_ratio(store->cache_meta_ratio);
   data_cache->set_cache_ratio(store->cache_data_ratio);
+  double max_miss_weight = store->cct->_conf.get_val<double>(
+    "bluestore_cache_autotune_max_miss_weight");
+  if (pcm != nullptr) {
+    pcm->set_max_miss_weight(max_miss_weight);
+  }
+  bool track_misses = pcm != nullptr && max_miss_weight > 1.0;
+  for (auto i : store->cache_shards) {
+    i->track_misses = track_misses;
+  }
 }
 
 void BlueStore::MempoolThread::_trim_shards(bool interval_stats)
@@ -3668,6 +3789,138 @@ void BlueStore::MempoolThread::_trim_shards(bool interval_stats)
 
 // =======================================================
 
+// DefragThread
+
+#undef dout_prefix
+#define dout_prefix *_dout << "bluestore.DefragThread(" << this << ") "
+
+void *BlueStore::DefragThread::entry()
+{
+  CephContext *cct = store->cct;
+  std::unique_lock l(lock);
+  while (!stop) {
+    if (cct->_conf.get_val<bool>("bluestore_defrag_enable")) {
+      _pass(l);
+    }
+    if (stop) {
+      break;
+    }
+    auto wait = ceph::make_timespan(
+      cct->_conf.get_val<double>("bluestore_defrag_interval"));
+    cond.wait_for(l, wait);
+  }
+  stop = false;
+  return NULL;
+}
+
+void BlueStore::DefragThread::_pass(std::unique_lock<ceph::mutex>& l)
+{
+  CephContext *cct = store->cct;
+  vector<CollectionRef> colls;
+  {
+    RWLock::RLocker cl(store->coll_lock);
+    colls.reserve(store->coll_map.size());
+    for (auto& p : store->coll_map) {
+      colls.push_back(p.second);
+    }
+  }
+
+  running = true;
+  ++passes;
+  pass_start = ceph_clock_now();
+  colls_total = colls.size();
+  colls_done = 0;
+  objects_scanned = 0;
+  objects_rewritten = 0;
+  objects_failed = 0;
+  bytes_rewritten = 0;
+  ldout(cct, 5) << __func__ << " start pass " << passes << " over "
+		<< colls_total << " collections" << dendl;
+
+  for (auto& c : colls) {
+    current_coll = c->cid;
+    ghobject_t next;
+    while (!stop &&
+	   cct->_conf.get_val<bool>("bluestore_defrag_enable")) {
+      vector<ghobject_t> ls;
+      ghobject_t start = next;
+      l.unlock();
+      {
+	RWLock::RLocker cl(c->lock);
+	if (c->exists) {
+	  store->_collection_list(c.get(), start, ghobject_t::get_max(),
+				  100, &ls, &next);
+	}
+      }
+      l.lock();
+      for (auto& oid : ls) {
+	if (stop) {
+	  break;
+	}
+	l.unlock();
+	int64_t r = store->_defrag_object(c, oid);
+	l.lock();
+	++objects_scanned;
+	if (r < 0) {
+	  ++objects_failed;
+	  continue;
+	}
+	if (r == 0) {
+	  continue;
+	}
+	++objects_rewritten;
+	bytes_rewritten += r;
+	// rate limit by sleeping off what we just wrote
+	uint64_t rate =
+	  cct->_conf.get_val<Option::size_t>("bluestore_defrag_bytes_per_sec");
+	if (rate) {
+	  cond.wait_for(l, ceph::make_timespan((double)r / rate));
+	}
+      }
+      if (ls.empty() || next == ghobject_t::get_max()) {
+	break;
+      }
+    }
+    if (stop) {
+      break;
+    }
+    ++colls_done;
+  }
+
+  running = false;
+  current_coll = coll_t();
+  last_pass_duration = ceph_clock_now() - pass_start;
+  ldout(cct, 5) << __func__ << " pass " << passes << " rewrote "
+		<< objects_rewritten << "/" << objects_scanned << " objects, "
+		<< byte_u_t(bytes_rewritten) << " in " << last_pass_duration
+		<< "s, " << objects_failed << " objects failed to read"
+		<< dendl;
+}
+
+void BlueStore::DefragThread::dump(Formatter *f)
+{
+  std::lock_guard l(lock);
+  f->open_object_section("defrag");
+  f->dump_bool("enabled",
+	       store->cct->_conf.get_val<bool>("bluestore_defrag_enable"));
+  f->dump_bool("running", running);
+  f->dump_unsigned("passes", passes);
+  f->dump_stream("pass_start") << pass_start;
+  f->dump_float("last_pass_duration", last_pass_duration);
+  if (running) {
+    f->dump_stream("current_collection") << current_coll;
+  }
+  f->dump_unsigned("collections_total", colls_total);
+  f->dump_unsigned("collections_done", colls_done);
+  f->dump_unsigned("objects_scanned", objects_scanned);
+  f->dump_unsigned("objects_rewritten", objects_rewritten);
+  f->dump_unsigned("objects_failed", objects_failed);
+  f->dump_unsigned("bytes_rewritten", bytes_rewritten);
+  f->close_section();
+}
+
+// =======================================================
+
 // OmapIteratorImpl
 
 #undef dout_prefix
@@ -3849,8 +4102,10 @@ BlueStore::BlueStore(CephContext *cct, const string& path)
     deferred_finisher(cct, "defered_finisher", "dfin"),
     finisher(cct, "commit_finisher", "cfin"),
     kv_sync_thread(this),
+    kv_commit_thread(this),
     kv_finalize_thread(this),
-    mempool_thread(this)
+    mempool_thread(this),
+    defrag_thread(this)
 {
   _init_logger();
   cct->_conf.add_observer(this);
@@ -3869,10 +4124,12 @@ BlueStore::BlueStore(CephContext *cct,
     deferred_finisher(cct, "defered_finisher", "dfin"),
     finisher(cct, "commit_finisher", "cfin"),
     kv_sync_thread(this),
+    kv_commit_thread(this),
     kv_finalize_thread(this),
     min_alloc_size(_min_alloc_size),
     min_alloc_size_order(ctz(_min_alloc_size)),
-    mempool_thread(this)
+    mempool_thread(this),
+    defrag_thread(this)
 {
   _init_logger();
   cct->_conf.add_observer(this);
@@ -3907,6 +4164,7 @@ const char **BlueStore::get_tracked_conf_keys() const
     "bluestore_compression_max_blob_size_ssd",
     "bluestore_compression_max_blob_size_hdd",
     "bluestore_compression_required_ratio",
+    "bluestore_compression_frame_size",
     "bluestore_max_alloc_size",
     "bluestore_prefer_deferred_size",
     "bluestore_prefer_deferred_size_hdd",
@@ -3930,6 +4188,8 @@ const char **BlueStore::get_tracked_conf_keys() const
     "bluestore_cache_autotune_interval",
     "bluestore_no_per_pool_stats_tolerance",
     "bluestore_warn_on_legacy_statfs",
+    "bluestore_defrag_enable",
+    "bluestore_debug_transaction_trace",
     NULL
   };
   return KEYS;
@@ -3946,10 +4206,18 @@ void BlueStore::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("bluestore_csum_type")) {
     _set_csum();
   }
+  if (changed.count("bluestore_defrag_enable")) {
+    defrag_thread.wakeup();
+  }
+  if (changed.count("bluestore_debug_transaction_trace") && mounted) {
+    _set_transaction_trace(
+      conf.get_val<std::string>("bluestore_debug_transaction_trace"));
+  }
   if (changed.count("bluestore_compression_mode") ||
       changed.count("bluestore_compression_algorithm") ||
       changed.count("bluestore_compression_min_blob_size") ||
-      changed.count("bluestore_compression_max_blob_size")) {
+      changed.count("bluestore_compression_max_blob_size") ||
+      changed.count("bluestore_compression_frame_size")) {
     if (bdev) {
       _set_compression();
     }
@@ -4010,6 +4278,8 @@ void BlueStore::_set_compression()
   }
 
   compressor = nullptr;
+  // pools may enable compression on their own, keep framing up to date
+  comp_frame_size = cct->_conf->bluestore_compression_frame_size;
 
   if (comp_mode == Compressor::COMP_NONE) {
     dout(10) << __func__ << " compression mode set to 'none', "
@@ -4053,6 +4323,7 @@ void BlueStore::_set_compression()
 	   << " alg " << (compressor ? compressor->get_type_name() : "(none)")
 	   << " min_blob " << comp_min_blob_size
 	   << " max_blob " << comp_max_blob_size
+	   << " frame " << comp_frame_size
 	   << dendl;
 }
 
@@ -4209,6 +4480,51 @@ int BlueStore::read_meta(const std::string& key, std::string *value)
   return 0;
 }
 
+// state latency x txc size, first is the prepare state histogram and
+// the rest follow in state order
+static void add_state_histograms(PerfCountersBuilder& b, int first)
+{
+  // latency axis, values are in nanoseconds
+  PerfHistogramCommon::axis_config_d lat_axis{
+    "Latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Latency in logarithmic scale
+    0,                               ///< Start at 0
+    1000,                            ///< Quantization unit is 1usec
+    32,                              ///< Enough to cover over 30 minutes
+  };
+  // size axis, values are in bytes
+  PerfHistogramCommon::axis_config_d size_axis{
+    "Transaction size (bytes)",
+    PerfHistogramCommon::SCALE_LOG2, ///< Size in logarithmic scale
+    0,                               ///< Start at 0
+    512,                             ///< Quantization unit is 512 bytes
+    32,                              ///< Enough to cover txcs larger than GB
+  };
+  static const char *states[] = {
+    "prepare", "aio_wait", "io_done", "kv_queued", "kv_commiting",
+    "kv_done", "deferred_queued", "deferred_aio_wait", "deferred_cleanup",
+    "finishing", "done",
+  };
+  static_assert(std::size(states) ==
+		l_bluestore_state_done_lat - l_bluestore_state_prepare_lat + 1);
+  // the names and descriptions must outlive the builder
+  static std::vector<std::pair<string,string>> names = [] {
+    std::vector<std::pair<string,string>> v;
+    for (auto state : states) {
+      v.emplace_back(
+	string("state_") + state + "_lat_hist",
+	string("Histogram of ") + state + " state latency + transaction size");
+    }
+    return v;
+  }();
+  for (unsigned i = 0; i < names.size(); ++i) {
+    b.add_u64_counter_histogram(
+      first + i, names[i].first.c_str(),
+      lat_axis, size_axis,
+      names[i].second.c_str());
+  }
+}
+
 void BlueStore::_init_logger()
 {
   PerfCountersBuilder b(cct, "bluestore",
@@ -4224,6 +4540,10 @@ void BlueStore::_init_logger()
   b.add_time_avg(l_bluestore_kv_final_lat, "kv_final_lat",
 		 "Average kv_finalize thread latency",
 		 "kf_l", PerfCountersBuilder::PRIO_INTERESTING);
+  b.add_time_avg(l_bluestore_kv_submit_lat, "kv_submit_lat",
+		 "Average kv_sync thread latency of the non-sync kv submits");
+  b.add_time_avg(l_bluestore_kv_pipeline_wait_lat, "kv_pipeline_wait_lat",
+		 "Average time a submitted commit group waits for kv_commit thread");
   b.add_time_avg(l_bluestore_state_prepare_lat, "state_prepare_lat",
     "Average prepare state latency");
   b.add_time_avg(l_bluestore_state_aio_wait_lat, "state_aio_wait_lat",
@@ -4363,10 +4683,25 @@ void BlueStore::_init_logger()
     "Average omap iterator lower_bound call latency");
   b.add_time_avg(l_bluestore_omap_next_lat, "omap_next_lat",
     "Average omap iterator next call latency");
+  add_state_histograms(b, l_bluestore_state_prepare_lat_hist);
   logger = b.create_perf_counters();
   cct->get_perfcounters_collection()->add(logger);
 }
 
+PerfCounters *BlueStore::_get_pool_logger(uint64_t pool)
+{
+  std::lock_guard l(pool_loggers_lock);
+  auto& p = pool_loggers[pool];
+  if (!p) {
+    PerfCountersBuilder b(cct, "bluestore-pool-" + stringify(pool),
+			  l_bluestore_pool_first, l_bluestore_pool_last);
+    add_state_histograms(b, l_bluestore_pool_state_prepare_lat_hist);
+    p = b.create_perf_counters();
+    cct->get_perfcounters_collection()->add(p);
+  }
+  return p;
+}
+
 int BlueStore::_reload_logger()
 {
   struct store_statfs_t store_statfs;
@@ -4383,6 +4718,14 @@ int BlueStore::_reload_logger()
 
 void BlueStore::_shutdown_logger()
 {
+  {
+    std::lock_guard l(pool_loggers_lock);
+    for (auto& p : pool_loggers) {
+      cct->get_perfcounters_collection()->remove(p.second);
+      delete p.second;
+    }
+    pool_loggers.clear();
+  }
   cct->get_perfcounters_collection()->remove(logger);
   delete logger;
 }
@@ -4546,7 +4889,10 @@ void BlueStore::_set_alloc_sizes(void)
     deferred_batch_ops = cct->_conf->bluestore_deferred_batch_ops;
   } else {
     ceph_assert(bdev);
-    if (_use_rotational_settings()) {
+    if (bdev->is_byte_addressable()) {
+      // writes to pmem complete synchronously; batching only adds latency
+      deferred_batch_ops = 1;
+    } else if (_use_rotational_settings()) {
       deferred_batch_ops = cct->_conf->bluestore_deferred_batch_ops_hdd;
     } else {
       deferred_batch_ops = cct->_conf->bluestore_deferred_batch_ops_ssd;
@@ -4762,6 +5108,10 @@ int BlueStore::_open_alloc()
     return -EINVAL;
   }
 
+  if (_load_alloc_image()) {
+    return 0;
+  }
+
   uint64_t num = 0, bytes = 0;
 
   dout(1) << __func__ << " opening allocation metadata" << dendl;
@@ -4786,54 +5136,221 @@ int BlueStore::_open_alloc()
   return 0;
 }
 
-void BlueStore::_close_alloc()
+// The allocator image is a header plus the free extents in chunks of
+// at most alloc_image_chunk_extents, each keyed by its u32 index.  The
+// header carries a crc32c over the chunks and the geometry it was taken
+// with; anything that does not match sends us back to the freelist.
+static const uint32_t alloc_image_chunk_extents = 65536;
+
+void BlueStore::_write_alloc_image()
 {
-  ceph_assert(bdev);
+  if (!cct->_conf.get_val<bool>("bluestore_alloc_image")) {
+    return;
+  }
+  if (!bluefs_extents_reclaiming.empty()) {
+    // that space is neither free in the allocator nor owned by bluefs
+    dout(10) << __func__ << " bluefs reclaim in progress, skipping" << dendl;
+    return;
+  }
+  auto start = mono_clock::now();
+  // releases may be held back by async discard
   bdev->discard_drain();
 
-  ceph_assert(alloc);
-  alloc->shutdown();
-  delete alloc;
-  alloc = NULL;
-  bluefs_extents.clear();
-}
-
-int BlueStore::_open_fsid(bool create)
-{
-  ceph_assert(fsid_fd < 0);
-  int flags = O_RDWR|O_CLOEXEC;
-  if (create)
-    flags |= O_CREAT;
-  fsid_fd = ::openat(path_fd, "fsid", flags, 0644);
-  if (fsid_fd < 0) {
-    int err = -errno;
-    derr << __func__ << " " << cpp_strerror(err) << dendl;
-    return err;
+  KeyValueDB::Transaction t = db->get_transaction();
+  uint32_t chunks = 0;
+  uint32_t crc = -1;
+  uint64_t num = 0, bytes = 0, in_chunk = 0;
+  bufferlist bl;
+  auto flush_chunk = [&]() {
+    string key;
+    _key_encode_u32(chunks, &key);
+    crc = bl.crc32c(crc);
+    t->set(PREFIX_ALLOC_IMAGE, key, bl);
+    bl.clear();
+    ++chunks;
+    in_chunk = 0;
+  };
+  alloc->dump([&](uint64_t offset, uint64_t length) {
+      encode(offset, bl);
+      encode(length, bl);
+      ++num;
+      bytes += length;
+      if (++in_chunk == alloc_image_chunk_extents) {
+	flush_chunk();
+      }
+    });
+  if (in_chunk) {
+    flush_chunk();
+  }
+
+  bufferlist hbl;
+  ENCODE_START(1, 1, hbl);
+  encode(chunks, hbl);
+  encode(num, hbl);
+  encode(bytes, hbl);
+  encode(bdev->get_size(), hbl);
+  encode(min_alloc_size, hbl);
+  encode(bluefs_extents, hbl);
+  encode(crc, hbl);
+  ENCODE_FINISH(hbl);
+  t->set(PREFIX_ALLOC_IMAGE, "header", hbl);
+  int r = db->submit_transaction_sync(t);
+  if (r < 0) {
+    derr << __func__ << " failed to save allocator image: "
+	 << cpp_strerror(r) << dendl;
+    return;
   }
-  return 0;
+  dout(1) << __func__ << " saved " << byte_u_t(bytes) << " in " << num
+	  << " extents (" << chunks << " chunks) in "
+	  << (mono_clock::now() - start) << dendl;
 }
 
-int BlueStore::_read_fsid(uuid_d *uuid)
+void BlueStore::_read_alloc_image()
 {
-  char fsid_str[40];
-  memset(fsid_str, 0, sizeof(fsid_str));
-  int ret = safe_read(fsid_fd, fsid_str, sizeof(fsid_str));
-  if (ret < 0) {
-    derr << __func__ << " failed: " << cpp_strerror(ret) << dendl;
-    return ret;
+  alloc_image.reset();
+  if (!cct->_conf.get_val<bool>("bluestore_alloc_image")) {
+    return;
   }
-  if (ret > 36)
-    fsid_str[36] = 0;
-  else
-    fsid_str[ret] = 0;
-  if (!uuid->parse(fsid_str)) {
-    derr << __func__ << " unparsable uuid " << fsid_str << dendl;
-    return -EINVAL;
+  bufferlist hbl;
+  int r = db->get(PREFIX_ALLOC_IMAGE, "header", &hbl);
+  if (r < 0) {
+    dout(10) << __func__ << " no allocator image" << dendl;
+    return;
   }
-  return 0;
-}
-
-int BlueStore::_write_fsid()
+  auto img = std::make_unique<alloc_image_t>();
+  try {
+    uint32_t chunks, expected_crc, crc = -1;
+    uint64_t num;
+    auto p = hbl.cbegin();
+    DECODE_START(1, p);
+    decode(chunks, p);
+    decode(num, p);
+    decode(img->free_bytes, p);
+    decode(img->bdev_size, p);
+    decode(img->min_alloc_size, p);
+    decode(img->bluefs_extents, p);
+    decode(expected_crc, p);
+    DECODE_FINISH(p);
+
+    img->extents.reserve(num);
+    for (uint32_t i = 0; i < chunks; ++i) {
+      string key;
+      _key_encode_u32(i, &key);
+      bufferlist bl;
+      r = db->get(PREFIX_ALLOC_IMAGE, key, &bl);
+      if (r < 0) {
+	derr << __func__ << " allocator image chunk " << i << " missing"
+	     << dendl;
+	return;
+      }
+      crc = bl.crc32c(crc);
+      auto q = bl.cbegin();
+      while (!q.end()) {
+	uint64_t offset, length;
+	decode(offset, q);
+	decode(length, q);
+	img->extents.emplace_back(offset, length);
+      }
+    }
+    if (crc != expected_crc || img->extents.size() != num) {
+      derr << __func__ << " allocator image is corrupt (crc 0x" << std::hex
+	   << crc << " expected 0x" << expected_crc << std::dec
+	   << ", " << img->extents.size() << "/" << num << " extents)"
+	   << dendl;
+      return;
+    }
+  } catch (buffer::error& e) {
+    derr << __func__ << " failed to decode allocator image: " << e.what()
+	 << dendl;
+    return;
+  }
+  dout(10) << __func__ << " read " << img->extents.size() << " extents"
+	   << dendl;
+  alloc_image = std::move(img);
+}
+
+bool BlueStore::_load_alloc_image()
+{
+  if (!alloc_image) {
+    return false;
+  }
+  auto img = std::move(alloc_image);
+  if (img->bdev_size != bdev->get_size() ||
+      img->min_alloc_size != min_alloc_size ||
+      !(img->bluefs_extents == bluefs_extents)) {
+    dout(1) << __func__ << " allocator image is stale, ignoring" << dendl;
+    return false;
+  }
+  auto start = mono_clock::now();
+  for (auto& e : img->extents) {
+    alloc->init_add_free(e.first, e.second);
+  }
+  if (alloc->get_free() != img->free_bytes) {
+    derr << __func__ << " allocator image has " << img->free_bytes
+	 << " free but allocator reports " << alloc->get_free()
+	 << ", rebuilding from freelist" << dendl;
+    alloc->shutdown();
+    delete alloc;
+    alloc = Allocator::create(cct, cct->_conf->bluestore_allocator,
+			      bdev->get_size(),
+			      min_alloc_size);
+    ceph_assert(alloc);
+    return false;
+  }
+  dout(1) << __func__ << " loaded " << byte_u_t(img->free_bytes)
+	  << " in " << img->extents.size() << " extents from allocator image"
+	  << " in " << (mono_clock::now() - start) << dendl;
+  return true;
+}
+
+void BlueStore::_close_alloc()
+{
+  ceph_assert(bdev);
+  bdev->discard_drain();
+
+  ceph_assert(alloc);
+  alloc->shutdown();
+  delete alloc;
+  alloc = NULL;
+  bluefs_extents.clear();
+}
+
+int BlueStore::_open_fsid(bool create)
+{
+  ceph_assert(fsid_fd < 0);
+  int flags = O_RDWR|O_CLOEXEC;
+  if (create)
+    flags |= O_CREAT;
+  fsid_fd = ::openat(path_fd, "fsid", flags, 0644);
+  if (fsid_fd < 0) {
+    int err = -errno;
+    derr << __func__ << " " << cpp_strerror(err) << dendl;
+    return err;
+  }
+  return 0;
+}
+
+int BlueStore::_read_fsid(uuid_d *uuid)
+{
+  char fsid_str[40];
+  memset(fsid_str, 0, sizeof(fsid_str));
+  int ret = safe_read(fsid_fd, fsid_str, sizeof(fsid_str));
+  if (ret < 0) {
+    derr << __func__ << " failed: " << cpp_strerror(ret) << dendl;
+    return ret;
+  }
+  if (ret > 36)
+    fsid_str[36] = 0;
+  else
+    fsid_str[ret] = 0;
+  if (!uuid->parse(fsid_str)) {
+    derr << __func__ << " unparsable uuid " << fsid_str << dendl;
+    return -EINVAL;
+  }
+  return 0;
+}
+
+int BlueStore::_write_fsid()
 {
   int r = ::ftruncate(fsid_fd, 0);
   if (r < 0) {
@@ -5296,6 +5813,9 @@ int BlueStore::_open_db(bool create, bool to_repair_db, bool read_only)
   map<string,string> kv_options;
   // force separate wal dir for all new deployments.
   kv_options["separate_wal_dir"] = 1;
+  if (db_resharding) {
+    kv_options["allow_sharding_mismatch"] = "1";
+  }
   rocksdb::Env *env = NULL;
   if (do_bluefs) {
     dout(10) << __func__ << " initializing bluefs" << dendl;
@@ -5411,14 +5931,12 @@ int BlueStore::_open_db(bool create, bool to_repair_db, bool read_only)
   if (kv_backend == "rocksdb") {
     options = cct->_conf->bluestore_rocksdb_options;
 
-    map<string,string> cf_map;
-    cct->_conf.with_val<string>("bluestore_rocksdb_cfs",
-                                 get_str_map,
-                                 &cf_map,
-                                 " \t");
-    for (auto& i : cf_map) {
-      dout(10) << "column family " << i.first << ": " << i.second << dendl;
-      cfs.push_back(KeyValueDB::ColumnFamily(i.first, i.second));
+    r = _parse_db_sharding(
+      cct->_conf.get_val<string>("bluestore_rocksdb_cfs"), &cfs);
+    if (r < 0) {
+      derr << __func__ << " invalid bluestore_rocksdb_cfs" << dendl;
+      _close_db();
+      return r;
     }
   }
 
@@ -5445,6 +5963,59 @@ int BlueStore::_open_db(bool create, bool to_repair_db, bool read_only)
   }
   dout(1) << __func__ << " opened " << kv_backend
 	  << " path " << fn << " options " << options << dendl;
+
+  if (!create) {
+    if (!alloc) {
+      _read_alloc_image();
+    }
+    if (!read_only) {
+      // the image only describes the freelist as of the last clean
+      // umount.  drop it before anything can change the freelist, so a
+      // stale image can never be loaded.
+      KeyValueDB::Transaction t = db->get_transaction();
+      t->rmkeys_by_prefix(PREFIX_ALLOC_IMAGE);
+      r = db->submit_transaction_sync(t);
+      if (r < 0) {
+	derr << __func__ << " failed to remove the allocator image: "
+	     << cpp_strerror(r) << dendl;
+	alloc_image.reset();
+	_close_db();
+	return -EIO;
+      }
+    }
+  }
+  return 0;
+}
+
+int BlueStore::_parse_db_sharding(
+  const string& spec,
+  vector<KeyValueDB::ColumnFamily> *cfs)
+{
+  map<string,string> cf_map;
+  get_str_map(spec, &cf_map, " \t");
+  for (auto& i : cf_map) {
+    // "P(n)" spreads prefix P over n column families by key hash
+    string name = i.first;
+    unsigned shards = 1;
+    auto lp = name.find('(');
+    if (lp != string::npos) {
+      if (lp == 0 || name.back() != ')') {
+	derr << __func__ << " bad column family '" << name << "'" << dendl;
+	return -EINVAL;
+      }
+      string err;
+      shards = strict_strtol(name.substr(lp + 1, name.size() - lp - 2).c_str(),
+			     10, &err);
+      if (!err.empty() || shards < 1) {
+	derr << __func__ << " bad shard count in '" << name << "'" << dendl;
+	return -EINVAL;
+      }
+      name.resize(lp);
+    }
+    dout(10) << "column family " << name << " shards " << shards
+	     << ": " << i.second << dendl;
+    cfs->push_back(KeyValueDB::ColumnFamily(name, i.second, shards));
+  }
   return 0;
 }
 
@@ -6425,6 +6996,28 @@ int BlueStore::expand_devices(ostream& out)
   return r;
 }
 
+int BlueStore::reshard_db(const string& sharding, ostream& out)
+{
+  vector<KeyValueDB::ColumnFamily> cfs;
+  int r = _parse_db_sharding(sharding, &cfs);
+  if (r < 0) {
+    out << "invalid sharding '" << sharding << "'" << std::endl;
+    return r;
+  }
+  db_resharding = true;
+  r = _mount(true);
+  db_resharding = false;
+  if (r < 0) {
+    return r;
+  }
+  r = db->reshard(cfs, out);
+  if (r < 0) {
+    out << "reshard failed: " << cpp_strerror(r) << std::endl;
+  }
+  umount();
+  return r;
+}
+
 void BlueStore::set_cache_shards(unsigned num)
 {
   dout(10) << __func__ << " " << num << dendl;
@@ -6521,8 +7114,11 @@ int BlueStore::_mount(bool kv_only, bool open_db)
     goto out_stop;
 
   mempool_thread.init();
+  defrag_thread.init();
 
   mounted = true;
+  _set_transaction_trace(
+    cct->_conf.get_val<std::string>("bluestore_debug_transaction_trace"));
   return 0;
 
  out_stop:
@@ -6545,7 +7141,12 @@ int BlueStore::umount()
   ceph_assert(_kv_only || mounted);
   dout(1) << __func__ << dendl;
 
+  if (!_kv_only) {
+    // stop queueing rewrites before we drain
+    defrag_thread.shutdown();
+  }
   _osr_drain_all();
+  _set_transaction_trace({});
 
   mounted = false;
   if (!_kv_only) {
@@ -6553,6 +7154,7 @@ int BlueStore::umount()
     dout(20) << __func__ << " stopping kv thread" << dendl;
     _kv_stop();
     _flush_cache();
+    _write_alloc_image();
     dout(20) << __func__ << " closing" << dendl;
 
   }
@@ -6827,7 +7429,7 @@ int BlueStore::_fsck(bool deep, bool repair)
   mempool::bluestore_fsck::map<uint64_t,sb_info_t> sb_info;
 
   uint64_t num_objects = 0;
-  uint64_t num_extents = 0;
+  std::atomic<uint64_t> num_extents = {0};
   uint64_t num_blobs = 0;
   uint64_t num_spanning_blobs = 0;
   uint64_t num_shared_blobs = 0;
@@ -6837,6 +7439,7 @@ int BlueStore::_fsck(bool deep, bool repair)
   store_statfs_t* expected_statfs = nullptr;
   // in deep mode we need R/W write access to be able to replay deferred ops
   bool read_only = !(repair || deep);
+  bool aborted = false;
 
   utime_t start = ceph_clock_now();
   const auto& no_pps_mode = cct->_conf->bluestore_no_per_pool_stats_tolerance;
@@ -6966,12 +7569,247 @@ int BlueStore::_fsck(bool deep, bool repair)
      //fill global if not overriden below
     expected_statfs = &expected_store_statfs;
 
+    // Onodes are decoded here, in key order, so that extent shard keys can
+    // be matched up with them.  The expensive part (faulting in shards,
+    // checking blobs and, if deep, reading the data) is left to a pool of
+    // workers.
+    struct fsck_object_t {
+      CollectionRef c;
+      OnodeRef o;
+      store_statfs_t *expected_statfs;
+    };
+    ceph::mutex fsck_lock = ceph::make_mutex("BlueStore::fsck_lock");
+    ceph::condition_variable fsck_cond;
+    std::deque<fsck_object_t> fsck_queue;
+    bool fsck_stop = false;
+    int obj_errors = 0;  // found by the workers, under fsck_lock
+    std::atomic<uint64_t> done_bytes = {0};
+
+    auto check_object = [&](fsck_object_t& e) {
+      CollectionRef& c = e.c;
+      OnodeRef& o = e.o;
+      const ghobject_t& oid = o->oid;
+      int errs = 0;
+      store_statfs_t onode_statfs;
+      RWLock::RLocker cl(c->lock);
+      o->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
+      _dump_onode(o);
+      // lextents
+      map<BlobRef,bluestore_blob_t::unused_t> referenced;
+      uint64_t pos = 0;
+      mempool::bluestore_fsck::map<BlobRef,
+				   bluestore_blob_use_tracker_t> ref_map;
+      for (auto& l : o->extent_map.extent_map) {
+	dout(20) << __func__ << "    " << l << dendl;
+	if (l.logical_offset < pos) {
+	  derr << "fsck error: " << oid << " lextent at 0x"
+	       << std::hex << l.logical_offset
+	       << " overlaps with the previous, which ends at 0x" << pos
+	       << std::dec << dendl;
+	  ++errs;
+	}
+	if (o->extent_map.spans_shard(l.logical_offset, l.length)) {
+	  derr << "fsck error: " << oid << " lextent at 0x"
+	       << std::hex << l.logical_offset << "~" << l.length
+	       << " spans a shard boundary"
+	       << std::dec << dendl;
+	  ++errs;
+	}
+	pos = l.logical_offset + l.length;
+	onode_statfs.data_stored += l.length;
+	ceph_assert(l.blob);
+	const bluestore_blob_t& blob = l.blob->get_blob();
+
+        auto& ref = ref_map[l.blob];
+        if (ref.is_empty()) {
+          uint32_t min_release_size = blob.get_release_size(min_alloc_size);
+          uint32_t l = blob.get_logical_length();
+          ref.init(l, min_release_size);
+        }
+	ref.get(
+	  l.blob_offset, 
+	  l.length);
+	++num_extents;
+	if (blob.has_unused()) {
+	  auto p = referenced.find(l.blob);
+	  bluestore_blob_t::unused_t *pu;
+	  if (p == referenced.end()) {
+	    pu = &referenced[l.blob];
+	  } else {
+	    pu = &p->second;
+	  }
+	  uint64_t blob_len = blob.get_logical_length();
+	  ceph_assert((blob_len % (sizeof(*pu)*8)) == 0);
+	  ceph_assert(l.blob_offset + l.length <= blob_len);
+	  uint64_t chunk_size = blob_len / (sizeof(*pu)*8);
+	  uint64_t start = l.blob_offset / chunk_size;
+	  uint64_t end =
+	    round_up_to(l.blob_offset + l.length, chunk_size) / chunk_size;
+	  for (auto i = start; i < end; ++i) {
+	    (*pu) |= (1u << i);
+	  }
+	}
+      }
+      for (auto &i : referenced) {
+	dout(20) << __func__ << "  referenced 0x" << std::hex << i.second
+		 << std::dec << " for " << *i.first << dendl;
+	const bluestore_blob_t& blob = i.first->get_blob();
+	if (i.second & blob.unused) {
+	  derr << "fsck error: " << oid << " blob claims unused 0x"
+	       << std::hex << blob.unused
+	       << " but extents reference 0x" << i.second << std::dec
+	       << " on blob " << *i.first << dendl;
+	  ++errs;
+	}
+	if (blob.has_csum()) {
+	  uint64_t blob_len = blob.get_logical_length();
+	  uint64_t unused_chunk_size = blob_len / (sizeof(blob.unused)*8);
+	  unsigned csum_count = blob.get_csum_count();
+	  unsigned csum_chunk_size = blob.get_csum_chunk_size();
+	  for (unsigned p = 0; p < csum_count; ++p) {
+	    unsigned pos = p * csum_chunk_size;
+	    unsigned firstbit = pos / unused_chunk_size;    // [firstbit,lastbit]
+	    unsigned lastbit = (pos + csum_chunk_size - 1) / unused_chunk_size;
+	    unsigned mask = 1u << firstbit;
+	    for (unsigned b = firstbit + 1; b <= lastbit; ++b) {
+	      mask |= 1u << b;
+	    }
+	    if ((blob.unused & mask) == mask) {
+	      // this csum chunk region is marked unused
+	      if (blob.get_csum_item(p) != 0) {
+		derr << "fsck error: " << oid
+		     << " blob claims csum chunk 0x" << std::hex << pos
+		     << "~" << csum_chunk_size
+		     << " is unused (mask 0x" << mask << " of unused 0x"
+		     << blob.unused << ") but csum is non-zero 0x"
+		     << blob.get_csum_item(p) << std::dec << " on blob "
+		     << *i.first << dendl;
+		++errs;
+	      }
+	    }
+	  }
+	}
+      }
+      {
+	// sb_info, used_blocks and the repairer are shared
+	std::lock_guard l(fsck_lock);
+	for (auto &i : ref_map) {
+	  ++num_blobs;
+	  const bluestore_blob_t& blob = i.first->get_blob();
+	  bool equal = i.first->get_blob_use_tracker().equal(i.second);
+	  if (!equal) {
+	    derr << "fsck error: " << oid << " blob " << *i.first
+		 << " doesn't match expected ref_map " << i.second << dendl;
+	    ++errs;
+	  }
+	  if (blob.is_compressed()) {
+	    onode_statfs.data_compressed += blob.get_compressed_payload_length();
+	    onode_statfs.data_compressed_original +=
+	      i.first->get_referenced_bytes();
+	  }
+	  if (blob.is_shared()) {
+	    if (i.first->shared_blob->get_sbid() > blobid_max) {
+	      derr << "fsck error: " << oid << " blob " << blob
+		   << " sbid " << i.first->shared_blob->get_sbid() << " > blobid_max "
+		   << blobid_max << dendl;
+	      ++errs;
+	    } else if (i.first->shared_blob->get_sbid() == 0) {
+	      derr << "fsck error: " << oid << " blob " << blob
+		   << " marked as shared but has uninitialized sbid"
+		   << dendl;
+	      ++errs;
+	    }
+	    sb_info_t& sbi = sb_info[i.first->shared_blob->get_sbid()];
+	    ceph_assert(sbi.cid == coll_t() || sbi.cid == c->cid);
+	    ceph_assert(sbi.pool_id == INT64_MIN ||
+			sbi.pool_id == oid.hobj.get_logical_pool());
+	    sbi.cid = c->cid;
+	    sbi.pool_id = oid.hobj.get_logical_pool();
+	    sbi.sb = i.first->shared_blob;
+	    sbi.oids.push_back(oid);
+	    sbi.compressed = blob.is_compressed();
+	    for (auto e : blob.get_extents()) {
+	      if (e.is_valid()) {
+		sbi.ref_map.get(e.offset, e.length);
+	      }
+	    }
+	  } else {
+	    errs += _fsck_check_extents(c->cid, oid, blob.get_extents(),
+					blob.is_compressed(),
+					used_blocks,
+					fm->get_alloc_size(),
+					repair ? &repairer : nullptr,
+					onode_statfs);
+	  }
+	}
+      }
+      if (deep) {
+	bufferlist bl;
+	uint64_t max_read_block = cct->_conf->bluestore_fsck_read_bytes_cap;
+	uint64_t offset = 0;
+	do {
+	  uint64_t l = std::min(uint64_t(o->onode.size - offset), max_read_block);
+	  int r = _do_read(c.get(), o, offset, l, bl,
+	    CEPH_OSD_OP_FLAG_FADVISE_NOCACHE);
+	  if (r < 0) {
+	    ++errs;
+	    derr << "fsck error: " << oid << std::hex
+	         << " error during read: "
+		 << " " << offset << "~" << l
+		 << " " << cpp_strerror(r) << std::dec
+		 << dendl;
+	    break;
+	  }
+	  offset += l;
+	} while (offset < o->onode.size);
+      }
+      std::lock_guard l(fsck_lock);
+      e.expected_statfs->add(onode_statfs);
+      obj_errors += errs;
+      done_bytes += onode_statfs.allocated;
+    };
+
+    unsigned num_threads = cct->_conf.get_val<uint64_t>("bluestore_fsck_threads");
+    if (num_threads == 0) {
+      num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t max_queued = num_threads * 64;
+    std::vector<std::thread> workers;
+    if (num_threads > 1) {
+      dout(1) << __func__ << " checking objects on " << num_threads
+	      << " threads" << dendl;
+      for (unsigned i = 0; i < num_threads; ++i) {
+	workers.push_back(make_named_thread("bstore_fsck", [&]() {
+	  std::unique_lock l(fsck_lock);
+	  while (!fsck_queue.empty() || !fsck_stop) {
+	    if (fsck_queue.empty()) {
+	      fsck_cond.wait(l);
+	      continue;
+	    }
+	    {
+	      auto e = std::move(fsck_queue.front());
+	      fsck_queue.pop_front();
+	      fsck_cond.notify_all();
+	      l.unlock();
+	      check_object(e);
+	    }
+	    l.lock();
+	  }
+	}));
+      }
+    }
+    const uint64_t total_bytes = actual_statfs.allocated;
+    utime_t next_progress = ceph_clock_now();
+    next_progress += 1.0;
+    uint64_t num_keys = 0;
+
     CollectionRef c;
     spg_t pgid;
     mempool::bluestore_fsck::list<string> expecting_shards;
     for (it->lower_bound(string()); it->valid(); it->next()) {
       if (g_conf()->bluestore_debug_fsck_abort) {
-	goto out_scan;
+	aborted = true;
+	break;
       }
       dout(30) << __func__ << " key "
                << pretty_binary_string(it->key()) << dendl;
@@ -7052,218 +7890,53 @@ int BlueStore::_fsck(bool deep, bool repair)
 		 << dendl;
       }
 
-      if (!expecting_shards.empty()) {
-	for (auto &k : expecting_shards) {
-	  derr << "fsck error: missing shard key "
-	       << pretty_binary_string(k) << dendl;
-	}
-	++errors;
-	expecting_shards.clear();
-      }
-
-      dout(10) << __func__ << "  " << oid << dendl;
-      store_statfs_t onode_statfs;
-      RWLock::RLocker l(c->lock);
-      OnodeRef o = c->get_onode(oid, false);
-      if (o->onode.nid) {
-	if (o->onode.nid > nid_max) {
-	  derr << "fsck error: " << oid << " nid " << o->onode.nid
-	       << " > nid_max " << nid_max << dendl;
-	  ++errors;
-	}
-	if (used_nids.count(o->onode.nid)) {
-	  derr << "fsck error: " << oid << " nid " << o->onode.nid
-	       << " already in use" << dendl;
-	  ++errors;
-	  continue; // go for next object
-	}
-	used_nids.insert(o->onode.nid);
-      }
-      ++num_objects;
-      num_spanning_blobs += o->extent_map.spanning_blob_map.size();
-      o->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
-      _dump_onode(o);
-      // shards
-      if (!o->extent_map.shards.empty()) {
-	++num_sharded_objects;
-	num_object_shards += o->extent_map.shards.size();
-      }
-      for (auto& s : o->extent_map.shards) {
-	dout(20) << __func__ << "    shard " << *s.shard_info << dendl;
-	expecting_shards.push_back(string());
-	get_extent_shard_key(o->key, s.shard_info->offset,
-			     &expecting_shards.back());
-	if (s.shard_info->offset >= o->onode.size) {
-	  derr << "fsck error: " << oid << " shard 0x" << std::hex
-	       << s.shard_info->offset << " past EOF at 0x" << o->onode.size
-	       << std::dec << dendl;
-	  ++errors;
-	}
-      }
-      // lextents
-      map<BlobRef,bluestore_blob_t::unused_t> referenced;
-      uint64_t pos = 0;
-      mempool::bluestore_fsck::map<BlobRef,
-				   bluestore_blob_use_tracker_t> ref_map;
-      for (auto& l : o->extent_map.extent_map) {
-	dout(20) << __func__ << "    " << l << dendl;
-	if (l.logical_offset < pos) {
-	  derr << "fsck error: " << oid << " lextent at 0x"
-	       << std::hex << l.logical_offset
-	       << " overlaps with the previous, which ends at 0x" << pos
-	       << std::dec << dendl;
-	  ++errors;
-	}
-	if (o->extent_map.spans_shard(l.logical_offset, l.length)) {
-	  derr << "fsck error: " << oid << " lextent at 0x"
-	       << std::hex << l.logical_offset << "~" << l.length
-	       << " spans a shard boundary"
-	       << std::dec << dendl;
-	  ++errors;
-	}
-	pos = l.logical_offset + l.length;
-	onode_statfs.data_stored += l.length;
-	ceph_assert(l.blob);
-	const bluestore_blob_t& blob = l.blob->get_blob();
-
-        auto& ref = ref_map[l.blob];
-        if (ref.is_empty()) {
-          uint32_t min_release_size = blob.get_release_size(min_alloc_size);
-          uint32_t l = blob.get_logical_length();
-          ref.init(l, min_release_size);
-        }
-	ref.get(
-	  l.blob_offset, 
-	  l.length);
-	++num_extents;
-	if (blob.has_unused()) {
-	  auto p = referenced.find(l.blob);
-	  bluestore_blob_t::unused_t *pu;
-	  if (p == referenced.end()) {
-	    pu = &referenced[l.blob];
-	  } else {
-	    pu = &p->second;
-	  }
-	  uint64_t blob_len = blob.get_logical_length();
-	  ceph_assert((blob_len % (sizeof(*pu)*8)) == 0);
-	  ceph_assert(l.blob_offset + l.length <= blob_len);
-	  uint64_t chunk_size = blob_len / (sizeof(*pu)*8);
-	  uint64_t start = l.blob_offset / chunk_size;
-	  uint64_t end =
-	    round_up_to(l.blob_offset + l.length, chunk_size) / chunk_size;
-	  for (auto i = start; i < end; ++i) {
-	    (*pu) |= (1u << i);
-	  }
+      if (!expecting_shards.empty()) {
+	for (auto &k : expecting_shards) {
+	  derr << "fsck error: missing shard key "
+	       << pretty_binary_string(k) << dendl;
 	}
+	++errors;
+	expecting_shards.clear();
       }
-      for (auto &i : referenced) {
-	dout(20) << __func__ << "  referenced 0x" << std::hex << i.second
-		 << std::dec << " for " << *i.first << dendl;
-	const bluestore_blob_t& blob = i.first->get_blob();
-	if (i.second & blob.unused) {
-	  derr << "fsck error: " << oid << " blob claims unused 0x"
-	       << std::hex << blob.unused
-	       << " but extents reference 0x" << i.second << std::dec
-	       << " on blob " << *i.first << dendl;
+
+      dout(10) << __func__ << "  " << oid << dendl;
+      OnodeRef o;
+      {
+	RWLock::RLocker l(c->lock);
+	o = c->get_onode(oid, false);
+      }
+      if (o->onode.nid) {
+	if (o->onode.nid > nid_max) {
+	  derr << "fsck error: " << oid << " nid " << o->onode.nid
+	       << " > nid_max " << nid_max << dendl;
 	  ++errors;
 	}
-	if (blob.has_csum()) {
-	  uint64_t blob_len = blob.get_logical_length();
-	  uint64_t unused_chunk_size = blob_len / (sizeof(blob.unused)*8);
-	  unsigned csum_count = blob.get_csum_count();
-	  unsigned csum_chunk_size = blob.get_csum_chunk_size();
-	  for (unsigned p = 0; p < csum_count; ++p) {
-	    unsigned pos = p * csum_chunk_size;
-	    unsigned firstbit = pos / unused_chunk_size;    // [firstbit,lastbit]
-	    unsigned lastbit = (pos + csum_chunk_size - 1) / unused_chunk_size;
-	    unsigned mask = 1u << firstbit;
-	    for (unsigned b = firstbit + 1; b <= lastbit; ++b) {
-	      mask |= 1u << b;
-	    }
-	    if ((blob.unused & mask) == mask) {
-	      // this csum chunk region is marked unused
-	      if (blob.get_csum_item(p) != 0) {
-		derr << "fsck error: " << oid
-		     << " blob claims csum chunk 0x" << std::hex << pos
-		     << "~" << csum_chunk_size
-		     << " is unused (mask 0x" << mask << " of unused 0x"
-		     << blob.unused << ") but csum is non-zero 0x"
-		     << blob.get_csum_item(p) << std::dec << " on blob "
-		     << *i.first << dendl;
-		++errors;
-	      }
-	    }
-	  }
+	if (used_nids.count(o->onode.nid)) {
+	  derr << "fsck error: " << oid << " nid " << o->onode.nid
+	       << " already in use" << dendl;
+	  ++errors;
+	  continue; // go for next object
 	}
+	used_nids.insert(o->onode.nid);
       }
-      for (auto &i : ref_map) {
-	++num_blobs;
-	const bluestore_blob_t& blob = i.first->get_blob();
-	bool equal = i.first->get_blob_use_tracker().equal(i.second);
-	if (!equal) {
-	  derr << "fsck error: " << oid << " blob " << *i.first
-	       << " doesn't match expected ref_map " << i.second << dendl;
+      ++num_objects;
+      num_spanning_blobs += o->extent_map.spanning_blob_map.size();
+      // shards
+      if (!o->extent_map.shards.empty()) {
+	++num_sharded_objects;
+	num_object_shards += o->extent_map.shards.size();
+      }
+      for (auto& s : o->extent_map.shards) {
+	dout(20) << __func__ << "    shard " << *s.shard_info << dendl;
+	expecting_shards.push_back(string());
+	get_extent_shard_key(o->key, s.shard_info->offset,
+			     &expecting_shards.back());
+	if (s.shard_info->offset >= o->onode.size) {
+	  derr << "fsck error: " << oid << " shard 0x" << std::hex
+	       << s.shard_info->offset << " past EOF at 0x" << o->onode.size
+	       << std::dec << dendl;
 	  ++errors;
 	}
-	if (blob.is_compressed()) {
-	  onode_statfs.data_compressed += blob.get_compressed_payload_length();
-	  onode_statfs.data_compressed_original +=
-	    i.first->get_referenced_bytes();
-	}
-	if (blob.is_shared()) {
-	  if (i.first->shared_blob->get_sbid() > blobid_max) {
-	    derr << "fsck error: " << oid << " blob " << blob
-		 << " sbid " << i.first->shared_blob->get_sbid() << " > blobid_max "
-		 << blobid_max << dendl;
-	    ++errors;
-	  } else if (i.first->shared_blob->get_sbid() == 0) {
-            derr << "fsck error: " << oid << " blob " << blob
-                 << " marked as shared but has uninitialized sbid"
-                 << dendl;
-            ++errors;
-          }
-	  sb_info_t& sbi = sb_info[i.first->shared_blob->get_sbid()];
-	  ceph_assert(sbi.cid == coll_t() || sbi.cid == c->cid);
-	  ceph_assert(sbi.pool_id == INT64_MIN ||
-	              sbi.pool_id == oid.hobj.get_logical_pool());
-	  sbi.cid = c->cid;
-	  sbi.pool_id = oid.hobj.get_logical_pool();
-	  sbi.sb = i.first->shared_blob;
-	  sbi.oids.push_back(oid);
-	  sbi.compressed = blob.is_compressed();
-	  for (auto e : blob.get_extents()) {
-	    if (e.is_valid()) {
-	      sbi.ref_map.get(e.offset, e.length);
-	    }
-	  }
-	} else {
-	  errors += _fsck_check_extents(c->cid, oid, blob.get_extents(),
-					blob.is_compressed(),
-					used_blocks,
-					fm->get_alloc_size(),
-					repair ? &repairer : nullptr,
-					onode_statfs);
-        }
-      }
-      if (deep) {
-	bufferlist bl;
-	uint64_t max_read_block = cct->_conf->bluestore_fsck_read_bytes_cap;
-	uint64_t offset = 0;
-	do {
-	  uint64_t l = std::min(uint64_t(o->onode.size - offset), max_read_block);
-	  int r = _do_read(c.get(), o, offset, l, bl,
-	    CEPH_OSD_OP_FLAG_FADVISE_NOCACHE);
-	  if (r < 0) {
-	    ++errors;
-	    derr << "fsck error: " << oid << std::hex
-	         << " error during read: "
-		 << " " << offset << "~" << l
-		 << " " << cpp_strerror(r) << std::dec
-		 << dendl;
-	    break;
-	  }
-	  offset += l;
-	} while (offset < o->onode.size);
       }
       // omap
       if (o->onode.has_omap()) {
@@ -7277,8 +7950,45 @@ int BlueStore::_fsck(bool deep, bool repair)
 	  m.insert(o->onode.nid);
 	}
       }
-      expected_statfs->add(onode_statfs);
+
+      fsck_object_t e{c, o, expected_statfs};
+      if (workers.empty()) {
+	check_object(e);
+      } else {
+	std::unique_lock l(fsck_lock);
+	fsck_cond.wait(l, [&] { return fsck_queue.size() < max_queued; });
+	fsck_queue.push_back(std::move(e));
+	fsck_cond.notify_all();
+      }
+
+      if ((++num_keys & 1023) == 0 && ceph_clock_now() > next_progress) {
+	next_progress = ceph_clock_now();
+	next_progress += 1.0;
+	dout(5) << __func__ << " checked " << byte_u_t(done_bytes)
+		<< " of " << byte_u_t(total_bytes) << dendl;
+	if (fsck_progress_cb) {
+	  fsck_progress_cb(done_bytes, total_bytes);
+	}
+      }
     } // for (it->lower_bound(string()); it->valid(); it->next())
+
+    if (!workers.empty()) {
+      {
+	std::lock_guard l(fsck_lock);
+	fsck_stop = true;
+      }
+      fsck_cond.notify_all();
+      for (auto& t : workers) {
+	t.join();
+      }
+    }
+    errors += obj_errors;
+    if (fsck_progress_cb) {
+      fsck_progress_cb(done_bytes, total_bytes);
+    }
+    if (aborted) {
+      goto out_scan;
+    }
   } // if (it)
 
   dout(1) << __func__ << " checking shared_blobs" << dendl;
@@ -8346,6 +9056,110 @@ int BlueStore::read(
   return r;
 }
 
+int BlueStore::read_crc32c(
+  CollectionHandle &c_,
+  const ghobject_t& oid,
+  uint64_t offset,
+  size_t length,
+  uint32_t seed,
+  uint32_t *crc,
+  uint32_t op_flags)
+{
+  Collection *c = static_cast<Collection *>(c_.get());
+  dout(15) << __func__ << " " << c->get_cid() << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length << std::dec
+	   << dendl;
+  if (!c->exists)
+    return -ENOENT;
+
+  int r;
+  {
+    RWLock::RLocker l(c->lock);
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists) {
+      return -ENOENT;
+    }
+    if (offset == length && offset == 0)
+      length = o->onode.size;
+
+    // _do_read verifies the blob csums against what it read, so
+    // wherever those are crc32c the digest follows from them
+    bufferlist bl;
+    r = _do_read(c, o, offset, length, bl, op_flags);
+    if (r == -EIO) {
+      logger->inc(l_bluestore_read_eio);
+    }
+    if (r >= 0) {
+      *crc = _crc32c_from_csums(o, offset, bl, seed);
+    }
+  }
+  if (r >= 0 && _debug_data_eio(oid)) {
+    r = -EIO;
+    derr << __func__ << " " << c->cid << " " << oid << " INJECT EIO" << dendl;
+  }
+  dout(10) << __func__ << " " << c->get_cid() << " " << oid
+	   << " 0x" << std::hex << offset << "~" << length << std::dec
+	   << " = " << r << dendl;
+  return r;
+}
+
+uint32_t BlueStore::_crc32c_from_csums(
+  OnodeRef& o,
+  uint64_t offset,
+  const bufferlist& bl,
+  uint32_t crc)
+{
+  uint64_t end = offset + bl.length();
+  uint64_t pos = offset;
+  auto p = bl.cbegin();
+  uint64_t from_csum = 0;
+  for (auto lp = o->extent_map.seek_lextent(offset);
+       pos < end && lp != o->extent_map.extent_map.end();
+       ++lp) {
+    if (lp->logical_offset >= end) {
+      break;
+    }
+    const bluestore_blob_t& blob = lp->blob->get_blob();
+    if (blob.is_compressed() ||
+	!blob.has_csum() ||
+	blob.csum_type != Checksummer::CSUM_CRC32C) {
+      continue;
+    }
+    // the whole csum chunks of this extent that lie in what we read
+    uint64_t csum_chunk = blob.get_csum_chunk_size();
+    uint64_t a = std::max(pos, (uint64_t)lp->logical_offset);
+    uint64_t b = std::min(end, (uint64_t)lp->logical_end());
+    uint64_t xa = p2roundup<uint64_t>(a - lp->logical_offset + lp->blob_offset,
+				      csum_chunk);
+    uint64_t xb = p2align<uint64_t>(b - lp->logical_offset + lp->blob_offset,
+				    csum_chunk);
+    if (xa >= xb) {
+      continue;
+    }
+    uint64_t s = xa - lp->blob_offset + lp->logical_offset;
+    uint64_t e = xb - lp->blob_offset + lp->logical_offset;
+    if (s > pos) {
+      crc = p.crc32c(s - pos, crc);
+    }
+    // each stored value is crc32c(-1, chunk); continuing crc over the
+    // chunk gives zeros(crc) ^ zeros(-1) ^ value
+    uint32_t zeros = ceph_crc32c_zeros(-1, csum_chunk);
+    for (uint64_t x = xa; x < xb; x += csum_chunk) {
+      crc = ceph_crc32c_zeros(crc, csum_chunk) ^ zeros ^
+	(uint32_t)blob.get_csum_item(x / csum_chunk);
+    }
+    p.advance(e - s);
+    from_csum += e - s;
+    pos = e;
+  }
+  if (pos < end) {
+    crc = p.crc32c(end - pos, crc);
+  }
+  dout(20) << __func__ << " 0x" << std::hex << from_csum << " of 0x"
+	   << bl.length() << std::dec << " bytes from csums" << dendl;
+  return crc;
+}
+
 // --------------------------------------------------------
 // intermediate data structures used while reading
 struct region_t {
@@ -8427,6 +9241,13 @@ int BlueStore::_do_read(
     dout(20) << __func__ << " defaulting to buffered read" << dendl;
     buffered = true;
   }
+  // decompressing is costly enough that we keep the result around unless
+  // the client told us not to
+  bool cache_decompressed = buffered ||
+    (cct->_conf->bluestore_cache_decompressed &&
+     (op_flags & (CEPH_OSD_OP_FLAG_FADVISE_DONTNEED |
+		  CEPH_OSD_OP_FLAG_FADVISE_NOCACHE |
+		  CEPH_OSD_OP_FLAG_BYPASS_CLEAN_CACHE)) == 0);
 
   if (offset + length > o->onode.size) {
     length = o->onode.size - offset;
@@ -8541,7 +9362,16 @@ int BlueStore::_do_read(
   start = mono_clock::now(); // for the sake of simplicity
                              // measure the whole block below.
                              // The error isn't that much...
-  vector<bufferlist> compressed_blob_bls;
+  struct compressed_read_t {
+    bufferlist bl;         ///< compressed data read so far
+    uint64_t c_off = 0;    ///< blob offset of bl
+    // for framed blobs we only read and decompress the frames we need
+    bluestore_compression_header_t chdr;
+    uint32_t data_off = 0; ///< blob offset of first_frame
+    unsigned first_frame = 0;
+    unsigned num_frames = 0;
+  };
+  vector<compressed_read_t> compressed_blob_bls;
   IOContext ioc(cct, NULL, true); // allow EIO
   for (auto& p : blobs2read) {
     const BlobRef& bptr = p.first;
@@ -8549,27 +9379,98 @@ int BlueStore::_do_read(
     dout(20) << __func__ << "  blob " << *bptr << std::hex
 	     << " need " << r2r << std::dec << dendl;
     if (bptr->get_blob().is_compressed()) {
-      // read the whole thing
       if (compressed_blob_bls.empty()) {
 	// ensure we avoid any reallocation on subsequent blobs
 	compressed_blob_bls.reserve(blobs2read.size());
       }
-      compressed_blob_bls.push_back(bufferlist());
-      bufferlist& bl = compressed_blob_bls.back();
-      r = bptr->get_blob().map(
-	0, bptr->get_blob().get_ondisk_length(),
-	[&](uint64_t offset, uint64_t length) {
-	  int r;
-	  // use aio if there are more regions to read than those in this blob
-	  if (num_regions > r2r.size()) {
-	    r = bdev->aio_read(offset, length, &bl, &ioc);
+      compressed_blob_bls.push_back(compressed_read_t());
+      compressed_read_t& cr = compressed_blob_bls.back();
+      const bluestore_blob_t& blob = bptr->get_blob();
+      uint64_t ondisk_len = blob.get_ondisk_length();
+      r = 0;
+
+      // a small read out of a (possibly) framed blob: fetch the header
+      // first and see which frames are needed.  the csum covers the
+      // compressed data, so read whole csum chunks to verify what we read.
+      uint32_t want_start = UINT32_MAX, want_end = 0;
+      for (auto& req : r2r) {
+	for (auto& reg : req.regs) {
+	  want_start = std::min<uint32_t>(want_start, reg.blob_xoffset);
+	  want_end = std::max<uint32_t>(want_end,
+					reg.blob_xoffset + reg.length);
+	}
+      }
+      uint64_t frame_size = comp_frame_size;
+      uint64_t chunk_size = blob.has_csum() ?
+	std::max<uint64_t>(block_size, blob.get_csum_chunk_size()) : block_size;
+      if (frame_size &&
+	  ondisk_len > chunk_size &&
+	  blob.get_logical_length() >= frame_size * 2 &&
+	  (want_end - want_start) * 2 <= blob.get_logical_length()) {
+	r = blob.map(
+	  0, chunk_size,
+	  [&](uint64_t offset, uint64_t length) {
+	    return bdev->read(offset, length, &cr.bl, &ioc, false);
+	  });
+	if (r == 0 && blob.has_csum() &&
+	    _verify_csum(o, &blob, 0, cr.bl,
+			 r2r.front().regs.front().logical_offset) < 0) {
+	  // read it all, which verifies and retries as usual
+	  r = 0;
+	} else if (r == 0) {
+	  uint32_t hdr_len = 0;
+	  try {
+	    auto i = cr.bl.cbegin();
+	    decode(cr.chdr, i);
+	    hdr_len = i.get_off();
+	  } catch (buffer::error& e) {
+	    // header spans more than a chunk, just read it all
+	    cr.chdr = bluestore_compression_header_t();
+	  }
+	  auto& chdr = cr.chdr;
+	  if (chdr.is_framed() &&
+	      want_end <= chdr.frames.size() * chdr.frame_size) {
+	    cr.first_frame = want_start / chdr.frame_size;
+	    cr.num_frames = (want_end - 1) / chdr.frame_size + 1 -
+	      cr.first_frame;
+	    cr.data_off = hdr_len + chdr.get_frame_offset(cr.first_frame);
+	    uint64_t data_end = hdr_len +
+	      chdr.get_frame_offset(cr.first_frame + cr.num_frames);
+	    ceph_assert(data_end <= ondisk_len);
+	    if (cr.data_off >= chunk_size) {
+	      cr.bl.clear();
+	      cr.c_off = p2align<uint64_t>(cr.data_off, chunk_size);
+	    }
+	    ondisk_len = std::min(ondisk_len,
+				  p2roundup<uint64_t>(data_end, chunk_size));
+	    dout(20) << __func__ << "  frames " << cr.first_frame
+		     << "~" << cr.num_frames << " of " << chdr.frames.size()
+		     << " at 0x" << std::hex << cr.data_off << "~"
+		     << (data_end - cr.data_off) << std::dec << dendl;
 	  } else {
-	    r = bdev->read(offset, length, &bl, &ioc, false);
+	    cr.num_frames = 0;
 	  }
-	  if (r < 0)
-            return r;
-          return 0;
-	});
+	}
+      }
+
+      // read the (rest of the) needed part
+      uint64_t r_off = cr.c_off + cr.bl.length();
+      if (r == 0 && r_off < ondisk_len) {
+	r = blob.map(
+	  r_off, ondisk_len - r_off,
+	  [&](uint64_t offset, uint64_t length) {
+	    int r;
+	    // use aio if there are more regions to read than those in this blob
+	    if (num_regions > r2r.size()) {
+	      r = bdev->aio_read(offset, length, &cr.bl, &ioc);
+	    } else {
+	      r = bdev->read(offset, length, &cr.bl, &ioc, false);
+	    }
+	    if (r < 0)
+	      return r;
+	    return 0;
+	  });
+      }
       if (r < 0) {
         derr << __func__ << " bdev-read failed: " << cpp_strerror(r) << dendl;
         if (r == -EIO) {
@@ -8633,6 +9534,11 @@ int BlueStore::_do_read(
     mono_clock::now() - start,
     [&](auto lat) { return ", num_ios = " + stringify(num_ios); }
   );
+  if (num_regions > 0 && c->cache->track_misses) {
+    c->cache->note_buffer_misses(
+      num_regions,
+      std::chrono::duration<double>(mono_clock::now() - start).count());
+  }
 
   // enumerate and decompress desired blobs
   auto p = compressed_blob_bls.begin();
@@ -8644,9 +9550,11 @@ int BlueStore::_do_read(
 	     << " need 0x" << r2r << std::dec << dendl;
     if (bptr->get_blob().is_compressed()) {
       ceph_assert(p != compressed_blob_bls.end());
-      bufferlist& compressed_bl = *p++;
-      if (_verify_csum(o, &bptr->get_blob(), 0, compressed_bl,
-        	       r2r.front().regs.front().logical_offset) < 0) {
+      compressed_read_t& cr = *p++;
+      bufferlist raw_bl;
+      uint64_t raw_off = 0;
+      if (_verify_csum(o, &bptr->get_blob(), cr.c_off, cr.bl,
+		       r2r.front().regs.front().logical_offset) < 0) {
         // Handles spurious read errors caused by a kernel bug.
         // We sometimes get all-zero pages as a result of the read under
         // high memory pressure. Retrying the failing read succeeds in most 
@@ -8657,18 +9565,23 @@ int BlueStore::_do_read(
         }
         return _do_read(c, o, offset, length, bl, op_flags, retry_count + 1);
       }
-      bufferlist raw_bl;
-      r = _decompress(compressed_bl, &raw_bl);
+      if (cr.num_frames) {
+	raw_off = cr.first_frame * cr.chdr.frame_size;
+	r = _decompress(cr.chdr, cr.bl, cr.data_off - cr.c_off,
+			cr.first_frame, cr.num_frames, &raw_bl);
+      } else {
+	r = _decompress(cr.bl, &raw_bl);
+      }
       if (r < 0)
 	return r;
-      if (buffered) {
-	bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(), 0,
-				       raw_bl);
+      if (cache_decompressed) {
+	bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(),
+				       raw_off, raw_bl);
       }
       for (auto& req : r2r) {
         for (auto& r : req.regs) {
           ready_regions[r.logical_offset].substr_of(
-            raw_bl, r.blob_xoffset, r.length);
+            raw_bl, r.blob_xoffset - raw_off, r.length);
         }
       }
     } else {
@@ -8787,11 +9700,22 @@ int BlueStore::_verify_csum(OnodeRef& o,
 
 int BlueStore::_decompress(bufferlist& source, bufferlist* result)
 {
-  int r = 0;
-  auto start = mono_clock::now();
   auto i = source.cbegin();
   bluestore_compression_header_t chdr;
   decode(chdr, i);
+  return _decompress(chdr, source, i.get_off(), 0, chdr.frames.size(),
+		     result);
+}
+
+int BlueStore::_decompress(
+  const bluestore_compression_header_t& chdr,
+  const bufferlist& source,
+  uint32_t off,
+  unsigned first_frame, unsigned num_frames,
+  bufferlist* result)
+{
+  int r = 0;
+  auto start = mono_clock::now();
   int alg = int(chdr.type);
   CompressorRef cp = compressor;
   if (!cp || (int)cp->get_type() != alg) {
@@ -8806,12 +9730,31 @@ int BlueStore::_decompress(bufferlist& source, bufferlist* result)
     derr << __func__ << " can't load decompressor " << alg_name << dendl;
     _set_compression_alert(false, alg_name);
     r = -EIO;
-  } else {
+  } else if (!chdr.is_framed()) {
+    auto i = source.cbegin();
+    i.advance(off);
     r = cp->decompress(i, chdr.length, *result);
     if (r < 0) {
       derr << __func__ << " decompression failed with exit code " << r << dendl;
       r = -EIO;
     }
+  } else {
+    ceph_assert(first_frame + num_frames <= chdr.frames.size());
+    // not all codecs advance an iterator past their input, so hand each
+    // frame over as a bufferlist of its own
+    for (unsigned f = first_frame; f < first_frame + num_frames; ++f) {
+      bufferlist frame, t;
+      frame.substr_of(source, off, chdr.frames[f]);
+      off += chdr.frames[f];
+      r = cp->decompress(frame, t);
+      if (r < 0) {
+	derr << __func__ << " decompression of frame " << f
+	     << " failed with exit code " << r << dendl;
+	r = -EIO;
+	break;
+      }
+      result->claim_append(t);
+    }
   }
   LOG_LATENCY(logger, cct, l_bluestore_decompress_lat, mono_clock::now() - start);
   return r;
@@ -9227,7 +10170,8 @@ int BlueStore::omap_get(
   {
     const string& prefix =
       o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP;
-    KeyValueDB::Iterator it = db->get_iterator(prefix);
+    KeyValueDB::Iterator it =
+      db->get_iterator(prefix, get_omap_bounds(o->onode.nid));
     string head, tail;
     get_omap_header(o->onode.nid, &head);
     get_omap_tail(o->onode.nid, &tail);
@@ -9315,7 +10259,8 @@ int BlueStore::omap_get_keys(
   {
     const string& prefix =
       o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP;
-    KeyValueDB::Iterator it = db->get_iterator(prefix);
+    KeyValueDB::Iterator it =
+      db->get_iterator(prefix, get_omap_bounds(o->onode.nid));
     string head, tail;
     get_omap_key(o->onode.nid, string(), &head);
     get_omap_tail(o->onode.nid, &tail);
@@ -9434,6 +10379,15 @@ ObjectMap::ObjectMapIterator BlueStore::get_omap_iterator(
   CollectionHandle &c_,              ///< [in] collection
   const ghobject_t &oid  ///< [in] object
   )
+{
+  return get_omap_iterator(c_, oid, omap_iter_hints_t());
+}
+
+ObjectMap::ObjectMapIterator BlueStore::get_omap_iterator(
+  CollectionHandle &c_,              ///< [in] collection
+  const ghobject_t &oid,  ///< [in] object
+  const omap_iter_hints_t &hints ///< [in] scan hints
+  )
 {
   Collection *c = static_cast<Collection *>(c_.get());
   dout(10) << __func__ << " " << c->get_cid() << " " << oid << dendl;
@@ -9448,8 +10402,16 @@ ObjectMap::ObjectMapIterator BlueStore::get_omap_iterator(
   }
   o->flush();
   dout(10) << __func__ << " has_omap = " << (int)o->onode.has_omap() <<dendl;
+  auto bounds = get_omap_bounds(o->onode.nid);
+  if (hints.upper_bound) {
+    bounds.upper_bound->clear();
+    get_omap_key(o->onode.nid, *hints.upper_bound, &*bounds.upper_bound);
+  }
+  bounds.readahead = hints.readahead;
+  bounds.fill_cache = hints.fill_cache;
   KeyValueDB::Iterator it = db->get_iterator(
-    o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP);
+    o->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP,
+    bounds);
   return ObjectMap::ObjectMapIterator(new OmapIteratorImpl(c, o, it));
 }
 
@@ -10042,7 +11004,7 @@ void BlueStore::_txc_finish(TransContext *txc)
 	       << dendl;
       if (txc->state != TransContext::STATE_DONE) {
 	if (txc->state == TransContext::STATE_PREPARE &&
-	  deferred_aggressive) {
+	    _deferred_aggressive(osr.get())) {
 	  // for _osr_drain_preceding()
           notify = true;
 	}
@@ -10160,7 +11122,10 @@ void BlueStore::_osr_drain_preceding(TransContext *txc)
 {
   OpSequencer *osr = txc->osr.get();
   dout(10) << __func__ << " " << txc << " osr " << osr << dendl;
-  ++deferred_aggressive; // FIXME: maybe osr-local aggressive flag?
+  // only hurry this osr along, the deferred io of the others is still
+  // batched (a pg split or merge would otherwise slow down all of them)
+  ++osr->deferred_aggressive;
+  ++deferred_aggressive_osrs;
   {
     // submit anything pending
     deferred_lock.lock();
@@ -10176,14 +11141,16 @@ void BlueStore::_osr_drain_preceding(TransContext *txc)
     kv_cond.notify_one();
   }
   osr->drain_preceding(txc);
-  --deferred_aggressive;
+  --deferred_aggressive_osrs;
+  --osr->deferred_aggressive;
   dout(10) << __func__ << " " << osr << " done" << dendl;
 }
 
 void BlueStore::_osr_drain(OpSequencer *osr)
 {
   dout(10) << __func__ << " " << osr << dendl;
-  ++deferred_aggressive; // FIXME: maybe osr-local aggressive flag?
+  ++osr->deferred_aggressive;
+  ++deferred_aggressive_osrs;
   {
     // submit anything pending
     deferred_lock.lock();
@@ -10199,7 +11166,8 @@ void BlueStore::_osr_drain(OpSequencer *osr)
     kv_cond.notify_one();
   }
   osr->drain();
-  --deferred_aggressive;
+  --deferred_aggressive_osrs;
+  --osr->deferred_aggressive;
   dout(10) << __func__ << " " << osr << " done" << dendl;
 }
 
@@ -10271,7 +11239,11 @@ void BlueStore::_kv_start()
 
   deferred_finisher.start();
   finisher.start();
+  kv_pipeline = cct->_conf.get_val<bool>("bluestore_kv_sync_pipeline");
   kv_sync_thread.create("bstore_kv_sync");
+  if (kv_pipeline) {
+    kv_commit_thread.create("bstore_kv_commit");
+  }
   kv_finalize_thread.create("bstore_kv_final");
 }
 
@@ -10286,6 +11258,19 @@ void BlueStore::_kv_stop()
     kv_stop = true;
     kv_cond.notify_all();
   }
+  if (kv_pipeline) {
+    // kv_sync_thread may still hand us a group on its way out, so only
+    // stop the commit stage once it is gone
+    kv_sync_thread.join();
+    std::unique_lock l(kv_commit_lock);
+    while (!kv_commit_started) {
+      kv_commit_cond.wait(l);
+    }
+    kv_commit_stop = true;
+    kv_commit_cond.notify_all();
+    l.unlock();
+    kv_commit_thread.join();
+  }
   {
     std::unique_lock l(kv_finalize_lock);
     while (!kv_finalize_started) {
@@ -10294,13 +11279,19 @@ void BlueStore::_kv_stop()
     kv_finalize_stop = true;
     kv_finalize_cond.notify_all();
   }
-  kv_sync_thread.join();
+  if (!kv_pipeline) {
+    kv_sync_thread.join();
+  }
   kv_finalize_thread.join();
   ceph_assert(removed_collections.empty());
   {
     std::lock_guard l(kv_lock);
     kv_stop = false;
   }
+  if (kv_pipeline) {
+    std::lock_guard l(kv_commit_lock);
+    kv_commit_stop = false;
+  }
   {
     std::lock_guard l(kv_finalize_lock);
     kv_finalize_stop = false;
@@ -10325,9 +11316,21 @@ void BlueStore::_kv_sync_thread()
     ceph_assert(kv_committing.empty());
     if (kv_queue.empty() &&
 	((deferred_done_queue.empty() && deferred_stable_queue.empty()) ||
-	 !deferred_aggressive)) {
+	 (!deferred_aggressive && !deferred_aggressive_osrs))) {
       if (kv_stop)
 	break;
+      double window = cct->_conf->bluestore_deferred_flush_window;
+      if (window > 0 && deferred_queue_size > 0) {
+	// don't leave a partial deferred batch pending on an idle device
+	dout(20) << __func__ << " sleep (deferred flush window)" << dendl;
+	kv_cond.wait_for(l, ceph::make_timespan(window));
+	if (kv_queue.empty() && _deferred_flush_window_expired()) {
+	  l.unlock();
+	  deferred_try_submit();
+	  l.lock();
+	}
+	continue;
+      }
       dout(20) << __func__ << " sleep" << dendl;
       kv_cond.wait(l);
       dout(20) << __func__ << " wake" << dendl;
@@ -10368,7 +11371,7 @@ void BlueStore::_kv_sync_thread()
 	  force_flush = true;
 	} else if (kv_committing.empty() && deferred_stable.empty()) {
 	  force_flush = true;  // there's nothing else to commit!
-	} else if (deferred_aggressive) {
+	} else if (deferred_aggressive || deferred_aggressive_osrs) {
 	  force_flush = true;
 	}
       } else {
@@ -10462,71 +11465,42 @@ void BlueStore::_kv_sync_thread()
       for (auto b : deferred_stable) {
 	for (auto& txc : b->txcs) {
 	  bluestore_deferred_transaction_t& wt = *txc.deferred_txn;
-	  ceph_assert(wt.released.empty()); // only kraken did this
-	  string key;
-	  get_deferred_key(wt.seq, &key);
-	  synct->rm_single_key(PREFIX_DEFERRED, key);
-	}
-      }
-
-      // submit synct synchronously (block and wait for it to commit)
-      int r = cct->_conf->bluestore_debug_omit_kv_commit ? 0 : db->submit_transaction_sync(synct);
-      ceph_assert(r == 0);
-
-      {
-	std::unique_lock m(kv_finalize_lock);
-	if (kv_committing_to_finalize.empty()) {
-	  kv_committing_to_finalize.swap(kv_committing);
-	} else {
-	  kv_committing_to_finalize.insert(
-	      kv_committing_to_finalize.end(),
-	      kv_committing.begin(),
-	      kv_committing.end());
-	  kv_committing.clear();
-	}
-	if (deferred_stable_to_finalize.empty()) {
-	  deferred_stable_to_finalize.swap(deferred_stable);
-	} else {
-	  deferred_stable_to_finalize.insert(
-	      deferred_stable_to_finalize.end(),
-	      deferred_stable.begin(),
-	      deferred_stable.end());
-	  deferred_stable.clear();
-	}
-	kv_finalize_cond.notify_one();
-      }
-
-      if (new_nid_max) {
-	nid_max = new_nid_max;
-	dout(10) << __func__ << " nid_max now " << nid_max << dendl;
-      }
-      if (new_blobid_max) {
-	blobid_max = new_blobid_max;
-	dout(10) << __func__ << " blobid_max now " << blobid_max << dendl;
-      }
-
-      {
-	auto finish = mono_clock::now();
-	ceph::timespan dur_flush = after_flush - start;
-	ceph::timespan dur_kv = finish - after_flush;
-	ceph::timespan dur = finish - start;
-	dout(20) << __func__ << " committed " << kv_committing.size()
-	  << " cleaned " << deferred_stable.size()
-	  << " in " << dur
-	  << " (" << dur_flush << " flush + " << dur_kv << " kv commit)"
-	  << dendl;
-	LOG_LATENCY(logger, cct, l_bluestore_kv_flush_lat, dur_flush);
-	LOG_LATENCY(logger, cct, l_bluestore_kv_commit_lat, dur_kv);
-	LOG_LATENCY(logger, cct, l_bluestore_kv_sync_lat, dur);
+	  ceph_assert(wt.released.empty()); // only kraken did this
+	  string key;
+	  get_deferred_key(wt.seq, &key);
+	  synct->rm_single_key(PREFIX_DEFERRED, key);
+	}
       }
 
+      KVCommitGroup g;
+      g.committing.swap(kv_committing);
+      g.deferred_stable.swap(deferred_stable);
+      g.synct = synct;
+      g.new_nid_max = new_nid_max;
+      g.new_blobid_max = new_blobid_max;
+      g.start = start;
+      g.after_flush = after_flush;
+      g.queued = mono_clock::now();
+      LOG_LATENCY(logger, cct, l_bluestore_kv_submit_lat,
+		  g.queued - after_flush);
       if (bluefs) {
-	if (!bluefs_extents_reclaiming.empty()) {
-	  dout(0) << __func__ << " releasing old bluefs 0x" << std::hex
-		   << bluefs_extents_reclaiming << std::dec << dendl;
-	  alloc->release(bluefs_extents_reclaiming);
-	  bluefs_extents_reclaiming.clear();
+	// only release reclaimed bluefs space once the commit that goes
+	// with it is stable
+	g.bluefs_reclaiming.swap(bluefs_extents_reclaiming);
+      }
+
+      if (kv_pipeline) {
+	// go back and flush/submit the next group while this one syncs.
+	// keep at most one group waiting behind the one being synced so
+	// that commits still batch up under load.
+	std::unique_lock m(kv_commit_lock);
+	while (!kv_commit_queue.empty()) {
+	  kv_commit_cond.wait(m);
 	}
+	kv_commit_queue.emplace_back(std::move(g));
+	kv_commit_cond.notify_all();
+      } else {
+	_kv_commit_group(g);
       }
 
       l.lock();
@@ -10539,6 +11513,99 @@ void BlueStore::_kv_sync_thread()
   kv_sync_started = false;
 }
 
+void BlueStore::_kv_commit_group(KVCommitGroup& g)
+{
+  // submit synct synchronously (block and wait for it to commit)
+  int r = cct->_conf->bluestore_debug_omit_kv_commit ? 0 : db->submit_transaction_sync(g.synct);
+  ceph_assert(r == 0);
+
+  auto num_committed = g.committing.size();
+  auto num_cleaned = g.deferred_stable.size();
+  {
+    std::unique_lock m(kv_finalize_lock);
+    if (kv_committing_to_finalize.empty()) {
+      kv_committing_to_finalize.swap(g.committing);
+    } else {
+      kv_committing_to_finalize.insert(
+	  kv_committing_to_finalize.end(),
+	  g.committing.begin(),
+	  g.committing.end());
+      g.committing.clear();
+    }
+    if (deferred_stable_to_finalize.empty()) {
+      deferred_stable_to_finalize.swap(g.deferred_stable);
+    } else {
+      deferred_stable_to_finalize.insert(
+	  deferred_stable_to_finalize.end(),
+	  g.deferred_stable.begin(),
+	  g.deferred_stable.end());
+      g.deferred_stable.clear();
+    }
+    kv_finalize_cond.notify_one();
+  }
+
+  if (g.new_nid_max) {
+    nid_max = g.new_nid_max;
+    dout(10) << __func__ << " nid_max now " << nid_max << dendl;
+  }
+  if (g.new_blobid_max) {
+    blobid_max = g.new_blobid_max;
+    dout(10) << __func__ << " blobid_max now " << blobid_max << dendl;
+  }
+
+  {
+    auto finish = mono_clock::now();
+    ceph::timespan dur_flush = g.after_flush - g.start;
+    ceph::timespan dur_kv = finish - g.after_flush;
+    ceph::timespan dur = finish - g.start;
+    dout(20) << __func__ << " committed " << num_committed
+      << " cleaned " << num_cleaned
+      << " in " << dur
+      << " (" << dur_flush << " flush + " << dur_kv << " kv commit)"
+      << dendl;
+    LOG_LATENCY(logger, cct, l_bluestore_kv_flush_lat, dur_flush);
+    LOG_LATENCY(logger, cct, l_bluestore_kv_commit_lat, dur_kv);
+    LOG_LATENCY(logger, cct, l_bluestore_kv_sync_lat, dur);
+  }
+
+  if (!g.bluefs_reclaiming.empty()) {
+    dout(0) << __func__ << " releasing old bluefs 0x" << std::hex
+	     << g.bluefs_reclaiming << std::dec << dendl;
+    alloc->release(g.bluefs_reclaiming);
+    g.bluefs_reclaiming.clear();
+  }
+}
+
+void BlueStore::_kv_commit_thread()
+{
+  dout(10) << __func__ << " start" << dendl;
+  std::unique_lock l(kv_commit_lock);
+  ceph_assert(!kv_commit_started);
+  kv_commit_started = true;
+  kv_commit_cond.notify_all();
+  while (true) {
+    if (kv_commit_queue.empty()) {
+      if (kv_commit_stop)
+	break;
+      dout(20) << __func__ << " sleep" << dendl;
+      kv_commit_cond.wait(l);
+      dout(20) << __func__ << " wake" << dendl;
+    } else {
+      KVCommitGroup g = std::move(kv_commit_queue.front());
+      kv_commit_queue.pop_front();
+      // let kv_sync_thread queue up the next group behind us
+      kv_commit_cond.notify_all();
+      l.unlock();
+      LOG_LATENCY(logger, cct, l_bluestore_kv_pipeline_wait_lat,
+		  mono_clock::now() - g.queued);
+      _kv_commit_group(g);
+      l.lock();
+    }
+  }
+  dout(10) << __func__ << " finish" << dendl;
+  kv_commit_started = false;
+}
+
 void BlueStore::_kv_finalize_thread()
 {
   deque<TransContext*> kv_committed;
@@ -10587,7 +11654,8 @@ void BlueStore::_kv_finalize_thread()
 
       if (!deferred_aggressive) {
 	if (deferred_queue_size >= deferred_batch_ops.load() ||
-	    throttle_deferred_bytes.past_midpoint()) {
+	    throttle_deferred_bytes.past_midpoint() ||
+	    _deferred_flush_window_expired()) {
 	  deferred_try_submit();
 	}
       }
@@ -10640,7 +11708,7 @@ void BlueStore::_deferred_queue(TransContext *txc)
 	cct, wt.seq, e.offset, e.length, p);
     }
   }
-  if (deferred_aggressive &&
+  if (_deferred_aggressive(txc->osr.get()) &&
       !txc->osr->deferred_running) {
     _deferred_submit_unlock(txc->osr.get());
   } else {
@@ -10653,11 +11721,25 @@ void BlueStore::deferred_try_submit()
   dout(20) << __func__ << " " << deferred_queue.size() << " osrs, "
 	   << deferred_queue_size << " txcs" << dendl;
   std::lock_guard l(deferred_lock);
+  deferred_last_submit = mono_clock::now();
   vector<OpSequencerRef> osrs;
   osrs.reserve(deferred_queue.size());
   for (auto& osr : deferred_queue) {
     osrs.push_back(&osr);
   }
+  if (cct->_conf->bluestore_deferred_merge) {
+    vector<OpSequencerRef> ready;
+    for (auto& osr : osrs) {
+      if (osr->deferred_pending && !osr->deferred_running) {
+	ready.push_back(osr);
+      }
+    }
+    if (ready.size() > 1) {
+      _deferred_submit_merged_unlock(ready);
+      deferred_lock.lock();
+      return;
+    }
+  }
   for (auto& osr : osrs) {
     if (osr->deferred_pending) {
       if (!osr->deferred_running) {
@@ -10673,6 +11755,17 @@ void BlueStore::deferred_try_submit()
   }
 }
 
+void BlueStore::deferred_try_submit(OpSequencer *osr)
+{
+  dout(20) << __func__ << " osr " << osr << dendl;
+  deferred_lock.lock();
+  if (osr->deferred_pending && !osr->deferred_running) {
+    _deferred_submit_unlock(osr);
+  } else {
+    deferred_lock.unlock();
+  }
+}
+
 void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
 {
   dout(10) << __func__ << " osr " << osr
@@ -10730,11 +11823,100 @@ void BlueStore::_deferred_submit_unlock(OpSequencer *osr)
   bdev->aio_submit(&b->ioc);
 }
 
+void BlueStore::_deferred_submit_merged_unlock(vector<OpSequencerRef>& osrs)
+{
+  dout(10) << __func__ << " " << osrs.size() << " osrs" << dendl;
+  auto f = new DeferredFlush(cct);
+  for (auto& osr : osrs) {
+    ceph_assert(osr->deferred_pending);
+    ceph_assert(!osr->deferred_running);
+    auto b = osr->deferred_pending;
+    deferred_queue_size -= b->seq_bytes.size();
+    ceph_assert(deferred_queue_size >= 0);
+    osr->deferred_running = osr->deferred_pending;
+    osr->deferred_pending = nullptr;
+    f->batches.push_back(b);
+  }
+
+  deferred_lock.unlock();
+
+  // sort the extents from every batch by disk offset.  batches never
+  // overlap (an extent with a deferred write in flight cannot be
+  // released and reallocated until that write is done), but be
+  // defensive and only merge extents that are exactly adjacent.
+  multimap<uint64_t,bufferlist*> extents;
+  for (auto b : f->batches) {
+    for (auto& txc : b->txcs) {
+      txc.log_state_latency(logger, l_bluestore_state_deferred_queued_lat);
+    }
+    for (auto& i : b->iomap) {
+      extents.emplace(i.first, &i.second.bl);
+    }
+  }
+
+  uint64_t start = 0, pos = 0;
+  bufferlist bl;
+  auto i = extents.begin();
+  while (true) {
+    if (i == extents.end() || i->first != pos) {
+      if (bl.length()) {
+	dout(20) << __func__ << " write 0x" << std::hex
+		 << start << "~" << bl.length() << std::dec << dendl;
+	if (!g_conf()->bluestore_debug_omit_block_device_write) {
+	  logger->inc(l_bluestore_deferred_write_ops);
+	  logger->inc(l_bluestore_deferred_write_bytes, bl.length());
+	  int r = bdev->aio_write(start, bl, &f->ioc, false);
+	  ceph_assert(r == 0);
+	}
+      }
+      if (i == extents.end()) {
+	break;
+      }
+      pos = i->first;
+      bl.clear();
+    }
+    if (!bl.length()) {
+      start = pos;
+    }
+    pos += i->second->length();
+    bl.claim_append(*i->second);
+    ++i;
+  }
+
+  bdev->aio_submit(&f->ioc);
+}
+
+void BlueStore::_deferred_flush_finish(DeferredFlush *f)
+{
+  dout(10) << __func__ << " " << f << " " << f->batches.size() << " batches"
+	   << dendl;
+  for (auto b : f->batches) {
+    _deferred_aio_finish(b->osr);
+  }
+  delete f;
+}
+
+bool BlueStore::_deferred_flush_window_expired()
+{
+  double window = cct->_conf->bluestore_deferred_flush_window;
+  if (window <= 0 || deferred_queue_size == 0) {
+    return false;
+  }
+  return mono_clock::now() - deferred_last_submit.load() >=
+    ceph::make_timespan(window);
+}
+
 struct C_DeferredTrySubmit : public Context {
   BlueStore *store;
-  C_DeferredTrySubmit(BlueStore *s) : store(s) {}
+  BlueStore::OpSequencerRef osr;  ///< or null for all of them
+  C_DeferredTrySubmit(BlueStore *s, BlueStore::OpSequencer *osr = nullptr)
+    : store(s), osr(osr) {}
   void finish(int r) {
-    store->deferred_try_submit();
+    if (osr) {
+      store->deferred_try_submit(osr.get());
+    } else {
+      store->deferred_try_submit();
+    }
   }
 };
 
@@ -10755,6 +11937,10 @@ void BlueStore::_deferred_aio_finish(OpSequencer *osr)
     } else if (deferred_aggressive) {
       dout(20) << __func__ << " queuing async deferred_try_submit" << dendl;
       deferred_finisher.queue(new C_DeferredTrySubmit(this));
+    } else if (osr->deferred_aggressive) {
+      dout(20) << __func__ << " queuing async deferred_try_submit of osr"
+	       << dendl;
+      deferred_finisher.queue(new C_DeferredTrySubmit(this, osr));
     } else {
       dout(20) << __func__ << " leaving queued, more pending" << dendl;
     }
@@ -10778,7 +11964,7 @@ void BlueStore::_deferred_aio_finish(OpSequencer *osr)
 
   // in the normal case, do not bother waking up the kv thread; it will
   // catch us on the next commit anyway.
-  if (deferred_aggressive) {
+  if (_deferred_aggressive(osr)) {
     std::lock_guard l(kv_lock);
     kv_cond.notify_one();
   }
@@ -10833,6 +12019,51 @@ int BlueStore::_deferred_replay()
 // ---------------------------
 // transactions
 
+void BlueStore::_set_transaction_trace(const std::string& path)
+{
+  std::lock_guard l(trace_lock);
+  if (trace_fd >= 0) {
+    dout(1) << __func__ << " stopped tracing transactions" << dendl;
+    tracing = false;
+    VOID_TEMP_FAILURE_RETRY(::close(trace_fd));
+    trace_fd = -1;
+  }
+  if (path.empty()) {
+    return;
+  }
+  int fd = ::open(path.c_str(), O_WRONLY|O_CREAT|O_APPEND|O_CLOEXEC, 0644);
+  if (fd < 0) {
+    int r = -errno;
+    derr << __func__ << " failed to open " << path << ": "
+	 << cpp_strerror(r) << dendl;
+    return;
+  }
+  dout(1) << __func__ << " tracing transactions to " << path << dendl;
+  trace_fd = fd;
+  tracing = true;
+}
+
+void BlueStore::_trace_transactions(const coll_t& cid,
+				    const vector<Transaction>& tls)
+{
+  transaction_trace_record_t rec;
+  rec.stamp = ceph_clock_now();
+  rec.cid = cid;
+  rec.tls = tls;
+  std::lock_guard l(trace_lock);
+  if (trace_fd < 0) {
+    return;
+  }
+  int r = rec.write(trace_fd);
+  if (r < 0) {
+    derr << __func__ << " failed to write: " << cpp_strerror(r)
+	 << ", stopped tracing transactions" << dendl;
+    tracing = false;
+    VOID_TEMP_FAILURE_RETRY(::close(trace_fd));
+    trace_fd = -1;
+  }
+}
+
 int BlueStore::queue_transactions(
   CollectionHandle& ch,
   vector<Transaction>& tls,
@@ -10861,6 +12092,11 @@ int BlueStore::queue_transactions(
   dout(10) << __func__ << " ch " << c << " " << c->cid << dendl;
 
   // prepare
+  std::unique_lock sl(osr->submit_lock);
+  if (tracing) {
+    // under submit_lock, so the trace has each collection's in order
+    _trace_transactions(c->cid, tls);
+  }
   TransContext *txc = _txc_create(static_cast<Collection*>(ch.get()), osr,
 				  &on_commit);
 
@@ -10869,7 +12105,47 @@ int BlueStore::queue_transactions(
     _txc_add_transaction(txc, &(*p));
   }
   _txc_calc_cost(txc);
+  if (cct->_conf->bluestore_pool_latency_histograms &&
+      txc->osd_pool_id != META_POOL_ID) {
+    txc->pool_logger = _get_pool_logger(txc->osd_pool_id);
+  }
+  _txc_prepare_submit(txc);
+  sl.unlock();
+
+  if (handle)
+    handle->suspend_tp_timeout();
+
+  auto tstart = mono_clock::now();
+  _txc_throttle(txc);
+  auto tend = mono_clock::now();
+
+  if (handle)
+    handle->reset_tp_timeout();
+
+  logger->inc(l_bluestore_txc);
 
+  // execute (start)
+  _txc_state_proc(txc);
+
+  // we're immediately readable (unlike FileStore)
+  for (auto c : on_applied_sync) {
+    c->complete(0);
+  }
+  if (!on_applied.empty()) {
+    if (c->commit_queue) {
+      c->commit_queue->queue(on_applied);
+    } else {
+      finisher.queue(on_applied);
+    }
+  }
+
+  LOG_LATENCY(logger, cct, l_bluestore_submit_lat, mono_clock::now() - start);
+  LOG_LATENCY(logger, cct, l_bluestore_throttle_lat, tend - tstart);
+  return 0;
+}
+
+void BlueStore::_txc_prepare_submit(TransContext *txc)
+{
   _txc_write_nodes(txc, txc->t);
 
   // journal deferred items
@@ -10883,10 +12159,10 @@ int BlueStore::queue_transactions(
   }
 
   _txc_finalize_kv(txc, txc->t);
-  if (handle)
-    handle->suspend_tp_timeout();
+}
 
-  auto tstart = mono_clock::now();
+void BlueStore::_txc_throttle(TransContext *txc)
+{
   throttle_bytes.get(txc->cost);
   if (txc->deferred_txn) {
     // ensure we do not block here because of deferred writes
@@ -10904,31 +12180,6 @@ int BlueStore::queue_transactions(
       --deferred_aggressive;
    }
   }
-  auto tend = mono_clock::now();
-
-  if (handle)
-    handle->reset_tp_timeout();
-
-  logger->inc(l_bluestore_txc);
-
-  // execute (start)
-  _txc_state_proc(txc);
-
-  // we're immediately readable (unlike FileStore)
-  for (auto c : on_applied_sync) {
-    c->complete(0);
-  }
-  if (!on_applied.empty()) {
-    if (c->commit_queue) {
-      c->commit_queue->queue(on_applied);
-    } else {
-      finisher.queue(on_applied);
-    }
-  }
-
-  LOG_LATENCY(logger, cct, l_bluestore_submit_lat, mono_clock::now() - start);
-  LOG_LATENCY(logger, cct, l_bluestore_throttle_lat, tend - tstart);
-  return 0;
 }
 
 void BlueStore::_txc_aio_submit(TransContext *txc)
@@ -11858,6 +13109,39 @@ void BlueStore::_do_write_big(
   }
 }
 
+int BlueStore::_compress(
+  CompressorRef& c,
+  const bufferlist& in,
+  bluestore_compression_header_t* chdr,
+  bufferlist* out)
+{
+  uint64_t frame_size = comp_frame_size;
+  if (!frame_size || in.length() < frame_size * 2) {
+    int r = c->compress(in, *out);
+    chdr->length = out->length();
+    return r;
+  }
+
+  // compress each frame on its own so that it can be decompressed
+  // without the ones before it
+  chdr->frame_size = frame_size;
+  for (uint64_t off = 0; off < in.length(); off += frame_size) {
+    bufferlist raw, t;
+    raw.substr_of(in, off, std::min<uint64_t>(frame_size, in.length() - off));
+    int r = c->compress(raw, t);
+    if (r != 0) {
+      return r;
+    }
+    chdr->frames.push_back(t.length());
+    out->claim_append(t);
+  }
+  chdr->length = out->length();
+  dout(20) << __func__ << " 0x" << std::hex << in.length()
+	   << " in " << std::dec << chdr->frames.size() << " frames of 0x"
+	   << std::hex << frame_size << std::dec << dendl;
+  return 0;
+}
+
 int BlueStore::_do_alloc_write(
   TransContext *txc,
   CollectionRef coll,
@@ -11936,7 +13220,8 @@ int BlueStore::_do_alloc_write(
 
       // FIXME: memory alignment here is bad
       bufferlist t;
-      int r = c->compress(wi.bl, t);
+      bluestore_compression_header_t chdr(c->get_type());
+      int r = _compress(c, wi.bl, &chdr, &t);
       uint64_t want_len_raw = wi.blob_length * crr;
       uint64_t want_len = p2roundup(want_len_raw, min_alloc_size);
       bool rejected = false;
@@ -11945,9 +13230,6 @@ int BlueStore::_do_alloc_write(
       // that doesn't take header overhead  into account
       uint64_t result_len = p2roundup(compressed_len, min_alloc_size);
       if (r == 0 && result_len <= want_len && result_len < wi.blob_length) {
-	bluestore_compression_header_t chdr;
-	chdr.type = c->get_type();
-	chdr.length = t.length();
 	encode(chdr, wi.compressed_bl);
 	wi.compressed_bl.claim_append(t);
 
@@ -12005,9 +13287,31 @@ int BlueStore::_do_alloc_write(
   PExtentVector prealloc;
   prealloc.reserve(2 * wctx->writes.size());;
   int64_t prealloc_left = 0;
-  prealloc_left = alloc->allocate(
-    need, min_alloc_size, need,
-    0, &prealloc);
+  // take what we can in the pool's preferred unit; the remainder, or all
+  // of it if the allocator has no chunks that large, in min_alloc_size
+  uint64_t big = wctx->alloc_unit ? p2align(need, wctx->alloc_unit) : 0;
+  if (big) {
+    prealloc_left = alloc->allocate(
+      big, wctx->alloc_unit, big,
+      0, &prealloc);
+    if (prealloc_left < (int64_t)big) {
+      dout(20) << __func__ << " no room for 0x" << std::hex << big
+	       << " in 0x" << wctx->alloc_unit << " units" << std::dec << dendl;
+      if (prealloc.size()) {
+	alloc->release(prealloc);
+      }
+      prealloc.clear();
+      prealloc_left = 0;
+    }
+  }
+  if (prealloc_left < (int64_t)need) {
+    int64_t r = alloc->allocate(
+      need - prealloc_left, min_alloc_size, need - prealloc_left,
+      0, &prealloc);
+    if (r > 0) {
+      prealloc_left += r;
+    }
+  }
   if (prealloc_left < (int64_t)need) {
     derr << __func__ << " failed to allocate 0x" << std::hex << need
          << " allocated 0x " << prealloc_left
@@ -12023,6 +13327,8 @@ int BlueStore::_do_alloc_write(
   dout(20) << __func__ << " prealloc " << prealloc << dendl;
   auto prealloc_pos = prealloc.begin();
 
+  // csums of all blobs are computed together once the loop is done
+  Checksummer::crc32c_batch csum_batch;
   for (auto& wi : wctx->writes) {
     BlobRef b = wi.b;
     bluestore_blob_t& dblob = b->dirty_blob();
@@ -12097,7 +13403,7 @@ int BlueStore::_do_alloc_write(
 
     dout(20) << __func__ << " blob " << *b << dendl;
     if (dblob.has_csum()) {
-      dblob.calc_csum(b_off, *l);
+      dblob.calc_csum(b_off, *l, &csum_batch);
     }
 
     if (wi.mark_unused) {
@@ -12147,6 +13453,7 @@ int BlueStore::_do_alloc_write(
       }
     }
   }
+  csum_batch.flush();
   ceph_assert(prealloc_pos == prealloc.end());
   ceph_assert(prealloc_left == 0);
   return 0;
@@ -12364,8 +13671,16 @@ void BlueStore::_choose_write_options(
     wctx->target_blob_size = min_alloc_size * 2;
   }
 
+  int64_t au;
+  if (c->pool_opts.get(pool_opts_t::ALLOC_UNIT, &au) &&
+      au > (int64_t)min_alloc_size) {
+    // both are powers of two, so au is a multiple of min_alloc_size
+    wctx->alloc_unit = au;
+  }
+
   dout(20) << __func__ << " prefer csum_order " << wctx->csum_order
            << " target_blob_size 0x" << std::hex << wctx->target_blob_size
+	   << " alloc_unit 0x" << wctx->alloc_unit
 	   << " compress=" << (int)wctx->compress
 	   << " buffered=" << (int)wctx->buffered
            << std::dec << dendl;
@@ -12422,6 +13737,111 @@ int BlueStore::_do_gc(
   return 0;
 }
 
+bool BlueStore::_defrag_wanted(OnodeRef& o)
+{
+  uint64_t min_extents =
+    cct->_conf.get_val<uint64_t>("bluestore_defrag_min_extents");
+  o->extent_map.fault_range(db, 0, o->onode.size);
+  auto& em = o->extent_map.extent_map;
+  if (em.size() < min_extents) {
+    return false;
+  }
+
+  uint64_t data = 0;
+  for (auto& e : em) {
+    if (e.blob->get_blob().is_shared()) {
+      // rewriting would unshare the data with clones
+      return false;
+    }
+    data += e.length;
+  }
+  uint64_t ideal = data / std::max<uint64_t>(max_blob_size, min_alloc_size) + 1;
+  return em.size() >= ideal * 2;
+}
+
+int64_t BlueStore::_defrag_object(CollectionRef& c, const ghobject_t& oid)
+{
+  OpSequencer *osr = c->osr.get();
+  std::unique_lock sl(osr->submit_lock);
+  TransContext *txc = nullptr;
+  uint64_t rewritten = 0;
+  {
+    RWLock::WLocker l(c->lock);
+    if (!c->exists) {
+      return 0;
+    }
+    OnodeRef o = c->get_onode(oid, false);
+    if (!o || !o->exists || !_defrag_wanted(o)) {
+      return 0;
+    }
+    // once the old extents are punched there is no way back, so make
+    // sure the new ones fit
+    if (alloc->get_free() < o->onode.size * 2 + min_alloc_size) {
+      dout(10) << __func__ << " " << oid << " not enough free space" << dendl;
+      return 0;
+    }
+
+    dout(10) << __func__ << " " << c->cid << " " << oid << " "
+	     << o->extent_map.extent_map.size() << " extents, "
+	     << o->extent_map.spanning_blob_map.size() << " spanning blobs"
+	     << dendl;
+    _dump_onode<20>(o);
+
+    // collect the data ranges, leaving holes as they are
+    interval_set<uint64_t> ranges;
+    for (auto& e : o->extent_map.extent_map) {
+      ranges.union_insert(e.logical_offset, e.length);
+    }
+
+    // read it all before touching anything, so an object that can't be
+    // read (a csum error, say) is left alone
+    map<uint64_t, bufferlist> data;
+    for (auto p = ranges.begin(); p != ranges.end(); ++p) {
+      bufferlist& bl = data[p.get_start()];
+      int r = _do_read(c.get(), o, p.get_start(), p.get_len(), bl, 0);
+      if (r < 0) {
+	derr << __func__ << " " << c->cid << " " << oid << " read 0x"
+	     << std::hex << p.get_start() << "~" << p.get_len() << std::dec
+	     << " failed: " << cpp_strerror(r) << ", skipping it" << dendl;
+	return r;
+      }
+      ceph_assert(r == (int)p.get_len());
+    }
+
+    txc = _txc_create(c.get(), osr, nullptr);
+    WriteContext wctx;
+    _choose_write_options(c, o, 0, &wctx);
+    for (auto& p : data) {
+      uint64_t len = p.second.length();
+      _do_write_data(txc, c, o, p.first, len, p.second, &wctx);
+      rewritten += len;
+    }
+    int r = _do_alloc_write(txc, c, o, &wctx);
+    if (r < 0) {
+      derr << __func__ << " _do_alloc_write failed with " << cpp_strerror(r)
+	   << dendl;
+      ceph_abort_msg("unexpected error during defrag");
+    }
+    _wctx_finish(txc, c, o, &wctx);
+    o->extent_map.compress_extent_map(0, o->onode.size);
+    o->extent_map.dirty_range(0, o->onode.size);
+    txc->write_onode(o);
+    txc->bytes += rewritten;
+    dout(20) << __func__ << " " << oid << " now "
+	     << o->extent_map.extent_map.size() << " extents" << dendl;
+    _dump_onode<20>(o);
+
+    _txc_calc_cost(txc);
+    _txc_prepare_submit(txc);
+  }
+  sl.unlock();
+
+  _txc_throttle(txc);
+  logger->inc(l_bluestore_txc);
+  _txc_state_proc(txc);
+  return rewritten;
+}
+
 int BlueStore::_do_write(
   TransContext *txc,
   CollectionRef& c,
@@ -12684,6 +14104,7 @@ int BlueStore::_do_remove(
 
   dout(20) << __func__ << " checking for unshareable blobs on " << h
 	   << " " << h->oid << dendl;
+  h->extent_map.fault_range(db, 0, OBJECT_MAX_SIZE);
   map<SharedBlob*,bluestore_extent_ref_map_t> expect;
   for (auto& e : h->extent_map.extent_map) {
     const bluestore_blob_t& b = e.blob->get_blob();
@@ -13084,7 +14505,8 @@ int BlueStore::_clone(TransContext *txc,
     }
     const string& prefix =
       newo->onode.is_pgmeta_omap() ? PREFIX_PGMETA_OMAP : PREFIX_OMAP;
-    KeyValueDB::Iterator it = db->get_iterator(prefix);
+    KeyValueDB::Iterator it =
+      db->get_iterator(prefix, get_omap_bounds(oldo->onode.nid));
     string head, tail;
     get_omap_header(oldo->onode.nid, &head);
     get_omap_tail(oldo->onode.nid, &tail);
@@ -13362,17 +14784,20 @@ int BlueStore::_split_collection(TransContext *txc,
 {
   dout(15) << __func__ << " " << c->cid << " to " << d->cid << " "
 	   << " bits " << bits << dendl;
-  RWLock::WLocker l(c->lock);
-  RWLock::WLocker l2(d->lock);
-  int r;
 
   // flush all previous deferred writes on this sequencer.  this is a bit
   // heavyweight, but we need to make sure all deferred writes complete
   // before we split as the new collection's sequencer may need to order
   // this after those writes, and we don't bother with the complexity of
-  // moving those TransContexts over to the new osr.
+  // moving those TransContexts over to the new osr.  the caller queues
+  // nothing else on it meanwhile, so this needn't hold the collection
+  // locks, which keeps the readers of the parent going.
   _osr_drain_preceding(txc);
 
+  RWLock::WLocker l(c->lock);
+  RWLock::WLocker l2(d->lock);
+  int r;
+
   // move any cached items (onodes and referenced shared blobs) that will
   // belong to the child collection post-split.  leave everything else behind.
   // this may include things that don't strictly belong to the now-smaller
@@ -13415,18 +14840,20 @@ int BlueStore::_merge_collection(
 {
   dout(15) << __func__ << " " << (*c)->cid << " to " << d->cid
 	   << " bits " << bits << dendl;
-  RWLock::WLocker l((*c)->lock);
-  RWLock::WLocker l2(d->lock);
-  int r;
-
-  coll_t cid = (*c)->cid;
 
   // flush all previous deferred writes on the source collection to ensure
   // that all deferred writes complete before we merge as the target collection's
-  // sequencer may need to order new ops after those writes.
+  // sequencer may need to order new ops after those writes.  as for a split,
+  // do it before taking the collection locks.
 
   _osr_drain((*c)->osr.get());
 
+  RWLock::WLocker l((*c)->lock);
+  RWLock::WLocker l2(d->lock);
+  int r;
+
+  coll_t cid = (*c)->cid;
+
   // move any cached items (onodes and referenced shared blobs) that will
   // belong to the child collection post-split.  leave everything else behind.
   // this may include things that don't strictly belong to the now-smaller
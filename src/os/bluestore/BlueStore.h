@@ -64,6 +64,8 @@ enum {
   l_bluestore_kv_commit_lat,
   l_bluestore_kv_sync_lat,
   l_bluestore_kv_final_lat,
+  l_bluestore_kv_submit_lat,
+  l_bluestore_kv_pipeline_wait_lat,
   l_bluestore_state_prepare_lat,
   l_bluestore_state_aio_wait_lat,
   l_bluestore_state_io_done_lat,
@@ -75,6 +77,18 @@ enum {
   l_bluestore_state_deferred_cleanup_lat,
   l_bluestore_state_finishing_lat,
   l_bluestore_state_done_lat,
+  // 2d histograms (latency x txc bytes), same order as the state_*_lat above
+  l_bluestore_state_prepare_lat_hist,
+  l_bluestore_state_aio_wait_lat_hist,
+  l_bluestore_state_io_done_lat_hist,
+  l_bluestore_state_kv_queued_lat_hist,
+  l_bluestore_state_kv_committing_lat_hist,
+  l_bluestore_state_kv_done_lat_hist,
+  l_bluestore_state_deferred_queued_lat_hist,
+  l_bluestore_state_deferred_aio_wait_lat_hist,
+  l_bluestore_state_deferred_cleanup_lat_hist,
+  l_bluestore_state_finishing_lat_hist,
+  l_bluestore_state_done_lat_hist,
   l_bluestore_throttle_lat,
   l_bluestore_submit_lat,
   l_bluestore_commit_lat,
@@ -130,6 +144,23 @@ enum {
   l_bluestore_last
 };
 
+// per-pool state latency histograms, see bluestore_pool_latency_histograms
+enum {
+  l_bluestore_pool_first = 732700,
+  l_bluestore_pool_state_prepare_lat_hist,
+  l_bluestore_pool_state_aio_wait_lat_hist,
+  l_bluestore_pool_state_io_done_lat_hist,
+  l_bluestore_pool_state_kv_queued_lat_hist,
+  l_bluestore_pool_state_kv_committing_lat_hist,
+  l_bluestore_pool_state_kv_done_lat_hist,
+  l_bluestore_pool_state_deferred_queued_lat_hist,
+  l_bluestore_pool_state_deferred_aio_wait_lat_hist,
+  l_bluestore_pool_state_deferred_cleanup_lat_hist,
+  l_bluestore_pool_state_finishing_lat_hist,
+  l_bluestore_pool_state_done_lat_hist,
+  l_bluestore_pool_last
+};
+
 #define META_POOL_ID ((uint64_t)-1ull)
 
 class BlueStore : public ObjectStore,
@@ -777,6 +808,7 @@ public:
     mempool::bluestore_cache_other::vector<Shard> shards;    ///< shards
 
     bufferlist inline_bl;    ///< cached encoded map, if unsharded; empty=>dirty
+    bool inline_pending = false; ///< inline_bl not decoded yet
 
     uint32_t needs_reshard_begin = 0;
     uint32_t needs_reshard_end = 0;
@@ -812,9 +844,18 @@ public:
       extent_map.clear_and_dispose(DeleteDisposer());
       shards.clear();
       inline_bl.clear();
+      inline_pending = false;
       clear_needs_reshard();
     }
 
+    /// decode the inline map deferred by get_onode, if any
+    void load_inline() {
+      if (inline_pending) {
+	inline_pending = false;
+	decode_some(inline_bl);
+      }
+    }
+
     void dump(Formatter* f) const;
 
     bool encode_some(uint32_t offset, uint32_t length, bufferlist& bl,
@@ -1048,6 +1089,9 @@ public:
     mempool::bluestore_cache_other::string key;
 
     boost::intrusive::list_member_hook<> lru_item;
+    /// set on a lookup hit, consumed by trim (second chance) so that hits
+    /// do not need the cache shard lock to reorder the lru
+    std::atomic<bool> lru_touched = {false};
 
     bluestore_onode_t onode;  ///< metadata stored as value in kv store
     bool exists;              ///< true if object logically exists
@@ -1087,6 +1131,13 @@ public:
 
   /// a cache (shard) of onodes and buffers
   struct Cache {
+    typedef boost::intrusive::list<
+      Onode,
+      boost::intrusive::member_hook<
+        Onode,
+	boost::intrusive::list_member_hook<>,
+	&Onode::lru_item> > onode_lru_list_t;
+
     CephContext* cct;
     PerfCounters *logger;
 
@@ -1097,6 +1148,16 @@ public:
     std::atomic<uint64_t> num_extents = {0};
     std::atomic<uint64_t> num_blobs = {0};
 
+    /// what trimming dropped lately, to count the misses that a larger
+    /// cache would have hit; protected by lock
+    PriorityCache::GhostCache onode_ghost;   ///< in onodes, not bytes
+    PriorityCache::GhostCache buffer_ghost;
+    PriorityCache::MissStats onode_miss_stats;
+    PriorityCache::MissStats buffer_miss_stats;
+    /// keep the ghosts and the miss stats at all; only the autotuner's
+    /// miss weights (bluestore_cache_autotune_max_miss_weight) use them
+    std::atomic<bool> track_misses = {false};
+
     static Cache *create(CephContext* cct, string type, PerfCounters *logger);
 
     Cache(CephContext* cct) : cct(cct), logger(nullptr) {}
@@ -1129,11 +1190,23 @@ public:
       --num_blobs;
     }
 
+    void _ghost_onode(Onode *o);
+    void _ghost_buffer(Buffer *b);
+    /// note a buffer miss at offset, under lock
+    void _note_buffer_miss(BufferSpace *space, uint32_t offset);
+    /// note an onode read from the db and the seconds it took, under lock
+    void _note_onode_miss(const ghobject_t& oid, double seconds);
+    /// note n buffer misses read from the device in the seconds given
+    void note_buffer_misses(unsigned n, double seconds);
+    void add_miss_stats(PriorityCache::MissStats *onode,
+			PriorityCache::MissStats *buffer);
+
     void trim(uint64_t onode_max, uint64_t buffer_max);
 
     void trim_all();
 
     virtual void _trim(uint64_t onode_max, uint64_t buffer_max) = 0;
+    void _trim_onodes(onode_lru_list_t& onode_lru, uint64_t onode_max);
 
     virtual void add_stats(uint64_t *onodes, uint64_t *extents,
 			   uint64_t *blobs,
@@ -1155,12 +1228,6 @@ public:
   /// simple LRU cache for onodes and buffers
   struct LRUCache : public Cache {
   private:
-    typedef boost::intrusive::list<
-      Onode,
-      boost::intrusive::member_hook<
-        Onode,
-	boost::intrusive::list_member_hook<>,
-	&Onode::lru_item> > onode_lru_list_t;
     typedef boost::intrusive::list<
       Buffer,
       boost::intrusive::member_hook<
@@ -1248,12 +1315,6 @@ public:
   struct TwoQCache : public Cache {
   private:
     // stick with LRU for onodes for now (fixme?)
-    typedef boost::intrusive::list<
-      Onode,
-      boost::intrusive::member_hook<
-        Onode,
-	boost::intrusive::list_member_hook<>,
-	&Onode::lru_item> > onode_lru_list_t;
     typedef boost::intrusive::list<
       Buffer,
       boost::intrusive::member_hook<
@@ -1343,6 +1404,12 @@ public:
   private:
     Cache *cache;
 
+    /// protect onode_map; taken shared on lookup so that hits stay off
+    /// the cache shard lock.  nests inside Cache::lock.  no lockdep:
+    /// split_cache() holds two of these at once.
+    ceph::shared_mutex map_lock = ceph::make_shared_mutex(
+      "BlueStore::OnodeSpace::map_lock", true, false);
+
     /// forward lookups
     mempool::bluestore_cache_other::unordered_map<ghobject_t,OnodeRef> onode_map;
 
@@ -1354,11 +1421,13 @@ public:
       clear();
     }
 
-    OnodeRef add(const ghobject_t& oid, OnodeRef o);
+    /// miss_seconds, if >= 0, is how long o took to read, for the miss stats
+    OnodeRef add(const ghobject_t& oid, OnodeRef o, double miss_seconds = -1);
     OnodeRef lookup(const ghobject_t& o);
-    void remove(const ghobject_t& oid) {
-      onode_map.erase(oid);
-    }
+    /// drop o from the map unless it is pinned; the caller must hold the
+    /// cache lock.  returns the map's ref so it can be released after the
+    /// onode has been unlinked from the lru.
+    OnodeRef trim_unpinned(Onode *o);
     void rename(OnodeRef& o, const ghobject_t& old_oid,
 		const ghobject_t& new_oid,
 		const mempool::bluestore_cache_other::string& new_okey);
@@ -1608,6 +1677,16 @@ public:
       utime_t lat, now = ceph_clock_now();
       lat = now - last_stamp;
       logger->tinc(state, lat);
+      if (state >= l_bluestore_state_prepare_lat &&
+	  state <= l_bluestore_state_done_lat) {
+	int i = state - l_bluestore_state_prepare_lat;
+	logger->hinc(l_bluestore_state_prepare_lat_hist + i,
+		     lat.to_nsec(), bytes);
+	if (pool_logger) {
+	  pool_logger->hinc(l_bluestore_pool_state_prepare_lat_hist + i,
+			    lat.to_nsec(), bytes);
+	}
+      }
 #if defined(WITH_LTTNG) && defined(WITH_EVENTTRACE)
       if (state >= l_bluestore_state_prepare_lat && state <= l_bluestore_state_done_lat) {
         double usecs = (now.to_nsec()-last_stamp.to_nsec())/1000;
@@ -1639,6 +1718,7 @@ public:
     interval_set<uint64_t> allocated, released;
     volatile_statfs statfs_delta;	   ///< overall store statistics delta
     uint64_t osd_pool_id = META_POOL_ID;    ///< osd pool id we're operating on
+    PerfCounters *pool_logger = nullptr;    ///< per-pool histograms, if enabled
     
     IOContext ioc;
     bool had_ios = false;  ///< true if we submitted IOs before our kv txn
@@ -1725,10 +1805,26 @@ public:
     }
   };
 
+  /// deferred batches from several sequencers flushed as one merged io set
+  struct DeferredFlush final : public AioContext {
+    vector<DeferredBatch*> batches;  ///< running batches we flush
+    IOContext ioc;                   ///< our aios
+
+    explicit DeferredFlush(CephContext *cct)
+      : ioc(cct, this) {}
+
+    void aio_finish(BlueStore *store) override {
+      store->_deferred_flush_finish(this);
+    }
+  };
+
   class OpSequencer : public RefCountedObject {
   public:
     ceph::mutex qlock = ceph::make_mutex("BlueStore::OpSequencer::qlock");
     ceph::condition_variable qcond;
+    /// serializes txc preparation between callers and internal rewrites
+    ceph::mutex submit_lock =
+      ceph::make_mutex("BlueStore::OpSequencer::submit_lock");
     typedef boost::intrusive::list<
       TransContext,
       boost::intrusive::member_hook<
@@ -1755,6 +1851,9 @@ public:
 
     std::atomic_bool zombie = {false};    ///< in zombie_osr set (collection going away)
 
+    /// being drained, so its deferred io is submitted right away
+    std::atomic_int deferred_aggressive = {0};
+
     OpSequencer(BlueStore *store, const coll_t& c)
       : RefCountedObject(store->cct, 0),
 	store(store), cid(c) {
@@ -1859,6 +1958,14 @@ public:
       return NULL;
     }
   };
+  struct KVCommitThread : public Thread {
+    BlueStore *store;
+    explicit KVCommitThread(BlueStore *s) : store(s) {}
+    void *entry() override {
+      store->_kv_commit_thread();
+      return NULL;
+    }
+  };
   struct KVFinalizeThread : public Thread {
     BlueStore *store;
     explicit KVFinalizeThread(BlueStore *s) : store(s) {}
@@ -1868,6 +1975,20 @@ public:
     }
   };
 
+  /// a commit group: flushed and submitted by kv_sync_thread, made
+  /// durable by the synct commit (on kv_commit_thread, if pipelined)
+  struct KVCommitGroup {
+    deque<TransContext*> committing;
+    deque<DeferredBatch*> deferred_stable;
+    KeyValueDB::Transaction synct;
+    interval_set<uint64_t> bluefs_reclaiming; ///< release once committed
+    uint64_t new_nid_max = 0;
+    uint64_t new_blobid_max = 0;
+    mono_clock::time_point start;
+    mono_clock::time_point after_flush;
+    mono_clock::time_point queued;
+  };
+
   struct DBHistogram {
     struct value_dist {
       uint64_t count;
@@ -1909,6 +2030,8 @@ private:
   int path_fd = -1;  ///< open handle to $path
   int fsid_fd = -1;  ///< open handle (locked) to $path/fsid
   bool mounted = false;
+  bool db_resharding = false;  ///< open a db whose layout isn't the configured one
+  std::function<void(uint64_t, uint64_t)> fsck_progress_cb;
 
   RWLock coll_lock = {"BlueStore::coll_lock"};  ///< rwlock to protect coll_map
   mempool::bluestore_cache_other::unordered_map<coll_t, CollectionRef> coll_map;
@@ -1931,11 +2054,28 @@ private:
   interval_set<uint64_t> bluefs_extents;  ///< block extents owned by bluefs
   interval_set<uint64_t> bluefs_extents_reclaiming; ///< currently reclaiming
 
+  /// allocator image saved by the last clean umount, read at _open_db
+  struct alloc_image_t {
+    uint64_t bdev_size = 0;
+    uint64_t min_alloc_size = 0;
+    uint64_t free_bytes = 0;
+    interval_set<uint64_t> bluefs_extents;
+    std::vector<std::pair<uint64_t,uint64_t>> extents;
+  };
+  std::unique_ptr<alloc_image_t> alloc_image;
+
   ceph::mutex deferred_lock = ceph::make_mutex("BlueStore::deferred_lock");
   std::atomic<uint64_t> deferred_seq = {0};
   deferred_osr_queue_t deferred_queue; ///< osr's with deferred io pending
   int deferred_queue_size = 0;         ///< num txc's queued across all osrs
+  std::atomic<mono_time> deferred_last_submit = {mono_time()}; ///< last deferred_try_submit
   atomic_int deferred_aggressive = {0}; ///< aggressive wakeup of kv thread
+  atomic_int deferred_aggressive_osrs = {0}; ///< osrs being drained, see _osr_drain
+
+  /// true if osr's deferred io shouldn't wait to be batched
+  bool _deferred_aggressive(const OpSequencer *osr) const {
+    return deferred_aggressive || osr->deferred_aggressive;
+  }
   Finisher deferred_finisher, finisher;
 
   KVSyncThread kv_sync_thread;
@@ -1951,6 +2091,16 @@ private:
   deque<TransContext*> kv_committing;        ///< currently syncing
   deque<DeferredBatch*> deferred_done_queue;   ///< deferred ios done
 
+  /// hand off commit groups so that one group is synced while the next
+  /// is flushed and submitted (bluestore_kv_sync_pipeline)
+  bool kv_pipeline = false;
+  KVCommitThread kv_commit_thread;
+  ceph::mutex kv_commit_lock = ceph::make_mutex("BlueStore::kv_commit_lock");
+  ceph::condition_variable kv_commit_cond;
+  bool kv_commit_started = false;
+  bool kv_commit_stop = false;
+  deque<KVCommitGroup> kv_commit_queue;      ///< submitted, need sync
+
   KVFinalizeThread kv_finalize_thread;
   ceph::mutex kv_finalize_lock = ceph::make_mutex("BlueStore::kv_finalize_lock");
   ceph::condition_variable kv_finalize_cond;
@@ -1958,6 +2108,15 @@ private:
   deque<DeferredBatch*> deferred_stable_to_finalize; ///< pending finalization
 
   PerfCounters *logger = nullptr;
+  /// per-pool state latency histograms, created on first use
+  ceph::mutex pool_loggers_lock =
+    ceph::make_mutex("BlueStore::pool_loggers_lock");
+  map<uint64_t, PerfCounters*> pool_loggers;
+
+  /// bluestore_debug_transaction_trace, see os/TransactionTrace.h
+  ceph::mutex trace_lock = ceph::make_mutex("BlueStore::trace_lock");
+  int trace_fd = -1;
+  std::atomic<bool> tracing = {false};
 
   list<CollectionRef> removed_collections;
 
@@ -1995,6 +2154,7 @@ private:
   CompressorRef compressor;
   std::atomic<uint64_t> comp_min_blob_size = {0};
   std::atomic<uint64_t> comp_max_blob_size = {0};
+  std::atomic<uint64_t> comp_frame_size = {0}; ///< 0 if not framing
 
   std::atomic<uint64_t> max_blob_size = {0};  ///< maximum blob size
 
@@ -2032,6 +2192,8 @@ private:
     uint64_t autotune_cache_size = 0;
     std::shared_ptr<PriorityCache::PriCache> binned_kv_cache = nullptr;
     std::shared_ptr<PriorityCache::Manager> pcm = nullptr;
+    /// caches outside the store that are tuned along with its own
+    std::map<std::string, std::shared_ptr<PriorityCache::PriCache>> other_caches;
 
     struct MempoolCache : public PriorityCache::PriCache {
       BlueStore *store;
@@ -2116,6 +2278,16 @@ private:
       double get_bytes_per_onode() const {
         return (double)_get_used_bytes() / (double)_get_num_onodes();
       }
+
+      virtual bool get_miss_stats(PriorityCache::MissStats *stats) const {
+        PriorityCache::MissStats buffer;
+        for (auto i : store->cache_shards) {
+          i->add_miss_stats(stats, &buffer);
+        }
+        // the onode ghosts count onodes
+        stats->ghost_bytes *= get_bytes_per_onode();
+        return true;
+      }
     };
     std::shared_ptr<MetaCache> meta_cache;
 
@@ -2132,6 +2304,14 @@ private:
       virtual string get_cache_name() const {
         return "BlueStore Data Cache";
       }
+
+      virtual bool get_miss_stats(PriorityCache::MissStats *stats) const {
+        PriorityCache::MissStats onode;
+        for (auto i : store->cache_shards) {
+          i->add_miss_stats(&onode, stats);
+        }
+        return true;
+      }
     };
     std::shared_ptr<DataCache> data_cache;
 
@@ -2146,6 +2326,16 @@ private:
       ceph_assert(stop == false);
       create("bstore_mempool");
     }
+    void add_cache(const std::string& name,
+		   std::shared_ptr<PriorityCache::PriCache> c) {
+      std::lock_guard l(lock);
+      if (!other_caches.emplace(name, c).second) {
+	return;
+      }
+      if (pcm != nullptr) {
+	pcm->insert(name, c);
+      }
+    }
     void shutdown() {
       lock.lock();
       stop = true;
@@ -2166,13 +2356,61 @@ private:
         PriorityCache::Priority pri);
   } mempool_thread;
 
+  struct DefragThread : public Thread {
+    BlueStore *store;
+    ceph::condition_variable cond;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::DefragThread::lock");
+    bool stop = false;
+
+    // progress, protected by lock
+    bool running = false;
+    uint64_t passes = 0;
+    utime_t pass_start;
+    double last_pass_duration = 0;
+    coll_t current_coll;
+    uint64_t colls_total = 0;
+    uint64_t colls_done = 0;
+    uint64_t objects_scanned = 0;
+    uint64_t objects_rewritten = 0;
+    uint64_t objects_failed = 0;     ///< skipped: could not be read
+    uint64_t bytes_rewritten = 0;
+
+    explicit DefragThread(BlueStore *s) : store(s) {}
+
+    void *entry() override;
+    void init() {
+      ceph_assert(stop == false);
+      create("bstore_defrag");
+    }
+    void shutdown() {
+      lock.lock();
+      stop = true;
+      cond.notify_all();
+      lock.unlock();
+      join();
+    }
+    void wakeup() {
+      std::lock_guard l(lock);
+      cond.notify_all();
+    }
+    void dump(Formatter *f);
+
+  private:
+    void _pass(std::unique_lock<ceph::mutex>& l);
+  } defrag_thread;
+
   // --------------------------------------------------------
   // private methods
 
   void _init_logger();
   void _shutdown_logger();
+  PerfCounters *_get_pool_logger(uint64_t pool);
   int _reload_logger();
 
+  /// start tracing transactions to path, or stop if it's empty
+  void _set_transaction_trace(const std::string& path);
+  void _trace_transactions(const coll_t& cid, const vector<Transaction>& tls);
+
   int _open_path();
   void _close_path();
   int _open_fsid(bool create);
@@ -2221,11 +2459,16 @@ private:
   int _open_db(bool create,
 	       bool to_repair_db=false,
 	       bool read_only = false);
+  int _parse_db_sharding(const string& spec,
+			 vector<KeyValueDB::ColumnFamily> *cfs);
   void _close_db();
   int _open_fm(KeyValueDB::Transaction t);
   void _close_fm();
   int _open_alloc();
   void _close_alloc();
+  void _write_alloc_image();
+  void _read_alloc_image();
+  bool _load_alloc_image();
   int _open_collections(int *errors=0);
   void _close_collections();
 
@@ -2278,6 +2521,8 @@ public:
 private:
   void _txc_finish_io(TransContext *txc);
   void _txc_finalize_kv(TransContext *txc, KeyValueDB::Transaction t);
+  void _txc_prepare_submit(TransContext *txc);
+  void _txc_throttle(TransContext *txc);
   void _txc_applied_kv(TransContext *txc);
   void _txc_committed_kv(TransContext *txc);
   void _txc_finish(TransContext *txc);
@@ -2292,15 +2537,21 @@ private:
   void _kv_start();
   void _kv_stop();
   void _kv_sync_thread();
+  void _kv_commit_group(KVCommitGroup& g);
+  void _kv_commit_thread();
   void _kv_finalize_thread();
 
   bluestore_deferred_op_t *_get_deferred_op(TransContext *txc, OnodeRef o);
   void _deferred_queue(TransContext *txc);
 public:
   void deferred_try_submit();
+  void deferred_try_submit(OpSequencer *osr);
 private:
   void _deferred_submit_unlock(OpSequencer *osr);
+  void _deferred_submit_merged_unlock(vector<OpSequencerRef>& osrs);
   void _deferred_aio_finish(OpSequencer *osr);
+  void _deferred_flush_finish(DeferredFlush *f);
+  bool _deferred_flush_window_expired();
   int _deferred_replay();
 
 public:
@@ -2439,7 +2690,17 @@ public:
   }
   int _fsck(bool deep, bool repair);
 
+  /// called about once a second while fsck walks the objects, with the
+  /// allocated bytes checked so far and the store's allocated total
+  void set_fsck_progress_cb(std::function<void(uint64_t, uint64_t)> cb) {
+    fsck_progress_cb = std::move(cb);
+  }
+
   void set_cache_shards(unsigned num) override;
+  void add_pri_cache(const std::string& name,
+		     std::shared_ptr<PriorityCache::PriCache> c) override {
+    mempool_thread.add_cache(name, c);
+  }
   void dump_cache_stats(Formatter *f) override {
     int onode_count = 0, buffers_bytes = 0;
     for (auto i: cache_shards) {
@@ -2473,6 +2734,9 @@ public:
 
   void get_db_statistics(Formatter *f) override;
   void generate_db_histogram(Formatter *f) override;
+  void dump_defrag_status(Formatter *f) override {
+    defrag_thread.dump(f);
+  }
   void _flush_cache();
   int flush_cache(ostream *os = NULL) override;
   void dump_perf_counters(Formatter *f) override {
@@ -2488,6 +2752,8 @@ public:
     int id,
     const string& path);
   int expand_devices(ostream& out);
+  /// move the kv store into the given column family layout
+  int reshard_db(const string& sharding, ostream& out);
   string get_device_path(unsigned id);
 
 public:
@@ -2521,6 +2787,19 @@ public:
     bufferlist& bl,
     uint32_t op_flags = 0,
     uint64_t retry_count = 0);
+  int read_crc32c(
+    CollectionHandle &c,
+    const ghobject_t& oid,
+    uint64_t offset,
+    size_t len,
+    uint32_t seed,
+    uint32_t *crc,
+    uint32_t op_flags = 0) override;
+  uint32_t _crc32c_from_csums(
+    OnodeRef& o,
+    uint64_t offset,
+    const bufferlist& bl,
+    uint32_t crc);
 
 private:
   int _fiemap(CollectionHandle &c_, const ghobject_t& oid,
@@ -2599,6 +2878,11 @@ public:
     CollectionHandle &c,   ///< [in] collection
     const ghobject_t &oid  ///< [in] object
     ) override;
+  ObjectMap::ObjectMapIterator get_omap_iterator(
+    CollectionHandle &c,   ///< [in] collection
+    const ghobject_t &oid, ///< [in] object
+    const omap_iter_hints_t &hints ///< [in] scan hints
+    ) override;
 
   void set_fsid(uuid_d u) override {
     fsid = u;
@@ -2753,6 +3037,13 @@ private:
     const bufferlist& bl,
     uint64_t logical_offset) const;
   int _decompress(bufferlist& source, bufferlist* result);
+  /// decompress num_frames frames starting at first_frame, which begins
+  /// at off in source (or the whole payload if the blob is not framed)
+  int _decompress(const bluestore_compression_header_t& chdr,
+		  const bufferlist& source,
+		  uint32_t off,
+		  unsigned first_frame, unsigned num_frames,
+		  bufferlist* result);
 
 
   // --------------------------------------------------------
@@ -2763,6 +3054,7 @@ private:
     bool compress = false;          ///< compressed write
     uint64_t target_blob_size = 0;  ///< target (max) blob size
     unsigned csum_order = 0;        ///< target checksum chunk order
+    uint64_t alloc_unit = 0;        ///< preferred big-write unit, 0 = none
 
     old_extent_map_t old_extents;   ///< must deref these blobs
 
@@ -2811,6 +3103,7 @@ private:
       compress = other.compress;
       target_blob_size = other.target_blob_size;
       csum_order = other.csum_order;
+      alloc_unit = other.alloc_unit;
     }
     void write(
       uint64_t loffs,
@@ -2854,6 +3147,11 @@ private:
     uint64_t offset, uint64_t length,
     bufferlist::iterator& blp,
     WriteContext *wctx);
+  int _compress(
+    CompressorRef& c,
+    const bufferlist& in,
+    bluestore_compression_header_t* chdr,
+    bufferlist* out);
   int _do_alloc_write(
     TransContext *txc,
     CollectionRef c,
@@ -2875,6 +3173,11 @@ private:
   void _pad_zeros(bufferlist *bl, uint64_t *offset,
 		  uint64_t chunk_size);
 
+  bool _defrag_wanted(OnodeRef& o);
+  /// rewrite a fragmented object in place, return bytes rewritten or
+  /// the error reading it
+  int64_t _defrag_object(CollectionRef& c, const ghobject_t& oid);
+
   void _choose_write_options(CollectionRef& c,
                              OnodeRef o,
                              uint32_t fadvise_flags,
@@ -0,0 +1,152 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "HybridAllocator.h"
+
+#include <limits>
+
+#include "common/config_proxy.h"
+#include "common/debug.h"
+#include "include/intarith.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_bluestore
+#undef  dout_prefix
+#define dout_prefix *_dout << "HybridAllocator "
+
+HybridAllocator::HybridAllocator(CephContext* cct,
+				 int64_t device_size,
+				 int64_t block_size,
+				 uint64_t max_mem)
+  : AvlAllocator(cct, device_size, block_size, max_mem)
+{
+}
+
+HybridAllocator::~HybridAllocator()
+{
+  shutdown();
+}
+
+int64_t HybridAllocator::allocate(
+  uint64_t want,
+  uint64_t unit,
+  uint64_t max_alloc_size,
+  int64_t  hint,
+  PExtentVector* extents)
+{
+  ldout(cct, 10) << __func__ << std::hex
+		 << " want 0x" << want
+		 << " unit 0x" << unit
+		 << " max_alloc_size 0x" << max_alloc_size
+		 << " hint 0x" << hint
+		 << std::dec << dendl;
+  ceph_assert(isp2(unit));
+  ceph_assert(want % unit == 0);
+
+  if (max_alloc_size == 0) {
+    max_alloc_size = want;
+  }
+  if (constexpr auto cap =
+	std::numeric_limits<decltype(bluestore_pextent_t::length)>::max();
+      max_alloc_size >= cap) {
+    max_alloc_size = p2align(uint64_t(cap), _get_block_size());
+  }
+
+  std::lock_guard l(lock);
+
+  // large extents live in the trees; only go to the bitmap for the rest
+  uint64_t allocated = 0;
+  if (_get_free()) {
+    allocated = _allocate(want, unit, max_alloc_size, hint, extents);
+  }
+  if (allocated < want && bmap_alloc && bmap_alloc->get_free()) {
+    int64_t r = bmap_alloc->allocate(want - allocated, unit, max_alloc_size,
+				     hint, extents);
+    if (r > 0) {
+      allocated += r;
+    }
+  }
+  return allocated ? (int64_t)allocated : -ENOSPC;
+}
+
+uint64_t HybridAllocator::get_free()
+{
+  std::lock_guard l(lock);
+  return (bmap_alloc ? bmap_alloc->get_free() : 0) + _get_free();
+}
+
+double HybridAllocator::get_fragmentation(uint64_t alloc_unit)
+{
+  std::lock_guard l(lock);
+  uint64_t bmap_free = bmap_alloc ? bmap_alloc->get_free() : 0;
+  if (!bmap_free) {
+    return _get_fragmentation(alloc_unit);
+  }
+  // weight each part by the free space it holds
+  uint64_t avl_free = _get_free();
+  return (_get_fragmentation(alloc_unit) * avl_free +
+	  bmap_alloc->get_fragmentation(alloc_unit) * bmap_free) /
+    (avl_free + bmap_free);
+}
+
+void HybridAllocator::dump()
+{
+  std::lock_guard l(lock);
+  _dump();
+  if (bmap_alloc) {
+    bmap_alloc->dump();
+  }
+  ldout(cct, 0) << __func__
+		<< " extents in trees " << _num_extents()
+		<< " avl free " << _get_free()
+		<< " bitmap free " << (bmap_alloc ? bmap_alloc->get_free() : 0)
+		<< dendl;
+}
+
+void HybridAllocator::dump(
+  std::function<void(uint64_t offset, uint64_t length)> notify)
+{
+  std::lock_guard l(lock);
+  _dump(notify);
+  if (bmap_alloc) {
+    bmap_alloc->dump(notify);
+  }
+}
+
+void HybridAllocator::init_rm_free(uint64_t offset, uint64_t length)
+{
+  std::lock_guard l(lock);
+  ldout(cct, 10) << __func__ << std::hex
+		 << " offset 0x" << offset
+		 << " length 0x" << length
+		 << std::dec << dendl;
+  _try_remove_from_tree(offset, length,
+    [&](uint64_t o, uint64_t l) {
+      // whatever is not in the trees must have been spilled over
+      ceph_assert(bmap_alloc);
+      bmap_alloc->init_rm_free(o, l);
+    });
+}
+
+void HybridAllocator::shutdown()
+{
+  std::lock_guard l(lock);
+  _shutdown();
+  if (bmap_alloc) {
+    bmap_alloc->shutdown();
+    delete bmap_alloc;
+    bmap_alloc = nullptr;
+  }
+}
+
+void HybridAllocator::_spillover_range(uint64_t start, uint64_t end)
+{
+  if (!bmap_alloc) {
+    dout(1) << __func__ << " constructing fallback allocator"
+	    << dendl;
+    bmap_alloc = new BitmapAllocator(cct,
+				     _get_total(),
+				     _get_block_size());
+  }
+  bmap_alloc->init_add_free(start, end - start);
+}
@@ -0,0 +1,44 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_OS_BLUESTORE_HYBRIDALLOCATOR_H
+#define CEPH_OS_BLUESTORE_HYBRIDALLOCATOR_H
+
+#include <mutex>
+
+#include "AvlAllocator.h"
+#include "BitmapAllocator.h"
+
+/*
+ * AVL allocator with a bounded number of extents.  Once the extent cap
+ * (derived from the memory cap) is hit, the smallest extents are handed
+ * over to a bitmap allocator, which is created lazily.  Large extents
+ * therefore stay in the trees, where they can be found in O(log n), while
+ * the long tail of small fragments costs only bitmap memory.
+ */
+class HybridAllocator : public AvlAllocator {
+  BitmapAllocator* bmap_alloc = nullptr;
+public:
+  HybridAllocator(CephContext* cct, int64_t device_size, int64_t block_size,
+		  uint64_t max_mem);
+  ~HybridAllocator() override;
+
+  int64_t allocate(
+    uint64_t want,
+    uint64_t unit,
+    uint64_t max_alloc_size,
+    int64_t  hint,
+    PExtentVector *extents) override;
+  uint64_t get_free() override;
+  double get_fragmentation(uint64_t alloc_unit) override;
+
+  void dump() override;
+  void dump(std::function<void(uint64_t offset, uint64_t length)> notify) override;
+  void init_rm_free(uint64_t offset, uint64_t length) override;
+  void shutdown() override;
+
+protected:
+  void _spillover_range(uint64_t start, uint64_t end) override;
+};
+
+#endif
@@ -46,7 +46,14 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "bdev(" << sn << ") "
 
-thread_local SharedDriverQueueData *queue_t;
+// qpair each thread is pinned to, per device
+struct thread_queue_t {
+  const NVMEDevice *dev;
+  uint64_t epoch;
+  SharedDriverQueueData *queue;
+};
+static thread_local std::vector<thread_queue_t> thread_queues;
+static std::atomic<uint64_t> queue_epochs = {0};
 
 static constexpr uint16_t data_buffer_default_num = 1024;
 
@@ -72,7 +79,7 @@ static void io_complete(void *t, const struct spdk_nvme_cpl *completion);
 
 struct IORequest {
   uint16_t cur_seg_idx = 0;
-  uint16_t nseg;
+  uint16_t nseg = 0;
   uint32_t cur_seg_left = 0;
   void *inline_segs[inline_segment_num];
   void **extra_segs = nullptr;
@@ -138,9 +145,15 @@ class SharedDriverQueueData {
   uint32_t max_queue_depth;
   struct spdk_nvme_qpair *qpair;
   bool reap_io = false;
+  uint32_t max_io_completion;
+  uint64_t io_sleep_in_us;
   int alloc_buf_from_pool(Task *t, bool write);
 
   public:
+    /// serializes threads sharing this qpair; recursive since completion
+    /// callbacks may submit more I/O from within _aio_handle
+    ceph::recursive_mutex lock =
+      ceph::make_recursive_mutex("SharedDriverQueueData::lock");
     uint32_t current_queue_depth = 0;
     std::atomic_ulong completed_op_seq, queue_op_seq;
     std::vector<void*> data_buf_mempool;
@@ -153,6 +166,9 @@ class SharedDriverQueueData {
     ctrlr = driver->ctrlr;
     ns = driver->ns;
     block_size = driver->block_size;
+    max_io_completion =
+      (uint32_t)g_conf().get_val<uint64_t>("bluestore_spdk_max_io_completion");
+    io_sleep_in_us = g_conf().get_val<uint64_t>("bluestore_spdk_io_sleep");
 
     struct spdk_nvme_io_qpair_opts opts = {};
     spdk_nvme_ctrlr_get_default_io_qpair_opts(ctrlr, &opts, sizeof(opts));
@@ -218,11 +234,14 @@ struct Task {
   uint64_t offset;
   uint64_t len;
   bufferlist bl;
-  std::function<void()> fill_cb;
+  char *fill_buf = nullptr;  ///< read destination, copied out on completion
+  uint64_t fill_off = 0;     ///< offset within the task to copy from
+  uint64_t fill_len = 0;
   Task *next = nullptr;
   int64_t return_code;
   ceph::coarse_real_clock::time_point start;
   IORequest io_request;
+  std::vector<void*> extra_seg_storage;  ///< kept across reuse of the task
   ceph::mutex lock = ceph::make_mutex("Task::lock");
   ceph::condition_variable cond;
   SharedDriverQueueData *queue = nullptr;
@@ -233,11 +252,31 @@ struct Task {
   ~Task() {
     ceph_assert(!io_request.nseg);
   }
+  void reset(NVMEDevice *dev, IOCommand c, uint64_t off, uint64_t l,
+	     int64_t rc) {
+    ceph_assert(!io_request.nseg);
+    device = dev;
+    ctx = nullptr;
+    command = c;
+    offset = off;
+    len = l;
+    bl.clear();
+    fill_buf = nullptr;
+    fill_off = fill_len = 0;
+    next = nullptr;
+    return_code = rc;
+    start = ceph::coarse_real_clock::now();
+    io_request = IORequest();
+    queue = nullptr;
+  }
+  void fill() {
+    copy_to_buf(fill_buf, fill_off, fill_len);
+  }
   void release_segs(SharedDriverQueueData *queue_data) {
     if (io_request.extra_segs) {
       for (uint16_t i = 0; i < io_request.nseg; i++)
         queue_data->data_buf_mempool.push_back(io_request.extra_segs[i]);
-      delete io_request.extra_segs;
+      io_request.extra_segs = nullptr;
     } else if (io_request.nseg) {
       for (uint16_t i = 0; i < io_request.nseg; i++)
         queue_data->data_buf_mempool.push_back(io_request.inline_segs[i]);
@@ -262,6 +301,48 @@ struct Task {
   }
 };
 
+// Tasks are recycled through a per-thread cache so the I/O path does not
+// allocate once warm.  A task returns to the cache of the thread that
+// completes it, i.e. the one polling its qpair, which is normally the
+// thread that queued it.
+struct TaskCache {
+  static constexpr size_t max_cached = 1024;
+  std::vector<Task*> free;
+  ~TaskCache() {
+    for (auto t : free) {
+      delete t;
+    }
+  }
+};
+static thread_local TaskCache task_cache;
+
+static Task *get_task(NVMEDevice *dev, IOCommand c, uint64_t off,
+		      uint64_t l, int64_t rc = 0)
+{
+  auto& free = task_cache.free;
+  if (free.empty()) {
+    return new Task(dev, c, off, l, rc);
+  }
+  Task *t = free.back();
+  free.pop_back();
+  t->reset(dev, c, off, l, rc);
+  return t;
+}
+
+static void put_task(Task *t)
+{
+  auto& free = task_cache.free;
+  if (free.size() >= TaskCache::max_cached) {
+    delete t;
+    return;
+  }
+  if (free.capacity() == 0) {
+    free.reserve(TaskCache::max_cached);
+  }
+  t->bl.clear();
+  free.push_back(t);
+}
+
 static void data_buf_reset_sgl(void *cb_arg, uint32_t sgl_offset)
 {
   Task *t = static_cast<Task*>(cb_arg);
@@ -328,7 +409,8 @@ int SharedDriverQueueData::alloc_buf_from_pool(Task *t, bool write)
   if (count <= inline_segment_num) {
     segs = t->io_request.inline_segs;
   } else {
-    t->io_request.extra_segs = new void*[count];
+    t->extra_seg_storage.resize(count);
+    t->io_request.extra_segs = t->extra_seg_storage.data();
     segs = t->io_request.extra_segs;
   }
   for (uint16_t i = 0; i < count; i++) {
@@ -357,8 +439,7 @@ void SharedDriverQueueData::_aio_handle(Task *t, IOContext *ioc)
 
   int r = 0;
   uint64_t lba_off, lba_count;
-  uint32_t max_io_completion = (uint32_t)g_conf().get_val<uint64_t>("bluestore_spdk_max_io_completion");
-  uint64_t io_sleep_in_us = g_conf().get_val<uint64_t>("bluestore_spdk_io_sleep");
+  std::lock_guard l(lock);
 
   ceph::coarse_real_clock::time_point cur, start
     = ceph::coarse_real_clock::now();
@@ -400,7 +481,7 @@ void SharedDriverQueueData::_aio_handle(Task *t, IOContext *ioc)
             derr << __func__ << " failed to do write command" << dendl;
             t->ctx->nvme_task_first = t->ctx->nvme_task_last = nullptr;
             t->release_segs(this);
-            delete t;
+            put_task(t);
             ceph_abort();
           }
           cur = ceph::coarse_real_clock::now();
@@ -423,7 +504,7 @@ void SharedDriverQueueData::_aio_handle(Task *t, IOContext *ioc)
           if (r < 0) {
             derr << __func__ << " failed to read" << dendl;
             t->release_segs(this);
-            delete t;
+            put_task(t);
             ceph_abort();
           } else {
             cur = ceph::coarse_real_clock::now();
@@ -439,7 +520,7 @@ void SharedDriverQueueData::_aio_handle(Task *t, IOContext *ioc)
           if (r < 0) {
             derr << __func__ << " failed to flush" << dendl;
             t->release_segs(this);
-            delete t;
+            put_task(t);
             ceph_abort();
           } else {
             cur = ceph::coarse_real_clock::now();
@@ -661,12 +742,12 @@ void io_complete(void *t, const struct spdk_nvme_cpl *completion)
       ctx->try_aio_wake();
     }
     task->release_segs(queue);
-    delete task;
+    put_task(task);
   } else if (task->command == IOCommand::READ_COMMAND) {
     queue->logger->tinc(l_bluestore_nvmedevice_read_lat, dur);
     ceph_assert(!spdk_nvme_cpl_is_error(completion));
     dout(20) << __func__ << " read op successfully" << dendl;
-    task->fill_cb();
+    task->fill();
     task->release_segs(queue);
     // read submitted by AIO
     if (!task->return_code) {
@@ -677,7 +758,7 @@ void io_complete(void *t, const struct spdk_nvme_cpl *completion)
       } else {
         ctx->try_aio_wake();
       }
-      delete task;
+      put_task(task);
     } else {
       task->return_code = 0;
       ctx->try_aio_wake();
@@ -724,6 +805,7 @@ int NVMEDevice::open(const string& p)
   }
 
   driver->register_device(this);
+  queue_epoch = ++queue_epochs;
   block_size = driver->get_block_size();
   size = driver->get_size();
   name = trid.traddr;
@@ -746,8 +828,15 @@ void NVMEDevice::close()
 {
   dout(1) << __func__ << dendl;
 
-  delete queue_t;
-  queue_t = nullptr;
+  {
+    std::lock_guard l(queue_lock);
+    for (auto q : queues) {
+      delete q;
+    }
+    queues.clear();
+    next_queue = 0;
+    queue_epoch = 0;
+  }
   name.clear();
   driver->remove_device(this);
 
@@ -767,6 +856,42 @@ int NVMEDevice::collect_metadata(const string& prefix, map<string,string> *pm) c
   return 0;
 }
 
+SharedDriverQueueData *NVMEDevice::get_queue()
+{
+  thread_queue_t *pin = nullptr;
+  for (auto& q : thread_queues) {
+    if (q.dev == this) {
+      if (q.epoch == queue_epoch) {
+	return q.queue;
+      }
+      pin = &q;  // left over from a previous open
+      break;
+    }
+  }
+  SharedDriverQueueData *queue;
+  {
+    std::lock_guard l(queue_lock);
+    auto max = cct->_conf.get_val<uint64_t>("bluestore_spdk_qpair_count");
+    if (max == 0 || queues.size() < max) {
+      queue = new SharedDriverQueueData(this, driver);
+      queues.push_back(queue);
+      dout(10) << __func__ << " qpair " << queues.size() << " for thread "
+	       << std::this_thread::get_id() << dendl;
+    } else {
+      queue = queues[next_queue++ % queues.size()];
+      dout(10) << __func__ << " sharing qpair " << queue << " with thread "
+	       << std::this_thread::get_id() << dendl;
+    }
+  }
+  if (pin) {
+    pin->epoch = queue_epoch;
+    pin->queue = queue;
+  } else {
+    thread_queues.push_back(thread_queue_t{this, queue_epoch, queue});
+  }
+  return queue;
+}
+
 int NVMEDevice::flush()
 {
   return 0;
@@ -785,9 +910,7 @@ void NVMEDevice::aio_submit(IOContext *ioc)
     ceph_assert(ioc->num_pending.load() == 0);  // we should be only thread doing this
     // Only need to push the first entry
     ioc->nvme_task_first = ioc->nvme_task_last = nullptr;
-    if (!queue_t)
-	queue_t = new SharedDriverQueueData(this, driver);
-    queue_t->_aio_handle(t, ioc);
+    get_queue()->_aio_handle(t, ioc);
   }
 }
 
@@ -804,7 +927,7 @@ static void write_split(
 
   while (remain_len > 0) {
     write_size = std::min(remain_len, split_size);
-    t = new Task(dev, IOCommand::WRITE_COMMAND, off + begin, write_size);
+    t = get_task(dev, IOCommand::WRITE_COMMAND, off + begin, write_size);
     // TODO: if upper layer alloc memory with known physical address,
     // we can reduce this copy
     bl.splice(0, write_size, &t->bl);
@@ -866,14 +989,12 @@ int NVMEDevice::read(uint64_t off, uint64_t len, bufferlist *pbl,
   dout(5) << __func__ << " " << off << "~" << len << " ioc " << ioc << dendl;
   ceph_assert(is_valid_io(off, len));
 
-  Task *t = new Task(this, IOCommand::READ_COMMAND, off, len, 1);
+  Task *t = get_task(this, IOCommand::READ_COMMAND, off, len, 1);
   bufferptr p = buffer::create_small_page_aligned(len);
   int r = 0;
   t->ctx = ioc;
-  char *buf = p.c_str();
-  t->fill_cb = [buf, t]() {
-    t->copy_to_buf(buf, 0, t->len);
-  };
+  t->fill_buf = p.c_str();
+  t->fill_len = len;
 
   ++ioc->num_pending;
   ioc->nvme_task_first = t;
@@ -882,7 +1003,7 @@ int NVMEDevice::read(uint64_t off, uint64_t len, bufferlist *pbl,
 
   pbl->push_back(std::move(p));
   r = t->return_code;
-  delete t;
+  put_task(t);
   return r;
 }
 
@@ -895,15 +1016,13 @@ int NVMEDevice::aio_read(
   dout(20) << __func__ << " " << off << "~" << len << " ioc " << ioc << dendl;
   ceph_assert(is_valid_io(off, len));
 
-  Task *t = new Task(this, IOCommand::READ_COMMAND, off, len);
+  Task *t = get_task(this, IOCommand::READ_COMMAND, off, len);
 
   bufferptr p = buffer::create_small_page_aligned(len);
   pbl->append(p);
   t->ctx = ioc;
-  char* buf = p.c_str();
-  t->fill_cb = [buf, t]() {
-    t->copy_to_buf(buf, 0, t->len);
-  };
+  t->fill_buf = p.c_str();
+  t->fill_len = len;
 
   Task *first = static_cast<Task*>(ioc->nvme_task_first);
   Task *last = static_cast<Task*>(ioc->nvme_task_last);
@@ -928,12 +1047,12 @@ int NVMEDevice::read_random(uint64_t off, uint64_t len, char *buf, bool buffered
   dout(5) << __func__ << " " << off << "~" << len
           << " aligned " << aligned_off << "~" << aligned_len << dendl;
   IOContext ioc(g_ceph_context, nullptr);
-  Task *t = new Task(this, IOCommand::READ_COMMAND, aligned_off, aligned_len, 1);
+  Task *t = get_task(this, IOCommand::READ_COMMAND, aligned_off, aligned_len, 1);
   int r = 0;
   t->ctx = &ioc;
-  t->fill_cb = [buf, t, off, len]() {
-    t->copy_to_buf(buf, off-t->offset, len);
-  };
+  t->fill_buf = buf;
+  t->fill_off = off - aligned_off;
+  t->fill_len = len;
 
   ++ioc.num_pending;
   ioc.nvme_task_first = t;
@@ -941,7 +1060,7 @@ int NVMEDevice::read_random(uint64_t off, uint64_t len, char *buf, bool buffered
   ioc.aio_wait();
 
   r = t->return_code;
-  delete t;
+  put_task(t);
   return r;
 }
 
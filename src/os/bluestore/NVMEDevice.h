@@ -27,6 +27,7 @@
 
 #include "include/interval_set.h"
 #include "common/ceph_time.h"
+#include "common/ceph_mutex.h"
 #include "BlockDevice.h"
 
 enum class IOCommand {
@@ -47,6 +48,13 @@ class NVMEDevice : public BlockDevice {
   SharedDriverData *driver;
   string name;
 
+  /// qpairs of this device; a thread is pinned to one on its first submit
+  ceph::mutex queue_lock = ceph::make_mutex("NVMEDevice::queue_lock");
+  std::vector<SharedDriverQueueData*> queues;
+  unsigned next_queue = 0;
+  uint64_t queue_epoch = 0;  ///< changes on open, so stale pins are dropped
+  SharedDriverQueueData *get_queue();
+
  public:
   std::atomic_int queue_number = {0};
   SharedDriverData *get_driver() { return driver; }
@@ -83,12 +83,21 @@ int PMEMDevice::open(const string& p)
   }
 
   size_t map_len;
-  addr = (char *)pmem_map_file(path.c_str(), 0, PMEM_FILE_EXCL, O_RDWR, &map_len, NULL);
+  int is_pmem_map;
+  addr = (char *)pmem_map_file(path.c_str(), 0, PMEM_FILE_EXCL, O_RDWR, &map_len,
+			       &is_pmem_map);
   if (addr == NULL) {
     derr << __func__ << " pmem_map_file failed: " << pmem_errormsg() << dendl;
     goto out_fail;
   }
   size = map_len;
+  // Without DAX the mapping goes through the page cache and only
+  // pmem_msync() makes it durable; cache-line flushes are not enough.
+  is_pmem = is_pmem_map;
+  if (!is_pmem) {
+    dout(1) << __func__ << " " << path << " is not DAX-mapped, writes"
+	    << " will be persisted with msync" << dendl;
+  }
 
   // Operate as though the block size is 4 KB.  The backing file
   // blksize doesn't strictly matter except that some file systems may
@@ -134,6 +143,7 @@ int PMEMDevice::collect_metadata(const string& prefix, map<string,string> *pm) c
   (*pm)[prefix + "size"] = stringify(get_size());
   (*pm)[prefix + "block_size"] = stringify(get_block_size());
   (*pm)[prefix + "driver"] = "PMEMDevice";
+  (*pm)[prefix + "dax"] = stringify((int)is_pmem);
   (*pm)[prefix + "type"] = "ssd";
 
   struct stat st;
@@ -202,15 +212,28 @@ int PMEMDevice::write(uint64_t off, bufferlist& bl, bool buffered, int write_hin
     return 0;
   }
 
+  // flush each segment's cache lines as we go, but fence only once
   bufferlist::iterator p = bl.begin();
-  uint32_t off1 = off;
+  uint64_t off1 = off;
   while (len) {
     const char *data;
     uint32_t l = p.get_ptr_and_advance(len, &data);
-    pmem_memcpy_persist(addr + off1, data, l);
+    if (is_pmem) {
+      pmem_memcpy_nodrain(addr + off1, data, l);
+    } else {
+      memcpy(addr + off1, data, l);
+    }
     len -= l;
     off1 += l;
   }
+  if (is_pmem) {
+    pmem_drain();
+  } else if (pmem_msync(addr + off, bl.length()) < 0) {
+    int r = -errno;
+    derr << __func__ << " pmem_msync " << off << "~" << bl.length()
+	 << " got " << cpp_strerror(r) << dendl;
+    return r;
+  }
   return 0;
 }
 
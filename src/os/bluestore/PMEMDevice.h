@@ -27,6 +27,7 @@
 class PMEMDevice : public BlockDevice {
   int fd;
   char *addr; //the address of mmap
+  bool is_pmem = false; //mapping is real pmem (DAX), not page cache
   std::string path;
 
   ceph::mutex debug_lock = ceph::make_mutex("PMEMDevice::debug_lock");
@@ -38,6 +39,9 @@ class PMEMDevice : public BlockDevice {
 public:
   PMEMDevice(CephContext *cct, aio_callback_t cb, void *cbpriv);
 
+  bool is_byte_addressable() const override {
+    return is_pmem;
+  }
 
   void aio_submit(IOContext *ioc) override;
 
@@ -63,6 +67,8 @@ public:
   void close() override;
 
 private:
+  // pmem is byte addressable, so unlike BlockDevice::is_valid_io() this
+  // takes any alignment; BlueFS writes less than a block to it
   bool is_valid_io(uint64_t off, uint64_t len) const {
     return (len > 0 &&
             off < size &&
@@ -104,6 +104,8 @@ void bluefs_fnode_t::dump(Formatter *f) const
   f->dump_unsigned("size", size);
   f->dump_stream("mtime") << mtime;
   f->dump_unsigned("prefer_bdev", prefer_bdev);
+  f->dump_unsigned("type", type);
+  f->dump_unsigned("envelope_gen", envelope_gen);
   f->open_array_section("extents");
   for (auto& p : extents)
     f->dump_object("extent", p);
@@ -119,17 +121,25 @@ void bluefs_fnode_t::generate_test_instances(list<bluefs_fnode_t*>& ls)
   ls.back()->mtime = utime_t(123,45);
   ls.back()->extents.push_back(bluefs_extent_t(0, 1048576, 4096));
   ls.back()->prefer_bdev = 1;
+  ls.push_back(new bluefs_fnode_t);
+  ls.back()->ino = 124;
+  ls.back()->type = bluefs_fnode_t::TYPE_WAL_ENVELOPE;
+  ls.back()->envelope_gen = 3;
+  ls.back()->extents.push_back(bluefs_extent_t(0, 2097152, 65536));
 }
 
 ostream& operator<<(ostream& out, const bluefs_fnode_t& file)
 {
-  return out << "file(ino " << file.ino
+  out << "file(ino " << file.ino
 	     << " size 0x" << std::hex << file.size << std::dec
 	     << " mtime " << file.mtime
 	     << " bdev " << (int)file.prefer_bdev
 	     << " allocated " << std::hex << file.allocated << std::dec
-	     << " extents " << file.extents
-	     << ")";
+	     << " extents " << file.extents;
+  if (file.is_envelope()) {
+    out << " envelope gen " << file.envelope_gen;
+  }
+  return out << ")";
 }
 
 
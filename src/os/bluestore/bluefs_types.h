@@ -35,15 +35,26 @@ ostream& operator<<(ostream& out, const bluefs_extent_t& e);
 
 
 struct bluefs_fnode_t {
+  enum {
+    TYPE_NORMAL = 0,
+    TYPE_WAL_ENVELOPE = 1, ///< data is framed in bluefs_wal_envelope_t
+  };
+
   uint64_t ino;
   uint64_t size;
   utime_t mtime;
   uint8_t prefer_bdev;
   mempool::bluefs::vector<bluefs_extent_t> extents;
   uint64_t allocated;
+  uint8_t type = TYPE_NORMAL;
+  uint64_t envelope_gen = 0;  ///< bumped each time an envelope file is rewritten
 
   bluefs_fnode_t() : ino(0), size(0), prefer_bdev(0), allocated(0) {}
 
+  bool is_envelope() const {
+    return type == TYPE_WAL_ENVELOPE;
+  }
+
   uint64_t get_allocated() const {
     return allocated;
   }
@@ -69,12 +80,16 @@ struct bluefs_fnode_t {
   template<typename T, typename P>
   friend std::enable_if_t<std::is_same_v<bluefs_fnode_t, std::remove_const_t<T>>>
   _denc_friend(T& v, P& p) {
-    DENC_START(1, 1, p);
+    DENC_START(2, 1, p);
     denc_varint(v.ino, p);
     denc_varint(v.size, p);
     denc(v.mtime, p);
     denc(v.prefer_bdev, p);
     denc(v.extents, p);
+    if (struct_v >= 2) {
+      denc(v.type, p);
+      denc_varint(v.envelope_gen, p);
+    }
     DENC_FINISH(p);
   }
 
@@ -113,6 +128,56 @@ WRITE_CLASS_DENC(bluefs_fnode_t)
 
 ostream& operator<<(ostream& out, const bluefs_fnode_t& file);
 
+/*
+ * WAL files in envelope mode are written as a sequence of block aligned
+ * envelopes, one per flush:
+ *
+ *   header | payload | crc32c(header + payload) | zero padding
+ *
+ * The logical file is the concatenation of the payloads.  Replay finds
+ * the end of the file by walking the envelopes until one fails to
+ * verify, so a sync does not need to record the new file size in the
+ * BlueFS log.
+ */
+struct bluefs_wal_envelope_t {
+  static constexpr uint32_t MAGIC = 0x45565757;  ///< "WWVE"
+  static constexpr uint32_t HEADER_LEN = 32;
+  static constexpr uint32_t TRAILER_LEN = 4;
+
+  uint32_t length = 0;  ///< payload length
+  uint64_t ino = 0;
+  uint64_t gen = 0;     ///< bluefs_fnode_t::envelope_gen
+  uint64_t offset = 0;  ///< logical offset of the payload
+
+  void encode_header(bufferlist& bl) const {
+    using ceph::encode;
+    encode(MAGIC, bl);
+    encode(length, bl);
+    encode(ino, bl);
+    encode(gen, bl);
+    encode(offset, bl);
+  }
+  /// @return false if this is not an envelope header
+  bool decode_header(bufferlist::const_iterator& p) {
+    using ceph::decode;
+    uint32_t magic;
+    decode(magic, p);
+    if (magic != MAGIC) {
+      return false;
+    }
+    decode(length, p);
+    decode(ino, p);
+    decode(gen, p);
+    decode(offset, p);
+    return true;
+  }
+  /// on-disk footprint of an envelope with this payload
+  uint64_t get_disk_len(uint64_t block_size) const {
+    return round_up_to<uint64_t>(HEADER_LEN + length + TRAILER_LEN,
+				 block_size);
+  }
+};
+
 
 struct bluefs_super_t {
   uuid_d uuid;      ///< unique to this bluefs instance
@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <iomanip>
 #include <iostream>
 #include <time.h>
 #include <fcntl.h>
@@ -224,6 +225,7 @@ int main(int argc, char **argv)
   string action;
   string log_file;
   string key, value;
+  string sharding;
   int log_level = 30;
   bool fsck_deep = false;
   po::options_description po_options("Options");
@@ -239,10 +241,11 @@ int main(int argc, char **argv)
     ("deep", po::value<bool>(&fsck_deep), "deep fsck (read all data)")
     ("key,k", po::value<string>(&key), "label metadata key name")
     ("value,v", po::value<string>(&value), "label metadata value")
+    ("sharding", po::value<string>(&sharding), "reshard column family layout, e.g. \"M= P= O(4)=\"")
     ;
   po::options_description po_positional("Positional options");
   po_positional.add_options()
-    ("command", po::value<string>(&action), "fsck, repair, bluefs-export, bluefs-bdev-sizes, bluefs-bdev-expand, bluefs-bdev-new-db, bluefs-bdev-new-wal, bluefs-bdev-migrate, show-label, set-label-key, rm-label-key, prime-osd-dir, bluefs-log-dump")
+    ("command", po::value<string>(&action), "fsck, repair, bluefs-export, bluefs-bdev-sizes, bluefs-bdev-expand, bluefs-bdev-new-db, bluefs-bdev-new-wal, bluefs-bdev-migrate, show-label, set-label-key, rm-label-key, prime-osd-dir, bluefs-log-dump, reshard")
     ;
   po::options_description po_all("All options");
   po_all.add(po_options).add(po_positional);
@@ -332,6 +335,17 @@ int main(int argc, char **argv)
     }
     inferring_bluefs_devices(devs, path);
   }
+  if (action == "reshard") {
+    if (path.empty()) {
+      cerr << "must specify bluestore path" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (sharding.empty()) {
+      cerr << "must specify target layout with --sharding" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    inferring_bluefs_devices(devs, path);
+  }
   if (action == "bluefs-bdev-new-db" || action == "bluefs-bdev-new-wal") {
     if (path.empty()) {
       cerr << "must specify bluestore path" << std::endl;
@@ -385,6 +399,21 @@ int main(int argc, char **argv)
       action == "repair") {
     validate_path(cct.get(), path, false);
     BlueStore bluestore(cct.get(), path);
+    utime_t fsck_start = ceph_clock_now();
+    bluestore.set_fsck_progress_cb([&](uint64_t done, uint64_t total) {
+      if (!total) {
+	return;
+      }
+      double frac = std::min(1.0, (double)done / total);
+      cout << action << ": " << std::fixed << std::setprecision(1)
+	   << frac * 100 << "% of " << byte_u_t(total) << " checked";
+      if (frac > 0 && frac < 1) {
+	double elapsed = ceph_clock_now() - fsck_start;
+	cout << ", eta " << ceph::timespan_str(
+	  ceph::make_timespan(elapsed / frac - elapsed));
+      }
+      cout << std::endl;
+    });
     int r;
     if (action == "fsck") {
       r = bluestore.fsck(fsck_deep);
@@ -535,6 +564,15 @@ int main(int argc, char **argv)
       exit(EXIT_FAILURE);
     }
   }
+  else if (action == "reshard") {
+    BlueStore bluestore(cct.get(), path);
+    auto r = bluestore.reshard_db(sharding, cout);
+    if (r < 0) {
+      cerr << "failed to reshard bluestore db: "
+	   << cpp_strerror(r) << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
   else if (action == "bluefs-export") {
     BlueFS *fs = open_bluefs(cct.get(), path, devs);
 
@@ -677,8 +677,14 @@ ostream& operator<<(ostream& out, const bluestore_blob_t& o)
   return out;
 }
 
-void bluestore_blob_t::calc_csum(uint64_t b_off, const bufferlist& bl)
+void bluestore_blob_t::calc_csum(uint64_t b_off, const bufferlist& bl,
+				 Checksummer::crc32c_batch *batch)
 {
+  if (batch && Checksummer::crc32c_batch::is_batchable(csum_type)) {
+    batch->add(csum_type, get_csum_chunk_size(), b_off, bl.length(), bl,
+	       &csum_data);
+    return;
+  }
   switch (csum_type) {
   case Checksummer::CSUM_XXHASH32:
     Checksummer::calculate<Checksummer::xxhash32>(
@@ -1121,6 +1127,14 @@ void bluestore_compression_header_t::dump(Formatter *f) const
 {
   f->dump_unsigned("type", type);
   f->dump_unsigned("length", length);
+  if (frame_size) {
+    f->dump_unsigned("frame_size", frame_size);
+    f->open_array_section("frames");
+    for (auto l : frames) {
+      f->dump_unsigned("length", l);
+    }
+    f->close_section();
+  }
 }
 
 void bluestore_compression_header_t::generate_test_instances(
@@ -1129,4 +1143,8 @@ void bluestore_compression_header_t::generate_test_instances(
   o.push_back(new bluestore_compression_header_t);
   o.push_back(new bluestore_compression_header_t(1));
   o.back()->length = 1234;
+  o.push_back(new bluestore_compression_header_t(1));
+  o.back()->length = 3000;
+  o.back()->frame_size = 4096;
+  o.back()->frames = {1000, 2000};
 }
@@ -784,7 +784,8 @@ public:
   }
 
   /// calculate csum for the buffer at the given b_off
-  void calc_csum(uint64_t b_off, const bufferlist& bl);
+  void calc_csum(uint64_t b_off, const bufferlist& bl,
+		 Checksummer::crc32c_batch *batch = nullptr);
 
   /// verify csum: return -EOPNOTSUPP for unsupported checksum type;
   /// return -1 and valid(nonnegative) b_bad_off for checksum error;
@@ -1016,15 +1017,33 @@ WRITE_CLASS_DENC(bluestore_deferred_transaction_t)
 struct bluestore_compression_header_t {
   uint8_t type = Compressor::COMP_ALG_NONE;
   uint32_t length = 0;
+  uint32_t frame_size = 0;      ///< raw bytes per frame, 0 if not framed
+  std::vector<uint32_t> frames; ///< compressed length of each frame
 
   bluestore_compression_header_t() {}
   bluestore_compression_header_t(uint8_t _type)
     : type(_type) {}
 
+  bool is_framed() const {
+    return frame_size && !frames.empty();
+  }
+  /// compressed offset of the given frame, relative to end of header
+  uint32_t get_frame_offset(unsigned frame) const {
+    uint32_t off = 0;
+    for (unsigned i = 0; i < frame; ++i) {
+      off += frames[i];
+    }
+    return off;
+  }
+
   DENC(bluestore_compression_header_t, v, p) {
-    DENC_START(1, 1, p);
+    DENC_START(2, 1, p);
     denc(v.type, p);
     denc(v.length, p);
+    if (struct_v >= 2) {
+      denc(v.frame_size, p);
+      denc(v.frames, p);
+    }
     DENC_FINISH(p);
   }
   void dump(Formatter *f) const;
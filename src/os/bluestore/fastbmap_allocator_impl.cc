@@ -510,6 +510,43 @@ bool AllocatorLevel01Loose::_allocate_l1(uint64_t length,
   return _is_empty_l1(l1_pos_start, l1_pos_end);
 }
 
+void AllocatorLevel01Loose::dump(
+  std::function<void(uint64_t offset, uint64_t length)> notify)
+{
+  uint64_t run_start = 0; // in l0 entries
+  uint64_t run_len = 0;
+  auto flush = [&]() {
+    if (run_len) {
+      notify(run_start * l0_granularity, run_len * l0_granularity);
+      run_len = 0;
+    }
+  };
+  for (size_t i = 0; i < l0.size(); ++i) {
+    slot_t slot = l0[i];
+    uint64_t base = i * bits_per_slot;
+    if (slot == all_slot_set) {
+      if (!run_len) {
+	run_start = base;
+      }
+      run_len += bits_per_slot;
+    } else if (slot == all_slot_clear) {
+      flush();
+    } else {
+      for (size_t pos = 0; pos < bits_per_slot; ++pos) {
+	if (slot & (slot_t(1) << pos)) {
+	  if (!run_len) {
+	    run_start = base + pos;
+	  }
+	  ++run_len;
+	} else {
+	  flush();
+	}
+      }
+    }
+  }
+  flush();
+}
+
 void AllocatorLevel01Loose::collect_stats(
   std::map<size_t, size_t>& bins_overall)
 {
@@ -13,6 +13,7 @@
 #include <vector>
 #include <algorithm>
 #include <mutex>
+#include <functional>
 
 typedef uint64_t slot_t;
 
@@ -469,6 +470,9 @@ public:
   }
   void collect_stats(
     std::map<size_t, size_t>& bins_overall) override;
+
+  /// report free space as maximal runs of free l0 entries
+  void dump(std::function<void(uint64_t offset, uint64_t length)> notify);
 };
 
 class AllocatorLevel01Compact : public AllocatorLevel01
@@ -518,6 +522,11 @@ public:
       l1.collect_stats(bins_overall);
   }
 
+  void dump(std::function<void(uint64_t offset, uint64_t length)> notify) {
+    std::lock_guard l(lock);
+    l1.dump(notify);
+  }
+
 protected:
   ceph::mutex lock = ceph::make_mutex("AllocatorLevel02::lock");
   L1 l1;
@@ -0,0 +1,272 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "ioring.h"
+
+#if defined(HAVE_LIBURING)
+
+#include <map>
+#include <sys/epoll.h>
+#include "liburing.h"
+
+struct ioring_data {
+  struct io_uring io_uring;
+  int epoll_fd = -1;
+  std::map<int, int> fixed_fds_map;  ///< fd -> index in the registered set
+};
+
+static int ioring_get_cqe(ioring_data *d, unsigned int max,
+			  struct aio_t **paio)
+{
+  struct io_uring *ring = &d->io_uring;
+  struct io_uring_cqe *cqe;
+
+  unsigned nr = 0;
+  unsigned head;
+  io_uring_for_each_cqe(ring, head, cqe) {
+    struct aio_t *io = (struct aio_t *)(uintptr_t) io_uring_cqe_get_data(cqe);
+    io->rval = cqe->res;
+
+    paio[nr++] = io;
+
+    if (nr == max)
+      break;
+  }
+  io_uring_cq_advance(ring, nr);
+
+  return nr;
+}
+
+static int find_fixed_fd(ioring_data *d, int real_fd)
+{
+  auto it = d->fixed_fds_map.find(real_fd);
+  if (it == d->fixed_fds_map.end())
+    return -1;
+
+  return it->second;
+}
+
+static void init_sqe(ioring_data *d, struct io_uring_sqe *sqe,
+		     struct aio_t *io)
+{
+  int fixed_fd = find_fixed_fd(d, io->fd);
+
+  ceph_assert(fixed_fd != -1);
+
+  if (io->iocb.aio_lio_opcode == IO_CMD_PWRITEV)
+    io_uring_prep_writev(sqe, fixed_fd, &io->iov[0],
+			 io->iov.size(), io->offset);
+  else if (io->iocb.aio_lio_opcode == IO_CMD_PREAD ||
+	   io->iocb.aio_lio_opcode == IO_CMD_PREADV)
+    io_uring_prep_readv(sqe, fixed_fd, &io->iov[0],
+			io->iov.size(), io->offset);
+  else
+    ceph_assert(0);
+
+  io_uring_sqe_set_data(sqe, io);
+  io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+}
+
+/// queue as many aios as the sq has room for; returns the number queued
+static int ioring_queue(ioring_data *d, void *priv,
+			list<aio_t>::iterator& beg, list<aio_t>::iterator end)
+{
+  struct io_uring *ring = &d->io_uring;
+  int queued = 0;
+
+  while (beg != end) {
+    struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+    if (!sqe)
+      break;
+
+    struct aio_t *io = &*beg;
+    io->priv = priv;
+    init_sqe(d, sqe, io);
+    ++queued;
+    ++beg;
+  }
+  return queued;
+}
+
+static void build_fixed_fds_map(ioring_data *d,
+				std::vector<int> &fds)
+{
+  int fixed_fd = 0;
+  for (int real_fd : fds) {
+    d->fixed_fds_map[real_fd] = fixed_fd++;
+  }
+}
+
+ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_) :
+  d(make_unique<ioring_data>()),
+  iodepth(iodepth_),
+  hipri(hipri_),
+  sq_thread(sq_thread_)
+{
+}
+
+ioring_queue_t::~ioring_queue_t()
+{
+}
+
+int ioring_queue_t::init(std::vector<int> &fds)
+{
+  unsigned flags = 0;
+
+  if (hipri)
+    flags |= IORING_SETUP_IOPOLL;
+  if (sq_thread)
+    flags |= IORING_SETUP_SQPOLL;
+
+  int ret = io_uring_queue_init(iodepth, &d->io_uring, flags);
+  if (ret < 0)
+    return ret;
+
+  ret = io_uring_register_files(&d->io_uring,
+				&fds[0], fds.size());
+  if (ret < 0) {
+    ret = -errno;
+    goto close_ring_fd;
+  }
+
+  build_fixed_fds_map(d.get(), fds);
+
+  d->epoll_fd = epoll_create1(0);
+  if (d->epoll_fd < 0) {
+    ret = -errno;
+    goto close_ring_fd;
+  }
+
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ret = epoll_ctl(d->epoll_fd, EPOLL_CTL_ADD, d->io_uring.ring_fd, &ev);
+  if (ret < 0) {
+    ret = -errno;
+    goto close_epoll_fd;
+  }
+
+  return 0;
+
+close_epoll_fd:
+  close(d->epoll_fd);
+  d->epoll_fd = -1;
+close_ring_fd:
+  io_uring_queue_exit(&d->io_uring);
+
+  return ret;
+}
+
+void ioring_queue_t::shutdown()
+{
+  d->fixed_fds_map.clear();
+  close(d->epoll_fd);
+  d->epoll_fd = -1;
+  io_uring_queue_exit(&d->io_uring);
+}
+
+int ioring_queue_t::submit_batch(aio_iter beg, aio_iter end,
+				 uint16_t aios_size, void *priv,
+				 int *retries)
+{
+  (void)aios_size;
+
+  // same backoff as aio_queue_t, used only when the sq is full
+  int attempts = 16;
+  int delay = 125;
+  int done = 0;
+
+  std::lock_guard l(sq_mutex);
+  while (beg != end) {
+    int queued = ioring_queue(d.get(), priv, beg, end);
+    if (queued > 0) {
+      int r = io_uring_submit(&d->io_uring);
+      if (r < 0)
+	return r;
+      done += queued;
+      attempts = 16;
+      delay = 125;
+      continue;
+    }
+    // sq is full; wait for the reaper (or the sq thread) to catch up
+    if (attempts-- == 0)
+      return -EAGAIN;
+    usleep(delay);
+    delay *= 2;
+    (*retries)++;
+  }
+  return done;
+}
+
+int ioring_queue_t::get_next_completed(int timeout_ms,
+				       aio_t **paio, int max)
+{
+get_cqe:
+  {
+    std::lock_guard l(cq_mutex);
+    int events = ioring_get_cqe(d.get(), max, paio);
+    if (events)
+      return events;
+  }
+
+  struct epoll_event ev;
+  int ret = TEMP_FAILURE_RETRY(epoll_wait(d->epoll_fd, &ev, 1, timeout_ms));
+  if (ret < 0)
+    ret = -errno;
+  else if (ret > 0)
+    goto get_cqe;
+
+  return ret;
+}
+
+bool ioring_queue_t::supported()
+{
+  struct io_uring ring;
+  int ret = io_uring_queue_init(16, &ring, 0);
+  if (ret) {
+    return false;
+  }
+  io_uring_queue_exit(&ring);
+  return true;
+}
+
+#else // #if defined(HAVE_LIBURING)
+
+struct ioring_data {};
+
+ioring_queue_t::ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_)
+{
+  ceph_abort();
+}
+
+ioring_queue_t::~ioring_queue_t()
+{
+}
+
+int ioring_queue_t::init(std::vector<int> &fds)
+{
+  ceph_abort();
+}
+
+void ioring_queue_t::shutdown()
+{
+  ceph_abort();
+}
+
+int ioring_queue_t::submit_batch(aio_iter beg, aio_iter end,
+				 uint16_t aios_size, void *priv,
+				 int *retries)
+{
+  ceph_abort();
+}
+
+int ioring_queue_t::get_next_completed(int timeout_ms, aio_t **paio, int max)
+{
+  ceph_abort();
+}
+
+bool ioring_queue_t::supported()
+{
+  return false;
+}
+
+#endif // #if defined(HAVE_LIBURING)
@@ -0,0 +1,43 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#pragma once
+
+#include "acconfig.h"
+
+#include "include/types.h"
+#include "common/ceph_mutex.h"
+#include "ceph_aio.h"
+
+struct ioring_data;
+
+/**
+ * io_uring based io_queue_t
+ *
+ * Submission and completion go through the shared rings, so with
+ * sqthread_poll enabled neither submit_batch() nor the reap in
+ * get_next_completed() needs a syscall while the device is busy.  All
+ * of the device fds are registered with the ring up front and every
+ * sqe refers to them by index (IOSQE_FIXED_FILE).
+ */
+struct ioring_queue_t final : public io_queue_t {
+  std::unique_ptr<ioring_data> d;
+  unsigned iodepth = 0;
+  bool hipri = false;
+  bool sq_thread = false;
+
+  ceph::mutex sq_mutex = ceph::make_mutex("ioring_queue_t::sq_mutex");
+  ceph::mutex cq_mutex = ceph::make_mutex("ioring_queue_t::cq_mutex");
+
+  static bool supported();
+
+  ioring_queue_t(unsigned iodepth_, bool hipri_, bool sq_thread_);
+  ~ioring_queue_t() final;
+
+  int init(std::vector<int> &fds) final;
+  void shutdown() final;
+
+  int submit_batch(aio_iter begin, aio_iter end, uint16_t aios_size,
+		   void *priv, int *retries) final;
+  int get_next_completed(int timeout_ms, aio_t **paio, int max) final;
+};
@@ -1988,6 +1988,13 @@ void KStore::_txc_finalize(OpSequencer *osr, TransContext *txc)
   dout(20) << __func__ << " osr " << osr << " txc " << txc
 	   << " onodes " << txc->onodes << dendl;
 
+  // write out the stripes
+  dout(20) << " " << txc->stripes.size() << " stripes" << dendl;
+  for (auto& p : txc->stripes) {
+    txc->t->set(PREFIX_DATA, p.first, p.second);
+  }
+  txc->stripes.clear();
+
   // finalize onodes
   for (set<OnodeRef>::iterator p = txc->onodes.begin();
        p != txc->onodes.end();
@@ -2611,7 +2618,7 @@ void KStore::_do_write_stripe(TransContext *txc, OnodeRef o,
   o->pending_stripes[offset] = bl;
   string key;
   get_data_key(o->onode.nid, offset, &key);
-  txc->t->set(PREFIX_DATA, key, bl);
+  txc->stripes[key] = bl;
 }
 
 void KStore::_do_remove_stripe(TransContext *txc, OnodeRef o, uint64_t offset)
@@ -2619,6 +2626,7 @@ void KStore::_do_remove_stripe(TransContext *txc, OnodeRef o, uint64_t offset)
   o->pending_stripes.erase(offset);
   string key;
   get_data_key(o->onode.nid, offset, &key);
+  txc->stripes.erase(key);
   txc->t->rmkey(PREFIX_DATA, key);
 }
 
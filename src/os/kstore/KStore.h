@@ -225,6 +225,9 @@ public:
     uint64_t ops, bytes;
 
     set<OnodeRef> onodes;     ///< these onodes need to be updated/written
+    /// data key -> stripe, written once at finalize however often the
+    /// transaction rewrote it
+    map<string,bufferlist> stripes;
     KeyValueDB::Transaction t; ///< then we will commit this
     Context *oncommit;         ///< signal on commit
     Context *onreadable;         ///< signal on readable
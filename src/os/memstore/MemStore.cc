@@ -24,6 +24,7 @@
 #include "include/types.h"
 #include "include/stringify.h"
 #include "include/unordered_map.h"
+#include "include/buffer_raw.h"
 #include "common/errno.h"
 #include "MemStore.h"
 #include "include/compat.h"
@@ -1579,6 +1580,8 @@ struct MemStore::PageSetObject : public Object {
             uint64_t dstoff) override;
   int truncate(uint64_t offset) override;
 
+  class raw_page;
+
   void encode(bufferlist& bl) const override {
     ENCODE_START(1, 1, bl);
     encode(data_len, bl);
@@ -1604,23 +1607,33 @@ thread_local PageSet::page_vector MemStore::PageSetObject::tls_pages;
 #define DEFINE_PAGE_VECTOR(name) PageSet::page_vector name;
 #endif
 
+// a buffer backed by a whole page, which keeps a ref to it.  writes
+// replace the pages that are referenced like this instead of changing
+// them, see PageSet::alloc_range()
+class MemStore::PageSetObject::raw_page : public buffer::raw {
+  Page::Ref page;
+ public:
+  raw_page(Page::Ref p, unsigned page_size)
+    : raw(p->data, page_size), page(std::move(p)) {}
+  raw* clone_empty() override {
+    return buffer::create(len).release();
+  }
+};
+
 int MemStore::PageSetObject::read(uint64_t offset, uint64_t len, bufferlist& bl)
 {
-  const auto start = offset;
   const auto end = offset + len;
+  const auto page_size = data.get_page_size();
   auto remaining = len;
 
   DEFINE_PAGE_VECTOR(tls_pages);
   data.get_range(offset, len, tls_pages);
 
-  // allocate a buffer for the data
-  buffer::ptr buf(len);
-
   auto p = tls_pages.begin();
   while (remaining) {
     // no more pages in range
     if (p == tls_pages.end() || (*p)->offset >= end) {
-      buf.zero(offset - start, remaining);
+      bl.append_zero(remaining);
       break;
     }
     auto page = *p;
@@ -1628,18 +1641,23 @@ int MemStore::PageSetObject::read(uint64_t offset, uint64_t len, bufferlist& bl)
     // fill any holes between pages with zeroes
     if (page->offset > offset) {
       const auto count = std::min(remaining, page->offset - offset);
-      buf.zero(offset - start, count);
+      bl.append_zero(count);
       remaining -= count;
       offset = page->offset;
       if (!remaining)
         break;
     }
 
-    // read from page
+    // read from page: share the whole ones, copy the others, which
+    // aren't worth a later copy on write
     const auto page_offset = offset - page->offset;
-    const auto count = min(remaining, data.get_page_size() - page_offset);
+    const auto count = min(remaining, page_size - page_offset);
 
-    buf.copy_in(offset - start, count, page->data + page_offset);
+    if (count == page_size) {
+      bl.append(buffer::ptr(new raw_page(page, page_size)));
+    } else {
+      bl.append(page->data + page_offset, count);
+    }
 
     remaining -= count;
     offset += count;
@@ -1648,8 +1666,6 @@ int MemStore::PageSetObject::read(uint64_t offset, uint64_t len, bufferlist& bl)
   }
 
   tls_pages.clear(); // drop page refs
-
-  bl.append(std::move(buf));
   return len;
 }
 
@@ -1785,6 +1801,9 @@ int MemStore::PageSetObject::truncate(uint64_t size)
   data.get_range(page_offset, page_size, tls_pages);
   if (tls_pages.empty())
     return 0;
+  // it may be shared with a read, take it for writing
+  tls_pages.clear();
+  data.alloc_range(size, page_offset + page_size - size, tls_pages);
 
   auto page = tls_pages.begin();
   auto data = (*page)->data;
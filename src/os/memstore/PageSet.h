@@ -30,10 +30,13 @@ struct Page {
   boost::intrusive::avl_set_member_hook<> hook;
   uint64_t offset;
 
-  // avoid RefCountedObject because it has a virtual destructor
-  std::atomic<uint16_t> nrefs;
+  // avoid RefCountedObject because it has a virtual destructor.  the reads
+  // hand out buffers holding refs, so this can go well past the PageSet's
+  std::atomic<uint32_t> nrefs;
   void get() { ++nrefs; }
   void put() { if (--nrefs == 0) delete this; }
+  /// referenced by more than its PageSet, so it mustn't change in place
+  bool is_shared() const { return nrefs > 1; }
 
   typedef boost::intrusive_ptr<Page> Ref;
   friend void intrusive_ptr_add_ref(Page *p) { p->get(); }
@@ -144,12 +147,16 @@ class PageSet {
   size_t size() const { return pages.size(); }
   size_t get_page_size() const { return page_size; }
 
-  // allocate all pages that intersect the range [offset,length)
+  // allocate all pages that intersect the range [offset,length), for
+  // writing: the pages that are still referenced elsewhere, e.g. by the
+  // buffers of a read, are replaced by copies
   void alloc_range(uint64_t offset, uint64_t length, page_vector &range) {
     // loop in reverse so we can provide hints to avl_set::insert_check()
     //	and get O(1) insertions after the first
     uint64_t position = offset + length - 1;
 
+    // drop the caller's refs first, they would make the pages look shared
+    range.clear();
     range.resize(count_pages(offset, length));
     auto out = range.rbegin();
 
@@ -176,6 +183,14 @@ class PageSet {
           std::fill(page->data, page->data + offset - page->offset, 0);
       } else { // exists
         cur = insert.first;
+        if (cur->is_shared()) {
+          auto page = Page::create(page_size, page_offset);
+          std::copy(cur->data, cur->data + page_size, page->data);
+          Page *old = &*cur;
+          pages.replace_node(cur, *page);
+          old->put();
+          cur = pages.iterator_to(*page);
+        }
       }
       // add a reference to output vector
       out->reset(&*cur);
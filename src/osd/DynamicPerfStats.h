@@ -4,6 +4,9 @@
 #ifndef DYNAMIC_PERF_STATS_H
 #define DYNAMIC_PERF_STATS_H
 
+#include <array>
+#include <bitset>
+
 #include "include/random.h"
 #include "messages/MOSDOp.h"
 #include "mgr/OSDPerfMetricTypes.h"
@@ -41,13 +44,21 @@ public:
     }
   }
 
-  void set_queries(const std::list<OSDPerfMetricQuery> &queries) {
+  void set_queries(const std::list<OSDPerfMetricQuery> &queries,
+                   uint64_t sample_interval = 1) {
     std::map<OSDPerfMetricQuery,
              std::map<OSDPerfMetricKey, PerformanceCounters>> new_data;
     for (auto &query : queries) {
       std::swap(new_data[query], data[query]);
     }
     std::swap(data, new_data);
+    sample_every = std::max<uint64_t>(sample_interval, 1);
+    sample_skipped = 0;
+  }
+
+  // hand the collected counters over, keeping the sampling state
+  void swap_data(DynamicPerfStats *other) {
+    std::swap(data, other->data);
   }
 
   bool is_enabled() {
@@ -56,53 +67,62 @@ public:
 
   void add(const OSDService *osd, const pg_info_t &pg_info, const OpRequest& op,
            uint64_t inb, uint64_t outb, const utime_t &latency) {
+    // when sampling, an op stands for the ones skipped since the last one
+    if (sample_every > 1 && ++sample_skipped < sample_every) {
+      return;
+    }
+    sample_skipped = 0;
+    const uint64_t n = sample_every;
+    const bool is_write = op.may_write() || op.may_cache();
+    const bool is_read = op.may_read();
+    const uint64_t lat = latency.to_nsec();
 
     auto update_counter_fnc =
-        [&op, inb, outb, &latency](const PerformanceCounterDescriptor &d,
-                                   PerformanceCounter *c) {
+        [is_write, is_read, inb, outb, lat, n](
+          const PerformanceCounterDescriptor &d, PerformanceCounter *c) {
           ceph_assert(d.is_supported());
 
           switch(d.type) {
           case PerformanceCounterType::OPS:
-            c->first++;
+            c->first += n;
             return;
           case PerformanceCounterType::WRITE_OPS:
-            if (op.may_write() || op.may_cache()) {
-              c->first++;
+            if (is_write) {
+              c->first += n;
             }
             return;
           case PerformanceCounterType::READ_OPS:
-            if (op.may_read()) {
-              c->first++;
+            if (is_read) {
+              c->first += n;
             }
             return;
           case PerformanceCounterType::BYTES:
-            c->first += inb + outb;
+            c->first += (inb + outb) * n;
             return;
           case PerformanceCounterType::WRITE_BYTES:
-            if (op.may_write() || op.may_cache()) {
-              c->first += inb;
+            if (is_write) {
+              c->first += inb * n;
             }
             return;
           case PerformanceCounterType::READ_BYTES:
-            if (op.may_read()) {
-              c->first += outb;
+            if (is_read) {
+              c->first += outb * n;
             }
             return;
           case PerformanceCounterType::LATENCY:
-            c->first += latency.to_nsec();
-            c->second++;
+            c->first += lat * n;
+            c->second += n;
             return;
           case PerformanceCounterType::WRITE_LATENCY:
-            if (op.may_write() || op.may_cache()) {
-              c->first += latency.to_nsec();
-              c->second++;
+            if (is_write) {
+              c->first += lat * n;
+              c->second += n;
             }
             return;
           case PerformanceCounterType::READ_LATENCY:
-            if (op.may_read()) {
-              c->first += latency.to_nsec();
-              c->second++;
+            if (is_read) {
+              c->first += lat * n;
+              c->second += n;
             }
             return;
           default:
@@ -110,14 +130,16 @@ public:
           }
         };
 
-    auto get_subkey_fnc =
-        [&osd, &pg_info, &op](const OSDPerfMetricSubKeyDescriptor &d,
-                              OSDPerfMetricSubKey *sub_key) {
-          ceph_assert(d.is_supported());
-
+    // the queries mostly key by the same few fields, so stringify each
+    // of them once per op rather than once per query
+    std::array<std::string, NUM_SUB_KEY_TYPES> match_strings;
+    std::bitset<NUM_SUB_KEY_TYPES> have_match_strings;
+    auto get_match_string =
+        [&osd, &pg_info, &op](OSDPerfMetricSubKeyType type,
+                              std::string *out) {
           auto m = static_cast<const MOSDOp*>(op.get_req());
-          std::string match_string;
-          switch(d.type) {
+          auto &match_string = *out;
+          switch(type) {
           case OSDPerfMetricSubKeyType::CLIENT_ID:
             match_string = stringify(m->get_reqid().name);
             break;
@@ -145,6 +167,26 @@ public:
           default:
             ceph_abort_msg("unknown counter type");
           }
+        };
+
+    auto get_subkey_fnc =
+        [&](const OSDPerfMetricSubKeyDescriptor &d,
+            OSDPerfMetricSubKey *sub_key) {
+          ceph_assert(d.is_supported());
+
+          auto type = static_cast<size_t>(d.type);
+          auto &match_string = match_strings[type];
+          if (!have_match_strings[type]) {
+            get_match_string(d.type, &match_string);
+            have_match_strings[type] = true;
+          }
+
+          // the whole string, as asked for by most queries, needs no regex
+          if (d.regex_str == MATCH_ALL &&
+              match_string.find_first_of("\r\n") == std::string::npos) {
+            sub_key->push_back(match_string);
+            return true;
+          }
 
           std::smatch match;
           if (!std::regex_search(match_string, match, d.regex)) {
@@ -255,8 +297,14 @@ private:
     return true;
   }
 
+  static constexpr size_t NUM_SUB_KEY_TYPES =
+    static_cast<size_t>(OSDPerfMetricSubKeyType::SNAP_ID) + 1;
+  static constexpr const char *MATCH_ALL = "^(.*)$";
+
   std::map<OSDPerfMetricQuery,
            std::map<OSDPerfMetricKey, PerformanceCounters>> data;
+  uint64_t sample_every = 1;   ///< count one op out of this many
+  uint64_t sample_skipped = 0; ///< ops skipped since the last one counted
 };
 
 #endif // DYNAMIC_PERF_STATS_H
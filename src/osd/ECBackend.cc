@@ -90,6 +90,7 @@ ostream &operator<<(ostream &lhs, const ECBackend::read_request_t &rhs)
   return lhs << "read_request_t(to_read=[" << rhs.to_read << "]"
 	     << ", need=" << rhs.need
 	     << ", want_attrs=" << rhs.want_attrs
+	     << ", hedged=" << rhs.hedged
 	     << ")";
 }
 
@@ -1222,6 +1223,10 @@ void ECBackend::handle_sub_read_reply(
 
   ceph_assert(rop.in_progress.count(from));
   rop.in_progress.erase(from);
+  if (auto s = rop.sent.find(from); s != rop.sent.end()) {
+    get_parent()->record_peer_read_latency(
+      from.osd, ceph::mono_clock::now() - s->second);
+  }
   unsigned is_complete = 0;
   // For redundant reads check for completion as each shard comes in,
   // or in a non-recovery read check for completion once all the shards read.
@@ -1246,7 +1251,10 @@ void ECBackend::handle_sub_read_reply(
 	  // If we don't have enough copies, try other pg_shard_ts if available.
 	  // During recovery there may be multiple osds with copies of the same shard,
 	  // so getting EIO from one may result in multiple passes through this code path.
-	  if (!rop.do_redundant_reads) {
+	  // a fast_read already read every shard, but a hedged read
+	  // may still have more to try
+	  if (!rop.do_redundant_reads ||
+	      rop.to_read.find(iter->first)->second.hedged) {
 	    int r = send_all_remaining_reads(iter->first, rop);
 	    if (r == 0) {
 	      // We added to in_progress and not incrementing is_complete
@@ -1306,10 +1314,15 @@ void ECBackend::complete_read_op(ReadOp &rop, RecoveryMessages *m)
     }
   }
   // if the read op is over. clean all the data of this tid.
+  auto now = ceph::mono_clock::now();
   for (set<pg_shard_t>::iterator iter = rop.in_progress.begin();
     iter != rop.in_progress.end();
     iter++) {
     shard_to_read_map[*iter].erase(rop.tid);
+    // its reply will be dropped, but it is at least this slow
+    if (auto s = rop.sent.find(*iter); s != rop.sent.end()) {
+      get_parent()->record_peer_read_latency(iter->osd, now - s->second);
+    }
   }
   rop.in_progress.clear();
   tid_to_read_map.erase(rop.tid);
@@ -1428,6 +1441,8 @@ void ECBackend::on_change()
     cache.release_write_pin(op.second.pin);
   }
   tid_to_op_map.clear();
+  // divergent writes on the shards may be rolled back
+  cache.drop_cached();
 
   for (map<ceph_tid_t, ReadOp>::iterator i = tid_to_read_map.begin();
        i != tid_to_read_map.end();
@@ -1590,7 +1605,8 @@ int ECBackend::get_min_avail_to_read_shards(
   const set<int> &want,
   bool for_recovery,
   bool do_redundant_reads,
-  map<pg_shard_t, vector<pair<int, int>>> *to_read)
+  map<pg_shard_t, vector<pair<int, int>>> *to_read,
+  bool *hedged)
 {
   // Make sure we don't do redundant reads for recovery
   ceph_assert(!for_recovery || !do_redundant_reads);
@@ -1612,7 +1628,25 @@ int ECBackend::get_min_avail_to_read_shards(
       for (auto &&i: have) {
         need[i] = subchunks_list;
       }
-  } 
+  } else if (!for_recovery) {
+    double ratio = cct->_conf->osd_ec_read_slow_shard_ratio;
+    unsigned extra = cct->_conf->osd_ec_read_hedge_shards;
+    if (!hedged || ec_impl->get_sub_chunk_count() != 1)
+      extra = 0;
+    if (ratio > 0 || extra) {
+      map<int, double> latency;
+      for (auto i : have) {
+	latency[i] = get_parent()->get_peer_read_latency(
+	  shards[shard_id_t(i)].osd);
+      }
+      ECUtil::avoid_slow_shards(ec_impl, ratio, want, latency, &need);
+      // hedge with the fastest of the shards we are not reading yet
+      if (extra && ECUtil::add_hedge_shards(ec_impl, extra, latency, &need))
+	*hedged = true;
+      dout(20) << __func__ << ": " << hoid << " shard latencies " << latency
+	       << ", reading " << need << dendl;
+    }
+  }
 
   if (!to_read)
     return 0;
@@ -1629,6 +1663,7 @@ int ECBackend::get_remaining_shards(
   const set<int> &avail,
   const set<int> &want,
   const read_result_t &result,
+  const map<int, vector<pair<int, int>>> &subchunks_read,
   map<pg_shard_t, vector<pair<int, int>>> *to_read,
   bool for_recovery)
 {
@@ -1658,14 +1693,38 @@ int ECBackend::get_remaining_shards(
     }
   }
 
+  // keep reading sub-chunks as long as the shards already read were asked
+  // for the same ones the new plan needs of them, as a repair from other
+  // helpers does. otherwise fall back to whole chunks, reading those that
+  // only returned sub-chunks again.
   vector<pair<int, int>> subchunks;
   subchunks.push_back(make_pair(0, ec_impl->get_sub_chunk_count()));
+  bool keep_subchunks = true;
+  for (auto &p : need) {
+    auto r = subchunks_read.find(p.first);
+    if (r != subchunks_read.end() && r->second != p.second) {
+      keep_subchunks = false;
+      break;
+    }
+  }
   for (set<int>::iterator i = shards_left.begin();
        i != shards_left.end();
        ++i) {
     ceph_assert(shards.count(shard_id_t(*i)));
     ceph_assert(avail.find(*i) == avail.end());
-    to_read->insert(make_pair(shards[shard_id_t(*i)], subchunks));
+    to_read->insert(make_pair(shards[shard_id_t(*i)],
+			      keep_subchunks ? need[*i] : subchunks));
+  }
+  if (!keep_subchunks) {
+    for (auto &p : need) {
+      auto r = subchunks_read.find(p.first);
+      if (r != subchunks_read.end() && r->second != subchunks) {
+	ceph_assert(shards.count(shard_id_t(p.first)));
+	dout(10) << __func__ << " reading shard " << p.first
+		 << " of " << hoid << " again in whole" << dendl;
+	to_read->insert(make_pair(shards[shard_id_t(p.first)], subchunks));
+      }
+    }
   }
   return 0;
 }
@@ -1719,6 +1778,7 @@ void ECBackend::do_read_op(ReadOp &op)
 	need_attrs = false;
       }
       messages[j->first].subchunks[i->first] = j->second;
+      op.subchunks_read[i->first][j->first.shard] = j->second;
       op.obj_to_source[i->first].insert(j->first);
       op.source_to_obj[j->first].insert(i->first);
     }
@@ -1741,10 +1801,12 @@ void ECBackend::do_read_op(ReadOp &op)
     }
   }
 
+  auto now = ceph::mono_clock::now();
   for (map<pg_shard_t, ECSubRead>::iterator i = messages.begin();
        i != messages.end();
        ++i) {
     op.in_progress.insert(i->first);
+    op.sent[i->first] = now;
     shard_to_read_map[i->first].insert(op.tid);
     i->second.tid = tid;
     MOSDECSubOpRead *msg = new MOSDECSubOpRead;
@@ -1874,12 +1936,16 @@ bool ECBackend::try_state_to_reads()
     dout(20) << __func__ << ": invalidating cache after this op"
 	     << dendl;
     pipeline_state.invalidate();
+    cache.drop_cached();
   }
 
   waiting_state.pop_front();
   waiting_reads.push_back(*op);
 
   if (op->using_cache) {
+    cache.set_max_cached_bytes(
+      get_parent()->get_pool().allows_ecoverwrites() ?
+      cct->_conf->osd_ec_extent_cache_max_bytes : 0);
     cache.open_write_pin(op->pin);
 
     extent_set empty;
@@ -2119,7 +2185,8 @@ bool ECBackend::try_finish_rmw()
   }
 
   if (op->using_cache) {
-    cache.release_write_pin(op->pin);
+    // writes that bypassed the cache may follow this one
+    cache.release_write_pin(op->pin, pipeline_state.caching_enabled());
   }
   tid_to_op_map.erase(op->tid);
 
@@ -2346,14 +2413,19 @@ void ECBackend::objects_read_and_reconstruct(
   get_want_to_read_shards(&want_to_read);
     
   map<hobject_t, read_request_t> for_read_op;
+  // any hedged object has the op complete its objects as they decode
+  bool any_hedged = false;
   for (auto &&to_read: reads) {
     map<pg_shard_t, vector<pair<int, int>>> shards;
+    bool hedged = false;
     int r = get_min_avail_to_read_shards(
       to_read.first,
       want_to_read,
       false,
       fast_read,
-      &shards);
+      &shards,
+      &hedged);
+    any_hedged |= hedged;
     ceph_assert(r == 0);
 
     CallClientContexts *c = new CallClientContexts(
@@ -2368,7 +2440,8 @@ void ECBackend::objects_read_and_reconstruct(
 	  to_read.second,
 	  shards,
 	  false,
-	  c)));
+	  c,
+	  hedged)));
     obj_want_to_read.insert(make_pair(to_read.first, want_to_read));
   }
 
@@ -2377,7 +2450,7 @@ void ECBackend::objects_read_and_reconstruct(
     obj_want_to_read,
     for_read_op,
     OpRequestRef(),
-    fast_read, false);
+    fast_read || any_hedged, false);
   return;
 }
 
@@ -2393,9 +2466,20 @@ int ECBackend::send_all_remaining_reads(
   dout(10) << __func__ << " have/error shards=" << already_read << dendl;
   map<pg_shard_t, vector<pair<int, int>>> shards;
   int r = get_remaining_shards(hoid, already_read, rop.want_to_read[hoid],
-			       rop.complete[hoid], &shards, rop.for_recovery);
+			       rop.complete[hoid], rop.subchunks_read[hoid],
+			       &shards, rop.for_recovery);
   if (r)
     return r;
+  if (shards.empty())
+    return -EIO;
+
+  // a shard read again in whole only returned sub-chunks so far. drop
+  // them, so that it does not count as read until the whole chunk comes
+  for (auto &&i : shards) {
+    for (auto &&j : rop.complete[hoid].returned) {
+      j.get<2>().erase(i.first);
+    }
+  }
 
   list<boost::tuple<uint64_t, uint64_t, uint32_t> > offsets =
     rop.to_read.find(hoid)->second.to_read;
@@ -2410,6 +2494,7 @@ int ECBackend::send_all_remaining_reads(
     dout(10) << __func__ << " want attrs again" << dendl;
   }
 
+  bool hedged = rop.to_read.find(hoid)->second.hedged;
   rop.to_read.erase(hoid);
   rop.to_read.insert(make_pair(
       hoid,
@@ -2417,7 +2502,8 @@ int ECBackend::send_all_remaining_reads(
 	offsets,
 	shards,
 	want_attrs,
-	c)));
+	c,
+	hedged)));
   do_read_op(rop);
   return 0;
 }
@@ -2484,13 +2570,14 @@ int ECBackend::be_deep_scrub(
   if (stride % sinfo.get_chunk_size())
     stride += sinfo.get_chunk_size() - (stride % sinfo.get_chunk_size());
 
-  bufferlist bl;
-  r = store->read(
+  uint32_t crc;
+  r = store->read_crc32c(
     ch,
     ghobject_t(
       poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
     pos.data_pos,
-    stride, bl,
+    stride,
+    pos.data_hash.digest(), &crc,
     fadvise_flags);
   if (r < 0) {
     dout(20) << __func__ << "  " << poid << " got "
@@ -2498,7 +2585,7 @@ int ECBackend::be_deep_scrub(
     o.read_error = true;
     return 0;
   }
-  if (bl.length() % sinfo.get_chunk_size()) {
+  if (r % sinfo.get_chunk_size()) {
     dout(20) << __func__ << "  " << poid << " got "
 	     << r << " on read, not chunk size " << sinfo.get_chunk_size() << " aligned"
 	     << dendl;
@@ -2506,9 +2593,10 @@ int ECBackend::be_deep_scrub(
     return 0;
   }
   if (r > 0) {
-    pos.data_hash << bl;
+    pos.data_hash = bufferhash(crc);
   }
   pos.data_pos += r;
+  pos.bytes_read += r;
   if (r == (int)stride) {
     return -EINPROGRESS;
   }
@@ -354,14 +354,18 @@ public:
     const list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
     const map<pg_shard_t, vector<pair<int, int>>> need;
     const bool want_attrs;
+    // True if need has a few extra shards rather than all of them
+    // (osd_ec_read_hedge_shards), so others are left to try
+    const bool hedged;
     GenContext<pair<RecoveryMessages *, read_result_t& > &> *cb;
     read_request_t(
       const list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read,
       const map<pg_shard_t, vector<pair<int, int>>> &need,
       bool want_attrs,
-      GenContext<pair<RecoveryMessages *, read_result_t& > &> *cb)
+      GenContext<pair<RecoveryMessages *, read_result_t& > &> *cb,
+      bool hedged = false)
       : to_read(to_read), need(need), want_attrs(want_attrs),
-	cb(cb) {}
+	hedged(hedged), cb(cb) {}
   };
   friend ostream &operator<<(ostream &lhs, const read_request_t &rhs);
 
@@ -385,10 +389,13 @@ public:
 
     map<hobject_t, set<pg_shard_t>> obj_to_source;
     map<pg_shard_t, set<hobject_t> > source_to_obj;
+    /// the sub-chunks last asked of each shard, by object
+    map<hobject_t, map<int, vector<pair<int, int>>>> subchunks_read;
 
     void dump(Formatter *f) const;
 
     set<pg_shard_t> in_progress;
+    map<pg_shard_t, ceph::mono_time> sent;  ///< when each sub read was sent
 
     ReadOp(
       int priority,
@@ -652,7 +659,8 @@ public:
     const set<int> &want,      ///< [in] desired shards
     bool for_recovery,         ///< [in] true if we may use non-acting replicas
     bool do_redundant_reads,   ///< [in] true if we want to issue redundant reads to reduce latency
-    map<pg_shard_t, vector<pair<int, int>>> *to_read   ///< [out] shards, corresponding subchunks to read
+    map<pg_shard_t, vector<pair<int, int>>> *to_read,  ///< [out] shards, corresponding subchunks to read
+    bool *hedged = nullptr     ///< [out] true if extra shards were added to hedge a client read
     ); ///< @return error code, 0 on success
 
   int get_remaining_shards(
@@ -660,6 +668,7 @@ public:
     const set<int> &avail,
     const set<int> &want,
     const read_result_t &result,
+    const map<int, vector<pair<int, int>>> &subchunks_read,
     map<pg_shard_t, vector<pair<int, int>>> *to_read,
     bool for_recovery);
 
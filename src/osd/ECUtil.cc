@@ -1,6 +1,7 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 
 #include <errno.h>
+#include <algorithm>
 #include "include/encoding.h"
 #include "ECUtil.h"
 
@@ -28,19 +29,29 @@ int ECUtil::decode(
   if (total_data_size == 0)
     return 0;
 
+  // decode the data chunks of all the stripes at once, then interleave
+  // them back into stripes
+  unsigned k = ec_impl->get_data_chunk_count();
+  const vector<int> &mapping = ec_impl->get_chunk_mapping();
+  set<int> want;
+  for (unsigned i = 0; i < k; i++) {
+    want.insert(mapping.size() > i ? mapping[i] : i);
+  }
+  map<int, bufferlist> decoded;
+  int r = ec_impl->decode_stripes(want, to_decode, &decoded,
+				  sinfo.get_chunk_size());
+  ceph_assert(r == 0);
   for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
-    map<int, bufferlist> chunks;
-    for (map<int, bufferlist>::iterator j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
+    for (unsigned j = 0; j < k; j++) {
+      bufferlist &chunk = decoded[mapping.size() > j ? mapping[j] : j];
+      ceph_assert(chunk.length() == total_data_size);
+      bufferlist bl;
+      bl.substr_of(chunk, i, sinfo.get_chunk_size());
+      out->claim_append(bl);
     }
-    bufferlist bl;
-    int r = ec_impl->decode_concat(chunks, &bl);
-    ceph_assert(r == 0);
-    ceph_assert(bl.length() == sinfo.get_stripe_width());
-    out->claim_append(bl);
   }
+  ceph_assert(out->length() ==
+	      total_data_size / sinfo.get_chunk_size() * sinfo.get_stripe_width());
   return 0;
 }
 
@@ -93,6 +104,21 @@ int ECUtil::decode(
     }
   }
 
+  if (ec_impl->get_sub_chunk_count() == 1) {
+    // whole chunks are read, all the stripes can be decoded at once
+    map<int, bufferlist> out_bls;
+    r = ec_impl->decode_stripes(need, to_decode, &out_bls,
+				sinfo.get_chunk_size());
+    ceph_assert(r == 0);
+    for (auto j = out.begin(); j != out.end(); ++j) {
+      ceph_assert(out_bls.count(j->first));
+      ceph_assert(out_bls[j->first].length() ==
+		  chunks_count * sinfo.get_chunk_size());
+      j->second->claim_append(out_bls[j->first]);
+    }
+    return 0;
+  }
+
   for (int i = 0; i < chunks_count; i++) {
     map<int, bufferlist> chunks;
     for (auto j = to_decode.begin();
@@ -133,19 +159,8 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
-    map<int, bufferlist> encoded;
-    bufferlist buf;
-    buf.substr_of(in, i, sinfo.get_stripe_width());
-    int r = ec_impl->encode(want, buf, &encoded);
-    ceph_assert(r == 0);
-    for (map<int, bufferlist>::iterator i = encoded.begin();
-	 i != encoded.end();
-	 ++i) {
-      ceph_assert(i->second.length() == sinfo.get_chunk_size());
-      (*out)[i->first].claim_append(i->second);
-    }
-  }
+  int r = ec_impl->encode_stripes(want, sinfo.get_stripe_width(), in, out);
+  ceph_assert(r == 0);
 
   for (map<int, bufferlist>::iterator i = out->begin();
        i != out->end();
@@ -158,6 +173,65 @@ int ECUtil::encode(
   return 0;
 }
 
+void ECUtil::avoid_slow_shards(
+  ErasureCodeInterfaceRef &ec_impl,
+  double ratio,
+  const set<int> &want,
+  const map<int, double> &latency,
+  map<int, vector<pair<int, int>>> *need)
+{
+  if (ratio <= 0)
+    return;
+  set<int> have;
+  vector<pair<double, int>> lat;
+  vector<double> known;
+  for (auto [i, l] : latency) {
+    have.insert(i);
+    lat.push_back(make_pair(l, i));
+    if (l > 0)
+      known.push_back(l);
+  }
+  if (known.size() < 2)
+    return;
+  std::nth_element(known.begin(), known.begin() + known.size() / 2,
+		   known.end());
+  double limit = known[known.size() / 2] * ratio;
+
+  std::sort(lat.rbegin(), lat.rend());
+  for (auto [l, i] : lat) {
+    if (l <= limit)
+      break;
+    if (!need->count(i))
+      continue;
+    have.erase(i);
+    map<int, vector<pair<int, int>>> n;
+    if (ec_impl->minimum_to_decode(want, have, &n) < 0)
+      break;
+    need->swap(n);
+  }
+}
+
+unsigned ECUtil::add_hedge_shards(
+  ErasureCodeInterfaceRef &ec_impl,
+  unsigned extra,
+  const map<int, double> &latency,
+  map<int, vector<pair<int, int>>> *need)
+{
+  vector<pair<double, int>> spare;
+  for (auto [i, l] : latency) {
+    if (!need->count(i))
+      spare.push_back(make_pair(l, i));
+  }
+  std::sort(spare.begin(), spare.end());
+  vector<pair<int, int>> subchunks_list;
+  subchunks_list.push_back(make_pair(0, ec_impl->get_sub_chunk_count()));
+  unsigned added = 0;
+  for (; added < spare.size() && added < extra; ++added) {
+    (*need)[spare[added].second] = subchunks_list;
+  }
+  return added;
+}
+
 void ECUtil::HashInfo::append(uint64_t old_size,
 			      map<int, bufferlist> &to_append) {
   ceph_assert(old_size == total_chunk_size);
@@ -164,6 +164,24 @@ typedef std::shared_ptr<HashInfo> HashInfoRef;
 bool is_hinfo_key_string(const std::string &key);
 const std::string &get_hinfo_key();
 
+/// drop the shards in need whose latency (in secs, 0 if unknown) is
+/// more than ratio times the median, slowest first, for as long as the
+/// shards left still decode want.  latency has every available shard.
+void avoid_slow_shards(
+  ErasureCodeInterfaceRef &ec_impl,
+  double ratio,
+  const std::set<int> &want,
+  const std::map<int, double> &latency,
+  std::map<int, std::vector<std::pair<int, int>>> *need);
+
+/// add up to extra of the available shards need doesn't have yet, the
+/// fastest first.  @return the number added
+unsigned add_hedge_shards(
+  ErasureCodeInterfaceRef &ec_impl,
+  unsigned extra,
+  const std::map<int, double> &latency,
+  std::map<int, std::vector<std::pair<int, int>>> *need);
+
 WRITE_CLASS_ENCODER(ECUtil::HashInfo)
 }
 #endif
@@ -20,6 +20,7 @@ void ExtentCache::extent::_link_pin_state(pin_state &pin_state)
   ceph_assert(!parent_pin_state);
   parent_pin_state = &pin_state;
   pin_state.pin_list.push_back(*this);
+  pin_state.bytes += length;
 }
 
 void ExtentCache::extent::_unlink_pin_state()
@@ -28,6 +29,7 @@ void ExtentCache::extent::_unlink_pin_state()
   ceph_assert(parent_pin_state);
   auto liter = pin_state::list::s_iterator_to(*this);
   parent_pin_state->pin_list.erase(liter);
+  parent_pin_state->bytes -= length;
   parent_pin_state = nullptr;
 }
 
@@ -107,6 +109,16 @@ ExtentCache::object_extent_set *ExtentCache::get_if_exists(
   }
 }
 
+void ExtentCache::trim_cached(uint64_t target)
+{
+  while (cached.bytes > target) {
+    unique_ptr<extent> extent(&cached.pin_list.front());
+    auto &eset = *(extent->parent_extent_set);
+    extent->unlink();
+    remove_and_destroy_if_empty(eset);
+  }
+}
+
 std::pair<
   ExtentCache::object_extent_set::set::iterator,
   ExtentCache::object_extent_set::set::iterator
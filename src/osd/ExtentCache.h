@@ -92,6 +92,15 @@
    All of the above suggests that there are 3 things users can
    ask of the cache corresponding to the 3 Write pipelines
    states.
+
+   Optionally (set_max_cached_bytes), extents released by a completed
+   write are kept, up to a byte limit, rather than dropped:
+   3) Cached:
+      - This extent has the committed data of the last write to it
+      - Nothing pins it; reserve_extents_for_rmw treats it as present
+        and moves it to the new write pin, like Write Pinned N
+      - Cached extents are evicted in LRU order, and must be dropped
+        (drop_cached) whenever a write may bypass the cache
  */
 
 /// If someone wants these types, but not ExtentCache, move to another file
@@ -351,9 +360,11 @@ private:
     enum pin_type_t {
       NONE,
       WRITE,
+      CACHED,
     };
     pin_type_t pin_type = NONE;
     bool is_write() const { return pin_type == WRITE; }
+    uint64_t bytes = 0;  ///< total length of extents in pin_list
 
     pin_state(const pin_state &other) = delete;
     pin_state &operator=(const pin_state &other) = delete;
@@ -379,8 +390,14 @@ private:
     }
   };
 
-  void release_pin(pin_state &p) {
+  void release_pin(pin_state &p, bool keep_cached = false) {
     for (auto iter = p.pin_list.begin(); iter != p.pin_list.end(); ) {
+      if (keep_cached && max_cached_bytes && iter->bl) {
+	extent *ext = &*iter;
+	iter++; // move will invalidate
+	ext->move(cached);
+	continue;
+      }
       unique_ptr<extent> extent(&*iter); // we now own this
       iter++; // unlink will invalidate
       ceph_assert(extent->parent_extent_set);
@@ -390,6 +407,23 @@ private:
     }
     p.tid = 0;
     p.pin_type = pin_state::NONE;
+    trim_cached();
+  }
+
+  /// unpinned extents kept after their write completed, oldest first
+  struct cached_pin : pin_state {
+    cached_pin() {
+      pin_type = CACHED;
+    }
+    ~cached_pin() {
+      pin_type = NONE;
+    }
+  } cached;
+  uint64_t max_cached_bytes = 0;
+
+  void trim_cached(uint64_t target);
+  void trim_cached() {
+    trim_cached(max_cached_bytes);
   }
 
 public:
@@ -476,10 +510,35 @@ public:
 
   /**
    * Release all buffers pinned by pin
+   *
+   * @param pin [in,out] pin to release
+   * @param keep_cached [in] true if the write committed and its
+   *                         buffers may be kept as cached extents
    */
   void release_write_pin(
-    write_pin &pin) {
-    release_pin(pin);
+    write_pin &pin,
+    bool keep_cached = false) {
+    release_pin(pin, keep_cached);
+  }
+
+  /// Bound the cached extents, 0 disables caching
+  void set_max_cached_bytes(uint64_t max) {
+    max_cached_bytes = max;
+    trim_cached();
+  }
+
+  /// Drop all cached extents, pinned extents are not affected
+  void drop_cached() {
+    trim_cached(0);
+  }
+
+  uint64_t get_cached_bytes() const {
+    return cached.bytes;
+  }
+
+  ExtentCache() = default;
+  ~ExtentCache() {
+    drop_cached();
   }
 
   ostream &print(
@@ -452,4 +452,69 @@ public:
 };
 WRITE_CLASS_ENCODER(BloomHitSet)
 
+/**
+ * approximate, decaying access counts of objects
+ *
+ * A count-min sketch: each object has a counter in each row, picked by
+ * hashing it differently per row, and its count is the smallest of
+ * them, which is never lower than the actual count. Only the smallest
+ * of the counters are bumped on an insert. Unlike a series of HitSets
+ * it takes the same memory whatever the number of objects, and is
+ * not persisted. decay() halves the counts.
+ */
+class TemperatureSketch {
+  static constexpr unsigned DEPTH = 4;
+  uint32_t mask;
+  std::vector<uint16_t> counters;  ///< DEPTH rows of mask + 1 counters
+
+  uint16_t& counter(unsigned row, uint32_t hash) {
+    static constexpr uint64_t seeds[DEPTH] = {
+      0x9e3779b97f4a7c15ull, 0xc2b2ae3d27d4eb4full,
+      0x165667b19e3779f9ull, 0xd6e8feb86659fd93ull,
+    };
+    uint64_t h = ((uint64_t)hash + 1) * seeds[row];
+    h ^= h >> 29;
+    return counters[row * (mask + 1) + ((h >> 32) & mask)];
+  }
+
+public:
+  /// width is rounded up to a power of 2
+  explicit TemperatureSketch(uint32_t width) {
+    uint32_t w = 1;
+    while (w < width && w < (1u << 30))
+      w <<= 1;
+    mask = w - 1;
+    counters.resize(DEPTH * w);
+  }
+
+  void insert(const hobject_t& o) {
+    uint16_t *c[DEPTH];
+    uint16_t min = UINT16_MAX;
+    for (unsigned row = 0; row < DEPTH; ++row) {
+      c[row] = &counter(row, o.get_hash());
+      min = std::min(min, *c[row]);
+    }
+    if (min == UINT16_MAX)
+      return;
+    for (unsigned row = 0; row < DEPTH; ++row) {
+      if (*c[row] == min)
+	++*c[row];
+    }
+  }
+  unsigned count(const hobject_t& o) {
+    uint16_t min = UINT16_MAX;
+    for (unsigned row = 0; row < DEPTH; ++row) {
+      min = std::min(min, counter(row, o.get_hash()));
+    }
+    return min;
+  }
+  void decay() {
+    for (auto& c : counters)
+      c >>= 1;
+  }
+  uint32_t get_width() const {
+    return mask + 1;
+  }
+};
+
 #endif
@@ -22,6 +22,7 @@
 
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <signal.h>
 #include <boost/scoped_ptr.hpp>
 
@@ -51,6 +52,7 @@
 #include "common/pick_address.h"
 #include "common/blkdev.h"
 #include "common/numa.h"
+#include "common/Thread.h"
 
 #include "os/ObjectStore.h"
 #ifdef HAVE_LIBFUSE
@@ -77,6 +79,7 @@
 #include "messages/MOSDBeacon.h"
 #include "messages/MOSDRepOp.h"
 #include "messages/MOSDRepOpReply.h"
+#include "messages/MOSDRepOpBatch.h"
 #include "messages/MOSDBoot.h"
 #include "messages/MOSDPGTemp.h"
 #include "messages/MOSDPGReadyToMerge.h"
@@ -223,6 +226,13 @@ OSDService::OSDService(OSD *osd) :
   class_handler(osd->class_handler),
   osd_max_object_size(cct->_conf, "osd_max_object_size"),
   osd_skip_data_digest(cct->_conf, "osd_skip_data_digest"),
+  osd_hit_set_sample_ratio(cct->_conf, "osd_hit_set_sample_ratio"),
+  osd_omap_scan_readahead(cct->_conf, "osd_omap_scan_readahead"),
+  osd_max_pg_omap_read_objects(cct->_conf, "osd_max_pg_omap_read_objects"),
+  osd_omap_cursors_per_pg(cct->_conf, "osd_omap_cursors_per_pg"),
+  osd_omap_cursors_max(cct->_conf, "osd_omap_cursors_max"),
+  osd_omap_cursor_ttl(cct->_conf, "osd_omap_cursor_ttl"),
+  repop_batcher(cct),
   publish_lock{ceph::make_mutex("OSDService::publish_lock")},
   pre_publish_lock{ceph::make_mutex("OSDService::pre_publish_lock")},
   max_oldest_map(0),
@@ -457,6 +467,7 @@ void OSDService::shutdown_reserver()
 
 void OSDService::shutdown()
 {
+  repop_batcher.stop();
   {
     std::lock_guard l(watch_lock);
     watch_timer.shutdown();
@@ -475,6 +486,7 @@ void OSDService::shutdown()
 void OSDService::init()
 {
   reserver_finisher.start();
+  repop_batcher.start();
   for (auto f : objecter_finishers) {
     f->start();
   }
@@ -994,7 +1006,13 @@ void OSDService::send_message_osd_cluster(int peer, Message *m, epoch_t from_epo
   ConnectionRef peer_con = osd->cluster_messenger->connect_to_osd(
     next_map->get_cluster_addrs(peer));
   maybe_share_map(peer_con.get(), next_map);
-  peer_con->send_message(m);
+  if (m->get_type() == MSG_OSD_REPOP &&
+      next_map->require_osd_release >= CEPH_RELEASE_OCTOPUS) {
+    repop_batcher.queue(peer_con, m);
+  } else {
+    repop_batcher.flush(peer_con.get());
+    peer_con->send_message(m);
+  }
   release_map(next_map);
 }
 
@@ -1117,6 +1135,35 @@ void OSDService::send_pg_temp()
   _sent_pg_temp();
 }
 
+void OSDService::record_peer_read_latency(int peer, ceph::timespan lat)
+{
+  auto now = ceph::coarse_mono_clock::now();
+  double secs = std::chrono::duration<double>(lat).count();
+  std::lock_guard l(peer_read_lat_lock);
+  auto p = peer_read_lat.find(peer);
+  if (p == peer_read_lat.end() ||
+      now - p->second.first > std::chrono::seconds(10)) {
+    peer_read_lat[peer] = make_pair(now, secs);
+  } else {
+    p->second.first = now;
+    p->second.second += (secs - p->second.second) / 8;
+  }
+}
+
+double OSDService::get_peer_read_latency(int peer)
+{
+  auto now = ceph::coarse_mono_clock::now();
+  std::lock_guard l(peer_read_lat_lock);
+  auto p = peer_read_lat.find(peer);
+  // forget peers we have not read from lately, so that a peer we
+  // stopped reading from for being slow gets another chance
+  if (p == peer_read_lat.end() ||
+      now - p->second.first > std::chrono::seconds(10)) {
+    return 0;
+  }
+  return p->second.second;
+}
+
 void OSDService::send_pg_created(pg_t pgid)
 {
   std::lock_guard l(pg_created_lock);
@@ -1236,6 +1283,53 @@ void OSDService::dec_scrubs_active()
   sched_scrub_lock.Unlock();
 }
 
+void OSDService::_scrub_budget_refill(double rate)
+{
+  auto now = ceph::mono_clock::now();
+  if (scrub_budget_stamp != ceph::mono_time()) {
+    // allow a burst of at most one second's worth
+    scrub_budget = std::min(
+      rate,
+      scrub_budget + rate * std::chrono::duration<double>(
+	now - scrub_budget_stamp).count());
+  }
+  scrub_budget_stamp = now;
+}
+
+void OSDService::scrub_budget_charge(uint64_t bytes)
+{
+  double rate = cct->_conf->osd_scrub_max_bytes_per_sec;
+  if (!rate || !bytes) {
+    return;
+  }
+  std::lock_guard l(scrub_budget_lock);
+  _scrub_budget_refill(rate);
+  scrub_budget -= bytes;
+}
+
+double OSDService::scrub_budget_wait()
+{
+  double rate = cct->_conf->osd_scrub_max_bytes_per_sec;
+  if (!rate) {
+    return 0;
+  }
+  std::lock_guard l(scrub_budget_lock);
+  _scrub_budget_refill(rate);
+  if (scrub_budget >= 0) {
+    return 0;
+  }
+  return -scrub_budget / rate;
+}
+
+unsigned OSDService::get_queued_client_ops() const
+{
+  unsigned n = 0;
+  for (auto sdata : osd->shards) {
+    n += sdata->queued_client_ops;
+  }
+  return n;
+}
+
 void OSDService::retrieve_epochs(epoch_t *_boot_epoch, epoch_t *_up_epoch,
                                  epoch_t *_bind_epoch) const
 {
@@ -1375,6 +1469,8 @@ MOSDMap *OSDService::build_incremental_map_msg(epoch_t since, epoch_t to,
 
 void OSDService::send_map(MOSDMap *m, Connection *con)
 {
+  // a map must not overtake the repops queued ahead of it
+  repop_batcher.flush(con);
   con->send_message(m);
 }
 
@@ -2085,6 +2181,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
   asok_hook(NULL),
   m_osd_pg_epoch_max_lag_factor(cct->_conf.get_val<double>(
 				  "osd_pg_epoch_max_lag_factor")),
+  m_osd_op_run_to_completion(cct->_conf.get_val<bool>(
+			       "osd_op_run_to_completion")),
   osd_compat(get_osd_compat_set()),
   osd_op_tp(cct, "OSD::osd_op_tp", "tp_osd_tp",
 	    get_num_op_threads()),
@@ -2149,6 +2247,9 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
                                            cct->_conf->osd_op_history_duration);
   op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                     cct->_conf->osd_op_history_slow_op_threshold);
+  op_tracker.set_history_sample_rate_and_size(
+    cct->_conf.get_val<uint64_t>("osd_op_history_sample_rate"),
+    cct->_conf.get_val<uint64_t>("osd_op_history_sample_size"));
 #ifdef WITH_BLKIN
   std::stringstream ss;
   ss << "osd." << whoami;
@@ -2164,7 +2265,8 @@ OSD::OSD(CephContext *cct_, ObjectStore *store_,
       this,
       cct->_conf->osd_op_pq_max_tokens_per_priority,
       cct->_conf->osd_op_pq_min_cost,
-      op_queue);
+      op_queue,
+      store_is_rotational);
     shards.push_back(one_shard);
   }
 }
@@ -2260,6 +2362,23 @@ int OSD::set_numa_affinity()
     // this takes precedence over the automagic logic above
     numa_node = node;
   }
+  if (numa_node < 0 &&
+      g_conf().get_val<bool>("osd_numa_auto_affinity") &&
+      g_conf().get_val<bool>("osd_numa_split_affinity")) {
+    // no node serves everything; keep the messenger workers next to the
+    // network and the kv and aio threads next to the storage.  the
+    // memory they allocate follows them.
+    msgr_numa_node = -1;
+    store_numa_node = -1;
+    if (front_node >= 0 && front_node == back_node &&
+	set_threads_numa_affinity(front_node, {"msgr-worker-"})) {
+      msgr_numa_node = front_node;
+    }
+    if (store_node >= 0 &&
+	set_threads_numa_affinity(store_node, {"bstore_"})) {
+      store_numa_node = store_node;
+    }
+  }
   if (numa_node >= 0) {
     int r = get_numa_node_cpu_set(numa_node, &numa_cpu_set_size, &numa_cpu_set);
     if (r < 0) {
@@ -2271,20 +2390,53 @@ int OSD::set_numa_affinity()
 	      << " cpus "
 	      << cpu_set_to_str_list(numa_cpu_set_size, &numa_cpu_set)
 	      << dendl;
-      r = sched_setaffinity(getpid(), numa_cpu_set_size, &numa_cpu_set);
+      // all of the threads, the messenger workers and the kv threads are
+      // running already
+      r = set_threads_affinity(numa_cpu_set_size, &numa_cpu_set);
       if (r < 0) {
-	r = -errno;
 	derr << __func__ << " failed to set numa affinity: " << cpp_strerror(r)
 	     << dendl;
 	numa_node = -1;
       }
     }
-  } else {
+  } else if (msgr_numa_node < 0 && store_numa_node < 0) {
     dout(1) << __func__ << " not setting numa affinity" << dendl;
   }
   return 0;
 }
 
+bool OSD::set_threads_numa_affinity(int node,
+				    const std::vector<std::string>& prefixes)
+{
+  size_t cpu_set_size = 0;
+  cpu_set_t cpu_set;
+  int r = get_numa_node_cpu_set(node, &cpu_set_size, &cpu_set);
+  if (r < 0) {
+    dout(1) << __func__ << " unable to determine numa node " << node
+	    << " CPUs" << dendl;
+    return false;
+  }
+  r = set_threads_affinity(
+    cpu_set_size, &cpu_set,
+    [&prefixes](const std::string& name) {
+      for (auto& prefix : prefixes) {
+	if (name.compare(0, prefix.size(), prefix) == 0) {
+	  return true;
+	}
+      }
+      return false;
+    });
+  if (r < 0) {
+    derr << __func__ << " failed to set numa affinity of " << prefixes
+	 << " threads: " << cpp_strerror(r) << dendl;
+    return false;
+  }
+  dout(1) << __func__ << " set numa affinity of " << r << " " << prefixes
+	  << " threads to node " << node << " cpus "
+	  << cpu_set_to_str_list(cpu_set_size, &cpu_set) << dendl;
+  return r > 0;
+}
+
 // asok
 
 class OSDSocketHook : public AdminSocketHook {
@@ -2338,7 +2490,8 @@ bool OSD::asok_command(std::string_view admin_command, const cmdmap_t& cmdmap,
              admin_command == "dump_blocked_ops" ||
              admin_command == "dump_historic_ops" ||
              admin_command == "dump_historic_ops_by_duration" ||
-             admin_command == "dump_historic_slow_ops") {
+             admin_command == "dump_historic_slow_ops" ||
+             admin_command == "dump_historic_ops_trace") {
 
     const string error_str = "op_tracker tracking is not enabled now, so no ops are tracked currently, \
 even those get stuck. Please enable \"osd_enable_op_tracker\", and the tracker \
@@ -2377,6 +2530,12 @@ will start to track new ops received afterwards.";
         ss << error_str;
       }
     }
+    if (admin_command == "dump_historic_ops_trace") {
+      if (!op_tracker.dump_historic_ops_trace(f, whoami,
+					      "osd." + stringify(whoami))) {
+        ss << error_str;
+      }
+    }
   } else if (admin_command == "dump_op_pq_state") {
     f->open_object_section("pq");
     op_shardedwq.dump(f);
@@ -2496,6 +2655,8 @@ will start to track new ops received afterwards.";
     f->close_section();
   } else if (admin_command == "dump_objectstore_kv_stats") {
     store->get_db_statistics(f);
+  } else if (admin_command == "dump_objectstore_defrag_status") {
+    store->dump_defrag_status(f);
   } else if (admin_command == "dump_scrubs") {
     service.dumps_scrub(f);
   } else if (admin_command == "calc_objectstore_db_histogram") {
@@ -2720,6 +2881,22 @@ int OSD::init()
   dout(2) << "journal looks like " << (journal_is_rotational ? "hdd" : "ssd")
           << dendl;
 
+  {
+    // the store's memory autotuner sizes the messengers' receive buffer
+    // pools too; messengers sharing a stack share them
+    std::set<std::shared_ptr<PriorityCache::PriCache>> rx_caches;
+    for (auto m : {client_messenger, cluster_messenger}) {
+      if (auto c = m->get_rx_buffer_cache()) {
+	rx_caches.insert(c);
+      }
+    }
+    unsigned i = 0;
+    for (auto& c : rx_caches) {
+      store->add_pri_cache(i ? "msgr_rx" + stringify(i) : "msgr_rx", c);
+      ++i;
+    }
+  }
+
   enable_disable_fuse(false);
 
   dout(2) << "boot" << dendl;
@@ -3115,6 +3292,12 @@ void OSD::final_init()
 				     asok_hook,
 				     "show slowest recent ops, sorted by duration");
   ceph_assert(r == 0);
+  r = admin_socket->register_command("dump_historic_ops_trace",
+				     "dump_historic_ops_trace",
+				     asok_hook,
+				     "show the sampled recent ops and their stages, "
+				     "in Chrome's trace event format");
+  ceph_assert(r == 0);
   r = admin_socket->register_command("dump_op_pq_state", "dump_op_pq_state",
 				     asok_hook,
 				     "dump op priority queue state");
@@ -3168,6 +3351,12 @@ void OSD::final_init()
 				     "print statistics of kvdb which used by bluestore");
   ceph_assert(r == 0);
 
+  r = admin_socket->register_command("dump_objectstore_defrag_status",
+				     "dump_objectstore_defrag_status",
+				     asok_hook,
+				     "show progress of background defragmentation");
+  ceph_assert(r == 0);
+
   r = admin_socket->register_command("dump_scrubs",
 				     "dump_scrubs",
 				     asok_hook,
@@ -3441,6 +3630,9 @@ void OSD::create_logger()
     "Latency of IO before calling queue(before really queue into ShardedOpWq)"); // client io before queue op_wq latency
   osd_plb.add_time_avg(l_osd_op_before_dequeue_op_lat, "op_before_dequeue_op_lat",
     "Latency of IO before calling dequeue_op(already dequeued and get PG lock)"); // client io before dequeue_op latency
+  osd_plb.add_u64_counter(
+    l_osd_op_inline, "op_inline",
+    "Client operations run on the messenger thread");
 
   osd_plb.add_u64_counter(
     l_osd_sop, "subop", "Suboperations");
@@ -4251,7 +4443,7 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
-  int num = 0;
+  vector<PGRef> pgs;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -4304,20 +4496,56 @@ void OSD::load_pgs()
       recursive_remove_collection(cct, store, pgid, *it);
       continue;
     }
+    pgs.push_back(pg);
+  }
 
-    // there can be no waiters here, so we don't call _wake_pg_slot
-
+  // read pg state, log; most of the boot time with many pgs or long
+  // logs, so spread it over threads. each pg is only touched by the
+  // thread that reads it.
+  auto read_pg = [this](PG *pg) {
     pg->lock();
     pg->ch = store->open_collection(pg->coll);
-
-    // read pg state, log
     pg->read_state(store);
+    pg->unlock();
+  };
+  unsigned num_threads = cct->_conf.get_val<uint64_t>("osd_load_pgs_threads");
+  if (num_threads == 0) {
+    num_threads = num_shards;
+  }
+  num_threads = std::min<size_t>(num_threads, pgs.size());
+  if (num_threads > 1) {
+    dout(1) << __func__ << " reading " << pgs.size() << " pgs on "
+	    << num_threads << " threads" << dendl;
+    std::atomic<size_t> next = {0};
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < num_threads; ++i) {
+      workers.push_back(make_named_thread("osd_load_pgs", [&]() {
+	for (size_t n = next++; n < pgs.size(); n = next++) {
+	  read_pg(pgs[n].get());
+	}
+      }));
+    }
+    for (auto& t : workers) {
+      t.join();
+    }
+  } else {
+    for (auto& pg : pgs) {
+      read_pg(pg.get());
+    }
+  }
+
+  int num = 0;
+  for (auto& pg : pgs) {
+    const spg_t pgid = pg->pg_id;
+
+    // there can be no waiters here, so we don't call _wake_pg_slot
 
+    pg->lock();
     if (pg->dne())  {
-      dout(10) << "load_pgs " << *it << " deleting dne" << dendl;
+      dout(10) << "load_pgs " << pg->coll << " deleting dne" << dendl;
       pg->ch = nullptr;
       pg->unlock();
-      recursive_remove_collection(cct, store, pgid, *it);
+      recursive_remove_collection(cct, store, pgid, pg->coll);
       continue;
     }
     {
@@ -4860,6 +5088,7 @@ void OSD::handle_osd_ping(MOSDPing *m)
       m->get_connection()->send_message(r);
 
       if (curmap->is_up(from)) {
+	note_heartbeat_peer_epoch(m->map_epoch);
 	if (is_active()) {
 	  ConnectionRef con = service.get_con_osd_cluster(from, curmap->get_epoch());
 	  if (con) {
@@ -4954,6 +5183,7 @@ void OSD::handle_osd_ping(MOSDPing *m)
 
       if (m->map_epoch &&
 	  curmap->is_up(from)) {
+	note_heartbeat_peer_epoch(m->map_epoch);
 	if (is_active()) {
 	  ConnectionRef con = service.get_con_osd_cluster(from, curmap->get_epoch());
 	  if (con) {
@@ -4967,6 +5197,8 @@ void OSD::handle_osd_ping(MOSDPing *m)
   case MOSDPing::YOU_DIED:
     dout(10) << "handle_osd_ping " << m->get_source_inst()
 	     << " says i am down in " << m->map_epoch << dendl;
+    // the peers won't share maps with an osd that is down in them
+    heartbeat_peer_epoch = 0;
     osdmap_subscribe(curmap->get_epoch()+1, false);
     break;
   }
@@ -4977,6 +5209,12 @@ void OSD::handle_osd_ping(MOSDPing *m)
 
 void OSD::heartbeat_entry()
 {
+  const int nice = cct->_conf.get_val<int64_t>("osd_heartbeat_nice");
+  if (nice && setpriority(PRIO_PROCESS, ceph_gettid(), nice) < 0) {
+    int r = -errno;
+    derr << __func__ << " failed to set nice " << nice << ": "
+         << cpp_strerror(r) << dendl;
+  }
   std::lock_guard l(heartbeat_lock);
   if (is_stopping())
     return;
@@ -5217,6 +5455,8 @@ void OSD::tick_without_osd_lock()
   ceph_assert(r == 0);
   service.set_statfs(stbuf, alerts);
 
+  check_deferred_osdmap_subscribe();
+
   // osd_lock is not being held, which means the OSD state
   // might change when doing the monitor report
   if (is_active() || is_waiting_for_healthy()) {
@@ -5945,6 +6185,12 @@ void OSD::_collect_metadata(map<string,string> *pm)
     (*pm)["numa_node_cpus"] = cpu_set_to_str_list(numa_cpu_set_size,
 						  &numa_cpu_set);
   }
+  if (msgr_numa_node >= 0) {
+    (*pm)["msgr_numa_node"] = stringify(msgr_numa_node);
+  }
+  if (store_numa_node >= 0) {
+    (*pm)["objectstore_numa_node"] = stringify(store_numa_node);
+  }
 
   set<string> devnames;
   store->get_devices(&devnames);
@@ -7026,6 +7272,8 @@ void OSD::ms_fast_dispatch(Message *m)
     return handle_fast_pg_info(static_cast<MOSDPGInfo*>(m));
   case MSG_OSD_PG_REMOVE:
     return handle_fast_pg_remove(static_cast<MOSDPGRemove*>(m));
+  case MSG_OSD_REPOP_BATCH:
+    return handle_fast_repop_batch(static_cast<MOSDRepOpBatch*>(m));
 
     // these are single-pg messages that handle themselves
   case MSG_OSD_PG_LOG:
@@ -7065,6 +7313,13 @@ void OSD::ms_fast_dispatch(Message *m)
 
   if (m->get_connection()->has_features(CEPH_FEATUREMASK_RESEND_ON_SPLIT) ||
       m->get_type() != CEPH_MSG_OSD_OP) {
+    if (m->get_type() == CEPH_MSG_OSD_OP &&
+	m_osd_op_run_to_completion &&
+	op_shardedwq.try_run_inline(
+	  static_cast<MOSDFastDispatchOp*>(m)->get_spg(), op)) {
+      OID_EVENT_TRACE_WITH_MSG(m, "MS_FAST_DISPATCH_END", false);
+      return;
+    }
     // queue it directly
     enqueue_op(
       static_cast<MOSDFastDispatchOp*>(m)->get_spg(),
@@ -7603,12 +7858,70 @@ struct C_OnMapCommit : public Context {
   }
 };
 
+void OSD::note_heartbeat_peer_epoch(epoch_t e)
+{
+  epoch_t cur = heartbeat_peer_epoch;
+  while (e > cur && !heartbeat_peer_epoch.compare_exchange_weak(cur, e));
+}
+
+bool OSD::_defer_osdmap_subscribe(epoch_t epoch)
+{
+  ceph_assert(osdmap_subscribe_lock.is_locked_by_me());
+  // a heartbeat peer that has the maps shares them with us as soon as it
+  // hears our next ping, so give it a chance to before asking the mons;
+  // it only shares the last osd_map_share_max_epochs of them, though
+  const double grace = cct->_conf.get_val<double>("osd_map_peer_share_grace");
+  const epoch_t peer_epoch = heartbeat_peer_epoch;
+  if (grace <= 0 || peer_epoch < epoch ||
+      peer_epoch - epoch >= (epoch_t)cct->_conf->osd_map_share_max_epochs) {
+    deferred_subscribe_epoch = 0;
+    return false;
+  }
+  utime_t now = ceph_clock_now();
+  if (deferred_subscribe_epoch == 0) {
+    deferred_subscribe_stamp = now;
+  } else if (now - deferred_subscribe_stamp > grace) {
+    dout(10) << __func__ << " peers didn't share e" << deferred_subscribe_epoch
+	     << " within " << grace << "s" << dendl;
+    deferred_subscribe_epoch = 0;
+    return false;
+  }
+  if (epoch > deferred_subscribe_epoch) {
+    dout(10) << __func__ << " e" << epoch << ", heartbeat peers have e"
+	     << peer_epoch << dendl;
+    deferred_subscribe_epoch = epoch;
+  }
+  return true;
+}
+
+void OSD::check_deferred_osdmap_subscribe()
+{
+  epoch_t epoch;
+  {
+    std::lock_guard l(osdmap_subscribe_lock);
+    epoch = deferred_subscribe_epoch;
+    if (!epoch) {
+      return;
+    }
+    if (get_osdmap_epoch() >= epoch) {
+      deferred_subscribe_epoch = 0;
+      return;
+    }
+  }
+  // asks the mons once the grace ran out
+  osdmap_subscribe(epoch, false);
+}
+
 void OSD::osdmap_subscribe(version_t epoch, bool force_request)
 {
   std::lock_guard l(osdmap_subscribe_lock);
   if (latest_subscribed_epoch >= epoch && !force_request)
     return;
 
+  if (!force_request && _defer_osdmap_subscribe(epoch)) {
+    return;
+  }
+
   latest_subscribed_epoch = std::max<uint64_t>(epoch, latest_subscribed_epoch);
 
   if (monc->sub_want_increment("osdmap", epoch, CEPH_SUBSCRIBE_ONETIME) ||
@@ -8961,6 +9274,8 @@ void OSD::dispatch_context(PG::PeeringCtx &ctx, PG *pg, OSDMapRef curmap,
     dout(20) << __func__ << " not up in osdmap" << dendl;
   } else if (!is_active()) {
     dout(20) << __func__ << " not active" << dendl;
+  } else if (pg && cct->_conf->osd_peering_batch_delay > 0) {
+    queue_peering_out(ctx, pg, curmap);
   } else {
     do_notifies(*ctx.notify_list, curmap);
     do_queries(*ctx.query_map, curmap);
@@ -8987,6 +9302,76 @@ void OSD::discard_context(PG::PeeringCtx& ctx)
   delete ctx.transaction;
 }
 
+void OSD::queue_peering_out(PG::PeeringCtx &ctx, PG *pg, OSDMapRef curmap)
+{
+  if (ctx.notify_list->empty() &&
+      ctx.query_map->empty() &&
+      ctx.info_map->empty()) {
+    return;
+  }
+  bool queue_flush = false;
+  {
+    std::lock_guard l(peering_out_lock);
+    // a pg's messages must go out in the order its peering produced
+    // them, so a pg never has more than one context pending
+    if (!peering_out_pgs.insert(pg->get_pgid()).second) {
+      _flush_peering_out();
+      peering_out_pgs.insert(pg->get_pgid());
+    }
+    auto& out = peering_out[curmap->get_epoch()];
+    out.curmap = curmap;
+    for (auto& [osd, notifies] : *ctx.notify_list) {
+      auto& v = out.notify_list[osd];
+      std::move(notifies.begin(), notifies.end(), std::back_inserter(v));
+    }
+    for (auto& [osd, queries] : *ctx.query_map) {
+      out.query_map[osd].insert(queries.begin(), queries.end());
+    }
+    for (auto& [osd, infos] : *ctx.info_map) {
+      auto& v = out.info_map[osd];
+      std::move(infos.begin(), infos.end(), std::back_inserter(v));
+    }
+    if (peering_out_pgs.size() >= cct->_conf->osd_peering_batch_max_pgs) {
+      _flush_peering_out();
+    } else if (!peering_out_flush_queued) {
+      peering_out_flush_queued = queue_flush = true;
+    }
+  }
+  if (queue_flush) {
+    // the timer calls back with tick_timer_lock held, so don't take it
+    // under peering_out_lock
+    std::lock_guard l(tick_timer_lock);
+    tick_timer_without_osd_lock.add_event_after(
+      cct->_conf->osd_peering_batch_delay,
+      new FunctionContext([this](int r) {
+	std::lock_guard l(peering_out_lock);
+	_flush_peering_out();
+      }));
+  }
+}
+
+void OSD::_flush_peering_out()
+{
+  peering_out_flush_queued = false;
+  map<epoch_t, peering_out_t> out;
+  out.swap(peering_out);
+  peering_out_pgs.clear();
+  if (!service.get_osdmap()->is_up(whoami)) {
+    dout(20) << __func__ << " not up in osdmap" << dendl;
+    return;
+  }
+  if (!is_active()) {
+    dout(20) << __func__ << " not active" << dendl;
+    return;
+  }
+  for (auto& [epoch, o] : out) {
+    dout(20) << __func__ << " e" << epoch << dendl;
+    do_notifies(o.notify_list, o.curmap);
+    do_queries(o.query_map, o.curmap);
+    do_infos(o.info_map, o.curmap);
+  }
+}
+
 
 /** do_notifies
  * Send an MOSDPGNotify to a primary, with a list of PGs that I have
@@ -9018,7 +9403,7 @@ void OSD::do_notifies(
 	    << " on " << it->second.size() << " PGs" << dendl;
     MOSDPGNotify *m = new MOSDPGNotify(curmap->get_epoch(),
 				       std::move(it->second));
-    con->send_message(m);
+    service.send_message_osd_cluster(m, con);
   }
 }
 
@@ -9048,7 +9433,7 @@ void OSD::do_queries(map<int, map<spg_t,pg_query_t> >& query_map,
 	    << " on " << pit->second.size() << " PGs" << dendl;
     MOSDPGQuery *m = new MOSDPGQuery(curmap->get_epoch(),
 				     std::move(pit->second));
-    con->send_message(m);
+    service.send_message_osd_cluster(m, con);
   }
 }
 
@@ -9082,7 +9467,7 @@ void OSD::do_infos(map<int,
     service.maybe_share_map(con.get(), curmap);
     MOSDPGInfo *m = new MOSDPGInfo(curmap->get_epoch());
     m->pg_list = p->second;
-    con->send_message(m);
+    service.send_message_osd_cluster(m, con);
   }
   info_map.clear();
 }
@@ -9240,6 +9625,42 @@ void OSD::handle_fast_pg_info(MOSDPGInfo* m)
   m->put();
 }
 
+void OSD::handle_fast_repop_batch(MOSDRepOpBatch *m)
+{
+  dout(20) << __func__ << " " << *m << " from " << m->get_source() << dendl;
+  if (!require_osd_peer(m)) {
+    m->put();
+    return;
+  }
+  // the batch's crcs covered the inner messages
+  ceph_msg_footer footer = {};
+  footer.flags = CEPH_MSG_FOOTER_COMPLETE;
+  for (auto& i : m->items) {
+    i.header.src = m->get_header().src;
+    Message *op = decode_message(cct, 0, i.header, footer,
+				 i.front, i.middle, i.data,
+				 m->get_connection().get());
+    if (!op) {
+      derr << __func__ << " failed to decode op in " << *m << dendl;
+      continue;
+    }
+    if (op->get_type() != MSG_OSD_REPOP) {
+      derr << __func__ << " unexpected " << *op << " in " << *m << dendl;
+      op->put();
+      continue;
+    }
+    // each op holds the throttle until it is done, the batch's own share
+    // goes once all of them are queued
+    m->share_message_throttle(op);
+    op->set_recv_stamp(m->get_recv_stamp());
+    op->set_throttle_stamp(m->get_throttle_stamp());
+    op->set_recv_complete_stamp(m->get_recv_complete_stamp());
+    op->set_dispatch_stamp(m->get_dispatch_stamp());
+    ms_fast_dispatch(op);
+  }
+  m->put();
+}
+
 void OSD::handle_fast_pg_remove(MOSDPGRemove *m)
 {
   dout(7) << __func__ << " " << *m << " from " << m->get_source() << dendl;
@@ -9337,7 +9758,7 @@ void OSD::handle_pg_query_nopg(const MQuery& q)
       m = new MOSDPGNotify(osdmap->get_epoch(), std::move(ls));
     }
     service.maybe_share_map(con.get(), osdmap);
-    con->send_message(m);
+    service.send_message_osd_cluster(m, con);
   }
 }
 
@@ -9518,6 +9939,20 @@ void OSDService::release_reserved_pushes(uint64_t pushes)
   _maybe_queue_recovery();
 }
 
+bool OSDService::reserve_extra_push()
+{
+  std::lock_guard l(recovery_lock);
+  if (recovery_ops_active + recovery_ops_reserved >=
+      cct->_conf->osd_recovery_max_active) {
+    dout(20) << __func__ << " active " << recovery_ops_active
+	     << " + reserved " << recovery_ops_reserved
+	     << " >= max " << cct->_conf->osd_recovery_max_active << dendl;
+    return false;
+  }
+  ++recovery_ops_reserved;
+  return true;
+}
+
 // =========================================================
 // OPS
 
@@ -9694,6 +10129,8 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_op_history_duration",
     "osd_op_history_slow_op_size",
     "osd_op_history_slow_op_threshold",
+    "osd_op_history_sample_rate",
+    "osd_op_history_sample_size",
     "osd_enable_op_tracker",
     "osd_map_cache_size",
     "osd_pg_epoch_max_lag_factor",
@@ -9714,6 +10151,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_client_message_cap",
     "osd_heartbeat_min_size",
     "osd_heartbeat_interval",
+    "osd_op_run_to_completion",
     NULL
   };
   return KEYS;
@@ -9749,6 +10187,12 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
     op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                       cct->_conf->osd_op_history_slow_op_threshold);
   }
+  if (changed.count("osd_op_history_sample_rate") ||
+      changed.count("osd_op_history_sample_size")) {
+    op_tracker.set_history_sample_rate_and_size(
+      cct->_conf.get_val<uint64_t>("osd_op_history_sample_rate"),
+      cct->_conf.get_val<uint64_t>("osd_op_history_sample_size"));
+  }
   if (changed.count("osd_enable_op_tracker")) {
       op_tracker.set_tracking(cct->_conf->osd_enable_op_tracker);
   }
@@ -9772,6 +10216,10 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
     m_osd_pg_epoch_max_lag_factor = conf.get_val<double>(
       "osd_pg_epoch_max_lag_factor");
   }
+  if (changed.count("osd_op_run_to_completion")) {
+    m_osd_op_run_to_completion = conf.get_val<bool>(
+      "osd_op_run_to_completion");
+  }
 
 #ifdef HAVE_LIBFUSE
   if (changed.count("osd_objectstore_fuse")) {
@@ -10532,8 +10980,10 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   // callback.
   bool is_smallest_thread_index = thread_index < osd->num_shards;
 
-  // peek at spg_t
+  // peek at spg_t.  queue_lock is held until we have taken wait_lock so
+  // that an _enqueue racing with the emptiness check can't miss us.
   sdata->shard_lock.lock();
+  sdata->queue_lock.lock();
   if (sdata->pqueue->empty() &&
       (!is_smallest_thread_index || sdata->context_queue.empty())) {
     std::unique_lock wait_lock{sdata->sdata_wait_lock};
@@ -10543,12 +10993,15 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
     } else if (!sdata->stop_waiting) {
       dout(20) << __func__ << " empty q, waiting" << dendl;
       osd->cct->get_heartbeat_map()->clear_timeout(hb);
+      sdata->queue_lock.unlock();
       sdata->shard_lock.unlock();
       sdata->sdata_cond.wait(wait_lock);
       wait_lock.unlock();
       sdata->shard_lock.lock();
+      sdata->queue_lock.lock();
       if (sdata->pqueue->empty() &&
          !(is_smallest_thread_index && !sdata->context_queue.empty())) {
+	sdata->queue_lock.unlock();
 	sdata->shard_lock.unlock();
 	return;
       }
@@ -10557,6 +11010,7 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
     } else {
       dout(20) << __func__ << " need return immediately" << dendl;
       wait_lock.unlock();
+      sdata->queue_lock.unlock();
       sdata->shard_lock.unlock();
       return;
     }
@@ -10568,6 +11022,7 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   }
 
   if (sdata->pqueue->empty()) {
+    sdata->queue_lock.unlock();
     if (osd->is_stopping()) {
       sdata->shard_lock.unlock();
       for (auto c : oncommits) {
@@ -10582,6 +11037,9 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   }
 
   OpQueueItem item = sdata->pqueue->dequeue();
+  sdata->queue_lock.unlock();
+  if (item.get_op_type() == OpQueueItem::op_type_t::client_op)
+    --sdata->queued_client_ops;
   if (osd->is_stopping()) {
     sdata->shard_lock.unlock();
     for (auto c : oncommits) {
@@ -10822,21 +11280,98 @@ void OSD::ShardedOpWQ::_enqueue(OpQueueItem&& item) {
   assert (NULL != sdata);
   unsigned priority = item.get_priority();
   unsigned cost = item.get_cost();
-  sdata->shard_lock.lock();
+  // only the queue lock: new items don't touch pg_slots, so they need
+  // not wait for slot maintenance (consume_map, splits, ...) under
+  // shard_lock
+  sdata->queue_lock.lock();
 
   dout(20) << __func__ << " " << item << dendl;
+  if (item.get_op_type() == OpQueueItem::op_type_t::client_op)
+    ++sdata->queued_client_ops;
   if (priority >= osd->op_prio_cutoff)
     sdata->pqueue->enqueue_strict(
       item.get_owner(), priority, std::move(item));
   else
     sdata->pqueue->enqueue(
       item.get_owner(), priority, cost, std::move(item));
-  sdata->shard_lock.unlock();
+  sdata->queue_lock.unlock();
 
   std::lock_guard l{sdata->sdata_wait_lock};
   sdata->sdata_cond.notify_one();
 }
 
+bool OSD::ShardedOpWQ::try_run_inline(spg_t pgid, OpRequestRef& op)
+{
+  auto shard_index = pgid.hash_to_shard(osd->shards.size());
+  auto& sdata = osd->shards[shard_index];
+  ceph_assert(sdata);
+  PGRef pg;
+  {
+    std::lock_guard l{sdata->shard_lock};
+    if (sdata->inline_running) {
+      return false;
+    }
+    {
+      std::lock_guard ql{sdata->queue_lock};
+      if (!sdata->pqueue->empty()) {
+	return false;
+      }
+    }
+    auto p = sdata->pg_slots.find(pgid);
+    if (p == sdata->pg_slots.end()) {
+      return false;
+    }
+    OSDShardPGSlot *slot = p->second.get();
+    if (!slot->pg ||
+	slot->num_running ||
+	!slot->to_process.empty() ||
+	!slot->waiting.empty() ||
+	!slot->waiting_peering.empty() ||
+	!slot->waiting_for_split.empty()) {
+      return false;
+    }
+    // we normally take the pg lock before the shard lock, so only try
+    pg = slot->pg;
+    if (!pg->try_lock()) {
+      return false;
+    }
+    sdata->inline_running = true;
+  }
+
+  // account for the op as enqueue_op() would, so that the latency
+  // counters and traces look the same whichever way it ran
+  const utime_t latency = ceph_clock_now() - op->get_req()->get_recv_stamp();
+  dout(15) << __func__ << " " << op
+	   << " prio " << op->get_req()->get_priority()
+	   << " cost " << op->get_req()->get_cost()
+	   << " latency " << latency
+	   << " " << *(op->get_req()) << dendl;
+  op->osd_trace.event("run inline");
+  op->osd_trace.keyval("priority", op->get_req()->get_priority());
+  op->osd_trace.keyval("cost", op->get_req()->get_cost());
+  op->mark_queued_for_pg();
+  osd->logger->tinc(l_osd_op_before_queue_op_lat, latency);
+  osd->logger->inc(l_osd_op_inline);
+
+  ThreadPool::TPHandle tp_handle(osd->cct, sdata->inline_hb,
+				 timeout_interval, 0);
+  tp_handle.reset_tp_timeout();
+#ifdef WITH_LTTNG
+  osd_reqid_t reqid = op->get_reqid();
+#endif
+  tracepoint(osd, opwq_process_start, reqid.name._type,
+	     reqid.name._num, reqid.tid, reqid.inc);
+  osd->dequeue_op(pg, op, tp_handle);
+  pg->unlock();
+  tracepoint(osd, opwq_process_finish, reqid.name._type,
+	     reqid.name._num, reqid.tid, reqid.inc);
+  tp_handle.suspend_tp_timeout();
+
+  std::lock_guard l{sdata->shard_lock};
+  sdata->inline_running = false;
+  return true;
+}
+
 void OSD::ShardedOpWQ::_enqueue_front(OpQueueItem&& item)
 {
   auto shard_index = item.get_ordering_token().hash_to_shard(osd->shards.size());
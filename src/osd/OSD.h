@@ -23,6 +23,7 @@
 #include "common/RWLock.h"
 #include "common/Timer.h"
 #include "common/WorkQueue.h"
+#include "common/HeartbeatMap.h"
 #include "common/AsyncReserver.h"
 #include "common/ceph_context.h"
 #include "common/config_cacher.h"
@@ -43,6 +44,7 @@
 #include "Session.h"
 
 #include "osd/OpQueueItem.h"
+#include "osd/RepOpBatcher.h"
 
 #include <atomic>
 #include <map>
@@ -105,6 +107,7 @@ enum {
 
   l_osd_op_before_queue_op_lat,
   l_osd_op_before_dequeue_op_lat,
+  l_osd_op_inline,
 
   l_osd_sop,
   l_osd_sop_inb,
@@ -251,6 +254,7 @@ class MOSDPGQuery;
 class MOSDPGNotify;
 class MOSDPGInfo;
 class MOSDPGRemove;
+class MOSDRepOpBatch;
 class MOSDForceRecovery;
 
 class OSD;
@@ -276,6 +280,15 @@ public:
 
   md_config_cacher_t<Option::size_t> osd_max_object_size;
   md_config_cacher_t<bool> osd_skip_data_digest;
+  // read by the ops
+  md_config_cacher_t<double> osd_hit_set_sample_ratio;
+  md_config_cacher_t<Option::size_t> osd_omap_scan_readahead;
+  md_config_cacher_t<uint64_t> osd_max_pg_omap_read_objects;
+  md_config_cacher_t<uint64_t> osd_omap_cursors_per_pg;
+  md_config_cacher_t<uint64_t> osd_omap_cursors_max;
+  md_config_cacher_t<uint64_t> osd_omap_cursor_ttl;
+
+  RepOpBatcher repop_batcher;
 
   void enqueue_back(OpQueueItem&& qi);
   void enqueue_front(OpQueueItem&& qi);
@@ -408,15 +421,19 @@ public:
   pair<ConnectionRef,ConnectionRef> get_con_osd_hb(int peer, epoch_t from_epoch);  // (back, front)
   void send_message_osd_cluster(int peer, Message *m, epoch_t from_epoch);
   void send_message_osd_cluster(Message *m, Connection *con) {
+    repop_batcher.flush(con);
     con->send_message(m);
   }
   void send_message_osd_cluster(Message *m, const ConnectionRef& con) {
+    repop_batcher.flush(con.get());
     con->send_message(m);
   }
   void send_message_osd_client(Message *m, Connection *con) {
+    repop_batcher.flush(con);
     con->send_message(m);
   }
   void send_message_osd_client(Message *m, const ConnectionRef& con) {
+    repop_batcher.flush(con.get());
     con->send_message(m);
   }
   entity_name_t get_cluster_msgr_name() const;
@@ -688,6 +705,21 @@ public:
   Mutex sleep_lock;
   SafeTimer sleep_timer;
 
+  // -- Scrub I/O budget --
+private:
+  ceph::mutex scrub_budget_lock =
+    ceph::make_mutex("OSDService::scrub_budget_lock");
+  ceph::mono_time scrub_budget_stamp;
+  double scrub_budget = 0;  ///< bytes scrub may still read; < 0 is debt
+  void _scrub_budget_refill(double rate);
+public:
+  /// charge bytes read by scrub against osd_scrub_max_bytes_per_sec
+  void scrub_budget_charge(uint64_t bytes);
+  /// seconds scrub should wait for the budget to recover, 0 if none
+  double scrub_budget_wait();
+  /// client ops queued on all shards
+  unsigned get_queued_client_ops() const;
+
   // -- tids --
   // for ops i issue
   std::atomic<unsigned int> last_tid{0};
@@ -695,6 +727,30 @@ public:
     return (ceph_tid_t)last_tid++;
   }
 
+  // -- omap cursors --
+  /// omap iterators the PGs keep for paged listings
+  std::atomic<uint64_t> num_omap_cursors{0};
+  /// true if a PG may keep one more, within osd_omap_cursors_max
+  bool get_omap_cursor() {
+    if (++num_omap_cursors > osd_omap_cursors_max) {
+      --num_omap_cursors;
+      return false;
+    }
+    return true;
+  }
+  void put_omap_cursors(uint64_t n) {
+    num_omap_cursors -= n;
+  }
+
+  // -- peer read latency --
+  // ewma of EC sub read round trips, to steer reads away from slow peers
+  ceph::mutex peer_read_lat_lock =
+    ceph::make_mutex("OSDService::peer_read_lat_lock");
+  map<int, pair<ceph::coarse_mono_time, double>> peer_read_lat; ///< osd -> (last sample, secs)
+  void record_peer_read_latency(int peer, ceph::timespan lat);
+  /// recent read latency in seconds, or 0 if we have no recent sample
+  double get_peer_read_latency(int peer);
+
   // -- backfill_reservation --
   Finisher reserver_finisher;
   AsyncReserver<spg_t> local_reserver;
@@ -774,6 +830,9 @@ public:
   void finish_recovery_op(PG *pg, const hobject_t& soid, bool dequeue);
   bool is_recovery_active();
   void release_reserved_pushes(uint64_t pushes);
+  /// reserve a push beyond those reserved for a pg's recovery round, if
+  /// osd_recovery_max_active has room for it
+  bool reserve_extra_push();
   void defer_recovery(float defer_for) {
     defer_recovery_until = ceph_clock_now();
     defer_recovery_until += defer_for;
@@ -1141,7 +1200,7 @@ struct OSDShard {
   }
 
   string shard_lock_name;
-  ceph::mutex shard_lock;   ///< protects remaining members below
+  ceph::mutex shard_lock;   ///< protects remaining members below, but pqueue
 
   /// map of slots for each spg_t.  maintains ordering of items dequeued
   /// from pqueue while _process thread drops shard lock to acquire the
@@ -1165,16 +1224,29 @@ struct OSDShard {
   int waiting_for_min_pg_epoch = 0;
   ceph::condition_variable min_pg_epoch_cond;
 
+  string queue_lock_name;
+  ceph::mutex queue_lock;   ///< protects pqueue; nests inside shard_lock
+
   /// priority queue
   std::unique_ptr<OpQueue<OpQueueItem, uint64_t>> pqueue;
+  /// client ops waiting in pqueue, for scrub to yield to
+  std::atomic<unsigned> queued_client_ops = {0};
 
   bool stop_waiting = false;
 
   ContextQueue context_queue;
 
+  /// a messenger thread is running an op of this shard inline
+  bool inline_running = false;
+  /// heartbeat for ops run inline (never suicides)
+  heartbeat_handle_d *inline_hb = nullptr;
+
   void _enqueue_front(OpQueueItem&& item, unsigned cutoff) {
     unsigned priority = item.get_priority();
     unsigned cost = item.get_cost();
+    if (item.get_op_type() == OpQueueItem::op_type_t::client_op)
+      ++queued_client_ops;
+    std::lock_guard l{queue_lock};
     if (priority >= cutoff)
       pqueue->enqueue_strict_front(
 	item.get_owner(),
@@ -1219,7 +1291,8 @@ struct OSDShard {
     CephContext *cct,
     OSD *osd,
     uint64_t max_tok_per_prio, uint64_t min_cost,
-    io_queue opqueue)
+    io_queue opqueue,
+    bool rotational)
     : shard_id(id),
       cct(cct),
       osd(osd),
@@ -1230,6 +1303,8 @@ struct OSDShard {
       osdmap_lock{make_mutex(osdmap_lock_name)},
       shard_lock_name(shard_name + "::shard_lock"),
       shard_lock{make_mutex(shard_lock_name)},
+      queue_lock_name(shard_name + "::queue_lock"),
+      queue_lock{make_mutex(queue_lock_name)},
       context_queue(sdata_wait_lock, sdata_cond) {
     if (opqueue == io_queue::weightedpriority) {
       pqueue = std::make_unique<
@@ -1240,10 +1315,17 @@ struct OSDShard {
 	PrioritizedQueue<OpQueueItem,uint64_t>>(
 	  max_tok_per_prio, min_cost);
     } else if (opqueue == io_queue::mclock_opclass) {
-      pqueue = std::make_unique<ceph::mClockOpClassQueue>(cct);
+      pqueue = std::make_unique<ceph::mClockOpClassQueue>(
+	cct, rotational);
     } else if (opqueue == io_queue::mclock_client) {
-      pqueue = std::make_unique<ceph::mClockClientQueue>(cct);
+      pqueue = std::make_unique<ceph::mClockClientQueue>(
+	cct, rotational);
     }
+    inline_hb = cct->get_heartbeat_map()->add_worker(
+      shard_name + "::inline", pthread_self());
+  }
+  ~OSDShard() {
+    cct->get_heartbeat_map()->remove_worker(inline_hb);
   }
 };
 
@@ -1293,6 +1375,14 @@ protected:
   int numa_node = -1;
   size_t numa_cpu_set_size = 0;
   cpu_set_t numa_cpu_set;
+  // when the network and the storage are on different nodes, each set of
+  // threads goes on the node of the device it serves
+  int msgr_numa_node = -1;
+  int store_numa_node = -1;
+  /// set the affinity of the threads whose name starts with one of
+  /// prefixes to node; false if it couldn't
+  bool set_threads_numa_affinity(int node,
+				 const std::vector<std::string>& prefixes);
 
   bool store_is_rotational = true;
   bool journal_is_rotational = true;
@@ -1398,6 +1488,7 @@ private:
 
   // -- config settings --
   float m_osd_pg_epoch_max_lag_factor;
+  std::atomic<bool> m_osd_op_run_to_completion;
 
   // -- superblock --
   OSDSuperblock superblock;
@@ -1534,6 +1625,15 @@ private:
 
   Mutex osdmap_subscribe_lock;
   epoch_t latest_subscribed_epoch{0};
+  /// a subscription put off in the hope that a peer shares the maps
+  epoch_t deferred_subscribe_epoch{0};
+  utime_t deferred_subscribe_stamp;
+  /// the newest epoch an up heartbeat peer pinged us with
+  std::atomic<epoch_t> heartbeat_peer_epoch{0};
+
+  void note_heartbeat_peer_epoch(epoch_t e);
+  bool _defer_osdmap_subscribe(epoch_t epoch);
+  void check_deferred_osdmap_subscribe();
 
   // -- heartbeat --
   /// information about a heartbeat peer
@@ -1695,6 +1795,8 @@ protected:
    *
    * The pqueue is per-shard, and to_process is per pg_slot.  Items can be
    * pushed back up into to_process and/or pqueue while order is preserved.
+   * Pushing to the pqueue back only needs queue_lock; everything that
+   * moves items between pqueue and to_process also holds shard_lock.
    *
    * Multiple worker threads can operate on each shard.
    *
@@ -1737,6 +1839,10 @@ protected:
 
     /// requeue an old item (at the front of the line)
     void _enqueue_front(OpQueueItem&& item) override;
+
+    /// run an op on the calling thread if nothing is queued ahead of it
+    /// and its pg is idle; return false if it must be queued instead
+    bool try_run_inline(spg_t pgid, OpRequestRef& op);
       
     void return_waiting_threads() override {
       for(uint32_t i = 0; i < osd->num_shards; i++) {
@@ -1765,7 +1871,7 @@ protected:
 	snprintf(queue_name, sizeof(queue_name), "%s%" PRIu32, "OSD:ShardedOpWQ:", i);
 	ceph_assert(NULL != sdata);
 
-	std::scoped_lock l{sdata->shard_lock};
+	std::scoped_lock l{sdata->queue_lock};
 	f->open_object_section(queue_name);
 	sdata->pqueue->dump(f);
 	f->close_section();
@@ -1776,7 +1882,7 @@ protected:
       uint32_t shard_index = thread_index % osd->num_shards;
       auto &&sdata = osd->shards[shard_index];
       ceph_assert(sdata);
-      std::lock_guard l(sdata->shard_lock);
+      std::lock_guard l(sdata->queue_lock);
       if (thread_index < osd->num_shards) {
 	return sdata->pqueue->empty() && sdata->context_queue.empty();
       } else {
@@ -2022,6 +2128,21 @@ protected:
 		    vector<pair<pg_notify_t, PastIntervals> > >& info_map,
 		OSDMapRef map);
 
+  // -- peering messages, batched across pgs --
+  struct peering_out_t {
+    OSDMapRef curmap;
+    map<int, vector<pair<pg_notify_t, PastIntervals> > > notify_list;
+    map<int, map<spg_t,pg_query_t> > query_map;
+    map<int, vector<pair<pg_notify_t, PastIntervals> > > info_map;
+  };
+  ceph::mutex peering_out_lock = ceph::make_mutex("OSD::peering_out_lock");
+  map<epoch_t, peering_out_t> peering_out;  ///< by map epoch
+  set<spg_t> peering_out_pgs;  ///< pgs with messages in peering_out
+  bool peering_out_flush_queued = false;
+  /// hold back ctx's messages to send them along with other pgs' ones
+  void queue_peering_out(PG::PeeringCtx &ctx, PG *pg, OSDMapRef curmap);
+  void _flush_peering_out();
+
   bool require_mon_peer(const Message *m);
   bool require_mon_or_mgr_peer(const Message *m);
   bool require_osd_peer(const Message *m);
@@ -2048,6 +2169,7 @@ protected:
   void handle_pg_notify_nopg(const MNotifyRec& q);
   void handle_fast_pg_info(MOSDPGInfo *m);
   void handle_fast_pg_remove(MOSDPGRemove *m);
+  void handle_fast_repop_batch(MOSDRepOpBatch *m);
 
 public:
   // used by OSDShard
@@ -2154,6 +2276,7 @@ private:
     case MSG_OSD_RECOVERY_RESERVE:
     case MSG_OSD_REPOP:
     case MSG_OSD_REPOPREPLY:
+    case MSG_OSD_REPOP_BATCH:
     case MSG_OSD_PG_PUSH:
     case MSG_OSD_PG_PULL:
     case MSG_OSD_PG_PUSH_REPLY:
@@ -1507,7 +1507,7 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
   }
   mask |= CEPH_FEATURES_CRUSH;
 
-  if (!pg_upmap.empty() || !pg_upmap_items.empty())
+  if (!pg_upmap->empty() || !pg_upmap_items->empty())
     features |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
   mask |= CEPH_FEATUREMASK_OSDMAP_PG_UPMAP;
 
@@ -1688,6 +1688,14 @@ void OSDMap::dedup(const OSDMap *o, OSDMap *n)
       n->primary_temp = o->primary_temp;
   }
 
+  // do upmaps match?
+  if (o->pg_upmap->size() == n->pg_upmap->size() &&
+      *o->pg_upmap == *n->pg_upmap)
+    n->pg_upmap = o->pg_upmap;
+  if (o->pg_upmap_items->size() == n->pg_upmap_items->size() &&
+      *o->pg_upmap_items == *n->pg_upmap_items)
+    n->pg_upmap_items = o->pg_upmap_items;
+
   // do uuids match?
   if (o->osd_uuid->size() == n->osd_uuid->size() &&
       *o->osd_uuid == *n->osd_uuid)
@@ -1785,10 +1793,10 @@ void OSDMap::maybe_remove_pg_upmaps(CephContext *cct,
   set<pg_t> to_cancel;
   map<int, map<int, float>> rule_weight_map;
 
-  for (auto& p : nextmap.pg_upmap) {
+  for (auto& p : *nextmap.pg_upmap) {
     to_check.insert(p.first);
   }
-  for (auto& p : nextmap.pg_upmap_items) {
+  for (auto& p : *nextmap.pg_upmap_items) {
     to_check.insert(p.first);
   }
   for (auto& p : pending_inc->new_pg_upmap) {
@@ -1876,10 +1884,10 @@ void OSDMap::maybe_remove_pg_upmaps(CephContext *cct,
                        << dendl;
         pending_inc->new_pg_upmap.erase(it);
       }
-      if (oldmap.pg_upmap.count(pg)) {
+      if (oldmap.pg_upmap->count(pg)) {
         ldout(cct, 10) << __func__ << " cancel invalid pg_upmap entry "
-                       << oldmap.pg_upmap.find(pg)->first << "->"
-                       << oldmap.pg_upmap.find(pg)->second
+                       << oldmap.pg_upmap->find(pg)->first << "->"
+                       << oldmap.pg_upmap->find(pg)->second
                        << dendl;
         pending_inc->old_pg_upmap.insert(pg);
       }
@@ -1893,11 +1901,11 @@ void OSDMap::maybe_remove_pg_upmaps(CephContext *cct,
                        << dendl;
         pending_inc->new_pg_upmap_items.erase(it);
       }
-      if (oldmap.pg_upmap_items.count(pg)) {
+      if (oldmap.pg_upmap_items->count(pg)) {
         ldout(cct, 10) << __func__ << " cancel invalid "
                        << "pg_upmap_items entry "
-                       << oldmap.pg_upmap_items.find(pg)->first << "->"
-                       << oldmap.pg_upmap_items.find(pg)->second
+                       << oldmap.pg_upmap_items->find(pg)->first << "->"
+                       << oldmap.pg_upmap_items->find(pg)->second
                        << dendl;
         pending_inc->old_pg_upmap_items.insert(pg);
       }
@@ -2103,16 +2111,16 @@ int OSDMap::apply_incremental(const Incremental &inc)
   }
 
   for (auto& p : inc.new_pg_upmap) {
-    pg_upmap[p.first] = p.second;
+    (*pg_upmap)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap) {
-    pg_upmap.erase(pg);
+    pg_upmap->erase(pg);
   }
   for (auto& p : inc.new_pg_upmap_items) {
-    pg_upmap_items[p.first] = p.second;
+    (*pg_upmap_items)[p.first] = p.second;
   }
   for (auto& pg : inc.old_pg_upmap_items) {
-    pg_upmap_items.erase(pg);
+    pg_upmap_items->erase(pg);
   }
 
   // blacklist
@@ -2276,6 +2284,30 @@ void OSDMap::_pg_to_raw_osds(
     *ppps = pps;
 }
 
+void OSDMap::_pg_range_to_raw_osds(
+  const pg_pool_t& pool, int64_t poolid,
+  unsigned ps_begin, unsigned ps_end,
+  vector<vector<int>> *osds,
+  vector<ps_t> *ppps) const
+{
+  unsigned n = ps_end - ps_begin;
+  ppps->resize(n);
+  for (unsigned i = 0; i < n; ++i)
+    (*ppps)[i] = pool.raw_pg_to_pps(pg_t(ps_begin + i, poolid));
+  unsigned size = pool.get_size();
+
+  int ruleno = crush->find_rule(pool.get_crush_rule(), pool.get_type(), size);
+  if (ruleno >= 0) {
+    vector<int> xs(ppps->begin(), ppps->end());
+    crush->do_rule_multi(ruleno, xs, osds, size, osd_weight, poolid);
+  } else {
+    osds->assign(n, vector<int>());
+  }
+
+  for (auto& o : *osds)
+    _remove_nonexistent_osds(pool, o);
+}
+
 int OSDMap::_pick_primary(const vector<int>& osds) const
 {
   for (auto osd : osds) {
@@ -2289,8 +2321,8 @@ int OSDMap::_pick_primary(const vector<int>& osds) const
 void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) const
 {
   pg_t pg = pi.raw_pg_to_pg(raw_pg);
-  auto p = pg_upmap.find(pg);
-  if (p != pg_upmap.end()) {
+  auto p = pg_upmap->find(pg);
+  if (p != pg_upmap->end()) {
     // make sure targets aren't marked out
     for (auto osd : p->second) {
       if (osd != CRUSH_ITEM_NONE && osd < max_osd && osd >= 0 &&
@@ -2303,8 +2335,8 @@ void OSDMap::_apply_upmap(const pg_pool_t& pi, pg_t raw_pg, vector<int> *raw) co
     // continue to check and apply pg_upmap_items if any
   }
 
-  auto q = pg_upmap_items.find(pg);
-  if (q != pg_upmap_items.end()) {
+  auto q = pg_upmap_items->find(pg);
+  if (q != pg_upmap_items->end()) {
     // NOTE: this approach does not allow a bidirectional swap,
     // e.g., [[1,2],[2,1]] applied to [0,1,2] -> [0,2,1].
     for (auto& r : q->second) {
@@ -2536,6 +2568,39 @@ void OSDMap::_pg_to_up_acting_osds(
     *acting_primary = _acting_primary;
 }
 
+void OSDMap::pg_range_to_up_acting_osds(
+  int64_t poolid, unsigned ps_begin, unsigned ps_end,
+  vector<vector<int>> *up, vector<int> *up_primary,
+  vector<vector<int>> *acting, vector<int> *acting_primary) const
+{
+  ceph_assert(ps_begin <= ps_end);
+  unsigned n = ps_end - ps_begin;
+  up->assign(n, vector<int>());
+  up_primary->assign(n, -1);
+  acting->assign(n, vector<int>());
+  acting_primary->assign(n, -1);
+  const pg_pool_t *pool = get_pg_pool(poolid);
+  if (!pool)
+    return;
+  vector<vector<int>> raw;
+  vector<ps_t> pps;
+  _pg_range_to_raw_osds(*pool, poolid, ps_begin, ps_end, &raw, &pps);
+  for (unsigned i = 0; i < n; ++i) {
+    pg_t pg(ps_begin + i, poolid);
+    _get_temp_osds(*pool, pg, &(*acting)[i], &(*acting_primary)[i]);
+    _apply_upmap(*pool, pg, &raw[i]);
+    _raw_to_up_osds(*pool, raw[i], &(*up)[i]);
+    (*up_primary)[i] = _pick_primary((*up)[i]);
+    _apply_primary_affinity(pps[i], *pool, &(*up)[i], &(*up_primary)[i]);
+    if ((*acting)[i].empty()) {
+      (*acting)[i] = (*up)[i];
+      if ((*acting_primary)[i] == -1) {
+	(*acting_primary)[i] = (*up_primary)[i];
+      }
+    }
+  }
+}
+
 int OSDMap::calc_pg_rank(int osd, const vector<int>& acting, int nrep)
 {
   if (!nrep)
@@ -2718,12 +2783,16 @@ void OSDMap::encode_classic(ceph::buffer::list& bl, uint64_t features) const
  * refer to
  *    doc/dev/osd_internals/osdmap_versions.txt
  */
-void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
+int OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
 {
   using ceph::encode;
+  if (client_only) {
+    // the parts the client skipped are gone, it cannot be re-encoded
+    return -EINVAL;
+  }
   if ((features & CEPH_FEATURE_OSDMAP_ENC) == 0) {
     encode_classic(bl, features);
-    return;
+    return 0;
   }
 
   // only a select set of callers should *ever* be encoding new
@@ -2809,11 +2878,11 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
     encode(erasure_code_profiles, bl);
 
     if (v >= 4) {
-      encode(pg_upmap, bl);
-      encode(pg_upmap_items, bl);
+      encode(*pg_upmap, bl);
+      encode(*pg_upmap_items, bl);
     } else {
-      ceph_assert(pg_upmap.empty());
-      ceph_assert(pg_upmap_items.empty());
+      ceph_assert(pg_upmap->empty());
+      ceph_assert(pg_upmap_items->empty());
     }
     if (v >= 6) {
       encode(crush_version, bl);
@@ -2907,6 +2976,7 @@ void OSDMap::encode(ceph::buffer::list& bl, uint64_t features) const
   crc_le = crc;
   crc_filler->copy_in(4, (char*)&crc_le);
   crc_defined = true;
+  return 0;
 }
 
 /* for a description of osdmap versions, and when they were introduced, please
@@ -3040,6 +3110,18 @@ void OSDMap::decode_classic(ceph::buffer::list::const_iterator& p)
   post_decode();
 }
 
+/// parse past an encoded vector of T without keeping it
+template<typename T>
+static void skip_vector(ceph::buffer::list::const_iterator& p)
+{
+  using ceph::decode;
+  __u32 n;
+  decode(n, p);
+  T t;
+  while (n--)
+    decode(t, p);
+}
+
 void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
 {
   using ceph::decode;
@@ -3120,11 +3202,11 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
     // version increased from 3 to 4 still in luminous, so same as above
     // applies.
     if (struct_v >= 4) {
-      decode(pg_upmap, bl);
-      decode(pg_upmap_items, bl);
+      decode(*pg_upmap, bl);
+      decode(*pg_upmap_items, bl);
     } else {
-      pg_upmap.clear();
-      pg_upmap_items.clear();
+      pg_upmap->clear();
+      pg_upmap_items->clear();
     }
     // again, version increased from 5 to 6 still in luminous, so above
     // applies.
@@ -3146,15 +3228,37 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
 
   {
     DECODE_START(8, bl); // extended, osd-only data
-    decode(osd_addrs->hb_back_addrs, bl);
-    decode(osd_info, bl);
-    decode(blacklist, bl);
-    decode(osd_addrs->cluster_addrs, bl);
-    decode(cluster_snapshot_epoch, bl);
-    decode(cluster_snapshot, bl);
-    decode(*osd_uuid, bl);
-    decode(osd_xinfo, bl);
-    decode(osd_addrs->hb_front_addrs, bl);
+    if (client_only) {
+      // clients still want the blacklist, xinfo (for features) and the
+      // release requirements from here
+      skip_vector<entity_addrvec_t>(bl);  // hb_back_addrs
+      skip_vector<osd_info_t>(bl);
+      decode(blacklist, bl);
+      skip_vector<entity_addrvec_t>(bl);  // cluster_addrs
+      decode(cluster_snapshot_epoch, bl);
+      decode(cluster_snapshot, bl);
+      skip_vector<uuid_d>(bl);
+      decode(osd_xinfo, bl);
+      skip_vector<entity_addrvec_t>(bl);  // hb_front_addrs
+
+      // keep the per-osd vectors sized for apply_incremental
+      auto blank = std::make_shared<entity_addrvec_t>();
+      osd_addrs->hb_back_addrs.assign(max_osd, blank);
+      osd_addrs->cluster_addrs.assign(max_osd, blank);
+      osd_addrs->hb_front_addrs.assign(max_osd, blank);
+      osd_info.assign(max_osd, osd_info_t());
+      osd_uuid->assign(max_osd, uuid_d());
+    } else {
+      decode(osd_addrs->hb_back_addrs, bl);
+      decode(osd_info, bl);
+      decode(blacklist, bl);
+      decode(osd_addrs->cluster_addrs, bl);
+      decode(cluster_snapshot_epoch, bl);
+      decode(cluster_snapshot, bl);
+      decode(*osd_uuid, bl);
+      decode(osd_xinfo, bl);
+      decode(osd_addrs->hb_front_addrs, bl);
+    }
     // 
     if (struct_v >= 2) {
       decode(nearfull_ratio, bl);
@@ -3198,13 +3302,19 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
 	require_osd_release = 0;
       }
     }
-    if (struct_v >= 6) {
-      decode(removed_snaps_queue, bl);
-    }
-    if (struct_v >= 8) {
-      decode(crush_node_flags, bl);
-    } else {
+    if (client_only) {
+      // DECODE_FINISH skips whatever is left
+      removed_snaps_queue.clear();
       crush_node_flags.clear();
+    } else {
+      if (struct_v >= 6) {
+	decode(removed_snaps_queue, bl);
+      }
+      if (struct_v >= 8) {
+	decode(crush_node_flags, bl);
+      } else {
+	crush_node_flags.clear();
+      }
     }
     DECODE_FINISH(bl); // osd-only data
   }
@@ -3358,7 +3468,7 @@ void OSDMap::dump(Formatter *f) const
   f->close_section();
 
   f->open_array_section("pg_upmap");
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("osds");
@@ -3370,7 +3480,7 @@ void OSDMap::dump(Formatter *f) const
   }
   f->close_section();
   f->open_array_section("pg_upmap_items");
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     f->open_object_section("mapping");
     f->dump_stream("pgid") << p.first;
     f->open_array_section("mappings");
@@ -3611,10 +3721,10 @@ void OSDMap::print(ostream& out) const
   }
   out << std::endl;
 
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     out << "pg_upmap " << p.first << " " << p.second << "\n";
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     out << "pg_upmap_items " << p.first << " " << p.second << "\n";
   }
 
@@ -4320,7 +4430,7 @@ int OSDMap::clean_pg_upmaps(
 {
   ldout(cct, 10) << __func__ << dendl;
   int changed = 0;
-  for (auto& p : pg_upmap) {
+  for (auto& p : *pg_upmap) {
     vector<int> raw;
     int primary;
     pg_to_raw_osds(p.first, &raw, &primary);
@@ -4331,7 +4441,7 @@ int OSDMap::clean_pg_upmaps(
       ++changed;
     }
   }
-  for (auto& p : pg_upmap_items) {
+  for (auto& p : *pg_upmap_items) {
     vector<int> raw;
     int primary;
     pg_to_raw_osds(p.first, &raw, &primary);
@@ -4423,10 +4533,14 @@ int OSDMap::calc_pg_upmaps(
   for (auto& i : pools) {
     if (!only_pools.empty() && !only_pools.count(i.first))
       continue;
+    vector<vector<int>> pool_up, pool_acting;
+    vector<int> pool_up_primary, pool_acting_primary;
+    tmp.pg_range_to_up_acting_osds(
+      i.first, 0, i.second.get_pg_num(),
+      &pool_up, &pool_up_primary, &pool_acting, &pool_acting_primary);
     for (unsigned ps = 0; ps < i.second.get_pg_num(); ++ps) {
       pg_t pg(ps, i.first);
-      vector<int> up;
-      tmp.pg_to_up_acting_osds(pg, &up, nullptr, nullptr, nullptr);
+      const vector<int>& up = pool_up[ps];
       ldout(cct, 20) << __func__ << " " << pg << " up " << up << dendl;
       for (auto osd : up) {
         if (osd != CRUSH_ITEM_NONE)
@@ -4478,7 +4592,9 @@ int OSDMap::calc_pg_upmaps(
   float decay_factor = 1.0 / float(max);
   float stddev = 0;
   map<int,float> osd_deviation;       // osd, deviation(pgs)
-  multimap<float,int> deviation_osd;  // deviation(pgs), osd
+  // deviation(pgs), osd; ties ordered by osd so that updating it in place
+  // keeps the order it'd get if rebuilt from scratch
+  set<pair<float,int>> deviation_osd;
   for (auto& i : pgs_by_osd) {
     // make sure osd is still there (belongs to this crush-tree)
     ceph_assert(osd_weight.count(i.first));
@@ -4564,7 +4680,17 @@ int OSDMap::calc_pg_upmaps(
 
     set<pg_t> to_unmap;
     map<pg_t, mempool::osdmap::vector<pair<int32_t,int32_t>>> to_upmap;
-    auto temp_pgs_by_osd = pgs_by_osd;
+    // only the osds the change touches, copied from pgs_by_osd on demand
+    map<int,set<pg_t>> temp_pgs_by_osd;
+    auto temp_pgs = [&](int osd) -> set<pg_t>& {
+      auto t = temp_pgs_by_osd.find(osd);
+      if (t == temp_pgs_by_osd.end()) {
+        auto q = pgs_by_osd.find(osd);
+        t = temp_pgs_by_osd.emplace(
+          osd, q != pgs_by_osd.end() ? q->second : set<pg_t>()).first;
+      }
+      return t->second;
+    };
     // always start with fullest, break if we find any changes to make
     for (auto p = deviation_osd.rbegin(); p != deviation_osd.rend(); ++p) {
       if (skip_overfull) {
@@ -4601,8 +4727,8 @@ int OSDMap::calc_pg_upmaps(
       }
       // look for remaps we can un-remap
       for (auto pg : pgs) {
-	auto p = tmp.pg_upmap_items.find(pg);
-        if (p == tmp.pg_upmap_items.end())
+	auto p = tmp.pg_upmap_items->find(pg);
+        if (p == tmp.pg_upmap_items->end())
           continue;
         mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
         for (auto q : p->second) {
@@ -4613,8 +4739,8 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " into overfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[q.second].erase(pg);
-            temp_pgs_by_osd[q.first].insert(pg);
+            temp_pgs(q.second).erase(pg);
+            temp_pgs(q.first).insert(pg);
           } else {
             new_upmap_items.push_back(q);
           }
@@ -4641,8 +4767,8 @@ int OSDMap::calc_pg_upmaps(
 
       // try upmap
       for (auto pg : pgs) {
-        auto temp_it = tmp.pg_upmap.find(pg);
-        if (temp_it != tmp.pg_upmap.end()) {
+        auto temp_it = tmp.pg_upmap->find(pg);
+        if (temp_it != tmp.pg_upmap->end()) {
           // leave pg_upmap alone
           // it must be specified by admin since balancer does not
           // support pg_upmap yet
@@ -4654,14 +4780,14 @@ int OSDMap::calc_pg_upmaps(
         auto pg_pool_size = tmp.get_pg_pool_size(pg);
         mempool::osdmap::vector<pair<int32_t,int32_t>> new_upmap_items;
         set<int> existing;
-        auto it = tmp.pg_upmap_items.find(pg);
-        if (it != tmp.pg_upmap_items.end() &&
+        auto it = tmp.pg_upmap_items->find(pg);
+        if (it != tmp.pg_upmap_items->end() &&
             it->second.size() >= (size_t)pg_pool_size) {
           ldout(cct, 10) << " " << pg << " already has full-size pg_upmap_items "
                          << it->second << ", skipping"
                          << dendl;
           continue;
-        } else if (it != tmp.pg_upmap_items.end()) {
+        } else if (it != tmp.pg_upmap_items->end()) {
           ldout(cct, 10) << " " << pg << " already has pg_upmap_items "
                          << it->second
                          << dendl;
@@ -4695,8 +4821,8 @@ int OSDMap::calc_pg_upmaps(
                          << dendl;
           existing.insert(orig[i]);
           existing.insert(out[i]);
-          temp_pgs_by_osd[orig[i]].erase(pg);
-          temp_pgs_by_osd[out[i]].insert(pg);
+          temp_pgs(orig[i]).erase(pg);
+          temp_pgs(out[i]).insert(pg);
           ceph_assert(new_upmap_items.size() < (size_t)pg_pool_size);
           new_upmap_items.push_back(make_pair(orig[i], out[i]));
           // append new remapping pairs slowly
@@ -4734,8 +4860,8 @@ int OSDMap::calc_pg_upmaps(
       // look for remaps we can un-remap
       vector<pair<pg_t,
         mempool::osdmap::vector<pair<int32_t,int32_t>>>> candidates;
-      candidates.reserve(tmp.pg_upmap_items.size());
-      for (auto& i : tmp.pg_upmap_items) {
+      candidates.reserve(tmp.pg_upmap_items->size());
+      for (auto& i : *tmp.pg_upmap_items) {
         if (to_skip.count(i.first))
           continue;
         if (!only_pools.empty() && !only_pools.count(i.first.pool()))
@@ -4759,8 +4885,8 @@ int OSDMap::calc_pg_upmaps(
                            << " which remapped " << pg
                            << " out from underfull osd." << osd
                            << dendl;
-            temp_pgs_by_osd[j.second].erase(pg);
-            temp_pgs_by_osd[j.first].insert(pg);
+            temp_pgs(j.second).erase(pg);
+            temp_pgs(j.first).insert(pg);
           } else {
             new_upmap_items.push_back(j);
           }
@@ -4810,9 +4936,10 @@ int OSDMap::calc_pg_upmaps(
 
     // test change, apply if change is good
     ceph_assert(to_unmap.size() || to_upmap.size());
+    // only the touched osds' deviations change; sum them up in osd order
+    // with the others so the result doesn't depend on the path taken
     float new_stddev = 0;
     map<int,float> temp_osd_deviation;
-    multimap<float,int> temp_deviation_osd;
     for (auto& i : temp_pgs_by_osd) {
       // make sure osd is still there (belongs to this crush-tree)
       ceph_assert(osd_weight.count(i.first));
@@ -4824,8 +4951,23 @@ int OSDMap::calc_pg_upmaps(
                      << "\tdeviation " << deviation
                      << dendl;
       temp_osd_deviation[i.first] = deviation;
-      temp_deviation_osd.insert(make_pair(deviation, i.first));
-      new_stddev += deviation * deviation;
+    }
+    {
+      auto t = temp_osd_deviation.begin();
+      for (auto& i : osd_deviation) {
+        for (; t != temp_osd_deviation.end() && t->first < i.first; ++t) {
+          new_stddev += t->second * t->second;
+        }
+        float deviation = i.second;
+        if (t != temp_osd_deviation.end() && t->first == i.first) {
+          deviation = t->second;
+          ++t;
+        }
+        new_stddev += deviation * deviation;
+      }
+      for (; t != temp_osd_deviation.end(); ++t) {
+        new_stddev += t->second * t->second;
+      }
     }
     ldout(cct, 10) << " stddev " << stddev << " -> " << new_stddev << dendl;
     if (new_stddev >= stddev) {
@@ -4859,13 +5001,23 @@ int OSDMap::calc_pg_upmaps(
     // ready to go
     ceph_assert(new_stddev < stddev);
     stddev = new_stddev;
-    pgs_by_osd = temp_pgs_by_osd;
-    osd_deviation = temp_osd_deviation;
-    deviation_osd = temp_deviation_osd;
+    for (auto& i : temp_pgs_by_osd) {
+      pgs_by_osd[i.first] = std::move(i.second);
+    }
+    for (auto& i : temp_osd_deviation) {
+      auto p = osd_deviation.find(i.first);
+      if (p != osd_deviation.end()) {
+        deviation_osd.erase(make_pair(p->second, i.first));
+        p->second = i.second;
+      } else {
+        osd_deviation.emplace(i.first, i.second);
+      }
+      deviation_osd.insert(make_pair(i.second, i.first));
+    }
     for (auto& i : to_unmap) {
       ldout(cct, 10) << " unmap pg " << i << dendl;
-      ceph_assert(tmp.pg_upmap_items.count(i));
-      tmp.pg_upmap_items.erase(i);
+      ceph_assert(tmp.pg_upmap_items->count(i));
+      tmp.pg_upmap_items->erase(i);
       pending_inc->old_pg_upmap_items.insert(i);
       ++num_changed;
     }
@@ -4873,7 +5025,7 @@ int OSDMap::calc_pg_upmaps(
       ldout(cct, 10) << " upmap pg " << i.first
                      << " new pg_upmap_items " << i.second
                      << dendl;
-      tmp.pg_upmap_items[i.first] = i.second;
+      (*tmp.pg_upmap_items)[i.first] = i.second;
       pending_inc->new_pg_upmap_items[i.first] = i.second;
       ++num_changed;
     }
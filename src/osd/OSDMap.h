@@ -551,8 +551,8 @@ private:
   std::shared_ptr< mempool::osdmap::vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
   // remap (post-CRUSH, pre-up)
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap; ///< remap pg
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>> pg_upmap_items; ///< remap osds in up set
+  std::shared_ptr<mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>> pg_upmap; ///< remap pg
+  std::shared_ptr<mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>>> pg_upmap_items; ///< remap osds in up set
 
   mempool::osdmap::map<int64_t,pg_pool_t> pools;
   mempool::osdmap::map<int64_t,std::string> pool_name;
@@ -587,6 +587,9 @@ public:
   uint8_t require_osd_release = 0;    // CEPH_RELEASE_*
 
 private:
+  /// decode only what clients use; see set_client_only()
+  bool client_only = false;
+
   mutable uint64_t cached_up_osd_features;
 
   mutable bool crc_defined;
@@ -613,6 +616,8 @@ private:
 	     osd_addrs(std::make_shared<addrs_s>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
+	     pg_upmap(std::make_shared<mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>>()),
+	     pg_upmap_items(std::make_shared<mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>>>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
 	     cluster_snapshot_epoch(0),
 	     new_blacklist_entries(false),
@@ -633,10 +638,25 @@ public:
 
   uint64_t get_encoding_features() const;
 
+  /**
+   * Have decode() keep only what a client (the Objecter) reads.  The
+   * per-osd heartbeat and cluster addrs, osd_info, uuids, the removed
+   * snaps queue and crush node flags are parsed past without being
+   * kept, so encode() refuses a client-only map with -EINVAL.
+   */
+  void set_client_only(bool b) {
+    client_only = b;
+  }
+  bool is_client_only() const {
+    return client_only;
+  }
+
   void deepish_copy_from(const OSDMap& o) {
     *this = o;
     primary_temp.reset(new mempool::osdmap::map<pg_t,int32_t>(*o.primary_temp));
     pg_temp.reset(new PGTempMap(*o.pg_temp));
+    pg_upmap.reset(new mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>(*o.pg_upmap));
+    pg_upmap_items.reset(new mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>>(*o.pg_upmap_items));
     osd_uuid.reset(new mempool::osdmap::vector<uuid_d>(*o.osd_uuid));
 
     if (o.osd_primary_affinity)
@@ -1045,7 +1065,8 @@ private:
   void decode_classic(ceph::buffer::list::const_iterator& p);
   void post_decode();
 public:
-  void encode(ceph::buffer::list& bl, uint64_t features=CEPH_FEATURES_ALL) const;
+  /// @return 0 on success, -EINVAL (and nothing encoded) if client-only
+  int encode(ceph::buffer::list& bl, uint64_t features=CEPH_FEATURES_ALL) const;
   void decode(ceph::buffer::list& bl);
   void decode(ceph::buffer::list::const_iterator& bl);
 
@@ -1125,6 +1146,12 @@ private:
     const pg_pool_t& pool, pg_t pg,
     std::vector<int> *osds,
     ps_t *ppps) const;
+  /// _pg_to_raw_osds for the pgs [ps_begin, ps_end) of a pool
+  void _pg_range_to_raw_osds(
+    const pg_pool_t& pool, int64_t poolid,
+    unsigned ps_begin, unsigned ps_end,
+    std::vector<std::vector<int>> *osds,
+    std::vector<ps_t> *ppps) const;
   int _pick_primary(const std::vector<int>& osds) const;
   void _remove_nonexistent_osds(const pg_pool_t& pool, std::vector<int>& osds) const;
 
@@ -1192,6 +1219,17 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /**
+   * pg_to_up_acting_osds for the pgs [ps_begin, ps_end) of a pool, with
+   * the crush mappings done as one batch.  Entry i of each vector is
+   * for pg ps_begin + i.
+   * Each of these pointers must be non-NULL.
+   */
+  void pg_range_to_up_acting_osds(
+    int64_t poolid, unsigned ps_begin, unsigned ps_end,
+    std::vector<std::vector<int>> *up, std::vector<int> *up_primary,
+    std::vector<std::vector<int>> *acting,
+    std::vector<int> *acting_primary) const;
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     ceph_assert(i != pools.end());
@@ -1397,8 +1435,8 @@ public:
   int get_osds_by_bucket_name(const std::string &name, std::set<int> *osds) const;
 
   bool have_pg_upmaps(pg_t pg) const {
-    return pg_upmap.count(pg) ||
-      pg_upmap_items.count(pg);
+    return pg_upmap->count(pg) ||
+      pg_upmap_items->count(pg);
   }
 
   bool check_full(const set<pg_shard_t> &missing_on) const {
@@ -1499,7 +1537,18 @@ public:
   float pool_raw_used_rate(int64_t poolid) const;
 
 };
-WRITE_CLASS_ENCODER_FEATURES(OSDMap)
+// OSDMap::encode() can fail, so this can't come from
+// WRITE_CLASS_ENCODER_FEATURES.  the maps encoded this way are the
+// daemons' own, which are never client-only
+inline void encode(const OSDMap &c, ceph::buffer::list &bl, uint64_t features) {
+  ENCODE_DUMP_PRE();
+  int r = c.encode(bl, features);
+  ceph_assert(r == 0);
+  ENCODE_DUMP_POST(OSDMap);
+}
+inline void decode(OSDMap &c, ceph::buffer::list::const_iterator &p) {
+  c.decode(p);
+}
 WRITE_CLASS_ENCODER_FEATURES(OSDMap::Incremental)
 
 typedef std::shared_ptr<const OSDMap> OSDMapRef;
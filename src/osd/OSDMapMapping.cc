@@ -57,6 +57,109 @@ void OSDMapMapping::update(const OSDMap& osdmap, pg_t pgid)
   _update_range(osdmap, pgid.pool(), pgid.ps(), pgid.ps() + 1);
 }
 
+bool OSDMapMapping::update(const OSDMap& osdmap,
+			   const OSDMap::Incremental& inc,
+			   unsigned max_pgs)
+{
+  if (epoch == 0 || epoch + 1 != inc.epoch ||
+      osdmap.get_epoch() != inc.epoch) {
+    return false;
+  }
+  if (inc.fullmap.length() || inc.crush.length() ||
+      inc.new_max_osd >= 0 ||
+      !inc.new_pools.empty() || !inc.old_pools.empty() ||
+      !inc.new_weight.empty() || !inc.new_primary_affinity.empty() ||
+      !inc.new_up_client.empty()) {
+    return false;
+  }
+  std::set<int> down;
+  for (auto& p : inc.new_state) {
+    // an osd coming up may be in any pg's raw crush mapping; we don't
+    // keep those, so we can't tell which pgs it rejoins
+    if ((p.second & ~CEPH_OSD_UP) || osdmap.is_up(p.first)) {
+      return false;
+    }
+    down.insert(p.first);
+  }
+
+  std::set<pg_t> pgs;
+  auto add = [&](const pg_t& pg) {
+    auto i = pools.find(pg.pool());
+    if (i != pools.end() && pg.ps() < i->second.pg_num) {
+      pgs.insert(pg);
+    }
+  };
+  for (auto& p : inc.new_pg_temp) {
+    add(p.first);
+  }
+  for (auto& p : inc.new_primary_temp) {
+    add(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap) {
+    add(p.first);
+  }
+  for (auto& p : inc.new_pg_upmap_items) {
+    add(p.first);
+  }
+  for (auto& pg : inc.old_pg_upmap) {
+    add(pg);
+  }
+  for (auto& pg : inc.old_pg_upmap_items) {
+    add(pg);
+  }
+  if (!down.empty()) {
+    // a down osd only drops out of the up and acting sets it was in
+    for (auto& p : pools) {
+      auto& pm = p.second;
+      for (unsigned ps = 0; ps < pm.pg_num; ++ps) {
+	const int32_t *row = &pm.table[pm.row_size() * ps];
+	bool hit = down.count(row[0]) || down.count(row[1]);
+	for (int i = 0; !hit && i < row[2]; ++i) {
+	  hit = down.count(row[4 + i]);
+	}
+	for (int i = 0; !hit && i < row[3]; ++i) {
+	  hit = down.count(row[4 + pm.size + i]);
+	}
+	if (hit) {
+	  pgs.insert(pg_t(ps, p.first));
+	  if (pgs.size() > max_pgs) {
+	    return false;
+	  }
+	}
+      }
+    }
+  }
+  if (pgs.size() > max_pgs) {
+    return false;
+  }
+
+  for (auto& pg : pgs) {
+    auto& pm = pools.find(pg.pool())->second;
+    std::vector<int> up, acting;
+    int up_primary, acting_primary;
+    pm.get(pg.ps(), nullptr, nullptr, &acting, nullptr);
+    for (auto osd : acting) {
+      if (osd != CRUSH_ITEM_NONE && osd < (int)acting_rmap.size()) {
+	auto& v = acting_rmap[osd];
+	auto q = std::find(v.begin(), v.end(), pg);
+	if (q != v.end()) {
+	  v.erase(q);
+	}
+      }
+    }
+    osdmap.pg_to_up_acting_osds(pg, &up, &up_primary,
+				&acting, &acting_primary);
+    pm.set(pg.ps(), up, up_primary, acting, acting_primary);
+    for (auto osd : acting) {
+      if (osd != CRUSH_ITEM_NONE && osd < (int)acting_rmap.size()) {
+	acting_rmap[osd].push_back(pg);
+      }
+    }
+  }
+  epoch = osdmap.get_epoch();
+  return true;
+}
+
 void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
 {
   acting_rmap.resize(osdmap.get_max_osd());
@@ -112,14 +215,15 @@ void OSDMapMapping::_update_range(
   ceph_assert(i != pools.end());
   ceph_assert(pg_begin <= pg_end);
   ceph_assert(pg_end <= i->second.pg_num);
+  std::vector<std::vector<int>> up, acting;
+  std::vector<int> up_primary, acting_primary;
+  osdmap.pg_range_to_up_acting_osds(
+    pool, pg_begin, pg_end,
+    &up, &up_primary, &acting, &acting_primary);
   for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    std::vector<int> up, acting;
-    int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
-      pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
-    i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
+    unsigned j = ps - pg_begin;
+    i->second.set(ps, std::move(up[j]), up_primary[j],
+		  std::move(acting[j]), acting_primary[j]);
   }
 }
 
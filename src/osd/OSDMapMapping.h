@@ -9,11 +9,10 @@
 #include <map>
 
 #include "osd/osd_types.h"
+#include "osd/OSDMap.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
 
-class OSDMap;
-
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
 public:
@@ -261,6 +260,8 @@ private:
   void _build_rmap(const OSDMap& osdmap);
 
   void _start(const OSDMap& osdmap) {
+    // the table is not valid for any epoch until _finish
+    epoch = 0;
     _init_mappings(osdmap);
   }
   void _finish(const OSDMap& osdmap);
@@ -325,6 +326,20 @@ public:
   void update(const OSDMap& map);
   void update(const OSDMap& map, pg_t pgid);
 
+  /**
+   * bring a mapping for the previous epoch forward to map, which is
+   * that epoch with inc applied, by recomputing only the pgs inc can
+   * affect.  that is possible when inc just marks osds down or changes
+   * pg_temp, primary_temp or upmap entries; anything that may move crush
+   * mappings (crush, weights, pools, osds coming up...) needs a full
+   * update.  gives up, leaving the mapping untouched, if that would be
+   * more than max_pgs pgs.
+   *
+   * @return true if the mapping is now at map's epoch
+   */
+  bool update(const OSDMap& map, const OSDMap::Incremental& inc,
+	      unsigned max_pgs);
+
   std::unique_ptr<MappingJob> start_update(
     const OSDMap& map,
     ParallelPGMapper& mapper,
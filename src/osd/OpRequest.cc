@@ -74,6 +74,14 @@ void OpRequest::_dump(Formatter *f) const
   }
 }
 
+uint64_t OpRequest::get_sample_key() const
+{
+  if (reqid.tid == 0) {
+    return TrackedOp::get_sample_key();
+  }
+  return std::hash<osd_reqid_t>()(reqid);
+}
+
 void OpRequest::_dump_op_descriptor_unlocked(ostream& stream) const
 {
   get_req()->print(stream);
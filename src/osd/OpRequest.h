@@ -16,12 +16,13 @@
 
 #include "osd/osd_types.h"
 #include "common/TrackedOp.h"
+#include "common/ThreadLocalPool.h"
 
 /**
  * The OpRequest takes in a Message* and takes over a single reference
  * to it, which it puts() when destroyed.
  */
-struct OpRequest : public TrackedOp {
+struct OpRequest : public TrackedOp, public ThreadLocalPool<OpRequest> {
   friend class OpTracker;
 
   // rmw flags
@@ -99,6 +100,8 @@ protected:
   void _dump_op_descriptor_unlocked(std::ostream& stream) const override;
   void _unregistered() override;
   bool filter_out(const std::set<std::string>& filters) override;
+  /// sample by request, so a write's repops are traced on the replicas too
+  uint64_t get_sample_key() const override;
 
 public:
   ~OpRequest() override {
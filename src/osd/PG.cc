@@ -602,14 +602,15 @@ void PG::add_backoff(SessionRef s, const hobject_t& begin, const hobject_t& end)
     s->add_backoff(b);
     dout(10) << __func__ << " session " << s << " added " << *b << dendl;
   }
-  con->send_message(
+  osd->send_message_osd_client(
     new MOSDBackoff(
       info.pgid,
       get_osdmap_epoch(),
       CEPH_OSD_BACKOFF_OP_BLOCK,
       b->id,
       begin,
-      end));
+      end),
+    con);
 }
 
 void PG::release_backoffs(const hobject_t& begin, const hobject_t& end)
@@ -654,14 +655,15 @@ void PG::release_backoffs(const hobject_t& begin, const hobject_t& end)
       ceph_assert(b->pg == this);
       ConnectionRef con = b->session->con;
       if (con) {   // OSD::ms_handle_reset clears s->con without a lock
-	con->send_message(
+	osd->send_message_osd_client(
 	  new MOSDBackoff(
 	    info.pgid,
 	    get_osdmap_epoch(),
 	    CEPH_OSD_BACKOFF_OP_UNBLOCK,
 	    b->id,
 	    b->begin,
-	    b->end));
+	    b->end),
+	  con);
       }
       if (b->is_new()) {
 	b->state = Backoff::STATE_DELETING;
@@ -2345,6 +2347,8 @@ int PG::build_scrub_map_chunk(
   // scan objects
   while (!pos.done()) {
     int r = get_pgbackend()->be_scan_list(map, pos);
+    osd->scrub_budget_charge(pos.bytes_read);
+    pos.bytes_read = 0;
     if (r == -EINPROGRESS) {
       return r;
     }
@@ -2478,12 +2482,23 @@ void PG::replica_scrub(
  */
 void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
 {
-  if (cct->_conf->osd_scrub_sleep > 0 &&
-      (scrubber.state == PG::Scrubber::NEW_CHUNK ||
+  double scrub_sleep = 0;
+  if ((scrubber.state == PG::Scrubber::NEW_CHUNK ||
        scrubber.state == PG::Scrubber::INACTIVE) &&
-       scrubber.needs_sleep) {
+      scrubber.needs_sleep) {
+    scrub_sleep = cct->_conf->osd_scrub_sleep;
+    // wait out whatever scrub has read beyond osd_scrub_max_bytes_per_sec
+    scrub_sleep = std::max(scrub_sleep, osd->scrub_budget_wait());
+    // and back off from the next chunk while client ops are piling up
+    unsigned yield_ops = cct->_conf->osd_scrub_yield_client_ops;
+    if (yield_ops && osd->get_queued_client_ops() >= yield_ops) {
+      scrub_sleep = std::max(scrub_sleep, 0.1);
+    }
+  }
+  if (scrub_sleep > 0) {
     ceph_assert(!scrubber.sleeping);
-    dout(20) << __func__ << " state is INACTIVE|NEW_CHUNK, sleeping" << dendl;
+    dout(20) << __func__ << " state is INACTIVE|NEW_CHUNK, sleeping "
+	     << scrub_sleep << dendl;
 
     // Do an async sleep so we don't block the op queue
     OSDService *osds = osd;
@@ -2511,8 +2526,7 @@ void PG::scrub(epoch_t queued, ThreadPool::TPHandle &handle)
           pg->unlock();
         });
     std::lock_guard l(osd->sleep_lock);
-    osd->sleep_timer.add_event_after(cct->_conf->osd_scrub_sleep,
-                                           scrub_requeue_callback);
+    osd->sleep_timer.add_event_after(scrub_sleep, scrub_requeue_callback);
     scrubber.sleeping = true;
     scrubber.sleep_start = ceph_clock_now();
     return;
@@ -215,6 +215,13 @@ public:
     handle.reset_tp_timeout();
   }
   void lock(bool no_lockdep = false) const;
+  bool try_lock() const {
+    if (!_lock.try_lock()) {
+      return false;
+    }
+    ceph_assert(!recovery_state.debug_has_dirty_state());
+    return true;
+  }
   void unlock() const {
     //generic_dout(0) << this << " " << info.pgid << " unlock" << dendl;
     ceph_assert(!recovery_state.debug_has_dirty_state());
@@ -81,7 +81,8 @@ void PGBackend::send_recovery_deletes(int prio,
 
       while (it != objects.end() &&
 	     cost < cct->_conf->osd_max_push_cost &&
-	     deletes < cct->_conf->osd_max_push_objects) {
+	     (!cct->_conf->osd_max_push_objects ||
+	      deletes < cct->_conf->osd_max_push_objects)) {
 	dout(20) << __func__ << ": sending recovery delete << " << it->first
 		 << " " << it->second << " to osd." << shard << dendl;
 	msg->objects.push_back(*it);
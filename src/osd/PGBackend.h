@@ -285,6 +285,9 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
 
      virtual PerfCounters *get_logger() = 0;
 
+     virtual void record_peer_read_latency(int osd, ceph::timespan lat) = 0;
+     virtual double get_peer_read_latency(int osd) = 0;
+
      virtual ceph_tid_t get_tid() = 0;
 
      virtual LogClientTemp clog_error() = 0;
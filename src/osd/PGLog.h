@@ -20,6 +20,7 @@
 #include "include/ceph_assert.h"
 #include "osd_types.h"
 #include "os/ObjectStore.h"
+#include "PGLogIndex.h"
 #include <list>
 
 constexpr auto PGLOG_INDEXED_OBJECTS          = 1 << 0;
@@ -67,10 +68,31 @@ public:
    * plus some methods to manipulate it all.
    */
   struct IndexedLog : public pg_log_t {
-    mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
+    struct entry_soid {
+      const hobject_t& operator()(const pg_log_entry_t& e) const {
+	return e.soid;
+      }
+    };
+    struct entry_reqid {
+      const osd_reqid_t& operator()(const pg_log_entry_t& e) const {
+	return e.reqid;
+      }
+    };
+    struct dup_reqid {
+      const osd_reqid_t& operator()(const pg_log_dup_t& e) const {
+	return e.reqid;
+      }
+    };
+    using object_index_t =
+      pg_log_index_t<pg_log_entry_t, hobject_t, entry_soid>;
+    using caller_op_index_t =
+      pg_log_index_t<pg_log_entry_t, osd_reqid_t, entry_reqid>;
+    using dup_index_t = pg_log_index_t<pg_log_dup_t, osd_reqid_t, dup_reqid>;
+
+    mutable object_index_t objects;  // ptrs into log.  be careful!
+    mutable caller_op_index_t caller_ops;
     mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+    mutable dup_index_t dup_index;
 
     // recovery pointers
     list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
@@ -258,15 +280,14 @@ public:
       ceph_assert(version);
       ceph_assert(user_version);
       ceph_assert(return_code);
-      ceph::unordered_map<osd_reqid_t,pg_log_entry_t*>::const_iterator p;
       if (!(indexed_data & PGLOG_INDEXED_CALLER_OPS)) {
         index_caller_ops();
       }
-      p = caller_ops.find(r);
-      if (p != caller_ops.end()) {
-	*version = p->second->version;
-	*user_version = p->second->user_version;
-	*return_code = p->second->return_code;
+      auto c = caller_ops.find(r);
+      if (c != caller_ops.end()) {
+	*version = c->second->version;
+	*user_version = c->second->user_version;
+	*return_code = c->second->return_code;
 	return true;
       }
 
@@ -275,7 +296,7 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS)) {
         index_extra_caller_ops();
       }
-      p = extra_caller_ops.find(r);
+      auto p = extra_caller_ops.find(r);
       if (p != extra_caller_ops.end()) {
 	uint32_t idx = 0;
 	for (auto i = p->second->extra_reqids.begin();
@@ -361,7 +382,7 @@ public:
       if (to_index & PGLOG_INDEXED_DUPS) {
 	dup_index.clear();
 	for (auto& i : dups) {
-	  dup_index[i.reqid] = const_cast<pg_log_dup_t*>(&i);
+	  dup_index.insert_or_assign(const_cast<pg_log_dup_t*>(&i));
 	}
       }
 
@@ -376,13 +397,13 @@ public:
 	     ++i) {
 	  if (to_index & PGLOG_INDEXED_OBJECTS) {
 	    if (i->object_is_indexed()) {
-	      objects[i->soid] = const_cast<pg_log_entry_t*>(&(*i));
+	      objects.insert_or_assign(const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
 	  if (to_index & PGLOG_INDEXED_CALLER_OPS) {
 	    if (i->reqid_is_indexed()) {
-	      caller_ops[i->reqid] = const_cast<pg_log_entry_t*>(&(*i));
+	      caller_ops.insert_or_assign(const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
@@ -418,14 +439,14 @@ public:
 
     void index(pg_log_entry_t& e) {
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
-        if (objects.count(e.soid) == 0 ||
-            objects[e.soid]->version < e.version)
-          objects[e.soid] = &e;
+        auto it = objects.find(e.soid);
+        if (it == objects.end() || it->second->version < e.version)
+          objects.insert_or_assign(&e);
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
 	// divergent merge_log indexes new before unindexing old
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &e;
+	  caller_ops.insert_or_assign(&e);
         }
       }
       if (indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS) {
@@ -479,7 +500,7 @@ public:
 
     void index(pg_log_dup_t& e) {
       if (indexed_data & PGLOG_INDEXED_DUPS) {
-	dup_index[e.reqid] = &e;
+	dup_index.insert_or_assign(&e);
       }
     }
 
@@ -514,11 +535,11 @@ public:
 
       // to our index
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
-        objects[e.soid] = &(log.back());
+        objects.insert_or_assign(&(log.back()));
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &(log.back());
+	  caller_ops.insert_or_assign(&(log.back()));
         }
       }
 
@@ -946,8 +967,7 @@ protected:
 		       << " last_divergent_update: " << last_divergent_update
 		       << dendl;
 
-    ceph::unordered_map<hobject_t, pg_log_entry_t*>::const_iterator objiter =
-      log.objects.find(hoid);
+    auto objiter = log.objects.find(hoid);
     if (objiter != log.objects.end() &&
 	objiter->second->version >= first_divergent_update) {
       /// Case 1)
@@ -1346,8 +1366,14 @@ public:
     // will get overridden below if it had been recorded
     eversion_t on_disk_can_rollback_to = info.last_update;
     eversion_t on_disk_rollback_info_trimmed_to = eversion_t();
+    // one pass over the whole log; don't push hotter data out of the cache
+    ObjectStore::omap_iter_hints_t hints;
+    hints.readahead =
+      store->cct->_conf.get_val<Option::size_t>("osd_omap_scan_readahead");
+    hints.fill_cache = false;
     ObjectMap::ObjectMapIterator p = store->get_omap_iterator(ch,
-							      pgmeta_oid);
+							      pgmeta_oid,
+							      hints);
     map<eversion_t, hobject_t> divergent_priors;
     bool must_rebuild = false;
     missing.may_include_deletes = false;
@@ -0,0 +1,135 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <functional>
+
+#include "include/ceph_assert.h"
+#include "include/mempool.h"
+
+/**
+ * pg_log_index_t - index of log entries (or dups) by a key they hold
+ *
+ * An open-addressing (linear probing) hash table whose slots are just
+ * the key's hash and a pointer to the entry; the key itself is read
+ * from the entry.  Compared with an unordered_map this saves the heap
+ * node and the copy of the key (an hobject_t, with its strings, for
+ * the objects index) per entry.  Erasing uses backward shift deletion,
+ * so there are no tombstones.
+ *
+ * The interface is the subset of the map one PGLog needs; find()
+ * returns an iterator whose ->second is the entry.  Iterators are
+ * invalidated by any insertion or erasure.
+ */
+template <typename Entry, typename Key, typename GetKey,
+	  typename Hash = std::hash<Key>>
+class pg_log_index_t {
+public:
+  struct value_type {
+    size_t hash = 0;
+    Entry *second = nullptr;  ///< nullptr if the slot is free
+  };
+  using const_iterator = const value_type*;
+  using iterator = const_iterator;
+
+private:
+  mempool::osd_pglog::vector<value_type> slots;  ///< size is 0 or a power of 2
+  size_t num = 0;
+
+  size_t mask() const {
+    return slots.size() - 1;
+  }
+
+  value_type *lookup(const Key &k, size_t h) const {
+    if (slots.empty())
+      return nullptr;
+    for (size_t i = h & mask(); ; i = (i + 1) & mask()) {
+      auto &s = const_cast<value_type&>(slots[i]);
+      if (!s.second)
+	return nullptr;
+      if (s.hash == h && GetKey()(*s.second) == k)
+	return &s;
+    }
+  }
+
+  void place(const value_type &v) {
+    size_t i = v.hash & mask();
+    while (slots[i].second)
+      i = (i + 1) & mask();
+    slots[i] = v;
+  }
+
+  void grow() {
+    mempool::osd_pglog::vector<value_type> old;
+    old.swap(slots);
+    slots.resize(old.empty() ? 16 : old.size() * 2);
+    for (auto &v : old) {
+      if (v.second)
+	place(v);
+    }
+  }
+
+public:
+  size_t size() const {
+    return num;
+  }
+  bool empty() const {
+    return num == 0;
+  }
+  const_iterator end() const {
+    return nullptr;
+  }
+  const_iterator find(const Key &k) const {
+    return lookup(k, Hash()(k));
+  }
+  size_t count(const Key &k) const {
+    return find(k) ? 1 : 0;
+  }
+
+  /// index e under its key, replacing any entry already there
+  void insert_or_assign(Entry *e) {
+    const Key &k = GetKey()(*e);
+    size_t h = Hash()(k);
+    if (auto s = lookup(k, h)) {
+      s->second = e;
+      return;
+    }
+    // keep the load factor at or below 3/4
+    if ((num + 1) * 4 > slots.size() * 3)
+      grow();
+    place(value_type{h, e});
+    ++num;
+  }
+
+  void erase(const_iterator it) {
+    ceph_assert(it);
+    size_t i = it - slots.data();
+    ceph_assert(i < slots.size());
+    // shift back the entries of the probe sequence that follows
+    for (size_t j = (i + 1) & mask(); slots[j].second; j = (j + 1) & mask()) {
+      size_t home = slots[j].hash & mask();
+      // move j into the hole at i unless its home lies in (i, j]
+      if (((j - home) & mask()) >= ((j - i) & mask())) {
+	slots[i] = slots[j];
+	i = j;
+      }
+    }
+    slots[i] = value_type();
+    --num;
+  }
+
+  void clear() {
+    mempool::osd_pglog::vector<value_type>().swap(slots);
+    num = 0;
+  }
+};
@@ -25,6 +25,7 @@
 #include "Session.h"
 #include "objclass/objclass.h"
 
+#include "common/CDC.h"
 #include "common/errno.h"
 #include "common/scrub_types.h"
 #include "common/perf_counters.h"
@@ -45,6 +46,7 @@
 
 #include "common/config.h"
 #include "include/compat.h"
+#include "include/random.h"
 #include "mon/MonClient.h"
 #include "osdc/Objecter.h"
 #include "json_spirit/json_spirit_value.h"
@@ -535,6 +537,23 @@ bool PrimaryLogPG::should_send_op(
 }
 
 
+bool PrimaryLogPG::can_batch_trim(
+  const hobject_t &batched,
+  const hobject_t &soid)
+{
+  // issue_repop() decides what each peer gets by the op's object alone,
+  // so the clone and the head whose snapset it updates must go to the
+  // same peers as the rest of the batch
+  for (auto &peer : get_acting_recovery_backfill()) {
+    bool send = should_send_op(peer, batched);
+    if (should_send_op(peer, soid) != send ||
+	should_send_op(peer, soid.get_head()) != send) {
+      return false;
+    }
+  }
+  return true;
+}
+
 ConnectionRef PrimaryLogPG::get_con_osd_cluster(
   int peer, epoch_t from_epoch)
 {
@@ -1461,6 +1480,17 @@ void PrimaryLogPG::do_pg_op(OpRequestRef op)
       result = do_scrub_ls(m, &osd_op);
       break;
 
+    case CEPH_OSD_OP_PG_OMAP_READ:
+      {
+	bool waiting = false;
+	result = do_pg_omap_read(op, m, &osd_op, &waiting);
+	if (waiting) {
+	  delete filter;
+	  return;
+	}
+      }
+      break;
+
     default:
       result = -EINVAL;
       break;
@@ -1516,6 +1546,230 @@ int PrimaryLogPG::do_scrub_ls(MOSDOp *m, OSDOp *osd_op)
   return r;
 }
 
+int PrimaryLogPG::do_pg_omap_read(OpRequestRef op, MOSDOp *m, OSDOp *osd_op,
+				  bool *waiting)
+{
+  if (m->get_snapid() != CEPH_NOSNAP) {
+    return -EINVAL;
+  }
+  if (!pool.info.supports_omap()) {
+    return -EOPNOTSUPP;
+  }
+  auto bp = osd_op->indata.cbegin();
+  vector<pg_omap_read_t> reads;
+  try {
+    decode(reads, bp);
+  } catch (buffer::error&) {
+    dout(10) << " corrupted pg_omap_read_t" << dendl;
+    return -EINVAL;
+  }
+  if (reads.size() > osd->osd_max_pg_omap_read_objects) {
+    return -E2BIG;
+  }
+
+  // the caps were only checked against the op's own object
+  auto priv = m->get_connection()->get_priv();
+  auto session = static_cast<Session*>(priv.get());
+  if (!session) {
+    return -EPERM;
+  }
+  const string& nspace = m->get_hobj().nspace;
+
+  // bound the whole op as if it read a single object
+  uint64_t entries_left = cct->_conf->osd_max_omap_entries_per_request;
+  uint64_t bytes_left = cct->_conf->osd_max_omap_bytes_per_request;
+
+  vector<pg_omap_read_result_t> results(reads.size());
+  for (unsigned i = 0; i < reads.size(); ++i) {
+    const auto& read = reads[i];
+    auto& result = results[i];
+    const string& key = read.key.empty() ? read.oid.name : read.key;
+    if (!session->caps.is_capable(pool.name, nspace,
+				  pool.info.application_metadata,
+				  key, true, false, {},
+				  session->get_peer_socket_addr())) {
+      return -EPERM;
+    }
+    hobject_t soid(read.oid, read.key, CEPH_NOSNAP,
+		   pool.info.hash_key(key, nspace), info.pgid.pool(), nspace);
+    if (get_osdmap()->raw_pg_to_pg(pg_t(soid.get_hash(), info.pgid.pool())) !=
+	info.pgid.pgid) {
+      result.rval = -EXDEV;
+      continue;
+    }
+    if (is_unreadable_object(soid)) {
+      wait_for_unreadable_object(soid, op);
+      *waiting = true;
+      return 0;
+    }
+    ObjectContextRef obc = get_object_context(soid, false);
+    if (!obc || !obc->obs.exists || obc->obs.oi.is_whiteout()) {
+      result.rval = -ENOENT;
+      continue;
+    }
+    if (!obc->obs.oi.is_omap()) {
+      continue;
+    }
+    // don't read past a write in flight; the op is retried as a whole
+    if (!obc->get_read(op)) {
+      dout(10) << __func__ << " waiting for a read lock on " << soid << dendl;
+      *waiting = true;
+      return 0;
+    }
+    if (read.want_header) {
+      result.rval = osd->store->omap_get_header(ch, ghobject_t(soid),
+						&result.header);
+      bytes_left -= std::min<uint64_t>(bytes_left, result.header.length());
+    }
+    if (result.rval >= 0 && read.max_return) {
+      uint64_t bytes = 0;
+      result.rval = do_omap_get_vals(
+	soid, obc->obs.oi.version, read.start_after, read.filter_prefix,
+	std::min(read.max_return, entries_left), bytes_left,
+	&result.vals, &bytes, &result.truncated);
+      entries_left -= result.vals.size();
+      bytes_left -= std::min(bytes_left, bytes);
+    }
+    list<OpRequestRef> to_requeue;
+    obc->rwstate.put_read(&to_requeue);
+    requeue_ops(to_requeue);
+  }
+  encode(results, osd_op->outdata);
+  dout(10) << __func__ << " read " << reads.size() << " objects, "
+	   << osd_op->outdata.length() << " bytes" << dendl;
+  return 0;
+}
+
+int PrimaryLogPG::do_omap_get_vals(const hobject_t& soid,
+				   eversion_t version,
+				   const string& start_after,
+				   const string& filter_prefix,
+				   uint64_t max_return, uint64_t max_bytes,
+				   map<string, bufferlist> *vals,
+				   uint64_t *bytes, bool *truncated)
+{
+  ObjectMap::ObjectMapIterator iter =
+    take_omap_cursor(soid, version, start_after, filter_prefix);
+  if (iter) {
+    dout(20) << __func__ << " " << soid << " going on past " << start_after
+	     << dendl;
+  } else {
+    ObjectStore::omap_iter_hints_t hints;
+    if (max_return >= 64) {
+      hints.readahead =
+	static_cast<Option::size_t>(osd->osd_omap_scan_readahead);
+    }
+    if (!filter_prefix.empty()) {
+      // the first key past every key starting with filter_prefix
+      string end = filter_prefix;
+      while (!end.empty() && (unsigned char)end.back() == 0xff) {
+	end.pop_back();
+      }
+      if (!end.empty()) {
+	++end.back();
+	hints.upper_bound = std::move(end);
+      }
+    }
+    iter = osd->store->get_omap_iterator(ch, ghobject_t(soid), hints);
+    if (!iter) {
+      return -ENOENT;
+    }
+    iter->upper_bound(start_after);
+    if (filter_prefix > start_after) iter->lower_bound(filter_prefix);
+  }
+  *bytes = 0;
+  *truncated = false;
+  const string *last_key = &start_after;
+  for (uint64_t num = 0;
+       iter->valid() &&
+	 iter->key().substr(0, filter_prefix.size()) == filter_prefix;
+       ++num, iter->next()) {
+    dout(20) << "Found key " << iter->key() << dendl;
+    if (num >= max_return || *bytes >= max_bytes) {
+      *truncated = true;
+      break;
+    }
+    string key = iter->key();
+    bufferlist value = iter->value();
+    // as encoded in the reply
+    *bytes += 2 * sizeof(__u32) + key.size() + value.length();
+    last_key = &vals->emplace_hint(vals->end(), std::move(key),
+				   std::move(value))->first;
+  }
+  if (*truncated) {
+    // the iterator is at the first key the next page asks for
+    put_omap_cursor(soid, version, *last_key, filter_prefix, std::move(iter));
+  }
+  return 0;
+}
+
+ObjectMap::ObjectMapIterator PrimaryLogPG::take_omap_cursor(
+  const hobject_t& soid, eversion_t version,
+  const string& start_after, const string& filter_prefix)
+{
+  auto p = omap_cursors.find(std::make_pair(soid, start_after));
+  if (p == omap_cursors.end()) {
+    return ObjectMap::ObjectMapIterator();
+  }
+  omap_cursor_t cursor = std::move(p->second);
+  omap_cursors.erase(p);
+  osd->put_omap_cursors(1);
+  if (cursor.version != version ||
+      cursor.filter_prefix != filter_prefix ||
+      cursor.expires <= ceph::coarse_mono_clock::now()) {
+    // the object changed since, or another listing with the same last key
+    return ObjectMap::ObjectMapIterator();
+  }
+  return std::move(cursor.iter);
+}
+
+void PrimaryLogPG::put_omap_cursor(
+  const hobject_t& soid, eversion_t version,
+  const string& last_key, const string& filter_prefix,
+  ObjectMap::ObjectMapIterator iter)
+{
+  const uint64_t max = osd->osd_omap_cursors_per_pg;
+  if (max == 0) {
+    clear_omap_cursors();
+    return;
+  }
+  const auto now = ceph::coarse_mono_clock::now();
+  auto oldest = omap_cursors.end();
+  for (auto p = omap_cursors.begin(); p != omap_cursors.end();) {
+    if (p->second.expires <= now) {
+      p = omap_cursors.erase(p);
+      osd->put_omap_cursors(1);
+      continue;
+    }
+    if (oldest == omap_cursors.end() ||
+	p->second.expires < oldest->second.expires) {
+      oldest = p;
+    }
+    ++p;
+  }
+  auto key = std::make_pair(soid, last_key);
+  if (omap_cursors.count(key) == 0) {
+    if (omap_cursors.size() >= max) {
+      omap_cursors.erase(oldest);
+    } else if (!osd->get_omap_cursor()) {
+      // the other PGs keep as many as the OSD may have open
+      return;
+    }
+  }
+  auto& cursor = omap_cursors[key];
+  cursor.version = version;
+  cursor.filter_prefix = filter_prefix;
+  cursor.iter = std::move(iter);
+  cursor.expires = now + std::chrono::seconds(
+    static_cast<uint64_t>(osd->osd_omap_cursor_ttl));
+}
+
+void PrimaryLogPG::clear_omap_cursors()
+{
+  osd->put_omap_cursors(omap_cursors.size());
+  omap_cursors.clear();
+}
+
 PrimaryLogPG::PrimaryLogPG(OSDService *o, OSDMapRef curmap,
 			   const PGPool &_pool,
 			   const map<string,string>& ec_profile, spg_t p) :
@@ -2104,14 +2358,23 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
       if (missing_oid != hobject_t() && hit_set->contains(missing_oid))
         in_hit_set = true;
     }
-    if (!op->hitset_inserted) {
-      hit_set->insert(oid);
-      op->hitset_inserted = true;
-      if (hit_set->is_full() ||
-          hit_set_start_stamp + pool.info.hit_set_period <= m->get_recv_stamp()) {
-        hit_set_persist();
+  }
+  if (!op->hitset_inserted &&
+      (hit_set || (agent_state && agent_state->temp_sketch))) {
+    op->hitset_inserted = true;
+    if (hit_set_sample()) {
+      if (hit_set) {
+	hit_set->insert(oid);
+      }
+      if (agent_state && agent_state->temp_sketch) {
+	agent_state->temp_sketch->insert(oid);
       }
     }
+    if (hit_set &&
+	(hit_set->is_full() ||
+	 hit_set_start_stamp + pool.info.hit_set_period <= m->get_recv_stamp())) {
+      hit_set_persist();
+    }
   }
 
   if (agent_state) {
@@ -2399,16 +2662,97 @@ void PrimaryLogPG::handle_manifest_flush(hobject_t oid, ceph_tid_t tid, int r,
   }
 }
 
+/*
+ * With a dedup_chunk_algorithm, cut the runs of adjacent dirty chunks
+ * that hold a reference anew in the flush's chunk_map, where their
+ * content says, before they are fingerprinted. The new chunks have no
+ * target yet; do_manifest_flush names them after their fingerprints.
+ * The old targets lose this object's reference, unless a chunk outside
+ * the runs still uses them, once try_flush_mark_clean commits the new
+ * chunk_map.
+ */
+void PrimaryLogPG::cut_dirty_chunks(FlushOpRef fop)
+{
+  std::string algo;
+  int64_t chunk_size = 0;
+  if (pool.info.get_fingerprint_type() == pg_pool_t::TYPE_FINGERPRINT_NONE ||
+      !pool.info.opts.get(pool_opts_t::DEDUP_CHUNK_ALGORITHM, &algo) ||
+      !pool.info.opts.get(pool_opts_t::DEDUP_CDC_CHUNK_SIZE, &chunk_size)) {
+    return;
+  }
+  auto cdc = CDC::create(algo, cbits((uint64_t)chunk_size) - 1);
+  if (!cdc) {
+    dout(5) << __func__ << " bad dedup_chunk_algorithm " << algo
+	    << " or dedup_cdc_chunk_size " << chunk_size << dendl;
+    return;
+  }
+
+  const hobject_t& soid = fop->obc->obs.oi.soid;
+  auto& chunk_map = fop->chunk_map;
+  auto cut = [](const chunk_info_t& c) {
+    return c.is_dirty() && c.has_reference();
+  };
+  std::set<hobject_t> old_targets;
+  auto p = chunk_map.begin();
+  while (p != chunk_map.end()) {
+    if (!cut(p->second)) {
+      ++p;
+      continue;
+    }
+    const uint64_t start = p->first;
+    uint64_t end = start;
+    auto q = p;
+    for (; q != chunk_map.end() && q->first == end && cut(q->second); ++q) {
+      end += q->second.length;
+    }
+
+    bufferlist bl;
+    int r = pgbackend->objects_read_sync(soid, start, end - start, 0, &bl);
+    if (r < 0 || bl.length() != end - start) {
+      // leave them as they are, the flush reports the error
+      p = q;
+      continue;
+    }
+    vector<pair<uint64_t, uint64_t>> chunks;
+    cdc->calc_chunks(bl, &chunks);
+
+    chunk_info_t proto = p->second;
+    proto.oid.oid = object_t();
+    proto.offset = 0;
+    for (auto i = p; i != q; ++i) {
+      if (!i->second.oid.oid.name.empty()) {
+	old_targets.insert(i->second.oid);
+      }
+    }
+    chunk_map.erase(p, q);
+    for (auto& c : chunks) {
+      chunk_info_t& info = chunk_map[start + c.first];
+      info = proto;
+      info.length = c.second;
+    }
+    dout(20) << __func__ << " " << soid << " " << start << "~" << end - start
+	     << " into " << chunks.size() << " chunks" << dendl;
+    p = chunk_map.lower_bound(end);
+  }
+
+  for (auto& c : chunk_map) {
+    old_targets.erase(c.second.oid);
+  }
+  fop->old_chunk_targets = std::move(old_targets);
+}
+
 int PrimaryLogPG::start_manifest_flush(OpRequestRef op, ObjectContextRef obc, bool blocking,
 				       boost::optional<std::function<void()>> &&on_flush)
 {
-  auto p = obc->obs.oi.manifest.chunk_map.begin();
   FlushOpRef manifest_fop(std::make_shared<FlushOp>());
   manifest_fop->op = op;
   manifest_fop->obc = obc;
   manifest_fop->flushed_version = obc->obs.oi.user_version;
   manifest_fop->blocking = blocking;
   manifest_fop->on_flush = std::move(on_flush);
+  manifest_fop->chunk_map = obc->obs.oi.manifest.chunk_map;
+  cut_dirty_chunks(manifest_fop);
+  auto p = manifest_fop->chunk_map.begin();
   int r = do_manifest_flush(op, obc, manifest_fop, p->first, blocking);
   if (r < 0) {
     return r;
@@ -2421,15 +2765,16 @@ int PrimaryLogPG::start_manifest_flush(OpRequestRef op, ObjectContextRef obc, bo
 int PrimaryLogPG::do_manifest_flush(OpRequestRef op, ObjectContextRef obc, FlushOpRef manifest_fop,
 				    uint64_t start_offset, bool block)
 {
-  struct object_manifest_t &manifest = obc->obs.oi.manifest;
+  // the flush's own chunk_map, committed once every chunk is flushed
+  map<uint64_t, chunk_info_t> &chunk_map = manifest_fop->chunk_map;
   hobject_t soid = obc->obs.oi.soid;
   ceph_tid_t tid;
   SnapContext snapc;
   uint64_t max_copy_size = 0, last_offset = 0;
 
-  map<uint64_t, chunk_info_t>::iterator iter = manifest.chunk_map.find(start_offset); 
-  ceph_assert(iter != manifest.chunk_map.end());
-  for (;iter != manifest.chunk_map.end(); ++iter) {
+  map<uint64_t, chunk_info_t>::iterator iter = chunk_map.find(start_offset); 
+  ceph_assert(iter != chunk_map.end());
+  for (;iter != chunk_map.end(); ++iter) {
     if (iter->second.is_dirty()) {
       last_offset = iter->first;
       max_copy_size += iter->second.length;
@@ -2439,8 +2784,8 @@ int PrimaryLogPG::do_manifest_flush(OpRequestRef op, ObjectContextRef obc, Flush
     }
   }
 
-  iter = manifest.chunk_map.find(start_offset);
-  for (;iter != manifest.chunk_map.end(); ++iter) {
+  iter = chunk_map.find(start_offset);
+  for (;iter != chunk_map.end(); ++iter) {
     if (!iter->second.is_dirty()) {
       continue;
     }
@@ -2473,7 +2818,8 @@ int PrimaryLogPG::do_manifest_flush(OpRequestRef op, ObjectContextRef obc, Flush
 	    sha1_digest_t sha1r = chunk_data.sha1();
 	    object_t fp_oid = sha1r.to_str();
 	    bufferlist in;
-	    if (fp_oid != tgt_soid.oid) {
+	    // the chunks cut_dirty_chunks() made have no target to put yet
+	    if (fp_oid != tgt_soid.oid && !tgt_soid.oid.name.empty()) {
 	      // decrement old chunk's reference count 
 	      ObjectOperation dec_op;
 	      cls_chunk_refcount_put_op put_call;
@@ -2541,9 +2887,9 @@ void PrimaryLogPG::finish_manifest_flush(hobject_t oid, ceph_tid_t tid, int r,
     return;
   }
   map<uint64_t, chunk_info_t>::iterator iter = 
-      obc->obs.oi.manifest.chunk_map.find(last_offset); 
-  ceph_assert(iter != obc->obs.oi.manifest.chunk_map.end());
-  for (;iter != obc->obs.oi.manifest.chunk_map.end(); ++iter) {
+      p->second->chunk_map.find(last_offset); 
+  ceph_assert(iter != p->second->chunk_map.end());
+  for (;iter != p->second->chunk_map.end(); ++iter) {
     if (iter->second.is_dirty() && last_offset < iter->first) {
       do_manifest_flush(p->second->op, obc, p->second, iter->first, p->second->blocking);
       return;
@@ -4002,12 +4348,13 @@ void PrimaryLogPG::log_op_stats(const OpRequest& op,
 void PrimaryLogPG::set_dynamic_perf_stats_queries(
     const std::list<OSDPerfMetricQuery> &queries)
 {
-  m_dynamic_perf_stats.set_queries(queries);
+  m_dynamic_perf_stats.set_queries(
+    queries, cct->_conf.get_val<uint64_t>("osd_perf_query_sample_interval"));
 }
 
 void PrimaryLogPG::get_dynamic_perf_stats(DynamicPerfStats *stats)
 {
-  std::swap(m_dynamic_perf_stats, *stats);
+  m_dynamic_perf_stats.swap_data(stats);
 }
 
 void PrimaryLogPG::do_scan(
@@ -4194,7 +4541,6 @@ void PrimaryLogPG::do_backfill_remove(OpRequestRef op)
 int PrimaryLogPG::trim_object(
   bool first, const hobject_t &coid, PrimaryLogPG::OpContextUPtr *ctxp)
 {
-  *ctxp = NULL;
 
   // load clone info
   bufferlist bl;
@@ -4253,30 +4599,40 @@ int PrimaryLogPG::trim_object(
     }
   }
 
-  OpContextUPtr ctx = simple_opc_create(obc);
-  ctx->head_obc = head_obc;
-
-  if (!ctx->lock_manager.get_snaptrimmer_write(
+  ObcLockManager lock_manager;
+  if (!lock_manager.get_snaptrimmer_write(
 	coid,
 	obc,
 	first)) {
-    close_op_ctx(ctx.release());
     dout(10) << __func__ << ": Unable to get a wlock on " << coid << dendl;
     return -ENOLCK;
   }
 
-  if (!ctx->lock_manager.get_snaptrimmer_write(
+  if (!lock_manager.get_snaptrimmer_write(
 	head_oid,
 	head_obc,
 	first)) {
-    close_op_ctx(ctx.release());
+    release_object_locks(lock_manager);
     dout(10) << __func__ << ": Unable to get a wlock on " << head_oid << dendl;
     return -ENOLCK;
   }
 
-  ctx->at_version = get_next_version();
+  // start a new op, or add this clone to the batch already in *ctxp
+  OpContext *ctx;
+  if (!*ctxp) {
+    *ctxp = simple_opc_create(obc);
+    ctx = ctxp->get();
+    ctx->head_obc = head_obc;
+    ctx->at_version = get_next_version();
+  } else {
+    ctx = ctxp->get();
+    ctx->at_version.version++;
+  }
+  ctx->lock_manager.splice(std::move(lock_manager));
 
   PGTransaction *t = ctx->op_t.get();
+  t->add_obc(obc);
+  t->add_obc(head_obc);
  
   if (new_snaps.empty()) {
     // remove clone
@@ -4331,7 +4687,7 @@ int PrimaryLogPG::trim_object(
 	pg_log_entry_t::DELETE,
 	coid,
 	ctx->at_version,
-	ctx->obs->oi.version,
+	coi.version,
 	0,
 	osd_reqid_t(),
 	ctx->mtime,
@@ -4454,7 +4810,6 @@ int PrimaryLogPG::trim_object(
     t->setattrs(head_oid, attrs);
   }
 
-  *ctxp = std::move(ctx);
   return 0;
 }
 
@@ -6196,12 +6551,16 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
       {
 	uint32_t timeout;
         bufferlist bl;
+	uint32_t flags = 0;
 
 	try {
 	  uint32_t ver; // obsolete
           decode(ver, bp);
 	  decode(timeout, bp);
           decode(bl, bp);
+	  if (!bp.end()) {
+	    decode(flags, bp);
+	  }
 	} catch (const buffer::error &e) {
 	  timeout = 0;
 	}
@@ -6213,6 +6572,7 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	n.timeout = timeout;
 	n.notify_id = osd->get_next_id(get_osdmap_epoch());
 	n.cookie = op.watch.cookie;
+	n.flags = flags;
         n.bl = bl;
 	ctx->notifies.push_back(n);
 
@@ -7199,8 +7559,13 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	uint32_t num = 0;
 	bool truncated = false;
 	if (oi.is_omap()) {
+	  ObjectStore::omap_iter_hints_t hints;
+	  if (max_return >= 64) {
+	    hints.readahead =
+	      static_cast<Option::size_t>(osd->osd_omap_scan_readahead);
+	  }
 	  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
-	    ch, ghobject_t(soid)
+	    ch, ghobject_t(soid), hints
 	    );
 	  ceph_assert(iter);
 	  iter->upper_bound(start_after);
@@ -7242,35 +7607,19 @@ int PrimaryLogPG::do_osd_ops(OpContext *ctx, vector<OSDOp>& ops)
 	}
 	tracepoint(osd, do_osd_op_pre_omapgetvals, soid.oid.name.c_str(), soid.snap.val, start_after.c_str(), max_return, filter_prefix.c_str());
 
-	uint32_t num = 0;
 	bool truncated = false;
-	bufferlist bl;
+	map<string, bufferlist> vals;
 	if (oi.is_omap()) {
-	  ObjectMap::ObjectMapIterator iter = osd->store->get_omap_iterator(
-	    ch, ghobject_t(soid)
-	    );
-          if (!iter) {
-            result = -ENOENT;
-            goto fail;
-          }
-	  iter->upper_bound(start_after);
-	  if (filter_prefix > start_after) iter->lower_bound(filter_prefix);
-	  for (num = 0;
-	       iter->valid() &&
-		 iter->key().substr(0, filter_prefix.size()) == filter_prefix;
-	       ++num, iter->next()) {
-	    dout(20) << "Found key " << iter->key() << dendl;
-	    if (num >= max_return ||
-		bl.length() >= cct->_conf->osd_max_omap_bytes_per_request) {
-	      truncated = true;
-	      break;
-	    }
-	    encode(iter->key(), bl);
-	    encode(iter->value(), bl);
+	  uint64_t bytes;
+	  result = do_omap_get_vals(
+	    soid, oi.version, start_after, filter_prefix, max_return,
+	    cct->_conf->osd_max_omap_bytes_per_request,
+	    &vals, &bytes, &truncated);
+	  if (result < 0) {
+	    goto fail;
 	  }
 	} // else return empty out_set
-	encode(num, osd_op.outdata);
-	osd_op.outdata.claim_append(bl);
+	encode(vals, osd_op.outdata);
 	encode(truncated, osd_op.outdata);
 	ctx->delta_stats.num_rd_kb += shift_round_up(osd_op.outdata.length(), 10);
 	ctx->delta_stats.num_rd++;
@@ -8188,6 +8537,7 @@ void PrimaryLogPG::do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn)
 	p->cookie,
 	p->notify_id,
 	ctx->obc->obs.oi.user_version,
+	p->flags & CEPH_OSD_NOTIFY_FLAG_NO_ACK,
 	osd));
     for (map<pair<uint64_t, entity_name_t>, WatchRef>::iterator i =
 	   ctx->obc->watchers.begin();
@@ -8299,6 +8649,11 @@ int PrimaryLogPG::prepare_transaction(OpContext *ctx)
   }
 
   const hobject_t& soid = ctx->obs->oi.soid;
+  // make_writeable trims modified_ranges to the clone overlap, so take
+  // what the log entry should carry first
+  interval_set<uint64_t> dirty_extents;
+  bool has_dirty_extents = get_dirty_extents(ctx, &dirty_extents);
+
   // clone, if necessary
   if (soid.snap == CEPH_NOSNAP)
     make_writeable(ctx);
@@ -8307,9 +8662,63 @@ int PrimaryLogPG::prepare_transaction(OpContext *ctx)
 	     ctx->new_obs.exists ? pg_log_entry_t::MODIFY :
 	     pg_log_entry_t::DELETE);
 
+  if (has_dirty_extents) {
+    pg_log_entry_t& e = ctx->log.back();
+    ceph_assert(e.soid == soid && e.is_modify());
+    e.has_dirty_extents = true;
+    e.dirty_extents.swap(dirty_extents);
+  }
+
   return result;
 }
 
+bool PrimaryLogPG::get_dirty_extents(OpContext *ctx,
+				     interval_set<uint64_t> *extents)
+{
+  if (!cct->_conf->osd_recovery_dirty_extents ||
+      !pool.info.is_replicated() ||
+      get_osdmap()->require_osd_release < CEPH_RELEASE_OCTOPUS ||
+      !ctx->obs->exists || !ctx->new_obs.exists ||
+      ctx->obs->oi.is_whiteout())
+    return false;
+
+  // only ops whose effect on the data is fully described by
+  // modified_ranges
+  for (auto& osd_op : *ctx->ops) {
+    switch (osd_op.op.op) {
+    case CEPH_OSD_OP_WRITE:
+    case CEPH_OSD_OP_WRITEFULL:
+    case CEPH_OSD_OP_APPEND:
+    case CEPH_OSD_OP_ZERO:
+    case CEPH_OSD_OP_TRUNCATE:
+    case CEPH_OSD_OP_CREATE:
+    case CEPH_OSD_OP_SETALLOCHINT:
+    case CEPH_OSD_OP_SETXATTR:
+    case CEPH_OSD_OP_RMXATTR:
+    case CEPH_OSD_OP_OMAPSETVALS:
+    case CEPH_OSD_OP_OMAPSETHEADER:
+    case CEPH_OSD_OP_OMAPCLEAR:
+    case CEPH_OSD_OP_OMAPRMKEYS:
+      break;
+    default:
+      if (ceph_osd_op_mode_modify(osd_op.op.op))
+	return false;
+    }
+  }
+
+  *extents = ctx->modified_ranges;
+  // writefull only notes what it overwrote, not what it appended
+  uint64_t old_size = ctx->obs->oi.size;
+  uint64_t new_size = ctx->new_obs.oi.size;
+  if (new_size > old_size) {
+    interval_set<uint64_t> grown;
+    grown.insert(old_size, new_size - old_size);
+    extents->union_of(grown);
+  }
+  dout(20) << __func__ << " " << ctx->obs->oi.soid << " " << *extents << dendl;
+  return true;
+}
+
 void PrimaryLogPG::finish_ctx(OpContext *ctx, int log_op_type)
 {
   const hobject_t& soid = ctx->obs->oi.soid;
@@ -10102,6 +10511,18 @@ int PrimaryLogPG::try_flush_mark_clean(FlushOpRef fop)
   if (fop->obc->obs.oi.has_manifest()) {
     ceph_assert(obc->obs.oi.manifest.is_chunked());
     PGTransaction* t = ctx->op_t.get();
+    ctx->new_obs.oi.manifest.chunk_map = fop->chunk_map;
+    if (!fop->old_chunk_targets.empty()) {
+      // the chunks cut_dirty_chunks() replaced are only unreferenced
+      // once the new chunk_map is committed
+      ctx->register_on_commit(
+	[targets=std::move(fop->old_chunk_targets), obc, this](){
+	for (auto& target : targets) {
+	  refcount_manifest(obc, object_locator_t(target), target,
+			    SnapContext(), false, NULL, 0);
+	}
+      });
+    }
     uint64_t chunks_size = 0;
     for (auto &p : ctx->new_obs.oi.manifest.chunk_map) {
       chunks_size += p.second.length;
@@ -10772,12 +11193,31 @@ ObjectContextRef PrimaryLogPG::get_object_context(
     dout(10) << __func__ << ": obc NOT found in cache: " << soid << dendl;
     // check disk
     bufferlist bv;
+    map<string, bufferlist> fetched;
+    bool have_fetched = false;
     if (attrs) {
       auto it_oi = attrs->find(OI_ATTR);
       ceph_assert(it_oi != attrs->end());
       bv = it_oi->second;
     } else {
-      int r = pgbackend->objects_get_attr(soid, OI_ATTR, &bv);
+      int r;
+      if (pool.info.is_erasure()) {
+	// the obc of an ec object caches all of its attrs anyway: read
+	// them in one go and take oi and the snapset from there too,
+	// rather than going to the store three times
+	r = pgbackend->objects_get_attrs(soid, &fetched);
+	if (r >= 0) {
+	  auto it_oi = fetched.find(OI_ATTR);
+	  if (it_oi == fetched.end()) {
+	    r = -ENOENT;
+	  } else {
+	    bv = it_oi->second;
+	    have_fetched = true;
+	  }
+	}
+      } else {
+	r = pgbackend->objects_get_attr(soid, OI_ATTR, &bv);
+      }
       if (r < 0) {
 	if (!can_create) {
 	  dout(10) << __func__ << ": no obc for soid "
@@ -10820,9 +11260,14 @@ ObjectContextRef PrimaryLogPG::get_object_context(
     obc->obs.oi = oi;
     obc->obs.exists = true;
 
-    obc->ssc = get_snapset_context(
-      soid, true,
-      soid.has_snapset() ? attrs : 0);
+    const map<string, bufferlist> *ss_attrs = nullptr;
+    if (soid.has_snapset()) {
+      if (attrs)
+	ss_attrs = attrs;
+      else if (have_fetched && fetched.count(SS_ATTR))
+	ss_attrs = &fetched;
+    }
+    obc->ssc = get_snapset_context(soid, true, ss_attrs);
 
     if (is_active())
       populate_obc_watchers(obc);
@@ -10830,6 +11275,8 @@ ObjectContextRef PrimaryLogPG::get_object_context(
     if (pool.info.is_erasure()) {
       if (attrs) {
 	obc->attr_cache = *attrs;
+      } else if (have_fetched) {
+	obc->attr_cache = std::move(fetched);
       } else {
 	int r = pgbackend->objects_get_attrs(
 	  soid,
@@ -11844,6 +12291,7 @@ void PrimaryLogPG::on_shutdown()
 
   context_registry_on_change();
   object_contexts.clear();
+  clear_omap_cursors();
 
   clear_async_reads();
 
@@ -12013,6 +12461,7 @@ void PrimaryLogPG::on_change(ObjectStore::Transaction *t)
   // do this *after* apply_and_flush_repops so that we catch any newly
   // registered watches.
   context_registry_on_change();
+  clear_omap_cursors();
 
   pgbackend->on_change_cleanup(t);
   scrubber.cleanup_store(t);
@@ -12777,6 +13226,11 @@ uint64_t PrimaryLogPG::recover_backfill(
   }
   backfill_info.trim_to(last_backfill_started);
 
+  // small objects ride along with the recovery op of the object pushed
+  // before them until they add up to osd_recovery_batch_bytes, as long as
+  // osd_recovery_max_active has room for them
+  uint64_t batch_max = cct->_conf->osd_recovery_batch_bytes;
+  uint64_t batch_bytes = batch_max;
   PGBackend::RecoveryHandle *h = pgbackend->open_recovery_op();
   while (ops < max) {
     if (backfill_info.begin <= earliest_peer_backfill() &&
@@ -12914,14 +13368,30 @@ uint64_t PrimaryLogPG::recover_backfill(
 	  vector<pg_shard_t> all_push = need_ver_targs;
 	  all_push.insert(all_push.end(), missing_targs.begin(), missing_targs.end());
 
+	  // count at least a block for each, so empty objects are bounded too.
+	  // a batched object still takes a recovery op out of
+	  // osd_recovery_max_active, just not one of those reserved for us
+	  uint64_t bytes = std::max<uint64_t>(obc->obs.oi.size, CEPH_PAGE_SIZE);
+	  bool batched = batch_bytes + bytes <= batch_max &&
+	    osd->reserve_extra_push();
+
 	  handle.reset_tp_timeout();
 	  int r = prep_backfill_object_push(backfill_info.begin, obj_v, obc, all_push, h);
+	  if (batched) {
+	    // it's counted as an active recovery op now
+	    osd->release_reserved_pushes(1);
+	  }
 	  if (r < 0) {
 	    *work_started = true;
 	    dout(0) << __func__ << " Error " << r << " trying to backfill " << backfill_info.begin << dendl;
 	    break;
 	  }
-	  ops++;
+	  if (batched) {
+	    batch_bytes += bytes;
+	  } else {
+	    ops++;
+	    batch_bytes = bytes;
+	  }
 	} else {
 	  *work_started = true;
 	  dout(20) << "backfill blocking on " << backfill_info.begin
@@ -13283,6 +13753,15 @@ hobject_t PrimaryLogPG::get_hit_set_archive_object(utime_t start,
   return hoid;
 }
 
+bool PrimaryLogPG::hit_set_sample()
+{
+  const double ratio = osd->osd_hit_set_sample_ratio;
+  if (ratio >= 1.0) {
+    return true;
+  }
+  return ceph::util::generate_random_number(0.0, 1.0) < ratio;
+}
+
 void PrimaryLogPG::hit_set_clear()
 {
   dout(20) << __func__ << dendl;
@@ -13628,6 +14107,13 @@ void PrimaryLogPG::agent_setup()
       rand()));
     agent_state->start = agent_state->position;
 
+    auto sketch_size =
+      cct->_conf.get_val<uint64_t>("osd_agent_temp_sketch_size");
+    if (sketch_size) {
+      agent_state->temp_sketch.reset(new TemperatureSketch(sketch_size));
+      agent_state->temp_sketch_stamp = ceph_clock_now();
+    }
+
     dout(10) << __func__ << " allocated new state, position "
 	     << agent_state->position << dendl;
   } else {
@@ -13772,6 +14258,16 @@ bool PrimaryLogPG::agent_work(int start_max, int agent_flush_quota)
     agent_state->hist_age = 0;
     agent_state->temp_hist.decay();
   }
+  if (agent_state->temp_sketch) {
+    utime_t now = ceph_clock_now();
+    utime_t halflife(cct->_conf.get_val<uint64_t>(
+      "osd_agent_temp_sketch_halflife"), 0);
+    if (agent_state->temp_sketch_stamp + halflife <= now) {
+      dout(20) << __func__ << " decaying temp sketch" << dendl;
+      agent_state->temp_sketch->decay();
+      agent_state->temp_sketch_stamp = now;
+    }
+  }
 
   // Total objects operated on so far
   int total_started = agent_state->started + started;
@@ -13820,6 +14316,11 @@ void PrimaryLogPG::agent_load_hit_sets()
   if (agent_state->evict_mode == TierAgentState::EVICT_MODE_IDLE) {
     return;
   }
+  if (agent_state->temp_sketch) {
+    // temperatures come from the sketch, only the ones persisted since
+    // are kept for the promotion recency
+    return;
+  }
 
   if (agent_state->hit_set_map.size() < info.hit_set.history.size()) {
     dout(10) << __func__ << dendl;
@@ -13973,7 +14474,7 @@ bool PrimaryLogPG::agent_maybe_evict(ObjectContextRef& obc, bool after_flush)
     // is this object old and/or cold enough?
     int temp = 0;
     uint64_t temp_upper = 0, temp_lower = 0;
-    if (hit_set)
+    if (hit_set || agent_state->temp_sketch)
       agent_estimate_temp(soid, &temp);
     agent_state->temp_hist.add(temp);
     agent_state->temp_hist.get_position_micro(temp, &temp_lower, &temp_upper);
@@ -14303,8 +14804,12 @@ bool PrimaryLogPG::agent_choose_mode(bool restart, OpRequestRef op)
 
 void PrimaryLogPG::agent_estimate_temp(const hobject_t& oid, int *temp)
 {
-  ceph_assert(hit_set);
   ceph_assert(temp);
+  if (agent_state->temp_sketch) {
+    *temp = agent_state->temp_sketch->count(oid);
+    return;
+  }
+  ceph_assert(hit_set);
   *temp = 0;
   if (hit_set->contains(oid))
     *temp = 1000000;
@@ -15054,8 +15559,19 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
 
   ldout(pg->cct, 10) << "AwaitAsyncWork: trimming snap " << snap_to_trim << dendl;
 
+  // with batching, a round trims up to batch clones in one transaction
+  // and batch follows the latency of the rounds, never going below
+  // osd_pg_max_concurrent_snap_trims; otherwise each clone gets a
+  // transaction of its own
   vector<hobject_t> to_trim;
   unsigned max = pg->cct->_conf->osd_pg_max_concurrent_snap_trims;
+  unsigned max_batch = pg->cct->_conf->osd_snap_trim_max_batch;
+  unsigned min_batch = std::clamp(max, 1u, std::max(1u, max_batch));
+  auto &batch = context< SnapTrimmer >().batch;
+  if (max_batch) {
+    batch = std::clamp(batch ? batch : max, min_batch, max_batch);
+    max = batch;
+  }
   to_trim.reserve(max);
   int r = pg->snap_mapper.get_next_objects_to_trim(
     snap_to_trim,
@@ -15094,12 +15610,52 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
   }
   ceph_assert(!to_trim.empty());
 
+  OpContextUPtr ctx;
+  vector<hobject_t> in_ctx;
+  auto submit = [&]() {
+    auto start = ceph::mono_clock::now();
+    ctx->register_on_success(
+      [pg, objects = std::move(in_ctx), &in_flight, start, min_batch,
+       max_batch]() {
+	for (auto &object : objects) {
+	  ceph_assert(in_flight.find(object) != in_flight.end());
+	  in_flight.erase(object);
+	}
+	if (max_batch) {
+	  // grow the rounds while they commit within the target latency,
+	  // halve them (down to min_batch) when they do not
+	  auto &batch = pg->snap_trimmer_machine.batch;
+	  double lat = std::chrono::duration<double>(
+	    ceph::mono_clock::now() - start).count();
+	  if (lat > pg->cct->_conf->osd_snap_trim_target_latency) {
+	    batch = std::max(min_batch, batch / 2);
+	  } else if (objects.size() == batch) {
+	    batch = std::min(max_batch, batch + std::max(1u, batch / 4));
+	  }
+	}
+	if (in_flight.empty()) {
+	  if (pg->state_test(PG_STATE_SNAPTRIM_ERROR)) {
+	    pg->snap_trimmer_machine.process_event(Reset());
+	  } else {
+	    pg->snap_trimmer_machine.process_event(RepopsComplete());
+	  }
+	}
+      });
+    in_ctx.clear();
+    pg->simple_opc_submit(std::move(ctx));
+  };
+
   for (auto &&object: to_trim) {
     // Get next
     ldout(pg->cct, 10) << "AwaitAsyncWork react trimming " << object << dendl;
-    OpContextUPtr ctx;
+    if (ctx && !pg->can_batch_trim(ctx->obs->oi.soid, object)) {
+      submit();
+    }
     int error = pg->trim_object(in_flight.empty(), object, &ctx);
     if (error) {
+      if (ctx) {
+	submit();
+      }
       if (error == -ENOLCK) {
 	ldout(pg->cct, 10) << "could not get write lock on obj "
 			   << object << dendl;
@@ -15121,20 +15677,13 @@ boost::statechart::result PrimaryLogPG::AwaitAsyncWork::react(const DoSnapWork&)
     }
 
     in_flight.insert(object);
-    ctx->register_on_success(
-      [pg, object, &in_flight]() {
-	ceph_assert(in_flight.find(object) != in_flight.end());
-	in_flight.erase(object);
-	if (in_flight.empty()) {
-	  if (pg->state_test(PG_STATE_SNAPTRIM_ERROR)) {
-	    pg->snap_trimmer_machine.process_event(Reset());
-	  } else {
-	    pg->snap_trimmer_machine.process_event(RepopsComplete());
-	  }
-	}
-      });
-
-    pg->simple_opc_submit(std::move(ctx));
+    in_ctx.push_back(object);
+    if (!max_batch) {
+      submit();
+    }
+  }
+  if (ctx) {
+    submit();
   }
 
   return transit< WaitRepops >();
@@ -26,6 +26,7 @@
 #include "TierAgentState.h"
 #include "messages/MOSDOpReply.h"
 #include "common/Checksummer.h"
+#include "common/ThreadLocalPool.h"
 #include "common/sharedptr_registry.hpp"
 #include "common/shared_cache.hpp"
 #include "ReplicatedBackend.h"
@@ -249,6 +250,8 @@ public:
     map<uint64_t, int> io_results; 
     map<uint64_t, ceph_tid_t> io_tids; 
     uint64_t chunks;
+    map<uint64_t, chunk_info_t> chunk_map; ///< layout committed once flushed
+    set<hobject_t> old_chunk_targets; ///< put refs once chunk_map commits
 
     FlushOp()
       : flushed_version(0), objecter_tid(0), rval(0),
@@ -525,6 +528,13 @@ public:
 
   PerfCounters *get_logger() override;
 
+  void record_peer_read_latency(int peer, ceph::timespan lat) override {
+    osd->record_peer_read_latency(peer, lat);
+  }
+  double get_peer_read_latency(int peer) override {
+    return osd->get_peer_read_latency(peer);
+  }
+
   ceph_tid_t get_tid() override { return osd->get_tid(); }
 
   LogClientTemp clog_error() override { return osd->clog->error(); }
@@ -551,7 +561,7 @@ public:
   /*
    * Capture all object state associated with an in-progress read or write.
    */
-  struct OpContext {
+  struct OpContext : public ThreadLocalPool<OpContext> {
     OpRequestRef op;
     osd_reqid_t reqid;
     vector<OSDOp> *ops;
@@ -733,7 +743,7 @@ public:
   /*
    * State on the PG primary associated with the replicated mutation
    */
-  class RepGather {
+  class RepGather : public ThreadLocalPool<RepGather> {
   public:
     hobject_t hoid;
     OpRequestRef op;
@@ -950,6 +960,7 @@ protected:
   utime_t hit_set_start_stamp;    ///< time the current HitSet started recording
 
 
+  bool hit_set_sample();    ///< whether to record this access
   void hit_set_clear();     ///< discard any HitSet state
   void hit_set_setup();     ///< initialize HitSet state
   void hit_set_create();    ///< create a new HitSet
@@ -1159,6 +1170,7 @@ protected:
     object_info_t *poi);
   void execute_ctx(OpContext *ctx);
   void finish_ctx(OpContext *ctx, int log_op_type);
+  bool get_dirty_extents(OpContext *ctx, interval_set<uint64_t> *extents);
   void reply_ctx(OpContext *ctx, int err);
   void reply_ctx(OpContext *ctx, int err, eversion_t v, version_t uv);
   void make_writeable(OpContext *ctx);
@@ -1446,6 +1458,7 @@ protected:
 			uint64_t start_offset, bool block);
   int start_manifest_flush(OpRequestRef op, ObjectContextRef obc, bool blocking,
 			   boost::optional<std::function<void()>> &&on_flush);
+  void cut_dirty_chunks(FlushOpRef fop);
   void finish_manifest_flush(hobject_t oid, ceph_tid_t tid, int r, ObjectContextRef obc, 
 			     uint64_t last_offset);
   void handle_manifest_flush(hobject_t oid, ceph_tid_t tid, int r,
@@ -1464,7 +1477,9 @@ public:
 	       const PGPool &_pool,
 	       const map<string,string>& ec_profile,
 	       spg_t p);
-  ~PrimaryLogPG() override {}
+  ~PrimaryLogPG() override {
+    clear_omap_cursors();
+  }
 
   int do_command(
     cmdmap_t cmdmap,
@@ -1493,7 +1508,11 @@ public:
 
   void handle_backoff(OpRequestRef& op);
 
+  /// trim coid in a new op, or as part of the batch already in *ctxp
   int trim_object(bool first, const hobject_t &coid, OpContextUPtr *ctxp);
+  /// whether the trim of soid can go in the repop of the batch that
+  /// started with batched: soid and its head are sent to the same peers
+  bool can_batch_trim(const hobject_t &batched, const hobject_t &soid);
   void snap_trimmer(epoch_t e) override;
   void kick_snap_trim() override;
   void snap_trimmer_scrub_complete() override;
@@ -1507,6 +1526,34 @@ public:
   void do_osd_op_effects(OpContext *ctx, const ConnectionRef& conn);
 private:
   int do_scrub_ls(MOSDOp *op, OSDOp *osd_op);
+  /// sets waiting if it queued the op to be retried
+  int do_pg_omap_read(OpRequestRef op, MOSDOp *m, OSDOp *osd_op,
+		      bool *waiting);
+  int do_omap_get_vals(const hobject_t& soid, eversion_t version,
+		       const std::string& start_after,
+		       const std::string& filter_prefix, uint64_t max_return,
+		       uint64_t max_bytes,
+		       std::map<std::string, ceph::buffer::list> *vals,
+		       uint64_t *bytes, bool *truncated);
+
+  /// an omap iterator left positioned past the last key of a truncated
+  /// listing, for the listing to go on from without seeking
+  struct omap_cursor_t {
+    eversion_t version;  ///< of the object it iterates over
+    std::string filter_prefix;
+    ObjectMap::ObjectMapIterator iter;
+    ceph::coarse_mono_time expires;
+  };
+  /// by object and the last key the listing got
+  std::map<std::pair<hobject_t, std::string>, omap_cursor_t> omap_cursors;
+  ObjectMap::ObjectMapIterator take_omap_cursor(
+    const hobject_t& soid, eversion_t version,
+    const std::string& start_after, const std::string& filter_prefix);
+  void put_omap_cursor(
+    const hobject_t& soid, eversion_t version,
+    const std::string& last_key, const std::string& filter_prefix,
+    ObjectMap::ObjectMapIterator iter);
+  void clear_omap_cursors();
   hobject_t earliest_backfill() const;
   bool check_src_targ(const hobject_t& soid, const hobject_t& toid) const;
 
@@ -1587,6 +1634,8 @@ private:
   struct NotTrimming;
   struct SnapTrimmer : public boost::statechart::state_machine< SnapTrimmer, NotTrimming > {
     PrimaryLogPG *pg;
+    /// clones per round when batching, adapted to the round latency
+    unsigned batch = 0;
     explicit SnapTrimmer(PrimaryLogPG *pg) : pg(pg) {}
     void log_enter(const char *state_name);
     void log_exit(const char *state_name, utime_t duration);
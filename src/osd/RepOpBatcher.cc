@@ -0,0 +1,132 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "RepOpBatcher.h"
+#include "common/Thread.h"
+#include "common/debug.h"
+#include "messages/MOSDRepOpBatch.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix *_dout << "repop_batcher "
+
+void RepOpBatcher::start()
+{
+  flusher = make_named_thread("osd_repop_batch",
+			      &RepOpBatcher::flusher_entry, this);
+}
+
+void RepOpBatcher::stop()
+{
+  {
+    std::lock_guard l(lock);
+    stopping = true;
+    cond.notify_all();
+  }
+  if (flusher.joinable()) {
+    flusher.join();
+  }
+  std::lock_guard l(lock);
+  for (auto& [con, b] : pending) {
+    _send(con, b);
+  }
+  pending.clear();
+  num_pending = 0;
+}
+
+void RepOpBatcher::_send(const ConnectionRef& con, batch_t& b)
+{
+  dout(20) << __func__ << " " << b.ops.size() << " ops " << b.bytes
+	   << " bytes to " << con->get_peer_addr() << dendl;
+  if (b.ops.size() == 1) {
+    con->send_message(b.ops.front());
+    b.ops.clear();
+  } else if (!b.ops.empty()) {
+    con->send_message(new MOSDRepOpBatch(std::move(b.ops)));
+    b.ops.clear();
+  }
+  b.bytes = 0;
+}
+
+void RepOpBatcher::queue(const ConnectionRef& con, Message *m)
+{
+  uint64_t window = window_us;
+  if (!window && !num_pending) {
+    // batching is off and nothing is left from when it was on
+    con->send_message(m);
+    return;
+  }
+  std::lock_guard l(lock);
+  if (!window || stopping) {
+    auto p = pending.find(con);
+    if (p != pending.end()) {
+      _send(con, p->second);
+      pending.erase(p);
+      num_pending = pending.size();
+    }
+    con->send_message(m);
+    return;
+  }
+  auto [p, inserted] = pending.try_emplace(con);
+  batch_t& b = p->second;
+  if (inserted) {
+    num_pending = pending.size();
+  }
+  if (b.ops.empty()) {
+    b.deadline = ceph::mono_clock::now() + std::chrono::microseconds(window);
+    cond.notify_one();
+  }
+  b.ops.push_back(m);
+  // the payload isn't encoded yet; the transaction is most of the bytes
+  b.bytes += m->get_data().length();
+  if (b.ops.size() >= max_ops || b.bytes >= static_cast<Option::size_t>(max_bytes)) {
+    _send(con, b);
+    pending.erase(p);
+    num_pending = pending.size();
+  }
+}
+
+void RepOpBatcher::_flush(Connection *con)
+{
+  std::lock_guard l(lock);
+  auto p = pending.find(ConnectionRef(con));
+  if (p != pending.end()) {
+    _send(p->first, p->second);
+    pending.erase(p);
+    num_pending = pending.size();
+  }
+}
+
+void RepOpBatcher::flusher_entry()
+{
+  std::unique_lock l(lock);
+  while (!stopping) {
+    auto now = ceph::mono_clock::now();
+    auto next = ceph::mono_time::max();
+    for (auto p = pending.begin(); p != pending.end(); ) {
+      if (p->second.deadline <= now) {
+	_send(p->first, p->second);
+	p = pending.erase(p);
+      } else {
+	next = std::min(next, p->second.deadline);
+	++p;
+      }
+    }
+    num_pending = pending.size();
+    if (next == ceph::mono_time::max()) {
+      cond.wait(l);
+    } else {
+      cond.wait_for(l, next - now);
+    }
+  }
+}
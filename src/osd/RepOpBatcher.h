@@ -0,0 +1,86 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OSD_REPOPBATCHER_H
+#define CEPH_OSD_REPOPBATCHER_H
+
+#include <atomic>
+#include <map>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_context.h"
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "common/config_cacher.h"
+#include "msg/Connection.h"
+
+class Message;
+
+/**
+ * Coalesces MOSDRepOps headed for the same peer into MOSDRepOpBatch
+ * messages.  A batch goes out when it reaches osd_repop_batch_max_ops or
+ * osd_repop_batch_max_bytes, when it has waited osd_repop_batch_window_us,
+ * or when some other message is sent to the same connection (so the
+ * order of everything sent to a peer is kept).
+ */
+class RepOpBatcher {
+  CephContext *cct;
+  md_config_cacher_t<uint64_t> window_us;
+  md_config_cacher_t<uint64_t> max_ops;
+  md_config_cacher_t<Option::size_t> max_bytes;
+
+  struct batch_t {
+    std::vector<Message*> ops;
+    uint64_t bytes = 0;
+    ceph::mono_time deadline;
+  };
+
+  ceph::mutex lock = ceph::make_mutex("RepOpBatcher::lock");
+  ceph::condition_variable cond;
+  std::map<ConnectionRef, batch_t> pending;
+  std::atomic<unsigned> num_pending = {0};  ///< pending.size(), for flush()
+  bool stopping = false;
+  std::thread flusher;
+
+  /// send one batch; called with lock held so batches leave in order
+  void _send(const ConnectionRef& con, batch_t& b);
+  void flusher_entry();
+
+public:
+  explicit RepOpBatcher(CephContext *cct)
+    : cct(cct),
+      window_us(cct->_conf, "osd_repop_batch_window_us"),
+      max_ops(cct->_conf, "osd_repop_batch_max_ops"),
+      max_bytes(cct->_conf, "osd_repop_batch_max_bytes") {}
+  ~RepOpBatcher() {
+    ceph_assert(pending.empty());
+  }
+
+  void start();
+  /// send whatever is still queued and stop the flusher
+  void stop();
+
+  /// send m (a MOSDRepOp) to con, possibly batched; consumes the ref
+  void queue(const ConnectionRef& con, Message *m);
+  /// send anything queued for con ahead of a message about to go there
+  void flush(Connection *con) {
+    if (num_pending) {
+      _flush(con);
+    }
+  }
+
+private:
+  void _flush(Connection *con);
+};
+
+#endif
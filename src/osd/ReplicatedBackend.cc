@@ -611,13 +611,14 @@ int ReplicatedBackend::be_deep_scrub(
       pos.data_hash = bufferhash(-1);
     }
 
-    bufferlist bl;
-    r = store->read(
+    uint32_t crc;
+    r = store->read_crc32c(
       ch,
       ghobject_t(
 	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
       pos.data_pos,
-      cct->_conf->osd_deep_scrub_stride, bl,
+      cct->_conf->osd_deep_scrub_stride,
+      pos.data_hash.digest(), &crc,
       fadvise_flags);
     if (r < 0) {
       dout(20) << __func__ << "  " << poid << " got "
@@ -626,9 +627,10 @@ int ReplicatedBackend::be_deep_scrub(
       return 0;
     }
     if (r > 0) {
-      pos.data_hash << bl;
+      pos.data_hash = bufferhash(crc);
     }
     pos.data_pos += r;
+    pos.bytes_read += r;
     if (r == cct->_conf->osd_deep_scrub_stride) {
       dout(20) << __func__ << "  " << poid << " more data, digest so far 0x"
 	       << std::hex << pos.data_hash.digest() << std::dec << dendl;
@@ -680,6 +682,7 @@ int ReplicatedBackend::be_deep_scrub(
   while (iter->status() == 0 && iter->valid()) {
     pos.omap_bytes += iter->value().length();
     ++pos.omap_keys;
+    pos.bytes_read += iter->key().length() + iter->value().length();
     --max;
     // fixme: we can do this more efficiently.
     bufferlist bl;
@@ -1452,6 +1455,8 @@ int ReplicatedBackend::prep_push_to_replica(
       get_parent()->get_shard_info().find(peer)->second.last_backfill,
       data_subset, clone_subsets,
       lock_manager);
+    if (clone_subsets.empty())
+      calc_dirty_subsets(obc, soid, peer, data_subset, clone_subsets);
   }
 
   return prep_push(
@@ -1466,6 +1471,65 @@ int ReplicatedBackend::prep_push_to_replica(
     std::move(lock_manager));
 }
 
+/**
+ * calc_dirty_subsets
+ *
+ * If the peer has an older version of head and the log says which
+ * ranges changed since then, push only those: the peer updates its
+ * copy in place, keeping the rest (clone_subset[head]).  A push of
+ * more than one round updates a clone of the peer's copy instead.
+ * Objects with omap are still pushed whole.
+ */
+bool ReplicatedBackend::calc_dirty_subsets(
+  ObjectContextRef obc, const hobject_t& head, pg_shard_t peer,
+  interval_set<uint64_t>& data_subset,
+  map<hobject_t, interval_set<uint64_t>>& clone_subsets)
+{
+  const object_info_t& oi = obc->obs.oi;
+  if (!cct->_conf->osd_recovery_dirty_extents ||
+      get_osdmap()->require_osd_release < CEPH_RELEASE_OCTOPUS ||
+      oi.is_omap() ||
+      !obc->ssc->snapset.clones.empty())
+    return false;
+
+  auto pm = get_parent()->maybe_get_shard_missing(peer);
+  if (!pm)
+    return false;
+  auto mi = pm->get_items().find(head);
+  if (mi == pm->get_items().end() ||
+      mi->second.is_delete() ||
+      mi->second.have == eversion_t())
+    return false;
+  const eversion_t& have = mi->second.have;
+
+  const auto& log = get_parent()->get_log().get_log();
+  if (have < log.tail)
+    return false;
+  interval_set<uint64_t> dirty;
+  for (auto p = log.log.rbegin();
+       p != log.log.rend() && p->version > have;
+       ++p) {
+    if (p->soid != head)
+      continue;
+    if (!p->is_modify() || !p->has_dirty_extents)
+      return false;
+    dirty.union_of(p->dirty_extents);
+  }
+
+  interval_set<uint64_t> whole;
+  if (oi.size)
+    whole.insert(0, oi.size);
+  interval_set<uint64_t> push;
+  push.intersection_of(dirty, whole);
+
+  whole.subtract(push);
+  dout(10) << __func__ << " " << head << " " << have << " -> " << oi.version
+	   << " pushing " << push << " of " << oi.size << dendl;
+  data_subset.swap(push);
+  clone_subsets[head].swap(whole);
+  return true;
+}
+
 int ReplicatedBackend::prep_push(ObjectContextRef obc,
 			     const hobject_t& soid, pg_shard_t peer,
 			     PushOp *pop, bool cache_dont_need)
@@ -1527,6 +1591,9 @@ void ReplicatedBackend::submit_push_data(
   const map<string, bufferlist> &omap_entries,
   ObjectStore::Transaction *t)
 {
+  // updating our existing copy in place? (see calc_dirty_subsets)
+  bool in_place = recovery_info.clone_subset.count(recovery_info.soid);
+
   hobject_t target_oid;
   if (first && complete) {
     target_oid = recovery_info.soid;
@@ -1540,7 +1607,23 @@ void ReplicatedBackend::submit_push_data(
     }
   }
 
-  if (first) {
+  if (first && in_place) {
+    if (target_oid != recovery_info.soid) {
+      // the push takes more than one round: update a copy, which
+      // replaces ours once complete
+      t->remove(coll, ghobject_t(target_oid));
+      t->clone(coll, ghobject_t(recovery_info.soid), ghobject_t(target_oid));
+    }
+    t->truncate(coll, ghobject_t(target_oid), recovery_info.size);
+    t->rmattrs(coll, ghobject_t(target_oid));
+    t->omap_clear(coll, ghobject_t(target_oid));
+    // dirty ranges the primary found to be holes aren't in the push
+    interval_set<uint64_t> included, holes = recovery_info.copy_subset;
+    included.intersection_of(intervals_included, holes);
+    holes.subtract(included);
+    for (auto p = holes.begin(); p != holes.end(); ++p)
+      t->zero(coll, ghobject_t(target_oid), p.get_start(), p.get_len());
+  } else if (first) {
     t->remove(coll, ghobject_t(target_oid));
     t->touch(coll, ghobject_t(target_oid));
     t->truncate(coll, ghobject_t(target_oid), recovery_info.size);
@@ -1613,6 +1696,8 @@ void ReplicatedBackend::submit_push_complete(
 	 recovery_info.clone_subset.begin();
        p != recovery_info.clone_subset.end();
        ++p) {
+    if (p->first == recovery_info.soid)
+      continue;  // kept in place
     for (interval_set<uint64_t>::const_iterator q = p->second.begin();
 	 q != p->second.end();
 	 ++q) {
@@ -1820,7 +1905,8 @@ void ReplicatedBackend::send_pushes(int prio, map<pg_shard_t, vector<PushOp> > &
       for (;
            (j != i->second.end() &&
 	    cost < cct->_conf->osd_max_push_cost &&
-	    pushes < cct->_conf->osd_max_push_objects) ;
+	    (!cct->_conf->osd_max_push_objects ||
+	     pushes < cct->_conf->osd_max_push_objects)) ;
 	   ++j) {
 	dout(20) << __func__ << ": sending push " << *j
 		 << " to osd." << i->first << dendl;
@@ -1880,12 +1966,7 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
   eversion_t v  = recovery_info.version;
   object_info_t oi;
   if (progress.first) {
-    int r = store->omap_get_header(ch, ghobject_t(recovery_info.soid), &out_op->omap_header);
-    if(r < 0) {
-      dout(1) << __func__ << " get omap header failed: " << cpp_strerror(-r) << dendl; 
-      return r;
-    }
-    r = store->getattrs(ch, ghobject_t(recovery_info.soid), out_op->attrset);
+    int r = store->getattrs(ch, ghobject_t(recovery_info.soid), out_op->attrset);
     if(r < 0) {
       dout(1) << __func__ << " getattrs failed: " << cpp_strerror(-r) << dendl;
       return r;
@@ -1913,6 +1994,17 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
       return -EINVAL;
     }
 
+    // most small objects have no omap; skip looking for it
+    if (oi.is_omap()) {
+      r = store->omap_get_header(ch, ghobject_t(recovery_info.soid), &out_op->omap_header);
+      if(r < 0) {
+	dout(1) << __func__ << " get omap header failed: " << cpp_strerror(-r) << dendl;
+	return r;
+      }
+    } else {
+      new_progress.omap_complete = true;
+    }
+
     new_progress.first = false;
   }
   // Once we provide the version subsequent requests will have it, so
@@ -1920,7 +2012,7 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
   ceph_assert(v != eversion_t());
 
   uint64_t available = cct->_conf->osd_recovery_max_chunk;
-  if (!progress.omap_complete) {
+  if (!new_progress.omap_complete) {
     ObjectMap::ObjectMapIterator iter =
       store->get_omap_iterator(ch,
 			       ghobject_t(recovery_info.soid));
@@ -1962,7 +2054,8 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
 
       out_op->data_included.span_of(copy_subset, progress.data_recovered_to,
                                     available);
-      if (out_op->data_included.empty()) // zero filled section, skip to end!
+      if (out_op->data_included.empty() || // zero filled section, skip to end!
+	  out_op->data_included.range_end() == copy_subset.range_end())
         new_progress.data_recovered_to = recovery_info.copy_subset.range_end();
       else
         new_progress.data_recovered_to = out_op->data_included.range_end();
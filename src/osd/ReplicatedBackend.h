@@ -317,6 +317,10 @@ private:
     interval_set<uint64_t>& data_subset,
     map<hobject_t, interval_set<uint64_t>>& clone_subsets,
     ObcLockManager &lock_manager);
+  bool calc_dirty_subsets(
+    ObjectContextRef obc, const hobject_t& head, pg_shard_t peer,
+    interval_set<uint64_t>& data_subset,
+    map<hobject_t, interval_set<uint64_t>>& clone_subsets);
   ObjectRecoveryInfo recalc_subsets(
     const ObjectRecoveryInfo& recovery_info,
     SnapSetContext *ssc,
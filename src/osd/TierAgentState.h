@@ -29,6 +29,10 @@ struct TierAgentState {
   /// past HitSet(s) (not current)
   map<time_t,HitSetRef> hit_set_map;
 
+  /// access counts to estimate temperatures from, if not the HitSets
+  std::unique_ptr<TemperatureSketch> temp_sketch;
+  utime_t temp_sketch_stamp;  ///< when it was last decayed
+
   /// a few recent things we've seen that are clean
   list<hobject_t> recent_clean;
 
@@ -111,6 +115,10 @@ struct TierAgentState {
     f->open_object_section("temp_hist");
     temp_hist.dump(f);
     f->close_section();
+    if (temp_sketch) {
+      f->dump_unsigned("temp_sketch_width", temp_sketch->get_width());
+      f->dump_stream("temp_sketch_stamp") << temp_sketch_stamp;
+    }
   }
 };
 
@@ -36,11 +36,13 @@ Notify::Notify(
   uint64_t cookie,
   uint64_t notify_id,
   uint64_t version,
+  bool no_ack,
   OSDService *osd)
   : client(client), client_gid(client_gid),
     complete(false),
     discarded(false),
     timed_out(false),
+    no_ack(no_ack),
     payload(payload),
     timeout(timeout),
     cookie(cookie),
@@ -58,13 +60,14 @@ NotifyRef Notify::makeNotifyRef(
   uint64_t cookie,
   uint64_t notify_id,
   uint64_t version,
+  bool no_ack,
   OSDService *osd) {
   NotifyRef ret(
     new Notify(
       client, client_gid,
       payload, timeout,
       cookie, notify_id,
-      version, osd));
+      version, no_ack, osd));
   ret->set_self(ret);
   return ret;
 }
@@ -182,7 +185,8 @@ void Notify::maybe_complete_notify()
   dout(10) << "maybe_complete_notify -- "
 	   << watchers.size()
 	   << " in progress watchers " << dendl;
-  if (watchers.empty() || timed_out) {
+  // with no_ack, the watchers left are the ones it couldn't be sent to
+  if (watchers.empty() || timed_out || no_ack) {
     // prepare reply
     bufferlist bl;
     encode(notify_replies, bl);
@@ -218,7 +222,9 @@ void Notify::discard()
 void Notify::init()
 {
   std::lock_guard l(lock);
-  register_cb();
+  if (!no_ack) {
+    register_cb();
+  }
   maybe_complete_notify();
 }
 
@@ -461,6 +467,15 @@ void Watch::start_notify(NotifyRef notif)
     }
   }
   dout(10) << "start_notify " << notif->notify_id << dendl;
+  if (notif->no_ack) {
+    // nothing to wait for, and not resent on reconnect; a watcher that
+    // isn't connected is reported as missed
+    if (connected())
+      send_notify(notif);
+    else
+      notif->start_watcher(self.lock());
+    return;
+  }
   in_progress_notifies[notif->notify_id] = notif;
   notif->start_watcher(self.lock());
   if (connected())
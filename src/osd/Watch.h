@@ -54,6 +54,7 @@ class Notify {
   bool complete;
   bool discarded;
   bool timed_out;  ///< true if the notify timed out
+  bool no_ack;     ///< complete once sent, without waiting for acks
   std::set<WatchRef> watchers;
 
   ceph::buffer::list payload;
@@ -88,6 +89,7 @@ class Notify {
     uint64_t cookie,
     uint64_t notify_id,
     uint64_t version,
+    bool no_ack,
     OSDService *osd);
 
   /// registers a timeout callback with the watch_timer
@@ -113,6 +115,7 @@ public:
     uint64_t cookie,
     uint64_t notify_id,
     uint64_t version,
+    bool no_ack,
     OSDService *osd);
 
   /// Call after creation to initialize
@@ -33,10 +33,11 @@ namespace ceph {
    * class mClockClientQueue
    */
 
-  mClockClientQueue::mClockClientQueue(CephContext *cct) :
+  mClockClientQueue::mClockClientQueue(CephContext *cct,
+				       bool rotational) :
     queue(std::bind(&mClockClientQueue::op_class_client_info_f, this, _1),
 	  cct->_conf->osd_op_queue_mclock_anticipation_timeout),
-    client_info_mgr(cct)
+    client_info_mgr(cct, rotational)
   {
     // empty
   }
@@ -78,7 +79,10 @@ namespace ceph {
 					 unsigned priority,
 					 unsigned cost,
 					 Request&& item) {
-    queue.enqueue(get_inner_client(cl, item), priority, 1u, std::move(item));
+    auto inner_client = get_inner_client(cl, item);
+    unsigned mclock_cost = client_info_mgr.get_cost(inner_client.second, cost);
+    queue.enqueue(std::move(inner_client), priority, mclock_cost,
+		  std::move(item));
   }
 
   // Enqueue the op in the front of the regular queue
@@ -86,7 +90,9 @@ namespace ceph {
 					       unsigned priority,
 					       unsigned cost,
 					       Request&& item) {
-    queue.enqueue_front(get_inner_client(cl, item), priority, 1u,
+    auto inner_client = get_inner_client(cl, item);
+    unsigned mclock_cost = client_info_mgr.get_cost(inner_client.second, cost);
+    queue.enqueue_front(std::move(inner_client), priority, mclock_cost,
 			std::move(item));
   }
 
@@ -49,7 +49,7 @@ namespace ceph {
 
   public:
 
-    mClockClientQueue(CephContext *cct);
+    mClockClientQueue(CephContext *cct, bool rotational);
 
     const crimson::dmclock::ClientInfo* op_class_client_info_f(const InnerClient& client);
 
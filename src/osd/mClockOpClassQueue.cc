@@ -33,10 +33,11 @@ namespace ceph {
    * class mClockOpClassQueue
    */
 
-  mClockOpClassQueue::mClockOpClassQueue(CephContext *cct) :
+  mClockOpClassQueue::mClockOpClassQueue(CephContext *cct,
+					 bool rotational) :
     queue(std::bind(&mClockOpClassQueue::op_class_client_info_f, this, _1),
 	  cct->_conf->osd_op_queue_mclock_anticipation_timeout),
-    client_info_mgr(cct)
+    client_info_mgr(cct, rotational)
   {
     // empty
   }
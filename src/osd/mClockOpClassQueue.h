@@ -47,7 +47,7 @@ namespace ceph {
 
   public:
 
-    mClockOpClassQueue(CephContext *cct);
+    mClockOpClassQueue(CephContext *cct, bool rotational);
 
     const crimson::dmclock::ClientInfo*
     op_class_client_info_f(const osd_op_type_t& op_type);
@@ -92,9 +92,10 @@ namespace ceph {
 			unsigned priority,
 			unsigned cost,
 			Request&& item) override final {
-      queue.enqueue(client_info_mgr.osd_op_type(item),
+      auto type = client_info_mgr.osd_op_type(item);
+      queue.enqueue(type,
 		    priority,
-		    1u,
+		    client_info_mgr.get_cost(type, cost),
 		    std::move(item));
     }
 
@@ -103,9 +104,10 @@ namespace ceph {
 			      unsigned priority,
 			      unsigned cost,
 			      Request&& item) override final {
-      queue.enqueue_front(client_info_mgr.osd_op_type(item),
+      auto type = client_info_mgr.osd_op_type(item);
+      queue.enqueue_front(type,
 			  priority,
-			  1u,
+			  client_info_mgr.get_cost(type, cost),
 			  std::move(item));
     }
 
@@ -23,7 +23,8 @@ namespace ceph {
 
   namespace mclock {
 
-    OpClassClientInfoMgr::OpClassClientInfoMgr(CephContext *cct) :
+    OpClassClientInfoMgr::OpClassClientInfoMgr(CephContext *cct,
+					       bool rotational) :
       client_op(cct->_conf->osd_op_queue_mclock_client_op_res,
 		cct->_conf->osd_op_queue_mclock_client_op_wgt,
 		cct->_conf->osd_op_queue_mclock_client_op_lim),
@@ -44,7 +45,10 @@ namespace ceph {
 	    cct->_conf->osd_op_queue_mclock_pg_delete_lim),
       peering_event(cct->_conf->osd_op_queue_mclock_peering_event_res,
 		    cct->_conf->osd_op_queue_mclock_peering_event_wgt,
-		    cct->_conf->osd_op_queue_mclock_peering_event_lim)
+		    cct->_conf->osd_op_queue_mclock_peering_event_lim),
+      cost_unit(cct->_conf.get_val<Option::size_t>(
+		  rotational ? "osd_op_queue_mclock_cost_unit_hdd" :
+		  "osd_op_queue_mclock_cost_unit_ssd"))
     {
       constexpr int rep_ops[] = {
 	MSG_OSD_REPOP,
@@ -67,6 +71,7 @@ namespace ceph {
 	"; snaptrim:" << snaptrim <<
 	"; recov:" << recov <<
 	"; scrub:" << scrub <<
+	"; cost_unit:" << cost_unit <<
 	dendl;
 
       lgeneric_subdout(cct, osd, 30) <<
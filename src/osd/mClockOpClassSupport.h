@@ -45,9 +45,25 @@ namespace ceph {
       std::bitset<rep_op_msg_bitset_size> rep_op_msg_bitset;
       void add_rep_op_msg(int message_code);
 
+      /// bytes an op transfers to cost as much as one more op; 0 if
+      /// every op costs the same
+      uint64_t cost_unit;
+
     public:
 
-      OpClassClientInfoMgr(CephContext *cct);
+      OpClassClientInfoMgr(CephContext *cct, bool rotational);
+
+      /// the mclock cost of an op of the given cost in bytes; only
+      /// client and replica ops pass a byte count, the background items'
+      /// costs are in other units and they are charged 1 each
+      inline unsigned get_cost(osd_op_type_t type, unsigned bytes) const {
+	if (!cost_unit ||
+	    (type != osd_op_type_t::client_op &&
+	     type != osd_op_type_t::osd_rep_op)) {
+	  return 1;
+	}
+	return 1 + bytes / cost_unit;
+      }
 
       inline const crimson::dmclock::ClientInfo*
       get_client_info(osd_op_type_t type) {
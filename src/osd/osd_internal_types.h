@@ -434,6 +434,15 @@ public:
     }
   }
 
+  /// take over the locks held by other
+  void splice(ObcLockManager &&other) {
+    for (auto& p : other.locks) {
+      ceph_assert(locks.find(p.first) == locks.end());
+    }
+    locks.insert(other.locks.begin(), other.locks.end());
+    other.locks.clear();
+  }
+
   void put_locks(
     list<pair<ObjectContextRef, list<OpRequestRef> > > *to_requeue,
     bool *requeue_recovery,
@@ -1194,7 +1194,13 @@ static opt_mapping_t opt_mapping = boost::assign::map_list_of
            ("target_size_ratio", pool_opts_t::opt_desc_t(
 	     pool_opts_t::TARGET_SIZE_RATIO, pool_opts_t::DOUBLE))
            ("pg_autoscale_bias", pool_opts_t::opt_desc_t(
-	     pool_opts_t::PG_AUTOSCALE_BIAS, pool_opts_t::DOUBLE));
+	     pool_opts_t::PG_AUTOSCALE_BIAS, pool_opts_t::DOUBLE))
+           ("alloc_unit", pool_opts_t::opt_desc_t(
+	     pool_opts_t::ALLOC_UNIT, pool_opts_t::INT))
+           ("dedup_chunk_algorithm", pool_opts_t::opt_desc_t(
+	     pool_opts_t::DEDUP_CHUNK_ALGORITHM, pool_opts_t::STR))
+           ("dedup_cdc_chunk_size", pool_opts_t::opt_desc_t(
+	     pool_opts_t::DEDUP_CDC_CHUNK_SIZE, pool_opts_t::INT));
 
 bool pool_opts_t::is_opt_name(const std::string& name)
 {
@@ -4307,7 +4313,7 @@ void pg_log_entry_t::decode_with_checksum(ceph::buffer::list::const_iterator& p)
 
 void pg_log_entry_t::encode(ceph::buffer::list &bl) const
 {
-  ENCODE_START(12, 4, bl);
+  ENCODE_START(13, 4, bl);
   encode(op, bl);
   encode(soid, bl);
   encode(version, bl);
@@ -4336,12 +4342,15 @@ void pg_log_entry_t::encode(ceph::buffer::list &bl) const
     encode(return_code, bl);
   if (!extra_reqids.empty())
     encode(extra_reqid_return_codes, bl);
+  encode(has_dirty_extents, bl);
+  if (has_dirty_extents)
+    encode(dirty_extents, bl);
   ENCODE_FINISH(bl);
 }
 
 void pg_log_entry_t::decode(ceph::buffer::list::const_iterator &bl)
 {
-  DECODE_START_LEGACY_COMPAT_LEN(12, 4, 4, bl);
+  DECODE_START_LEGACY_COMPAT_LEN(13, 4, 4, bl);
   decode(op, bl);
   if (struct_v < 2) {
     sobject_t old_soid;
@@ -4397,6 +4406,11 @@ void pg_log_entry_t::decode(ceph::buffer::list::const_iterator &bl)
     decode(return_code, bl);
   if (struct_v >= 12 && !extra_reqids.empty())
     decode(extra_reqid_return_codes, bl);
+  if (struct_v >= 13) {
+    decode(has_dirty_extents, bl);
+    if (has_dirty_extents)
+      decode(dirty_extents, bl);
+  }
   DECODE_FINISH(bl);
 }
 
@@ -4444,6 +4458,8 @@ void pg_log_entry_t::dump(Formatter *f) const
     mod_desc.dump(f);
     f->close_section();
   }
+  if (has_dirty_extents)
+    f->dump_stream("dirty_extents") << dirty_extents;
 }
 
 void pg_log_entry_t::generate_test_instances(list<pg_log_entry_t*>& o)
@@ -4456,6 +4472,11 @@ void pg_log_entry_t::generate_test_instances(list<pg_log_entry_t*>& o)
   o.push_back(new pg_log_entry_t(ERROR, oid, eversion_t(1,2), eversion_t(3,4),
 				 1, osd_reqid_t(entity_name_t::CLIENT(777), 8, 999),
 				 utime_t(8,9), -ENOENT));
+  o.push_back(new pg_log_entry_t(MODIFY, oid, eversion_t(1,2), eversion_t(3,4),
+				 1, osd_reqid_t(entity_name_t::CLIENT(777), 8, 999),
+				 utime_t(8,9), 0));
+  o.back()->has_dirty_extents = true;
+  o.back()->dirty_extents.insert(4096, 8192);
 }
 
 ostream& operator<<(ostream& out, const pg_log_entry_t& e)
@@ -4475,6 +4496,8 @@ ostream& operator<<(ostream& out, const pg_log_entry_t& e)
     }
     out << " snaps " << snaps;
   }
+  if (e.has_dirty_extents)
+    out << " dirty " << e.dirty_extents;
   return out;
 }
 
@@ -6345,6 +6368,7 @@ ostream& operator<<(ostream& out, const OSDOp& op)
       out << " " << utime_t(op.op.hit_set_get.stamp);
       break;
     case CEPH_OSD_OP_SCRUBLS:
+    case CEPH_OSD_OP_PG_OMAP_READ:
       break;
     }
   }
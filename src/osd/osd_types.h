@@ -1032,6 +1032,9 @@ public:
     TARGET_SIZE_BYTES,  // total bytes in pool
     TARGET_SIZE_RATIO,  // fraction of total cluster
     PG_AUTOSCALE_BIAS,
+    ALLOC_UNIT,         // preferred allocation unit for big writes
+    DEDUP_CHUNK_ALGORITHM, // how flush cuts dirty chunks of a manifest
+    DEDUP_CDC_CHUNK_SIZE,  // average size of the chunks it cuts
   };
 
   enum type_t {
@@ -3809,6 +3812,11 @@ struct pg_log_entry_t {
   bool invalid_hash; // only when decoding sobject_t based entries
   bool invalid_pool; // only when decoding pool-less hobject based entries
 
+  /// data ranges this MODIFY may have changed; if set, log-based
+  /// recovery of the object can push just those
+  bool has_dirty_extents = false;
+  interval_set<uint64_t> dirty_extents;
+
   pg_log_entry_t()
    : user_version(0), return_code(0), op(0),
      invalid_hash(false), invalid_pool(false) {
@@ -5018,6 +5026,7 @@ struct notify_info_t {
   uint64_t cookie;
   uint64_t notify_id;
   uint32_t timeout;
+  uint32_t flags = 0;  ///< CEPH_OSD_NOTIFY_FLAG_*
   ceph::buffer::list bl;
 };
 
@@ -5494,6 +5503,7 @@ struct ScrubMapBuilder {
   ceph::buffer::hash data_hash, omap_hash;  ///< accumulatinng hash value
   uint64_t omap_keys = 0;
   uint64_t omap_bytes = 0;
+  uint64_t bytes_read = 0;  ///< read from the store, not yet charged to the budget
 
   bool empty() {
     return ls.empty();
@@ -5812,6 +5822,107 @@ struct obj_list_snap_response_t {
 
 WRITE_CLASS_ENCODER(obj_list_snap_response_t)
 
+/*
+ * pg omap read: reads the omap of many objects of a PG in one op
+ *
+ */
+struct pg_omap_read_t {
+  object_t oid;
+  std::string key;          ///< locator key, if any
+  bool want_header = false;
+  std::string start_after;
+  std::string filter_prefix;
+  uint64_t max_return = 0;  ///< 0 to only read the header
+
+  void encode(ceph::buffer::list& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(oid, bl);
+    encode(key, bl);
+    encode(want_header, bl);
+    encode(start_after, bl);
+    encode(filter_prefix, bl);
+    encode(max_return, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(ceph::buffer::list::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(oid, bl);
+    decode(key, bl);
+    decode(want_header, bl);
+    decode(start_after, bl);
+    decode(filter_prefix, bl);
+    decode(max_return, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(ceph::Formatter *f) const {
+    f->dump_string("oid", oid.name);
+    f->dump_string("key", key);
+    f->dump_bool("want_header", want_header);
+    f->dump_string("start_after", start_after);
+    f->dump_string("filter_prefix", filter_prefix);
+    f->dump_unsigned("max_return", max_return);
+  }
+  static void generate_test_instances(std::list<pg_omap_read_t*>& o) {
+    o.push_back(new pg_omap_read_t);
+    o.push_back(new pg_omap_read_t);
+    o.back()->oid.name = "foo";
+    o.back()->key = "bar";
+    o.back()->want_header = true;
+    o.back()->start_after = "a";
+    o.back()->filter_prefix = "b";
+    o.back()->max_return = 10;
+  }
+};
+WRITE_CLASS_ENCODER(pg_omap_read_t)
+
+struct pg_omap_read_result_t {
+  int32_t rval = 0;         ///< -ENOENT if the object doesn't exist, etc.
+  ceph::buffer::list header;
+  std::map<std::string, ceph::buffer::list> vals;
+  bool truncated = false;   ///< there are more vals past the last one
+
+  void encode(ceph::buffer::list& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(rval, bl);
+    encode(header, bl);
+    encode(vals, bl);
+    encode(truncated, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(ceph::buffer::list::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(rval, bl);
+    decode(header, bl);
+    decode(vals, bl);
+    decode(truncated, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(ceph::Formatter *f) const {
+    f->dump_int("rval", rval);
+    f->dump_unsigned("header_length", header.length());
+    f->open_array_section("vals");
+    for (auto& [k, v] : vals) {
+      f->open_object_section("val");
+      f->dump_string("key", k);
+      f->dump_unsigned("length", v.length());
+      f->close_section();
+    }
+    f->close_section();
+    f->dump_bool("truncated", truncated);
+  }
+  static void generate_test_instances(std::list<pg_omap_read_result_t*>& o) {
+    o.push_back(new pg_omap_read_result_t);
+    o.push_back(new pg_omap_read_result_t);
+    o.back()->header.append("header");
+    o.back()->vals["a"].append("1");
+    o.back()->vals["b"].append("2");
+    o.back()->truncated = true;
+    o.push_back(new pg_omap_read_result_t);
+    o.back()->rval = -ENOENT;
+  }
+};
+WRITE_CLASS_ENCODER(pg_omap_read_result_t)
+
 // PromoteCounter
 
 struct PromoteCounter {
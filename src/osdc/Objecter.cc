@@ -1209,6 +1209,7 @@ void Objecter::handle_osd_map(MOSDMap *m)
 	else if (m->maps.count(e)) {
 	  ldout(cct, 3) << "handle_osd_map decoding full epoch " << e << dendl;
           OSDMap *new_osdmap = new OSDMap();
+          new_osdmap->set_client_only(osdmap->is_client_only());
           new_osdmap->decode(m->maps[e]);
 
           emit_blacklist_events(*osdmap, *new_osdmap);
@@ -3141,11 +3142,12 @@ void Objecter::_cancel_linger_op(Op *op)
   _finish_op(op, 0);
 }
 
-void Objecter::_finish_op(Op *op, int r)
+void Objecter::_finish_op(Op *op, int r, bool rwlocked)
 {
   ldout(cct, 15) << __func__ << " " << op->tid << dendl;
 
   // op->session->lock is locked unique or op->session is null
+  // rwlock is locked if rwlocked
 
   if (!op->ctx_budgeted && op->budget >= 0) {
     put_op_budget_bytes(op->budget);
@@ -3161,7 +3163,10 @@ void Objecter::_finish_op(Op *op, int r)
 
   logger->dec(l_osdc_op_active);
 
-  ceph_assert(check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
+  // an op that was found in an osd session is never waiting on a map
+  // check, so this is only checked where it is safe to look
+  ceph_assert(!rwlocked ||
+	      check_latest_map_ops.find(op->tid) == check_latest_map_ops.end());
 
   inflight_ops--;
 
@@ -3355,7 +3360,9 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   // get pio
   ceph_tid_t tid = m->get_tid();
 
-  shunique_lock sul(rwlock, ceph::acquire_shared);
+  // A reply only needs the session it came in on; the connection's
+  // priv holds a ref to it, and its lock guards the ops and s->con.
+  // rwlock is only taken for the rare replies that resubmit the op.
   if (!initialized) {
     m->put();
     return;
@@ -3364,13 +3371,19 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   ConnectionRef con = m->get_connection();
   auto priv = con->get_priv();
   auto s = static_cast<OSDSession*>(priv.get());
-  if (!s || s->con != con) {
+  if (!s) {
     ldout(cct, 7) << __func__ << " no session on con " << con << dendl;
     m->put();
     return;
   }
 
   OSDSession::unique_lock sl(s->lock);
+  if (s->con != con) {
+    ldout(cct, 7) << __func__ << " no session on con " << con << dendl;
+    sl.unlock();
+    m->put();
+    return;
+  }
 
   map<ceph_tid_t, Op *>::iterator iter = s->ops.find(tid);
   if (iter == s->ops.end()) {
@@ -3402,6 +3415,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     _session_op_remove(s, op);
     sl.unlock();
 
+    shunique_lock sul(rwlock, ceph::acquire_shared);
     _op_submit(op, sul, NULL);
     m->put();
     return;
@@ -3443,6 +3457,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     op->target.flags |= (CEPH_OSD_FLAG_REDIRECTED |
 			 CEPH_OSD_FLAG_IGNORE_CACHE |
 			 CEPH_OSD_FLAG_IGNORE_OVERLAY);
+    shunique_lock sul(rwlock, ceph::acquire_shared);
     _op_submit(op, sul, NULL);
     m->put();
     return;
@@ -3459,13 +3474,12 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     op->target.flags &= ~(CEPH_OSD_FLAG_BALANCE_READS |
 			  CEPH_OSD_FLAG_LOCALIZE_READS);
     op->target.pgid = pg_t();
+    shunique_lock sul(rwlock, ceph::acquire_shared);
     _op_submit(op, sul, NULL);
     m->put();
     return;
   }
 
-  sul.unlock();
-
   if (op->objver)
     *op->objver = m->get_user_version();
   if (op->reply_epoch)
@@ -3546,7 +3560,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
   auto completion_lock = s->get_lock(op->target.base_oid);
 
   ldout(cct, 15) << "handle_osd_op_reply completed tid " << tid << dendl;
-  _finish_op(op, 0);
+  _finish_op(op, 0, false);
 
   ldout(cct, 5) << num_in_flight << " in flight" << dendl;
 
@@ -5288,3 +5302,79 @@ void ::ObjectOperation::scrub_ls(const librados::object_id_t& start_after,
   scrub_ls_arg_t arg = {*interval, 1, start_after, max_to_get};
   do_scrub_ls(this, arg, snapsets, interval, rval);
 }
+
+namespace {
+  void convert(pg_omap_read_result_t&& from, pg_omap_read_result_t *to)
+  {
+    *to = std::move(from);
+  }
+
+  void convert(pg_omap_read_result_t&& from,
+	       librados::omap_read_result_t *to)
+  {
+    to->rval = from.rval;
+    to->header = std::move(from.header);
+    to->vals = std::move(from.vals);
+    to->more = from.truncated;
+  }
+
+  template <typename T>
+  struct C_ObjectOperation_pg_omap_read : public Context {
+    ceph::buffer::list bl;
+    std::vector<T> *results;
+    int *prval;
+
+    C_ObjectOperation_pg_omap_read(std::vector<T> *results, int *prval)
+      : results(results), prval(prval) {}
+    void finish(int r) override {
+      using ceph::decode;
+      if (r < 0 || !results)
+	return;
+      try {
+	auto p = bl.cbegin();
+	std::vector<pg_omap_read_result_t> decoded;
+	decode(decoded, p);
+	results->resize(decoded.size());
+	for (unsigned i = 0; i < decoded.size(); ++i) {
+	  convert(std::move(decoded[i]), &(*results)[i]);
+	}
+      } catch (ceph::buffer::error&) {
+	if (prval)
+	  *prval = -EIO;
+      }
+    }
+  };
+
+  template <typename T>
+  void do_pg_omap_read(::ObjectOperation *op,
+		       const std::vector<pg_omap_read_t>& reads,
+		       std::vector<T> *results,
+		       int *prval)
+  {
+    using ceph::encode;
+    OSDOp& osd_op = op->add_op(CEPH_OSD_OP_PG_OMAP_READ);
+    op->flags |= CEPH_OSD_FLAG_PGOP;
+    encode(reads, osd_op.indata);
+    unsigned p = op->ops.size() - 1;
+    auto *h = new C_ObjectOperation_pg_omap_read<T>{results, prval};
+    op->out_handler[p] = h;
+    op->out_bl[p] = &h->bl;
+    op->out_rval[p] = prval;
+  }
+}
+
+void ::ObjectOperation::pg_omap_read(
+  const std::vector<pg_omap_read_t>& reads,
+  std::vector<pg_omap_read_result_t> *results,
+  int *prval)
+{
+  do_pg_omap_read(this, reads, results, prval);
+}
+
+void ::ObjectOperation::pg_omap_read(
+  const std::vector<pg_omap_read_t>& reads,
+  std::vector<librados::omap_read_result_t> *results,
+  int *prval)
+{
+  do_pg_omap_read(this, reads, results, prval);
+}
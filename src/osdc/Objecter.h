@@ -221,6 +221,24 @@ struct ObjectOperation {
 		uint32_t *interval,
 		int *rval);
 
+  /**
+   * read the omap of many objects of the PG of the op in one go
+   *
+   * The vals read are bounded over all of the objects, so a read may
+   * come back truncated even though it asked for less than the OSD
+   * returns for a single object.
+   *
+   * @param reads [in] what to read from each object, all in the same PG
+   * @param results [out] the results, in the order of the reads
+   * @param prval [out] return value
+   */
+  void pg_omap_read(const std::vector<pg_omap_read_t>& reads,
+		    std::vector<pg_omap_read_result_t> *results,
+		    int *prval);
+  void pg_omap_read(const std::vector<pg_omap_read_t>& reads,
+		    std::vector<librados::omap_read_result_t> *results,
+		    int *prval);
+
   void create(bool excl) {
     OSDOp& o = add_op(CEPH_OSD_OP_CREATE);
     o.op.flags = (excl ? CEPH_OSD_OP_FLAG_EXCL : 0);
@@ -1023,13 +1041,18 @@ struct ObjectOperation {
   }
 
   void notify(uint64_t cookie, uint32_t prot_ver, uint32_t timeout,
-              ceph::buffer::list &bl, ceph::buffer::list *inbl) {
+              ceph::buffer::list &bl, ceph::buffer::list *inbl,
+              uint32_t flags = 0) {
     using ceph::encode;
     OSDOp& osd_op = add_op(CEPH_OSD_OP_NOTIFY);
     osd_op.op.notify.cookie = cookie;
     encode(prot_ver, *inbl);
     encode(timeout, *inbl);
     encode(bl, *inbl);
+    if (flags) {
+      // older osds ignore it
+      encode(flags, *inbl);
+    }
     osd_op.indata.append(*inbl);
   }
 
@@ -1926,7 +1949,7 @@ public:
   void _send_op(Op *op);
   void _send_op_account(Op *op);
   void _cancel_linger_op(Op *op);
-  void _finish_op(Op *op, int r);
+  void _finish_op(Op *op, int r, bool rwlocked = true);
   static bool is_pg_changed(
     int oldprimary,
     const std::vector<int>& oldacting,
@@ -2055,7 +2078,9 @@ private:
     op_throttle_ops(cct, "objecter_ops", cct->_conf->objecter_inflight_ops),
     epoch_barrier(0),
     retry_writes_after_first_reply(cct->_conf->objecter_retry_writes_after_first_reply)
-  { }
+  {
+    osdmap->set_client_only(cct->_conf->objecter_osdmap_client_only);
+  }
   ~Objecter() override;
 
   void init();
@@ -12,6 +12,9 @@
  *
  */
 
+#include <algorithm>
+#include <limits>
+
 #include "Striper.h"
 
 #include "include/types.h"
@@ -38,10 +41,106 @@ void Striper::file_to_extents(CephContext *cct, const char *object_format,
 			      std::vector<ObjectExtent>& extents,
 			      uint64_t buffer_offset)
 {
-  map<object_t,std::vector<ObjectExtent> > object_extents;
-  file_to_extents(cct, object_format, layout, offset, len, trunc_size,
-		  object_extents, buffer_offset);
-  assimilate_extents(object_extents, extents);
+  ldout(cct, 10) << "file_to_extents " << offset << "~" << len
+		 << " format " << object_format
+		 << dendl;
+  ceph_assert(len > 0);
+
+  /*
+   * a contiguous range maps to one contiguous extent in each object it
+   * touches, and it is done with an object set before it moves on to
+   * the next, so this only needs to find the extents of the current
+   * object set.  that saves the map and the oid of every stripe unit,
+   * which add up for large I/O against small stripe units.
+   */
+
+  __u32 object_size = layout->object_size;
+  __u32 su = layout->stripe_unit;
+  __u32 stripe_count = layout->stripe_count;
+  ceph_assert(object_size >= su);
+  if (stripe_count == 1) {
+    ldout(cct, 20) << " sc is one, reset su to os" << dendl;
+    su = object_size;
+  }
+  uint64_t stripes_per_object = object_size / su;
+  ldout(cct, 20) << " su " << su << " sc " << stripe_count << " os "
+		 << object_size << " stripes_per_object " << stripes_per_object
+		 << dendl;
+
+  const object_locator_t oloc = OSDMap::file_to_object_locator(*layout);
+  const size_t format_len = strlen(object_format) + 32;
+  // stripe units each object gets at most
+  const uint64_t max_buffer_extents =
+    std::min(stripes_per_object,
+	     len / ((uint64_t)su * stripe_count) + 2);
+
+  const size_t first = extents.size();
+  extents.reserve(first + std::min(
+    len / su + 2,
+    (len / ((uint64_t)object_size * stripe_count) + 2) * stripe_count));
+  // where the current object set's extents are in extents, by stripepos
+  const size_t none = std::numeric_limits<size_t>::max();
+  std::vector<size_t> set_extents(stripe_count, none);
+  uint64_t cur_objectsetno = offset / su / stripe_count / stripes_per_object;
+
+  uint64_t cur = offset;
+  uint64_t left = len;
+  while (left > 0) {
+    uint64_t blockno = cur / su;
+    uint64_t stripeno = blockno / stripe_count;
+    uint64_t stripepos = blockno % stripe_count;
+    uint64_t objectsetno = stripeno / stripes_per_object;
+    uint64_t objectno = objectsetno * stripe_count + stripepos;
+
+    uint64_t block_start = (stripeno % stripes_per_object) * su;
+    uint64_t block_off = cur % su;
+    uint64_t x_offset = block_start + block_off;
+    uint64_t x_len = std::min<uint64_t>(left, su - block_off);
+
+    ldout(cct, 20) << " off " << cur << " blockno " << blockno << " stripeno "
+		   << stripeno << " stripepos " << stripepos << " objectsetno "
+		   << objectsetno << " objectno " << objectno
+		   << " block_start " << block_start << " block_off "
+		   << block_off << " " << x_offset << "~" << x_len
+		   << dendl;
+
+    if (objectsetno != cur_objectsetno) {
+      std::fill(set_extents.begin(), set_extents.end(), none);
+      cur_objectsetno = objectsetno;
+    }
+    ObjectExtent *ex;
+    if (set_extents[stripepos] == none) {
+      char buf[format_len];
+      snprintf(buf, sizeof(buf), object_format, (long long unsigned)objectno);
+      set_extents[stripepos] = extents.size();
+      extents.emplace_back(object_t(buf), objectno, x_offset, x_len,
+			   object_truncate_size(cct, layout, objectno,
+						trunc_size));
+      ex = &extents.back();
+      ex->oloc = oloc;
+      ex->buffer_extents.reserve(max_buffer_extents);
+      ldout(cct, 20) << " added new " << *ex << dendl;
+    } else {
+      ex = &extents[set_extents[stripepos]];
+      ceph_assert(ex->offset + ex->length == x_offset);
+      ldout(cct, 20) << " adding in to " << *ex << dendl;
+      ex->length += x_len;
+    }
+    ex->buffer_extents.push_back(make_pair(cur - offset + buffer_offset,
+					   x_len));
+
+    ldout(cct, 15) << "file_to_extents  " << *ex << " in " << ex->oloc
+		   << dendl;
+
+    left -= x_len;
+    cur += x_len;
+  }
+
+  // same order as going through the map of oids did
+  std::sort(extents.begin() + first, extents.end(),
+	    [](const ObjectExtent& a, const ObjectExtent& b) {
+	      return a.oid < b.oid;
+	    });
 }
 
 void Striper::file_to_extents(
@@ -255,6 +255,9 @@ void usage()
   cout << "   --admin                   set the admin flag on the user\n";
   cout << "   --system                  set the system flag on the user\n";
   cout << "   --op-mask                 set the op mask on the user\n";
+  cout << "   --qos-reservation=<ops>   dmclock reservation of the user's requests\n";
+  cout << "   --qos-weight=<weight>     dmclock weight of the user's requests (0 to disable)\n";
+  cout << "   --qos-limit=<ops>         dmclock limit of the user's requests\n";
   cout << "   --bucket=<bucket>         Specify the bucket name. Also used by the quota command.\n";
   cout << "   --pool=<pool>             Specify the pool name. Also used to scan for leaked rados objects.\n";
   cout << "   --object=<object>         object name\n";
@@ -1431,7 +1434,7 @@ int check_min_obj_stripe_size(RGWRados *store, RGWBucketInfo& bucket_info, rgw_o
   read_op.params.attrs = &attrs;
   read_op.params.obj_size = &obj_size;
 
-  int ret = read_op.prepare();
+  int ret = read_op.prepare(null_yield);
   if (ret < 0) {
     lderr(store->ctx()) << "ERROR: failed to stat object, returned error: " << cpp_strerror(-ret) << dendl;
     return ret;
@@ -1493,7 +1496,7 @@ int check_obj_locator_underscore(RGWBucketInfo& bucket_info, rgw_obj& obj, rgw_o
   RGWRados::Object op_target(store, bucket_info, obj_ctx, obj);
   RGWRados::Object::Read read_op(&op_target);
 
-  int ret = read_op.prepare();
+  int ret = read_op.prepare(null_yield);
   bool needs_fixing = (ret == -ENOENT);
 
   f->dump_bool("needs_fixing", needs_fixing);
@@ -2808,6 +2811,8 @@ int main(int argc, const char **argv)
   string client_id;
   string op_id;
   string op_mask_str;
+  RGWUserQoS qos;
+  bool qos_specified = false;
   string quota_scope;
   string object_version;
   string placement_id;
@@ -2915,6 +2920,27 @@ int main(int argc, const char **argv)
       op_id = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--op-mask", (char*)NULL)) {
       op_mask_str = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--qos-reservation", (char*)NULL)) {
+      qos.reservation = strict_strtod(val.c_str(), &err);
+      if (!err.empty() || qos.reservation < 0) {
+        cerr << "ERROR: failed to parse qos reservation: " << err << std::endl;
+        return EINVAL;
+      }
+      qos_specified = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--qos-weight", (char*)NULL)) {
+      qos.weight = strict_strtod(val.c_str(), &err);
+      if (!err.empty() || qos.weight < 0) {
+        cerr << "ERROR: failed to parse qos weight: " << err << std::endl;
+        return EINVAL;
+      }
+      qos_specified = true;
+    } else if (ceph_argparse_witharg(args, i, &val, "--qos-limit", (char*)NULL)) {
+      qos.limit = strict_strtod(val.c_str(), &err);
+      if (!err.empty() || qos.limit < 0) {
+        cerr << "ERROR: failed to parse qos limit: " << err << std::endl;
+        return EINVAL;
+      }
+      qos_specified = true;
     } else if (ceph_argparse_witharg(args, i, &val, "--key-type", (char*)NULL)) {
       key_type_str = val;
       if (key_type_str.compare("swift") == 0) {
@@ -4940,6 +4966,12 @@ int main(int argc, const char **argv)
     user_op.set_op_mask(op_mask);
   }
 
+  if (qos_specified) {
+    // a weight of 0 puts the user back with the shared clients
+    qos.enabled = qos.weight > 0;
+    user_op.set_qos(qos);
+  }
+
   if (key_type != KEY_TYPE_UNDEFINED)
     user_op.set_key_type(key_type);
 
@@ -6411,7 +6443,7 @@ next:
     read_op.params.attrs = &attrs;
     read_op.params.obj_size = &obj_size;
 
-    ret = read_op.prepare();
+    ret = read_op.prepare(null_yield);
     if (ret < 0) {
       cerr << "ERROR: failed to stat object, returned error: " << cpp_strerror(-ret) << std::endl;
       return 1;
@@ -18,6 +18,7 @@
 #include "include/rados/librados_fwd.hpp"
 #include <memory>
 #include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
 #include "common/async/completion.h"
 #include "common/async/yield_context.h"
 #include "services/svc_rados.h"
@@ -114,6 +115,32 @@ class YieldingAioThrottle final : public Aio, private Throttle {
 };
 #endif // HAVE_BOOST_CONTEXT
 
+// sizes the bytes of reads that a single object read keeps in flight. the
+// window starts at its minimum and doubles, up to max_window, each time the
+// read had to wait at least grow_wait on rados for room in it. a read held
+// back by the client instead finds its reads completed by the time it needs
+// room, so its window doesn't grow
+class ReadWindow {
+  uint64_t window;
+  const uint64_t max_window;
+  const ceph::timespan grow_wait;
+ public:
+  ReadWindow(uint64_t window, uint64_t max_window, ceph::timespan grow_wait)
+    : window(window), max_window(std::max(window, max_window)),
+      grow_wait(grow_wait)
+  {}
+
+  uint64_t size() const { return window; }
+  uint64_t max_size() const { return max_window; }
+
+  // a full window waited this long for one of its reads to complete
+  void waited(ceph::timespan duration) {
+    if (duration >= grow_wait && window < max_window) {
+      window = std::min(window * 2, max_window);
+    }
+  }
+};
+
 // return a smart pointer to Aio
 inline auto make_throttle(uint64_t window_size, optional_yield y)
 {
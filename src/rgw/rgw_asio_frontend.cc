@@ -267,14 +267,17 @@ class AsioFrontend {
   {
     auto sched_t = dmc::get_scheduler_t(ctx());
     switch(sched_t){
-    case dmc::scheduler_t::dmclock:
-      scheduler.reset(new dmc::AsyncScheduler(ctx(),
+    case dmc::scheduler_t::dmclock: {
+      auto async_scheduler = new dmc::AsyncScheduler(ctx(),
                                               context,
                                               std::ref(sched_ctx.get_dmc_client_counters()),
                                               sched_ctx.get_dmc_client_config(),
                                               *sched_ctx.get_dmc_client_config(),
-                                              dmc::AtLimit::Reject));
+                                              dmc::AtLimit::Reject);
+      async_scheduler->set_tenant_clients(sched_ctx.get_dmc_tenant_clients());
+      scheduler.reset(async_scheduler);
       break;
+    }
     case dmc::scheduler_t::none:
       lderr(ctx()) << "Got invalid scheduler type for beast, defaulting to throttler" << dendl;
       [[fallthrough]];
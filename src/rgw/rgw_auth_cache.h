@@ -0,0 +1,109 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_AUTH_CACHE_H
+#define CEPH_RGW_AUTH_CACHE_H
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "common/ceph_time.h"
+
+namespace rgw {
+namespace auth {
+
+/* A small cache of what authenticating a request derives from its
+ * credentials, for the requests that follow with the same ones. It's
+ * sharded by key so that the requests looking it up don't contend on
+ * one lock. Entries are dropped once they expire, and a full shard
+ * makes room by dropping the expired entries or, failing that, an
+ * arbitrary one. A max_size of 0 disables the cache. */
+template <class V>
+class ExpiringCache {
+  using clock_t = ceph::coarse_mono_clock;
+
+  static constexpr size_t NUM_SHARDS = 16;
+
+  struct entry_t {
+    V value;
+    clock_t::time_point expires;
+  };
+  struct shard_t {
+    std::mutex lock;
+    std::unordered_map<std::string, entry_t> entries;
+  };
+
+  std::array<shard_t, NUM_SHARDS> shards;
+  const size_t max_shard_size;
+  const clock_t::duration ttl;
+
+  shard_t& get_shard(const std::string& key) {
+    return shards[std::hash<std::string>{}(key) % NUM_SHARDS];
+  }
+
+public:
+  ExpiringCache(size_t max_size, clock_t::duration ttl)
+    : max_shard_size(max_size ? (max_size + NUM_SHARDS - 1) / NUM_SHARDS : 0),
+      ttl(ttl) {
+  }
+
+  bool enabled() const {
+    return max_shard_size > 0 && ttl > clock_t::duration::zero();
+  }
+
+  bool find(const std::string& key, V& value) {
+    if (!enabled()) {
+      return false;
+    }
+    auto& shard = get_shard(key);
+    std::lock_guard l{shard.lock};
+    const auto iter = shard.entries.find(key);
+    if (iter == std::end(shard.entries)) {
+      return false;
+    }
+    if (iter->second.expires <= clock_t::now()) {
+      shard.entries.erase(iter);
+      return false;
+    }
+    value = iter->second.value;
+    return true;
+  }
+
+  void add(const std::string& key, const V& value) {
+    if (!enabled()) {
+      return;
+    }
+    const auto now = clock_t::now();
+    auto& shard = get_shard(key);
+    std::lock_guard l{shard.lock};
+    if (shard.entries.size() >= max_shard_size &&
+        shard.entries.find(key) == std::end(shard.entries)) {
+      for (auto iter = std::begin(shard.entries);
+           iter != std::end(shard.entries);) {
+        if (iter->second.expires <= now) {
+          iter = shard.entries.erase(iter);
+        } else {
+          ++iter;
+        }
+      }
+      if (shard.entries.size() >= max_shard_size) {
+        shard.entries.erase(std::begin(shard.entries));
+      }
+    }
+    shard.entries[key] = entry_t{value, now + ttl};
+  }
+
+  void invalidate(const std::string& key) {
+    auto& shard = get_shard(key);
+    std::lock_guard l{shard.lock};
+    shard.entries.erase(key);
+  }
+};
+
+} /* namespace auth */
+} /* namespace rgw */
+
+#endif /* CEPH_RGW_AUTH_CACHE_H */
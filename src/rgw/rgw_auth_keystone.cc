@@ -633,18 +633,17 @@ bool SecretCache::find(const std::string& token_id,
   }
 
   secret_entry& entry = iter->second;
-  secrets_lru.erase(entry.lru_iter);
 
   const utime_t now = ceph_clock_now();
   if (entry.token.expired() || now > entry.expires) {
+    secrets_lru.erase(entry.lru_iter);
     secrets.erase(iter);
     return false;
   }
   token = entry.token;
   secret = entry.secret;
 
-  secrets_lru.push_front(token_id);
-  entry.lru_iter = secrets_lru.begin();
+  secrets_lru.splice(secrets_lru.begin(), secrets_lru, entry.lru_iter);
 
   return true;
 }
@@ -655,13 +654,17 @@ void SecretCache::add(const std::string& token_id,
 {
   std::lock_guard<std::mutex> l(lock);
 
+  const utime_t now = ceph_clock_now();
   map<string, secret_entry>::iterator iter = secrets.find(token_id);
   if (iter != secrets.end()) {
     secret_entry& e = iter->second;
-    secrets_lru.erase(e.lru_iter);
+    e.token = token;
+    e.secret = secret;
+    e.expires = now + s3_token_expiry_length;
+    secrets_lru.splice(secrets_lru.begin(), secrets_lru, e.lru_iter);
+    return;
   }
 
-  const utime_t now = ceph_clock_now();
   secrets_lru.push_front(token_id);
   secret_entry& entry = secrets[token_id];
   entry.token = token;
@@ -11,6 +11,7 @@
 #include "common/utf8.h"
 #include "rgw_rest_s3.h"
 #include "rgw_auth_s3.h"
+#include "rgw_auth_cache.h"
 #include "rgw_common.h"
 #include "rgw_client_io.h"
 #include "rgw_rest.h"
@@ -40,6 +41,8 @@ static const auto signed_subresources = {
   "response-content-language",
   "response-content-type",
   "response-expires",
+  "select",
+  "select-type",
   "tagging",
   "torrent",
   "uploadId",
@@ -730,6 +733,26 @@ get_v4_signing_key(CephContext* const cct,
                    const boost::string_view& credential_scope,
                    const boost::string_view& secret_access_key)
 {
+  /* The key depends only on the secret and the scope, which changes with
+   * the date, so a client's requests of a day share it. We don't want to
+   * redo the four HMAC rounds for each of them. */
+  static rgw::auth::ExpiringCache<sha256_digest_t> signing_key_cache(
+    cct->_conf.get_val<uint64_t>("rgw_s3_signing_key_cache_size"),
+    std::chrono::hours{24});
+
+  std::string cache_key;
+  if (signing_key_cache.enabled()) {
+    cache_key = std::to_string(secret_access_key.size()) + ":";
+    cache_key.append(secret_access_key.data(), secret_access_key.size());
+    cache_key.append(credential_scope.data(), credential_scope.size());
+
+    sha256_digest_t signing_key;
+    if (signing_key_cache.find(cache_key, signing_key)) {
+      ldout(cct, 20) << "signing_k = " << signing_key << " (cached)" << dendl;
+      return signing_key;
+    }
+  }
+
   boost::string_view date, region, service;
   std::tie(date, region, service) = parse_cred_scope(credential_scope);
 
@@ -747,6 +770,9 @@ get_v4_signing_key(CephContext* const cct,
   ldout(cct, 10) << "service_k = " << service_k << dendl;
   ldout(cct, 10) << "signing_k = " << signing_key << dendl;
 
+  if (signing_key_cache.enabled()) {
+    signing_key_cache.add(cache_key, signing_key);
+  }
   return signing_key;
 }
 
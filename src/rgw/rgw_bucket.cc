@@ -1260,7 +1260,7 @@ int RGWBucket::get_policy(RGWBucketAdminOpState& op_state, RGWAccessControlPolic
     RGWRados::Object op_target(store, bucket_info, obj_ctx, obj);
     RGWRados::Object::Read rop(&op_target);
 
-    int ret = rop.get_attr(RGW_ATTR_ACL, bl);
+    int ret = rop.get_attr(RGW_ATTR_ACL, bl, null_yield);
     if (ret < 0)
       return ret;
 
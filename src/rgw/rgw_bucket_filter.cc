@@ -0,0 +1,349 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "common/errno.h"
+
+#include "rgw_bucket_filter.h"
+#include "rgw_rados.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_rgw
+
+static constexpr double FALSE_POSITIVE_PROBABILITY = 0.01;
+static constexpr size_t MIN_FILTER_SIZE = 1024;
+static constexpr int64_t LIST_CHUNK = 1000;
+static constexpr uint64_t MIN_RETRY_MSEC = 100;
+
+class RGWBucketExistenceFilter::Refresher : public RGWRadosThread {
+  RGWBucketExistenceFilter *filters;
+
+  uint64_t interval_msec() override {
+    return filters->next_refresh_msec();
+  }
+public:
+  Refresher(RGWRados *store, RGWBucketExistenceFilter *filters)
+    : RGWRadosThread(store, "rgw_bucket_filter"), filters(filters) {}
+
+  int process() override {
+    return filters->refresh();
+  }
+};
+
+RGWBucketExistenceFilter::RGWBucketExistenceFilter(CephContext *cct,
+                                                   RGWRados *store)
+  : cct(cct), store(store)
+{
+}
+
+RGWBucketExistenceFilter::~RGWBucketExistenceFilter()
+{
+  stop();
+}
+
+void RGWBucketExistenceFilter::start()
+{
+  refresher.reset(new Refresher(store, this));
+  refresher->start();
+}
+
+void RGWBucketExistenceFilter::stop()
+{
+  if (refresher) {
+    refresher->stop();
+    refresher.reset();
+  }
+}
+
+bool RGWBucketExistenceFilter::going_down() const
+{
+  return refresher && refresher->going_down();
+}
+
+uint64_t RGWBucketExistenceFilter::refresh_interval_msec() const
+{
+  return cct->_conf.get_val<uint64_t>(
+    "rgw_bucket_existence_filter_refresh_interval") * 1000;
+}
+
+uint64_t RGWBucketExistenceFilter::next_refresh_msec() const
+{
+  const uint64_t msec = wait_msec;
+  return msec ? msec : refresh_interval_msec();
+}
+
+int RGWBucketExistenceFilter::read_index_version(
+  const RGWBucketInfo& bucket_info, uint64_t *ver, uint64_t *num_entries)
+{
+  std::vector<rgw_bucket_dir_header> headers;
+  int r = store->cls_bucket_head(bucket_info, RGW_NO_SHARD, headers);
+  if (r < 0) {
+    return r;
+  }
+  *ver = 0;
+  *num_entries = 0;
+  for (const auto& header : headers) {
+    *ver += header.ver;
+    for (const auto& stats : header.stats) {
+      *num_entries += stats.second.num_entries;
+    }
+  }
+  return 0;
+}
+
+int RGWBucketExistenceFilter::list_index(
+  const RGWBucketInfo& bucket_info,
+  const std::function<bool(const std::vector<std::string>&)>& f)
+{
+  RGWRados::Bucket target(store, bucket_info);
+  RGWRados::Bucket::List list_op(&target);
+  list_op.params.list_versions = true;
+  list_op.params.allow_unordered = true;
+
+  std::vector<rgw_bucket_dir_entry> objs;
+  std::vector<std::string> names;
+  bool truncated = false;
+  do {
+    objs.clear();
+    int r = list_op.list_objects(LIST_CHUNK, &objs, nullptr, &truncated);
+    if (r < 0) {
+      return r;
+    }
+    names.clear();
+    for (const auto& obj : objs) {
+      names.push_back(obj.key.name);
+    }
+  } while (f(names) && truncated);
+  return 0;
+}
+
+int RGWBucketExistenceFilter::lookup_index(const RGWBucketInfo& bucket_info,
+                                           const rgw_obj_key& key,
+                                           optional_yield y)
+{
+  rgw_obj obj(bucket_info.bucket, key);
+  rgw_cls_bi_entry entry;
+  int r = store->bi_get(bucket_info, obj, BIIndexType::Plain, &entry, y);
+  if (r == -ENOENT && key.instance.empty()) {
+    // the current version of a versioned object has only its olh entry
+    r = store->bi_get(bucket_info, obj, BIIndexType::OLH, &entry, y);
+  }
+  return r;
+}
+
+bool RGWBucketExistenceFilter::may_exist(const RGWBucketInfo& bucket_info,
+                                         const rgw_obj_key& key,
+                                         optional_yield y)
+{
+  if (!key.ns.empty() || bucket_info.index_type == RGWBIType_Indexless) {
+    return true;
+  }
+  const auto bucket_key = bucket_info.bucket.get_key();
+  bool tracked = false;
+  {
+    std::shared_lock l{lock};
+    auto iter = entries.find(bucket_key);
+    tracked = iter != entries.end();
+    if (tracked) {
+      auto& entry = iter->second;
+      entry.used = true;
+      if (!entry.filter || entry.filter->contains(key.name)) {
+        return true;
+      }
+    }
+  }
+  if (tracked) {
+    // it may have been written through another gateway since the filter
+    // was built, so ask the index
+    int r = lookup_index(bucket_info, key, y);
+    if (r == -ENOENT) {
+      return false;
+    }
+    if (r < 0) {
+      ldout(cct, 5) << "bucket existence filter: failed to look up " << key
+                    << " in " << bucket_key << ": " << cpp_strerror(-r)
+                    << dendl;
+      return true;
+    }
+    add(bucket_info, key);
+    return true;
+  }
+
+  // start tracking the bucket; the refresher builds its filter
+  std::unique_lock l{lock};
+  if (entries.size() >=
+      cct->_conf.get_val<uint64_t>("rgw_bucket_existence_filter_max_buckets")) {
+    return true;
+  }
+  auto& entry = entries[bucket_key];
+  entry.bucket_info = bucket_info;
+  l.unlock();
+  if (refresher) {
+    refresher->signal();
+  }
+  return true;
+}
+
+void RGWBucketExistenceFilter::add(const RGWBucketInfo& bucket_info,
+                                   const rgw_obj_key& key)
+{
+  if (!key.ns.empty()) {
+    return;
+  }
+  const auto bucket_key = bucket_info.bucket.get_key();
+  std::unique_lock l{lock};
+  auto iter = entries.find(bucket_key);
+  if (iter == entries.end()) {
+    return;
+  }
+  auto& entry = iter->second;
+  if (entry.filter) {
+    entry.filter->insert(key.name);
+  }
+  if (entry.building) {
+    entry.building->insert(key.name);
+  }
+}
+
+int RGWBucketExistenceFilter::build(const RGWBucketInfo& bucket_info,
+                                    bloom_filter *filter)
+{
+  return list_index(bucket_info,
+    [this, filter](const std::vector<std::string>& names) {
+      std::unique_lock l{lock};
+      for (const auto& name : names) {
+        filter->insert(name);
+      }
+      return !going_down();
+    });
+}
+
+void RGWBucketExistenceFilter::refresh_failed(entry_t& entry)
+{
+  // filter nothing until the index is readable again, and retry sooner
+  // than the interval, backing off up to it
+  const uint64_t msec = std::min(
+    MIN_RETRY_MSEC << std::min(entry.failures, 10u), refresh_interval_msec());
+  ++entry.failures;
+  entry.retry_at = ceph::coarse_mono_clock::now() +
+    std::chrono::milliseconds(msec);
+  entry.building.reset();
+  entry.filter.reset();
+}
+
+void RGWBucketExistenceFilter::refresh_entry(const std::string& key,
+                                             entry_t& entry)
+{
+  // only this thread changes the entry's bucket_info, no need for the lock
+  const auto& bucket_info = entry.bucket_info;
+
+  uint64_t ver = 0;
+  uint64_t num_entries = 0;
+  int r = read_index_version(bucket_info, &ver, &num_entries);
+  if (r < 0) {
+    ldout(cct, 5) << "bucket existence filter: failed to read index headers of "
+                  << key << ": " << cpp_strerror(-r) << dendl;
+    // this can't tell what changed, so stop filtering until it can
+    std::unique_lock l{lock};
+    refresh_failed(entry);
+    return;
+  }
+
+  {
+    std::unique_lock l{lock};
+    if (entry.filter && entry.ver == ver) {
+      entry.failures = 0;
+      return;
+    }
+    const auto max_objects = cct->_conf.get_val<uint64_t>(
+      "rgw_bucket_existence_filter_max_objects");
+    if (num_entries > max_objects) {
+      if (!entry.too_big) {
+        ldout(cct, 10) << "bucket existence filter: " << key << " has "
+                       << num_entries << " objects, not filtering it" << dendl;
+      }
+      entry.too_big = true;
+      entry.failures = 0;
+      entry.filter.reset();
+      return;
+    }
+    entry.too_big = false;
+    // room for the objects added until the next rebuild
+    const size_t size = std::max<size_t>(num_entries * 2, MIN_FILTER_SIZE);
+    entry.building.reset(new bloom_filter(size, FALSE_POSITIVE_PROBABILITY, 0));
+  }
+
+  // list what was in the index no later than when the headers were read
+  r = build(bucket_info, entry.building.get());
+
+  std::unique_lock l{lock};
+  if (r < 0) {
+    ldout(cct, 5) << "bucket existence filter: failed to list " << key
+                  << ": " << cpp_strerror(-r) << dendl;
+    refresh_failed(entry);
+    return;
+  }
+  if (going_down()) {
+    entry.building.reset();
+    entry.filter.reset();
+    return;
+  }
+  ldout(cct, 20) << "bucket existence filter: built " << key << " with "
+                 << num_entries << " objects" << dendl;
+  entry.filter = std::move(entry.building);
+  entry.ver = ver;
+  entry.failures = 0;
+}
+
+int RGWBucketExistenceFilter::refresh()
+{
+  const auto now = ceph::coarse_mono_clock::now();
+  const auto interval = std::chrono::milliseconds(refresh_interval_msec());
+
+  std::vector<std::pair<std::string, entry_t*>> due;
+  {
+    std::unique_lock l{lock};
+    for (auto iter = entries.begin(); iter != entries.end();) {
+      auto& entry = iter->second;
+      const bool retry = entry.failures && now >= entry.retry_at;
+      if (!retry && now - entry.last_check < interval) {
+        ++iter;
+        continue;
+      }
+      if (!retry) {
+        // drop the buckets that weren't read since the last check
+        if (!entry.used.exchange(false)) {
+          iter = entries.erase(iter);
+          continue;
+        }
+        entry.last_check = now;
+      }
+      due.emplace_back(iter->first, &entry);
+      ++iter;
+    }
+  }
+
+  for (auto& d : due) {
+    if (going_down()) {
+      break;
+    }
+    refresh_entry(d.first, *d.second);
+  }
+
+  // wake up for the soonest retry
+  uint64_t msec = 0;
+  std::shared_lock l{lock};
+  const auto after = ceph::coarse_mono_clock::now();
+  for (const auto& e : entries) {
+    if (!e.second.failures) {
+      continue;
+    }
+    const uint64_t wait = e.second.retry_at > after ?
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+        e.second.retry_at - after).count() : 1;
+    if (!msec || wait < msec) {
+      msec = std::max<uint64_t>(wait, 1);
+    }
+  }
+  wait_msec = msec;
+  return 0;
+}
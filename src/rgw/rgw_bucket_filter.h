@@ -0,0 +1,103 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_BUCKET_FILTER_H
+#define CEPH_RGW_BUCKET_FILTER_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "common/bloom_filter.hpp"
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "rgw_common.h"
+
+class RGWRados;
+
+/*
+ * Bloom filters of the object names in the buckets that are read, to
+ * answer reads of objects that a bucket never had without a RADOS op.
+ *
+ * A bucket's filter is built in the background by listing its index,
+ * once the bucket is first read. The writes made through this gateway
+ * add to it as they go. The writes made through others are caught by
+ * checking the version of the index shard headers every
+ * rgw_bucket_existence_filter_refresh_interval and rebuilding the
+ * filter when they changed. Until then a name the filter doesn't have
+ * is looked up in the bucket index, and added if it is there, so an
+ * object just written through another gateway is still found.
+ *
+ * Only reads consult the filters. Writes still look the head up, so a
+ * stale filter can't make them clobber an object.
+ */
+class RGWBucketExistenceFilter {
+  struct entry_t {
+    RGWBucketInfo bucket_info;
+    std::unique_ptr<bloom_filter> filter;   ///< null until built
+    std::unique_ptr<bloom_filter> building; ///< a rebuild, adds go to it as well
+    uint64_t ver = 0;         ///< sum of the shard header versions it was built at
+    bool too_big = false;     ///< has too many objects to be filtered
+    ceph::coarse_mono_time last_check;
+    unsigned failures = 0;    ///< refreshes failed in a row
+    ceph::coarse_mono_time retry_at; ///< of a failed refresh
+    std::atomic<bool> used = { true };
+  };
+
+  class Refresher;
+
+  CephContext *cct;
+  RGWRados *store;
+
+  ceph::shared_mutex lock =
+    ceph::make_shared_mutex("RGWBucketExistenceFilter::lock");
+  /// by bucket instance key; only the refresher erases entries, so it
+  /// can keep using one after dropping the lock
+  std::map<std::string, entry_t> entries;
+
+  std::unique_ptr<Refresher> refresher;
+  /// until the next refresh, shorter than the interval if one is retried
+  std::atomic<uint64_t> wait_msec = { 0 };
+
+  bool going_down() const;
+  /// check the bucket's index for changes, and rebuild its filter if any
+  void refresh_entry(const std::string& key, entry_t& entry);
+  int build(const RGWBucketInfo& bucket_info, bloom_filter *filter);
+  void refresh_failed(entry_t& entry);
+
+protected:
+  // the bucket index, overridden by the tests
+  /// sum the shard header versions and the number of entries
+  virtual int read_index_version(const RGWBucketInfo& bucket_info,
+                                 uint64_t *ver, uint64_t *num_entries);
+  /// pass the names in the index to f, a chunk at a time, until it
+  /// returns false
+  virtual int list_index(const RGWBucketInfo& bucket_info,
+                         const std::function<bool(const std::vector<std::string>&)>& f);
+  /// 0 if the index has an entry for the object, -ENOENT if not
+  virtual int lookup_index(const RGWBucketInfo& bucket_info,
+                           const rgw_obj_key& key, optional_yield y);
+
+public:
+  RGWBucketExistenceFilter(CephContext *cct, RGWRados *store);
+  virtual ~RGWBucketExistenceFilter();
+
+  void start();
+  void stop();
+
+  /// false if the object is certainly not in the bucket. a name the
+  /// filter doesn't have is looked up in the index, yielding on y
+  bool may_exist(const RGWBucketInfo& bucket_info, const rgw_obj_key& key,
+                 optional_yield y);
+  /// note an object the bucket index is about to get
+  void add(const RGWBucketInfo& bucket_info, const rgw_obj_key& key);
+
+  /// called by the refresher thread
+  int refresh();
+  uint64_t refresh_interval_msec() const;
+  uint64_t next_refresh_msec() const;
+};
+
+#endif
@@ -3,7 +3,9 @@
 
 #include "rgw_cache.h"
 #include "rgw_perf_counters.h"
+#include "include/scope_guard.h"
 
+#include <algorithm>
 #include <errno.h>
 
 #define dout_subsys ceph_subsys_rgw
@@ -11,14 +13,15 @@
 
 int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, rgw_cache_entry_info *cache_info)
 {
-  RWLock::RLocker l(lock);
+  Shard& shard = get_shard(name);
+  RWLock::RLocker l(shard.lock);
 
   if (!enabled) {
     return -ENOENT;
   }
 
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end()) {
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end()) {
     ldout(cct, 10) << "cache get: name=" << name << " : miss" << dendl;
     if (perfcounter)
       perfcounter->inc(l_rgw_cache_miss);
@@ -27,15 +30,13 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
   if (expiry.count() &&
        (ceph::coarse_mono_clock::now() - iter->second.info.time_added) > expiry) {
     ldout(cct, 10) << "cache get: name=" << name << " : expiry miss" << dendl;
-    lock.unlock();
-    lock.get_write();
+    shard.lock.unlock();
+    shard.lock.get_write();
     // check that wasn't already removed by other thread
-    iter = cache_map.find(name);
-    if (iter != cache_map.end()) {
-      for (auto &kv : iter->second.chained_entries)
-        kv.first->invalidate(kv.second);
-      remove_lru(name, iter->second.lru_iter);
-      cache_map.erase(iter);
+    iter = shard.cache_map.find(name);
+    if (iter != shard.cache_map.end()) {
+      invalidate_chained(iter->second);
+      remove_entry(shard, iter);
     }
     if(perfcounter)
       perfcounter->inc(l_rgw_cache_miss);
@@ -44,28 +45,12 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 
   ObjectCacheEntry *entry = &iter->second;
 
-  if (lru_counter - entry->lru_promotion_ts > lru_window) {
-    ldout(cct, 20) << "cache get: touching lru, lru_counter=" << lru_counter
-                   << " promotion_ts=" << entry->lru_promotion_ts << dendl;
-    lock.unlock();
-    lock.get_write(); /* promote lock to writer */
-
-    /* need to redo this because entry might have dropped off the cache */
-    iter = cache_map.find(name);
-    if (iter == cache_map.end()) {
-      ldout(cct, 10) << "lost race! cache get: name=" << name << " : miss" << dendl;
-      if(perfcounter) perfcounter->inc(l_rgw_cache_miss);
-      return -ENOENT;
-    }
-
-    entry = &iter->second;
-    /* check again, we might have lost a race here */
-    if (lru_counter - entry->lru_promotion_ts > lru_window) {
-      touch_lru(name, *entry, iter->second.lru_iter);
-    }
+  // avoid dirtying the cache line when the bit is already set
+  if (!entry->referenced.load(std::memory_order_relaxed)) {
+    entry->referenced.store(true, std::memory_order_relaxed);
   }
 
-  ObjectCacheInfo& src = iter->second.info;
+  ObjectCacheInfo& src = entry->info;
   if ((src.flags & mask) != mask) {
     ldout(cct, 10) << "cache get: name=" << name << " : type miss (requested=0x"
                    << std::hex << mask << ", cached=0x" << src.flags
@@ -90,7 +75,23 @@ int ObjectCache::get(const string& name, ObjectCacheInfo& info, uint32_t mask, r
 bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*> cache_info_entries,
 				    RGWChainedCache::Entry *chained_entry)
 {
-  RWLock::WLocker l(lock);
+  /* lock the shards of all the entries, in shard order */
+  std::vector<Shard*> locked_shards;
+  locked_shards.reserve(cache_info_entries.size());
+  for (auto cache_info : cache_info_entries) {
+    locked_shards.push_back(&get_shard(cache_info->cache_locator));
+  }
+  std::sort(locked_shards.begin(), locked_shards.end());
+  locked_shards.erase(std::unique(locked_shards.begin(), locked_shards.end()),
+		      locked_shards.end());
+  for (auto shard : locked_shards) {
+    shard->lock.get_write();
+  }
+  auto unlock = make_scope_guard([&locked_shards] {
+      for (auto shard : locked_shards) {
+	shard->lock.unlock();
+      }
+    });
 
   if (!enabled) {
     return false;
@@ -102,6 +103,7 @@ bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*>
   for (auto cache_info : cache_info_entries) {
     ldout(cct, 10) << "chain_cache_entry: cache_locator="
 		   << cache_info->cache_locator << dendl;
+    auto& cache_map = get_shard(cache_info->cache_locator).cache_map;
     auto iter = cache_map.find(cache_info->cache_locator);
     if (iter == cache_map.end()) {
       ldout(cct, 20) << "chain_cache_entry: couldn't find cache locator" << dendl;
@@ -132,7 +134,8 @@ bool ObjectCache::chain_cache_entry(std::initializer_list<rgw_cache_entry_info*>
 
 void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry_info *cache_info)
 {
-  RWLock::WLocker l(lock);
+  Shard& shard = get_shard(name);
+  RWLock::WLocker l(shard.lock);
 
   if (!enabled) {
     return;
@@ -141,20 +144,23 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
   ldout(cct, 10) << "cache put: name=" << name << " info.flags=0x"
                  << std::hex << info.flags << std::dec << dendl;
 
-  auto [iter, inserted] = cache_map.emplace(name, ObjectCacheEntry{});
+  auto [iter, inserted] = shard.cache_map.try_emplace(name);
   ObjectCacheEntry& entry = iter->second;
   entry.info.time_added = ceph::coarse_mono_clock::now();
   if (inserted) {
-    entry.lru_iter = lru.end();
+    // new entries go just behind the hand, so they are looked at last
+    entry.clock_iter = shard.clock.insert(shard.hand, name);
+    ldout(cct, 10) << "adding " << name << " to cache" << dendl;
   }
+  entry.referenced = true;
   ObjectCacheInfo& target = entry.info;
 
-  invalidate_lru(entry);
+  invalidate_chained(entry);
 
   entry.chained_entries.clear();
   entry.gen++;
 
-  touch_lru(name, entry, entry.lru_iter);
+  evict(shard, name);
 
   target.status = info.status;
 
@@ -204,80 +210,60 @@ void ObjectCache::put(const string& name, ObjectCacheInfo& info, rgw_cache_entry
 
 bool ObjectCache::remove(const string& name)
 {
-  RWLock::WLocker l(lock);
+  Shard& shard = get_shard(name);
+  RWLock::WLocker l(shard.lock);
 
   if (!enabled) {
     return false;
   }
 
-  auto iter = cache_map.find(name);
-  if (iter == cache_map.end())
+  auto iter = shard.cache_map.find(name);
+  if (iter == shard.cache_map.end())
     return false;
 
   ldout(cct, 10) << "removing " << name << " from cache" << dendl;
-  ObjectCacheEntry& entry = iter->second;
-
-  for (auto& kv : entry.chained_entries) {
-    kv.first->invalidate(kv.second);
-  }
-
-  remove_lru(name, iter->second.lru_iter);
-  cache_map.erase(iter);
+  invalidate_chained(iter->second);
+  remove_entry(shard, iter);
   return true;
 }
 
-void ObjectCache::touch_lru(const string& name, ObjectCacheEntry& entry,
-			    std::list<string>::iterator& lru_iter)
+void ObjectCache::evict(Shard& shard, const string& keep)
 {
-  while (lru_size > (size_t)cct->_conf->rgw_cache_lru_size) {
-    auto iter = lru.begin();
-    if ((*iter).compare(name) == 0) {
-      /*
-       * if the entry we're touching happens to be at the lru end, don't remove it,
-       * lru shrinking can wait for next time
-       */
-      break;
+  ceph_assert(shard.lock.is_wlocked());
+
+  // every entry is passed over at most twice: once to clear its
+  // referenced bit and once to evict it
+  while (shard.cache_map.size() > shard_capacity) {
+    if (shard.hand == shard.clock.end()) {
+      shard.hand = shard.clock.begin();
     }
-    auto map_iter = cache_map.find(*iter);
-    ldout(cct, 10) << "removing entry: name=" << *iter << " from cache LRU" << dendl;
-    if (map_iter != cache_map.end()) {
-      ObjectCacheEntry& entry = map_iter->second;
-      invalidate_lru(entry);
-      cache_map.erase(map_iter);
+    auto map_iter = shard.cache_map.find(*shard.hand);
+    ceph_assert(map_iter != shard.cache_map.end());
+    ObjectCacheEntry& entry = map_iter->second;
+    if (map_iter->first == keep || entry.referenced.exchange(false)) {
+      ++shard.hand;
+      continue;
     }
-    lru.pop_front();
-    lru_size--;
-  }
-
-  if (lru_iter == lru.end()) {
-    lru.push_back(name);
-    lru_size++;
-    lru_iter--;
-    ldout(cct, 10) << "adding " << name << " to cache LRU end" << dendl;
-  } else {
-    ldout(cct, 10) << "moving " << name << " to cache LRU end" << dendl;
-    lru.erase(lru_iter);
-    lru.push_back(name);
-    lru_iter = lru.end();
-    --lru_iter;
+    ldout(cct, 10) << "removing entry: name=" << map_iter->first
+		   << " from cache" << dendl;
+    invalidate_chained(entry);
+    remove_entry(shard, map_iter);
   }
-
-  lru_counter++;
-  entry.lru_promotion_ts = lru_counter;
 }
 
-void ObjectCache::remove_lru(const string& name,
-			     std::list<string>::iterator& lru_iter)
+void ObjectCache::remove_entry(Shard& shard,
+			       std::unordered_map<string, ObjectCacheEntry>::iterator iter)
 {
-  if (lru_iter == lru.end())
-    return;
-
-  lru.erase(lru_iter);
-  lru_size--;
-  lru_iter = lru.end();
+  auto clock_iter = iter->second.clock_iter;
+  if (shard.hand == clock_iter) {
+    shard.hand = shard.clock.erase(clock_iter);
+  } else {
+    shard.clock.erase(clock_iter);
+  }
+  shard.cache_map.erase(iter);
 }
 
-void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
+void ObjectCache::invalidate_chained(ObjectCacheEntry& entry)
 {
   for (auto iter = entry.chained_entries.begin();
        iter != entry.chained_entries.end(); ++iter) {
@@ -286,33 +272,48 @@ void ObjectCache::invalidate_lru(ObjectCacheEntry& entry)
   }
 }
 
+void ObjectCache::lock_all()
+{
+  for (auto& shard : shards) {
+    shard.lock.get_write();
+  }
+}
+
+void ObjectCache::unlock_all()
+{
+  for (auto& shard : shards) {
+    shard.lock.unlock();
+  }
+}
+
 void ObjectCache::set_enabled(bool status)
 {
-  RWLock::WLocker l(lock);
+  lock_all();
 
   enabled = status;
 
   if (!enabled) {
     do_invalidate_all();
   }
+  unlock_all();
 }
 
 void ObjectCache::invalidate_all()
 {
-  RWLock::WLocker l(lock);
-
+  lock_all();
   do_invalidate_all();
+  unlock_all();
 }
 
 void ObjectCache::do_invalidate_all()
 {
-  cache_map.clear();
-  lru.clear();
-
-  lru_size = 0;
-  lru_counter = 0;
-  lru_window = 0;
+  for (auto& shard : shards) {
+    shard.cache_map.clear();
+    shard.clock.clear();
+    shard.hand = shard.clock.end();
+  }
 
+  RWLock::RLocker l(lock);
   for (auto& cache : chained_cache) {
     cache->invalidate_all();
   }
@@ -5,6 +5,8 @@
 #define CEPH_RGWCACHE_H
 
 #include "rgw_rados.h"
+#include <array>
+#include <atomic>
 #include <string>
 #include <map>
 #include <unordered_map>
@@ -146,37 +148,58 @@ public:
 
 struct ObjectCacheEntry {
   ObjectCacheInfo info;
-  std::list<string>::iterator lru_iter;
-  uint64_t lru_promotion_ts;
+  std::list<string>::iterator clock_iter;
+  /// set on every hit (under the shard's read lock), cleared by the clock
+  std::atomic<bool> referenced{false};
   uint64_t gen;
   std::vector<pair<RGWChainedCache *, string> > chained_entries;
 
-  ObjectCacheEntry() : lru_promotion_ts(0), gen(0) {}
+  ObjectCacheEntry() : gen(0) {}
 };
 
+/**
+ * Cache of system objects (bucket, user and other metadata).
+ *
+ * Entries are spread over shards by name, each with its own lock, and
+ * evicted per shard in CLOCK order: a hit only sets the entry's
+ * referenced bit, so lookups never need a write lock.
+ */
 class ObjectCache {
-  std::unordered_map<string, ObjectCacheEntry> cache_map;
-  std::list<string> lru;
-  unsigned long lru_size;
-  unsigned long lru_counter;
-  unsigned long lru_window;
-  RWLock lock;
+  static constexpr size_t num_shards = 32;
+
+  struct Shard {
+    std::unordered_map<string, ObjectCacheEntry> cache_map;
+    std::list<string> clock;
+    std::list<string>::iterator hand;
+    RWLock lock;
+
+    Shard() : hand(clock.end()), lock("ObjectCache::Shard") {}
+  };
+
+  std::array<Shard, num_shards> shards;
+  size_t shard_capacity;
+  std::atomic<bool> enabled;
+  RWLock lock; // protects chained_cache
   CephContext *cct;
 
   vector<RGWChainedCache *> chained_cache;
 
-  bool enabled;
   ceph::timespan expiry;
 
-  void touch_lru(const string& name, ObjectCacheEntry& entry,
-		 std::list<string>::iterator& lru_iter);
-  void remove_lru(const string& name, std::list<string>::iterator& lru_iter);
-  void invalidate_lru(ObjectCacheEntry& entry);
+  Shard& get_shard(const string& name) {
+    return shards[std::hash<string>{}(name) % num_shards];
+  }
+
+  void evict(Shard& shard, const string& keep);
+  void remove_entry(Shard& shard, std::unordered_map<string, ObjectCacheEntry>::iterator iter);
+  void invalidate_chained(ObjectCacheEntry& entry);
 
+  void lock_all();
+  void unlock_all();
   void do_invalidate_all();
 
 public:
-  ObjectCache() : lru_size(0), lru_counter(0), lru_window(0), lock("ObjectCache"), cct(NULL), enabled(false) { }
+  ObjectCache() : shard_capacity(0), enabled(false), lock("ObjectCache"), cct(NULL) { }
   ~ObjectCache();
   int get(const std::string& name, ObjectCacheInfo& bl, uint32_t mask, rgw_cache_entry_info *cache_info);
   std::optional<ObjectCacheInfo> get(const std::string& name) {
@@ -187,10 +210,13 @@ public:
 
   template<typename F>
   void for_each(const F& f) {
-    RWLock::RLocker l(lock);
-    if (enabled) {
-      auto now  = ceph::coarse_mono_clock::now();
-      for (const auto& [name, entry] : cache_map) {
+    if (!enabled) {
+      return;
+    }
+    auto now  = ceph::coarse_mono_clock::now();
+    for (auto& shard : shards) {
+      RWLock::RLocker l(shard.lock);
+      for (const auto& [name, entry] : shard.cache_map) {
         if (expiry.count() && (now - entry.info.time_added) < expiry) {
           f(name, entry);
         }
@@ -202,7 +228,8 @@ public:
   bool remove(const std::string& name);
   void set_ctx(CephContext *_cct) {
     cct = _cct;
-    lru_window = cct->_conf->rgw_cache_lru_size / 2;
+    const int64_t lru_size = std::max<int64_t>(1, cct->_conf->rgw_cache_lru_size);
+    shard_capacity = (lru_size + num_shards - 1) / num_shards;
     expiry = std::chrono::seconds(cct->_conf.get_val<uint64_t>(
 						"rgw_cache_expiry_interval"));
   }
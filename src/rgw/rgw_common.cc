@@ -917,6 +917,8 @@ void RGWHTTPArgs::append(const string& name, const string& val)
       (name.compare("requestPayment") == 0) ||
       (name.compare("torrent") == 0) ||
       (name.compare("tagging") == 0) ||
+      (name.compare("select") == 0) ||
+      (name.compare("select-type") == 0) ||
       (name.compare("append") == 0) ||
       (name.compare("position") == 0)) {
     sub_resources[name] = val;
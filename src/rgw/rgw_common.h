@@ -742,6 +742,36 @@ void decode_json_obj(rgw_placement_rule& v, JSONObj *obj);
 inline ostream& operator<<(ostream& out, const rgw_placement_rule& rule) {
   return out << rule.to_str();
 }
+
+/// the dmclock qos a user (or its tenant) is scheduled with by the beast
+/// frontend, instead of sharing the data/metadata clients' qos
+struct RGWUserQoS {
+  bool enabled{false};
+  double reservation{0};
+  double weight{0};
+  double limit{0};
+
+  void encode(bufferlist& bl) const {
+    ENCODE_START(1, 1, bl);
+    encode(enabled, bl);
+    encode(reservation, bl);
+    encode(weight, bl);
+    encode(limit, bl);
+    ENCODE_FINISH(bl);
+  }
+  void decode(bufferlist::const_iterator& bl) {
+    DECODE_START(1, bl);
+    decode(enabled, bl);
+    decode(reservation, bl);
+    decode(weight, bl);
+    decode(limit, bl);
+    DECODE_FINISH(bl);
+  }
+  void dump(Formatter *f) const;
+  void decode_json(JSONObj *obj);
+};
+WRITE_CLASS_ENCODER(RGWUserQoS)
+
 struct RGWUserInfo
 {
   rgw_user user_id;
@@ -764,6 +794,7 @@ struct RGWUserInfo
   uint32_t type;
   set<string> mfa_ids;
   string assumed_role_arn;
+  RGWUserQoS qos;
 
   RGWUserInfo()
     : suspended(0),
@@ -786,7 +817,7 @@ struct RGWUserInfo
   }
 
   void encode(bufferlist& bl) const {
-     ENCODE_START(21, 9, bl);
+     ENCODE_START(22, 9, bl);
      encode((uint64_t)0, bl); // old auid
      string access_key;
      string secret_key;
@@ -829,10 +860,11 @@ struct RGWUserInfo
      encode(type, bl);
      encode(mfa_ids, bl);
      encode(assumed_role_arn, bl);
+     encode(qos, bl);
      ENCODE_FINISH(bl);
   }
   void decode(bufferlist::const_iterator& bl) {
-     DECODE_START_LEGACY_COMPAT_LEN_32(20, 9, 9, bl);
+     DECODE_START_LEGACY_COMPAT_LEN_32(22, 9, 9, bl);
      if (struct_v >= 2) {
        uint64_t old_auid;
        decode(old_auid, bl);
@@ -913,6 +945,9 @@ struct RGWUserInfo
     if (struct_v >= 21) {
       decode(assumed_role_arn, bl);
     }
+    if (struct_v >= 22) {
+      decode(qos, bl);
+    }
     DECODE_FINISH(bl);
   }
   void dump(Formatter *f) const;
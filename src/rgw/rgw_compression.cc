@@ -7,40 +7,61 @@
 
 //------------RGWPutObj_Compress---------------
 
+RGWPutObj_Compress::RGWPutObj_Compress(CephContext* cct_,
+                                       CompressorRef compressor,
+                                       rgw::putobj::DataProcessor *next)
+  : ParallelPipe(next,
+                 [compressor] (bufferlist& in, uint64_t, bufferlist& out) {
+                   return compressor->compress(in, out);
+                 },
+                 rgw::putobj::get_filter_pool(cct_),
+                 cct_->_conf.get_val<uint64_t>("rgw_put_obj_filter_max_inflight")),
+    cct(cct_), compressor(compressor)
+{}
+
 int RGWPutObj_Compress::process(bufferlist&& in, uint64_t logical_offset)
 {
-  bufferlist out;
   if (in.length() > 0) {
-    // compression stuff
-    if ((logical_offset > 0 && compressed) || // if previous part was compressed
-        (logical_offset == 0)) {              // or it's the first part
-      ldout(cct, 10) << "Compression for rgw is enabled, compress part " << in.length() << dendl;
-      int cr = compressor->compress(in, out);
-      if (cr < 0) {
-        if (logical_offset > 0) {
-          lderr(cct) << "Compression failed with exit code " << cr
-              << " for next part, compression process failed" << dendl;
-          return -EIO;
-        }
-        compressed = false;
-        ldout(cct, 5) << "Compression failed with exit code " << cr
-            << " for first part, storing uncompressed" << dendl;
-        out.claim(in);
-      } else {
-        compressed = true;
-    
-        compression_block newbl;
-        size_t bs = blocks.size();
-        newbl.old_ofs = logical_offset;
-        newbl.new_ofs = bs > 0 ? blocks[bs-1].len + blocks[bs-1].new_ofs : 0;
-        newbl.len = out.length();
-        blocks.push_back(newbl);
+    ldout(cct, 10) << "Compression for rgw is enabled, compress part " << in.length() << dendl;
+    return submit(std::move(in), logical_offset);
+  }
+  int r = drain();
+  if (r < 0) {
+    return r;
+  }
+  return Pipe::process({}, logical_offset);
+}
+
+int RGWPutObj_Compress::complete(int cr, bufferlist&& in, bufferlist&& out,
+                                 uint64_t logical_offset)
+{
+  // the parts are compressed ahead, but whether each is stored compressed
+  // is still decided in order
+  if ((logical_offset > 0 && compressed) || // if previous part was compressed
+      (logical_offset == 0)) {              // or it's the first part
+    if (cr < 0) {
+      if (logical_offset > 0) {
+        lderr(cct) << "Compression failed with exit code " << cr
+            << " for next part, compression process failed" << dendl;
+        return -EIO;
       }
-    } else {
       compressed = false;
+      ldout(cct, 5) << "Compression failed with exit code " << cr
+          << " for first part, storing uncompressed" << dendl;
       out.claim(in);
+    } else {
+      compressed = true;
+
+      compression_block newbl;
+      size_t bs = blocks.size();
+      newbl.old_ofs = logical_offset;
+      newbl.new_ofs = bs > 0 ? blocks[bs-1].len + blocks[bs-1].new_ofs : 0;
+      newbl.len = out.length();
+      blocks.push_back(newbl);
     }
-    // end of compression stuff
+  } else {
+    compressed = false;
+    out.claim(in);
   }
   return Pipe::process(std::move(out), logical_offset);
 }
@@ -32,16 +32,20 @@ public:
 
 };
 
-class RGWPutObj_Compress : public rgw::putobj::Pipe
+/* Compresses the parts of an upload, several at a time on the filter
+ * worker threads if there are any. */
+class RGWPutObj_Compress : public rgw::putobj::ParallelPipe
 {
   CephContext* cct;
   bool compressed{false};
   CompressorRef compressor;
   std::vector<compression_block> blocks;
+
+  int complete(int r, bufferlist&& in, bufferlist&& out,
+               uint64_t logical_offset) override;
 public:
   RGWPutObj_Compress(CephContext* cct_, CompressorRef compressor,
-                     rgw::putobj::DataProcessor *next)
-    : Pipe(next), cct(cct_), compressor(compressor) {}
+                     rgw::putobj::DataProcessor *next);
 
   int process(bufferlist&& data, uint64_t logical_offset) override;
 
@@ -7,6 +7,8 @@
 // re-include our assert to clobber the system one; fix dout:
 #include "include/ceph_assert.h"
 
+#include <boost/core/demangle.hpp>
+
 #include <boost/asio/yield.hpp>
 
 #define dout_subsys ceph_subsys_rgw
@@ -207,6 +209,43 @@ RGWCoroutinesStack::RGWCoroutinesStack(CephContext *_cct, RGWCoroutinesManager *
   pos = ops.begin();
 }
 
+namespace {
+/* freed stack memory, kept by the thread that freed it */
+struct StackPool {
+  static constexpr size_t max_free = 1024;
+  std::vector<void *> entries;
+
+  ~StackPool() {
+    for (auto p : entries) {
+      ::operator delete(p);
+    }
+  }
+};
+thread_local StackPool stack_pool;
+}
+
+void *RGWCoroutinesStack::operator new(size_t size)
+{
+  auto& pool = stack_pool;
+  if (size == sizeof(RGWCoroutinesStack) && !pool.entries.empty()) {
+    void *p = pool.entries.back();
+    pool.entries.pop_back();
+    return p;
+  }
+  return ::operator new(size);
+}
+
+void RGWCoroutinesStack::operator delete(void *p, size_t size)
+{
+  auto& pool = stack_pool;
+  if (size == sizeof(RGWCoroutinesStack) &&
+      pool.entries.size() < StackPool::max_free) {
+    pool.entries.push_back(p);
+    return;
+  }
+  ::operator delete(p);
+}
+
 RGWCoroutinesStack::~RGWCoroutinesStack()
 {
   for (auto op : ops) {
@@ -568,6 +607,7 @@ void RGWCoroutinesManager::_schedule(RGWCoroutinesEnv *env, RGWCoroutinesStack *
   if (!stack->is_scheduled) {
     env->scheduled_stacks->push_back(stack);
     stack->set_is_scheduled(true);
+    stack->schedule_stamp = ceph::mono_clock::now();
   }
   set<RGWCoroutinesStack *>& context_stacks = run_contexts[env->run_context];
   context_stacks.insert(stack);
@@ -597,10 +637,12 @@ int RGWCoroutinesManager::run(list<RGWCoroutinesStack *>& stacks)
   lock.get_write();
   set<RGWCoroutinesStack *>& context_stacks = run_contexts[run_context];
   list<RGWCoroutinesStack *> scheduled_stacks;
+  auto now = ceph::mono_clock::now();
   for (auto& st : stacks) {
     context_stacks.insert(st);
     scheduled_stacks.push_back(st);
     st->set_is_scheduled(true);
+    st->schedule_stamp = now;
   }
   env.run_context = run_context;
   env.manager = this;
@@ -618,11 +660,20 @@ int RGWCoroutinesManager::run(list<RGWCoroutinesStack *>& stacks)
     }
     env.stack = stack;
 
-    lock.unlock();
+    {
+      /* the op may be gone once it's done, take its type first */
+      std::type_index op_type = typeid(**stack->pos);
+      auto start = ceph::mono_clock::now();
+
+      lock.unlock();
+
+      ret = stack->operate(&env);
 
-    ret = stack->operate(&env);
+      lock.get_write();
 
-    lock.get_write();
+      auto end = ceph::mono_clock::now();
+      cr_stats[op_type].add(end - start, start - stack->schedule_stamp);
+    }
 
     stack->set_is_scheduled(false);
     if (ret < 0) {
@@ -795,6 +846,15 @@ void RGWCoroutinesManager::dump(Formatter *f) const {
   f->close_section();
 }
 
+void RGWCoroutinesManager::get_stats(map<string, RGWCoroutineTypeStats> *stats) const
+{
+  RWLock::RLocker rl(lock);
+
+  for (auto& i : cr_stats) {
+    (*stats)[boost::core::demangle(i.first.name())].merge(i.second);
+  }
+}
+
 RGWCoroutinesStack *RGWCoroutinesManager::allocate_stack() {
   return new RGWCoroutinesStack(cct, this);
 }
@@ -872,6 +932,34 @@ void RGWCoroutinesManagerRegistry::dump(Formatter *f) const {
   f->close_section();
 }
 
+void RGWCoroutinesManagerRegistry::dump_stats(Formatter *f) const {
+  map<string, RGWCoroutineTypeStats> stats;
+  {
+    RWLock::RLocker rl(lock);
+    for (auto m : managers) {
+      m->get_stats(&stats);
+    }
+  }
+  f->open_array_section("coroutine_stats");
+  for (auto& i : stats) {
+    f->open_object_section("entry");
+    ::encode_json("type", i.first, f);
+    i.second.dump(f);
+    f->close_section();
+  }
+  f->close_section();
+}
+
+void RGWCoroutineTypeStats::dump(Formatter *f) const {
+  ::encode_json("runs", runs, f);
+  ::encode_json("run_time_us",
+                std::chrono::duration_cast<std::chrono::microseconds>(run_time).count(), f);
+  ::encode_json("max_run_time_us",
+                std::chrono::duration_cast<std::chrono::microseconds>(max_run_time).count(), f);
+  ::encode_json("queue_time_us",
+                std::chrono::duration_cast<std::chrono::microseconds>(queue_time).count(), f);
+}
+
 void RGWCoroutine::call(RGWCoroutine *op)
 {
   stack->call(op);
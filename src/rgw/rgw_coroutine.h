@@ -17,6 +17,7 @@
 #endif
 
 #include "include/utime.h"
+#include "common/ceph_time.h"
 #include "common/RefCountedObj.h"
 #include "common/debug.h"
 #include "common/Timer.h"
@@ -26,6 +27,7 @@
 #include <boost/asio/coroutine.hpp>
 
 #include <atomic>
+#include <typeindex>
 
 #define RGW_ASYNC_OPS_MGR_WINDOW 100
 
@@ -406,6 +408,8 @@ class RGWCoroutinesStack : public RefCountedObject {
 
   uint64_t run_count;
 
+  ceph::mono_time schedule_stamp; ///< when it was last queued to run
+
 protected:
   RGWCoroutinesEnv *env;
   RGWCoroutinesStack *parent;
@@ -417,6 +421,10 @@ public:
   RGWCoroutinesStack(CephContext *_cct, RGWCoroutinesManager *_ops_mgr, RGWCoroutine *start = NULL);
   ~RGWCoroutinesStack() override;
 
+  /* sync spawns and frees stacks at a high rate, recycle their memory */
+  static void *operator new(size_t size);
+  static void operator delete(void *p, size_t size);
+
   int operate(RGWCoroutinesEnv *env);
 
   bool is_done() {
@@ -538,6 +546,28 @@ void RGWConsumerCR<T>::receive(const T& p, bool wakeup)
   }
 }
 
+/* time spent running and waiting to run, per coroutine type */
+struct RGWCoroutineTypeStats {
+  uint64_t runs{0};
+  ceph::timespan run_time{ceph::timespan::zero()};
+  ceph::timespan max_run_time{ceph::timespan::zero()};
+  ceph::timespan queue_time{ceph::timespan::zero()};
+
+  void add(ceph::timespan run, ceph::timespan queued) {
+    ++runs;
+    run_time += run;
+    max_run_time = std::max(max_run_time, run);
+    queue_time += queued;
+  }
+  void merge(const RGWCoroutineTypeStats& other) {
+    runs += other.runs;
+    run_time += other.run_time;
+    max_run_time = std::max(max_run_time, other.max_run_time);
+    queue_time += other.queue_time;
+  }
+  void dump(Formatter *f) const;
+};
+
 class RGWCoroutinesManagerRegistry : public RefCountedObject, public AdminSocketHook {
   CephContext *cct;
 
@@ -558,6 +588,7 @@ public:
             std::string_view format, bufferlist& out) override;
 
   void dump(Formatter *f) const;
+  void dump_stats(Formatter *f) const;
 };
 
 class RGWCoroutinesManager {
@@ -571,6 +602,8 @@ class RGWCoroutinesManager {
 
   RWLock lock;
 
+  map<std::type_index, RGWCoroutineTypeStats> cr_stats; /* under lock */
+
   RGWIOIDProvider io_id_provider;
 
   void handle_unblocked_stack(set<RGWCoroutinesStack *>& context_stacks, list<RGWCoroutinesStack *>& scheduled_stacks,
@@ -627,6 +660,7 @@ public:
 
   virtual string get_id();
   void dump(Formatter *f) const;
+  void get_stats(map<string, RGWCoroutineTypeStats> *stats) const;
 
   RGWIOIDProvider& get_io_id_provider() {
     return io_id_provider;
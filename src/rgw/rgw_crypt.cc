@@ -681,10 +681,24 @@ int RGWGetObj_BlockDecrypt::flush() {
 RGWPutObj_BlockEncrypt::RGWPutObj_BlockEncrypt(CephContext* cct,
                                                rgw::putobj::DataProcessor *next,
                                                std::unique_ptr<BlockCrypt> crypt)
-  : Pipe(next),
+  : RGWPutObj_BlockEncrypt(cct, next, std::shared_ptr<BlockCrypt>(std::move(crypt)))
+{
+}
+
+RGWPutObj_BlockEncrypt::RGWPutObj_BlockEncrypt(CephContext* cct,
+                                               rgw::putobj::DataProcessor *next,
+                                               std::shared_ptr<BlockCrypt> crypt)
+  : ParallelPipe(next,
+                 [crypt] (bufferlist& in, uint64_t offset, bufferlist& out) {
+                   if (!crypt->encrypt(in, 0, in.length(), out, offset)) {
+                     return -ERR_INTERNAL_ERROR;
+                   }
+                   return 0;
+                 },
+                 rgw::putobj::get_filter_pool(cct),
+                 cct->_conf.get_val<uint64_t>("rgw_put_obj_filter_max_inflight")),
     cct(cct),
-    crypt(std::move(crypt)),
-    block_size(this->crypt->get_block_size())
+    block_size(crypt->get_block_size())
 {
 }
 
@@ -704,18 +718,18 @@ int RGWPutObj_BlockEncrypt::process(bufferlist&& data, uint64_t logical_offset)
     proc_size = cache.length();
   }
   if (proc_size > 0) {
-    bufferlist in, out;
+    bufferlist in;
     cache.splice(0, proc_size, &in);
-    if (!crypt->encrypt(in, 0, proc_size, out, logical_offset)) {
-      return -ERR_INTERNAL_ERROR;
-    }
-    int r = Pipe::process(std::move(out), logical_offset);
+    int r = submit(std::move(in), logical_offset);
     logical_offset += proc_size;
     if (r < 0)
       return r;
   }
 
   if (flush) {
+    int r = drain();
+    if (r < 0)
+      return r;
     /*replicate 0-sized handle_data*/
     return Pipe::process({}, logical_offset);
   }
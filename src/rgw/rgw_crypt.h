@@ -118,13 +118,21 @@ public:
 }; /* RGWGetObj_BlockDecrypt */
 
 
-class RGWPutObj_BlockEncrypt : public rgw::putobj::Pipe
+/**
+ * Encrypts the data of an upload, several chunks at a time on the filter
+ * worker threads if there are any.
+ */
+class RGWPutObj_BlockEncrypt : public rgw::putobj::ParallelPipe
 {
   CephContext* cct;
-  std::unique_ptr<BlockCrypt> crypt; /**< already configured stateless BlockCrypt
-                                          for operations when enough data is accumulated */
   bufferlist cache; /**< stores extra data that could not (yet) be processed by BlockCrypt */
   const size_t block_size; /**< snapshot of \ref BlockCrypt.get_block_size() */
+
+  /* the already configured stateless BlockCrypt is shared with the
+   * transform of the chunks, which may outlive the filter */
+  RGWPutObj_BlockEncrypt(CephContext* cct,
+                         rgw::putobj::DataProcessor *next,
+                         std::shared_ptr<BlockCrypt> crypt);
 public:
   RGWPutObj_BlockEncrypt(CephContext* cct,
                          rgw::putobj::DataProcessor *next,
@@ -2451,8 +2451,34 @@ class RGWListBucketIndexLogCR: public RGWCoroutine {
   string marker;
 
   list<rgw_bi_log_entry> *result;
+  bufferlist bl;
   std::optional<PerfGuard> timer;
 
+  /* the remote zone answers 'binary' with the encoded entries, or with
+   * json if it doesn't know it */
+  int decode_result() {
+    static constexpr size_t magic_len = sizeof(RGW_BILOG_BINARY_MAGIC) - 1;
+    result->clear();
+    auto p = bl.cbegin();
+    string magic;
+    if (bl.length() >= magic_len) {
+      p.copy(magic_len, magic);
+    }
+    if (magic != RGW_BILOG_BINARY_MAGIC) {
+      return parse_decode_json(cct, *result, bl);
+    }
+    try {
+      while (!p.end()) {
+        result->emplace_back();
+        decode(result->back(), p);
+      }
+    } catch (buffer::error& err) {
+      ldout(cct, 0) << "ERROR: failed to decode bucket index log entries" << dendl;
+      return -EIO;
+    }
+    return 0;
+  }
+
 public:
   RGWListBucketIndexLogCR(RGWDataSyncEnv *_sync_env, const rgw_bucket_shard& bs,
                           string& _marker, list<rgw_bi_log_entry> *_result)
@@ -2467,13 +2493,17 @@ public:
       yield {
         rgw_http_param_pair pairs[] = { { "bucket-instance", instance_key.c_str() },
 					{ "format" , "json" },
+					{ "binary" , "" },
 					{ "marker" , marker.c_str() },
 					{ "type", "bucket-index" },
 	                                { NULL, NULL } };
 
-        call(new RGWReadRESTResourceCR<list<rgw_bi_log_entry> >(sync_env->cct, sync_env->conn, sync_env->http_manager, "/admin/log", pairs, result));
+        call(new RGWReadRawRESTResourceCR(sync_env->cct, sync_env->conn, sync_env->http_manager, "/admin/log", pairs, &bl));
       }
       timer.reset();
+      if (retcode >= 0) {
+        retcode = decode_result();
+      }
       if (retcode < 0) {
         if (sync_env->counters) {
           sync_env->counters->inc(sync_counters::l_poll_err);
@@ -2769,6 +2799,48 @@ done:
 
 #define BUCKET_SYNC_SPAWN_WINDOW 20
 
+/*
+ * the number of entry syncs a bucket shard sync keeps in flight. starting
+ * from BUCKET_SYNC_SPAWN_WINDOW, it is measured over a window's worth of
+ * completed entries at a time: it grows by half while that raises the
+ * rate of completions, as it does on a high latency link, and shrinks
+ * back when the rate falls, as it does once the link or the remote zone
+ * is saturated
+ */
+class BucketSyncSpawnWindow {
+  const int max_window;
+  int window{BUCKET_SYNC_SPAWN_WINDOW};
+  int completed{0};
+  ceph::coarse_mono_time start{ceph::coarse_mono_clock::now()};
+  double last_rate{0};
+public:
+  explicit BucketSyncSpawnWindow(CephContext *cct)
+    : max_window(std::max<int>(BUCKET_SYNC_SPAWN_WINDOW,
+                               cct->_conf.get_val<uint64_t>("rgw_bucket_sync_max_spawn_window"))) {}
+
+  size_t get() const {
+    return window;
+  }
+
+  void complete(int n) {
+    completed += n;
+    if (completed < window) {
+      return;
+    }
+    auto now = ceph::coarse_mono_clock::now();
+    double secs = std::chrono::duration<double>(now - start).count();
+    double rate = completed / std::max(secs, 0.001);
+    if (rate > last_rate * 1.1) {
+      window = std::min(max_window, window + std::max(1, window / 2));
+    } else if (rate < last_rate * 0.9) {
+      window = std::max(BUCKET_SYNC_SPAWN_WINDOW, window * 2 / 3);
+    }
+    last_rate = rate;
+    completed = 0;
+    start = now;
+  }
+};
+
 class RGWBucketShardFullSyncCR : public RGWCoroutine {
   RGWDataSyncEnv *sync_env;
   const rgw_bucket_shard& bs;
@@ -2784,6 +2856,8 @@ class RGWBucketShardFullSyncCR : public RGWCoroutine {
   int total_entries{0};
 
   int sync_status{0};
+  BucketSyncSpawnWindow spawn_window;
+  size_t spawned{0};
 
   const string& status_oid;
 
@@ -2800,6 +2874,7 @@ public:
     : RGWCoroutine(_sync_env->cct), sync_env(_sync_env), bs(bs),
       bucket_info(_bucket_info), lease_cr(lease_cr), sync_info(sync_info),
       marker_tracker(sync_env, status_oid, sync_info.full_marker),
+      spawn_window(sync_env->cct),
       status_oid(status_oid),
       tn(sync_env->sync_tracer->add_node(tn_parent, "full_sync",
                                          SSTR(bucket_shard_str{bs}))) {
@@ -2856,8 +2931,9 @@ int RGWBucketShardFullSyncCR::operate()
                                  entry->key, &marker_tracker, zones_trace, tn),
                       false);
         }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > spawn_window.get()) {
           yield wait_for_child();
+          spawned = num_spawned();
           bool again = true;
           while (again) {
             again = collect(&ret, nullptr);
@@ -2867,6 +2943,7 @@ int RGWBucketShardFullSyncCR::operate()
               /* we have reported this error */
             }
           }
+          spawn_window.complete(spawned - num_spawned());
         }
       }
     } while (list_result.is_truncated && sync_status == 0);
@@ -2939,6 +3016,8 @@ class RGWBucketShardIncrementalSyncCR : public RGWCoroutine {
 
   int sync_status{0};
   bool syncstopped{false};
+  BucketSyncSpawnWindow spawn_window;
+  size_t spawned{0};
 
   RGWSyncTraceNodeRef tn;
 public:
@@ -2953,6 +3032,7 @@ public:
       bucket_info(_bucket_info), lease_cr(lease_cr), sync_info(sync_info),
       marker_tracker(sync_env, status_oid, sync_info.inc_marker),
       status_oid(status_oid), zone_id(_sync_env->store->svc.zone->get_zone().id),
+      spawn_window(sync_env->cct),
       tn(sync_env->sync_tracer->add_node(_tn_parent, "inc_sync",
                                          SSTR(bucket_shard_str{bs})))
   {
@@ -3137,9 +3217,10 @@ int RGWBucketShardIncrementalSyncCR::operate()
                   false);
           }
         // }
-        while (num_spawned() > BUCKET_SYNC_SPAWN_WINDOW) {
+        while (num_spawned() > spawn_window.get()) {
           set_status() << "num_spawned() > spawn_window";
           yield wait_for_child();
+          spawned = num_spawned();
           bool again = true;
           while (again) {
             again = collect(&ret, nullptr);
@@ -3150,6 +3231,7 @@ int RGWBucketShardIncrementalSyncCR::operate()
             }
             /* not waiting for child here */
           }
+          spawn_window.complete(spawned - num_spawned());
         }
       }
     } while (!list_result.empty() && sync_status == 0 && !syncstopped);
@@ -17,6 +17,11 @@
 #include "rgw_sync_module.h"
 #include "rgw_sync_trace.h"
 
+/* a bucket index log listing asked for with 'binary' starts with this,
+ * followed by the encoded rgw_bi_log_entry's. a zone that doesn't know
+ * the parameter sends json instead */
+#define RGW_BILOG_BINARY_MAGIC "rgw-bilog-binary-v1\n"
+
 struct rgw_datalog_info {
   uint32_t num_shards;
 
@@ -57,6 +57,22 @@ int AsyncScheduler::schedule_request_impl(const client_id& client,
     return 0;
 }
 
+client_id AsyncScheduler::tenant_client(const std::string& name,
+                                        const ClientInfo& info)
+{
+  if (!tenants) {
+    return client_id::count;
+  }
+  std::unique_ptr<ClientInfo> retired;
+  auto client = tenants->get(name, info.reservation, info.weight, info.limit,
+                             &retired);
+  if (retired) {
+    // the queue may still point at the old info until it's told
+    queue.update_client_info(client);
+  }
+  return client;
+}
+
 void AsyncScheduler::request_complete()
 {
   --outstanding_requests;
@@ -68,7 +84,14 @@ void AsyncScheduler::cancel()
   ClientSums sums;
 
   queue.remove_by_req_filter([&] (RequestRef&& request) {
-      inc(sums, request->client, request->cost);
+      if (is_tenant_client(request->client)) {
+        // tenant clients aren't summed, there may be any number of them
+        if (auto c = counters(request->client)) {
+          on_cancel(c, ClientSum{1, request->cost});
+        }
+      } else {
+        inc(sums, request->client, request->cost);
+      }
       auto c = static_cast<Completion*>(request.release());
       Completion::dispatch(std::unique_ptr<Completion>{c},
                            boost::asio::error::operation_aborted,
@@ -149,11 +172,21 @@ void AsyncScheduler::process(const Time& now)
 
     if (auto c = counters(client)) {
       auto lat = Clock::from_double(now) - Clock::from_double(started);
-      if (phase == PhaseType::reservation) {
+      if (is_tenant_client(client)) {
+        const ClientSum sum{1, cost};
+        if (phase == PhaseType::reservation) {
+          on_process(c, sum, ClientSum{});
+        } else {
+          on_process(c, ClientSum{}, sum);
+        }
+      } else if (phase == PhaseType::reservation) {
         inc(rsums, client, cost);
-        c->tinc(queue_counters::l_res_latency, lat);
       } else {
         inc(psums, client, cost);
+      }
+      if (phase == PhaseType::reservation) {
+        c->tinc(queue_counters::l_res_latency, lat);
+      } else {
         c->tinc(queue_counters::l_prio_latency, lat);
       }
     }
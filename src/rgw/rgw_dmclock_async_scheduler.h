@@ -56,6 +56,13 @@ class AsyncScheduler : public md_config_obs_t, public Scheduler {
   /// returns a throttle unit granted by async_request()
   void request_complete() override;
 
+  /// schedule the requests of users or tenants with a qos of their own as
+  /// clients of the given registry. its clients' infos and counters must
+  /// also be served by the ClientInfoFunc and GetClientCounters
+  void set_tenant_clients(TenantClients *t) { tenants = t; }
+  client_id tenant_client(const std::string& name,
+                          const ClientInfo& info) override;
+
   /// cancel all queued requests, invoking their completion handlers with an
   /// operation_aborted error and default-constructed result
   void cancel();
@@ -93,6 +100,7 @@ class AsyncScheduler : public md_config_obs_t, public Scheduler {
   CephContext *const cct;
   md_config_obs_t *const observer; //< observer to update ClientInfoFunc
   GetClientCounters counters; //< provides per-client perf counters
+  TenantClients *tenants = nullptr; //< per-user/tenant clients, if any
 
   /// max request throttle
   std::atomic<int64_t> max_requests;
@@ -77,6 +77,14 @@ public:
   }
   virtual void request_complete() {};
 
+  /// the client to schedule the requests of the named user or tenant as,
+  /// with a qos of its own. client_id::count if the scheduler has no
+  /// clients but the fixed ones
+  virtual client_id tenant_client(const std::string& name,
+                                  const ClientInfo& info) {
+    return client_id::count;
+  }
+
   virtual ~Scheduler() {};
 private:
   virtual int schedule_request_impl(const client_id&, const ReqParams&,
@@ -15,13 +15,17 @@
 
 namespace rgw::dmclock {
 
-ClientConfig::ClientConfig(CephContext *cct)
+ClientConfig::ClientConfig(CephContext *cct, TenantClients *tenants)
+  : tenants(tenants)
 {
   update(cct->_conf);
 }
 
 ClientInfo* ClientConfig::operator()(client_id client)
 {
+  if (is_tenant_client(client)) {
+    return tenants ? tenants->info(client) : nullptr;
+  }
   return &clients[static_cast<size_t>(client)];
 }
 
@@ -73,7 +77,98 @@ void ClientConfig::handle_conf_change(const ConfigProxy& conf,
   update(conf);
 }
 
-ClientCounters::ClientCounters(CephContext *cct)
+TenantClients::TenantClients(CephContext *cct) : cct(cct)
+{
+  for (auto& chunk : chunks) {
+    chunk = nullptr;
+  }
+}
+
+TenantClients::~TenantClients()
+{
+  const size_t n = num_clients;
+  for (size_t i = 0; i < n; i++) {
+    delete find(static_cast<client_id>(counter_size + i))->info.load();
+  }
+  for (auto& chunk : chunks) {
+    delete[] chunk.load();
+  }
+}
+
+// chunk c holds the first_chunk_size << c clients from first_chunk_size *
+// (2^c - 1) on
+static std::pair<size_t, size_t> chunk_of(size_t i, size_t first_chunk_size)
+{
+  const size_t n = i / first_chunk_size + 1;
+  const size_t c = 63 - __builtin_clzll(n);
+  return {c, i - first_chunk_size * ((size_t(1) << c) - 1)};
+}
+
+TenantClients::Client* TenantClients::find(client_id client) const
+{
+  const size_t i = static_cast<size_t>(client) - counter_size;
+  if (i >= num_clients.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  auto [c, offset] = chunk_of(i, first_chunk_size);
+  return &chunks[c].load(std::memory_order_acquire)[offset];
+}
+
+client_id TenantClients::add(const std::string& name, const ClientInfo& info)
+{
+  std::lock_guard lock{add_mutex};
+  const size_t i = num_clients.load(std::memory_order_relaxed);
+  auto [c, offset] = chunk_of(i, first_chunk_size);
+  ceph_assert(c < max_chunks);
+  auto chunk = chunks[c].load(std::memory_order_relaxed);
+  if (!chunk) {
+    chunk = new Client[first_chunk_size << c];
+    chunks[c].store(chunk, std::memory_order_release);
+  }
+  auto& client = chunk[offset];
+  client.info = new ClientInfo(info);
+  client.counters = queue_counters::build(cct, "dmclock-tenant-" + name);
+  // publishes the client to find()
+  num_clients.store(i + 1, std::memory_order_release);
+  return static_cast<client_id>(counter_size + i);
+}
+
+client_id TenantClients::get(const std::string& name, double reservation,
+                             double weight, double limit,
+                             std::unique_ptr<ClientInfo> *retired)
+{
+  auto& shard = shards[std::hash<std::string>{}(name) % num_shards];
+  std::lock_guard lock{shard.mutex};
+  auto i = shard.ids.find(name);
+  if (i == shard.ids.end()) {
+    auto id = add(name, ClientInfo{reservation, weight, limit});
+    shard.ids.emplace(name, id);
+    return id;
+  }
+  auto client = find(i->second);
+  const auto info = client->info.load();
+  if (info->reservation != reservation || info->weight != weight ||
+      info->limit != limit) {
+    retired->reset(client->info.exchange(
+        new ClientInfo{reservation, weight, limit}));
+  }
+  return i->second;
+}
+
+ClientInfo* TenantClients::info(client_id client)
+{
+  auto c = find(client);
+  return c ? c->info.load() : nullptr;
+}
+
+PerfCounters* TenantClients::counters(client_id client)
+{
+  auto c = find(client);
+  return c ? c->counters.get() : nullptr;
+}
+
+ClientCounters::ClientCounters(CephContext *cct, TenantClients *tenants)
+  : tenants(tenants)
 {
   clients[static_cast<size_t>(client_id::admin)] =
       queue_counters::build(cct, "dmclock-admin");
@@ -1,6 +1,12 @@
 #ifndef RGW_DMCLOCK_SCHEDULER_CTX_H
 #define RGW_DMCLOCK_SCHEDULER_CTX_H
 
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+
 #include "common/perf_counters.h"
 #include "common/ceph_context.h"
 #include "common/config.h"
@@ -43,13 +49,66 @@ namespace rgw::dmclock {
 
 // the last client counter would be for global scheduler stats
 static constexpr auto counter_size = static_cast<size_t>(client_id::count) + 1;
+
+/// whether the client is one of TenantClients' rather than a fixed client_id
+inline bool is_tenant_client(client_id client)
+{
+  return static_cast<size_t>(client) >= counter_size;
+}
+
+/// dmclock clients for the users (or tenants) with a qos of their own,
+/// numbered after the fixed client_ids, one per name. a changed qos is
+/// published as a new ClientInfo, which the queue must be pointed at (by
+/// update_client_info()) before the replaced one is freed. looking a
+/// client up by id takes no lock: the clients live in chunks that never
+/// move, each twice the size of the last. the ids of the names are
+/// sharded, each shard with a lock of its own
+class TenantClients {
+  struct Client {
+    std::atomic<ClientInfo*> info{nullptr};
+    PerfCountersRef counters;
+  };
+  static constexpr size_t first_chunk_size = 64;
+  static constexpr size_t max_chunks = 26; ///< room for 2^32 clients
+  static constexpr size_t num_shards = 16;
+  struct Shard {
+    std::mutex mutex;
+    std::map<std::string, client_id> ids;
+  };
+
+  CephContext *cct;
+  std::array<std::atomic<Client*>, max_chunks> chunks;
+  std::atomic<size_t> num_clients{0};
+  std::mutex add_mutex; ///< serializes adding clients, after a shard's lock
+  std::array<Shard, num_shards> shards;
+
+  Client* find(client_id client) const;
+  client_id add(const std::string& name, const ClientInfo& info);
+
+ public:
+  explicit TenantClients(CephContext *cct);
+  ~TenantClients();
+
+  /// the client to schedule the named user's or tenant's requests as. if
+  /// its qos changed, the replaced ClientInfo is handed back in *retired
+  client_id get(const std::string& name, double reservation, double weight,
+                double limit, std::unique_ptr<ClientInfo> *retired);
+
+  ClientInfo* info(client_id client);
+  PerfCounters* counters(client_id client);
+};
+
 /// array of per-client counters to serve as GetClientCounters
 class ClientCounters {
   std::array<PerfCountersRef, counter_size> clients;
+  TenantClients *tenants;
  public:
-  ClientCounters(CephContext *cct);
+  ClientCounters(CephContext *cct, TenantClients *tenants = nullptr);
 
   PerfCounters* operator()(client_id client) const {
+    if (is_tenant_client(client)) {
+      return tenants ? tenants->counters(client) : nullptr;
+    }
     return clients[static_cast<size_t>(client)].get();
   }
 };
@@ -81,11 +140,12 @@ void on_process(PerfCounters* c, const ClientSum& rsum, const ClientSum& psum);
 
 class ClientConfig : public md_config_obs_t {
   std::vector<ClientInfo> clients;
+  TenantClients *tenants;
 
   void update(const ConfigProxy &conf);
 
 public:
-  ClientConfig(CephContext *cct);
+  ClientConfig(CephContext *cct, TenantClients *tenants = nullptr);
 
   ClientInfo* operator()(client_id client);
 
@@ -99,16 +159,19 @@ public:
   SchedulerCtx(CephContext* const cct) : sched_t(get_scheduler_t(cct))
   {
     if(sched_t == scheduler_t::dmclock) {
-      dmc_client_config = std::make_shared<ClientConfig>(cct);
+      dmc_tenant_clients = std::make_unique<TenantClients>(cct);
+      dmc_client_config = std::make_shared<ClientConfig>(cct, dmc_tenant_clients.get());
       // we don't have a move only cref std::function yet
-      dmc_client_counters = std::make_optional<ClientCounters>(cct);
+      dmc_client_counters = std::make_optional<ClientCounters>(cct, dmc_tenant_clients.get());
     }
   }
   // We need to construct a std::function from a NonCopyable object
   ClientCounters& get_dmc_client_counters() { return dmc_client_counters.value(); }
   ClientConfig* const get_dmc_client_config() const { return dmc_client_config.get(); }
+  TenantClients* get_dmc_tenant_clients() const { return dmc_tenant_clients.get(); }
 private:
   scheduler_t sched_t;
+  std::unique_ptr<TenantClients> dmc_tenant_clients {nullptr};
   std::shared_ptr<ClientConfig> dmc_client_config {nullptr};
   std::optional<ClientCounters> dmc_client_counters  {std::nullopt};
 };
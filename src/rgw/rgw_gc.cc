@@ -151,13 +151,18 @@ class RGWGCIOManager {
 
 #define MAX_AIO_DEFAULT 10
   size_t max_aio{MAX_AIO_DEFAULT};
+  /* ios allowed in flight: halved when a tail io fails, so that we back
+   * off from osds that are struggling, and grown back by one for every
+   * tail io that succeeds */
+  size_t aio_window{MAX_AIO_DEFAULT};
 
 public:
   RGWGCIOManager(const DoutPrefixProvider* _dpp, CephContext *_cct, RGWGC *_gc) : dpp(_dpp),
                                                   cct(_cct),
                                                   gc(_gc),
                                                   remove_tags(cct->_conf->rgw_gc_max_objs) {
-    max_aio = cct->_conf->rgw_gc_max_concurrent_io;
+    max_aio = std::max<int64_t>(1, cct->_conf->rgw_gc_max_concurrent_io);
+    aio_window = max_aio;
   }
 
   ~RGWGCIOManager() {
@@ -168,7 +173,7 @@ public:
 
   int schedule_io(IoCtx *ioctx, const string& oid, ObjectWriteOperation *op,
 		  int index, const string& tag) {
-    while (ios.size() > max_aio) {
+    while (ios.size() >= aio_window) {
       if (gc->going_down()) {
         return 0;
       }
@@ -207,9 +212,13 @@ public:
     if (ret < 0) {
       ldpp_dout(dpp, 0) << "WARNING: gc could not remove oid=" << io.oid <<
 	", ret=" << ret << dendl;
+      aio_window = std::max<size_t>(1, aio_window / 2);
       goto done;
     }
 
+    if (aio_window < max_aio) {
+      ++aio_window;
+    }
     schedule_tag_removal(io.index, io.tag);
 
   done:
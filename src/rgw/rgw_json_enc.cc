@@ -510,6 +510,7 @@ void RGWUserInfo::dump(Formatter *f) const
   }
   encode_json("type", user_source_type, f);
   encode_json("mfa_ids", mfa_ids, f);
+  encode_json("qos", qos, f);
 }
 
 
@@ -580,6 +581,23 @@ void RGWUserInfo::decode_json(JSONObj *obj)
     type = TYPE_NONE;
   }
   JSONDecoder::decode_json("mfa_ids", mfa_ids, obj);
+  JSONDecoder::decode_json("qos", qos, obj);
+}
+
+void RGWUserQoS::dump(Formatter *f) const
+{
+  f->dump_bool("enabled", enabled);
+  f->dump_float("reservation", reservation);
+  f->dump_float("weight", weight);
+  f->dump_float("limit", limit);
+}
+
+void RGWUserQoS::decode_json(JSONObj *obj)
+{
+  JSONDecoder::decode_json("enabled", enabled, obj);
+  JSONDecoder::decode_json("reservation", reservation, obj);
+  JSONDecoder::decode_json("weight", weight, obj);
+  JSONDecoder::decode_json("limit", limit, obj);
 }
 
 void RGWQuotaInfo::dump(Formatter *f) const
@@ -463,17 +463,18 @@ bool TokenCache::find_locked(const std::string& token_id,
   }
 
   token_entry& entry = iter->second;
-  tokens_lru.erase(entry.lru_iter);
 
   if (entry.token.expired()) {
+    tokens_lru.erase(entry.lru_iter);
     tokens.erase(iter);
     if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_hit);
     return false;
   }
   token = entry.token;
 
-  tokens_lru.push_front(token_id);
-  entry.lru_iter = tokens_lru.begin();
+  /* Relinking the node is enough to bump the entry: no need to allocate
+   * while holding the lock every request takes. */
+  tokens_lru.splice(tokens_lru.begin(), tokens_lru, entry.lru_iter);
 
   if (perfcounter) perfcounter->inc(l_rgw_keystone_token_cache_hit);
 
@@ -508,7 +509,9 @@ void TokenCache::add_locked(const std::string& token_id,
   map<string, token_entry>::iterator iter = tokens.find(token_id);
   if (iter != tokens.end()) {
     token_entry& e = iter->second;
-    tokens_lru.erase(e.lru_iter);
+    e.token = token;
+    tokens_lru.splice(tokens_lru.begin(), tokens_lru, e.lru_iter);
+    return;
   }
 
   tokens_lru.push_front(token_id);
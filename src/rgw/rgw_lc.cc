@@ -16,6 +16,7 @@
 #include "rgw_common.h"
 #include "rgw_bucket.h"
 #include "rgw_lc.h"
+#include "rgw_perf_counters.h"
 #include "rgw_string.h"
 
 #include "services/svc_sys_obj.h"
@@ -379,6 +380,8 @@ int RGWLC::handle_multipart_expiration(RGWRados::Bucket *target, const map<strin
             ldpp_dout(this, 0) << "ERROR: abort_multipart_upload failed, ret=" << ret << ", meta:" << obj_iter->key << dendl;
           } else if (ret == -ERR_NO_SUCH_UPLOAD) {
             ldpp_dout(this, 5) << "ERROR: abort_multipart_upload failed, ret=" << ret << ", meta:" << obj_iter->key << dendl;
+          } else if (perfcounter) {
+            perfcounter->inc(l_rgw_lc_abort_mpu);
           }
           if (going_down())
             return 0;
@@ -395,7 +398,7 @@ static int read_obj_tags(RGWRados *store, RGWBucketInfo& bucket_info, rgw_obj& o
   RGWRados::Object op_target(store, bucket_info, ctx, obj);
   RGWRados::Object::Read read_op(&op_target);
 
-  return read_op.get_attr(RGW_ATTR_TAGS, tags_bl);
+  return read_op.get_attr(RGW_ATTR_TAGS, tags_bl, null_yield);
 }
 
 static bool is_valid_op(const lc_op& op)
@@ -705,6 +708,9 @@ public:
       return r;
     }
     ldout(oc.cct, 2) << "DELETED:" << oc.bucket_info.bucket << ":" << o.key << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_expire_current);
+    }
     return 0;
   }
 };
@@ -734,6 +740,9 @@ public:
       return r;
     }
     ldout(oc.cct, 2) << "DELETED:" << oc.bucket_info.bucket << ":" << o.key << " (non-current expiration)" << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_expire_noncurrent);
+    }
     return 0;
   }
 };
@@ -765,6 +774,9 @@ public:
       return r;
     }
     ldout(oc.cct, 2) << "DELETED:" << oc.bucket_info.bucket << ":" << o.key << " (delete marker expiration)" << dendl;
+    if (perfcounter) {
+      perfcounter->inc(l_rgw_lc_expire_dm);
+    }
     return 0;
   }
 };
@@ -828,6 +840,10 @@ public:
       return r;
     }
     ldpp_dout(oc.dpp, 2) << "TRANSITIONED:" << oc.bucket_info.bucket << ":" << o.key << " -> " << transition.storage_class << dendl;
+    if (perfcounter) {
+      perfcounter->inc(o.is_current() ? l_rgw_lc_transition_current :
+                                        l_rgw_lc_transition_noncurrent);
+    }
     return 0;
   }
 };
@@ -1107,15 +1123,32 @@ int RGWLC::process()
   int max_secs = cct->_conf->rgw_lc_lock_max_time;
 
   const int start = ceph::util::generate_random_number(0, max_objs - 1);
+  const int workers = std::min<int64_t>(
+    max_objs, cct->_conf.get_val<int64_t>("rgw_lc_max_worker"));
+
+  // each worker takes the next shard, and processes its buckets, until
+  // all shards are done or one of them fails
+  std::atomic<int> next{0};
+  std::atomic<int> result{0};
+  auto work = [&] {
+    for (int i = next++; i < max_objs && result == 0; i = next++) {
+      int index = (i + start) % max_objs;
+      int ret = process(index, max_secs);
+      if (ret < 0)
+        result = ret;
+    }
+  };
 
-  for (int i = 0; i < max_objs; i++) {
-    int index = (i + start) % max_objs;
-    int ret = process(index, max_secs);
-    if (ret < 0)
-      return ret;
+  std::vector<std::thread> threads;
+  for (int i = 1; i < workers; i++) {
+    threads.push_back(make_named_thread("lifecycle_wp", work));
+  }
+  work();
+  for (auto& t : threads) {
+    t.join();
   }
 
-  return 0;
+  return result;
 }
 
 int RGWLC::process(int index, int max_lock_secs)
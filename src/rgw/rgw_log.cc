@@ -15,8 +15,12 @@
 #include "rgw_rest.h"
 #include "rgw_zone.h"
 
+#include "rgw_perf_counters.h"
+
 #include "services/svc_zone.h"
 
+#include <array>
+
 #define dout_subsys ceph_subsys_rgw
 
 static void set_param_str(struct req_state *s, const char *name, string& str)
@@ -87,15 +91,30 @@ string render_log_object_name(const string& format,
 }
 
 /* usage logger */
+/*
+ * Usage is aggregated per user and bucket in a few independently locked
+ * shards, so that requests don't all serialize on one lock, and written
+ * out by the timer thread only: a request that takes the aggregate over
+ * rgw_usage_log_flush_threshold just schedules a flush. While the writes
+ * can't keep up, new entries beyond rgw_usage_log_max_pending_entries
+ * are dropped (and counted) rather than growing without bound.
+ */
 class UsageLogger {
+  static constexpr size_t NUM_SHARDS = 16;
+
+  struct Shard {
+    Mutex lock{"UsageLogger::Shard"};
+    map<rgw_user_bucket, RGWUsageBatch> usage_map;
+  };
+
   CephContext *cct;
   RGWRados *store;
-  map<rgw_user_bucket, RGWUsageBatch> usage_map;
-  Mutex lock;
-  int32_t num_entries;
+  std::array<Shard, NUM_SHARDS> shards;
+  std::atomic<int32_t> num_entries{0};
+  std::atomic<bool> flush_pending{false};
+  std::atomic<uint64_t> dropped{0};
   Mutex timer_lock;
   SafeTimer timer;
-  utime_t round_timestamp;
 
   class C_UsageLogTimeout : public Context {
     UsageLogger *logger;
@@ -107,17 +126,38 @@ class UsageLogger {
     }
   };
 
+  class C_UsageLogFlush : public Context {
+    UsageLogger *logger;
+  public:
+    explicit C_UsageLogFlush(UsageLogger *_l) : logger(_l) {}
+    void finish(int r) override {
+      logger->flush();
+    }
+  };
+
   void set_timer() {
     timer.add_event_after(cct->_conf->rgw_usage_log_tick_interval, new C_UsageLogTimeout(this));
   }
+
+  Shard& get_shard(const rgw_user_bucket& ub) {
+    size_t h = std::hash<string>()(ub.user);
+    h ^= std::hash<string>()(ub.bucket) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return shards[h % NUM_SHARDS];
+  }
+
+  void request_flush() {
+    if (flush_pending.exchange(true)) {
+      return;
+    }
+    Mutex::Locker l(timer_lock);
+    timer.add_event_after(0, new C_UsageLogFlush(this));
+  }
 public:
 
-  UsageLogger(CephContext *_cct, RGWRados *_store) : cct(_cct), store(_store), lock("UsageLogger"), num_entries(0), timer_lock("UsageLogger::timer_lock"), timer(cct, timer_lock) {
+  UsageLogger(CephContext *_cct, RGWRados *_store) : cct(_cct), store(_store), timer_lock("UsageLogger::timer_lock"), timer(cct, timer_lock) {
     timer.init();
     Mutex::Locker l(timer_lock);
     set_timer();
-    utime_t ts = ceph_clock_now();
-    recalc_round_timestamp(ts);
   }
 
   ~UsageLogger() {
@@ -127,27 +167,38 @@ public:
     timer.shutdown();
   }
 
-  void recalc_round_timestamp(utime_t& ts) {
-    round_timestamp = ts.round_to_hour();
-  }
-
   void insert_user(utime_t& timestamp, const rgw_user& user, rgw_usage_log_entry& entry) {
-    lock.Lock();
-    if (timestamp.sec() > round_timestamp + 3600)
-      recalc_round_timestamp(timestamp);
+    utime_t round_timestamp = timestamp.round_to_hour();
     entry.epoch = round_timestamp.sec();
-    bool account;
     string u = user.to_str();
     rgw_user_bucket ub(u, entry.bucket);
     real_time rt = round_timestamp.to_real_time();
-    usage_map[ub].insert(rt, entry, &account);
-    if (account)
-      num_entries++;
-    bool need_flush = (num_entries > cct->_conf->rgw_usage_log_flush_threshold);
-    lock.Unlock();
-    if (need_flush) {
-      Mutex::Locker l(timer_lock);
-      flush();
+
+    Shard& shard = get_shard(ub);
+    {
+      Mutex::Locker l(shard.lock);
+      auto iter = shard.usage_map.find(ub);
+      if (iter == shard.usage_map.end() &&
+          num_entries >= cct->_conf->rgw_usage_log_max_pending_entries) {
+        uint64_t n = ++dropped;
+        if (perfcounter) {
+          perfcounter->inc(l_rgw_usage_log_dropped);
+        }
+        if (n == 1) {
+          ldout(cct, 0) << "WARNING: usage log backlog is full, dropping "
+              "new usage entries" << dendl;
+        }
+        ldout(cct, 10) << "usage log backlog is full, dropped " << n
+            << " usage entries so far" << dendl;
+        return;
+      }
+      bool account;
+      shard.usage_map[ub].insert(rt, entry, &account);
+      if (account)
+        num_entries++;
+    }
+    if (num_entries > cct->_conf->rgw_usage_log_flush_threshold) {
+      request_flush();
     }
   }
 
@@ -159,14 +210,21 @@ public:
     }
   }
 
+  /* called with timer_lock held */
   void flush() {
     map<rgw_user_bucket, RGWUsageBatch> old_map;
-    lock.Lock();
-    old_map.swap(usage_map);
-    num_entries = 0;
-    lock.Unlock();
+    for (auto& shard : shards) {
+      Mutex::Locker l(shard.lock);
+      for (auto& i : shard.usage_map) {
+        num_entries -= i.second.m.size();
+      }
+      old_map.merge(shard.usage_map);
+    }
 
-    store->log_usage(old_map);
+    if (!old_map.empty()) {
+      store->log_usage(old_map);
+    }
+    flush_pending = false;
   }
 };
 
@@ -276,39 +334,28 @@ void rgw_format_ops_log_entry(struct rgw_log_entry& entry, Formatter *formatter)
   formatter->close_section();
 }
 
-void OpsLogSocket::formatter_to_bl(bufferlist& bl)
-{
-  stringstream ss;
-  formatter->flush(ss);
-  const string& s = ss.str();
-
-  bl.append(s);
-}
-
 void OpsLogSocket::init_connection(bufferlist& bl)
 {
   bl.append("[");
 }
 
-OpsLogSocket::OpsLogSocket(CephContext *cct, uint64_t _backlog) : OutputDataSocket(cct, _backlog), lock("OpsLogSocket")
+OpsLogSocket::OpsLogSocket(CephContext *cct, uint64_t _backlog) : OutputDataSocket(cct, _backlog)
 {
-  formatter = new JSONFormatter;
   delim.append(",\n");
 }
 
 OpsLogSocket::~OpsLogSocket()
 {
-  delete formatter;
 }
 
 void OpsLogSocket::log(struct rgw_log_entry& entry)
 {
-  bufferlist bl;
+  // format with a formatter of our own, rather than share one under a lock
+  JSONFormatter formatter;
+  rgw_format_ops_log_entry(entry, &formatter);
 
-  lock.Lock();
-  rgw_format_ops_log_entry(entry, formatter);
-  formatter_to_bl(bl);
-  lock.Unlock();
+  bufferlist bl;
+  formatter.flush(bl);
 
   append_output(bl);
 }
@@ -116,11 +116,6 @@ struct rgw_log_entry {
 WRITE_CLASS_ENCODER(rgw_log_entry)
 
 class OpsLogSocket : public OutputDataSocket {
-  Formatter *formatter;
-  Mutex lock;
-
-  void formatter_to_bl(bufferlist& bl);
-
 protected:
   void init_connection(bufferlist& bl) override;
 
@@ -9,6 +9,7 @@
 #include <sstream>
 
 #include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/bind.hpp>
 #include <boost/optional.hpp>
 #include <boost/utility/in_place_factory.hpp>
@@ -236,7 +237,8 @@ static int get_obj_policy_from_attr(CephContext *cct,
 				    map<string, bufferlist>& bucket_attrs,
 				    RGWAccessControlPolicy *policy,
                                     string *storage_class,
-				    rgw_obj& obj)
+				    rgw_obj& obj,
+                                    optional_yield y)
 {
   bufferlist bl;
   int ret = 0;
@@ -244,7 +246,7 @@ static int get_obj_policy_from_attr(CephContext *cct,
   RGWRados::Object op_target(store, bucket_info, obj_ctx, obj);
   RGWRados::Object::Read rop(&op_target);
 
-  ret = rop.get_attr(RGW_ATTR_ACL, bl);
+  ret = rop.get_attr(RGW_ATTR_ACL, bl, y);
   if (ret >= 0) {
     ret = decode_policy(cct, bl, policy);
     if (ret < 0)
@@ -262,7 +264,7 @@ static int get_obj_policy_from_attr(CephContext *cct,
 
   if (storage_class) {
     bufferlist scbl;
-    int r = rop.get_attr(RGW_ATTR_STORAGE_CLASS, scbl);
+    int r = rop.get_attr(RGW_ATTR_STORAGE_CLASS, scbl, y);
     if (r >= 0) {
       *storage_class = scbl.to_str();
     } else {
@@ -327,7 +329,7 @@ static int get_obj_attrs(RGWRados *store, struct req_state *s, const rgw_obj& ob
 
   read_op.params.attrs = &attrs;
 
-  return read_op.prepare();
+  return read_op.prepare(s->yield);
 }
 
 static int get_obj_head(RGWRados *store, struct req_state *s,
@@ -342,7 +344,7 @@ static int get_obj_head(RGWRados *store, struct req_state *s,
 
   read_op.params.attrs = attrs;
 
-  int ret = read_op.prepare();
+  int ret = read_op.prepare(s->yield);
   if (ret < 0) {
     return ret;
   }
@@ -447,7 +449,7 @@ static int modify_obj_attr(RGWRados *store, struct req_state *s, const rgw_obj&
 
   read_op.params.attrs = &attrs;
   
-  int r = read_op.prepare();
+  int r = read_op.prepare(s->yield);
   if (r < 0) {
     return r;
   }
@@ -514,7 +516,8 @@ static int read_obj_policy(RGWRados *store,
 
   RGWObjectCtx *obj_ctx = static_cast<RGWObjectCtx *>(s->obj_ctx);
   int ret = get_obj_policy_from_attr(s->cct, store, *obj_ctx,
-                                     bucket_info, bucket_attrs, acl, storage_class, obj);
+                                     bucket_info, bucket_attrs, acl, storage_class, obj,
+                                     s->yield);
   if (ret == -ENOENT) {
     /* object does not exist checking the bucket's ACL to make sure
        that we send a proper error code */
@@ -1404,7 +1407,7 @@ int RGWGetObj::read_user_manifest_part(rgw_bucket& bucket,
   read_op.params.attrs = &attrs;
   read_op.params.obj_size = &obj_size;
 
-  op_ret = read_op.prepare();
+  op_ret = read_op.prepare(s->yield);
   if (op_ret < 0)
     return op_ret;
   op_ret = read_op.range_to_ofs(ent.meta.accounted_size, cur_ofs, cur_end);
@@ -1967,6 +1970,7 @@ void RGWGetObj::execute()
   RGWGetObj_Filter* filter = (RGWGetObj_Filter *)&cb;
   boost::optional<RGWGetObj_Decompress> decompress;
   std::unique_ptr<RGWGetObj_Filter> decrypt;
+  std::unique_ptr<RGWGetObj_Filter> select;
   map<string, bufferlist>::iterator attr_iter;
 
   perfcounter->inc(l_rgw_get);
@@ -1993,7 +1997,7 @@ void RGWGetObj::execute()
   read_op.params.lastmod = &lastmod;
   read_op.params.obj_size = &s->obj_size;
 
-  op_ret = read_op.prepare();
+  op_ret = read_op.prepare(s->yield);
   if (op_ret < 0)
     goto done_err;
   version_id = read_op.state.obj.key.instance;
@@ -2031,6 +2035,14 @@ void RGWGetObj::execute()
   }
   /* end gettorrent */
 
+  op_ret = get_select_filter(&select, filter);
+  if (op_ret < 0) {
+    goto done_err;
+  }
+  if (select) {
+    filter = select.get();
+  }
+
   op_ret = rgw_compression_info_from_attrset(attrs, need_decompress, cs_info);
   if (op_ret < 0) {
     ldpp_dout(s, 0) << "ERROR: failed to decode compression info, cannot decompress" << dendl;
@@ -3476,7 +3488,7 @@ int RGWPutObj::get_data(const off_t fst, const off_t lst, bufferlist& bl)
   read_op.params.obj_size = &obj_size;
   read_op.params.attrs = &attrs;
 
-  ret = read_op.prepare();
+  ret = read_op.prepare(s->yield);
   if (ret < 0)
     return ret;
 
@@ -3769,7 +3781,11 @@ void RGWPutObj::execute()
     }
 
     if (need_calc_md5) {
-      hash.Update((const unsigned char *)data.c_str(), data.length());
+      // hash the buffers in place; c_str() would copy a data bufferlist
+      // made of several buffers into one
+      for (const auto& bp : data.buffers()) {
+        hash.Update((const unsigned char *)bp.c_str(), bp.length());
+      }
     }
 
     /* update torrrent */
@@ -4055,7 +4071,9 @@ void RGWPostObj::execute()
         break;
       }
 
-      hash.Update((const unsigned char *)data.c_str(), data.length());
+      for (const auto& bp : data.buffers()) {
+        hash.Update((const unsigned char *)bp.c_str(), bp.length());
+      }
       op_ret = filter->process(std::move(data), ofs);
 
       ofs += len;
@@ -6075,7 +6093,6 @@ void RGWDeleteMultiObj::pre_exec()
 void RGWDeleteMultiObj::execute()
 {
   RGWMultiDelDelete *multi_delete;
-  vector<rgw_obj_key>::iterator iter;
   RGWMultiDelXMLParser parser;
   RGWObjectCtx *obj_ctx = static_cast<RGWObjectCtx *>(s->obj_ctx);
   char* buf;
@@ -6141,54 +6158,98 @@ void RGWDeleteMultiObj::execute()
     goto done;
   }
 
-  for (iter = multi_delete->objects.begin();
-        iter != multi_delete->objects.end();
-        ++iter) {
-    rgw_obj obj(bucket, *iter);
-    if (s->iam_policy || ! s->iam_user_policies.empty()) {
-      auto usr_policy_res = eval_user_policies(s->iam_user_policies, s->env,
-                                              boost::none,
-                                              iter->instance.empty() ?
-                                              rgw::IAM::s3DeleteObject :
-                                              rgw::IAM::s3DeleteObjectVersion,
-                                              ARN(obj));
-      if (usr_policy_res == Effect::Deny) {
-        send_partial_response(*iter, false, "", -EACCES);
-        continue;
-      }
+  {
+    auto& objects = multi_delete->objects;
+    auto delete_one = [&](rgw_obj_key& key, optional_yield y) {
+      rgw_obj obj(bucket, key);
+      if (s->iam_policy || ! s->iam_user_policies.empty()) {
+        auto usr_policy_res = eval_user_policies(s->iam_user_policies, s->env,
+                                                boost::none,
+                                                key.instance.empty() ?
+                                                rgw::IAM::s3DeleteObject :
+                                                rgw::IAM::s3DeleteObjectVersion,
+                                                ARN(obj));
+        if (usr_policy_res == Effect::Deny) {
+          send_partial_response(key, false, "", -EACCES);
+          return;
+        }
 
-      rgw::IAM::Effect e = Effect::Pass;
-      if (s->iam_policy) {
-        e = s->iam_policy->eval(s->env,
-				   *s->auth.identity,
-				   iter->instance.empty() ?
-				   rgw::IAM::s3DeleteObject :
-				   rgw::IAM::s3DeleteObjectVersion,
-				   ARN(obj));
-      }
-      if ((e == Effect::Deny) ||
-	  (usr_policy_res == Effect::Pass && e == Effect::Pass && !acl_allowed)) {
-	send_partial_response(*iter, false, "", -EACCES);
-	continue;
+        rgw::IAM::Effect e = Effect::Pass;
+        if (s->iam_policy) {
+          e = s->iam_policy->eval(s->env,
+                                  *s->auth.identity,
+                                  key.instance.empty() ?
+                                  rgw::IAM::s3DeleteObject :
+                                  rgw::IAM::s3DeleteObjectVersion,
+                                  ARN(obj));
+        }
+        if ((e == Effect::Deny) ||
+            (usr_policy_res == Effect::Pass && e == Effect::Pass && !acl_allowed)) {
+          send_partial_response(key, false, "", -EACCES);
+          return;
+        }
       }
-    }
 
-    obj_ctx->set_atomic(obj);
+      obj_ctx->set_atomic(obj);
 
-    RGWRados::Object del_target(store, s->bucket_info, *obj_ctx, obj);
-    RGWRados::Object::Delete del_op(&del_target);
+      RGWRados::Object del_target(store, s->bucket_info, *obj_ctx, obj);
+      RGWRados::Object::Delete del_op(&del_target);
 
-    del_op.params.bucket_owner = s->bucket_owner.get_id();
-    del_op.params.versioning_status = s->bucket_info.versioning_status();
-    del_op.params.obj_owner = s->owner;
+      del_op.params.bucket_owner = s->bucket_owner.get_id();
+      del_op.params.versioning_status = s->bucket_info.versioning_status();
+      del_op.params.obj_owner = s->owner;
 
-    op_ret = del_op.delete_obj();
-    if (op_ret == -ENOENT) {
-      op_ret = 0;
+      int r = del_op.delete_obj(y);
+      if (r == -ENOENT) {
+        r = 0;
+      }
+      send_partial_response(key, del_op.result.delete_marker,
+                            del_op.result.version_id, r);
+    };
+
+    /* a key named twice is deleted in order */
+    uint64_t max_aio = s->cct->_conf.get_val<uint64_t>("rgw_delete_multi_obj_max_concurrency");
+    if (set<rgw_obj_key>(objects.begin(), objects.end()).size() < objects.size()) {
+      max_aio = 1;
+    }
+
+#ifdef HAVE_BOOST_CONTEXT
+    if (s->yield && max_aio > 1) {
+      /* the deletions are independent of each other, so run them in
+       * coroutines, up to max_aio at a time. they run on our strand, so
+       * nothing they share needs a lock.  the writes to the client must
+       * use our own yield context, so they leave the results in the
+       * formatter, and wake us to flush it */
+      auto& io = s->yield.get_io_context();
+      auto& yield = s->yield.get_yield_context();
+      boost::asio::steady_timer wake(io);
+      uint64_t aio_count = 0;
+      auto wait_until = [&] (uint64_t count) {
+        while (aio_count > count) {
+          wake.expires_at(boost::asio::steady_timer::time_point::max());
+          boost::system::error_code ec;
+          wake.async_wait(yield[ec]);
+          rgw_flush_formatter(s, s->formatter);
+        }
+      };
+      for (auto& key : objects) {
+        wait_until(max_aio - 1);
+        ++aio_count;
+        boost::asio::spawn(yield, [&] (boost::asio::yield_context yc) {
+            delete_one(key, optional_yield{io, yc});
+            --aio_count;
+            wake.cancel();
+          });
+      }
+      wait_until(0);
+    } else
+#endif
+    {
+      for (auto& key : objects) {
+        delete_one(key, s->yield);
+        rgw_flush_formatter(s, s->formatter);
+      }
     }
-
-    send_partial_response(*iter, del_op.result.delete_marker,
-			  del_op.result.version_id, op_ret);
   }
 
   /*  set the return code to zero, errors at this point will be
@@ -7046,7 +7107,7 @@ void RGWGetObjLayout::execute()
                           rgw_obj(s->bucket, s->object));
   RGWRados::Object::Read stat_op(&target);
 
-  op_ret = stat_op.prepare();
+  op_ret = stat_op.prepare(s->yield);
   if (op_ret < 0) {
     return;
   }
@@ -361,6 +361,13 @@ public:
     *filter = nullptr;
     return 0;
   }
+  /**
+   * calculates filter used to return only part of the (plain) object data
+   */
+  virtual int get_select_filter(std::unique_ptr<RGWGetObj_Filter>* filter, RGWGetObj_Filter* cb) {
+    *filter = nullptr;
+    return 0;
+  }
   dmc::client_id dmclock_client() override { return dmc::client_id::data; }
 };
 
@@ -1833,6 +1840,7 @@ public:
   virtual int get_params() = 0;
   virtual void send_status() = 0;
   virtual void begin_response() = 0;
+  // formats the result of a key; execute() flushes it to the client
   virtual void send_partial_response(rgw_obj_key& key, bool delete_marker,
                                      const string& marker_version_id, int ret) = 0;
   virtual void end_response() = 0;
@@ -43,6 +43,15 @@ enum {
   l_rgw_pubsub_push_pending,
   l_rgw_pubsub_missing_conf,
 
+  l_rgw_lc_expire_current,
+  l_rgw_lc_expire_noncurrent,
+  l_rgw_lc_expire_dm,
+  l_rgw_lc_transition_current,
+  l_rgw_lc_transition_noncurrent,
+  l_rgw_lc_abort_mpu,
+
+  l_rgw_usage_log_dropped,
+
   l_rgw_last,
 };
 
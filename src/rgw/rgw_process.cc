@@ -56,6 +56,46 @@ auto schedule_request(Scheduler *scheduler, req_state *s, RGWOp *op)
                                      s->yield);
 }
 
+/// reschedule an authenticated request as the dmclock client of its user
+/// (or tenant), if it has a qos of its own. the throttle unit granted to
+/// the request's class is returned in exchange for the tenant's
+static int schedule_tenant_request(Scheduler *scheduler, req_state *s,
+                                   RGWOp *op,
+                                   rgw::dmclock::SchedulerCompleter& c)
+{
+  using rgw::dmclock::SchedulerCompleter;
+  if (!scheduler || !s->user->qos.enabled)
+    return 0;
+
+  const auto& user = s->user->user_id;
+  std::string name;
+  if (s->cct->_conf.get_val<bool>("rgw_dmclock_qos_per_tenant") &&
+      !user.tenant.empty()) {
+    name = user.tenant;
+  } else {
+    name = user.to_str();
+  }
+  const auto& qos = s->user->qos;
+  const auto client = scheduler->tenant_client(
+      name, rgw::dmclock::ClientInfo{qos.reservation, qos.weight, qos.limit});
+  if (client == rgw::dmclock::client_id::count)
+    return 0;
+
+  const auto cost = op->dmclock_cost();
+  ldpp_dout(op,10) << "rescheduling with dmclock client=" << name
+		   << " cost=" << cost << dendl;
+  // drop the class's completer without running it, and give its throttle
+  // unit back here instead
+  c = SchedulerCompleter{};
+  scheduler->request_complete();
+
+  int r;
+  std::tie(r, c) = scheduler->schedule_request(client, {},
+                                               req_state::Clock::to_double(s->time),
+                                               cost, s->yield);
+  return r;
+}
+
 bool RGWProcess::RGWWQ::_enqueue(RGWRequest* req) {
   process->m_req_queue.push_back(req);
   perfcounter->inc(l_rgw_qlen);
@@ -274,6 +314,16 @@ int process_request(RGWRados* const store,
     goto done;
   }
 
+  ret = schedule_tenant_request(scheduler, s, op, c);
+  if (ret < 0) {
+    if (ret == -EAGAIN) {
+      ret = -ERR_RATE_LIMITED;
+    }
+    ldpp_dout(op,0) << "Scheduling request failed with " << ret << dendl;
+    abort_early(s, op, ret, handler);
+    goto done;
+  }
+
   ret = rgw_process_authenticated(handler, op, req, s);
   if (ret < 0) {
     abort_early(s, op, ret, handler);
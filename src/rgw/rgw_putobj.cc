@@ -13,6 +13,10 @@
  *
  */
 
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include "common/ceph_context.h"
 #include "rgw_putobj.h"
 
 namespace rgw::putobj {
@@ -96,4 +100,90 @@ int StripeProcessor::process(bufferlist&& data, uint64_t offset)
   return Pipe::process(std::move(data), offset - bounds.first);
 }
 
+boost::asio::thread_pool* get_filter_pool(CephContext *cct)
+{
+  // sized once, at the first upload through the filters
+  static const auto threads =
+    cct->_conf.get_val<uint64_t>("rgw_put_obj_filter_threads");
+  if (!threads) {
+    return nullptr;
+  }
+  static boost::asio::thread_pool pool(threads);
+  return &pool;
+}
+
+ParallelPipe::ParallelPipe(DataProcessor *next, Transform&& transform,
+                           boost::asio::thread_pool *pool, size_t window)
+  : Pipe(next), transform(std::move(transform)), pool(pool),
+    window(std::max<size_t>(window, 1))
+{}
+
+ParallelPipe::~ParallelPipe()
+{
+  for (auto& chunk : pending) {
+    chunk->done.wait();
+  }
+}
+
+int ParallelPipe::complete(int r, bufferlist&& in, bufferlist&& out,
+                           uint64_t offset)
+{
+  if (r < 0) {
+    return r;
+  }
+  return Pipe::process(std::move(out), offset);
+}
+
+int ParallelPipe::complete_one()
+{
+  auto chunk = std::move(pending.front());
+  pending.pop_front();
+  chunk->done.wait();
+  return complete(chunk->r, std::move(chunk->in), std::move(chunk->out),
+                  chunk->offset);
+}
+
+int ParallelPipe::submit(bufferlist&& data, uint64_t offset)
+{
+  if (!pool) {
+    bufferlist out;
+    int r = transform(data, offset, out);
+    return complete(r, std::move(data), std::move(out), offset);
+  }
+
+  auto chunk = std::make_unique<Chunk>();
+  chunk->in = std::move(data);
+  chunk->offset = offset;
+  auto done = std::make_shared<std::promise<void>>();
+  chunk->done = done->get_future();
+  // the chunk stays in pending, at the same address, until it's done
+  boost::asio::post(*pool, [this, c = chunk.get(), done] {
+      c->r = transform(c->in, c->offset, c->out);
+      done->set_value();
+    });
+  pending.push_back(std::move(chunk));
+
+  while (pending.size() > window ||
+         (!pending.empty() &&
+          pending.front()->done.wait_for(std::chrono::seconds(0)) ==
+            std::future_status::ready)) {
+    int r = complete_one();
+    if (r < 0) {
+      return r;
+    }
+  }
+  return 0;
+}
+
+int ParallelPipe::drain()
+{
+  while (!pending.empty()) {
+    int r = complete_one();
+    if (r < 0) {
+      return r;
+    }
+  }
+  return 0;
+}
+
 } // namespace rgw::putobj
@@ -15,8 +15,16 @@
 
 #pragma once
 
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+
 #include "include/buffer.h"
 
+class CephContext;
+namespace boost::asio { class thread_pool; }
+
 namespace rgw::putobj {
 
 // a simple streaming data processing abstraction
@@ -76,4 +84,48 @@ class StripeProcessor : public Pipe {
   int process(bufferlist&& data, uint64_t data_offset) override;
 };
 
+// the worker threads shared by the requests' ParallelPipes, or nullptr if
+// rgw_put_obj_filter_threads is 0
+boost::asio::thread_pool* get_filter_pool(CephContext *cct);
+
+// pipe that transforms its chunks on a pool of worker threads, a few at a
+// time, and passes them on in order. without a pool, each chunk is
+// transformed as it's submitted
+class ParallelPipe : public Pipe {
+ public:
+  // transforms a chunk into out, on a worker thread. it owns whatever it
+  // needs, as it may outlive the pipe's derived class
+  using Transform = std::function<int(bufferlist& in, uint64_t offset,
+                                      bufferlist& out)>;
+ private:
+  struct Chunk {
+    bufferlist in;
+    bufferlist out;
+    uint64_t offset = 0;
+    int r = 0;
+    std::future<void> done;
+  };
+  Transform transform;
+  boost::asio::thread_pool *pool;
+  size_t window; // chunks in flight before submit() waits for the first
+  std::deque<std::unique_ptr<Chunk>> pending;
+
+  int complete_one();
+ protected:
+  // called in order, on the submitter's thread, with each chunk's result.
+  // passes the transformed data on by default
+  virtual int complete(int r, bufferlist&& in, bufferlist&& out,
+                       uint64_t offset);
+
+  // queue a chunk to transform. returns the error of an earlier chunk
+  int submit(bufferlist&& data, uint64_t offset);
+  // wait for the chunks in flight and pass them on
+  int drain();
+ public:
+  ParallelPipe(DataProcessor *next, Transform&& transform,
+               boost::asio::thread_pool *pool, size_t window);
+  // waits for the chunks in flight, which refer to the pipe
+  ~ParallelPipe() override;
+};
+
 } // namespace rgw::putobj
@@ -73,6 +73,7 @@ using namespace librados;
 #include "rgw_data_sync.h"
 #include "rgw_realm_watcher.h"
 #include "rgw_reshard.h"
+#include "rgw_bucket_filter.h"
 
 #include "services/svc_zone.h"
 #include "services/svc_zone_utils.h"
@@ -1284,6 +1285,11 @@ bool RGWIndexCompletionManager::handle_completion(completion_t cb, complete_op_d
 void RGWRados::finalize()
 {
   cct->get_admin_socket()->unregister_commands(this);
+  if (existence_filter) {
+    existence_filter->stop();
+    delete existence_filter;
+    existence_filter = nullptr;
+  }
   if (run_sync_thread) {
     Mutex::Locker l(meta_sync_thread_lock);
     meta_sync_processor_thread->stop();
@@ -1626,6 +1632,13 @@ int RGWRados::init_complete()
   index_completion_manager = new RGWIndexCompletionManager(this);
   ret = index_completion_manager->start();
 
+  /* only the gateway serves reads that the filters can spare */
+  if (use_gc_thread &&
+      cct->_conf.get_val<bool>("rgw_bucket_existence_filter")) {
+    existence_filter = new RGWBucketExistenceFilter(cct, this);
+    existence_filter->start();
+  }
+
   return ret;
 }
 
@@ -3687,7 +3700,7 @@ int RGWRados::Object::Write::_do_write_meta(uint64_t size, uint64_t accounted_si
 
   if (!index_op->is_prepared()) {
     tracepoint(rgw_rados, prepare_enter, req_id.c_str());
-    r = index_op->prepare(CLS_RGW_OP_ADD, &state->write_tag);
+    r = index_op->prepare(CLS_RGW_OP_ADD, &state->write_tag, null_yield);
     tracepoint(rgw_rados, prepare_exit, req_id.c_str());
     if (r < 0)
       return r;
@@ -4020,7 +4033,7 @@ int RGWRados::rewrite_obj(RGWBucketInfo& dest_bucket_info, const rgw_obj& obj, c
   read_op.params.lastmod = &mtime;
   read_op.params.obj_size = &obj_size;
 
-  int ret = read_op.prepare();
+  int ret = read_op.prepare(null_yield);
   if (ret < 0)
     return ret;
 
@@ -4623,7 +4636,7 @@ int RGWRados::copy_obj(RGWObjectCtx& obj_ctx,
   read_op.params.lastmod = src_mtime;
   read_op.params.obj_size = &obj_size;
 
-  ret = read_op.prepare();
+  ret = read_op.prepare(null_yield);
   if (ret < 0) {
     return ret;
   }
@@ -4938,7 +4951,7 @@ int RGWRados::transition_obj(RGWObjectCtx& obj_ctx,
   read_op.params.lastmod = &read_mtime;
   read_op.params.obj_size = &obj_size;
 
-  int ret = read_op.prepare();
+  int ret = read_op.prepare(null_yield);
   if (ret < 0) {
     return ret;
   }
@@ -5397,7 +5410,7 @@ void RGWRados::cls_obj_check_mtime(ObjectOperation& op, const real_time& mtime,
  * obj: name of the object to delete
  * Returns: 0 on success, -ERR# otherwise.
  */
-int RGWRados::Object::Delete::delete_obj()
+int RGWRados::Object::Delete::delete_obj(optional_yield y)
 {
   RGWRados *store = target->get_store();
   rgw_obj& src_obj = target->get_obj();
@@ -5482,7 +5495,7 @@ int RGWRados::Object::Delete::delete_obj()
   }
 
   RGWObjState *state;
-  r = target->get_state(&state, false);
+  r = target->get_state(&state, false, false, y);
   if (r < 0)
     return r;
 
@@ -5544,12 +5557,13 @@ int RGWRados::Object::Delete::delete_obj()
   index_op.set_zones_trace(params.zones_trace);
   index_op.set_bilog_flags(params.bilog_flags);
 
-  r = index_op.prepare(CLS_RGW_OP_DEL, &state->write_tag);
+  r = index_op.prepare(CLS_RGW_OP_DEL, &state->write_tag, y);
   if (r < 0)
     return r;
 
   store->remove_rgw_head_obj(op);
-  r = ref.ioctx.operate(ref.obj.oid, &op);
+  uint64_t ver = 0;
+  r = rgw_rados_operate(ref.ioctx, ref.obj.oid, &op, y, &ver);
 
   /* raced with another operation, object state is indeterminate */
   const bool need_invalidate = (r == -ECANCELED);
@@ -5561,7 +5575,7 @@ int RGWRados::Object::Delete::delete_obj()
       tombstone_entry entry{*state};
       obj_tombstone_cache->add(obj, entry);
     }
-    r = index_op.complete_del(poolid, ref.ioctx.get_last_version(), state->mtime, params.remove_objs);
+    r = index_op.complete_del(poolid, ver, state->mtime, params.remove_objs);
     
     int ret = target->complete_atomic_modification();
     if (ret < 0) {
@@ -5712,7 +5726,8 @@ int RGWRados::get_olh_target_state(RGWObjectCtx& obj_ctx, const RGWBucketInfo& b
 }
 
 int RGWRados::get_obj_state_impl(RGWObjectCtx *rctx, const RGWBucketInfo& bucket_info, const rgw_obj& obj,
-                                 RGWObjState **state, bool follow_olh, bool assume_noent)
+                                 RGWObjState **state, bool follow_olh, bool assume_noent,
+                                 optional_yield y)
 {
   if (obj.empty()) {
     return -EINVAL;
@@ -5738,7 +5753,7 @@ int RGWRados::get_obj_state_impl(RGWObjectCtx *rctx, const RGWBucketInfo& bucket
   int r = -ENOENT;
 
   if (!assume_noent) {
-    r = RGWRados::raw_obj_stat(raw_obj, &s->size, &s->mtime, &s->epoch, &s->attrset, (s->prefetch_data ? &s->data : NULL), NULL);
+    r = RGWRados::raw_obj_stat(raw_obj, &s->size, &s->mtime, &s->epoch, &s->attrset, (s->prefetch_data ? &s->data : NULL), NULL, y);
   }
 
   if (r == -ENOENT) {
@@ -5890,12 +5905,12 @@ int RGWRados::get_obj_state_impl(RGWObjectCtx *rctx, const RGWBucketInfo& bucket
 }
 
 int RGWRados::get_obj_state(RGWObjectCtx *rctx, const RGWBucketInfo& bucket_info, const rgw_obj& obj, RGWObjState **state,
-                            bool follow_olh, bool assume_noent)
+                            bool follow_olh, bool assume_noent, optional_yield y)
 {
   int ret;
 
   do {
-    ret = get_obj_state_impl(rctx, bucket_info, obj, state, follow_olh, assume_noent);
+    ret = get_obj_state_impl(rctx, bucket_info, obj, state, follow_olh, assume_noent, y);
   } while (ret == -EAGAIN);
 
   return ret;
@@ -5914,10 +5929,17 @@ int RGWRados::Object::get_manifest(RGWObjManifest **pmanifest)
   return 0;
 }
 
-int RGWRados::Object::Read::get_attr(const char *name, bufferlist& dest)
+int RGWRados::Object::Read::get_attr(const char *name, bufferlist& dest,
+                                      optional_yield y)
 {
+  RGWBucketExistenceFilter *filter = source->get_store()->get_existence_filter();
+  if (filter && !filter->may_exist(source->get_bucket_info(),
+                                   source->get_obj().key, y)) {
+    return -ENOENT;
+  }
+
   RGWObjState *state;
-  int r = source->get_state(&state, true);
+  int r = source->get_state(&state, true, false, y);
   if (r < 0)
     return r;
   if (!state->exists)
@@ -6044,6 +6066,12 @@ int RGWRados::Object::get_state(RGWObjState **pstate, bool follow_olh, bool assu
   return store->get_obj_state(&ctx, bucket_info, obj, pstate, follow_olh, assume_noent);
 }
 
+int RGWRados::Object::get_state(RGWObjState **pstate, bool follow_olh, bool assume_noent,
+                                optional_yield y)
+{
+  return store->get_obj_state(&ctx, bucket_info, obj, pstate, follow_olh, assume_noent, y);
+}
+
 void RGWRados::Object::invalidate_state()
 {
   ctx.invalidate(obj);
@@ -6232,7 +6260,7 @@ int RGWRados::set_attrs(void *ctx, const RGWBucketInfo& bucket_info, rgw_obj& sr
     string tag;
     append_rand_alpha(cct, tag, tag, 32);
     state->write_tag = tag;
-    r = index_op.prepare(CLS_RGW_OP_ADD, &state->write_tag);
+    r = index_op.prepare(CLS_RGW_OP_ADD, &state->write_tag, null_yield);
 
     if (r < 0)
       return r;
@@ -6288,7 +6316,7 @@ int RGWRados::set_attrs(void *ctx, const RGWBucketInfo& bucket_info, rgw_obj& sr
   return 0;
 }
 
-int RGWRados::Object::Read::prepare()
+int RGWRados::Object::Read::prepare(optional_yield y)
 {
   RGWRados *store = source->get_store();
   CephContext *cct = store->ctx();
@@ -6297,8 +6325,16 @@ int RGWRados::Object::Read::prepare()
 
   map<string, bufferlist>::iterator iter;
 
+  RGWBucketExistenceFilter *filter = store->get_existence_filter();
+  if (filter && !filter->may_exist(source->get_bucket_info(),
+                                   source->get_obj().key, y)) {
+    ldout(cct, 20) << "bucket existence filter: " << source->get_obj()
+                   << " is not in the bucket" << dendl;
+    return -ENOENT;
+  }
+
   RGWObjState *astate;
-  int r = source->get_state(&astate, true);
+  int r = source->get_state(&astate, true, false, y);
   if (r < 0)
     return r;
 
@@ -6353,7 +6389,7 @@ int RGWRados::Object::Read::prepare()
     }
   }
   if (conds.if_match || conds.if_nomatch) {
-    r = get_attr(RGW_ATTR_ETAG, etag);
+    r = get_attr(RGW_ATTR_ETAG, etag, y);
     if (r < 0)
       return r;
 
@@ -6454,7 +6490,8 @@ int RGWRados::Bucket::UpdateIndex::guard_reshard(BucketShard **pbs, std::functio
   return 0;
 }
 
-int RGWRados::Bucket::UpdateIndex::prepare(RGWModifyOp op, const string *write_tag)
+int RGWRados::Bucket::UpdateIndex::prepare(RGWModifyOp op, const string *write_tag,
+                                           optional_yield y)
 {
   if (blind) {
     return 0;
@@ -6470,7 +6507,7 @@ int RGWRados::Bucket::UpdateIndex::prepare(RGWModifyOp op, const string *write_t
   }
 
   int r = guard_reshard(nullptr, [&](BucketShard *bs) -> int {
-				   return store->cls_obj_prepare_op(*bs, op, optag, obj, bilog_flags, zones_trace);
+				   return store->cls_obj_prepare_op(*bs, op, optag, obj, bilog_flags, y, zones_trace);
 				 });
 
   if (r < 0) {
@@ -6478,6 +6515,11 @@ int RGWRados::Bucket::UpdateIndex::prepare(RGWModifyOp op, const string *write_t
   }
   prepared = true;
 
+  /* before the head is written, so that no read can find it missing */
+  if (op == CLS_RGW_OP_ADD && store->existence_filter) {
+    store->existence_filter->add(target->get_bucket_info(), obj.key);
+  }
+
   return 0;
 }
 
@@ -6716,12 +6758,50 @@ struct get_obj_data {
   uint64_t offset; // next offset to write to client
   rgw::AioResultList completed; // completed read results, sorted by offset
   optional_yield yield;
+  rgw::ReadWindow window; // bytes of reads to keep in flight
+  std::map<uint64_t, uint64_t> pending; // lengths of reads in flight, by id
+  uint64_t pending_size = 0;
 
   get_obj_data(RGWRados* store, RGWGetDataCB* cb, rgw::Aio* aio,
-               uint64_t offset, optional_yield yield)
-    : store(store), client_cb(cb), aio(aio), offset(offset), yield(yield) {}
+               uint64_t offset, optional_yield yield,
+               const rgw::ReadWindow& window)
+    : store(store), client_cb(cb), aio(aio), offset(offset), yield(yield),
+      window(window) {}
+
+  // wait until a read of len bytes fits in the window. if none of the reads
+  // in flight have completed by then, we're waiting on rados rather than on
+  // the client, and the window grows if that wait takes long enough. the aio
+  // throttle is sized for the max window and doesn't block before we do
+  int reserve(uint64_t len) {
+    while (pending_size > 0 && pending_size + len > window.size()) {
+      auto c = aio->poll();
+      if (c.empty()) {
+        auto start = ceph::mono_clock::now();
+        c = aio->wait();
+        window.waited(ceph::mono_clock::now() - start);
+      }
+      int r = flush(std::move(c));
+      if (r < 0) {
+        return r;
+      }
+    }
+    return 0;
+  }
+
+  void start(uint64_t id, uint64_t len) {
+    pending[id] = len;
+    pending_size += len;
+  }
 
   int flush(rgw::AioResultList&& results) {
+    for (const auto& result : results) {
+      auto p = pending.find(result.id);
+      if (p != pending.end()) {
+        pending_size -= p->second;
+        pending.erase(p);
+      }
+    }
+
     int r = rgw::check_for_errors(results);
     if (r < 0) {
       return r;
@@ -6817,6 +6897,12 @@ int RGWRados::get_obj_iterate_cb(const rgw_raw_obj& read_obj, off_t obj_ofs,
   const uint64_t cost = len;
   const uint64_t id = obj_ofs; // use logical object offset for sorting replies
 
+  r = d->reserve(cost);
+  if (r < 0) {
+    return r;
+  }
+  d->start(id, cost);
+
   auto completed = d->aio->get(obj, rgw::Aio::librados_op(std::move(op), d->yield), cost, id);
 
   return d->flush(std::move(completed));
@@ -6830,9 +6916,13 @@ int RGWRados::Object::Read::iterate(int64_t ofs, int64_t end, RGWGetDataCB *cb,
   RGWObjectCtx& obj_ctx = source->get_ctx();
   const uint64_t chunk_size = cct->_conf->rgw_get_obj_max_req_size;
   const uint64_t window_size = cct->_conf->rgw_get_obj_window_size;
+  const rgw::ReadWindow window(
+      window_size, cct->_conf->rgw_get_obj_max_window_size,
+      std::chrono::microseconds(
+        cct->_conf.get_val<uint64_t>("rgw_get_obj_window_grow_wait_us")));
 
-  auto aio = rgw::make_throttle(window_size, y);
-  get_obj_data data(store, cb, &*aio, ofs, y);
+  auto aio = rgw::make_throttle(window.max_size(), y);
+  get_obj_data data(store, cb, &*aio, ofs, y, window);
 
   int r = store->iterate_obj(obj_ctx, source->get_bucket_info(), state.obj,
                              ofs, end, chunk_size, _get_obj_iterate_cb, &data);
@@ -7876,7 +7966,7 @@ int RGWRados::follow_olh(const RGWBucketInfo& bucket_info, RGWObjectCtx& obj_ctx
 
 int RGWRados::raw_obj_stat(rgw_raw_obj& obj, uint64_t *psize, real_time *pmtime, uint64_t *epoch,
                            map<string, bufferlist> *attrs, bufferlist *first_chunk,
-                           RGWObjVersionTracker *objv_tracker)
+                           RGWObjVersionTracker *objv_tracker, optional_yield y)
 {
   rgw_rados_ref ref;
   int r = get_raw_obj_ref(obj, &ref);
@@ -7902,11 +7992,7 @@ int RGWRados::raw_obj_stat(rgw_raw_obj& obj, uint64_t *psize, real_time *pmtime,
     op.read(0, cct->_conf->rgw_max_chunk_size, first_chunk, NULL);
   }
   bufferlist outbl;
-  r = ref.ioctx.operate(ref.obj.oid, &op, &outbl);
-
-  if (epoch) {
-    *epoch = ref.ioctx.get_last_version();
-  }
+  r = rgw_rados_operate(ref.ioctx, ref.obj.oid, &op, &outbl, y, epoch);
 
   if (r < 0)
     return r;
@@ -8849,6 +8935,34 @@ int RGWRados::bi_get(const RGWBucketInfo& bucket_info, const rgw_obj& obj,
   return cls_rgw_bi_get(bs.index_ctx, bs.bucket_obj, index_type, key, entry);
 }
 
+int RGWRados::bi_get(const RGWBucketInfo& bucket_info, const rgw_obj& obj,
+                     BIIndexType index_type, rgw_cls_bi_entry *entry,
+                     optional_yield y)
+{
+  BucketShard bs(this);
+  int ret = bs.init(bucket_info, obj);
+  if (ret < 0) {
+    ldout(cct, 5) << "bs.init() returned ret=" << ret << dendl;
+    return ret;
+  }
+
+  cls_rgw_obj_key key(obj.key.get_index_key_name(), obj.key.instance);
+
+  librados::ObjectReadOperation op;
+  rgw_cls_bi_get_ret result;
+  int op_ret = 0;
+  cls_rgw_bi_get_op(op, index_type, key, &result, &op_ret);
+  ret = rgw_rados_operate(bs.index_ctx, bs.bucket_obj, &op, nullptr, y);
+  if (ret < 0) {
+    return ret;
+  }
+  if (op_ret < 0) {
+    return op_ret;
+  }
+  *entry = result.entry;
+  return 0;
+}
+
 void RGWRados::bi_put(ObjectWriteOperation& op, BucketShard& bs, rgw_cls_bi_entry& entry)
 {
   cls_rgw_bi_put(op, bs.bucket_obj, entry);
@@ -8978,7 +9092,8 @@ bool RGWRados::process_expire_objects()
 }
 
 int RGWRados::cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag,
-                                 rgw_obj& obj, uint16_t bilog_flags, rgw_zone_set *_zones_trace)
+                                 rgw_obj& obj, uint16_t bilog_flags, optional_yield y,
+                                 rgw_zone_set *_zones_trace)
 {
   rgw_zone_set zones_trace;
   if (_zones_trace) {
@@ -8990,7 +9105,7 @@ int RGWRados::cls_obj_prepare_op(BucketShard& bs, RGWModifyOp op, string& tag,
   cls_rgw_obj_key key(obj.key.get_index_key_name(), obj.key.instance);
   cls_rgw_guard_bucket_resharding(o, -ERR_BUSY_RESHARDING);
   cls_rgw_bucket_prepare_op(o, op, tag, key, obj.key.get_loc(), svc.zone->get_zone().log_data, bilog_flags, zones_trace);
-  return bs.index_ctx.operate(bs.bucket_obj, &o);
+  return rgw_rados_operate(bs.index_ctx, bs.bucket_obj, &o, y);
 }
 
 int RGWRados::cls_obj_complete_op(BucketShard& bs, const rgw_obj& obj, RGWModifyOp op, string& tag,
@@ -9071,6 +9186,27 @@ int RGWRados::cls_obj_set_bucket_tag_timeout(RGWBucketInfo& bucket_info, uint64_
 }
 
 
+/**
+ * Number of entries to request from each bucket index shard for an
+ * ordered listing of num_entries. Keys hash evenly over the shards, so
+ * each shard holds about num_entries / num_shards of the next entries;
+ * asking for twice that (and at least a few entries, since the cost of
+ * a cls call dwarfs that of a few more entries) rarely leaves the merge
+ * short of entries. When it does, the listing stops early at the first
+ * exhausted shard and the caller asks for the rest.
+ */
+static uint32_t calc_ordered_bucket_list_per_shard(uint32_t num_entries,
+						   uint32_t num_shards)
+{
+  constexpr uint32_t min_read = 8;
+
+  if (num_shards <= 1) {
+    return num_entries;
+  }
+  uint32_t calc_read = 1 + (2 * num_entries) / num_shards;
+  return std::min(num_entries, std::max(min_read, calc_read));
+}
+
 int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
 				      int shard_id,
 				      const rgw_obj_index_key& start,
@@ -9096,10 +9232,17 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   if (r < 0)
     return r;
 
+  const uint32_t num_entries_per_shard =
+    calc_ordered_bucket_list_per_shard(num_entries, oids.size());
+
+  ldout(cct, 20) << "cls_bucket_list_ordered requesting " <<
+    num_entries_per_shard << " entries from each of " << oids.size() <<
+    " shards" << dendl;
+
   cls_rgw_obj_key start_key(start.name, start.instance);
-  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix, num_entries,
-			    list_versions, oids, list_results,
-			    cct->_conf->rgw_bucket_index_max_aio)();
+  r = CLSRGWIssueBucketList(index_ctx, start_key, prefix,
+			    num_entries_per_shard, list_versions, oids,
+			    list_results, cct->_conf->rgw_bucket_index_max_aio)();
   if (r < 0)
     return r;
 
@@ -9107,15 +9250,18 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
   vector<map<string, struct rgw_bucket_dir_entry>::iterator> vcurrents;
   vector<map<string, struct rgw_bucket_dir_entry>::iterator> vends;
   vector<string> vnames;
+  vector<bool> vtruncated;
   vcurrents.reserve(list_results.size());
   vends.reserve(list_results.size());
   vnames.reserve(list_results.size());
+  vtruncated.reserve(list_results.size());
   map<int, struct rgw_cls_list_ret>::iterator iter = list_results.begin();
   *is_truncated = false;
   for (; iter != list_results.end(); ++iter) {
     vcurrents.push_back(iter->second.dir.m.begin());
     vends.push_back(iter->second.dir.m.end());
     vnames.push_back(oids[iter->first]);
+    vtruncated.push_back(iter->second.is_truncated);
     *is_truncated = (*is_truncated || iter->second.is_truncated);
   }
 
@@ -9131,12 +9277,14 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
 
   map<string, bufferlist> updates;
   uint32_t count = 0;
+  string last_entry_visited;
   while (count < num_entries && !candidates.empty()) {
     r = 0;
     // Select the next one
     int pos = candidates.begin()->second;
     const string& name = vcurrents[pos]->first;
     struct rgw_bucket_dir_entry& dirent = vcurrents[pos]->second;
+    last_entry_visited = name;
 
     bool force_check = force_check_filter &&
         force_check_filter(dirent.key.name);
@@ -9165,6 +9313,12 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
     ++vcurrents[pos];
     if (vcurrents[pos] != vends[pos]) {
       candidates[vcurrents[pos]->first] = pos;
+    } else if (vtruncated[pos]) {
+      // the next entries of this shard are unknown and may sort before
+      // those of the other shards, so stop here; the caller asks for more
+      ldout(cct, 20) << "cls_bucket_list_ordered exhausted shard " <<
+	vnames[pos] << ", stopping at " << name << dendl;
+      break;
     }
   }
 
@@ -9188,8 +9342,10 @@ int RGWRados::cls_bucket_list_ordered(RGWBucketInfo& bucket_info,
       break;
     }
   }
-  if (!m.empty())
-    *last_entry = m.rbegin()->first;
+  // resume after the last entry looked at, even if it was not returned,
+  // so that the caller makes progress
+  if (!last_entry_visited.empty())
+    *last_entry = last_entry_visited;
 
   return 0;
 }
@@ -10099,7 +10255,7 @@ int RGWRados::delete_obj_aio(const rgw_obj& obj,
     RGWRados::Bucket bop(this, bucket_info);
     RGWRados::Bucket::UpdateIndex index_op(&bop, obj);
 
-    ret = index_op.prepare(CLS_RGW_OP_DEL, &astate->write_tag);
+    ret = index_op.prepare(CLS_RGW_OP_DEL, &astate->write_tag, null_yield);
     if (ret < 0) {
       lderr(cct) << "ERROR: failed to prepare index op with ret=" << ret << dendl;
       return ret;
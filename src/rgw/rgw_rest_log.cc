@@ -379,6 +379,8 @@ void RGWOp_BILog_List::execute() {
   RGWBucketInfo bucket_info;
   unsigned max_entries;
 
+  binary = s->info.args.exists("binary");
+
   if (bucket_name.empty() && bucket_instance.empty()) {
     dout(5) << "ERROR: neither bucket nor bucket instance specified" << dendl;
     http_ret = -EINVAL;
@@ -438,18 +440,38 @@ void RGWOp_BILog_List::send_response() {
 
   set_req_state_err(s, http_ret);
   dump_errno(s);
-  end_header(s);
+  if (binary && http_ret >= 0) {
+    end_header(s, nullptr, "application/octet-stream");
+  } else {
+    end_header(s);
+  }
 
   sent_header = true;
 
   if (http_ret < 0)
     return;
 
+  if (binary) {
+    dump_body(s, RGW_BILOG_BINARY_MAGIC);
+    return;
+  }
   s->formatter->open_array_section("entries");
 }
 
 void RGWOp_BILog_List::send_response(list<rgw_bi_log_entry>& entries, string& marker)
 {
+  if (binary) {
+    bufferlist bl;
+    for (auto& entry : entries) {
+      encode(entry, bl);
+      marker = entry.id;
+    }
+    if (bl.length()) {
+      dump_body(s, bl);
+    }
+    return;
+  }
+
   for (list<rgw_bi_log_entry>::iterator iter = entries.begin(); iter != entries.end(); ++iter) {
     rgw_bi_log_entry& entry = *iter;
     encode_json("entry", entry, s->formatter);
@@ -460,6 +482,9 @@ void RGWOp_BILog_List::send_response(list<rgw_bi_log_entry>& entries, string& ma
 }
 
 void RGWOp_BILog_List::send_response_end() {
+  if (binary) {
+    return;
+  }
   s->formatter->close_section();
   flusher.flush();
 }
@@ -20,6 +20,7 @@
 
 class RGWOp_BILog_List : public RGWRESTOp {
   bool sent_header;
+  bool binary{false}; // encoded entries instead of json
 public:
   RGWOp_BILog_List() : sent_header(false) {}
   ~RGWOp_BILog_List() override {}
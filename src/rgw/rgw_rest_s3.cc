@@ -11,7 +11,9 @@
 #include "common/ceph_json.h"
 #include "common/safe_io.h"
 #include "auth/Crypto.h"
+#include <arpa/inet.h>
 #include <boost/algorithm/string.hpp>
+#include <boost/crc.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/utility/string_view.hpp>
 #include <boost/tokenizer.hpp>
@@ -385,6 +387,255 @@ int RGWGetObj_ObjStore_S3::get_decrypt_filter(std::unique_ptr<RGWGetObj_Filter>
   return res;
 }
 
+struct select_csv_xml {
+  RGWSelectCSVFormat fmt;
+
+  static void decode_char(const char *name, char *c, XMLObj *obj) {
+    string val;
+    if (RGWXMLDecoder::decode_xml(name, val, obj)) {
+      *c = (val.empty() ? 0 : val[0]);
+    }
+  }
+
+  void decode_xml(XMLObj *obj) {
+    decode_char("FieldDelimiter", &fmt.field_delim, obj);
+    decode_char("RecordDelimiter", &fmt.record_delim, obj);
+    decode_char("QuoteCharacter", &fmt.quote, obj);
+    decode_char("Comments", &fmt.comment, obj);
+    string val;
+    if (RGWXMLDecoder::decode_xml("FileHeaderInfo", val, obj)) {
+      if (val == "USE") {
+        fmt.header = RGWSelectCSVFormat::HEADER_USE;
+      } else if (val == "IGNORE") {
+        fmt.header = RGWSelectCSVFormat::HEADER_IGNORE;
+      } else if (val != "NONE") {
+        throw RGWXMLDecoder::err("bad FileHeaderInfo");
+      }
+    }
+    if (RGWXMLDecoder::decode_xml("QuoteFields", val, obj)) {
+      fmt.quote_always = (val == "ALWAYS");
+    }
+    if (!fmt.field_delim || !fmt.record_delim) {
+      throw RGWXMLDecoder::err("empty delimiter");
+    }
+  }
+};
+
+struct select_serialization_xml {
+  select_csv_xml csv;
+  string compression;
+  bool has_csv{false};
+
+  void decode_xml(XMLObj *obj) {
+    RGWXMLDecoder::decode_xml("CompressionType", compression, obj);
+    has_csv = RGWXMLDecoder::decode_xml("CSV", csv, obj);
+  }
+};
+
+struct select_request_xml {
+  string expression;
+  string expression_type;
+  select_serialization_xml input;
+  select_serialization_xml output;
+
+  void decode_xml(XMLObj *obj) {
+    RGWXMLDecoder::decode_xml("Expression", expression, obj, true);
+    RGWXMLDecoder::decode_xml("ExpressionType", expression_type, obj, true);
+    RGWXMLDecoder::decode_xml("InputSerialization", input, obj, true);
+    RGWXMLDecoder::decode_xml("OutputSerialization", output, obj, true);
+  }
+};
+
+int RGWSelectObj_ObjStore_S3::get_params()
+{
+  int r = RGWGetObj_ObjStore_S3::get_params();
+  if (r < 0) {
+    return r;
+  }
+  range_str = nullptr; // the query runs over the whole object
+
+  bufferlist data;
+  std::tie(r, data) =
+    rgw_rest_read_all_input(s, s->cct->_conf->rgw_max_put_param_size, false);
+  if (r < 0) {
+    return r;
+  }
+
+  r = do_aws4_auth_completion();
+  if (r < 0) {
+    return r;
+  }
+
+  RGWXMLDecoder::XMLParser parser;
+  if (!parser.init()) {
+    ldpp_dout(this, 0) << "ERROR: failed to initialize parser" << dendl;
+    return -EIO;
+  }
+  if (!parser.parse(data.c_str(), data.length(), 1)) {
+    return -ERR_MALFORMED_XML;
+  }
+
+  select_request_xml req;
+  try {
+    RGWXMLDecoder::decode_xml("SelectObjectContentRequest", req, &parser, true);
+  } catch (RGWXMLDecoder::err& err) {
+    ldpp_dout(this, 5) << "Malformed select request: " << err << dendl;
+    return -ERR_MALFORMED_XML;
+  }
+
+  if (req.expression_type != "SQL") {
+    s->err.message = "Only SQL expressions are supported";
+    return -EINVAL;
+  }
+  if (!req.input.has_csv || !req.output.has_csv ||
+      (!req.input.compression.empty() && req.input.compression != "NONE")) {
+    s->err.message = "Only uncompressed CSV input and CSV output are supported";
+    return -ERR_NOT_IMPLEMENTED;
+  }
+  csv_input = req.input.csv.fmt;
+  csv_output = req.output.csv.fmt;
+
+  string err;
+  r = RGWSelectQuery::parse(req.expression, &query, &err);
+  if (r < 0) {
+    s->err.message = err;
+    return r;
+  }
+  if (query->has_named_columns() &&
+      csv_input.header != RGWSelectCSVFormat::HEADER_USE) {
+    s->err.message = "Columns can only be named with FileHeaderInfo USE";
+    return -EINVAL;
+  }
+  return 0;
+}
+
+int RGWSelectObj_ObjStore_S3::get_select_filter(std::unique_ptr<RGWGetObj_Filter> *filter,
+                                               RGWGetObj_Filter* cb)
+{
+  if (attrs.count(RGW_ATTR_USER_MANIFEST) || attrs.count(RGW_ATTR_SLO_MANIFEST)) {
+    s->err.message = "Select is not supported on manifest objects";
+    return -ERR_NOT_IMPLEMENTED;
+  }
+  auto f = std::make_unique<RGWGetObj_Select>(s->cct, *query, csv_input,
+                                              csv_output, cb);
+  select = f.get();
+  *filter = std::move(f);
+  return 0;
+}
+
+static void append_event_header(bufferlist& bl, const char *name,
+                                const string& value)
+{
+  const char string_type = 7;
+  uint8_t name_len = strlen(name);
+  uint16_t value_len = htons(value.size());
+  bl.append((const char *)&name_len, sizeof(name_len));
+  bl.append(name, name_len);
+  bl.append(&string_type, sizeof(string_type));
+  bl.append((const char *)&value_len, sizeof(value_len));
+  bl.append(value);
+}
+
+static uint32_t event_crc(const bufferlist& bl)
+{
+  boost::crc_32_type crc;
+  for (auto& p : bl.buffers()) {
+    crc.process_bytes(p.c_str(), p.length());
+  }
+  return crc.checksum();
+}
+
+/* one message of the AWS event stream the select response is made of:
+ * prelude (total and headers lengths, prelude crc), headers, payload, crc
+ */
+void RGWSelectObj_ObjStore_S3::send_event(const char *event_type,
+                                          const char *content_type,
+                                          bufferlist&& payload)
+{
+  bufferlist headers;
+  if (event_type) {
+    append_event_header(headers, ":event-type", event_type);
+  }
+  if (content_type) {
+    append_event_header(headers, ":content-type", content_type);
+  }
+  if (event_type) {
+    append_event_header(headers, ":message-type", "event");
+  } else {
+    append_event_header(headers, ":error-code", s->err.err_code);
+    append_event_header(headers, ":error-message", s->err.message);
+    append_event_header(headers, ":message-type", "error");
+  }
+
+  bufferlist msg;
+  uint32_t prelude[2] = {
+    htonl(12 + headers.length() + payload.length() + 4),
+    htonl(headers.length())
+  };
+  msg.append((const char *)prelude, sizeof(prelude));
+  uint32_t crc = htonl(event_crc(msg));
+  msg.append((const char *)&crc, sizeof(crc));
+  msg.claim_append(headers);
+  msg.claim_append(payload);
+  crc = htonl(event_crc(msg));
+  msg.append((const char *)&crc, sizeof(crc));
+
+  dump_body(s, msg);
+}
+
+int RGWSelectObj_ObjStore_S3::send_response_data(bufferlist& bl, off_t bl_ofs,
+                                                 off_t bl_len)
+{
+  if (!sent_header) {
+    if (op_ret < 0) {
+      return RGWGetObj_ObjStore_S3::send_response_data(bl, bl_ofs, bl_len);
+    }
+    dump_errno(s);
+    end_header(s, this, "application/octet-stream", CHUNKED_TRANSFER_ENCODING);
+    sent_header = true;
+  }
+
+  if (op_ret < 0) { // failed after the response started
+    set_req_state_err(s, op_ret);
+    send_event(nullptr, nullptr, bufferlist());
+    return 0;
+  }
+
+  if (bl_len > 0) {
+    bufferlist records;
+    records.substr_of(bl, bl_ofs, bl_len);
+    send_event("Records", "application/octet-stream", std::move(records));
+    return 0;
+  }
+
+  // the object was read through, let the select filter return what it
+  // still holds (unless it's done already)
+  if (select) {
+    int r = select->flush();
+    if (r < 0) {
+      op_ret = r;
+      set_req_state_err(s, op_ret);
+      send_event(nullptr, nullptr, bufferlist());
+      return 0;
+    }
+  }
+
+  bufferlist stats;
+  stats.append("<Stats>");
+  if (select) {
+    stats.append("<BytesScanned>" + std::to_string(select->get_bytes_scanned()) +
+                 "</BytesScanned><BytesProcessed>" +
+                 std::to_string(select->get_bytes_scanned()) +
+                 "</BytesProcessed><BytesReturned>" +
+                 std::to_string(select->get_bytes_returned()) +
+                 "</BytesReturned>");
+  }
+  stats.append("</Stats>");
+  send_event("Stats", "text/xml", std::move(stats));
+  send_event("End", nullptr, bufferlist());
+  return 0;
+}
+
 void RGWGetObjTags_ObjStore_S3::send_response_data(bufferlist& bl)
 {
   dump_errno(s);
@@ -1551,7 +1802,7 @@ static inline int get_obj_attrs(RGWRados *store, struct req_state *s, rgw_obj& o
 
   read_op.params.attrs = &attrs;
 
-  return read_op.prepare();
+  return read_op.prepare(s->yield);
 }
 
 static inline void set_attr(map<string, bufferlist>& attrs, const char* key, const std::string& value)
@@ -2879,7 +3130,7 @@ void RGWDeleteMultiObj_ObjStore_S3::send_partial_response(rgw_obj_key& key,
 							  const string& marker_version_id, int ret)
 {
   if (!key.empty()) {
-    if (op_ret == 0 && !quiet) {
+    if (ret == 0 && !quiet) {
       s->formatter->open_object_section("Deleted");
       s->formatter->dump_string("Key", key.name);
       if (!key.instance.empty()) {
@@ -2890,13 +3141,13 @@ void RGWDeleteMultiObj_ObjStore_S3::send_partial_response(rgw_obj_key& key,
 	s->formatter->dump_string("DeleteMarkerVersionId", marker_version_id);
       }
       s->formatter->close_section();
-    } else if (op_ret < 0) {
+    } else if (ret < 0) {
       struct rgw_http_error r;
       int err_no;
 
       s->formatter->open_object_section("Error");
 
-      err_no = -op_ret;
+      err_no = -ret;
       rgw_get_errno_s3(&r, err_no);
 
       s->formatter->dump_string("Key", key.name);
@@ -2905,8 +3156,6 @@ void RGWDeleteMultiObj_ObjStore_S3::send_partial_response(rgw_obj_key& key,
       s->formatter->dump_string("Message", r.s3_code);
       s->formatter->close_section();
     }
-
-    rgw_flush_formatter(s, s->formatter);
   }
 }
 
@@ -3301,6 +3550,9 @@ RGWOp *RGWHandler_REST_Obj_S3::op_post()
   if (s->info.args.exists("uploads"))
     return new RGWInitMultipart_ObjStore_S3;
 
+  if (s->info.args.exists("select"))
+    return new RGWSelectObj_ObjStore_S3;
+
   return new RGWPostObj_ObjStore_S3;
 }
 
@@ -4423,14 +4675,20 @@ rgw::auth::s3::LocalEngine::authenticate(
   const req_state* const s) const
 {
   /* get the user info */
-  RGWUserInfo user_info;
+  std::shared_ptr<const RGWUserInfo> cached_info;
   /* TODO(rzarzynski): we need to have string-view taking variant. */
   const std::string access_key_id = _access_key_id.to_string();
-  if (rgw_get_user_info_by_access_key(store, access_key_id, user_info) < 0) {
+  if (!user_cache.find(access_key_id, cached_info)) {
+    auto info = std::make_shared<RGWUserInfo>();
+    if (rgw_get_user_info_by_access_key(store, access_key_id, *info) < 0) {
       ldpp_dout(dpp, 5) << "error reading user info, uid=" << access_key_id
               << " can't authenticate" << dendl;
       return result_t::deny(-ERR_INVALID_ACCESS_KEY);
+    }
+    cached_info = std::move(info);
+    user_cache.add(access_key_id, cached_info);
   }
+  const RGWUserInfo& user_info = *cached_info;
   //TODO: Uncomment, when we have a migration plan in place.
   /*else {
     if (s->user->type != TYPE_RGW) {
@@ -18,6 +18,7 @@
 #include "rgw_acl_s3.h"
 #include "rgw_policy_s3.h"
 #include "rgw_lc_s3.h"
+#include "rgw_select.h"
 #include "rgw_keystone.h"
 #include "rgw_rest_conn.h"
 #include "rgw_ldap.h"
@@ -27,6 +28,7 @@
 
 #include "rgw_auth.h"
 #include "rgw_auth_filters.h"
+#include "rgw_auth_cache.h"
 #include "rgw_sts.h"
 
 struct rgw_http_error {
@@ -56,6 +58,28 @@ public:
                          bufferlist* manifest_bl) override;
 };
 
+/* SelectObjectContent: a GET that only returns what the query selects */
+class RGWSelectObj_ObjStore_S3 : public RGWGetObj_ObjStore_S3
+{
+  RGWSelectCSVFormat csv_input;
+  RGWSelectCSVFormat csv_output;
+  std::unique_ptr<RGWSelectQuery> query;
+  RGWGetObj_Select *select{nullptr};
+
+  void send_event(const char *event_type, const char *content_type,
+                  bufferlist&& payload);
+public:
+  RGWSelectObj_ObjStore_S3() {}
+  ~RGWSelectObj_ObjStore_S3() override {}
+
+  bool prefetch_data() override { return false; }
+  int get_params() override;
+  int send_response_data(bufferlist& bl, off_t ofs, off_t len) override;
+  int get_select_filter(std::unique_ptr<RGWGetObj_Filter>* filter,
+                        RGWGetObj_Filter* cb) override;
+  const char* name() const override { return "select_obj_content"; }
+};
+
 class RGWGetObjTags_ObjStore_S3 : public RGWGetObjTags_ObjStore
 {
 public:
@@ -867,6 +891,9 @@ public:
 class LocalEngine : public AWSEngine {
   RGWRados* const store;
   const rgw::auth::LocalApplier::Factory* const apl_factory;
+  /* The users by their access keys, for a few seconds, to spare the
+   * requests that follow the user lookup. */
+  mutable rgw::auth::ExpiringCache<std::shared_ptr<const RGWUserInfo>> user_cache;
 
   result_t authenticate(const DoutPrefixProvider* dpp,
                         const boost::string_view& access_key_id,
@@ -883,7 +910,10 @@ public:
               const rgw::auth::LocalApplier::Factory* const apl_factory)
     : AWSEngine(cct, ver_abstractor),
       store(store),
-      apl_factory(apl_factory) {
+      apl_factory(apl_factory),
+      user_cache(cct->_conf.get_val<uint64_t>("rgw_s3_auth_cache_size"),
+                 std::chrono::seconds(
+                   cct->_conf.get_val<uint64_t>("rgw_s3_auth_cache_ttl"))) {
   }
 
   using AWSEngine::authenticate;
@@ -0,0 +1,711 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
+#include <strings.h>
+
+#include "rgw_select.h"
+
+#define dout_subsys ceph_subsys_rgw
+
+namespace {
+
+struct Token {
+  enum Type {
+    END,
+    IDENT,        ///< a name or keyword
+    QUOTED_IDENT, ///< a "name"
+    STRING,       ///< a 'literal'
+    NUMBER,
+    SYMBOL,
+  } type{END};
+  std::string text;
+};
+
+class Parser {
+  const std::string& sql;
+  size_t pos{0};
+  Token tok;
+  std::string error;
+  // bound the recursion of parsing here, and of eval() later: the
+  // conditions are a tree no deeper than their count
+  static constexpr int max_nesting = 32;
+  static constexpr int max_conditions = 256;
+  int nesting{0};
+  int conditions{0};
+
+  // counts a level of NOT, parentheses or CAST while in scope
+  struct Nested {
+    Parser *p;
+    explicit Nested(Parser *p) : p(p) { ++p->nesting; }
+    ~Nested() { --p->nesting; }
+    bool ok() {
+      if (p->nesting > max_nesting) {
+        p->fail("expression nested too deeply");
+        return false;
+      }
+      return true;
+    }
+  };
+
+  std::unique_ptr<RGWSelectQuery::Condition> new_condition() {
+    if (++conditions > max_conditions) {
+      fail("too many conditions");
+      return nullptr;
+    }
+    return std::make_unique<RGWSelectQuery::Condition>();
+  }
+
+  void next() {
+    while (pos < sql.size() && isspace((unsigned char)sql[pos])) {
+      ++pos;
+    }
+    tok.text.clear();
+    if (pos == sql.size()) {
+      tok.type = Token::END;
+      return;
+    }
+    char c = sql[pos];
+    if (isalpha((unsigned char)c) || c == '_') {
+      tok.type = Token::IDENT;
+      while (pos < sql.size() &&
+             (isalnum((unsigned char)sql[pos]) || sql[pos] == '_')) {
+        tok.text.push_back(sql[pos++]);
+      }
+    } else if (isdigit((unsigned char)c) ||
+               (c == '-' && pos + 1 < sql.size() &&
+                isdigit((unsigned char)sql[pos + 1]))) {
+      tok.type = Token::NUMBER;
+      tok.text.push_back(sql[pos++]);
+      while (pos < sql.size() &&
+             (isdigit((unsigned char)sql[pos]) || sql[pos] == '.')) {
+        tok.text.push_back(sql[pos++]);
+      }
+    } else if (c == '\'' || c == '"') {
+      tok.type = (c == '\'' ? Token::STRING : Token::QUOTED_IDENT);
+      ++pos;
+      for (;;) {
+        if (pos == sql.size()) {
+          error = "unterminated quoted string";
+          tok.type = Token::END;
+          return;
+        }
+        if (sql[pos] == c) {
+          if (pos + 1 < sql.size() && sql[pos + 1] == c) { // escaped quote
+            tok.text.push_back(c);
+            pos += 2;
+            continue;
+          }
+          ++pos;
+          break;
+        }
+        tok.text.push_back(sql[pos++]);
+      }
+    } else {
+      tok.type = Token::SYMBOL;
+      tok.text.push_back(sql[pos++]);
+      if (pos < sql.size() &&
+          ((c == '<' && (sql[pos] == '=' || sql[pos] == '>')) ||
+           ((c == '>' || c == '!') && sql[pos] == '='))) {
+        tok.text.push_back(sql[pos++]);
+      }
+    }
+  }
+
+  bool is_keyword(const char *kw) const {
+    return tok.type == Token::IDENT && strcasecmp(tok.text.c_str(), kw) == 0;
+  }
+  bool is_symbol(const char *sym) const {
+    return tok.type == Token::SYMBOL && tok.text == sym;
+  }
+  bool expect_keyword(const char *kw) {
+    if (!is_keyword(kw)) {
+      fail(std::string("expected ") + kw);
+      return false;
+    }
+    next();
+    return true;
+  }
+  bool expect_symbol(const char *sym) {
+    if (!is_symbol(sym)) {
+      fail(std::string("expected '") + sym + "'");
+      return false;
+    }
+    next();
+    return true;
+  }
+  void fail(const std::string& msg) {
+    if (error.empty()) {
+      error = msg + " at offset " + std::to_string(pos);
+    }
+  }
+
+  bool parse_column(RGWSelectQuery::Operand *op) {
+    op->is_column = true;
+    for (;;) {
+      std::string name = tok.text;
+      bool quoted = (tok.type == Token::QUOTED_IDENT);
+      next();
+      if (!quoted && is_symbol(".")) { // alias.column
+        next();
+        if (tok.type != Token::IDENT && tok.type != Token::QUOTED_IDENT) {
+          fail("expected a column name");
+          return false;
+        }
+        continue;
+      }
+      op->name = name;
+      if (!quoted && name.size() > 1 && name[0] == '_' &&
+          name.find_first_not_of("0123456789", 1) == std::string::npos) {
+        op->index = atoi(name.c_str() + 1) - 1;
+        if (op->index < 0) {
+          fail("bad column index " + name);
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+
+  bool parse_operand(RGWSelectQuery::Operand *op) {
+    if (is_keyword("CAST")) {
+      next();
+      Nested nested(this);
+      if (!nested.ok() ||
+          !expect_symbol("(") || !parse_operand(op) || !expect_keyword("AS")) {
+        return false;
+      }
+      if (is_keyword("INT") || is_keyword("INTEGER") || is_keyword("FLOAT") ||
+          is_keyword("DECIMAL")) {
+        op->type = RGWSelectQuery::TYPE_NUMBER;
+      } else if (is_keyword("STRING")) {
+        op->type = RGWSelectQuery::TYPE_STRING;
+      } else {
+        fail("unsupported cast type");
+        return false;
+      }
+      next();
+      return expect_symbol(")");
+    }
+    switch (tok.type) {
+    case Token::IDENT:
+    case Token::QUOTED_IDENT:
+      return parse_column(op);
+    case Token::STRING:
+      op->name = tok.text;
+      op->type = RGWSelectQuery::TYPE_STRING;
+      next();
+      return true;
+    case Token::NUMBER:
+      op->name = tok.text;
+      next();
+      return true;
+    default:
+      fail("expected a column or a value");
+      return false;
+    }
+  }
+
+  std::unique_ptr<RGWSelectQuery::Condition> parse_comparison() {
+    using Condition = RGWSelectQuery::Condition;
+    auto cond = new_condition();
+    if (!cond || !parse_operand(&cond->lhs)) {
+      return nullptr;
+    }
+    if (is_symbol("=")) {
+      cond->op = Condition::OP_EQ;
+    } else if (is_symbol("!=") || is_symbol("<>")) {
+      cond->op = Condition::OP_NE;
+    } else if (is_symbol("<")) {
+      cond->op = Condition::OP_LT;
+    } else if (is_symbol("<=")) {
+      cond->op = Condition::OP_LE;
+    } else if (is_symbol(">")) {
+      cond->op = Condition::OP_GT;
+    } else if (is_symbol(">=")) {
+      cond->op = Condition::OP_GE;
+    } else {
+      fail("expected a comparison");
+      return nullptr;
+    }
+    next();
+    if (!parse_operand(&cond->rhs)) {
+      return nullptr;
+    }
+    return cond;
+  }
+
+  std::unique_ptr<RGWSelectQuery::Condition> parse_not() {
+    using Condition = RGWSelectQuery::Condition;
+    if (is_keyword("NOT")) {
+      next();
+      Nested nested(this);
+      auto cond = new_condition();
+      if (!nested.ok() || !cond) {
+        return nullptr;
+      }
+      cond->op = Condition::OP_NOT;
+      cond->left = parse_not();
+      if (!cond->left) {
+        return nullptr;
+      }
+      return cond;
+    }
+    if (is_symbol("(")) {
+      next();
+      Nested nested(this);
+      if (!nested.ok()) {
+        return nullptr;
+      }
+      auto cond = parse_or();
+      if (!cond || !expect_symbol(")")) {
+        return nullptr;
+      }
+      return cond;
+    }
+    return parse_comparison();
+  }
+
+  std::unique_ptr<RGWSelectQuery::Condition> parse_binary(
+      const char *kw, RGWSelectQuery::Condition::Op op,
+      std::unique_ptr<RGWSelectQuery::Condition> (Parser::*operand)()) {
+    auto left = (this->*operand)();
+    while (left && is_keyword(kw)) {
+      next();
+      auto cond = new_condition();
+      if (!cond) {
+        return nullptr;
+      }
+      cond->op = op;
+      cond->left = std::move(left);
+      cond->right = (this->*operand)();
+      if (!cond->right) {
+        return nullptr;
+      }
+      left = std::move(cond);
+    }
+    return left;
+  }
+
+  std::unique_ptr<RGWSelectQuery::Condition> parse_and() {
+    return parse_binary("AND", RGWSelectQuery::Condition::OP_AND,
+                        &Parser::parse_not);
+  }
+
+  std::unique_ptr<RGWSelectQuery::Condition> parse_or() {
+    return parse_binary("OR", RGWSelectQuery::Condition::OP_OR,
+                        &Parser::parse_and);
+  }
+
+public:
+  explicit Parser(const std::string& sql) : sql(sql) {
+    next();
+  }
+
+  int parse(RGWSelectQuery *q, std::string *err) {
+    if (!expect_keyword("SELECT")) {
+      goto fail;
+    }
+    if (is_symbol("*")) {
+      q->select_all = true;
+      next();
+    } else if (is_keyword("COUNT")) {
+      next();
+      if (!expect_symbol("(") || !expect_symbol("*") || !expect_symbol(")")) {
+        goto fail;
+      }
+      q->count = true;
+    } else {
+      for (;;) {
+        RGWSelectQuery::Operand op;
+        if (!parse_operand(&op)) {
+          goto fail;
+        }
+        q->projection.push_back(std::move(op));
+        if (!is_symbol(",")) {
+          break;
+        }
+        next();
+      }
+    }
+    if (!expect_keyword("FROM")) {
+      goto fail;
+    }
+    if (!is_keyword("S3Object")) {
+      fail("expected S3Object");
+      goto fail;
+    }
+    next();
+    if (is_keyword("AS")) {
+      next();
+    }
+    if (tok.type == Token::IDENT && !is_keyword("WHERE") && !is_keyword("LIMIT")) {
+      next(); // the alias; columns are not checked against it
+    }
+    if (is_keyword("WHERE")) {
+      next();
+      q->where = parse_or();
+      if (!q->where) {
+        goto fail;
+      }
+    }
+    if (is_keyword("LIMIT")) {
+      next();
+      if (tok.type != Token::NUMBER || tok.text[0] == '-') {
+        fail("expected a limit");
+        goto fail;
+      }
+      q->limit = strtoll(tok.text.c_str(), nullptr, 10);
+      next();
+    }
+    if (tok.type != Token::END) {
+      fail("unexpected '" + tok.text + "'");
+      goto fail;
+    }
+    if (error.empty()) {
+      return 0;
+    }
+  fail:
+    *err = error;
+    return -EINVAL;
+  }
+};
+
+bool parse_number(const std::string& s, double *val)
+{
+  if (s.empty()) {
+    return false;
+  }
+  char *end;
+  errno = 0;
+  *val = strtod(s.c_str(), &end);
+  while (*end && isspace((unsigned char)*end)) {
+    ++end;
+  }
+  return errno == 0 && *end == '\0' && end != s.c_str();
+}
+
+template <typename T>
+bool compare(RGWSelectQuery::Condition::Op op, const T& l, const T& r)
+{
+  using Condition = RGWSelectQuery::Condition;
+  switch (op) {
+  case Condition::OP_EQ: return l == r;
+  case Condition::OP_NE: return l != r;
+  case Condition::OP_LT: return l < r;
+  case Condition::OP_LE: return l <= r;
+  case Condition::OP_GT: return l > r;
+  case Condition::OP_GE: return l >= r;
+  default: return false;
+  }
+}
+
+void for_each_operand(RGWSelectQuery::Condition *cond,
+                      const std::function<void(RGWSelectQuery::Operand&)>& f)
+{
+  if (!cond) {
+    return;
+  }
+  for_each_operand(cond->left.get(), f);
+  for_each_operand(cond->right.get(), f);
+  if (!cond->left) {
+    f(cond->lhs);
+    f(cond->rhs);
+  }
+}
+
+} // anonymous namespace
+
+bool RGWSelectQuery::Condition::eval(const std::vector<std::string>& fields) const
+{
+  switch (op) {
+  case OP_AND:
+    return left->eval(fields) && right->eval(fields);
+  case OP_OR:
+    return left->eval(fields) || right->eval(fields);
+  case OP_NOT:
+    return !left->eval(fields);
+  default:
+    break;
+  }
+
+  auto value = [&fields](const Operand& o) -> const std::string* {
+    if (!o.is_column) {
+      return &o.name;
+    }
+    if (o.index < 0 || (size_t)o.index >= fields.size()) {
+      return nullptr; // missing, compares as null
+    }
+    return &fields[o.index];
+  };
+  const std::string *l = value(lhs);
+  const std::string *r = value(rhs);
+  if (!l || !r) {
+    return false;
+  }
+
+  bool numeric;
+  if (lhs.type == TYPE_NUMBER || rhs.type == TYPE_NUMBER) {
+    numeric = true;
+  } else if (lhs.type == TYPE_STRING || rhs.type == TYPE_STRING) {
+    numeric = false;
+  } else {
+    double dummy;
+    numeric = parse_number(*l, &dummy) && parse_number(*r, &dummy);
+  }
+  if (numeric) {
+    double lv, rv;
+    if (!parse_number(*l, &lv) || !parse_number(*r, &rv)) {
+      return false;
+    }
+    return compare(op, lv, rv);
+  }
+  return compare(op, *l, *r);
+}
+
+int RGWSelectQuery::parse(const std::string& sql, std::unique_ptr<RGWSelectQuery> *query,
+                          std::string *err)
+{
+  auto q = std::make_unique<RGWSelectQuery>();
+  Parser parser(sql);
+  int r = parser.parse(q.get(), err);
+  if (r < 0) {
+    return r;
+  }
+  *query = std::move(q);
+  return 0;
+}
+
+bool RGWSelectQuery::has_named_columns() const
+{
+  bool found = false;
+  auto check = [&found](const Operand& o) {
+    found |= (o.is_column && o.index < 0);
+  };
+  for (auto& o : projection) {
+    check(o);
+  }
+  for_each_operand(where.get(), check);
+  return found;
+}
+
+int RGWSelectQuery::resolve_columns(const std::vector<std::string>& header,
+                                    std::string *err)
+{
+  auto resolve = [&header, err](Operand& o) {
+    if (!o.is_column || o.index >= 0) {
+      return;
+    }
+    for (size_t i = 0; i < header.size(); ++i) {
+      if (header[i] == o.name) {
+        o.index = i;
+        return;
+      }
+    }
+    for (size_t i = 0; i < header.size(); ++i) {
+      if (strcasecmp(header[i].c_str(), o.name.c_str()) == 0) {
+        o.index = i;
+        return;
+      }
+    }
+    if (err->empty()) {
+      *err = "no column named " + o.name;
+    }
+  };
+  for (auto& o : projection) {
+    resolve(o);
+  }
+  for_each_operand(where.get(), resolve);
+  return err->empty() ? 0 : -EINVAL;
+}
+
+static constexpr size_t SELECT_SEND_SIZE = 64 * 1024;
+
+void RGWGetObj_Select::split_record(std::string_view record)
+{
+  fields.clear();
+  fields.emplace_back();
+  bool quoted = false;
+  for (size_t i = 0; i < record.size(); ++i) {
+    char c = record[i];
+    if (input.quote && c == input.quote) {
+      if (quoted && i + 1 < record.size() && record[i + 1] == c) {
+        fields.back().push_back(c);
+        ++i;
+      } else {
+        quoted = !quoted;
+      }
+    } else if (c == input.field_delim && !quoted) {
+      fields.emplace_back();
+    } else {
+      fields.back().push_back(c);
+    }
+  }
+}
+
+void RGWGetObj_Select::append_field(std::string_view field)
+{
+  const char quote = output.quote ? output.quote : '"';
+  bool need_quote = output.quote_always ||
+    field.find_first_of(std::string{output.field_delim, output.record_delim,
+                                    quote, '\r'}) != std::string_view::npos;
+  if (!need_quote) {
+    out.append(field);
+    return;
+  }
+  out.push_back(quote);
+  for (char c : field) {
+    if (c == quote) {
+      out.push_back(quote);
+    }
+    out.push_back(c);
+  }
+  out.push_back(quote);
+}
+
+int RGWGetObj_Select::process_record(std::string_view record)
+{
+  if (input.record_delim == '\n' && !record.empty() && record.back() == '\r') {
+    record.remove_suffix(1);
+  }
+  if (record.empty() ||
+      (input.comment && record.front() == input.comment)) {
+    return 0;
+  }
+  if (first_record) {
+    first_record = false;
+    if (input.header == RGWSelectCSVFormat::HEADER_IGNORE) {
+      return 0;
+    }
+    if (input.header == RGWSelectCSVFormat::HEADER_USE) {
+      split_record(record);
+      std::string err;
+      int r = query.resolve_columns(fields, &err);
+      if (r < 0) {
+        ldout(cct, 5) << "select: " << err << dendl;
+      }
+      return r;
+    }
+  }
+  if (done()) {
+    return 0;
+  }
+  split_record(record);
+  if (query.where && !query.where->eval(fields)) {
+    return 0;
+  }
+  ++matched;
+  if (query.count) {
+    return 0;
+  }
+
+  if (query.select_all) {
+    for (size_t i = 0; i < fields.size(); ++i) {
+      if (i > 0) {
+        out.push_back(output.field_delim);
+      }
+      append_field(fields[i]);
+    }
+  } else {
+    for (size_t i = 0; i < query.projection.size(); ++i) {
+      auto& o = query.projection[i];
+      if (i > 0) {
+        out.push_back(output.field_delim);
+      }
+      if (!o.is_column) {
+        append_field(o.name);
+      } else if (o.index >= 0 && (size_t)o.index < fields.size()) {
+        append_field(fields[o.index]);
+      }
+    }
+  }
+  out.push_back(output.record_delim);
+
+  if (out.size() >= SELECT_SEND_SIZE) {
+    return send();
+  }
+  return 0;
+}
+
+int RGWGetObj_Select::send()
+{
+  if (out.empty()) {
+    return 0;
+  }
+  bufferlist bl;
+  bl.append(out);
+  bytes_returned += out.size();
+  out.clear();
+  return RGWGetObj_Filter::handle_data(bl, 0, bl.length());
+}
+
+int RGWGetObj_Select::handle_data(bufferlist& bl, off_t bl_ofs, off_t bl_len)
+{
+  bytes_scanned += bl_len;
+  if (done()) {
+    return 0; // nothing more to return, let the rest go by
+  }
+
+  auto& bufs = bl.buffers();
+  for (auto i = bufs.begin(); i != bufs.end() && bl_len > 0; ++i) {
+    if (bl_ofs >= (off_t)i->length()) {
+      bl_ofs -= i->length();
+      continue;
+    }
+    off_t len = std::min<off_t>(bl_len, i->length() - bl_ofs);
+    pending.append(i->c_str() + bl_ofs, len);
+    bl_len -= len;
+    bl_ofs = 0;
+  }
+
+  size_t start = 0;
+  for (; scan_pos < pending.size(); ++scan_pos) {
+    char c = pending[scan_pos];
+    if (input.quote && c == input.quote) {
+      scan_quoted = !scan_quoted;
+    } else if (c == input.record_delim && !scan_quoted) {
+      int r = process_record(std::string_view(pending).substr(start, scan_pos - start));
+      if (r < 0) {
+        return r;
+      }
+      start = scan_pos + 1;
+    }
+  }
+  pending.erase(0, start);
+  scan_pos = pending.size();
+  if (pending.size() > max_record_size) {
+    ldout(cct, 5) << "select: record over " << max_record_size
+                  << " bytes" << dendl;
+    return -ERR_TOO_LARGE;
+  }
+
+  return send();
+}
+
+int RGWGetObj_Select::flush()
+{
+  if (flushed) {
+    return 0;
+  }
+  flushed = true;
+
+  if (!pending.empty()) { // the last record has no delimiter
+    int r = process_record(pending);
+    if (r < 0) {
+      return r;
+    }
+    pending.clear();
+  }
+  if (query.count) {
+    out.append(std::to_string(matched));
+    out.push_back(output.record_delim);
+  }
+  int r = send();
+  if (r < 0) {
+    return r;
+  }
+  return RGWGetObj_Filter::flush();
+}
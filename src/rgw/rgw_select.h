@@ -0,0 +1,145 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_RGW_SELECT_H
+#define CEPH_RGW_SELECT_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "rgw_op.h"
+
+/*
+ * The subset of S3 Select that RGW evaluates while streaming a CSV
+ * object:
+ *
+ *   SELECT * | COUNT(*) | <column>[, <column> ...]
+ *   FROM S3Object [[AS] <alias>]
+ *   [WHERE <condition>]
+ *   [LIMIT <n>]
+ *
+ * A column is _1, _2, ... or, with FileHeaderInfo USE, a header name,
+ * optionally prefixed by the alias. A condition combines comparisons
+ * (=, !=, <>, <, <=, >, >=) of columns, string literals, numbers and
+ * CAST(<operand> AS INT|INTEGER|FLOAT|DECIMAL|STRING) with AND, OR,
+ * NOT and parentheses. Two values compare as numbers when either is
+ * cast to a number, or when neither is cast and both parse as numbers.
+ */
+
+struct RGWSelectCSVFormat {
+  enum Header {
+    HEADER_NONE,   ///< the first record is data
+    HEADER_IGNORE, ///< skip the first record
+    HEADER_USE,    ///< the first record names the columns
+  };
+
+  char field_delim{','};
+  char record_delim{'\n'};
+  char quote{'"'};
+  char comment{0};          ///< records starting with it are skipped, if set
+  Header header{HEADER_NONE};
+  bool quote_always{false}; ///< on output: quote every field, not as needed
+};
+
+class RGWSelectQuery {
+public:
+  enum ValueType {
+    TYPE_AUTO,
+    TYPE_STRING,
+    TYPE_NUMBER,
+  };
+
+  struct Operand {
+    bool is_column{false};
+    int index{-1};        ///< column index, -1 until resolved by name
+    std::string name;     ///< column name, or the literal
+    ValueType type{TYPE_AUTO};
+  };
+
+  struct Condition {
+    enum Op {
+      OP_AND,
+      OP_OR,
+      OP_NOT,
+      OP_EQ,
+      OP_NE,
+      OP_LT,
+      OP_LE,
+      OP_GT,
+      OP_GE,
+    } op{OP_EQ};
+    std::unique_ptr<Condition> left, right; ///< for AND, OR, NOT
+    Operand lhs, rhs;                       ///< for comparisons
+
+    bool eval(const std::vector<std::string>& fields) const;
+  };
+
+  bool select_all{false};
+  bool count{false};
+  std::vector<Operand> projection;
+  std::unique_ptr<Condition> where;
+  int64_t limit{-1};
+
+  /// returns -EINVAL with a description in *err on a syntax error
+  static int parse(const std::string& sql, std::unique_ptr<RGWSelectQuery> *query,
+                   std::string *err);
+
+  /// resolve the columns referred to by name against the header record;
+  /// returns -EINVAL with the missing name in *err
+  int resolve_columns(const std::vector<std::string>& header, std::string *err);
+  /// whether a column is referred to by name
+  bool has_named_columns() const;
+};
+
+/*
+ * Runs a select query over the CSV stream it gets, and passes on only
+ * the records (or the count) it returns, formatted as CSV.
+ */
+class RGWGetObj_Select : public RGWGetObj_Filter
+{
+  CephContext *cct;
+  RGWSelectQuery& query;
+  const RGWSelectCSVFormat& input;
+  const RGWSelectCSVFormat& output;
+
+  /// longest record we hold on to while looking for its end
+  static constexpr size_t max_record_size = 1 << 20;
+
+  std::string pending;    ///< data not yet split into records
+  size_t scan_pos{0};     ///< how far pending was scanned for a record end
+  bool scan_quoted{false};
+  std::string out;
+  std::vector<std::string> fields;
+  bool first_record{true};
+  bool flushed{false};
+  uint64_t matched{0};
+  uint64_t bytes_scanned{0};
+  uint64_t bytes_returned{0};
+
+  /// whether the query's limit was reached
+  bool done() const {
+    return query.limit >= 0 && matched >= (uint64_t)query.limit;
+  }
+  int process_record(std::string_view record);
+  void split_record(std::string_view record);
+  void append_field(std::string_view field);
+  int send();
+public:
+  RGWGetObj_Select(CephContext *cct, RGWSelectQuery& query,
+                   const RGWSelectCSVFormat& input,
+                   const RGWSelectCSVFormat& output,
+                   RGWGetObj_Filter *next)
+    : RGWGetObj_Filter(next), cct(cct), query(query), input(input),
+      output(output) {}
+  ~RGWGetObj_Select() override {}
+
+  int handle_data(bufferlist& bl, off_t bl_ofs, off_t bl_len) override;
+  int flush() override;
+
+  uint64_t get_bytes_scanned() const { return bytes_scanned; }
+  uint64_t get_bytes_returned() const { return bytes_returned; }
+};
+
+#endif
@@ -26,6 +26,7 @@
 
 
 #define PUBSUB_EVENTS_RETENTION_DEFAULT 7
+#define PUBSUB_MAX_PENDING_DELIVERIES_DEFAULT 16
 
 /*
 
@@ -36,6 +37,7 @@ config:
    "uid": <uid>,                   # default: "pubsub"
    "data_bucket_prefix": <prefix>  # default: "pubsub-"
    "data_oid_prefix": <prefix>     #
+   "max_pending_deliveries": <n>   # default: 16
 
     # non-dynamic config
     "notifications": [
@@ -191,6 +193,7 @@ struct PSConfig {
   string data_oid_prefix;
 
   int events_retention_days{0};
+  int max_pending_deliveries{PUBSUB_MAX_PENDING_DELIVERIES_DEFAULT};
 
   uint64_t sync_instance{0};
   uint64_t max_id{0};
@@ -206,6 +209,7 @@ struct PSConfig {
     encode_json("data_bucket_prefix", data_bucket_prefix, f);
     encode_json("data_oid_prefix", data_oid_prefix, f);
     encode_json("events_retention_days", events_retention_days, f);
+    encode_json("max_pending_deliveries", max_pending_deliveries, f);
     encode_json("sync_instance", sync_instance, f);
     encode_json("max_id", max_id, f);
     {
@@ -246,6 +250,7 @@ struct PSConfig {
     data_bucket_prefix = config["data_bucket_prefix"]("pubsub-");
     data_oid_prefix = config["data_oid_prefix"];
     events_retention_days = config["events_retention_days"](PUBSUB_EVENTS_RETENTION_DEFAULT);
+    max_pending_deliveries = std::max(1, (int)config["max_pending_deliveries"](PUBSUB_MAX_PENDING_DELIVERIES_DEFAULT));
 
     for (auto& c : config["notifications"].array()) {
       PSNotificationConfig nc;
@@ -771,15 +776,18 @@ class PSSubscription {
     const PSSubscriptionRef sub;
     const PSEvent<EventType> pse;
     const string oid_prefix;
+    bool* const handled;
 
   public:
     StoreEventCR(RGWDataSyncEnv* const _sync_env,
                  const PSSubscriptionRef& _sub,
-                 const EventRef<EventType>& _event) : RGWCoroutine(_sync_env->cct),
+                 const EventRef<EventType>& _event,
+                 bool* _handled) : RGWCoroutine(_sync_env->cct),
                                      sync_env(_sync_env),
                                      sub(_sub),
                                      pse(_event),
-                                     oid_prefix(sub->sub_conf->data_oid_prefix) {
+                                     oid_prefix(sub->sub_conf->data_oid_prefix),
+                                     handled(_handled) {
     }
 
     int operate() override {
@@ -804,9 +812,12 @@ class PSSubscription {
                                             put_obj,
                                             sync_env->dpp));
         if (retcode < 0) {
-          ldpp_dout(sync_env->dpp, 10) << "failed to store event: " << put_obj.bucket << "/" << put_obj.key << " ret=" << retcode << dendl;
+          if (perfcounter) perfcounter->inc(l_rgw_pubsub_store_fail);
+          ldpp_dout(sync_env->dpp, 1) << "ERROR: failed to store event: " << put_obj.bucket << "/" << put_obj.key << " ret=" << retcode << dendl;
           return set_cr_error(retcode);
         } else {
+          if (perfcounter) perfcounter->inc(l_rgw_pubsub_store_ok);
+          *handled = true;
           ldpp_dout(sync_env->dpp, 20) << "event stored: " << put_obj.bucket << "/" << put_obj.key << dendl;
         }
 
@@ -820,15 +831,18 @@ class PSSubscription {
   class PushEventCR : public RGWCoroutine {
     RGWDataSyncEnv* const sync_env;
     const EventRef<EventType> event;
-    const PSSubConfigRef& sub_conf;
+    const PSSubConfigRef sub_conf;
+    bool* const handled;
 
   public:
     PushEventCR(RGWDataSyncEnv* const _sync_env,
                  const PSSubscriptionRef& _sub,
-                 const EventRef<EventType>& _event) : RGWCoroutine(_sync_env->cct),
+                 const EventRef<EventType>& _event,
+                 bool* _handled) : RGWCoroutine(_sync_env->cct),
                                      sync_env(_sync_env),
                                      event(_event),
-                                     sub_conf(_sub->sub_conf) {
+                                     sub_conf(_sub->sub_conf),
+                                     handled(_handled) {
     }
 
     int operate() override {
@@ -837,10 +851,13 @@ class PSSubscription {
         yield call(sub_conf->push_endpoint->send_to_completion_async(*event.get(), sync_env));
       
         if (retcode < 0) {
-          ldout(sync_env->cct, 10) << "failed to push event: " << event->id <<
+          if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_failed);
+          ldout(sync_env->cct, 1) << "ERROR: failed to push event: " << event->id <<
             " to endpoint: " << sub_conf->push_endpoint_name << " ret=" << retcode << dendl;
           return set_cr_error(retcode);
         }
+        if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_ok);
+        *handled = true;
         
         ldout(sync_env->cct, 20) << "event: " << event->id <<
           " pushed to endpoint: " << sub_conf->push_endpoint_name << dendl;
@@ -886,14 +903,15 @@ public:
     return init_cr->execute(caller);
   }
 
+  // both set *handled when they succeed, and count their results
   template<typename EventType>
-  static RGWCoroutine *store_event_cr(RGWDataSyncEnv* const sync_env, const PSSubscriptionRef& sub, const EventRef<EventType>& event) {
-    return new StoreEventCR<EventType>(sync_env, sub, event);
+  static RGWCoroutine *store_event_cr(RGWDataSyncEnv* const sync_env, const PSSubscriptionRef& sub, const EventRef<EventType>& event, bool* handled) {
+    return new StoreEventCR<EventType>(sync_env, sub, event, handled);
   }
 
   template<typename EventType>
-  static RGWCoroutine *push_event_cr(RGWDataSyncEnv* const sync_env, const PSSubscriptionRef& sub, const EventRef<EventType>& event) {
-    return new PushEventCR<EventType>(sync_env, sub, event);
+  static RGWCoroutine *push_event_cr(RGWDataSyncEnv* const sync_env, const PSSubscriptionRef& sub, const EventRef<EventType>& event, bool* handled) {
+    return new PushEventCR<EventType>(sync_env, sub, event, handled);
   }
   friend class InitCR;
 };
@@ -1187,10 +1205,13 @@ class RGWPSHandleObjEventCR : public RGWCoroutine {
   bool event_handled;
   bool sub_conf_found;
   PSSubscriptionRef sub;
+  EventRef<rgw_pubsub_s3_record> sub_record;
   std::array<rgw_user, 2>::const_iterator oiter;
   std::vector<PSTopicConfigRef>::const_iterator titer;
   std::set<string>::const_iterator siter;
   int last_sub_conf_error;
+  // the last error of a store or push
+  int delivery_error{0};
 
 public:
   RGWPSHandleObjEventCR(RGWDataSyncEnv* const _sync_env,
@@ -1209,6 +1230,18 @@ public:
                                           has_subscriptions(false),
                                           event_handled(false) {}
 
+  void collect_deliveries() {
+    bool again = true;
+    while (again) {
+      int ret;
+      again = collect(&ret, nullptr);
+      if (ret < 0) {
+        // StoreEventCR and PushEventCR already logged and counted it
+        delivery_error = ret;
+      }
+    }
+  }
+
   int operate() override {
     reenter(this) {
       ldout(sync_env->cct, 20) << ": handle event: obj: z=" << sync_env->source_zone
@@ -1244,52 +1277,33 @@ public:
               continue;
             }
             sub_conf_found = true;
+            // store and push to all the subscriptions at once, rather than
+            // waiting on each endpoint in turn
             if (sub->sub_conf->s3_id.empty()) {
               // subscription was not made by S3 compatible API
               ldout(sync_env->cct, 20) << "storing event for subscription=" << *siter << " owner=" << *oiter << " ret=" << retcode << dendl;
-              yield call(PSSubscription::store_event_cr(sync_env, sub, event));
-              if (retcode < 0) {
-                if (perfcounter) perfcounter->inc(l_rgw_pubsub_store_fail);
-                ldout(sync_env->cct, 1) << "ERROR: failed to store event for subscription=" << *siter << " ret=" << retcode << dendl;
-              } else {
-                if (perfcounter) perfcounter->inc(l_rgw_pubsub_store_ok);
-                event_handled = true;
-              }
+              spawn(PSSubscription::store_event_cr(sync_env, sub, event, &event_handled), false);
               if (sub->sub_conf->push_endpoint) {
                 ldout(sync_env->cct, 20) << "push event for subscription=" << *siter << " owner=" << *oiter << " ret=" << retcode << dendl;
-                yield call(PSSubscription::push_event_cr(sync_env, sub, event));
-                if (retcode < 0) {
-                  if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_failed);
-                  ldout(sync_env->cct, 1) << "ERROR: failed to push event for subscription=" << *siter << " ret=" << retcode << dendl;
-                } else {
-                  if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_ok);
-                  event_handled = true;
-                }
+                spawn(PSSubscription::push_event_cr(sync_env, sub, event, &event_handled), false);
               } 
             } else {
-              // subscription was made by S3 compatible API
+              // subscription was made by S3 compatible API; each gets its
+              // own copy of the record, tagged with its configuration id
               ldout(sync_env->cct, 20) << "storing record for subscription=" << *siter << " owner=" << *oiter << " ret=" << retcode << dendl;
-              record->configurationId = sub->sub_conf->s3_id;
-              yield call(PSSubscription::store_event_cr(sync_env, sub, record));
-              if (retcode < 0) {
-                if (perfcounter) perfcounter->inc(l_rgw_pubsub_store_fail);
-                ldout(sync_env->cct, 1) << "ERROR: failed to store record for subscription=" << *siter << " ret=" << retcode << dendl;
-              } else {
-                if (perfcounter) perfcounter->inc(l_rgw_pubsub_store_ok);
-                event_handled = true;
-              }
+              sub_record = std::make_shared<rgw_pubsub_s3_record>(*record);
+              sub_record->configurationId = sub->sub_conf->s3_id;
+              spawn(PSSubscription::store_event_cr(sync_env, sub, sub_record, &event_handled), false);
               if (sub->sub_conf->push_endpoint) {
                   ldout(sync_env->cct, 20) << "push record for subscription=" << *siter << " owner=" << *oiter << " ret=" << retcode << dendl;
-                yield call(PSSubscription::push_event_cr(sync_env, sub, record));
-                if (retcode < 0) {
-                  if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_failed);
-                  ldout(sync_env->cct, 1) << "ERROR: failed to push record for subscription=" << *siter << " ret=" << retcode << dendl;
-                } else {
-                  if (perfcounter) perfcounter->inc(l_rgw_pubsub_push_ok);
-                  event_handled = true;
-                }
+                spawn(PSSubscription::push_event_cr(sync_env, sub, sub_record, &event_handled), false);
               }
             }
+            // bound the stores and pushes in flight
+            while ((int)num_spawned() > env->conf->max_pending_deliveries) {
+              yield wait_for_child();
+              collect_deliveries();
+            }
           }
           if (!sub_conf_found) {
             // could not find conf for subscription at user or global levels
@@ -1304,6 +1318,13 @@ public:
           }
         }
       }
+      while (num_spawned() > 0) {
+        yield wait_for_child();
+        collect_deliveries();
+      }
+      if (retcode >= 0 && delivery_error < 0) {
+        retcode = delivery_error;
+      }
       if (has_subscriptions && !event_handled) {
         // event is considered "lost" of it has subscriptions on any of its topics
         // but it was not stored in, or pushed to, any of them
@@ -11,6 +11,7 @@
 
 #include "rgw_sync_trace.h"
 #include "rgw_rados.h"
+#include "rgw_coroutine.h"
 
 
 #define dout_context g_ceph_context
@@ -124,6 +125,7 @@ void RGWSyncTraceManager::init(RGWRados *store)
 {
   service_map_thread = new RGWSyncTraceServiceMapThread(store, this);
   service_map_thread->start();
+  cr_registry = store->get_cr_registry();
 }
 
 RGWSyncTraceManager::~RGWSyncTraceManager()
@@ -142,7 +144,8 @@ int RGWSyncTraceManager::hook_to_admin_command()
   admin_commands = { { "sync trace show", "sync trace show name=search,type=CephString,req=false", "sync trace show [filter_str]: show current multisite tracing information" },
                      { "sync trace history", "sync trace history name=search,type=CephString,req=false", "sync trace history [filter_str]: show history of multisite tracing information" },
                      { "sync trace active", "sync trace active name=search,type=CephString,req=false", "show active multisite sync entities information" },
-                     { "sync trace active_short", "sync trace active_short name=search,type=CephString,req=false", "show active multisite sync entities entries" } };
+                     { "sync trace active_short", "sync trace active_short name=search,type=CephString,req=false", "show active multisite sync entities entries" },
+                     { "sync trace cr_stats", "sync trace cr_stats", "show run and queue time of multisite sync coroutines, by type" } };
   for (auto cmd : admin_commands) {
     int r = admin_socket->register_command(cmd[0], cmd[1], this,
                                            cmd[2]);
@@ -201,6 +204,17 @@ bool RGWSyncTraceManager::call(std::string_view command, const cmdmap_t& cmdmap,
   bool show_short = (command == "sync trace active_short");
   bool show_active = (command == "sync trace active") || show_short;
 
+  if (command == "sync trace cr_stats") {
+    stringstream ss;
+    JSONFormatter f(true);
+    if (cr_registry) {
+      cr_registry->dump_stats(&f);
+    }
+    f.flush(ss);
+    out.append(ss);
+    return true;
+  }
+
   string search;
 
   auto si = cmdmap.find("search");
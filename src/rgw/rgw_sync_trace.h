@@ -26,6 +26,7 @@
 #define RGW_SNS_FLAG_ERROR    2
 
 class RGWRados;
+class RGWCoroutinesManagerRegistry;
 class RGWSyncTraceManager;
 class RGWSyncTraceNode;
 class RGWSyncTraceServiceMapThread;
@@ -107,6 +108,7 @@ class RGWSyncTraceManager : public AdminSocketHook {
 
   CephContext *cct;
   RGWSyncTraceServiceMapThread *service_map_thread{nullptr};
+  RGWCoroutinesManagerRegistry *cr_registry{nullptr};
 
   std::map<uint64_t, RGWSyncTraceNodeRef> nodes;
   boost::circular_buffer<RGWSyncTraceNodeRef> complete_nodes;
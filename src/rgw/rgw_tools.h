@@ -40,12 +40,15 @@ void rgw_filter_attrset(map<string, bufferlist>& unfiltered_attrset, const strin
 /// used to log warnings if synchronous librados calls are made
 extern thread_local bool is_asio_thread;
 
-/// perform the rados operation, using the yield context when given
+/// perform the rados operation, using the yield context when given. the
+/// object version is stored to *pver, if given; ioctx.get_last_version()
+/// isn't updated by the asynchronous path
 int rgw_rados_operate(librados::IoCtx& ioctx, const std::string& oid,
                       librados::ObjectReadOperation *op, bufferlist* pbl,
-                      optional_yield y);
+                      optional_yield y, uint64_t *pver = nullptr);
 int rgw_rados_operate(librados::IoCtx& ioctx, const std::string& oid,
-                      librados::ObjectWriteOperation *op, optional_yield y);
+                      librados::ObjectWriteOperation *op, optional_yield y,
+                      uint64_t *pver = nullptr);
 int rgw_rados_notify(librados::IoCtx& ioctx, const std::string& oid,
                      bufferlist& bl, uint64_t timeout_ms, bufferlist* pbl,
                      optional_yield y);
@@ -770,6 +770,7 @@ static void dump_user_info(Formatter *f, RGWUserInfo &info,
   }
   encode_json("type", user_source_type, f);
   encode_json("mfa_ids", info.mfa_ids, f);
+  encode_json("qos", info.qos, f);
   if (stats) {
     encode_json("stats", *stats, f);
   }
@@ -2290,6 +2291,10 @@ int RGWUser::execute_modify(RGWUserAdminOpState& op_state, std::string *err_msg)
   if (op_state.mfa_ids_specified) {
     user_info.mfa_ids = op_state.mfa_ids;
   }
+
+  if (op_state.qos_specified) {
+    user_info.qos = op_state.qos;
+  }
   op_state.set_user_info(user_info);
 
   // if we're supposed to modify keys, do so
@@ -181,6 +181,7 @@ struct RGWUserAdminOpState {
   int32_t key_type;
 
   std::set<string> mfa_ids;
+  RGWUserQoS qos;
 
   // operation attributes
   bool existing_user;
@@ -212,6 +213,7 @@ struct RGWUserAdminOpState {
   bool found_by_email;  
   bool found_by_key;
   bool mfa_ids_specified;
+  bool qos_specified;
  
   // req parameters
   bool populated;
@@ -401,6 +403,11 @@ struct RGWUserAdminOpState {
     mfa_ids_specified = true;
   }
 
+  void set_qos(const RGWUserQoS& q) {
+    qos = q;
+    qos_specified = true;
+  }
+
   bool is_populated() { return populated; }
   bool is_initialized() { return initialized; }
   bool has_existing_user() { return existing_user; }
@@ -538,6 +545,7 @@ struct RGWUserAdminOpState {
     found_by_email = false;
     found_by_key = false;
     mfa_ids_specified = false;
+    qos_specified = false;
     max_entries = 1000;
     marker = "";
   }
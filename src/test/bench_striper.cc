@@ -0,0 +1,52 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "include/types.h"
+#include "common/ceph_argparse.h"
+#include "common/Clock.h"
+#include "global/global_init.h"
+#include "osdc/Striper.h"
+
+/*
+ * time Striper::file_to_extents against a layout, e.g.
+ *
+ *   ceph_bench_striper 4096 16 4194304 67108864 1000
+ *
+ * maps 1000 64MB I/Os against 4k stripe units over 16 4MB objects.
+ */
+int main(int argc, const char **argv)
+{
+  if (argc < 6) {
+    cerr << "usage: " << argv[0]
+	 << " <stripe_unit> <stripe_count> <object_size> <len> <iterations>"
+	 << std::endl;
+    return 1;
+  }
+  file_layout_t l;
+  l.stripe_unit = atoi(argv[1]);
+  l.stripe_count = atoi(argv[2]);
+  l.object_size = atoi(argv[3]);
+  uint64_t len = strtoull(argv[4], NULL, 10);
+  int iterations = atoi(argv[5]);
+
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  uint64_t num_extents = 0;
+  utime_t start = ceph_clock_now();
+  for (int i = 0; i < iterations; ++i) {
+    vector<ObjectExtent> ex;
+    Striper::file_to_extents(g_ceph_context, "rbd_data.1234.%016llx", &l,
+			     (uint64_t)i * len, len, 0, ex);
+    num_extents += ex.size();
+  }
+  utime_t dur = ceph_clock_now() - start;
+
+  cout << iterations << " x " << len << " bytes -> " << num_extents
+       << " extents in " << dur << " ("
+       << (double)dur * 1000000 / iterations << " us each)" << std::endl;
+  return 0;
+}
@@ -2113,6 +2113,20 @@ TEST(BufferList, append_hole) {
   }
 }
 
+TEST(BufferList, reserve) {
+  bufferlist bl;
+  bl.append('A');
+  bl.reserve(10000);
+  EXPECT_LE(10000u, bl.get_append_buffer_unused_tail_length());
+  const unsigned buffers = bl.get_num_buffers();
+  for (unsigned i = 0; i < 1000; i++)
+    bl.append("0123456789", 10);
+  EXPECT_EQ(buffers, bl.get_num_buffers());
+  EXPECT_EQ(10001u, bl.length());
+  EXPECT_EQ('A', bl[0]);
+  EXPECT_EQ('9', bl[10000]);
+}
+
 TEST(BufferList, append_zero) {
   bufferlist bl;
   bl.append('A');
@@ -2368,6 +2382,29 @@ TEST(BufferList, crc32c_append) {
   ASSERT_EQ(bl1.crc32c(0), bl2.crc32c(0));
 }
 
+TEST(BufferList, crc32c_adjacent_ptrs) {
+  // many ptrs into one raw, back to back, are hashed as one range
+  bufferptr p(4096);
+  for (unsigned i = 0; i < p.length(); i++)
+    p.c_str()[i] = i * 7;
+  bufferlist bl;
+  for (unsigned off = 0; off < p.length(); off += 64)
+    bl.append(p, off, 64);
+  bl.append("x", 1);
+  bufferlist whole;
+  whole.append(p.c_str(), p.length());
+  whole.append("x", 1);
+  const uint32_t crc = whole.crc32c(3);
+  EXPECT_EQ(crc, bl.crc32c(3));
+
+  buffer::track_cached_crc(true);
+  int base_cached = buffer::get_cached_crc();
+  EXPECT_EQ(crc, bl.crc32c(3));
+  // the run of 64 ptrs, and the appended byte
+  EXPECT_EQ(2 + base_cached, buffer::get_cached_crc());
+  buffer::track_cached_crc(false);
+}
+
 TEST(BufferList, crc32c_zeros) {
   char buffer[4*1024];
   for (size_t i=0; i < sizeof(buffer); i++)
@@ -95,6 +95,7 @@
         [--num-rep n]
         [--pool-id n]      specifies pool id
         [--batches b]      split the CRUSH mapping into b > 1 rounds
+        [--threads n]      map the inputs with n threads
         [--weight|-w devno weight]
                            where weight is 0 to 1.0
         [--simulate]       simulate placements using a random
@@ -107,6 +108,8 @@
      --show-mappings       show mappings
      --show-bad-mappings   show bad mappings
      --show-choose-tries   show choose tries histogram
+     --show-imbalance      show how far the rule's failure domains are
+                           from their expected share
      --output-name name
                            prepend the data file(s) generated during the
                            testing routine with name
@@ -121,6 +124,7 @@
      --set-subtree-class <bucket-name> <class>
                            set class for all items beneath bucket-name
      --compare <otherfile> compare two maps using --test parameters
+        [--show-movement]  show the share of placements that move
   
   Options for the output stage
   
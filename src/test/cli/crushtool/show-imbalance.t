@@ -0,0 +1,15 @@
+  $ map="$TESTDIR/show-imbalance.crushmap"
+  $ CEPH_ARGS="--debug-crush 0" crushtool --outfn "$map" --build --num_osds 2 host straw2 2 root straw2 0
+
+#
+# a single host stores exactly its expected share
+#
+  $ crushtool -i "$map" --test --show-imbalance --num-rep 1 --min-x 0 --max-x 99
+  rule 0 (replicated_rule) num_rep 1 1 host stored/expected: min 1 (host0) max 1 (host0) stddev 0
+  $ crushtool -i "$map" --test --show-imbalance --num-rep 1 --min-x 0 --max-x 99 --threads 2
+  rule 0 (replicated_rule) num_rep 1 1 host stored/expected: min 1 (host0) max 1 (host0) stddev 0
+  $ rm "$map"
+
+# Local Variables:
+# compile-command: "cd ../../.. ; make crushtool && test/run-cli-tests"
+# End:
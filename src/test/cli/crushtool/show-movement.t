@@ -0,0 +1,25 @@
+  $ map="$TESTDIR/show-movement.crushmap"
+  $ CEPH_ARGS="--debug-crush 0" crushtool --outfn "$map" --build --num_osds 2 host straw2 2 root straw2 0
+
+#
+# nothing moves between a map and itself
+#
+  $ crushtool -i "$map" --compare "$map" --show-movement --num-rep 1 --min-x 0 --max-x 99
+  rule 0 had 0/100 mismatched mappings (0)
+  rule 0 moved 0/100 placements (0)
+  maps appear equivalent
+
+#
+# without --show-movement only the mismatches are reported
+#
+  $ crushtool -i "$map" --compare "$map" --num-rep 1 --min-x 0 --max-x 99
+  rule 0 had 0/100 mismatched mappings (0)
+  maps appear equivalent
+  $ crushtool -i "$map" --compare "$map" --min-x 10 --max-x 5
+  min_x 10 is greater than max_x 5
+  [1]
+  $ rm "$map"
+
+# Local Variables:
+# compile-command: "cd ../../.. ; make crushtool && test/run-cli-tests"
+# End:
@@ -0,0 +1,26 @@
+  $ map="$TESTDIR/threads.crushmap"
+  $ CEPH_ARGS="--debug-crush 0" crushtool --outfn "$map" --build --num_osds 16 host straw2 4 root straw2 0
+
+#
+# the mappings don't depend on how many threads compute them
+#
+  $ crushtool -i "$map" --test --show-mappings --show-statistics --min-x 0 --max-x 4095 > "$map.one" 2>&1
+  $ crushtool -i "$map" --test --show-mappings --show-statistics --min-x 0 --max-x 4095 --threads 4 > "$map.four" 2>&1
+  $ cmp "$map.one" "$map.four"
+  $ crushtool -i "$map" --test --show-mappings --show-statistics --min-x 0 --max-x 4095 --threads 3 --batches 5 > "$map.three" 2>&1
+  $ cmp "$map.one" "$map.three"
+  $ crushtool -i "$map" --test --show-mappings --threads 0
+  --threads must be at least 1
+  [1]
+
+#
+# an empty x range is refused
+#
+  $ crushtool -i "$map" --test --show-mappings --min-x 10 --max-x 5
+  min_x 10 is greater than max_x 5
+  [1]
+  $ rm "$map" "$map.one" "$map.four" "$map.three"
+
+# Local Variables:
+# compile-command: "cd ../../.. ; make crushtool && test/run-cli-tests"
+# End:
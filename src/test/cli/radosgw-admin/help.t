@@ -175,6 +175,9 @@
      --admin                   set the admin flag on the user
      --system                  set the system flag on the user
      --op-mask                 set the op mask on the user
+     --qos-reservation=<ops>   dmclock reservation of the user's requests
+     --qos-weight=<weight>     dmclock weight of the user's requests (0 to disable)
+     --qos-limit=<ops>         dmclock limit of the user's requests
      --bucket=<bucket>         Specify the bucket name. Also used by the quota command.
      --pool=<pool>             Specify the pool name. Also used to scan for leaked rados objects.
      --object=<object>         object name
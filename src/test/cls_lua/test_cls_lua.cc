@@ -287,6 +287,62 @@ objclass.register(bl_concat_eq)
 objclass.register(bl_concat_ne)
 objclass.register(bl_concat_immut)
 
+--
+-- Bufferlist ranges
+--
+function bl_sub(input, output)
+  local bl = bufferlist.new()
+  bl:append('abc')
+  bl:append('def')
+  assert(bl:sub(0) == 'abcdef')
+  assert(bl:sub(2, 2) == 'cd')
+  assert(bl:sub(4, 100) == 'ef')
+  assert(bl:sub(6) == '')
+  assert(bl:byte(3) == string.byte('d'))
+  output:append(input:sub(1, 3))
+end
+
+function bl_view(input, output)
+  local bl = bufferlist.new()
+  bl:append('abcdef')
+  local v = bl:view(1, 4)
+  assert(v:str() == 'bcde')
+  bl:append('g')
+  assert(v:str() == 'bcde')
+  output:append(input:view(1))
+end
+
+function bl_range_bad()
+  local bl = bufferlist.new()
+  bl:append('abc')
+  bl:sub(4)
+end
+
+objclass.register(bl_sub)
+objclass.register(bl_view)
+objclass.register(bl_range_bad)
+
+--
+-- State isolation
+--
+calls = 0
+function state_count(input, output)
+  calls = calls + 1
+  output:append(tostring(calls))
+end
+
+function state_keep_input(input, output)
+  kept = input
+end
+
+function state_use_input(input, output)
+  output:append(kept:str())
+end
+
+objclass.register(state_count)
+objclass.register(state_keep_input)
+objclass.register(state_use_input)
+
 --
 -- RunError
 --
@@ -867,6 +923,31 @@ TEST_F(ClsLua, BufferlistConcat) {
   ASSERT_EQ(0, clslua_exec(test_script, NULL, "bl_concat_immut"));
 }
 
+TEST_F(ClsLua, BufferlistRange) {
+  bufferlist inbl;
+  inbl.append("0123");
+  inbl.append("4567");
+  ASSERT_EQ(0, clslua_exec(test_script, &inbl, "bl_sub"));
+  ASSERT_EQ("123", std::string(reply_output.c_str(), reply_output.length()));
+  ASSERT_EQ(0, clslua_exec(test_script, &inbl, "bl_view"));
+  ASSERT_EQ("1234567", std::string(reply_output.c_str(), reply_output.length()));
+  ASSERT_EQ(-EIO, clslua_exec(test_script, NULL, "bl_range_bad"));
+}
+
+TEST_F(ClsLua, StateIsolation) {
+  // every call runs the script in a new state, even once it is compiled
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(0, clslua_exec(test_script, NULL, "state_count"));
+    ASSERT_EQ("1", std::string(reply_output.c_str(), reply_output.length()));
+  }
+
+  // so the globals of a returned call are gone
+  bufferlist inbl;
+  inbl.append("input");
+  ASSERT_EQ(0, clslua_exec(test_script, &inbl, "state_keep_input"));
+  ASSERT_EQ(-EIO, clslua_exec(test_script, NULL, "state_use_input"));
+}
+
 TEST_F(ClsLua, GetXattr) {
   bufferlist bl;
   bl.append("blahblahblahblahblah");
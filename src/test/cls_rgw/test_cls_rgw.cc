@@ -144,6 +144,60 @@ TEST(cls_rgw, index_basic)
 	     obj_size * NUM_OBJS);
 }
 
+TEST(cls_rgw, index_complete_ops)
+{
+  string bucket_oid = "bucket-complete-ops";
+
+  OpMgr mgr;
+
+  ObjectWriteOperation *op = mgr.write_op();
+  cls_rgw_bucket_init_index(*op);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, op));
+
+  uint64_t obj_size = 1024;
+
+  list<rgw_cls_obj_complete_op> ops;
+  for (int i = 0; i < NUM_OBJS; i++) {
+    string obj = str_int("obj", i);
+    string tag = str_int("tag", i);
+    string loc = str_int("loc", i);
+
+    index_prepare(mgr, ioctx, bucket_oid, CLS_RGW_OP_ADD, tag, obj, loc);
+
+    rgw_cls_obj_complete_op c;
+    c.op = CLS_RGW_OP_ADD;
+    c.key = cls_rgw_obj_key(obj, string());
+    c.tag = tag;
+    c.ver.pool = ioctx.get_id();
+    c.ver.epoch = 1;
+    c.meta.category = RGWObjCategory::None;
+    c.meta.size = obj_size;
+    c.meta.accounted_size = obj_size;
+    c.log_op = true;
+    ops.push_back(c);
+  }
+
+  /* an op without a pending tag is skipped, the others still apply */
+  rgw_cls_obj_complete_op stray = ops.front();
+  stray.key = cls_rgw_obj_key("stray", string());
+  ops.push_back(stray);
+
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, 0, 0);
+
+  op = mgr.write_op();
+  cls_rgw_bucket_complete_ops(*op, ops);
+  ASSERT_EQ(0, ioctx.operate(bucket_oid, op));
+
+  test_stats(ioctx, bucket_oid, RGWObjCategory::None, NUM_OBJS,
+	     obj_size * NUM_OBJS);
+
+  /* a batch can't complete a key twice */
+  ops.push_back(stray);
+  op = mgr.write_op();
+  cls_rgw_bucket_complete_ops(*op, ops);
+  ASSERT_EQ(-EINVAL, ioctx.operate(bucket_oid, op));
+}
+
 TEST(cls_rgw, index_multiple_obj_writers)
 {
   string bucket_oid = str_int("bucket", 1);
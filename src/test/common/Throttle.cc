@@ -164,6 +164,31 @@ TEST_F(ThrottleTest, get_or_fail) {
   }
 }
 
+TEST_F(ThrottleTest, concurrent) {
+  // gets and puts that mostly don't wait, mixed with some that do
+  const int64_t throttle_max = 16;
+  Throttle throttle(g_ceph_context, "throttle", throttle_max);
+  std::atomic<bool> over = { false };
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&throttle, &over, i]() {
+      for (int j = 0; j < 10000; j++) {
+	int64_t c = 1 + (i + j) % 4;
+	throttle.get(c);
+	if (throttle.get_current() > throttle_max) {
+	  over = true;
+	}
+	throttle.put(c);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_FALSE(over);
+  ASSERT_EQ(0, throttle.get_current());
+}
+
 TEST_F(ThrottleTest, wait) {
   int64_t throttle_max = 10;
   Throttle throttle(g_ceph_context, "throttle");
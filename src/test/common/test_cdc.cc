@@ -0,0 +1,128 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <random>
+#include <set>
+#include <vector>
+
+#include "include/types.h"
+#include "include/buffer.h"
+
+#include "common/CDC.h"
+#include "gtest/gtest.h"
+
+static bufferlist random_data(size_t len, unsigned seed)
+{
+  std::mt19937 gen(seed);
+  bufferptr bp(len);
+  for (size_t i = 0; i < len; i++) {
+    bp[i] = gen();
+  }
+  bufferlist bl;
+  bl.append(std::move(bp));
+  return bl;
+}
+
+static void check_chunks(const std::vector<std::pair<uint64_t, uint64_t>>& chunks,
+			 uint64_t len)
+{
+  uint64_t off = 0;
+  for (auto& c : chunks) {
+    ASSERT_EQ(off, c.first);
+    ASSERT_GT(c.second, 0u);
+    off += c.second;
+  }
+  ASSERT_EQ(len, off);
+}
+
+TEST(CDC, unknown) {
+  ASSERT_FALSE(CDC::create("rabin", 12));
+}
+
+TEST(CDC, bits_out_of_range) {
+  for (auto type : {"fixed", "fastcdc"}) {
+    ASSERT_FALSE(CDC::create(type, CDC::MIN_BITS - 1));
+    ASSERT_FALSE(CDC::create(type, CDC::MAX_BITS + 1));
+    ASSERT_FALSE(CDC::create(type, 64));
+    ASSERT_TRUE(CDC::create(type, CDC::MIN_BITS));
+    ASSERT_TRUE(CDC::create(type, CDC::MAX_BITS));
+  }
+}
+
+TEST(CDC, fixed) {
+  auto cdc = CDC::create("fixed", 12);
+  bufferlist bl = random_data(10000, 0);
+  std::vector<std::pair<uint64_t, uint64_t>> chunks;
+  cdc->calc_chunks(bl, &chunks);
+  ASSERT_EQ(3u, chunks.size());
+  ASSERT_EQ(4096u, chunks[0].second);
+  ASSERT_EQ(4096u, chunks[1].second);
+  ASSERT_EQ(10000u - 8192u, chunks[2].second);
+  check_chunks(chunks, bl.length());
+}
+
+TEST(CDC, fastcdc_sizes) {
+  auto cdc = CDC::create("fastcdc", 12);
+  bufferlist bl = random_data(1 << 22, 1);
+  std::vector<std::pair<uint64_t, uint64_t>> chunks;
+  cdc->calc_chunks(bl, &chunks);
+  check_chunks(chunks, bl.length());
+  for (unsigned i = 0; i + 1 < chunks.size(); i++) {
+    ASSERT_GE(chunks[i].second, 1024u);
+    ASSERT_LE(chunks[i].second, 16384u);
+  }
+  // the average is around 2^12
+  uint64_t avg = bl.length() / chunks.size();
+  ASSERT_GT(avg, 2048u);
+  ASSERT_LT(avg, 8192u);
+
+  // zeros never match the masks, so they're cut at the max size
+  bufferlist zeros;
+  zeros.append_zero(100000);
+  chunks.clear();
+  cdc->calc_chunks(zeros, &chunks);
+  check_chunks(chunks, zeros.length());
+  ASSERT_EQ(16384u, chunks[0].second);
+}
+
+TEST(CDC, fastcdc_fragmented) {
+  // the chunks don't depend on how the data is split into buffers
+  auto cdc = CDC::create("fastcdc", 12);
+  bufferlist bl = random_data(1 << 20, 2);
+  bufferlist fragmented;
+  std::mt19937 gen(3);
+  for (uint64_t off = 0; off < bl.length();) {
+    uint64_t len = std::min<uint64_t>(1 + gen() % 5000, bl.length() - off);
+    fragmented.push_back(buffer::copy(bl.c_str() + off, len));
+    off += len;
+  }
+  ASSERT_GT(fragmented.get_num_buffers(), 1u);
+
+  std::vector<std::pair<uint64_t, uint64_t>> chunks, fragmented_chunks;
+  cdc->calc_chunks(bl, &chunks);
+  cdc->calc_chunks(fragmented, &fragmented_chunks);
+  ASSERT_EQ(chunks, fragmented_chunks);
+}
+
+TEST(CDC, fastcdc_insert) {
+  // a byte inserted in front only changes the chunks around it
+  auto cdc = CDC::create("fastcdc", 12);
+  bufferlist bl = random_data(1 << 20, 4);
+  bufferlist shifted;
+  shifted.append('a');
+  shifted.append(bl);
+
+  std::vector<std::pair<uint64_t, uint64_t>> chunks, shifted_chunks;
+  cdc->calc_chunks(bl, &chunks);
+  cdc->calc_chunks(shifted, &shifted_chunks);
+
+  std::set<uint64_t> ends;
+  for (auto& c : chunks) {
+    ends.insert(c.first + c.second);
+  }
+  unsigned same = 0;
+  for (auto& c : shifted_chunks) {
+    same += ends.count(c.first + c.second - 1);
+  }
+  ASSERT_GE(same, chunks.size() - 2);
+}
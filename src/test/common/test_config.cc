@@ -20,6 +20,7 @@
  *
  */
 #include "common/config_proxy.h"
+#include "common/config_cacher.h"
 #include "common/errno.h"
 #include "gtest/gtest.h"
 #include "common/hostname.h"
@@ -239,6 +240,22 @@ TEST(md_config_t, set_val)
   }
 }
 
+TEST(md_config_cacher_t, tracks_its_option)
+{
+  ConfigProxy conf{false};
+  // two cachers of the same type, each following its own option
+  md_config_cacher_t<uint64_t> per_pg(conf, "osd_omap_cursors_per_pg");
+  md_config_cacher_t<uint64_t> ttl(conf, "osd_omap_cursor_ttl");
+  EXPECT_EQ(conf.get_val<uint64_t>("osd_omap_cursors_per_pg"), per_pg);
+  EXPECT_EQ(conf.get_val<uint64_t>("osd_omap_cursor_ttl"), ttl);
+
+  EXPECT_EQ(0, conf.set_val("osd_omap_cursors_per_pg", "3"));
+  EXPECT_EQ(0, conf.set_val("osd_omap_cursor_ttl", "7"));
+  conf.apply_changes(nullptr);
+  EXPECT_EQ(3u, per_pg);
+  EXPECT_EQ(7u, ttl);
+}
+
 TEST(Option, validation)
 {
   Option opt_int("foo", Option::TYPE_INT, Option::LEVEL_BASIC);
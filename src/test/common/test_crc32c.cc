@@ -178,6 +178,22 @@ TEST(Crc32c, Range) {
   free(b);
 }
 
+TEST(Crc32c, Multi) {
+  const unsigned n = 11;  // not a multiple of any interleave width
+  for (unsigned len : {1u, 7u, 8u, 33u, 4096u}) {
+    std::vector<unsigned char> buf(n * len);
+    for (size_t i = 0; i < buf.size(); i++)
+      buf[i] = (i * 7 + len) & 0xff;
+    const unsigned char *data[n];
+    for (unsigned i = 0; i < n; i++)
+      data[i] = buf.data() + i * len;
+    uint32_t out[n];
+    ceph_crc32c_multi(1234, data, n, len, out);
+    for (unsigned i = 0; i < n; i++)
+      ASSERT_EQ(ceph_crc32c(1234, data[i], len), out[i]);
+  }
+}
+
 static uint32_t crc_zero_check_table[] = {
 0xbd6f81f8, 0x6213374d, 0x72952aeb, 0x8ecb5e52, 0xa04914b4, 0xaf3aaea9, 0xb88d42d6, 0x81797724,
 0xc0022634, 0x4dbf46a4, 0xc7813aa, 0x172150e0, 0x13d8d958, 0x339fd933, 0xd9e725f4, 0x20b65b14,
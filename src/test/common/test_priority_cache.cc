@@ -0,0 +1,158 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <memory>
+#include "gtest/gtest.h"
+#include "common/PriorityCache.h"
+#include "global/global_context.h"
+
+using PriorityCache::GhostCache;
+using PriorityCache::Manager;
+using PriorityCache::MissStats;
+using PriorityCache::Priority;
+
+TEST(GhostCache, TrimByBytes) {
+  GhostCache g;
+  g.set_max_bytes(100);
+  for (uint64_t k = 0; k < 5; ++k) {
+    g.insert(k, 30);
+  }
+  // only the three newest fit
+  ASSERT_EQ(90u, g.get_bytes());
+  ASSERT_FALSE(g.erase(0));
+  ASSERT_FALSE(g.erase(1));
+  ASSERT_TRUE(g.erase(2));
+  ASSERT_TRUE(g.erase(4));
+  // and each is a hit only once
+  ASSERT_FALSE(g.erase(4));
+
+  g.set_max_bytes(0);
+  ASSERT_EQ(0u, g.get_bytes());
+  ASSERT_FALSE(g.erase(3));
+}
+
+TEST(GhostCache, ReinsertKeepsNewest) {
+  GhostCache g;
+  g.set_max_bytes(100);
+  g.insert(1, 40);
+  g.insert(2, 40);
+  g.insert(1, 40);
+  // trimming the first entry of 1 must not forget its second one
+  ASSERT_EQ(80u, g.get_bytes());
+  ASSERT_TRUE(g.erase(1));
+  ASSERT_TRUE(g.erase(2));
+}
+
+struct FakeCache : public PriorityCache::PriCache {
+  std::string name;
+  bool keeps_stats;
+  MissStats stats;
+  int64_t bytes = 0;
+  double ratio = 0.5;
+
+  FakeCache(const std::string& n, bool s) : name(n), keeps_stats(s) {}
+
+  int64_t request_cache_bytes(Priority pri, uint64_t total) const override {
+    return 0;
+  }
+  int64_t get_cache_bytes(Priority pri) const override {
+    return bytes;
+  }
+  int64_t get_cache_bytes() const override {
+    return bytes;
+  }
+  void set_cache_bytes(Priority pri, int64_t b) override {
+    bytes = b;
+  }
+  void add_cache_bytes(Priority pri, int64_t b) override {
+    bytes += b;
+  }
+  int64_t commit_cache_size(uint64_t total) override {
+    return bytes;
+  }
+  int64_t get_committed_size() const override {
+    return bytes;
+  }
+  double get_cache_ratio() const override {
+    return ratio;
+  }
+  void set_cache_ratio(double r) override {
+    ratio = r;
+  }
+  std::string get_cache_name() const override {
+    return name;
+  }
+  bool get_miss_stats(MissStats *s) const override {
+    if (!keeps_stats) {
+      return false;
+    }
+    *s = stats;
+    return true;
+  }
+};
+
+class MissWeightTest : public ::testing::Test {
+public:
+  Manager mgr{g_ceph_context, 0, 1 << 30, 1 << 30};
+  std::shared_ptr<FakeCache> hot = std::make_shared<FakeCache>("hot", true);
+  std::shared_ptr<FakeCache> cold = std::make_shared<FakeCache>("cold", true);
+  std::shared_ptr<FakeCache> plain = std::make_shared<FakeCache>("plain", false);
+
+  void SetUp() override {
+    mgr.insert("hot", hot);
+    mgr.insert("cold", cold);
+    mgr.insert("plain", plain);
+    // 10 misses of 100ms hit hot's ghost of 100 bytes; cold's is never hit
+    hot->stats.ghost_hits = 10;
+    hot->stats.misses = 10;
+    hot->stats.miss_time = 1.0;
+    hot->stats.ghost_bytes = 100;
+    cold->stats.misses = 10;
+    cold->stats.miss_time = 1.0;
+    cold->stats.ghost_bytes = 100;
+  }
+
+  void TearDown() override {
+    mgr.clear();
+  }
+};
+
+TEST_F(MissWeightTest, Off) {
+  mgr.set_max_miss_weight(1.0);
+  mgr.update_miss_weights();
+  ASSERT_EQ(1.0, mgr.get_miss_weight("hot"));
+  ASSERT_EQ(1.0, mgr.get_miss_weight("cold"));
+  ASSERT_EQ(1.0, mgr.get_miss_weight("plain"));
+}
+
+TEST_F(MissWeightTest, HalfwayToTarget) {
+  mgr.set_max_miss_weight(4.0);
+  mgr.update_miss_weights();
+  // hot has all of the utility, twice the mean, and cold gets the floor
+  ASSERT_DOUBLE_EQ(1.5, mgr.get_miss_weight("hot"));
+  ASSERT_DOUBLE_EQ(0.625, mgr.get_miss_weight("cold"));
+  ASSERT_EQ(1.0, mgr.get_miss_weight("plain"));
+
+  // the same again moves another half of the way
+  hot->stats.ghost_hits += 10;
+  hot->stats.misses += 10;
+  hot->stats.miss_time += 1.0;
+  mgr.update_miss_weights();
+  ASSERT_DOUBLE_EQ(1.75, mgr.get_miss_weight("hot"));
+  ASSERT_DOUBLE_EQ(0.4375, mgr.get_miss_weight("cold"));
+  ASSERT_EQ(1.0, mgr.get_miss_weight("plain"));
+}
+
+TEST_F(MissWeightTest, Clamped) {
+  mgr.set_max_miss_weight(1.5);
+  mgr.update_miss_weights();
+  ASSERT_DOUBLE_EQ(1.25, mgr.get_miss_weight("hot"));
+  ASSERT_DOUBLE_EQ((1.0 + 1.0 / 1.5) / 2, mgr.get_miss_weight("cold"));
+  ASSERT_EQ(1.0, mgr.get_miss_weight("plain"));
+
+  // and turning it off puts them all back
+  mgr.set_max_miss_weight(1.0);
+  mgr.update_miss_weights();
+  ASSERT_EQ(1.0, mgr.get_miss_weight("hot"));
+  ASSERT_EQ(1.0, mgr.get_miss_weight("cold"));
+}
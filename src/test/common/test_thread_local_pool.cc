@@ -0,0 +1,80 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "common/ThreadLocalPool.h"
+#include <set>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+struct pooled : public ThreadLocalPool<pooled, 4> {
+  char payload[100];
+  virtual ~pooled() = default;
+};
+
+struct bigger : public pooled {
+  char more[100];
+};
+
+TEST(ThreadLocalPool, Reuse) {
+  pooled *a = new pooled;
+  delete a;
+  pooled *b = new pooled;
+  ASSERT_EQ(a, b);
+  delete b;
+}
+
+TEST(ThreadLocalPool, Cap) {
+  std::vector<pooled*> v;
+  for (int i = 0; i < 8; ++i) {
+    v.push_back(new pooled);
+  }
+  std::set<pooled*> freed(v.begin(), v.end());
+  for (auto p : v) {
+    delete p;
+  }
+  // only 4 are kept; they come back first, then fresh allocations
+  unsigned reused = 0;
+  v.clear();
+  for (int i = 0; i < 8; ++i) {
+    v.push_back(new pooled);
+    if (i < 4) {
+      ASSERT_TRUE(freed.count(v.back()));
+    }
+    reused += freed.count(v.back());
+  }
+  ASSERT_GE(reused, 4u);
+  for (auto p : v) {
+    delete p;
+  }
+}
+
+TEST(ThreadLocalPool, Derived) {
+  // a derived class has a different size and must not be cached
+  pooled *a = new bigger;
+  delete a;
+  pooled *b = new pooled;
+  delete b;
+  pooled *c = new bigger;
+  delete c;
+}
+
+TEST(ThreadLocalPool, OtherThread) {
+  pooled *a = new pooled;
+  std::thread t([a] {
+    delete a;
+    pooled *b = new pooled;
+    ASSERT_EQ(a, b);
+    delete b;
+  });
+  t.join();
+}
@@ -3,7 +3,15 @@
 #include <boost/program_options/variables_map.hpp>
 #include <boost/program_options/parsers.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+
 #include "auth/Auth.h"
+#include "common/ceph_time.h"
 #include "global/global_init.h"
 #include "msg/Dispatcher.h"
 #include "msg/Messenger.h"
@@ -16,11 +24,31 @@ namespace {
 
 constexpr int CEPH_OSD_PROTOCOL = 10;
 
+MOSDOp* new_osd_op(const bufferlist& msg_data)
+{
+  const static pg_t pgid;
+  const static object_locator_t oloc;
+  const static hobject_t hobj(object_t(), oloc.key, CEPH_NOSNAP, pgid.ps(),
+                              pgid.pool(), oloc.nspace);
+  static spg_t spgid(pgid);
+  MOSDOp *m = new MOSDOp(0, 0, hobj, spgid, 0, 0, 0);
+  bufferlist data(msg_data);
+  m->write(0, data.length(), data);
+  return m;
+}
+
+// the stack is picked by ms_type, e.g. "--ms_type async+rdma"
+std::string get_msgr_type(CephContext* cct)
+{
+  return cct->_conf.get_val<std::string>("ms_type");
+}
+
 struct Server {
   Server(CephContext* cct, unsigned msg_len)
     : dummy_auth(cct), dispatcher(cct, msg_len)
   {
-    msgr.reset(Messenger::create(cct, "async", entity_name_t::OSD(0), "server", 0, 0));
+    msgr.reset(Messenger::create(cct, get_msgr_type(cct),
+                                 entity_name_t::OSD(0), "server", 0, 0));
     dummy_auth.auth_registry.refresh_config();
     msgr->set_cluster_protocol(CEPH_OSD_PROTOCOL);
     msgr->set_default_policy(Messenger::Policy::stateless_server(0));
@@ -47,15 +75,77 @@ struct Server {
     }
     void ms_fast_dispatch(Message* m) override {
       ceph_assert(m->get_type() == CEPH_MSG_OSD_OP);
-      const static pg_t pgid;
-      const static object_locator_t oloc;
-      const static hobject_t hobj(object_t(), oloc.key, CEPH_NOSNAP, pgid.ps(),
-                                  pgid.pool(), oloc.nspace);
-      static spg_t spgid(pgid);
-      MOSDOp *rep = new MOSDOp(0, 0, hobj, spgid, 0, 0, 0);
-      bufferlist data(msg_data);
-      rep->write(0, msg_len, data);
-      m->get_connection()->send_message(rep);
+      m->get_connection()->send_message(new_osd_op(msg_data));
+      m->put();
+    }
+    bool ms_dispatch(Message*) override {
+      ceph_abort();
+    }
+    bool ms_handle_reset(Connection*) override {
+      return true;
+    }
+    void ms_handle_remote_reset(Connection*) override {
+    }
+    bool ms_handle_refused(Connection*) override {
+      return true;
+    }
+  } dispatcher;
+};
+
+struct Client {
+  // a connection to the server, and the MOSDOps in flight over it. the
+  // server replies in the order it receives them, so the oldest one in
+  // flight is the one a reply is for.
+  struct Session {
+    ConnectionRef conn;
+    std::mutex mutex;
+    std::condition_variable on_reply;
+    std::deque<ceph::mono_time> inflight;
+    std::vector<ceph::timespan> latencies;
+  };
+
+  Client(CephContext* cct, unsigned msg_len, unsigned depth)
+    : dummy_auth(cct), dispatcher(cct), msgr_type(get_msgr_type(cct)),
+      depth(depth)
+  {
+    msgr.reset(Messenger::create(cct, msgr_type,
+                                 entity_name_t::CLIENT(-1), "client",
+                                 getpid(), 0));
+    dummy_auth.auth_registry.refresh_config();
+    msgr->set_cluster_protocol(CEPH_OSD_PROTOCOL);
+    msgr->set_default_policy(Messenger::Policy::lossy_client(0));
+    msgr->set_auth_client(&dummy_auth);
+    msgr->set_auth_server(&dummy_auth);
+    msgr->set_require_authorizer(false);
+    msg_data.append_zero(msg_len);
+  }
+  DummyAuthClientServer dummy_auth;
+  unique_ptr<Messenger> msgr;
+  struct ClientDispatcher : Dispatcher {
+    // filled before any MOSDOp is sent, read-only afterwards
+    std::map<Connection*, Session*> sessions;
+
+    ClientDispatcher(CephContext* cct)
+      : Dispatcher(cct)
+    {}
+    bool ms_can_fast_dispatch_any() const override {
+      return true;
+    }
+    bool ms_can_fast_dispatch(const Message* m) const override {
+      return m->get_type() == CEPH_MSG_OSD_OP;
+    }
+    void ms_fast_dispatch(Message* m) override {
+      const auto now = ceph::mono_clock::now();
+      auto found = sessions.find(m->get_connection().get());
+      ceph_assert(found != sessions.end());
+      auto session = found->second;
+      {
+        std::lock_guard lock{session->mutex};
+        ceph_assert(!session->inflight.empty());
+        session->latencies.push_back(now - session->inflight.front());
+        session->inflight.pop_front();
+      }
+      session->on_reply.notify_one();
       m->put();
     }
     bool ms_dispatch(Message*) override {
@@ -70,18 +160,132 @@ struct Server {
       return true;
     }
   } dispatcher;
+  const std::string msgr_type;
+  const unsigned depth;
+  bufferlist msg_data;
+  std::vector<std::unique_ptr<Session>> sessions;
+
+  void connect(const entity_addr_t& addr, unsigned conns) {
+    for (unsigned i = 0; i < conns; i++) {
+      auto session = std::make_unique<Session>();
+      session->conn = msgr->connect_to(CEPH_ENTITY_TYPE_OSD,
+                                       entity_addrvec_t{addr});
+      dispatcher.sessions[session->conn.get()] = session.get();
+      sessions.push_back(std::move(session));
+    }
+  }
+
+  // keep up to depth MOSDOps in flight until rounds of them are replied
+  void send_messages(Session& session, unsigned rounds) {
+    for (unsigned i = 0; i < rounds; i++) {
+      {
+        std::unique_lock lock{session.mutex};
+        session.on_reply.wait(lock, [&] {
+          return session.inflight.size() < depth;
+        });
+        session.inflight.push_back(ceph::mono_clock::now());
+      }
+      session.conn->send_message(new_osd_op(msg_data));
+    }
+    std::unique_lock lock{session.mutex};
+    session.on_reply.wait(lock, [&] {
+      return session.inflight.empty();
+    });
+  }
+
+  void run(unsigned rounds) {
+    // get the connections through their handshakes first
+    for (auto& session : sessions) {
+      send_messages(*session, 1);
+      session->latencies.clear();
+    }
+    std::vector<std::thread> threads;
+    const auto start = ceph::mono_clock::now();
+    for (auto& session : sessions) {
+      threads.emplace_back([this, &session, rounds] {
+        send_messages(*session, rounds / sessions.size());
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    const std::chrono::duration<double> elapsed =
+      ceph::mono_clock::now() - start;
+    report(elapsed.count());
+  }
+
+  void report(double elapsed) const {
+    std::vector<ceph::timespan> latencies;
+    for (auto& session : sessions) {
+      latencies.insert(latencies.end(),
+                       session->latencies.begin(), session->latencies.end());
+    }
+    if (latencies.empty()) {
+      return;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto usec = [](ceph::timespan t) {
+      return std::chrono::duration<double, std::micro>(t).count();
+    };
+    auto percentile = [&](double p) {
+      auto i = std::min<size_t>(latencies.size() * p, latencies.size() - 1);
+      return usec(latencies[i]);
+    };
+    const double ops = latencies.size();
+    std::cout << "\nSummary:"
+              << "\n  ms_type: " << msgr_type
+              << "\n  connections: " << sessions.size()
+              << "\n  depth: " << depth
+              << "\n  block size: " << msg_data.length()
+              << "\n  MOSDOps: " << latencies.size()
+              << "\n  total time: " << elapsed << "s"
+              << "\n  ops/s: " << ops / elapsed
+              << "\n  MB/s: " << ops * msg_data.length() / elapsed / (1 << 20)
+              << "\n  latency (us): p50=" << percentile(0.5)
+              << " p95=" << percentile(0.95)
+              << " p99=" << percentile(0.99)
+              << " p99.9=" << percentile(0.999)
+              << " max=" << usec(latencies.back())
+              << std::endl;
+  }
 };
 
 }
 
-static void run(CephContext* cct, entity_addr_t addr, unsigned bs)
+enum class perf_mode_t {
+  both,
+  client,
+  server
+};
+
+static void run(CephContext* cct, perf_mode_t mode, entity_addr_t addr,
+                unsigned sbs, unsigned cbs, unsigned conns, unsigned depth,
+                unsigned rounds)
 {
-  std::cout << "async server listening at " << addr << std::endl;
-  Server server{cct, bs};
-  server.msgr->bind(addr);
-  server.msgr->add_dispatcher_head(&server.dispatcher);
-  server.msgr->start();
-  server.msgr->wait();
+  std::unique_ptr<Server> server;
+  if (mode != perf_mode_t::client) {
+    std::cout << "async server listening at " << addr << std::endl;
+    server = std::make_unique<Server>(cct, sbs);
+    server->msgr->bind(addr);
+    server->msgr->add_dispatcher_head(&server->dispatcher);
+    server->msgr->start();
+  }
+  if (mode != perf_mode_t::server) {
+    std::cout << "async client sending to " << addr << std::endl;
+    Client client{cct, cbs, depth};
+    client.msgr->add_dispatcher_head(&client.dispatcher);
+    client.msgr->start();
+    client.connect(addr, conns);
+    client.run(rounds);
+    client.msgr->shutdown();
+    client.msgr->wait();
+    if (server) {
+      server->msgr->shutdown();
+    }
+  }
+  if (server) {
+    server->msgr->wait();
+  }
 }
 
 int main(int argc, char** argv)
@@ -90,10 +294,20 @@ int main(int argc, char** argv)
   po::options_description desc{"Allowed options"};
   desc.add_options()
     ("help,h", "show help message")
+    ("mode", po::value<unsigned>()->default_value(2),
+     "0: both, 1:client, 2:server")
     ("addr", po::value<std::string>()->default_value("v1:0.0.0.0:9010"),
-     "server address")
+     "server address, the prefix picks the protocol (v1 | v2)")
     ("bs", po::value<unsigned>()->default_value(0),
-     "server block size");
+     "server block size")
+    ("cbs", po::value<unsigned>()->default_value(4096),
+     "client block size")
+    ("conns", po::value<unsigned>()->default_value(1),
+     "number of client connections, each sent from its own thread")
+    ("depth", po::value<unsigned>()->default_value(512),
+     "client io depth per connection")
+    ("rounds", po::value<unsigned>()->default_value(65536),
+     "number of client messages to send");
   po::variables_map vm;
   std::vector<std::string> unrecognized_options;
   try {
@@ -116,7 +330,16 @@ int main(int argc, char** argv)
   auto addr = vm["addr"].as<std::string>();
   entity_addr_t target_addr;
   target_addr.parse(addr.c_str(), nullptr);
+  auto mode = vm["mode"].as<unsigned>();
+  if (mode > 2) {
+    std::cerr << "error: unknown mode " << mode << std::endl;
+    return 1;
+  }
   auto bs = vm["bs"].as<unsigned>();
+  auto cbs = vm["cbs"].as<unsigned>();
+  auto conns = std::max(vm["conns"].as<unsigned>(), 1u);
+  auto depth = std::max(vm["depth"].as<unsigned>(), 1u);
+  auto rounds = vm["rounds"].as<unsigned>();
 
   std::vector<const char*> args(argv, argv + argc);
   auto cct = global_init(nullptr, args,
@@ -124,5 +347,6 @@ int main(int argc, char** argv)
                          CODE_ENVIRONMENT_UTILITY,
                          CINIT_FLAG_NO_MON_CONFIG);
   common_init_finish(cct.get());
-  run(cct.get(), target_addr, bs);
+  run(cct.get(), static_cast<perf_mode_t>(mode), target_addr,
+      bs, cbs, conns, depth, rounds);
 }
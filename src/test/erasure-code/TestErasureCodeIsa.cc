@@ -22,6 +22,7 @@
 #include "include/stringify.h"
 #include "erasure-code/isa/ErasureCodeIsa.h"
 #include "erasure-code/isa/xor_op.h"
+#include "arch/intel.h"
 #include "global/global_context.h"
 #include "common/config.h"
 #include "gtest/gtest.h"
@@ -874,6 +875,44 @@ TEST_F(IsaErasureCodeTest, isa_xor_codec)
   EXPECT_EQ(5, cnt_cf);
 }
 
+TEST_F(IsaErasureCodeTest, region_xor_kernels)
+{
+  const int src_size = 5;
+  const unsigned size = 4096 + 64;
+  unsigned char *src[src_size];
+  vector<bufferptr> bufs;
+  for (int i = 0; i < src_size; i++) {
+    bufs.push_back(buffer::create_page_aligned(size));
+    for (unsigned j = 0; j < size; j++)
+      bufs.back()[j] = j * (i + 3) + i;
+    src[i] = (unsigned char*) bufs.back().c_str();
+  }
+  bufferptr expected(buffer::create_page_aligned(size));
+  memcpy(expected.c_str(), src[0], size);
+  for (int i = 1; i < src_size; i++)
+    byte_xor(src[i], (unsigned char*) expected.c_str(), src[i] + size);
+
+  bufferptr parity(buffer::create_page_aligned(size));
+  region_xor(src, (unsigned char*) parity.c_str(), src_size, size);
+  EXPECT_EQ(0, memcmp(expected.c_str(), parity.c_str(), size))
+    << region_xor_kernel();
+  EXPECT_NE(nullptr, region_xor_kernel());
+
+#ifdef __x86_64__
+  // whichever of them the cpu has, they all agree
+  if (ceph_arch_intel_avx2) {
+    parity.zero();
+    region_avx2_xor((char**) src, parity.c_str(), src_size, size);
+    EXPECT_EQ(0, memcmp(expected.c_str(), parity.c_str(), size));
+  }
+  if (ceph_arch_intel_avx512) {
+    parity.zero();
+    region_avx512_xor((char**) src, parity.c_str(), src_size, size);
+    EXPECT_EQ(0, memcmp(expected.c_str(), parity.c_str(), size));
+  }
+#endif
+}
+
 TEST_F(IsaErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
@@ -129,6 +129,60 @@ TYPED_TEST(ErasureCodeTest, encode_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, encode_decode_stripes)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "3";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+  EXPECT_TRUE(jerasure.supports_concatenated_stripes());
+
+  const unsigned stripes = 4;
+  unsigned stripe_width = LARGE_ENOUGH;
+  unsigned chunk_size = jerasure.get_chunk_size(stripe_width);
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < jerasure.get_chunk_count(); i++)
+    want_to_encode.insert(i);
+
+  bufferptr ptr(buffer::create_page_aligned(stripe_width * stripes));
+  for (unsigned i = 0; i < ptr.length(); i++)
+    ptr[i] = i * 13 + i / 251;
+  bufferlist in;
+  in.push_back(ptr);
+
+  // the same as encoding the stripes one by one
+  map<int, bufferlist> expected;
+  for (unsigned s = 0; s < stripes; s++) {
+    bufferlist stripe;
+    stripe.substr_of(in, s * stripe_width, stripe_width);
+    map<int, bufferlist> encoded;
+    EXPECT_EQ(0, jerasure.encode(want_to_encode, stripe, &encoded));
+    for (auto& i : encoded)
+      expected[i.first].claim_append(i.second);
+  }
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, jerasure.encode_stripes(want_to_encode, stripe_width, in,
+				       &encoded));
+  EXPECT_EQ(expected.size(), encoded.size());
+  for (auto& i : expected) {
+    ASSERT_EQ(stripes * chunk_size, encoded[i.first].length());
+    EXPECT_TRUE(i.second.contents_equal(encoded[i.first]));
+  }
+
+  // lose two data chunks and get them back
+  map<int, bufferlist> chunks = encoded;
+  chunks.erase(0);
+  chunks.erase(2);
+  set<int> want_to_read = {0, 2};
+  map<int, bufferlist> decoded;
+  EXPECT_EQ(0, jerasure.decode_stripes(want_to_read, chunks, &decoded,
+				       chunk_size));
+  for (auto i : want_to_read)
+    EXPECT_TRUE(encoded[i].contents_equal(decoded[i]));
+}
+
 TYPED_TEST(ErasureCodeTest, minimum_to_decode)
 {
   TypeParam jerasure;
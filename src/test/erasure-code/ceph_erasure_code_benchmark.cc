@@ -31,6 +31,7 @@
 #include "common/config.h"
 #include "common/Clock.h"
 #include "include/utime.h"
+#include "arch/intel.h"
 #include "erasure-code/ErasureCodePlugin.h"
 #include "erasure-code/ErasureCode.h"
 #include "ceph_erasure_code_benchmark.h"
@@ -138,10 +139,26 @@ int ErasureCodeBench::setup(int argc, char** argv) {
   return 0;
 }
 
+// the widest kernels ISA-L and the isa plugin's region xor dispatch to
+static const char *simd_kernel()
+{
+  if (ceph_arch_intel_avx512)
+    return "avx512";
+  if (ceph_arch_intel_avx2)
+    return "avx2";
+  if (ceph_arch_intel_sse2)
+    return "sse2";
+  return "generic";
+}
+
 int ErasureCodeBench::run() {
   ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
   instance.disable_dlclose = true;
 
+  if (verbose)
+    cerr << "kernel " << simd_kernel()
+	 << (ceph_arch_intel_gfni ? " (gfni available)" : "") << endl;
+
   if (workload == "encode")
     return encode();
   else
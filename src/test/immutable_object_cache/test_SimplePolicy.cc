@@ -3,6 +3,7 @@
 
 #include <sstream>
 #include <list>
+#include <unistd.h>
 #include <gtest/gtest.h>
 
 #include "include/Context.h"
@@ -233,3 +234,54 @@ TEST_F(TestSimplePolicy, test_evict_list_10) {
     m_promoted_lru.erase(m_promoted_lru.begin());
   }
 }
+
+TEST_F(TestSimplePolicy, test_evict_list_by_size) {
+  SimplePolicy policy(g_ceph_context, 100, 128, 0.1);
+  for (uint64_t i = 0; i < 10; i++) {
+    std::string file_name = generate_file_name(i);
+    ASSERT_EQ(OBJ_CACHE_NONE, policy.lookup_object(file_name));
+    policy.update_status(file_name, OBJ_CACHE_PROMOTED, i < 8 ? 5 : 30);
+  }
+  // 100 used, evicting the 2 oldest brings it back to 90
+  std::list<std::string> evict_entry_list;
+  policy.get_evict_list(&evict_entry_list);
+  ASSERT_EQ(2u, evict_entry_list.size());
+  for (auto& file_name : evict_entry_list) {
+    policy.evict_entry(file_name);
+  }
+  ASSERT_EQ(10u, policy.get_free_size());
+
+  // nothing to evict under the watermark
+  policy.update_status(generate_file_name(9), OBJ_CACHE_NONE);
+  ASSERT_EQ(40u, policy.get_free_size());
+  evict_entry_list.clear();
+  policy.get_evict_list(&evict_entry_list);
+  ASSERT_TRUE(evict_entry_list.empty());
+}
+
+TEST_F(TestSimplePolicy, test_promote_after_hits) {
+  SimplePolicy policy(g_ceph_context, m_cache_size, 128, 0.1, 2, 0);
+  ASSERT_EQ(OBJ_CACHE_SKIP, policy.lookup_object("scanned_file_name"));
+  ASSERT_EQ(OBJ_CACHE_NONE, policy.get_status("scanned_file_name"));
+  ASSERT_EQ(0u, policy.get_promoting_entry_num());
+
+  // promoted on the second access
+  ASSERT_EQ(OBJ_CACHE_NONE, policy.lookup_object("scanned_file_name"));
+  ASSERT_EQ(OBJ_CACHE_SKIP, policy.get_status("scanned_file_name"));
+  ASSERT_EQ(1u, policy.get_promoting_entry_num());
+
+  // and counted from scratch once evicted
+  policy.update_status("scanned_file_name", OBJ_CACHE_PROMOTED, 1);
+  policy.evict_entry("scanned_file_name");
+  ASSERT_EQ(OBJ_CACHE_SKIP, policy.lookup_object("scanned_file_name"));
+  ASSERT_EQ(OBJ_CACHE_NONE, policy.lookup_object("scanned_file_name"));
+}
+
+TEST_F(TestSimplePolicy, test_promote_window) {
+  SimplePolicy policy(g_ceph_context, m_cache_size, 128, 0.1, 2, 0.1);
+  ASSERT_EQ(OBJ_CACHE_SKIP, policy.lookup_object("slow_file_name"));
+  usleep(200000);
+  // the first access is out of the window
+  ASSERT_EQ(OBJ_CACHE_SKIP, policy.lookup_object("slow_file_name"));
+  ASSERT_EQ(OBJ_CACHE_NONE, policy.lookup_object("slow_file_name"));
+}
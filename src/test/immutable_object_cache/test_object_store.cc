@@ -2,11 +2,13 @@
 // vim: ts=8 sw=2 smarttab
 
 #include <iostream>
+#include <sstream>
 #include <unistd.h>
 
 #include <experimental/filesystem>
 
 #include "gtest/gtest.h"
+#include "common/Formatter.h"
 #include "include/Context.h"
 #include "include/rados/librados.hpp"
 #include "include/rbd/librbd.hpp"
@@ -93,3 +95,39 @@ TEST_F(TestObjectStore, test_1) {
 
   shutdown_object_cache_store();
 }
+
+TEST_F(TestObjectStore, close_reader) {
+  create_object_cache_store(1000);
+  efs::remove_all(test_cache_path);
+  init_object_cache_store(m_temp_pool_name, m_temp_volume_name, 1000, true);
+
+  auto has_perf_counters = [this](const std::string& image) {
+    JSONFormatter f;
+    m_ceph_context->get_perfcounters_collection()->dump_formatted(&f, false);
+    std::stringstream ss;
+    f.flush(ss);
+    return ss.str().find("immutable_object_cache-1-" + m_temp_pool_name +
+                         "-" + image) != std::string::npos;
+  };
+
+  // two readers of image a, one of image b
+  int reader1, reader2;
+  std::string cache_path;
+  m_object_cache_store->lookup_object(m_temp_pool_name, 1, 2, "a.0",
+                                      cache_path, &reader1);
+  m_object_cache_store->lookup_object(m_temp_pool_name, 1, 2, "a.1",
+                                      cache_path, &reader2);
+  m_object_cache_store->lookup_object(m_temp_pool_name, 1, 2, "b.0",
+                                      cache_path, &reader2);
+  ASSERT_TRUE(has_perf_counters("a"));
+  ASSERT_TRUE(has_perf_counters("b"));
+
+  m_object_cache_store->close_reader(&reader2);
+  ASSERT_TRUE(has_perf_counters("a"));
+  ASSERT_FALSE(has_perf_counters("b"));
+
+  m_object_cache_store->close_reader(&reader1);
+  ASSERT_FALSE(has_perf_counters("a"));
+
+  shutdown_object_cache_store();
+}
@@ -2,6 +2,7 @@
 // vim: ts=8 sw=2 smarttab
 #include <errno.h>
 #include <map>
+#include <set>
 #include <sstream>
 #include <string>
 #include <regex>
@@ -812,6 +813,133 @@ TEST_F(LibRadosMiscPP, CmpExtPP) {
   ASSERT_EQ(-MAX_ERRNO - 5, ioctx.cmpext("cmpextpp", 0, bad_cmp_bl));
 }
 
+TEST_F(LibRadosMiscPP, PGOmapReadPP) {
+  // a shared locator puts the objects in the same PG
+  ioctx.locator_set_key("pgomapread");
+  for (int i = 0; i < 3; ++i) {
+    std::map<std::string, bufferlist> vals;
+    for (int j = 0; j <= i; ++j) {
+      vals["key" + stringify(j)].append("val" + stringify(j));
+    }
+    ObjectWriteOperation o;
+    o.omap_set(vals);
+    if (i == 1) {
+      bufferlist header;
+      header.append("header");
+      o.omap_set_header(header);
+    }
+    ASSERT_EQ(0, ioctx.operate("obj" + stringify(i), &o));
+  }
+  ioctx.locator_set_key("");
+
+  std::vector<omap_read_t> reads(4);
+  for (int i = 0; i < 4; ++i) {
+    reads[i].oid = "obj" + stringify(i);
+    reads[i].locator = "pgomapread";
+    reads[i].want_header = true;
+    reads[i].max_return = 2;
+  }
+  reads[2].start_after = "key0";
+
+  std::vector<omap_read_result_t> results;
+  AioCompletion *c = cluster.aio_create_completion();
+  ASSERT_EQ(0, ioctx.aio_pg_omap_read(c, reads, &results));
+  ASSERT_EQ(0, c->wait_for_complete());
+  ASSERT_EQ(0, c->get_return_value());
+  c->release();
+
+  ASSERT_EQ(4U, results.size());
+  ASSERT_EQ(0, results[0].rval);
+  ASSERT_EQ(1U, results[0].vals.size());
+  ASSERT_EQ(0U, results[0].header.length());
+  ASSERT_FALSE(results[0].more);
+
+  ASSERT_EQ(0, results[1].rval);
+  ASSERT_EQ(2U, results[1].vals.size());
+  ASSERT_EQ(std::string("header"), results[1].header.to_str());
+  ASSERT_EQ(std::string("val1"), results[1].vals["key1"].to_str());
+  ASSERT_FALSE(results[1].more);
+
+  ASSERT_EQ(0, results[2].rval);
+  ASSERT_EQ(2U, results[2].vals.size());
+  ASSERT_EQ(1U, results[2].vals.count("key1"));
+  ASSERT_EQ(1U, results[2].vals.count("key2"));
+  ASSERT_FALSE(results[2].more);
+
+  ASSERT_EQ(-ENOENT, results[3].rval);
+}
+
+TEST_F(LibRadosMiscPP, OmapPagesPP) {
+  std::map<std::string, bufferlist> vals;
+  for (int i = 0; i < 100; ++i) {
+    char key[16];
+    snprintf(key, sizeof(key), "key%03d", i);
+    vals[key].append(stringify(i));
+  }
+  ObjectWriteOperation o;
+  o.omap_set(vals);
+  ASSERT_EQ(0, ioctx.operate("omappages", &o));
+
+  // page through it, changing the object past where the listing got, so
+  // that the iterator kept for the next page can't be used
+  std::map<std::string, bufferlist> expected = vals;
+  std::map<std::string, bufferlist> got;
+  std::string start_after;
+  bool more = true;
+  for (int page = 0; more; ++page) {
+    std::map<std::string, bufferlist> page_vals;
+    ASSERT_EQ(0, ioctx.omap_get_vals2("omappages", start_after, 10,
+				      &page_vals, &more));
+    ASSERT_FALSE(page_vals.empty());
+    ASSERT_LE(page_vals.size(), 10U);
+    got.insert(page_vals.begin(), page_vals.end());
+    start_after = page_vals.rbegin()->first;
+
+    if (page == 3) {
+      std::map<std::string, bufferlist> added;
+      added["key095a"].append("new");
+      std::set<std::string> removed = {"key050", "key051"};
+      ObjectWriteOperation w;
+      w.omap_set(added);
+      w.omap_rm_keys(removed);
+      ASSERT_EQ(0, ioctx.operate("omappages", &w));
+      expected.insert(added.begin(), added.end());
+      for (auto& k : removed) {
+	expected.erase(k);
+      }
+    }
+  }
+  ASSERT_EQ(expected, got);
+
+  // the next page with another prefix gets only the keys with that prefix
+  std::map<std::string, bufferlist> page_vals;
+  ASSERT_EQ(0, ioctx.omap_get_vals2("omappages", "", 10, &page_vals, &more));
+  ASSERT_TRUE(more);
+  ASSERT_EQ(std::string("key009"), page_vals.rbegin()->first);
+  page_vals.clear();
+  ASSERT_EQ(0, ioctx.omap_get_vals2("omappages", "key009", "key02", 100,
+				    &page_vals, &more));
+  ASSERT_FALSE(more);
+  ASSERT_EQ(10U, page_vals.size());
+  ASSERT_EQ(std::string("key020"), page_vals.begin()->first);
+
+  // and two listings going on from the same key both get the same page
+  for (int i = 0; i < 2; ++i) {
+    page_vals.clear();
+    ASSERT_EQ(0, ioctx.omap_get_vals2("omappages", "", 10, &page_vals,
+				      &more));
+  }
+  for (int i = 0; i < 2; ++i) {
+    page_vals.clear();
+    ASSERT_EQ(0, ioctx.omap_get_vals2("omappages", "key009", 10, &page_vals,
+				      &more));
+    ASSERT_TRUE(more);
+    ASSERT_EQ(10U, page_vals.size());
+    ASSERT_EQ(std::string("key010"), page_vals.begin()->first);
+    ASSERT_EQ(std::string("key019"), page_vals.rbegin()->first);
+  }
+}
+
 TEST_F(LibRadosMiscPP, Applications) {
   bufferlist inbl, outbl;
   string outs;
@@ -3519,6 +3519,125 @@ TEST_F(LibRadosTwoPoolsPP, ManifestDedupRefRead) {
   cluster.wait_for_latest_osdmap();
 }
 
+TEST_F(LibRadosTwoPoolsPP, ManifestDedupCutChunks) {
+  // skip test if not yet octopus
+  {
+    bufferlist inbl, outbl;
+    ASSERT_EQ(0, cluster.mon_command(
+		"{\"prefix\": \"osd dump\"}",
+		inbl, &outbl, NULL));
+    string s(outbl.c_str(), outbl.length());
+    if (s.find("octopus") == std::string::npos) {
+      cout << "cluster is not yet octopus, skipping test" << std::endl;
+      return;
+    }
+  }
+  bufferlist inbl;
+  ASSERT_EQ(0, cluster.mon_command(
+	    set_pool_str(pool_name, "fingerprint_algorithm", "sha1"),
+	    inbl, NULL, NULL));
+  ASSERT_EQ(0, cluster.mon_command(
+	    set_pool_str(pool_name, "dedup_chunk_algorithm", "fixed"),
+	    inbl, NULL, NULL));
+  ASSERT_EQ(0, cluster.mon_command(
+	    set_pool_str(pool_name, "dedup_cdc_chunk_size", 4),
+	    inbl, NULL, NULL));
+  cluster.wait_for_latest_osdmap();
+
+  // create object
+  {
+    bufferlist bl;
+    bl.append("hi there");
+    ObjectWriteOperation op;
+    op.write_full(bl);
+    ASSERT_EQ(0, ioctx.operate("foo", &op));
+  }
+  {
+    bufferlist bl;
+    bl.append("there");
+    ObjectWriteOperation op;
+    op.write_full(bl);
+    ASSERT_EQ(0, cache_ioctx.operate("bar", &op));
+  }
+
+  // wait for maps to settle
+  cluster.wait_for_latest_osdmap();
+
+  // set-chunk (dedup), one chunk over the whole object
+  {
+    ObjectWriteOperation op;
+    int len = strlen("hi there");
+    op.set_chunk(0, len, cache_ioctx, "bar", 0,
+		CEPH_OSD_OP_FLAG_WITH_REFERENCE);
+    librados::AioCompletion *completion = cluster.aio_create_completion();
+    ASSERT_EQ(0, ioctx.aio_operate("foo", completion, &op));
+    completion->wait_for_safe();
+    ASSERT_EQ(0, completion->get_return_value());
+    completion->release();
+  }
+  // make all chunks dirty --> flush
+  {
+    bufferlist bl;
+    bl.append("There hi");
+    ObjectWriteOperation op;
+    op.write_full(bl);
+    ASSERT_EQ(0, ioctx.operate("foo", &op));
+  }
+  {
+    bufferlist bl;
+    bl.append("There hi");
+    ObjectWriteOperation op;
+    op.write_full(bl);
+    ASSERT_EQ(0, ioctx.operate("foo", &op));
+  }
+
+  // the flush cut it into chunks of 4 bytes, each stored by its fingerprint
+  auto fingerprint = [](const char *data) {
+    SHA1 sha1_gen;
+    unsigned char fingerprint[CEPH_CRYPTO_SHA1_DIGESTSIZE + 1];
+    char p_str[CEPH_CRYPTO_SHA1_DIGESTSIZE*2+1] = {0};
+    sha1_gen.Update((const unsigned char *)data, strlen(data));
+    sha1_gen.Final(fingerprint);
+    buf_to_hex(fingerprint, CEPH_CRYPTO_SHA1_DIGESTSIZE, p_str);
+    return string(p_str);
+  };
+  for (auto chunk : {"Ther", "e hi"}) {
+    bufferlist in, out;
+    ASSERT_EQ(0, cache_ioctx.exec(fingerprint(chunk), "cas", "chunk_read",
+				  in, out));
+    cls_chunk_refcount_read_ret read_ret;
+    try {
+      auto iter = out.cbegin();
+      decode(read_ret, iter);
+    } catch (buffer::error& err) {
+      ASSERT_TRUE(0);
+    }
+    ASSERT_EQ(1u, read_ret.refs.size());
+  }
+  {
+    bufferlist in, out;
+    ASSERT_EQ(-ENOENT, cache_ioctx.exec(fingerprint("There hi"), "cas",
+					"chunk_read", in, out));
+  }
+
+  // the object reads back whole
+  {
+    bufferlist bl;
+    ASSERT_EQ(8, ioctx.read("foo", bl, 8, 0));
+    ASSERT_EQ(string("There hi"), bl.to_str());
+  }
+
+  ASSERT_EQ(0, cluster.mon_command(
+	    set_pool_str(pool_name, "dedup_chunk_algorithm", "unset"),
+	    inbl, NULL, NULL));
+  ASSERT_EQ(0, cluster.mon_command(
+	    set_pool_str(pool_name, "dedup_cdc_chunk_size", 0),
+	    inbl, NULL, NULL));
+
+  // wait for maps to settle before next test
+  cluster.wait_for_latest_osdmap();
+}
+
 class LibRadosTwoPoolsECPP : public RadosTestECPP
 {
 public:
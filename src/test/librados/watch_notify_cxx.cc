@@ -194,6 +194,39 @@ TEST_P(LibRadosWatchNotifyPP, WatchNotify2) {
   ioctx.unwatch2(handle);
 }
 
+TEST_P(LibRadosWatchNotifyPP, WatchNotify2NoAck) {
+  notify_oid = "foo";
+  notify_ioctx = &ioctx;
+  notify_sleep = 0;
+  notify_cookies.clear();
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  bufferlist bl1;
+  bl1.append(buf, sizeof(buf));
+  ASSERT_EQ(0, ioctx.write(notify_oid, bl1, sizeof(buf), 0));
+  uint64_t handle;
+  WatchNotifyTestCtx2 ctx(this);
+  ASSERT_EQ(0, ioctx.watch2(notify_oid, &handle, &ctx));
+  ASSERT_GT(ioctx.watch_check(handle), 0);
+  bufferlist bl2, bl_reply;
+  ASSERT_EQ(0, ioctx.notify_no_ack(notify_oid, bl2, &bl_reply));
+  auto p = bl_reply.cbegin();
+  std::map<std::pair<uint64_t,uint64_t>,bufferlist> reply_map;
+  std::set<std::pair<uint64_t,uint64_t> > missed_map;
+  decode(reply_map, p);
+  decode(missed_map, p);
+  ASSERT_EQ(0u, reply_map.size());
+  ASSERT_EQ(0u, missed_map.size());
+  // the watcher still gets it
+  for (int i = 0; i < 300 && notify_cookies.empty(); i++) {
+    usleep(100000);
+  }
+  ASSERT_EQ(1u, notify_cookies.count(handle));
+  ASSERT_GT(ioctx.watch_check(handle), 0);
+  ioctx.unwatch2(handle);
+  cluster.watch_flush();
+}
+
 TEST_P(LibRadosWatchNotifyPP, AioWatchNotify2) {
   notify_oid = "foo";
   notify_ioctx = &ioctx;
@@ -4,6 +4,7 @@
 #include "include/radosstriper/libradosstriper.hpp"
 #include "test/librados/test.h"
 #include "test/libradosstriper/TestCase.h"
+#include "libradosstriper/RadosStriperImpl.h"
 
 #include <fcntl.h>
 #include <errno.h>
@@ -404,3 +405,42 @@ TEST_F(StriperTestPP, XattrListPP) {
     }
   }
 }
+
+TEST_F(StriperTestPP, WriteLockLeasePP) {
+  ASSERT_EQ(0, cluster.conf_set("rados_striper_write_lock_lease", "60"));
+  ASSERT_EQ(0, cluster.conf_set("rados_striper_lockless_reads", "true"));
+  // every write completion holds a reference on the striper
+  rados_striper_t s;
+  libradosstriper::RadosStriper::to_rados_striper_t(striper, &s);
+  auto impl = (libradosstriper::RadosStriperImpl *)s;
+  int refs = impl->m_refCnt;
+  char buf[128];
+  memset(buf, 0xcc, sizeof(buf));
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+  ASSERT_EQ(0, striper.write("WriteLockLeasePP", bl, sizeof(buf), 0));
+  ASSERT_EQ(0, striper.write("WriteLockLeasePP", bl, sizeof(buf), sizeof(buf)));
+  // the completions of writes keeping the lease were all released
+  ASSERT_EQ(refs, impl->m_refCnt);
+  rados_striper_destroy(s);
+  // both writes went through the same lock, which is still held
+  int exclusive;
+  std::string tag;
+  std::list<librados::locker_t> lockers;
+  ASSERT_EQ(1, ioctx.list_lockers("WriteLockLeasePP.0000000000000000",
+				  "striper.lock", &exclusive, &tag, &lockers));
+  ASSERT_EQ(0, exclusive);
+  bufferlist bl2;
+  ASSERT_EQ((int)(2 * sizeof(buf)),
+	    striper.read("WriteLockLeasePP", &bl2, 2 * sizeof(buf), 0));
+  ASSERT_EQ(0, memcmp(bl2.c_str(), buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(bl2.c_str() + sizeof(buf), buf, sizeof(buf)));
+  // truncating gives the lease up first
+  ASSERT_EQ(0, striper.trunc("WriteLockLeasePP", sizeof(buf)));
+  uint64_t size;
+  time_t mtime;
+  ASSERT_EQ(0, striper.stat("WriteLockLeasePP", &size, &mtime));
+  ASSERT_EQ(sizeof(buf), size);
+  ASSERT_EQ(0, cluster.conf_set("rados_striper_write_lock_lease", "0"));
+  ASSERT_EQ(0, cluster.conf_set("rados_striper_lockless_reads", "false"));
+}
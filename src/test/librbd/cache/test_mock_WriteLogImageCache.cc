@@ -0,0 +1,368 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "test/librbd/test_mock_fixture.h"
+#include "test/librbd/test_support.h"
+#include "test/librbd/mock/MockImageCtx.h"
+#include "test/librbd/mock/MockExclusiveLock.h"
+#include "include/rbd/librbd.hpp"
+#include "include/stringify.h"
+#include "librbd/cache/ImageWriteback.h"
+#include <unistd.h>
+
+namespace librbd {
+namespace {
+
+struct MockTestImageCtx : public MockImageCtx {
+  MockTestImageCtx(ImageCtx &image_ctx) : MockImageCtx(image_ctx) {
+  }
+};
+
+} // anonymous namespace
+
+namespace cache {
+
+template <>
+struct ImageWriteback<MockTestImageCtx> {
+  typedef std::vector<std::pair<uint64_t,uint64_t> > Extents;
+
+  static ImageWriteback *s_instance;
+
+  ImageWriteback(MockTestImageCtx &image_ctx) {
+    s_instance = this;
+  }
+
+  MOCK_METHOD4(aio_read_mock, void(const Extents &, ceph::bufferlist *, int,
+                                   Context *));
+  void aio_read(Extents &&image_extents, ceph::bufferlist *bl,
+                int fadvise_flags, Context *on_finish) {
+    aio_read_mock(image_extents, bl, fadvise_flags, on_finish);
+  }
+
+  MOCK_METHOD4(aio_write_mock, void(const Extents &, const ceph::bufferlist &,
+                                    int, Context *));
+  void aio_write(Extents &&image_extents, ceph::bufferlist&& bl,
+                 int fadvise_flags, Context *on_finish) {
+    aio_write_mock(image_extents, bl, fadvise_flags, on_finish);
+  }
+
+  MOCK_METHOD4(aio_discard, void(uint64_t, uint64_t, uint32_t, Context *));
+  MOCK_METHOD1(aio_flush, void(Context *));
+
+  MOCK_METHOD5(aio_writesame_mock, void(uint64_t, uint64_t,
+                                        const ceph::bufferlist &, int,
+                                        Context *));
+  void aio_writesame(uint64_t offset, uint64_t length, ceph::bufferlist&& bl,
+                     int fadvise_flags, Context *on_finish) {
+    aio_writesame_mock(offset, length, bl, fadvise_flags, on_finish);
+  }
+
+  MOCK_METHOD6(aio_compare_and_write_mock, void(const Extents &,
+                                                const ceph::bufferlist &,
+                                                const ceph::bufferlist &,
+                                                uint64_t *, int, Context *));
+  void aio_compare_and_write(Extents &&image_extents,
+                             ceph::bufferlist&& cmp_bl, ceph::bufferlist&& bl,
+                             uint64_t *mismatch_offset, int fadvise_flags,
+                             Context *on_finish) {
+    aio_compare_and_write_mock(image_extents, cmp_bl, bl, mismatch_offset,
+                               fadvise_flags, on_finish);
+  }
+};
+
+ImageWriteback<MockTestImageCtx> *ImageWriteback<MockTestImageCtx>::s_instance = nullptr;
+
+} // namespace cache
+} // namespace librbd
+
+#include "librbd/cache/WriteLogImageCache.cc"
+
+namespace librbd {
+namespace cache {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::Return;
+using ::testing::WithArg;
+
+struct TestMockCacheWriteLogImageCache : public TestMockFixture {
+  typedef WriteLogImageCache<librbd::MockTestImageCtx> MockWriteLogImageCache;
+  typedef ImageWriteback<librbd::MockTestImageCtx> MockImageWriteback;
+
+  std::string m_log_path;
+
+  void SetUp() override {
+    TestMockFixture::SetUp();
+    m_log_path = "test_mock_WriteLogImageCache.log." + stringify(getpid());
+    ::unlink(m_log_path.c_str());
+  }
+
+  void TearDown() override {
+    ::unlink(m_log_path.c_str());
+    TestMockFixture::TearDown();
+  }
+
+  void expect_op_work_queue(MockTestImageCtx& mock_image_ctx) {
+    EXPECT_CALL(*mock_image_ctx.op_work_queue, queue(_, _))
+      .WillRepeatedly(Invoke([](Context* ctx, int r) {
+                        ctx->complete(r);
+                      }));
+  }
+
+  void expect_is_lock_owner(MockExclusiveLock &mock_exclusive_lock,
+                            bool owner) {
+    EXPECT_CALL(mock_exclusive_lock, is_lock_owner())
+      .WillRepeatedly(Return(owner));
+  }
+
+  void expect_image_read(MockImageWriteback &mock_image_writeback,
+                         const ImageCache::Extents &image_extents,
+                         const std::string &data) {
+    EXPECT_CALL(mock_image_writeback, aio_read_mock(image_extents, _, _, _))
+      .WillOnce(Invoke([data](const ImageCache::Extents &, bufferlist *bl,
+                              int, Context *ctx) {
+                  bl->append(data);
+                  ctx->complete(data.length());
+                }));
+  }
+
+  void expect_image_flush(MockImageWriteback &mock_image_writeback, int r) {
+    EXPECT_CALL(mock_image_writeback, aio_flush(_))
+      .WillOnce(WithArg<0>(Invoke([r](Context *ctx) {
+                  ctx->complete(r);
+                })));
+  }
+
+  int init(MockWriteLogImageCache &cache) {
+    C_SaferCond ctx;
+    cache.init(&ctx);
+    return ctx.wait();
+  }
+
+  int write(MockWriteLogImageCache &cache, uint64_t off,
+            const std::string &data) {
+    bufferlist bl;
+    bl.append(data);
+    C_SaferCond ctx;
+    cache.aio_write({{off, data.length()}}, std::move(bl), 0, &ctx);
+    return ctx.wait();
+  }
+
+  int read(MockWriteLogImageCache &cache, uint64_t off, uint64_t len,
+           std::string *data) {
+    bufferlist bl;
+    C_SaferCond ctx;
+    cache.aio_read({{off, len}}, &bl, 0, &ctx);
+    int r = ctx.wait();
+    *data = bl.to_str();
+    return r;
+  }
+
+  int flush(MockWriteLogImageCache &cache) {
+    C_SaferCond ctx;
+    cache.flush(&ctx);
+    return ctx.wait();
+  }
+
+  int shut_down(MockWriteLogImageCache &cache) {
+    C_SaferCond ctx;
+    cache.shut_down(&ctx);
+    return ctx.wait();
+  }
+};
+
+TEST_F(TestMockCacheWriteLogImageCache, WriteDestage) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_op_work_queue(mock_image_ctx);
+  expect_is_lock_owner(mock_exclusive_lock, true);
+
+  MockWriteLogImageCache cache(mock_image_ctx, m_log_path, 1 << 20);
+  auto &mock_image_writeback = *MockImageWriteback::s_instance;
+  ASSERT_EQ(0, init(cache));
+
+  bufferlist expected;
+  expected.append(std::string(4096, '1'));
+  EXPECT_CALL(mock_image_writeback,
+              aio_write_mock(ImageCache::Extents{{0, 4096}},
+                             ContentsEqual(expected), _, _))
+    .WillOnce(WithArg<3>(Invoke([](Context *ctx) {
+                ctx->complete(0);
+              })));
+  expect_image_flush(mock_image_writeback, 0);
+
+  ASSERT_EQ(0, write(cache, 0, std::string(4096, '1')));
+  ASSERT_EQ(0, flush(cache));
+  ASSERT_EQ(0, shut_down(cache));
+}
+
+TEST_F(TestMockCacheWriteLogImageCache, ReadNotLockOwner) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_op_work_queue(mock_image_ctx);
+  expect_is_lock_owner(mock_exclusive_lock, false);
+
+  std::string expected = std::string(4096, '1') + std::string(4096, '0');
+  {
+    // nothing is destaged without the lock, so the read comes from the log
+    MockWriteLogImageCache cache(mock_image_ctx, m_log_path, 1 << 20);
+    auto &mock_image_writeback = *MockImageWriteback::s_instance;
+    ASSERT_EQ(0, init(cache));
+    ASSERT_EQ(0, write(cache, 0, std::string(4096, '1')));
+
+    expect_image_read(mock_image_writeback, {{0, 8192}},
+                      std::string(8192, '0'));
+    std::string data;
+    ASSERT_EQ(8192, read(cache, 0, 8192, &data));
+    ASSERT_EQ(expected, data);
+    ASSERT_EQ(0, shut_down(cache));
+  }
+
+  {
+    // and so does a read of the replayed log, if the lock isn't acquired
+    MockWriteLogImageCache cache(mock_image_ctx, m_log_path, 1 << 20);
+    auto &mock_image_writeback = *MockImageWriteback::s_instance;
+    EXPECT_CALL(mock_exclusive_lock, acquire_lock(_))
+      .WillOnce(Invoke([ictx](Context *ctx) {
+                  ictx->op_work_queue->queue(ctx, -EBUSY);
+                }));
+    ASSERT_EQ(0, init(cache));
+
+    expect_image_read(mock_image_writeback, {{0, 8192}},
+                      std::string(8192, '0'));
+    std::string data;
+    ASSERT_EQ(8192, read(cache, 0, 8192, &data));
+    ASSERT_EQ(expected, data);
+    ASSERT_EQ(0, shut_down(cache));
+  }
+}
+
+TEST_F(TestMockCacheWriteLogImageCache, DestageFailureKeepsEntry) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_op_work_queue(mock_image_ctx);
+  expect_is_lock_owner(mock_exclusive_lock, true);
+
+  MockWriteLogImageCache cache(mock_image_ctx, m_log_path, 1 << 20);
+  auto &mock_image_writeback = *MockImageWriteback::s_instance;
+  ASSERT_EQ(0, init(cache));
+
+  bufferlist expected;
+  expected.append(std::string(4096, '1'));
+  C_SaferCond destage_started;
+  Context *destage_ctx = nullptr;
+  EXPECT_CALL(mock_image_writeback,
+              aio_write_mock(ImageCache::Extents{{0, 4096}},
+                             ContentsEqual(expected), _, _))
+    .WillOnce(WithArg<3>(Invoke([&destage_started, &destage_ctx](Context *ctx) {
+                destage_ctx = ctx;
+                destage_started.complete(0);
+              })))
+    .WillOnce(WithArg<3>(Invoke([](Context *ctx) {
+                ctx->complete(0);
+              })));
+
+  ASSERT_EQ(0, write(cache, 0, std::string(4096, '1')));
+
+  // the failed destage fails the flush, but the write stays in the log
+  C_SaferCond flush_ctx;
+  cache.flush(&flush_ctx);
+  ASSERT_EQ(0, destage_started.wait());
+  destage_ctx->complete(-EIO);
+  ASSERT_EQ(-EIO, flush_ctx.wait());
+
+  // and the next flush destages it again
+  expect_image_flush(mock_image_writeback, 0);
+  ASSERT_EQ(0, flush(cache));
+  ASSERT_EQ(0, shut_down(cache));
+}
+
+TEST_F(TestMockCacheWriteLogImageCache, LogLocked) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_op_work_queue(mock_image_ctx);
+  expect_is_lock_owner(mock_exclusive_lock, true);
+
+  MockWriteLogImageCache cache(mock_image_ctx, m_log_path, 1 << 20);
+  ASSERT_EQ(0, init(cache));
+
+  MockWriteLogImageCache other_cache(mock_image_ctx, m_log_path, 1 << 20);
+  ASSERT_EQ(-EBUSY, init(other_cache));
+  ASSERT_EQ(0, shut_down(cache));
+}
+
+TEST_F(TestMockCacheWriteLogImageCache, DirtyElsewhere) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_op_work_queue(mock_image_ctx);
+
+  CacheState state;
+  state.clean = false;
+  state.host = "some-other-host";
+  state.path = m_log_path;
+  state.log_id = 1;
+  bufferlist bl;
+  bl.append(state.to_json());
+  ASSERT_EQ(0, cls_client::metadata_set(&ictx->md_ctx, ictx->header_oid,
+                                        {{IMAGE_CACHE_STATE, bl}}));
+
+  MockWriteLogImageCache cache(mock_image_ctx, m_log_path, 1 << 20);
+  ASSERT_EQ(-EBUSY, init(cache));
+}
+
+TEST_F(TestMockCacheWriteLogImageCache, StaleLogDiscarded) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockExclusiveLock mock_exclusive_lock;
+  mock_image_ctx.exclusive_lock = &mock_exclusive_lock;
+  expect_op_work_queue(mock_image_ctx);
+  expect_is_lock_owner(mock_exclusive_lock, false);
+
+  {
+    MockWriteLogImageCache cache(mock_image_ctx, m_log_path, 1 << 20);
+    ASSERT_EQ(0, init(cache));
+    ASSERT_EQ(0, write(cache, 0, std::string(4096, '1')));
+    ASSERT_EQ(0, shut_down(cache));
+  }
+
+  // without the state naming it, the log isn't replayed
+  ASSERT_EQ(0, cls_client::metadata_remove(&ictx->md_ctx, ictx->header_oid,
+                                           IMAGE_CACHE_STATE));
+  {
+    MockWriteLogImageCache cache(mock_image_ctx, m_log_path, 1 << 20);
+    auto &mock_image_writeback = *MockImageWriteback::s_instance;
+    ASSERT_EQ(0, init(cache));
+
+    expect_image_read(mock_image_writeback, {{0, 4096}},
+                      std::string(4096, '0'));
+    std::string data;
+    ASSERT_EQ(4096, read(cache, 0, 4096, &data));
+    ASSERT_EQ(std::string(4096, '0'), data);
+    ASSERT_EQ(0, shut_down(cache));
+  }
+}
+
+} // namespace cache
+} // namespace librbd
@@ -3,6 +3,7 @@
 
 #include "test/librbd/test_mock_fixture.h"
 #include "include/rbd/librbd.hpp"
+#include "include/stringify.h"
 #include "librbd/ImageCtx.h"
 #include "librbd/ImageState.h"
 #include "librbd/Operations.h"
@@ -353,6 +354,55 @@ TEST_F(TestMockDeepCopyImageCopyRequest, OutOfOrder) {
   ASSERT_EQ(0, ctx.wait());
 }
 
+TEST_F(TestMockDeepCopyImageCopyRequest, ThrottleByBytes) {
+  librados::snap_t snap_id_end;
+  ASSERT_EQ(0, create_snap("copy", &snap_id_end));
+
+  uint64_t object_count = 4;
+
+  librbd::MockTestImageCtx mock_src_image_ctx(*m_src_image_ctx);
+  librbd::MockTestImageCtx mock_dst_image_ctx(*m_dst_image_ctx);
+  MockObjectCopyRequest mock_object_copy_request;
+
+  // room for two objects in flight, whatever the op limit
+  uint64_t object_bytes = m_dst_image_ctx->layout.object_size *
+                          m_snap_map.size();
+  mock_src_image_ctx.config.set_val("rbd_concurrent_management_ops", "10");
+  mock_src_image_ctx.config.set_val("rbd_concurrent_deep_copy_bytes",
+                                    stringify(2 * object_bytes));
+
+  expect_get_image_size(mock_src_image_ctx,
+                        object_count * (1 << m_src_image_ctx->order));
+  expect_get_image_size(mock_src_image_ctx, 0);
+
+  EXPECT_CALL(mock_object_copy_request, send()).Times(object_count);
+
+  librbd::NoOpProgressContext no_op;
+  C_SaferCond ctx;
+  auto request = new MockImageCopyRequest(&mock_src_image_ctx,
+                                          &mock_dst_image_ctx,
+                                          0, snap_id_end, false, boost::none,
+                                          m_snap_seqs, &no_op, &ctx);
+  request->send();
+
+  ASSERT_EQ(m_snap_map, wait_for_snap_map(mock_object_copy_request));
+  Context *copy_ctx0 = nullptr;
+  Context *copy_ctx1 = nullptr;
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 0, &copy_ctx0, 0));
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 1, &copy_ctx1, 0));
+  {
+    Mutex::Locker locker(mock_object_copy_request.lock);
+    ASSERT_EQ(0U, mock_object_copy_request.object_contexts.count(2));
+  }
+
+  copy_ctx0->complete(0);
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 2, nullptr, 0));
+  copy_ctx1->complete(0);
+  ASSERT_TRUE(complete_object_copy(mock_object_copy_request, 3, nullptr, 0));
+
+  ASSERT_EQ(0, ctx.wait());
+}
+
 TEST_F(TestMockDeepCopyImageCopyRequest, SnapshotSubset) {
   librados::snap_t snap_id_start;
   librados::snap_t snap_id_end;
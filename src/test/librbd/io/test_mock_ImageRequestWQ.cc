@@ -301,6 +301,35 @@ TEST_F(TestMockIoImageRequestWQ, AcquireLockError) {
   aio_comp->release();
 }
 
+TEST_F(TestMockIoImageRequestWQ, DirectDispatch) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  mock_image_ctx.non_blocking_aio = true;
+  mock_image_ctx.direct_dispatch_aio = true;
+
+  auto mock_image_request = new MockImageDispatchSpec();
+
+  InSequence seq;
+  MockImageRequestWQ mock_image_request_wq(&mock_image_ctx, "io", 60, nullptr);
+
+  expect_is_refresh_request(mock_image_ctx, false);
+  expect_is_write_op(*mock_image_request, true);
+  expect_start_op(*mock_image_request);
+  EXPECT_CALL(*mock_image_request, send())
+    .WillOnce(Invoke([mock_image_request]() {
+                  mock_image_request->aio_comp->set_request_count(0);
+                }));
+  EXPECT_CALL(mock_image_request_wq, queue(_)).Times(0);
+  auto *aio_comp = new librbd::io::AioCompletion();
+  mock_image_request_wq.aio_write(aio_comp, 0, 0, {}, 0);
+
+  ASSERT_EQ(0, aio_comp->wait_for_complete());
+  ASSERT_EQ(0, aio_comp->get_return_value());
+  aio_comp->release();
+}
+
 TEST_F(TestMockIoImageRequestWQ, AcquireLockBlacklisted) {
   REQUIRE_FEATURE(RBD_FEATURE_EXCLUSIVE_LOCK);
 
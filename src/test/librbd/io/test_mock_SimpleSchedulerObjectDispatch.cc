@@ -265,6 +265,79 @@ TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteDelayed) {
   ASSERT_EQ(0, cond2.wait());
 }
 
+TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteNotMergedNotDelayed) {
+  librbd::ImageCtx *ictx;
+  ASSERT_EQ(0, open_image(m_image_name, &ictx));
+
+  MockTestImageCtx mock_image_ctx(*ictx);
+  MockSimpleSchedulerObjectDispatch
+      mock_simple_scheduler_object_dispatch(&mock_image_ctx);
+
+  expect_get_object_name(mock_image_ctx, 0);
+
+  InSequence seq;
+
+  ceph::bufferlist data;
+  data.append("X");
+  int object_dispatch_flags = 0;
+  io::DispatchResult dispatch_result;
+
+  // delays that never merge anything...
+  for (int i = 0; i < MERGE_STATS_WINDOW_SIZE; ++i) {
+    auto bl = data;
+    C_SaferCond cond1;
+    Context *on_finish1 = &cond1;
+    ASSERT_FALSE(mock_simple_scheduler_object_dispatch.write(
+        ictx->get_object_name(0), 0, 0, std::move(bl), mock_image_ctx.snapc,
+        0, {}, &object_dispatch_flags, nullptr, nullptr, &on_finish1,
+        nullptr));
+
+    Context *timer_task = nullptr;
+    expect_schedule_dispatch_delayed_requests(nullptr, &timer_task);
+
+    bl = data;
+    C_SaferCond cond2;
+    Context *on_finish2 = &cond2;
+    C_SaferCond on_dispatched;
+    ASSERT_TRUE(mock_simple_scheduler_object_dispatch.write(
+        ictx->get_object_name(0), 0, 0, std::move(bl), mock_image_ctx.snapc,
+        0, {}, &object_dispatch_flags, nullptr, &dispatch_result,
+        &on_finish2, &on_dispatched));
+
+    expect_dispatch_delayed_requests(mock_image_ctx, 0);
+    expect_schedule_dispatch_delayed_requests(timer_task, nullptr);
+
+    on_finish1->complete(0);
+    ASSERT_EQ(0, cond1.wait());
+    ASSERT_EQ(0, on_dispatched.wait());
+    on_finish2->complete(0);
+    ASSERT_EQ(0, cond2.wait());
+  }
+
+  // ... stop further writes from being delayed
+  auto bl = data;
+  C_SaferCond cond1;
+  Context *on_finish1 = &cond1;
+  ASSERT_FALSE(mock_simple_scheduler_object_dispatch.write(
+      ictx->get_object_name(0), 0, 0, std::move(bl), mock_image_ctx.snapc, 0,
+      {}, &object_dispatch_flags, nullptr, nullptr, &on_finish1, nullptr));
+  ASSERT_NE(on_finish1, &cond1);
+
+  bl = data;
+  C_SaferCond cond2;
+  Context *on_finish2 = &cond2;
+  ASSERT_FALSE(mock_simple_scheduler_object_dispatch.write(
+      ictx->get_object_name(0), 0, 0, std::move(bl), mock_image_ctx.snapc, 0,
+      {}, &object_dispatch_flags, nullptr, &dispatch_result, &on_finish2,
+      nullptr));
+  ASSERT_NE(on_finish2, &cond2);
+
+  on_finish1->complete(0);
+  ASSERT_EQ(0, cond1.wait());
+  on_finish2->complete(0);
+  ASSERT_EQ(0, cond2.wait());
+}
+
 TEST_F(TestMockIoSimpleSchedulerObjectDispatch, WriteDelayedFlush) {
   librbd::ImageCtx *ictx;
   ASSERT_EQ(0, open_image(m_image_name, &ictx));
@@ -95,6 +95,7 @@ struct MockImageCtx {
       discard_granularity_bytes(image_ctx.discard_granularity_bytes),
       mirroring_replay_delay(image_ctx.mirroring_replay_delay),
       non_blocking_aio(image_ctx.non_blocking_aio),
+      direct_dispatch_aio(image_ctx.direct_dispatch_aio),
       blkin_trace_all(image_ctx.blkin_trace_all),
       enable_alloc_hint(image_ctx.enable_alloc_hint),
       ignore_migrating(image_ctx.ignore_migrating),
@@ -300,6 +301,7 @@ struct MockImageCtx {
   uint32_t discard_granularity_bytes;
   int mirroring_replay_delay;
   bool non_blocking_aio;
+  bool direct_dispatch_aio;
   bool blkin_trace_all;
   bool enable_alloc_hint;
   bool ignore_migrating;
@@ -4252,6 +4252,74 @@ TYPED_TEST(DiffIterateTest, DiffIterateCallbackError)
   ioctx.close();
 }
 
+TYPED_TEST(DiffIterateTest, DiffIterateFastDiff)
+{
+  REQUIRE_FEATURE(RBD_FEATURE_FAST_DIFF);
+
+  librados::IoCtx ioctx;
+  ASSERT_EQ(0, this->_rados.ioctx_create(this->m_pool_name.c_str(), ioctx));
+
+  {
+    librbd::RBD rbd;
+    librbd::Image image;
+    int order = 22;
+    std::string name = this->get_temp_image_name();
+    const uint64_t object_size = 1 << order;
+    uint64_t size = 8 * object_size;
+
+    ASSERT_EQ(0, create_image_pp(rbd, ioctx, name.c_str(), size, &order));
+    ASSERT_EQ(0, rbd.open(ioctx, image, name.c_str(), NULL));
+
+    bufferlist bl;
+    bl.append(std::string(4096, '1'));
+    ASSERT_EQ(4096, image.write(object_size + 4096, bl.length(), bl));
+    ASSERT_EQ(4096, image.write(5 * object_size, bl.length(), bl));
+    ASSERT_EQ(0, image.snap_create("one"));
+    ASSERT_EQ(4096, image.write(object_size, bl.length(), bl));
+    ASSERT_EQ(4096, image.write(3 * object_size + 8192, bl.length(), bl));
+
+    interval_set<uint64_t> written;
+    written.insert(object_size, 4096);
+    written.insert(3 * object_size + 8192, 4096);
+    interval_set<uint64_t> changed_objects;
+    changed_objects.insert(object_size, object_size);
+    changed_objects.insert(3 * object_size, object_size);
+
+    // the objects the object map shows as unchanged don't show up at all
+    interval_set<uint64_t> diff;
+    ASSERT_EQ(0, image.diff_iterate2("one", 0, size, true, this->whole_object,
+                                     iterate_cb, (void *)&diff));
+    cout << " diff was " << diff << std::endl;
+    ASSERT_TRUE(written.subset_of(diff));
+    ASSERT_TRUE(diff.subset_of(changed_objects));
+    if (this->whole_object) {
+      ASSERT_EQ(changed_objects, diff);
+    }
+
+    // and a diff from an unaligned offset starts at that offset
+    vector<diff_extent> extents;
+    uint64_t off = 3 * object_size + 100;
+    ASSERT_EQ(0, image.diff_iterate2("one", off, size - off, true,
+                                     this->whole_object, vector_iterate_cb,
+                                     (void *)&extents));
+    ASSERT_FALSE(extents.empty());
+    if (this->whole_object) {
+      ASSERT_EQ(1u, extents.size());
+      ASSERT_EQ(diff_extent(off, object_size - 100, true, 0), extents[0]);
+    } else {
+      interval_set<uint64_t> got;
+      for (auto& e : extents) {
+        got.insert(e.offset, e.length);
+      }
+      interval_set<uint64_t> bounds;
+      bounds.insert(off, 4 * object_size - off);
+      ASSERT_TRUE(got.subset_of(bounds));
+      ASSERT_TRUE(got.contains(3 * object_size + 8192, 4096));
+    }
+  }
+  ioctx.close();
+}
+
 TYPED_TEST(DiffIterateTest, DiffIterateParentDiscard)
 {
   REQUIRE_FEATURE(RBD_FEATURE_LAYERING);
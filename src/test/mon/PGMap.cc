@@ -156,3 +156,53 @@ TEST(pgmap, dump_object_stat_sum_2)
   ASSERT_EQ(percentify(0), tbl.get(0, col++));
   ASSERT_EQ(stringify(byte_u_t(avail/pool.size)), tbl.get(0, col++));
 }
+
+// the aggregates apply_incremental() keeps up match recomputing them
+TEST(pgmap, apply_incremental)
+{
+  PGMap pg_map;
+  const pg_t a(0, 1), b(1, 1), c(0, 2);
+
+  auto make_stat = [](std::vector<int32_t> acting, snapid_t purged) {
+    pg_stat_t s;
+    s.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+    s.acting = s.up = acting;
+    s.acting_primary = s.up_primary = acting.front();
+    s.purged_snaps.insert(snapid_t(1), purged);
+    return s;
+  };
+
+  PGMap::Incremental inc;
+  inc.version = 1;
+  inc.pg_stat_updates[a] = make_stat({0, 1}, 4);
+  inc.pg_stat_updates[b] = make_stat({1, 2}, 3);
+  inc.pg_stat_updates[c] = make_stat({2, 0}, 5);
+  pg_map.apply_incremental(nullptr, inc);
+  pg_map.calc_purged_snaps();
+  ASSERT_EQ(3u, pg_map.purged_snaps.at(1).size());
+  ASSERT_EQ(5u, pg_map.purged_snaps.at(2).size());
+
+  // same mapping, more purged snaps
+  PGMap::Incremental inc2;
+  inc2.version = 2;
+  inc2.pg_stat_updates[a] = make_stat({0, 1}, 6);
+  // remapped
+  inc2.pg_stat_updates[b] = make_stat({2, 0}, 6);
+  inc2.pg_remove.insert(c);
+  pg_map.apply_incremental(nullptr, inc2);
+  pg_map.calc_purged_snaps();
+
+  PGMap full = pg_map;
+  full.calc_stats();
+  full.calc_purged_snaps();
+  ASSERT_EQ(full.purged_snaps, pg_map.purged_snaps);
+  ASSERT_EQ(6u, pg_map.purged_snaps.at(1).size());
+  ASSERT_EQ(0u, pg_map.purged_snaps.count(2));
+  ASSERT_EQ(full.pg_by_osd, pg_map.pg_by_osd);
+  ASSERT_EQ(full.num_pg_by_state, pg_map.num_pg_by_state);
+  for (int osd = 0; osd < 3; ++osd) {
+    ASSERT_EQ(full.get_num_pg_by_osd(osd), pg_map.get_num_pg_by_osd(osd));
+    ASSERT_EQ(full.get_num_primary_pg_by_osd(osd),
+	      pg_map.get_num_primary_pg_by_osd(osd));
+  }
+}
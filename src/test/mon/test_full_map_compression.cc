@@ -0,0 +1,83 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "mon/FullMapCompression.h"
+#include "osd/OSDMap.h"
+#include "global/global_context.h"
+
+#include "gtest/gtest.h"
+
+static bufferlist encode_osdmap()
+{
+  OSDMap osdmap;
+  uuid_d fsid;
+  osdmap.build_simple(g_ceph_context, 1, fsid, 16);
+  bufferlist bl;
+  osdmap.encode(bl, CEPH_FEATURES_ALL|CEPH_FEATURE_RESERVED);
+  return bl;
+}
+
+TEST(FullMapCompression, plain_map_is_left_alone)
+{
+  // an uncompressed full map never starts with the marker
+  bufferlist bl = encode_osdmap();
+  ASSERT_NE(FULL_MAP_COMPRESSED, (uint8_t)bl[0]);
+  bufferlist orig = bl;
+  ASSERT_EQ(0, decompress_full_map(g_ceph_context, bl));
+  ASSERT_TRUE(bl.contents_equal(orig));
+}
+
+TEST(FullMapCompression, round_trip)
+{
+  bufferlist bl = encode_osdmap();
+  bufferlist orig = bl;
+  ASSERT_EQ(0, compress_full_map(g_ceph_context, "zlib", bl));
+  if (bl.contents_equal(orig)) {
+    // the plugin isn't there, or doesn't make it any smaller
+    return;
+  }
+  ASSERT_EQ(FULL_MAP_COMPRESSED, (uint8_t)bl[0]);
+  ASSERT_LT(bl.length(), orig.length());
+
+  ASSERT_EQ(0, decompress_full_map(g_ceph_context, bl));
+  ASSERT_TRUE(bl.contents_equal(orig));
+  OSDMap osdmap;
+  osdmap.decode(bl);
+  ASSERT_EQ(16, osdmap.get_max_osd());
+}
+
+TEST(FullMapCompression, unknown_compressor)
+{
+  bufferlist bl = encode_osdmap();
+  bufferlist orig = bl;
+  ASSERT_EQ(-ENOENT, compress_full_map(g_ceph_context, "invalid", bl));
+  ASSERT_TRUE(bl.contents_equal(orig));
+}
+
+TEST(FullMapCompression, corrupt)
+{
+  bufferlist orig = encode_osdmap();
+  bufferlist bl = orig;
+  ASSERT_EQ(0, compress_full_map(g_ceph_context, "zlib", bl));
+  if (bl.contents_equal(orig)) {
+    return;
+  }
+  // a truncated one fails rather than decoding garbage
+  bufferlist truncated;
+  truncated.substr_of(bl, 0, bl.length() / 2);
+  ASSERT_EQ(-EIO, decompress_full_map(g_ceph_context, truncated));
+
+  // and so does a header without the data
+  bufferlist header;
+  header.substr_of(bl, 0, 3);
+  ASSERT_EQ(-EIO, decompress_full_map(g_ceph_context, header));
+}
@@ -30,7 +30,10 @@
 #include "common/ceph_argparse.h"
 #include "msg/async/Event.h"
 
+#include <algorithm>
 #include <atomic>
+#include <map>
+#include <random>
 
 // We use epoll, kqueue, evport, select in descending order by performance.
 #if defined(__linux__)
@@ -330,6 +333,74 @@ TEST(EventCenterTest, DispatchTest) {
   worker2.join();
 }
 
+class RecordTimeEvent : public EventCallback {
+  std::map<uint64_t, std::vector<ceph::coarse_mono_clock::time_point>> *fired;
+
+ public:
+  explicit RecordTimeEvent(
+    std::map<uint64_t, std::vector<ceph::coarse_mono_clock::time_point>> *f)
+    : fired(f) {}
+  void do_request(uint64_t id) override {
+    (*fired)[id].push_back(ceph::coarse_mono_clock::now());
+  }
+};
+
+TEST(EventCenterTest, TimeEventRandomized) {
+  using clock_type = ceph::coarse_mono_clock;
+  EventCenter center(g_ceph_context);
+  center.init(100, 0, "posix");
+  center.set_owner();
+  std::map<uint64_t, std::vector<clock_type::time_point>> fired;
+  EventCallbackRef e(new RecordTimeEvent(&fired));
+
+  struct timer_t {
+    clock_type::time_point due;
+    bool cancelled = false;
+  };
+  std::map<uint64_t, timer_t> timers;
+  std::mt19937 rng(time(nullptr));
+  // mostly within the first wheel, some cascading down from the second
+  std::uniform_int_distribution<uint64_t> delay_us(0, 600000);
+  auto end = clock_type::now() + std::chrono::seconds(1);
+  while (clock_type::now() < end) {
+    for (int i = 0; i < 10; i++) {
+      auto us = delay_us(rng);
+      auto due = clock_type::now() + std::chrono::microseconds(us);
+      uint64_t id = center.create_time_event(us, e);
+      ASSERT_NE(0u, id);
+      ASSERT_EQ(0u, timers.count(id));
+      timers[id].due = due;
+    }
+    // cancel some pending ones, and some that already fired
+    for (int i = 0; i < 3; i++) {
+      auto p = timers.begin();
+      std::advance(p, rng() % timers.size());
+      if (!fired.count(p->first))
+	p->second.cancelled = true;
+      center.delete_time_event(p->first);
+    }
+    center.process_events(1000);
+  }
+  // run the ones still pending
+  end = clock_type::now() + std::chrono::seconds(2);
+  while (clock_type::now() < end)
+    center.process_events(10000);
+
+  for (auto& [id, t] : timers) {
+    auto p = fired.find(id);
+    if (t.cancelled) {
+      ASSERT_EQ(fired.end(), p) << "cancelled timer " << id << " fired";
+      continue;
+    }
+    ASSERT_NE(fired.end(), p) << "timer " << id << " never fired";
+    ASSERT_EQ(1u, p->second.size()) << "timer " << id << " fired twice";
+    ASSERT_GE(p->second.front(), t.due) << "timer " << id << " fired early";
+  }
+  ASSERT_EQ(timers.size(), fired.size() +
+	    std::count_if(timers.begin(), timers.end(),
+			  [](auto& t) { return t.second.cancelled; }));
+}
+
 INSTANTIATE_TEST_SUITE_P(
   AsyncMessenger,
   EventDriverTest,
@@ -439,6 +439,85 @@ TEST_P(NetworkWorkerTest, AcceptAndCloseTest) {
   });
 }
 
+TEST_P(NetworkWorkerTest, ZeroCopyCloseTest) {
+  if (strcmp(GetParam(), "posix"))
+    return;
+  entity_addr_t bind_addr;
+  ASSERT_TRUE(bind_addr.parse(get_addr().c_str()));
+  g_ceph_context->_conf.set_val_or_die("ms_tcp_zerocopy_min_size", "4096");
+  g_ceph_context->_conf.apply_changes(nullptr);
+
+  exec_events([bind_addr](Worker *worker) mutable {
+    if (worker->id != 0)
+      return;
+    SocketOptions options;
+    EventCenter *center = &worker->center;
+    entity_addr_t cli_addr;
+    ServerSocket bind_socket;
+    ConnectedSocket cli_socket, srv_socket;
+    ASSERT_EQ(0, worker->listen(bind_addr, 0, options, &bind_socket));
+    ASSERT_EQ(0, worker->connect(bind_addr, options, &cli_socket));
+    {
+      C_poll cb(center);
+      center->create_file_event(bind_socket.fd(), EVENT_READABLE, &cb);
+      ASSERT_TRUE(cb.poll(500));
+      center->delete_file_event(bind_socket.fd(), EVENT_READABLE);
+      ASSERT_EQ(0, bind_socket.accept(&srv_socket, options, &cli_addr, worker));
+    }
+    {
+      C_poll cb(center);
+      center->create_file_event(cli_socket.fd(), EVENT_READABLE, &cb);
+      int r = cli_socket.is_connected();
+      if (r == 0) {
+        ASSERT_TRUE(cb.poll(500));
+        r = cli_socket.is_connected();
+      }
+      ASSERT_EQ(1, r);
+      center->delete_file_event(cli_socket.fd(), EVENT_READABLE);
+    }
+
+    // close right after a zerocopy send: the data must still arrive
+    // intact, and the buffer be let go once the kernel is done with it
+    const unsigned len = 64 << 10;
+    bufferptr bp(buffer::create_page_aligned(len));
+    for (unsigned i = 0; i < len; ++i)
+      bp.c_str()[i] = i * 31;
+    std::string expected(bp.c_str(), len);
+    bufferlist bl;
+    bl.append(bp);
+    ASSERT_EQ((ssize_t)len, cli_socket.send(bl, false));
+    ASSERT_EQ(0u, bl.length());
+    cli_socket.close();
+
+    std::string received;
+    C_poll cb(center);
+    center->create_file_event(srv_socket.fd(), EVENT_READABLE, &cb);
+    char buf[4096];
+    ssize_t r;
+    while ((r = srv_socket.read(buf, sizeof(buf))) != 0) {
+      if (r == -EAGAIN) {
+        ASSERT_TRUE(cb.poll(5000));
+        cb.reset();
+        continue;
+      }
+      ASSERT_LT(0, r);
+      received.append(buf, r);
+    }
+    ASSERT_EQ(expected, received);
+    center->delete_file_event(srv_socket.fd(), EVENT_READABLE);
+    srv_socket.close();
+
+    for (int ms = 0; bp.raw_nref() > 1; ++ms) {
+      ASSERT_LT(ms, 5000);
+      center->process_events(1000);
+    }
+    bind_socket.abort_accept();
+  });
+
+  g_ceph_context->_conf.set_val_or_die("ms_tcp_zerocopy_min_size", "0");
+  g_ceph_context->_conf.apply_changes(nullptr);
+}
+
 TEST_P(NetworkWorkerTest, ComplexTest) {
   entity_addr_t bind_addr;
   std::atomic_bool listen_done(false);
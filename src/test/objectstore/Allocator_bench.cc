@@ -38,6 +38,7 @@ public:
   }
   void doOverwriteTest(uint64_t capacity, uint64_t prefill,
     uint64_t overwrite);
+  void doAgingTest(uint64_t capacity, uint64_t fill, uint64_t churn);
 };
 
 const uint64_t _1m = 1024 * 1024;
@@ -303,6 +304,130 @@ void AllocTest::doOverwriteTest(uint64_t capacity, uint64_t prefill,
   dump_mempools();
 }
 
+// allocation sizes and lifetimes of a mixed RBD/RGW/CephFS workload:
+// mostly small overwrites, some mid-sized writes and whole 4M objects.
+// half of the releases are of the oldest extents, the other half of
+// random ones, so lifetimes range from short to very long.
+void AllocTest::doAgingTest(uint64_t capacity, uint64_t fill, uint64_t churn)
+{
+  uint64_t alloc_unit = 4096;
+  PExtentVector tmp;
+  AllocTracker at(capacity, alloc_unit);
+
+  init_alloc(capacity, alloc_unit);
+  alloc->init_add_free(0, capacity);
+  const size_t mempool_bytes = mempool::bluestore_alloc::allocated_bytes();
+
+  gen_type rng(time(NULL));
+  boost::uniform_int<> kind(0, 9);
+  boost::uniform_int<> small(0, 4);  // 4K-64K
+  boost::uniform_int<> medium(4, 7); // 64K-512K
+  boost::uniform_int<> coin(0, 1);
+  auto want_size = [&]() -> uint32_t {
+    auto k = kind(rng);
+    if (k < 6) {
+      return alloc_unit << small(rng);
+    } else if (k < 9) {
+      return alloc_unit << medium(rng);
+    }
+    return alloc_unit << 10;         // 4M
+  };
+
+  std::vector<uint32_t> latencies;   // of each allocate(), in ns
+  auto allocate = [&](uint32_t want) {
+    tmp.clear();
+    auto t0 = ceph::mono_clock::now();
+    auto r = alloc->allocate(want, alloc_unit, 0, 0, &tmp);
+    latencies.push_back(std::chrono::nanoseconds(
+      ceph::mono_clock::now() - t0).count());
+    if (r < 0 || (uint64_t)r < want) {
+      return false;
+    }
+    for (auto a : tmp) {
+      bool full = !at.push(a.offset, a.length);
+      EXPECT_EQ(full, false);
+    }
+    return true;
+  };
+  auto release = [&](uint64_t want_release) {
+    uint64_t released = 0;
+    bool oldest = coin(rng);
+    do {
+      uint64_t o = 0;
+      uint32_t l = 0;
+      interval_set<uint64_t> release_set;
+      bool found = oldest ? at.pop(&o, &l) :
+	at.pop_random(rng, &o, &l, want_release - released);
+      if (!found) {
+	break;
+      }
+      release_set.insert(o, l);
+      alloc->release(release_set);
+      released += l;
+    } while (released < want_release);
+  };
+
+  utime_t start = ceph_clock_now();
+  for (uint64_t i = 0; i < fill; ) {
+    uint32_t want = want_size();
+    if (!allocate(want)) {
+      break;
+    }
+    i += want;
+  }
+  // keep the utilization around fill while aging
+  for (uint64_t i = 0; i < churn; ) {
+    uint32_t want = want_size();
+    release(want);
+    if (!allocate(want)) {
+      std::cout << "Can't allocate more space, stopping." << std::endl;
+      break;
+    }
+    i += want;
+  }
+  std::cout << "Executed in " << ceph_clock_now() - start << std::endl;
+
+  uint64_t free_extents = 0;
+  uint64_t max_free = 0;
+  alloc->dump([&](uint64_t offset, uint64_t length) {
+    ++free_extents;
+    max_free = std::max(max_free, length);
+  });
+  std::sort(latencies.begin(), latencies.end());
+  auto percentile = [&](double p) {
+    if (latencies.empty()) {
+      return 0u;
+    }
+    return latencies[std::min<size_t>(latencies.size() * p,
+				      latencies.size() - 1)];
+  };
+  std::cout << "Utilization "
+	    << 100.0 * (capacity - alloc->get_free()) / capacity << "%"
+	    << "\nFragmentation " << alloc->get_fragmentation(alloc_unit)
+	    << "\nFree extents " << free_extents
+	    << ", avg " << (free_extents ? alloc->get_free() / free_extents : 0)
+	    << ", max " << max_free
+	    << "\nAllocate latency (ns) p50 " << percentile(0.5)
+	    << " p99 " << percentile(0.99)
+	    << " p99.9 " << percentile(0.999)
+	    << " max " << percentile(1.0)
+	    << "\nMemory " << byte_u_t(mempool::bluestore_alloc::allocated_bytes())
+	    << " (" << byte_u_t(mempool_bytes) << " when fresh)"
+	    << std::endl;
+}
+
+TEST_P(AllocTest, test_alloc_aging_90)
+{
+  uint64_t capacity = uint64_t(1024) * 1024 * 1024 * 1024;
+  doAgingTest(capacity, capacity - capacity / 10, capacity * 3);
+}
+
+TEST_P(AllocTest, test_alloc_aging_70)
+{
+  uint64_t capacity = uint64_t(1024) * 1024 * 1024 * 1024;
+  doAgingTest(capacity, capacity / 10 * 7, capacity * 3);
+}
+
 TEST_P(AllocTest, test_alloc_bench_90_300)
 {
   uint64_t capacity = uint64_t(1024) * 1024 * 1024 * 1024;
@@ -330,4 +455,4 @@ TEST_P(AllocTest, test_alloc_bench_10_300)
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
-  ::testing::Values("stupid", "bitmap"));
+  ::testing::Values("stupid", "bitmap", "avl", "hybrid"));
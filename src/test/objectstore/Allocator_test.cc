@@ -14,6 +14,7 @@
 #include "include/stringify.h"
 #include "include/Context.h"
 #include "os/bluestore/Allocator.h"
+#include "os/bluestore/HybridAllocator.h"
 
 #include <boost/random/uniform_int.hpp>
 typedef boost::mt11213b gen_type;
@@ -326,7 +327,70 @@ TEST_P(AllocTest, test_alloc_bug_24598)
   EXPECT_EQ(1u, tmp.size());
 }
 
+TEST_P(AllocTest, test_dump_free)
+{
+  uint64_t capacity = 1024 * 1024;
+  uint64_t alloc_unit = 4096;
+  init_alloc(capacity, alloc_unit);
+
+  alloc->init_add_free(0, 0x10000);
+  alloc->init_add_free(0x20000, 0x1000);
+  alloc->init_add_free(0x22000, 0x3000);
+  alloc->init_add_free(0x80000, 0x80000);
+
+  interval_set<uint64_t> expected, dumped;
+  expected.insert(0, 0x10000);
+  expected.insert(0x20000, 0x1000);
+  expected.insert(0x22000, 0x3000);
+  expected.insert(0x80000, 0x80000);
+
+  uint64_t total = 0;
+  alloc->dump([&](uint64_t offset, uint64_t length) {
+      dumped.union_insert(offset, length);
+      total += length;
+    });
+  EXPECT_EQ(expected, dumped);
+  EXPECT_EQ(alloc->get_free(), total);
+}
+
+TEST(HybridAllocator, test_spillover)
+{
+  uint64_t block_size = 0x1000;
+  uint64_t capacity = 0x10000 * block_size;
+
+  // room for two extents only, the rest goes to the bitmap
+  HybridAllocator ha(g_ceph_context, capacity, block_size,
+		     2 * sizeof(range_seg_t));
+  ha.init_add_free(0, 0x2000);
+  ha.init_add_free(0x10000, 0x1000);
+  ha.init_add_free(0x20000, 0x100000);
+  ha.init_add_free(0x200000, 0x4000);
+  EXPECT_EQ(0x107000u, ha.get_free());
+
+  // the large extent is kept in the trees
+  PExtentVector extents;
+  EXPECT_EQ(0x100000, ha.allocate(0x100000, block_size, 0, 0, &extents));
+  ASSERT_EQ(1u, extents.size());
+  EXPECT_EQ(0x20000u, extents[0].offset);
+
+  // spilled over fragments are still allocatable
+  extents.clear();
+  EXPECT_EQ(0x7000, ha.allocate(0x7000, block_size, 0, 0, &extents));
+  EXPECT_EQ(0u, ha.get_free());
+  EXPECT_EQ(-ENOSPC, ha.allocate(block_size, block_size, 0, 0, &extents));
+
+  interval_set<uint64_t> release_set;
+  for (auto& e : extents) {
+    release_set.insert(e.offset, e.length);
+  }
+  ha.release(release_set);
+  EXPECT_EQ(0x7000u, ha.get_free());
+  ha.init_rm_free(0, 0x2000);
+  ha.init_rm_free(0x10000, 0x1000);
+  EXPECT_EQ(0x4000u, ha.get_free());
+}
+
 INSTANTIATE_TEST_SUITE_P(
   Allocator,
   AllocTest,
-  ::testing::Values("stupid", "bitmap"));
+  ::testing::Values("stupid", "bitmap", "avl", "hybrid"));
@@ -0,0 +1,366 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Replay a transaction trace, as recorded by an OSD with
+ * bluestore_debug_transaction_trace set, against any ObjectStore.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/errno.h"
+#include "global/global_init.h"
+#include "os/ObjectStore.h"
+#include "os/TransactionTrace.h"
+
+#define dout_context g_ceph_context
+#define dout_subsys ceph_subsys_
+
+static void usage()
+{
+  cout << "usage: ceph_replay_objectstore [flags] <trace>\n"
+      "	 --concurrency\n"
+      "	       number of queue_transactions() calls kept in flight\n"
+      "	 --no-mkfs\n"
+      "	       replay on top of what the store already has\n"
+      "\n"
+      "The store is picked by --osd-objectstore, --osd-data and --osd-journal.\n"
+      << std::endl;
+  generic_server_usage();
+}
+
+// bytes this process had the kernel write to storage, 0 if unknown
+static uint64_t get_io_write_bytes()
+{
+  std::ifstream io("/proc/self/io");
+  std::string key;
+  uint64_t value;
+  while (io >> key >> value) {
+    if (key == "write_bytes:") {
+      return value;
+    }
+  }
+  return 0;
+}
+
+/*
+ * A trace taken from a running OSD refers to the objects and the
+ * collections it had before tracing started. Replaying it on an empty
+ * store would hit the errors the stores treat as bugs, so the replayer
+ * keeps track of what the trace created and touches the rest first.
+ */
+class Replayer {
+  ObjectStore *store;
+  const unsigned concurrency;
+
+  std::set<coll_t> colls;
+  std::map<coll_t, ObjectStore::CollectionHandle> handles;
+  std::set<std::pair<coll_t, ghobject_t>> objects;
+
+  std::mutex lock;
+  std::condition_variable cond;
+  unsigned inflight = 0;
+  std::vector<ceph::timespan> latencies;
+
+public:
+  uint64_t records = 0;
+  uint64_t transactions = 0;
+  uint64_t bytes_written = 0;
+  uint64_t fixups = 0;
+
+  Replayer(ObjectStore *store, unsigned concurrency)
+    : store(store), concurrency(concurrency) {
+    vector<coll_t> ls;
+    store->list_collections(ls);
+    colls.insert(ls.begin(), ls.end());
+  }
+
+  ObjectStore::CollectionHandle get_handle(const coll_t& cid) {
+    auto& ch = handles[cid];
+    if (!ch) {
+      ch = store->open_collection(cid);
+    }
+    if (!ch) {
+      ch = store->create_new_collection(cid);
+    }
+    return ch;
+  }
+
+  void need_coll(const coll_t& cid, ObjectStore::Transaction *fix) {
+    if (colls.insert(cid).second) {
+      get_handle(cid);
+      fix->create_collection(cid, 0);
+      ++fixups;
+    }
+  }
+
+  void need_object(const coll_t& cid, const ghobject_t& oid,
+		   ObjectStore::Transaction *fix) {
+    need_coll(cid, fix);
+    if (objects.emplace(cid, oid).second) {
+      fix->touch(cid, oid);
+      ++fixups;
+    }
+  }
+
+  void scan(ObjectStore::Transaction& t, ObjectStore::Transaction *fix) {
+    using Transaction = ObjectStore::Transaction;
+    auto i = t.begin();
+    while (i.have_op()) {
+      auto op = i.decode_op();
+      switch (op->op) {
+      case Transaction::OP_NOP:
+	break;
+      case Transaction::OP_MKCOLL:
+	{
+	  const coll_t& cid = i.get_cid(op->cid);
+	  if (colls.insert(cid).second) {
+	    handles[cid] = store->create_new_collection(cid);
+	  }
+	}
+	break;
+      case Transaction::OP_RMCOLL:
+	colls.erase(i.get_cid(op->cid));
+	handles.erase(i.get_cid(op->cid));
+	break;
+      case Transaction::OP_WRITE:
+	bytes_written += op->len;
+	// fall through
+      case Transaction::OP_TOUCH:
+      case Transaction::OP_ZERO:
+      case Transaction::OP_TRUNCATE:
+      case Transaction::OP_SETALLOCHINT:
+      case Transaction::OP_OMAP_CLEAR:
+	need_coll(i.get_cid(op->cid), fix);
+	objects.emplace(i.get_cid(op->cid), i.get_oid(op->oid));
+	break;
+      case Transaction::OP_REMOVE:
+	need_coll(i.get_cid(op->cid), fix);
+	objects.erase(std::make_pair(i.get_cid(op->cid), i.get_oid(op->oid)));
+	break;
+      case Transaction::OP_SETATTR:
+      case Transaction::OP_SETATTRS:
+      case Transaction::OP_RMATTR:
+      case Transaction::OP_RMATTRS:
+      case Transaction::OP_OMAP_SETKEYS:
+      case Transaction::OP_OMAP_RMKEYS:
+      case Transaction::OP_OMAP_RMKEYRANGE:
+      case Transaction::OP_OMAP_SETHEADER:
+	need_object(i.get_cid(op->cid), i.get_oid(op->oid), fix);
+	break;
+      case Transaction::OP_CLONE:
+      case Transaction::OP_CLONERANGE:
+      case Transaction::OP_CLONERANGE2:
+	need_object(i.get_cid(op->cid), i.get_oid(op->oid), fix);
+	objects.emplace(i.get_cid(op->cid), i.get_oid(op->dest_oid));
+	break;
+      case Transaction::OP_TRY_RENAME:
+	need_coll(i.get_cid(op->cid), fix);
+	objects.erase(std::make_pair(i.get_cid(op->cid), i.get_oid(op->oid)));
+	objects.emplace(i.get_cid(op->cid), i.get_oid(op->dest_oid));
+	break;
+      case Transaction::OP_COLL_MOVE_RENAME:
+	need_coll(i.get_cid(op->cid), fix);
+	need_coll(i.get_cid(op->dest_cid), fix);
+	objects.erase(std::make_pair(i.get_cid(op->cid), i.get_oid(op->oid)));
+	objects.emplace(i.get_cid(op->dest_cid), i.get_oid(op->dest_oid));
+	break;
+      case Transaction::OP_SPLIT_COLLECTION2:
+      case Transaction::OP_MERGE_COLLECTION:
+	need_coll(i.get_cid(op->cid), fix);
+	need_coll(i.get_cid(op->dest_cid), fix);
+	break;
+      default:
+	need_coll(i.get_cid(op->cid), fix);
+	break;
+      }
+    }
+  }
+
+  void queue(transaction_trace_record_t& rec) {
+    ObjectStore::Transaction fix;
+    for (auto& t : rec.tls) {
+      scan(t, &fix);
+    }
+    need_coll(rec.cid, &fix);
+    auto ch = get_handle(rec.cid);
+    if (!fix.empty()) {
+      rec.tls.insert(rec.tls.begin(), std::move(fix));
+    }
+    ++records;
+    transactions += rec.tls.size();
+
+    {
+      std::unique_lock l{lock};
+      cond.wait(l, [this] { return inflight < concurrency; });
+      ++inflight;
+    }
+    const auto start = ceph::mono_clock::now();
+    rec.tls.back().register_on_commit(make_lambda_context([this, start] {
+      const auto lat = ceph::mono_clock::now() - start;
+      std::lock_guard l{lock};
+      latencies.push_back(lat);
+      --inflight;
+      cond.notify_all();
+    }));
+    store->queue_transactions(ch, rec.tls);
+  }
+
+  void drain() {
+    std::unique_lock l{lock};
+    cond.wait(l, [this] { return inflight == 0; });
+    handles.clear();
+  }
+
+  void report(double elapsed, uint64_t device_bytes) {
+    std::sort(latencies.begin(), latencies.end());
+    auto usec = [](ceph::timespan t) {
+      return std::chrono::duration<double, std::micro>(t).count();
+    };
+    auto percentile = [&](double p) {
+      if (latencies.empty()) {
+	return 0.0;
+      }
+      auto i = std::min<size_t>(latencies.size() * p, latencies.size() - 1);
+      return usec(latencies[i]);
+    };
+    cout << "records: " << records
+	 << "\ntransactions: " << transactions
+	 << "\nfixups: " << fixups
+	 << "\ndata written: " << byte_u_t(bytes_written)
+	 << "\ntotal time: " << elapsed << "s"
+	 << "\nrecords/s: " << records / elapsed
+	 << "\nthroughput: " << byte_u_t(bytes_written / elapsed) << "/s";
+    if (device_bytes) {
+      cout << "\ndevice writes: " << byte_u_t(device_bytes)
+	   << "\nwrite amplification: "
+	   << (bytes_written ? (double)device_bytes / bytes_written : 0.0);
+    } else {
+      cout << "\ndevice writes: unknown";
+    }
+    cout << "\nlatency (us): p50=" << percentile(0.5)
+	 << " p95=" << percentile(0.95)
+	 << " p99=" << percentile(0.99)
+	 << " p99.9=" << percentile(0.999)
+	 << " max=" << percentile(1.0)
+	 << "\nlatency histogram (us):\n";
+    // power of two buckets
+    std::map<uint64_t, uint64_t> histogram;
+    for (auto lat : latencies) {
+      uint64_t us = std::max<uint64_t>(usec(lat), 1);
+      histogram[1ull << (63 - __builtin_clzll(us))]++;
+    }
+    for (auto& [lower, count] : histogram) {
+      cout << "  [" << lower << ", " << lower * 2 << "): " << count << "\n";
+    }
+    cout << std::endl;
+  }
+};
+
+int main(int argc, const char *argv[])
+{
+  vector<const char*> args;
+  argv_to_vec(argc, argv, args);
+
+  if (args.empty()) {
+    cerr << argv[0] << ": -h or --help for usage" << std::endl;
+    exit(1);
+  }
+  if (ceph_argparse_need_usage(args)) {
+    usage();
+    exit(0);
+  }
+
+  auto cct = global_init(nullptr, args, CEPH_ENTITY_TYPE_OSD,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+
+  unsigned concurrency = 16;
+  bool mkfs = true;
+  std::string trace;
+  std::string val;
+  vector<const char*>::iterator i = args.begin();
+  while (i != args.end()) {
+    if (ceph_argparse_double_dash(args, i))
+      break;
+
+    if (ceph_argparse_witharg(args, i, &val, "--concurrency", (char*)nullptr)) {
+      concurrency = std::max(atoi(val.c_str()), 1);
+    } else if (ceph_argparse_flag(args, i, "--no-mkfs", (char*)nullptr)) {
+      mkfs = false;
+    } else if (trace.empty()) {
+      trace = *i++;
+    } else {
+      derr << "Error: can't understand argument: " << *i << "\n" << dendl;
+      exit(1);
+    }
+  }
+  if (trace.empty()) {
+    derr << "Error: no trace given" << dendl;
+    exit(1);
+  }
+
+  common_init_finish(g_ceph_context);
+
+  int fd = ::open(trace.c_str(), O_RDONLY|O_CLOEXEC);
+  if (fd < 0) {
+    derr << "failed to open " << trace << ": " << cpp_strerror(errno) << dendl;
+    return 1;
+  }
+
+  dout(0) << "objectstore " << g_conf()->osd_objectstore << dendl;
+  dout(0) << "data " << g_conf()->osd_data << dendl;
+  dout(0) << "journal " << g_conf()->osd_journal << dendl;
+  auto os = std::unique_ptr<ObjectStore>(
+      ObjectStore::create(g_ceph_context,
+                          g_conf()->osd_objectstore,
+                          g_conf()->osd_data,
+                          g_conf()->osd_journal));
+  if (!os) {
+    derr << "bad objectstore type " << g_conf()->osd_objectstore << dendl;
+    return 1;
+  }
+  if (mkfs && os->mkfs() < 0) {
+    derr << "mkfs failed" << dendl;
+    return 1;
+  }
+  if (os->mount() < 0) {
+    derr << "mount failed" << dendl;
+    return 1;
+  }
+
+  const uint64_t device_bytes_start = get_io_write_bytes();
+  const auto start = ceph::mono_clock::now();
+  int r;
+  {
+    Replayer replayer(os.get(), concurrency);
+    for (;;) {
+      transaction_trace_record_t rec;
+      r = rec.read(fd);
+      if (r < 0) {
+	break;
+      }
+      replayer.queue(rec);
+    }
+    replayer.drain();
+    const std::chrono::duration<double> elapsed =
+      ceph::mono_clock::now() - start;
+    if (r != -ENOENT) {
+      derr << "failed to read " << trace << " after " << replayer.records
+	   << " records: " << cpp_strerror(r) << dendl;
+    }
+    // count what the store writes back when it unmounts as well
+    os->umount();
+    const uint64_t device_bytes_end = get_io_write_bytes();
+    replayer.report(elapsed.count(), device_bytes_end - device_bytes_start);
+  }
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  return r == -ENOENT ? 0 : 1;
+}
@@ -16,6 +16,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <iostream>
+#include <regex>
 #include <time.h>
 #include <sys/mount.h>
 #include <boost/scoped_ptr.hpp>
@@ -35,6 +36,7 @@
 #include "common/Mutex.h"
 #include "common/Cond.h"
 #include "common/errno.h"
+#include "common/ceph_json.h"
 #include "include/stringify.h"
 #include "include/coredumpctl.h"
 
@@ -1094,6 +1096,28 @@ TEST_P(StoreTest, CompressionTest) {
   SetVal(g_conf(), "bluestore_compression_mode", "aggressive");
   g_ceph_context->_conf.apply_changes(nullptr);
   doCompressionTest();
+
+  // independently compressed frames, with and without caching the
+  // decompressed result
+  SetVal(g_conf(), "bluestore_compression_algorithm", "snappy");
+  SetVal(g_conf(), "bluestore_compression_mode", "force");
+  SetVal(g_conf(), "bluestore_compression_frame_size", "16384");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  doCompressionTest();
+
+  SetVal(g_conf(), "bluestore_cache_decompressed", "false");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  doCompressionTest();
+
+  // and without a csum to verify the frames against
+  SetVal(g_conf(), "bluestore_csum_type", "none");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  doCompressionTest();
+
+  SetVal(g_conf(), "bluestore_csum_type", "crc32c");
+  SetVal(g_conf(), "bluestore_cache_decompressed", "true");
+  SetVal(g_conf(), "bluestore_compression_frame_size", "0");
+  g_ceph_context->_conf.apply_changes(nullptr);
 }
 
 TEST_P(StoreTest, SimpleObjectTest) {
@@ -6186,6 +6210,58 @@ TEST_P(StoreTest, BluestoreOnOffCSumTest) {
 }
 #endif
 
+TEST_P(StoreTest, ReadCrc32cTest) {
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  auto write = [&](uint64_t off, size_t len) {
+    bufferlist bl;
+    for (size_t i = 0; i < len; ++i) {
+      bl.append((char)(rand() & 0xff));
+    }
+    ObjectStore::Transaction t;
+    t.write(cid, hoid, off, bl.length(), bl);
+    ASSERT_EQ(0, queue_transaction(store, ch, std::move(t)));
+  };
+  // protected, unaligned, unprotected and hole-y pieces
+  SetVal(g_conf(), "bluestore_csum_type", "crc32c");
+  g_conf().apply_changes(nullptr);
+  write(0, 0x12000);
+  write(0x30123, 0x5432);
+  SetVal(g_conf(), "bluestore_csum_type", "none");
+  g_conf().apply_changes(nullptr);
+  write(0x40000, 0x3000);
+  SetVal(g_conf(), "bluestore_csum_type", "crc32c");
+  g_conf().apply_changes(nullptr);
+  write(0x8000, 0x1001);
+
+  for (auto [off, len] : std::vector<std::pair<uint64_t, size_t>>{
+      {0, 0x50000}, {0, 0x1000}, {0x123, 0x20000}, {0x8000, 0x2000},
+      {0x30000, 0x11000}, {0x42000, 0x10000}, {0x60000, 0x1000}}) {
+    bufferlist in;
+    r = store->read(ch, hoid, off, len, in);
+    ASSERT_LE(0, r);
+    uint32_t crc = 0;
+    int r2 = store->read_crc32c(ch, hoid, off, len, 12345, &crc);
+    ASSERT_EQ(r, r2);
+    ASSERT_EQ(in.crc32c(12345), crc) << std::hex << off << "~" << len;
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(
   ObjectStore,
   StoreTest,
@@ -6399,6 +6475,86 @@ TEST_P(StoreTestSpecificAUSize, OnodeSizeTracking) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, DefragTest) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  SetVal(g_conf(), "bluestore_defrag_min_extents", "8");
+  SetVal(g_conf(), "bluestore_defrag_bytes_per_sec", "0");
+  SetVal(g_conf(), "bluestore_max_blob_size", "65536");
+  StartDeferred(0x1000);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // lay out 64 small blobs back to front so they can't be merged on write
+  const size_t obj_size = 0x40000;
+  bufferlist expected;
+  {
+    std::string data(obj_size, 0);
+    for (size_t i = 0; i < data.size(); i++)
+      data[i] = i / 256 + 1;
+    expected.append(data);
+  }
+  for (size_t j = obj_size; j > 0; j -= 0x1000) {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.substr_of(expected, j - 0x1000, 0x1000);
+    t.write(cid, hoid, j - 0x1000, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+
+  SetVal(g_conf(), "bluestore_defrag_enable", "true");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  bool done = false;
+  for (int i = 0; i < 100 && !done; ++i) {
+    JSONFormatter f(false);
+    store->dump_defrag_status(&f);
+    stringstream ss;
+    f.flush(ss);
+    done = ss.str().find("\"running\":false,\"passes\":1") != string::npos;
+    if (!done) {
+      usleep(100000);
+    }
+  }
+  SetVal(g_conf(), "bluestore_defrag_enable", "false");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  ASSERT_TRUE(done);
+
+  {
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, obj_size, bl);
+    ASSERT_EQ(r, (int)obj_size);
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  ch.reset();
+  EXPECT_EQ(store->umount(), 0);
+  ASSERT_EQ(store->fsck(false), 0);
+  EXPECT_EQ(store->mount(), 0);
+  ch = store->open_collection(cid);
+  {
+    bufferlist bl;
+    r = store->read(ch, hoid, 0, obj_size, bl);
+    ASSERT_EQ(r, (int)obj_size);
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, BlobReuseOnOverwrite) {
 
   if (string(GetParam()) != "bluestore")
@@ -6916,6 +7072,168 @@ TEST_P(StoreTestSpecificAUSize, SmallWriteOnShardedExtents) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, PoolAllocUnit) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  size_t block_size = 4096;
+  StartDeferred(block_size);
+  SetVal(g_conf(), "bluestore_prefer_deferred_size", "0");
+  g_conf().apply_changes(nullptr);
+
+  int r;
+  coll_t cid(spg_t(pg_t(0, 3), shard_id_t::NO_SHARD));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // leave holes of min_alloc_size all over the free space
+  const int num_small = 256;
+  bufferlist small;
+  small.append(std::string(block_size, 's'));
+  for (int i = 0; i < num_small; ++i) {
+    ObjectStore::Transaction t;
+    ghobject_t hoid(hobject_t("small_" + stringify(i), "", CEPH_NOSNAP, 0,
+			      3, ""));
+    t.write(cid, hoid, 0, small.length(), small);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  for (int i = 0; i < num_small; i += 2) {
+    ObjectStore::Transaction t;
+    ghobject_t hoid(hobject_t("small_" + stringify(i), "", CEPH_NOSNAP, 0,
+			      3, ""));
+    t.remove(cid, hoid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+
+  // the aligned bulk of a write goes in units of the pool's alloc_unit
+  const int64_t alloc_unit = 0x10000;
+  pool_opts_t opts;
+  opts.set(pool_opts_t::ALLOC_UNIT, alloc_unit);
+  ASSERT_EQ(0, store->set_collection_opts(ch, opts));
+
+  ghobject_t big(hobject_t("big", "", CEPH_NOSNAP, 0, 3, ""));
+  {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(std::string(alloc_unit * 4, 'b'));
+    t.write(cid, big, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  JSONFormatter f;
+  ASSERT_EQ(0, store->dump_onode(ch, big, "onode", &f));
+  stringstream ss;
+  f.flush(ss);
+  string dump = ss.str();
+  std::regex pextent_re("\"offset\":([0-9]+),\"length\":([0-9]+)");
+  uint64_t allocated = 0;
+  for (auto i = std::sregex_iterator(dump.begin(), dump.end(), pextent_re);
+       i != std::sregex_iterator(); ++i) {
+    uint64_t offset = std::stoull((*i)[1]);
+    uint64_t length = std::stoull((*i)[2]);
+    ASSERT_EQ(0u, offset % alloc_unit) << dump;
+    ASSERT_EQ(0u, length % alloc_unit) << dump;
+    allocated += length;
+  }
+  ASSERT_EQ((uint64_t)alloc_unit * 4, allocated) << dump;
+}
+
+TEST_P(StoreTestSpecificAUSize, SplitMergeDrainIsLocal) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  // keep deferred writes pending until something drains them
+  SetVal(g_conf(), "bluestore_deferred_batch_ops", "1000");
+  SetVal(g_conf(), "bluestore_prefer_deferred_size", "0");
+  size_t block_size = 0x10000;
+  StartDeferred(block_size);
+
+  int r;
+  coll_t cid(spg_t(pg_t(0, 5), shard_id_t::NO_SHARD));
+  coll_t tid(spg_t(pg_t(1, 5), shard_id_t::NO_SHARD));
+  coll_t oid(spg_t(pg_t(0, 6), shard_id_t::NO_SHARD));
+  auto ch = store->create_new_collection(cid);
+  auto tch = store->create_new_collection(tid);
+  auto och = store->create_new_collection(oid);
+  ghobject_t parent(hobject_t("parent", "", CEPH_NOSNAP, 0, 5, ""));
+  ghobject_t child(hobject_t("child", "", CEPH_NOSNAP, 1, 5, ""));
+  ghobject_t other(hobject_t("other", "", CEPH_NOSNAP, 0, 6, ""));
+  bufferlist full, small;
+  full.append(std::string(block_size, 'a'));
+  small.append(std::string(4096, 'b'));
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    t.write(cid, parent, 0, full.length(), full);
+    t.write(cid, child, 0, full.length(), full);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(oid, 0);
+    t.write(oid, other, 0, full.length(), full);
+    r = queue_transaction(store, och, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+
+  // overwrite a block of obj in ch, which is deferred
+  auto overwrite = [&](ObjectStore::CollectionHandle& c,
+		       const ghobject_t& obj) {
+    ObjectStore::Transaction t;
+    t.write(c->cid, obj, 0, small.length(), small);
+    ASSERT_EQ(0, queue_transaction(store, c, std::move(t)));
+    c->flush();
+  };
+
+  const PerfCounters* logger = store->get_perf_counters();
+  uint64_t deferred_ops = logger->get(l_bluestore_deferred_write_ops);
+  overwrite(och, other);
+  overwrite(ch, parent);
+  ASSERT_EQ(deferred_ops, logger->get(l_bluestore_deferred_write_ops));
+
+  // the split only submits the deferred writes of the parent
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(tid, 1);
+    t.split_collection(cid, 1, 1, tid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_EQ(deferred_ops + 1, logger->get(l_bluestore_deferred_write_ops));
+  ASSERT_TRUE(store->exists(tch, child));
+  ASSERT_FALSE(store->exists(ch, child));
+
+  // and the merge only those of its source
+  overwrite(tch, child);
+  ASSERT_EQ(deferred_ops + 1, logger->get(l_bluestore_deferred_write_ops));
+  {
+    ObjectStore::Transaction t;
+    t.merge_collection(tid, cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_EQ(deferred_ops + 2, logger->get(l_bluestore_deferred_write_ops));
+
+  bufferlist expected;
+  expected.append(small);
+  expected.append(std::string(block_size - small.length(), 'a'));
+  std::vector<std::pair<ObjectStore::CollectionHandle, ghobject_t>> objs = {
+    {ch, parent}, {ch, child}, {och, other}};
+  for (auto& [c, obj] : objs) {
+    bufferlist bl;
+    r = store->read(c, obj, 0, block_size, bl);
+    ASSERT_EQ((int)block_size, r);
+    ASSERT_TRUE(bl_eq(expected, bl));
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, ExcessiveFragmentation) {
   if (string(GetParam()) != "bluestore")
     return;
@@ -7462,6 +7780,76 @@ TEST_P(StoreTestSpecificAUSize, BluestoreRepairTest) {
 
 }
 
+TEST_P(StoreTestSpecificAUSize, BluestoreFsckThreads) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  SetVal(g_conf(), "bluestore_fsck_on_mount", "false");
+  SetVal(g_conf(), "bluestore_fsck_on_umount", "false");
+  SetVal(g_conf(), "bluestore_extent_map_shard_max_size", "12000");
+  StartDeferred(0x10000);
+
+  BlueStore* bstore = dynamic_cast<BlueStore*> (store.get());
+
+  // enough objects, in a few pools, for every worker to get some
+  const int num_pools = 3;
+  const int num_objects = 200;
+  bufferlist bl;
+  bl.append(std::string(0x1000, 'f'));
+  std::vector<std::pair<coll_t, ghobject_t>> victims;
+  for (int64_t pool = 1; pool <= num_pools; ++pool) {
+    coll_t cid(spg_t(pg_t(0, pool), shard_id_t::NO_SHARD));
+    auto ch = store->create_new_collection(cid);
+    {
+      ObjectStore::Transaction t;
+      t.create_collection(cid, 0);
+      int r = queue_transaction(store, ch, std::move(t));
+      ASSERT_EQ(r, 0);
+    }
+    for (int i = 0; i < num_objects; ++i) {
+      ObjectStore::Transaction t;
+      string name = "fsck_obj_" + stringify(i);
+      ghobject_t hoid = make_object(name.c_str(), pool);
+      for (int j = 0; j < 8; ++j) {
+	t.write(cid, hoid, j * 0x20000, bl.length(), bl);
+      }
+      int r = queue_transaction(store, ch, std::move(t));
+      ASSERT_EQ(r, 0);
+    }
+    victims.emplace_back(cid, make_object("fsck_obj_7", pool));
+  }
+
+  bstore->umount();
+  for (auto threads : {"1", "4"}) {
+    SetVal(g_conf(), "bluestore_fsck_threads", threads);
+    g_conf().apply_changes(nullptr);
+    ASSERT_EQ(bstore->fsck(false), 0) << threads << " threads";
+    ASSERT_EQ(bstore->fsck(true), 0) << threads << " threads";
+  }
+
+  // the workers find the same errors as a single thread
+  bstore->mount();
+  for (auto& v : victims) {
+    bstore->inject_false_free(v.first, v.second);
+  }
+  bstore->umount();
+  SetVal(g_conf(), "bluestore_fsck_threads", "1");
+  g_conf().apply_changes(nullptr);
+  int errors = bstore->fsck(false);
+  ASSERT_GT(errors, 0);
+  ASSERT_EQ(errors, bstore->fsck(true));
+  SetVal(g_conf(), "bluestore_fsck_threads", "4");
+  g_conf().apply_changes(nullptr);
+  ASSERT_EQ(errors, bstore->fsck(false));
+  ASSERT_EQ(errors, bstore->fsck(true));
+
+  // and repair fixes them all
+  ASSERT_EQ(bstore->repair(false), 0);
+  ASSERT_EQ(bstore->fsck(false), 0);
+  ASSERT_EQ(bstore->fsck(true), 0);
+  bstore->mount();
+}
+
 TEST_P(StoreTest, BluestoreStatistics) {
   if (string(GetParam()) != "bluestore")
     return;
@@ -7511,6 +7899,97 @@ TEST_P(StoreTest, BluestoreStatistics) {
   cout << std::endl;
 }
 
+// the number of samples in a histogram of the perf counters collection
+static uint64_t get_histogram_count(const string& logger,
+				    const string& counter)
+{
+  JSONFormatter f;
+  g_ceph_context->get_perfcounters_collection()->dump_formatted_histograms(
+    &f, false, logger, counter);
+  stringstream ss;
+  f.flush(ss);
+  JSONParser p;
+  string json = ss.str();
+  if (!p.parse(json.c_str(), json.length())) {
+    return 0;
+  }
+  JSONObj *o = p.find_obj(logger);
+  o = o ? o->find_obj(counter) : nullptr;
+  o = o ? o->find_obj("values") : nullptr;
+  if (!o) {
+    return 0;
+  }
+  string values = o->get_data();
+  std::replace_if(values.begin(), values.end(),
+		  [](char c) { return !isdigit(c); }, ' ');
+  std::istringstream is(values);
+  uint64_t count = 0;
+  for (uint64_t v; is >> v; ) {
+    count += v;
+  }
+  return count;
+}
+
+TEST_P(StoreTest, BluestoreStateLatencyHistograms) {
+  if (string(GetParam()) != "bluestore")
+    return;
+
+  SetVal(g_conf(), "bluestore_pool_latency_histograms", "true");
+  g_conf().apply_changes(nullptr);
+
+  const int64_t poolid = 11;
+  coll_t cid(spg_t(pg_t(0, poolid), shard_id_t::NO_SHARD));
+  ghobject_t hoid(hobject_t("test_state_hist", "", CEPH_NOSNAP, 0, poolid, ""));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    int r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+
+  const string pool_logger = "bluestore-pool-" + stringify(poolid);
+  uint64_t before = get_histogram_count("bluestore", "state_prepare_lat_hist");
+  uint64_t pool_before = get_histogram_count(pool_logger,
+					     "state_prepare_lat_hist");
+  const int n = 10;
+  for (int i = 0; i < n; ++i) {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(string(4096, 'a' + i));
+    t.write(cid, hoid, 4096 * i, bl.length(), bl);
+    int r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // every transaction goes through prepare once
+  ASSERT_EQ(before + n,
+	    get_histogram_count("bluestore", "state_prepare_lat_hist"));
+  ASSERT_EQ(pool_before + n,
+	    get_histogram_count(pool_logger, "state_prepare_lat_hist"));
+
+  // while those of the meta collection stay out of the pool histograms
+  {
+    coll_t meta;
+    auto mch = store->create_new_collection(meta);
+    ObjectStore::Transaction t;
+    t.create_collection(meta, 0);
+    int r = queue_transaction(store, mch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  ASSERT_EQ(before + n + 1,
+	    get_histogram_count("bluestore", "state_prepare_lat_hist"));
+  ASSERT_EQ(pool_before + n,
+	    get_histogram_count(pool_logger, "state_prepare_lat_hist"));
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    int r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, BluestoreTinyDevFailure) {
   if (string(GetParam()) != "bluestore")
     return;
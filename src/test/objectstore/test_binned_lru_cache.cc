@@ -0,0 +1,115 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <string>
+#include "gtest/gtest.h"
+#include "common/PriorityCache.h"
+#include "global/global_context.h"
+#include "kv/rocksdb_cache/BinnedLRUCache.h"
+
+using rocksdb_cache::BinnedLRUCacheShard;
+
+static void noop_deleter(const rocksdb::Slice&, void*) {}
+
+class BinnedLRUCacheShardTest : public ::testing::Test {
+public:
+  std::unique_ptr<BinnedLRUCacheShard> shard;
+
+  void make_shard(size_t capacity, double probation_pool_ratio) {
+    shard.reset(new BinnedLRUCacheShard(capacity, false, 0.0,
+					probation_pool_ratio));
+  }
+
+  // every entry has a charge of 1, so the usages count entries
+  void insert(unsigned i) {
+    std::string key = std::to_string(i);
+    ASSERT_TRUE(shard->Insert(key, i, nullptr, 1, &noop_deleter, nullptr,
+			      rocksdb::Cache::Priority::LOW).ok());
+  }
+
+  bool lookup(unsigned i) {
+    std::string key = std::to_string(i);
+    auto h = shard->Lookup(key, i);
+    if (!h) {
+      return false;
+    }
+    shard->Release(h);
+    return true;
+  }
+};
+
+TEST_F(BinnedLRUCacheShardTest, ScanKeepsHitEntries) {
+  make_shard(100, 0.25);
+  for (unsigned i = 0; i < 50; ++i) {
+    insert(i);
+    ASSERT_TRUE(lookup(i));
+  }
+  // a scan reads every key once, so it only goes through probation
+  for (unsigned i = 1000; i < 3000; ++i) {
+    insert(i);
+  }
+  for (unsigned i = 0; i < 50; ++i) {
+    ASSERT_TRUE(lookup(i)) << "hot key " << i << " was evicted";
+  }
+  ASSERT_EQ(100u, shard->GetUsage());
+  ASSERT_EQ(50u, shard->GetProbationPoolUsage());
+}
+
+TEST_F(BinnedLRUCacheShardTest, NoProbation) {
+  // a ratio of 0 is the plain LRU it used to be
+  make_shard(100, 0.0);
+  for (unsigned i = 0; i < 50; ++i) {
+    insert(i);
+    ASSERT_TRUE(lookup(i));
+  }
+  for (unsigned i = 1000; i < 3000; ++i) {
+    insert(i);
+  }
+  for (unsigned i = 0; i < 50; ++i) {
+    ASSERT_FALSE(lookup(i));
+  }
+  ASSERT_EQ(0u, shard->GetProbationPoolUsage());
+}
+
+TEST_F(BinnedLRUCacheShardTest, ProtectedOverflowIsDemoted) {
+  make_shard(100, 0.25);
+  for (unsigned i = 0; i < 100; ++i) {
+    insert(i);
+  }
+  ASSERT_EQ(100u, shard->GetProbationPoolUsage());
+  // each hit moves an entry to the protected part, which only has room
+  // for 75, so its oldest entries go back on probation
+  for (unsigned i = 0; i < 100; ++i) {
+    ASSERT_TRUE(lookup(i));
+  }
+  ASSERT_EQ(100u, shard->GetUsage());
+  ASSERT_EQ(25u, shard->GetProbationPoolUsage());
+  ASSERT_EQ(100u, shard->TEST_GetLRUSize());
+
+  // and the demoted ones are the first to go
+  insert(1000);
+  ASSERT_FALSE(lookup(0));
+  ASSERT_TRUE(lookup(99));
+}
+
+TEST(BinnedLRUCache, RequestCacheBytes) {
+  auto cache = std::static_pointer_cast<rocksdb_cache::BinnedLRUCache>(
+    rocksdb_cache::NewBinnedLRUCache(g_ceph_context, 1000, 0, false, 0.0, 0.25));
+  for (unsigned i = 0; i < 10; ++i) {
+    std::string key = std::to_string(i);
+    ASSERT_TRUE(cache->Insert(key, nullptr, 10, &noop_deleter, nullptr,
+			      rocksdb::Cache::Priority::LOW).ok());
+  }
+  // nothing was hit yet, so it is all asked for at PRI2
+  ASSERT_EQ(0, cache->request_cache_bytes(PriorityCache::Priority::PRI1, 0));
+  ASSERT_EQ(100, cache->request_cache_bytes(PriorityCache::Priority::PRI2, 0));
+
+  for (unsigned i = 0; i < 4; ++i) {
+    std::string key = std::to_string(i);
+    auto h = cache->Lookup(key, nullptr);
+    ASSERT_TRUE(h);
+    cache->Release(h);
+  }
+  ASSERT_EQ(40, cache->request_cache_bytes(PriorityCache::Priority::PRI1, 0));
+  ASSERT_EQ(60, cache->request_cache_bytes(PriorityCache::Priority::PRI2, 0));
+}
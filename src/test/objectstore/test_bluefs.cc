@@ -135,6 +135,54 @@ TEST(BlueFS, small_appends) {
   rm_temp_bdev(fn);
 }
 
+#if defined(HAVE_PMEM)
+TEST(BlueFS, pmem_sub_block_flush) {
+  // have libpmem take the file for DAX-mapped pmem, so that the device is
+  // byte addressable and each fsync below writes less than a block
+  setenv("PMEM_IS_PMEM_FORCE", "1", 1);
+  auto unset = make_scope_guard([] { unsetenv("PMEM_IS_PMEM_FORCE"); });
+  uint64_t size = 1048576 * 128;
+  string fn = get_temp_bdev(size);
+  uuid_d fsid;
+  string expected;
+  {
+    BlueFS fs(g_ceph_context);
+    ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, fn, false));
+    fs.add_block_extent(BlueFS::BDEV_DB, 1048576, size - 1048576);
+    ASSERT_EQ(0, fs.mkfs(fsid));
+    ASSERT_EQ(0, fs.mount());
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.mkdir("dir"));
+    ASSERT_EQ(0, fs.open_for_write("dir", "file", &h, false));
+    // 23 bytes at a time, so the flushes straddle the block boundaries
+    for (unsigned i = 0; i < 1000; ++i) {
+      string s = stringify(i % 10) + "bcdeabcdeabcdeabcdeabc";
+      h->append(s.c_str(), s.length());
+      expected += s;
+      ASSERT_EQ(0, fs.fsync(h));
+    }
+    fs.close_writer(h);
+    fs.umount();
+  }
+  {
+    BlueFS fs(g_ceph_context);
+    ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, fn, false));
+    fs.add_block_extent(BlueFS::BDEV_DB, 1048576, size - 1048576);
+    ASSERT_EQ(0, fs.mount());
+    BlueFS::FileReader *h;
+    ASSERT_EQ(0, fs.open_for_read("dir", "file", &h));
+    bufferlist bl;
+    BlueFS::FileReaderBuffer buf(4096);
+    ASSERT_EQ((int)expected.length(),
+	      fs.read(h, &buf, 0, expected.length(), &bl, NULL));
+    ASSERT_EQ(expected, bl.to_str());
+    delete h;
+    fs.umount();
+  }
+  rm_temp_bdev(fn);
+}
+#endif
+
 TEST(BlueFS, very_large_write) {
   // we'll write a ~3G file, so allocate more than that for the whole fs
   uint64_t size = 1048576 * 1024 * 8ull;
@@ -620,6 +668,81 @@ TEST(BlueFS, test_replay) {
   rm_temp_bdev(fn);
 }
 
+TEST(BlueFS, test_wal_envelope) {
+  uint64_t size = 1048576 * 128;
+  string fn = get_temp_bdev(size);
+  g_ceph_context->_conf.set_val("bluefs_wal_envelope_mode", "true");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  auto restore = make_scope_guard([] {
+    g_ceph_context->_conf.set_val("bluefs_wal_envelope_mode", "false");
+    g_ceph_context->_conf.apply_changes(nullptr);
+  });
+
+  BlueFS fs(g_ceph_context);
+  ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, fn, false));
+  fs.add_block_extent(BlueFS::BDEV_DB, 1048576, size - 1048576);
+  uuid_d fsid;
+  ASSERT_EQ(0, fs.mkfs(fsid));
+  ASSERT_EQ(0, fs.mount());
+  ASSERT_EQ(0, fs.mkdir("dir"));
+  string expected;
+  {
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.open_for_write("dir", "000001.log", &h, false));
+    for (unsigned i = 0; i < 100; ++i) {
+      string rec = "record " + stringify(i) + string(i * 97, 'x');
+      h->append(rec.c_str(), rec.length());
+      expected += rec;
+      fs.fsync(h);
+    }
+    fs.close_writer(h);
+  }
+  fs.umount();
+
+  // the file size is only recoverable from the envelopes
+  ASSERT_EQ(0, fs.mount());
+  {
+    uint64_t file_size = 0;
+    ASSERT_EQ(0, fs.stat("dir", "000001.log", &file_size, nullptr));
+    ASSERT_EQ(expected.length(), file_size);
+
+    BlueFS::FileReader *h;
+    ASSERT_EQ(0, fs.open_for_read("dir", "000001.log", &h));
+    BlueFS::FileReaderBuffer buf(4096);
+    string got;
+    uint64_t pos = 0;
+    while (true) {
+      bufferlist bl;
+      int r = fs.read(h, &buf, pos, 3000, &bl, NULL);
+      ASSERT_GE(r, 0);
+      if (r == 0) {
+	break;
+      }
+      got.append(bl.c_str(), bl.length());
+      pos += r;
+    }
+    ASSERT_EQ(expected, got);
+    delete h;
+  }
+  {
+    // recycling the file starts a new generation; old envelopes are gone
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.open_for_write("dir", "000001.log", &h, true));
+    h->append("new", 3);
+    fs.fsync(h);
+    fs.close_writer(h);
+  }
+  fs.umount();
+  ASSERT_EQ(0, fs.mount());
+  {
+    uint64_t file_size = 0;
+    ASSERT_EQ(0, fs.stat("dir", "000001.log", &file_size, nullptr));
+    ASSERT_EQ(3u, file_size);
+  }
+  fs.umount();
+  rm_temp_bdev(fn);
+}
+
 int main(int argc, char **argv) {
   vector<const char*> args;
   argv_to_vec(argc, (const char **)argv, args);
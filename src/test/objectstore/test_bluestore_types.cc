@@ -306,6 +306,40 @@ TEST(bluestore_blob_t, calc_csum)
   }
 }
 
+TEST(bluestore_blob_t, calc_csum_batch)
+{
+  // two pieces, so that one 4k block straddles buffers
+  bufferlist bl;
+  bufferptr p1(3 * 4096 + 100), p2(5 * 4096 - 100);
+  for (unsigned i = 0; i < p1.length(); ++i)
+    p1.c_str()[i] = i * 13;
+  for (unsigned i = 0; i < p2.length(); ++i)
+    p2.c_str()[i] = i * 31;
+  bl.append(p1);
+  bl.append(p2);
+
+  for (int csum_type : {Checksummer::CSUM_CRC32C,
+			Checksummer::CSUM_CRC32C_16,
+			Checksummer::CSUM_CRC32C_8}) {
+    bluestore_blob_t a, b, c;
+    a.init_csum(csum_type, 12, bl.length());
+    b.init_csum(csum_type, 12, bl.length());
+    c.init_csum(csum_type, 12, bl.length());
+    a.calc_csum(0, bl);
+    Checksummer::crc32c_batch batch;
+    b.calc_csum(0, bl, &batch);
+    bufferlist first;
+    first.substr_of(bl, 0, 4096);
+    c.calc_csum(4096, first, &batch);
+    batch.flush();
+    ASSERT_EQ(a.get_csum_count(), b.get_csum_count());
+    for (unsigned i = 0; i < a.get_csum_count(); ++i) {
+      ASSERT_EQ(a.get_csum_item(i), b.get_csum_item(i));
+    }
+    ASSERT_EQ(a.get_csum_item(0), c.get_csum_item(1));
+  }
+}
+
 TEST(bluestore_blob_t, csum_bench)
 {
   bufferlist bl;
@@ -310,6 +310,60 @@ TEST_P(KVTest, RMRange) {
   fini();
 }
 
+TEST_P(KVTest, RMRangeBounded) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+  ASSERT_EQ(0, db->create_and_open(cout));
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    bufferlist value;
+    value.append("value");
+    for (auto k : {"a", "b", "c", "d", "e"}) {
+      t->set("prefix", k, value);
+      t->set("other", k, value);
+    }
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  {
+    cout << "bounded iterator stays within [b, d)" << std::endl;
+    KeyValueDB::Iterator it =
+      db->get_iterator("prefix", KeyValueDB::IteratorBounds{"b", "d"});
+    it->seek_to_first();
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("b", it->key());
+    it->next();
+    ASSERT_EQ("c", it->key());
+    it->next();
+    ASSERT_FALSE(it->valid());
+    it->seek_to_last();
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("c", it->key());
+  }
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rm_range_keys("prefix", "b", "e");
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  {
+    KeyValueDB::Iterator it =
+      db->get_iterator("prefix", KeyValueDB::IteratorBounds());
+    it->seek_to_first();
+    ASSERT_TRUE(it->valid());
+    ASSERT_EQ("a", it->key());
+    it->next();
+    ASSERT_EQ("e", it->key());
+    it->next();
+    ASSERT_FALSE(it->valid());
+    KeyValueDB::Iterator other = db->get_iterator("other");
+    unsigned n = 0;
+    for (other->seek_to_first(); other->valid(); other->next()) {
+      ++n;
+    }
+    ASSERT_EQ(5u, n);
+  }
+  fini();
+}
+
 TEST_P(KVTest, RocksDBColumnFamilyTest) {
   if(string(GetParam()) != "rocksdb")
     return;
@@ -465,6 +519,132 @@ TEST_P(KVTest, RocksDBCFMerge) {
   fini();
 }
 
+TEST_P(KVTest, RocksDBShardedCF) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+
+  std::vector<KeyValueDB::ColumnFamily> cfs;
+  cfs.push_back(KeyValueDB::ColumnFamily("S", "", 3));
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  cout << "creating a prefix sharded over three column families" << std::endl;
+  ASSERT_EQ(0, db->create_and_open(cout, cfs));
+  set<string> keys;
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    for (unsigned i = 0; i < 100; ++i) {
+      char k[16];
+      snprintf(k, sizeof(k), "key%03u", i);
+      bufferlist bl;
+      bl.append(k);
+      t->set("S", k, bl);
+      t->set("P", k, bl);
+      keys.insert(k);
+    }
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+  }
+  auto check = [&](const string& prefix) {
+    auto p = keys.begin();
+    KeyValueDB::Iterator iter = db->get_iterator(prefix);
+    for (iter->seek_to_first(); iter->valid(); iter->next(), ++p) {
+      ASSERT_TRUE(p != keys.end());
+      ASSERT_EQ(*p, iter->key());
+      ASSERT_EQ(*p, _bl_to_str(iter->value()));
+    }
+    ASSERT_TRUE(p == keys.end());
+    auto r = keys.rbegin();
+    for (iter->seek_to_last(); iter->valid(); iter->prev(), ++r) {
+      ASSERT_TRUE(r != keys.rend());
+      ASSERT_EQ(*r, iter->key());
+    }
+    ASSERT_TRUE(r == keys.rend());
+    // change direction in the middle
+    iter->lower_bound("key050");
+    ASSERT_TRUE(iter->valid());
+    ASSERT_EQ("key050", iter->key());
+    iter->prev();
+    ASSERT_EQ("key049", iter->key());
+    iter->next();
+    ASSERT_EQ("key050", iter->key());
+    iter->next();
+    ASSERT_EQ("key051", iter->key());
+  };
+  check("S");
+  {
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->rm_range_keys("S", "key010", "key020");
+    ASSERT_EQ(0, db->submit_transaction_sync(t));
+    for (auto p = keys.begin(); p != keys.end();) {
+      if (*p >= "key010" && *p < "key020")
+	p = keys.erase(p);
+      else
+	++p;
+    }
+  }
+  check("S");
+  fini();
+
+  cout << "resharding P onto two column families, S back to default"
+       << std::endl;
+  init();
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  ASSERT_EQ(0, db->open(cout, cfs));
+  std::vector<KeyValueDB::ColumnFamily> new_cfs;
+  new_cfs.push_back(KeyValueDB::ColumnFamily("P", "", 2));
+  ASSERT_EQ(0, db->reshard(new_cfs, cout));
+  fini();
+
+  init();
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  ASSERT_EQ(0, db->open(cout, new_cfs));
+  check("S");
+  {
+    KeyValueDB::Iterator iter = db->get_iterator("P");
+    unsigned n = 0;
+    for (iter->seek_to_first(); iter->valid(); iter->next()) {
+      ++n;
+    }
+    ASSERT_EQ(100u, n);
+  }
+  fini();
+}
+
+TEST_P(KVTest, RocksDBShardedCFMismatch) {
+  if(string(GetParam()) != "rocksdb")
+    return;
+
+  std::vector<KeyValueDB::ColumnFamily> cfs;
+  cfs.push_back(KeyValueDB::ColumnFamily("S", "", 3));
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  ASSERT_EQ(0, db->create_and_open(cout, cfs));
+  fini();
+
+  cout << "opening with other shard counts is refused" << std::endl;
+  for (unsigned shards : {1u, 2u, 4u}) {
+    init();
+    std::vector<KeyValueDB::ColumnFamily> other;
+    other.push_back(KeyValueDB::ColumnFamily("S", "", shards));
+    ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+    ASSERT_EQ(-EINVAL, db->open(cout, other));
+    fini();
+  }
+
+  cout << "unless opening to reshard" << std::endl;
+  db.reset(KeyValueDB::create(g_ceph_context, string(GetParam()),
+			      "kv_test_temp_dir",
+			      {{"allow_sharding_mismatch", "1"}}));
+  std::vector<KeyValueDB::ColumnFamily> new_cfs;
+  new_cfs.push_back(KeyValueDB::ColumnFamily("S", "", 2));
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  ASSERT_EQ(0, db->open(cout, new_cfs));
+  ASSERT_EQ(0, db->reshard(new_cfs, cout));
+  fini();
+
+  init();
+  ASSERT_EQ(0, db->init(g_conf()->bluestore_rocksdb_options));
+  ASSERT_EQ(0, db->open(cout, new_cfs));
+  fini();
+}
+
 INSTANTIATE_TEST_SUITE_P(
   KeyValueDB,
   KVTest,
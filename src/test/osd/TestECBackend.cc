@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <signal.h>
 #include "osd/ECBackend.h"
+#include "test/erasure-code/ErasureCodeExample.h"
 #include "gtest/gtest.h"
 
 TEST(ECUtil, stripe_info_t)
@@ -58,3 +59,59 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+
+TEST(ECUtil, avoid_slow_shards)
+{
+  // k=2, m=1
+  ErasureCodeInterfaceRef ec_impl(new ErasureCodeExample());
+  set<int> want = {0, 1};
+  const map<int, vector<pair<int, int>>> data = {
+    {0, {{0, 1}}}, {1, {{0, 1}}}};
+
+  // shard 1 is slow, read the parity instead
+  {
+    map<int, vector<pair<int, int>>> need = data;
+    ECUtil::avoid_slow_shards(ec_impl, 4, want,
+			      {{0, 0.001}, {1, 0.1}, {2, 0.001}}, &need);
+    ASSERT_EQ(2u, need.size());
+    ASSERT_TRUE(need.count(0));
+    ASSERT_TRUE(need.count(2));
+  }
+  // all slow but one, keep enough to decode
+  {
+    map<int, vector<pair<int, int>>> need = data;
+    ECUtil::avoid_slow_shards(ec_impl, 0.5, want,
+			      {{0, 0.1}, {1, 0.1}, {2, 0.001}}, &need);
+    ASSERT_EQ(2u, need.size());
+    ASSERT_TRUE(need.count(2));
+  }
+  // within the ratio, unknown latencies, or off: unchanged
+  {
+    map<int, vector<pair<int, int>>> need = data;
+    ECUtil::avoid_slow_shards(ec_impl, 4, want,
+			      {{0, 0.001}, {1, 0.003}, {2, 0.001}}, &need);
+    ASSERT_EQ(data, need);
+    ECUtil::avoid_slow_shards(ec_impl, 4, want,
+			      {{0, 0}, {1, 0.1}, {2, 0}}, &need);
+    ASSERT_EQ(data, need);
+    ECUtil::avoid_slow_shards(ec_impl, 0, want,
+			      {{0, 0.001}, {1, 0.1}, {2, 0.001}}, &need);
+    ASSERT_EQ(data, need);
+  }
+}
+
+TEST(ECUtil, add_hedge_shards)
+{
+  ErasureCodeInterfaceRef ec_impl(new ErasureCodeExample());
+  map<int, vector<pair<int, int>>> need = {{1, {{0, 1}}}};
+  const map<int, double> latency = {{0, 0.01}, {1, 0.01}, {2, 0.001}};
+
+  // the fastest spare first
+  ASSERT_EQ(1u, ECUtil::add_hedge_shards(ec_impl, 1, latency, &need));
+  ASSERT_EQ(2u, need.size());
+  ASSERT_TRUE(need.count(2));
+  // no more than there are spares
+  ASSERT_EQ(1u, ECUtil::add_hedge_shards(ec_impl, 2, latency, &need));
+  ASSERT_EQ(3u, need.size());
+  ASSERT_EQ(0u, ECUtil::add_hedge_shards(ec_impl, 1, latency, &need));
+}
@@ -30,7 +30,7 @@ public:
   uint64_t client3;
 
   MClockClientQueueTest() :
-    q(g_ceph_context),
+    q(g_ceph_context, true),
     client1(1001),
     client2(9999),
     client3(100000001)
@@ -32,7 +32,7 @@ public:
   uint64_t client3;
 
   MClockOpClassQueueTest() :
-    q(g_ceph_context),
+    q(g_ceph_context, true),
     client1(1001),
     client2(9999),
     client3(100000001)
@@ -182,3 +182,45 @@ TEST_F(MClockOpClassQueueTest, TestRemoveByClass) {
   r = q.dequeue();
   ASSERT_EQ(104u, r.get_map_epoch());
 }
+
+
+TEST(MClockOpClassClientInfoMgr, Cost) {
+  using ceph::mclock::osd_op_type_t;
+  const auto client = osd_op_type_t::client_op;
+  ceph::mclock::OpClassClientInfoMgr hdd(g_ceph_context, true);
+  ASSERT_EQ(1u, hdd.get_cost(client, 0));
+  ASSERT_EQ(1u, hdd.get_cost(client, (1 << 20) - 1));
+  ASSERT_EQ(2u, hdd.get_cost(client, 1 << 20));
+  ASSERT_EQ(5u, hdd.get_cost(client, 4 << 20));
+  ASSERT_EQ(5u, hdd.get_cost(osd_op_type_t::osd_rep_op, 4 << 20));
+
+  ceph::mclock::OpClassClientInfoMgr ssd(g_ceph_context, false);
+  ASSERT_EQ(1u, ssd.get_cost(client, 0));
+  ASSERT_EQ(2u, ssd.get_cost(client, 32 << 10));
+  ASSERT_EQ(129u, ssd.get_cost(client, 4 << 20));
+}
+
+
+TEST(MClockOpClassClientInfoMgr, BackgroundCost) {
+  using ceph::mclock::osd_op_type_t;
+  ceph::mclock::OpClassClientInfoMgr ssd(g_ceph_context, false);
+
+  // the costs the OSD gives these aren't byte counts
+  ASSERT_EQ(1u, ssd.get_cost(osd_op_type_t::bg_recovery, 20 << 20));
+  ASSERT_EQ(1u, ssd.get_cost(osd_op_type_t::bg_scrub, 50 << 20));
+  ASSERT_EQ(1u, ssd.get_cost(osd_op_type_t::bg_snaptrim, 1 << 20));
+  ASSERT_EQ(1u, ssd.get_cost(osd_op_type_t::bg_pg_delete, 1 << 20));
+  ASSERT_EQ(1u, ssd.get_cost(osd_op_type_t::peering_event, 1 << 20));
+}
+
+
+TEST(MClockOpClassClientInfoMgr, NoCostUnit) {
+  g_ceph_context->_conf.set_val("osd_op_queue_mclock_cost_unit_hdd", "0");
+  ceph::mclock::OpClassClientInfoMgr hdd(g_ceph_context, true);
+  g_ceph_context->_conf.rm_val("osd_op_queue_mclock_cost_unit_hdd");
+
+  // every op costs the same
+  const auto client = ceph::mclock::osd_op_type_t::client_op;
+  ASSERT_EQ(1u, hdd.get_cost(client, 0));
+  ASSERT_EQ(1u, hdd.get_cost(client, 4 << 20));
+}
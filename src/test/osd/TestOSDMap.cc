@@ -279,6 +279,134 @@ TEST_F(OSDMapTest, MapFunctionsMatch) {
   EXPECT_EQ(acting_osds, acting_osds_two);
 }
 
+TEST_F(OSDMapTest, MapPGRange) {
+  set_up_map();
+  for (auto pool : {my_ec_pool, my_rep_pool}) {
+    unsigned pg_num = osdmap.get_pg_pool(pool)->get_pg_num();
+    vector<vector<int>> up, acting;
+    vector<int> up_primary, acting_primary;
+    osdmap.pg_range_to_up_acting_osds(pool, 0, pg_num,
+                                      &up, &up_primary,
+                                      &acting, &acting_primary);
+    ASSERT_EQ(pg_num, up.size());
+    ASSERT_EQ(pg_num, acting_primary.size());
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      vector<int> up_osds, acting_osds;
+      int up_p, acting_p;
+      osdmap.pg_to_up_acting_osds(pg_t(ps, pool), &up_osds, &up_p,
+                                  &acting_osds, &acting_p);
+      EXPECT_EQ(up_osds, up[ps]);
+      EXPECT_EQ(up_p, up_primary[ps]);
+      EXPECT_EQ(acting_osds, acting[ps]);
+      EXPECT_EQ(acting_p, acting_primary[ps]);
+    }
+  }
+}
+
+TEST_F(OSDMapTest, DecodeClientOnly) {
+  set_up_map();
+  bufferlist bl;
+  ASSERT_EQ(0, osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED));
+
+  OSDMap client;
+  client.set_client_only(true);
+  client.decode(bl);
+  ASSERT_EQ(osdmap.get_epoch(), client.get_epoch());
+  ASSERT_EQ(osdmap.get_pools().size(), client.get_pools().size());
+  ASSERT_EQ(osdmap.get_up_osd_features(), client.get_up_osd_features());
+
+  // a client-only map must still take incrementals
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.fsid = osdmap.get_fsid();
+  inc.new_state[0] = CEPH_OSD_UP;
+  osdmap.apply_incremental(inc);
+  ASSERT_EQ(0, client.apply_incremental(inc));
+  ASSERT_FALSE(client.is_up(0));
+
+  for (auto pool : {my_ec_pool, my_rep_pool}) {
+    for (unsigned ps = 0; ps < 64; ++ps) {
+      pg_t pgid(ps, pool);
+      vector<int> up, acting, up2, acting2;
+      int up_primary, acting_primary, up_primary2, acting_primary2;
+      osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+                                  &acting, &acting_primary);
+      client.pg_to_up_acting_osds(pgid, &up2, &up_primary2,
+                                  &acting2, &acting_primary2);
+      ASSERT_EQ(up, up2);
+      ASSERT_EQ(up_primary, up_primary2);
+      ASSERT_EQ(acting, acting2);
+      ASSERT_EQ(acting_primary, acting_primary2);
+    }
+  }
+
+  // and refuse to be encoded, as it lacks the skipped parts
+  bufferlist out;
+  ASSERT_EQ(-EINVAL, client.encode(out));
+  ASSERT_EQ(0u, out.length());
+}
+
+TEST_F(OSDMapTest, MappingIncrementalUpdate) {
+  set_up_map();
+  mapping.update(osdmap);
+  ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+
+  auto check = [&]() {
+    for (auto pool : {my_ec_pool, my_rep_pool}) {
+      for (unsigned ps = 0; ps < 64; ++ps) {
+        pg_t pgid(ps, pool);
+        vector<int> up, acting, up2, acting2;
+        int up_primary, acting_primary, up_primary2, acting_primary2;
+        osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+                                    &acting, &acting_primary);
+        mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+        ASSERT_EQ(up, up2);
+        ASSERT_EQ(up_primary, up_primary2);
+        ASSERT_EQ(acting, acting2);
+        ASSERT_EQ(acting_primary, acting_primary2);
+      }
+    }
+  };
+
+  {
+    // mark an osd down
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[0] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    ASSERT_TRUE(mapping.update(osdmap, inc, 1000));
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+    check();
+    for (auto& pgid : mapping.get_osd_acting_pgs(0)) {
+      ADD_FAILURE() << pgid << " still maps to down osd.0";
+    }
+  }
+  {
+    // add a pg_temp
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pg_t(3, my_rep_pool)] =
+      mempool::osdmap::vector<int32_t>({3, 4, 5});
+    osdmap.apply_incremental(inc);
+    ASSERT_TRUE(mapping.update(osdmap, inc, 1000));
+    check();
+  }
+  {
+    // too many pgs to recompute one by one
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[1] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    ASSERT_FALSE(mapping.update(osdmap, inc, 1));
+    mapping.update(osdmap);
+    check();
+  }
+  {
+    // an osd coming back up needs a full update
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_state[0] = CEPH_OSD_UP;
+    osdmap.apply_incremental(inc);
+    ASSERT_TRUE(osdmap.is_up(0));
+    ASSERT_FALSE(mapping.update(osdmap, inc, 1000));
+  }
+}
+
 /** This test must be removed or modified appropriately when we allow
  * other ways to specify a primary. */
 TEST_F(OSDMapTest, PrimaryIsFirst) {
@@ -2232,7 +2232,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
   log.add(modify);
 
   EXPECT_TRUE(log.logged_object(oid));
-  pg_log_entry_t *entry = log.objects[oid];
+  pg_log_entry_t *entry = log.objects.find(oid)->second;
   EXPECT_EQ(modify.op, entry->op);
   EXPECT_EQ(modify.version, entry->version);
   EXPECT_EQ(modify.prior_version, entry->prior_version);
@@ -2246,7 +2246,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
   log.add(del);
 
   EXPECT_TRUE(log.logged_object(oid));
-  entry = log.objects[oid];
+  entry = log.objects.find(oid)->second;
   EXPECT_EQ(del.op, entry->op);
   EXPECT_EQ(del.version, entry->version);
   EXPECT_EQ(del.prior_version, entry->prior_version);
@@ -2259,7 +2259,7 @@ TEST_F(PGLogTest, ErrorNotIndexedByObject) {
 		   utime_t(20,1), -ENOENT));
 
   EXPECT_TRUE(log.logged_object(oid));
-  entry = log.objects[oid];
+  entry = log.objects.find(oid)->second;
   EXPECT_EQ(del.op, entry->op);
   EXPECT_EQ(del.version, entry->version);
   EXPECT_EQ(del.prior_version, entry->prior_version);
@@ -2988,6 +2988,57 @@ TEST(pg_log_dup_t, get_key_name) {
   EXPECT_EQ("dup_0000001234.00000000000000005678", a_key_name);
 }
 
+namespace {
+struct index_item_t {
+  int key;
+};
+struct index_item_key {
+  const int& operator()(const index_item_t& i) const {
+    return i.key;
+  }
+};
+// few buckets, so that probe sequences collide and wrap
+struct index_item_hash {
+  size_t operator()(int k) const {
+    return k % 7;
+  }
+};
+}
+
+TEST(pg_log_index_t, insert_find_erase) {
+  pg_log_index_t<index_item_t, int, index_item_key, index_item_hash> index;
+  std::vector<index_item_t> items(200);
+  std::map<int, index_item_t*> ref;
+  for (int i = 0; i < 200; ++i) {
+    items[i].key = i;
+  }
+  unsigned seed = 1;
+  for (int round = 0; round < 5000; ++round) {
+    seed = seed * 1103515245 + 12345;
+    int k = (seed >> 8) % 200;
+    if (ref.count(k) && (seed & 1)) {
+      auto it = index.find(k);
+      ASSERT_NE(index.end(), it);
+      ASSERT_EQ(&items[k], it->second);
+      index.erase(it);
+      ref.erase(k);
+    } else {
+      index.insert_or_assign(&items[k]);
+      ref[k] = &items[k];
+    }
+    ASSERT_EQ(ref.size(), index.size());
+  }
+  for (int k = 0; k < 200; ++k) {
+    ASSERT_EQ(ref.count(k), index.count(k));
+    if (ref.count(k)) {
+      ASSERT_EQ(&items[k], index.find(k)->second);
+    }
+  }
+  index.clear();
+  ASSERT_TRUE(index.empty());
+  ASSERT_EQ(index.end(), index.find(3));
+}
+
 // Local Variables:
 // compile-command: "cd ../.. ; make unittest_pglog ; ./unittest_pglog --log-to-stderr=true  --debug-osd=20 # --gtest_filter=*.* "
 // End:
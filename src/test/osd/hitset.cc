@@ -195,3 +195,38 @@ TEST_F(ExplicitObjectHitSetTest, RejectsNoMatch) {
   }
   EXPECT_EQ(matches, 0);
 }
+
+TEST(TemperatureSketch, Counts) {
+  TemperatureSketch sketch(1000);
+  ASSERT_EQ(1024u, sketch.get_width());
+
+  char buf[50];
+  for (unsigned i = 0; i < 500; ++i) {
+    sprintf(buf, "sketchtest_%u", i);
+    hobject_t obj(object_t(buf), "", 0, i * 2654435761u, 0, "");
+    for (unsigned j = 0; j < i % 10; ++j) {
+      sketch.insert(obj);
+    }
+  }
+  // never under the count, and rarely much over it with so few objects
+  unsigned exact = 0;
+  for (unsigned i = 0; i < 500; ++i) {
+    sprintf(buf, "sketchtest_%u", i);
+    hobject_t obj(object_t(buf), "", 0, i * 2654435761u, 0, "");
+    unsigned count = sketch.count(obj);
+    EXPECT_GE(count, i % 10);
+    if (count == i % 10)
+      ++exact;
+  }
+  EXPECT_GT(exact, 450u);
+
+  hobject_t hot(object_t("hot"), "", 0, 1234, 0, "");
+  for (unsigned j = 0; j < 100; ++j) {
+    sketch.insert(hot);
+  }
+  ASSERT_EQ(100u, sketch.count(hot));
+  sketch.decay();
+  ASSERT_EQ(50u, sketch.count(hot));
+  sketch.decay();
+  ASSERT_EQ(25u, sketch.count(hot));
+}
@@ -278,3 +278,46 @@ TEST(extentcache, write_write_overlap2)
 
   c.release_write_pin(pin3);
 }
+
+TEST(extentcache, cached_write)
+{
+  hobject_t oid;
+
+  ExtentCache c;
+  c.set_max_cached_bytes(16);
+
+  // write 1 populates the cache
+  ExtentCache::write_pin pin;
+  c.open_write_pin(pin);
+  auto to_write = iset_from_vector({{0, 10}, {20, 4}});
+  auto must_read = c.reserve_extents_for_rmw(
+    oid, pin, to_write, iset_from_vector({{0, 2}}));
+  ASSERT_EQ(must_read, iset_from_vector({{0, 2}}));
+  c.present_rmw_update(oid, pin, imap_from_iset(to_write));
+  c.release_write_pin(pin, true);
+  ASSERT_EQ(14u, c.get_cached_bytes());
+
+  // write 2 finds what it reads in the cache
+  ExtentCache::write_pin pin2;
+  c.open_write_pin(pin2);
+  auto to_read2 = iset_from_vector({{0, 4}, {20, 4}});
+  auto to_write2 = iset_from_vector({{0, 4}, {20, 8}});
+  must_read = c.reserve_extents_for_rmw(oid, pin2, to_write2, to_read2);
+  ASSERT_TRUE(must_read.empty());
+  auto pending = c.get_remaining_extents_for_rmw(oid, pin2, to_read2);
+  uint64_t got = 0;
+  for (auto &&e: pending)
+    got += e.get_len();
+  ASSERT_EQ(8u, got);
+  c.present_rmw_update(oid, pin2, imap_from_iset(to_write2));
+  ASSERT_EQ(6u, c.get_cached_bytes());
+
+  // the least recently written extent, 4~6, is evicted first
+  c.release_write_pin(pin2, true);
+  ASSERT_EQ(12u, c.get_cached_bytes());
+
+  c.print(std::cerr);
+
+  c.drop_cached();
+  ASSERT_EQ(0u, c.get_cached_bytes());
+}
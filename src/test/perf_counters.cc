@@ -252,4 +252,59 @@ TEST(PerfCounters, read_avg) {
   std::thread t2(counters_readavg_test, fake_pf);
   t2.join();
   t1.join();
-}
\ No newline at end of file
+}
+enum {
+  TEST_PERFCOUNTERS4_ELEMENT_FIRST = 800,
+  TEST_PERFCOUNTERS4_ELEMENT_COUNTER,
+  TEST_PERFCOUNTERS4_ELEMENT_AVG,
+  TEST_PERFCOUNTERS4_ELEMENT_U64_AVG,
+  TEST_PERFCOUNTERS4_ELEMENT_LAST,
+};
+
+TEST(PerfCounters, sharded) {
+  PerfCountersBuilder bld(g_ceph_context, "test_perfcounter_4",
+      TEST_PERFCOUNTERS4_ELEMENT_FIRST, TEST_PERFCOUNTERS4_ELEMENT_LAST);
+  bld.add_u64_counter(TEST_PERFCOUNTERS4_ELEMENT_COUNTER, "counter");
+  bld.add_time_avg(TEST_PERFCOUNTERS4_ELEMENT_AVG, "avg");
+  bld.add_u64_avg(TEST_PERFCOUNTERS4_ELEMENT_U64_AVG, "u64_avg");
+  std::unique_ptr<PerfCounters> fake_pf(bld.create_perf_counters());
+
+  // more threads than shards, so that some of them share one
+  const int num_threads = 20;
+  const int num_incs = 10000;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; ++i) {
+    threads.emplace_back([&fake_pf] {
+      for (int j = 0; j < num_incs; ++j) {
+	fake_pf->inc(TEST_PERFCOUNTERS4_ELEMENT_COUNTER, 2);
+	fake_pf->tinc(TEST_PERFCOUNTERS4_ELEMENT_AVG, utime_t(0, 3));
+	fake_pf->inc(TEST_PERFCOUNTERS4_ELEMENT_U64_AVG, 4);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(2u * num_threads * num_incs,
+	    fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNTER));
+  auto avg = fake_pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_AVG);
+  ASSERT_EQ((uint64_t)num_threads * num_incs, avg.first);
+  ASSERT_EQ(3u * num_threads * num_incs, avg.second);
+
+  fake_pf->set(TEST_PERFCOUNTERS4_ELEMENT_COUNTER, 5);
+  ASSERT_EQ(5u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNTER));
+  // set() of an average replaces the sum and counts one more
+  fake_pf->set(TEST_PERFCOUNTERS4_ELEMENT_U64_AVG, 7);
+  {
+    JSONFormatter f;
+    fake_pf->dump_formatted(&f, false, "u64_avg");
+    std::ostringstream ss, expected;
+    f.flush(ss);
+    expected << "{\"u64_avg\":{\"avgcount\":"
+	     << num_threads * num_incs + 1 << ",\"sum\":7}}";
+    ASSERT_EQ(expected.str(), ss.str());
+  }
+  fake_pf->reset();
+  ASSERT_EQ(0u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNTER));
+  ASSERT_EQ(0u, fake_pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_AVG).first);
+}
@@ -51,6 +51,7 @@
 #include "common/Mutex.h"
 #include "common/Thread.h"
 #include "common/Timer.h"
+#include "common/WeightedPriorityQueue.h"
 #include "msg/async/Event.h"
 #include "global/global_init.h"
 
@@ -868,6 +869,25 @@ double vector_push_pop()
   return Cycles::to_seconds(stop - start)/(count*3);
 }
 
+// Measure the cost of enqueueing an item in a WeightedPriorityQueue and
+// dequeueing one, with a few items of a few priorities and clients queued,
+// as in an OSD shard
+double wpq_enqueue_dequeue()
+{
+  int count = 100000;
+  WeightedPriorityQueue<uint64_t, uint64_t> q(0, 0);
+  for (uint64_t i = 0; i < 16; i++) {
+    q.enqueue(i % 4, 63 + (i % 2) * 64, 4096, std::move(i));
+  }
+  uint64_t start = Cycles::rdtsc();
+  for (int i = 0; i < count; i++) {
+    uint64_t item = q.dequeue();
+    q.enqueue(item % 4, 63 + (item % 2) * 64, 4096, std::move(item));
+  }
+  uint64_t stop = Cycles::rdtsc();
+  return Cycles::to_seconds(stop - start)/count;
+}
+
 // Measure the cost of ceph_clock_now
 double perf_ceph_clock_now()
 {
@@ -968,6 +988,8 @@ TestInfo tests[] = {
     "Throw an Exception in a function call"},
   {"vector_push_pop", vector_push_pop,
     "Push and pop a std::vector"},
+  {"wpq_enqueue_dequeue", wpq_enqueue_dequeue,
+    "WeightedPriorityQueue enqueue and dequeue"},
   {"ceph_clock_now", perf_ceph_clock_now,
    "ceph_clock_now function"},
 };
@@ -0,0 +1,153 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include "rgw/rgw_bucket_filter.h"
+
+#include <set>
+#include <thread>
+#include <gtest/gtest.h>
+#include "global/global_context.h"
+
+using namespace std::chrono_literals;
+
+// a bucket index in memory, shared by all the buckets
+class TestFilter : public RGWBucketExistenceFilter {
+protected:
+  int read_index_version(const RGWBucketInfo& bucket_info,
+                         uint64_t *ver, uint64_t *num_entries) override {
+    if (head_error < 0) {
+      return head_error;
+    }
+    *ver = version;
+    *num_entries = names.size();
+    return 0;
+  }
+  int list_index(const RGWBucketInfo& bucket_info,
+                 const std::function<bool(const std::vector<std::string>&)>& f) override {
+    ++lists;
+    f(std::vector<std::string>(names.begin(), names.end()));
+    return 0;
+  }
+  int lookup_index(const RGWBucketInfo& bucket_info,
+                   const rgw_obj_key& key, optional_yield y) override {
+    ++lookups;
+    return names.count(key.name) ? 0 : -ENOENT;
+  }
+public:
+  std::set<std::string> names;
+  uint64_t version = 1;
+  int head_error = 0;
+  int lists = 0;
+  int lookups = 0;
+
+  TestFilter() : RGWBucketExistenceFilter(g_ceph_context, nullptr) {}
+};
+
+static RGWBucketInfo make_bucket(const std::string& name)
+{
+  RGWBucketInfo info;
+  info.bucket.name = name;
+  info.bucket.bucket_id = name + ".1";
+  return info;
+}
+
+TEST(BucketExistenceFilter, BuiltOnFirstRead)
+{
+  TestFilter filter;
+  filter.names = {"a", "b"};
+  const auto bucket = make_bucket("bucket");
+
+  // an untracked bucket filters nothing until the refresher builds it
+  EXPECT_TRUE(filter.may_exist(bucket, rgw_obj_key("missing"), null_yield));
+  EXPECT_EQ(0, filter.refresh());
+  EXPECT_EQ(1, filter.lists);
+
+  EXPECT_TRUE(filter.may_exist(bucket, rgw_obj_key("a"), null_yield));
+  EXPECT_TRUE(filter.may_exist(bucket, rgw_obj_key("b"), null_yield));
+  EXPECT_EQ(0, filter.lookups);
+  EXPECT_FALSE(filter.may_exist(bucket, rgw_obj_key("missing"), null_yield));
+  EXPECT_EQ(1, filter.lookups);
+}
+
+TEST(BucketExistenceFilter, MissFallsThroughToIndex)
+{
+  TestFilter filter;
+  filter.names = {"a"};
+  const auto bucket = make_bucket("bucket");
+  filter.may_exist(bucket, rgw_obj_key("a"), null_yield);
+  ASSERT_EQ(0, filter.refresh());
+
+  // written through another gateway, so not added to this filter
+  filter.names.insert("c");
+  EXPECT_TRUE(filter.may_exist(bucket, rgw_obj_key("c"), null_yield));
+  EXPECT_EQ(1, filter.lookups);
+  // but found in the index, so it is now
+  EXPECT_TRUE(filter.may_exist(bucket, rgw_obj_key("c"), null_yield));
+  EXPECT_EQ(1, filter.lookups);
+
+  // written through this one
+  filter.add(bucket, rgw_obj_key("d"));
+  EXPECT_TRUE(filter.may_exist(bucket, rgw_obj_key("d"), null_yield));
+  EXPECT_EQ(1, filter.lookups);
+}
+
+TEST(BucketExistenceFilter, FailedHeadReadIsRetried)
+{
+  TestFilter filter;
+  filter.names = {"a"};
+  filter.head_error = -EIO;
+  const auto bucket = make_bucket("bucket");
+  filter.may_exist(bucket, rgw_obj_key("a"), null_yield);
+
+  ASSERT_EQ(0, filter.refresh());
+  EXPECT_EQ(0, filter.lists);
+  EXPECT_TRUE(filter.may_exist(bucket, rgw_obj_key("missing"), null_yield));
+  EXPECT_EQ(0, filter.lookups);
+  // the retry comes well before the interval
+  EXPECT_GT(filter.refresh_interval_msec(), filter.next_refresh_msec());
+
+  filter.head_error = 0;
+  std::this_thread::sleep_for(std::chrono::milliseconds(
+    filter.next_refresh_msec() + 10));
+  ASSERT_EQ(0, filter.refresh());
+  EXPECT_EQ(1, filter.lists);
+  EXPECT_EQ(filter.refresh_interval_msec(), filter.next_refresh_msec());
+  EXPECT_FALSE(filter.may_exist(bucket, rgw_obj_key("missing"), null_yield));
+}
+
+TEST(BucketExistenceFilter, RebuiltOnIndexChange)
+{
+  TestFilter filter;
+  filter.names = {"a"};
+  const auto bucket = make_bucket("bucket");
+  g_ceph_context->_conf.set_val_or_die(
+    "rgw_bucket_existence_filter_refresh_interval", "1");
+  filter.may_exist(bucket, rgw_obj_key("a"), null_yield);
+  ASSERT_EQ(0, filter.refresh());
+  EXPECT_EQ(1, filter.lists);
+
+  // the same version needs no rebuild
+  filter.may_exist(bucket, rgw_obj_key("a"), null_yield);
+  std::this_thread::sleep_for(1100ms);
+  ASSERT_EQ(0, filter.refresh());
+  EXPECT_EQ(1, filter.lists);
+
+  filter.names.erase("a");
+  ++filter.version;
+  filter.may_exist(bucket, rgw_obj_key("a"), null_yield);
+  std::this_thread::sleep_for(1100ms);
+  ASSERT_EQ(0, filter.refresh());
+  EXPECT_EQ(2, filter.lists);
+  EXPECT_FALSE(filter.may_exist(bucket, rgw_obj_key("a"), null_yield));
+  g_ceph_context->_conf.rm_val(
+    "rgw_bucket_existence_filter_refresh_interval");
+}
@@ -0,0 +1,115 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "rgw/rgw_cache.h"
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+// ObjectCache spreads its entries over this many shards by name
+static constexpr size_t num_shards = 32;
+
+class ObjectCacheTest : public ::testing::Test {
+protected:
+  ObjectCache cache;
+
+  void init(int lru_size) {
+    g_ceph_context->_conf.set_val("rgw_cache_lru_size",
+                                  std::to_string(lru_size));
+    cache.set_ctx(g_ceph_context);
+    cache.set_enabled(true);
+  }
+
+  void TearDown() override {
+    g_ceph_context->_conf.rm_val("rgw_cache_lru_size");
+  }
+
+  void put(const std::string& name) {
+    ObjectCacheInfo info;
+    info.flags = CACHE_FLAG_DATA;
+    info.data.append(name);
+    cache.put(name, info, nullptr);
+  }
+
+  bool get(const std::string& name) {
+    ObjectCacheInfo info;
+    if (cache.get(name, info, CACHE_FLAG_DATA, nullptr) < 0) {
+      return false;
+    }
+    EXPECT_EQ(name, info.data.to_str());
+    return true;
+  }
+
+  size_t size() {
+    size_t n = 0;
+    cache.for_each([&n](const std::string&, const ObjectCacheEntry&) { ++n; });
+    return n;
+  }
+
+  // names that all land in the same shard
+  static std::vector<std::string> same_shard_names(size_t count) {
+    std::vector<std::string> names;
+    const std::string first = "obj0";
+    const size_t shard = std::hash<std::string>{}(first) % num_shards;
+    for (unsigned i = 0; names.size() < count; ++i) {
+      std::string name = "obj" + std::to_string(i);
+      if (std::hash<std::string>{}(name) % num_shards == shard) {
+        names.push_back(name);
+      }
+    }
+    return names;
+  }
+};
+
+TEST_F(ObjectCacheTest, PutGetRemove) {
+  init(1000);
+  put("foo");
+  ASSERT_TRUE(get("foo"));
+  ASSERT_FALSE(get("bar"));
+  ASSERT_TRUE(cache.remove("foo"));
+  ASSERT_FALSE(get("foo"));
+  ASSERT_FALSE(cache.remove("foo"));
+}
+
+TEST_F(ObjectCacheTest, Bounded) {
+  const int lru_size = 2 * num_shards;
+  init(lru_size);
+  for (unsigned i = 0; i < 1000; ++i) {
+    put("obj" + std::to_string(i));
+  }
+  ASSERT_LE(size(), size_t(lru_size));
+
+  // the entry just put is never the one evicted
+  put("last");
+  ASSERT_TRUE(get("last"));
+}
+
+TEST_F(ObjectCacheTest, HitSurvivesEviction) {
+  // three entries per shard
+  init(3 * num_shards);
+  auto names = same_shard_names(5);
+  put(names[0]);
+  put(names[1]);
+  put(names[2]);
+
+  // the clock clears every referenced bit and evicts the oldest
+  put(names[3]);
+  ASSERT_FALSE(get(names[0]));
+
+  // a hit gives names[1] a second chance, so names[2] goes instead
+  ASSERT_TRUE(get(names[1]));
+  put(names[4]);
+  ASSERT_TRUE(get(names[1]));
+  ASSERT_FALSE(get(names[2]));
+  ASSERT_TRUE(get(names[3]));
+  ASSERT_TRUE(get(names[4]));
+}
+
+TEST_F(ObjectCacheTest, Disable) {
+  init(1000);
+  put("foo");
+  cache.set_enabled(false);
+  ASSERT_FALSE(get("foo"));
+  put("foo");
+  cache.set_enabled(true);
+  ASSERT_FALSE(get("foo"));
+}
@@ -18,6 +18,8 @@
 #include "rgw/rgw_dmclock_async_scheduler.h"
 
 #include <optional>
+#include <set>
+#include <thread>
 #include <boost/asio/spawn.hpp>
 #include <gtest/gtest.h>
 #include "acconfig.h"
@@ -426,6 +428,138 @@ TEST(Queue, SpawnAsyncRequest)
   EXPECT_TRUE(context.stopped());
 }
 
+TEST(Queue, TenantClients)
+{
+  boost::asio::io_context context;
+  TenantClients tenants(g_ceph_context);
+  ClientCounters counters(g_ceph_context, &tenants);
+  AsyncScheduler queue(g_ceph_context, context, std::ref(counters), nullptr,
+                  [&tenants] (client_id client) -> ClientInfo* {
+      static ClientInfo info{0, 1, 1};
+      if (is_tenant_client(client)) {
+        return tenants.info(client);
+      }
+      return &info;
+    }, AtLimit::Reject);
+  queue.set_tenant_clients(&tenants);
+
+  const auto a = queue.tenant_client("a", {1, 1, 1}); // by reservation
+  const auto b = queue.tenant_client("b", {0, 1, 1}); // by priority
+  EXPECT_TRUE(is_tenant_client(a));
+  EXPECT_TRUE(is_tenant_client(b));
+  EXPECT_NE(a, b);
+  EXPECT_EQ(a, queue.tenant_client("a", {1, 1, 1}));
+
+  // a new qos keeps the client, and replaces its info
+  const auto a2 = queue.tenant_client("a", {1, 2, 1});
+  EXPECT_EQ(a, a2);
+  ASSERT_TRUE(tenants.info(a));
+  EXPECT_EQ(2, tenants.info(a)->weight);
+  EXPECT_NE(counters(a), counters(b));
+
+  std::optional<error_code> ec1, ec2, ec3;
+  std::optional<PhaseType> p1, p2, p3;
+
+  auto now = get_time();
+  queue.async_request(a2, {}, now, 1, capture(ec1, p1));
+  queue.async_request(b, {}, now, 1, capture(ec2, p2));
+  queue.async_request(b, {}, now, 1, capture(ec3, p3));
+  EXPECT_EQ(1u, counters(a2)->get(queue_counters::l_qlen));
+  EXPECT_EQ(1u, counters(b)->get(queue_counters::l_qlen));
+
+  context.poll();
+  EXPECT_TRUE(context.stopped());
+
+  ASSERT_TRUE(ec1);
+  EXPECT_EQ(boost::system::errc::success, *ec1);
+  ASSERT_TRUE(p1);
+  EXPECT_EQ(PhaseType::reservation, *p1);
+
+  ASSERT_TRUE(ec2);
+  EXPECT_EQ(boost::system::errc::success, *ec2);
+  ASSERT_TRUE(p2);
+  EXPECT_EQ(PhaseType::priority, *p2);
+
+  ASSERT_TRUE(ec3);
+  EXPECT_EQ(boost::system::errc::resource_unavailable_try_again, *ec3);
+
+  EXPECT_EQ(0u, counters(a)->get(queue_counters::l_qlen));
+  EXPECT_EQ(1u, counters(a)->get(queue_counters::l_res));
+  EXPECT_EQ(0u, counters(a)->get(queue_counters::l_prio));
+
+  EXPECT_EQ(0u, counters(b)->get(queue_counters::l_qlen));
+  EXPECT_EQ(0u, counters(b)->get(queue_counters::l_res));
+  EXPECT_EQ(1u, counters(b)->get(queue_counters::l_prio));
+  EXPECT_EQ(1u, counters(b)->get(queue_counters::l_limit));
+}
+
 #endif
 
+TEST(Queue, TenantClientsMany)
+{
+  TenantClients tenants(g_ceph_context);
+  std::unique_ptr<ClientInfo> retired;
+
+  // enough for several chunks of clients
+  constexpr int count = 1000;
+  std::vector<client_id> ids;
+  for (int i = 0; i < count; i++) {
+    auto id = tenants.get(std::to_string(i), 0, i + 1, 0, &retired);
+    EXPECT_FALSE(retired);
+    EXPECT_TRUE(is_tenant_client(id));
+    ids.push_back(id);
+  }
+  EXPECT_EQ(size_t(count), std::set<client_id>(ids.begin(), ids.end()).size());
+
+  for (int i = 0; i < count; i++) {
+    EXPECT_EQ(ids[i], tenants.get(std::to_string(i), 0, i + 1, 0, &retired));
+    EXPECT_FALSE(retired);
+    auto info = tenants.info(ids[i]);
+    ASSERT_TRUE(info);
+    EXPECT_EQ(i + 1, info->weight);
+  }
+
+  // a changed qos hands the old info back, without a new id
+  auto old_info = tenants.info(ids[0]);
+  EXPECT_EQ(ids[0], tenants.get("0", 0, 5, 0, &retired));
+  EXPECT_EQ(old_info, retired.get());
+  EXPECT_EQ(5, tenants.info(ids[0])->weight);
+
+  // an id that was never handed out isn't found
+  auto unknown = static_cast<client_id>(static_cast<size_t>(ids.back()) + 1);
+  EXPECT_EQ(nullptr, tenants.info(unknown));
+  EXPECT_EQ(nullptr, tenants.counters(unknown));
+}
+
+TEST(Queue, TenantClientsConcurrent)
+{
+  TenantClients tenants(g_ceph_context);
+  constexpr int num_threads = 4;
+  constexpr int num_names = 200;
+  std::vector<std::vector<client_id>> ids(num_threads);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&tenants, &ids, t] {
+        std::unique_ptr<ClientInfo> retired;
+        for (int i = 0; i < num_names; i++) {
+          // every thread gives the names a qos of its own
+          ids[t].push_back(tenants.get(std::to_string(i), 0, t + 1, 0,
+                                       &retired));
+          EXPECT_TRUE(tenants.info(ids[t].back()));
+        }
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  // all threads agree on the id of each name
+  for (int t = 1; t < num_threads; t++) {
+    EXPECT_EQ(ids[0], ids[t]);
+  }
+  EXPECT_EQ(size_t(num_names), std::set<client_id>(ids[0].begin(), ids[0].end()).size());
+}
+
+
 } // namespace rgw::dmclock
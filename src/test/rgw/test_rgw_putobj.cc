@@ -13,6 +13,7 @@
  */
 
 #include "rgw/rgw_putobj.h"
+#include <boost/asio/thread_pool.hpp>
 #include <gtest/gtest.h>
 
 inline bufferlist string_buf(const char* buf) {
@@ -194,3 +195,86 @@ TEST(PutObj_Stripe, SkipFirstChunk)
   ASSERT_EQ(4u, mock.ops.size());
   EXPECT_EQ(Op({"", 4}), mock.ops[3]); // flush
 }
+
+// upper cases each chunk, and fails on the ones that contain 'x'
+struct UpperPipe : rgw::putobj::ParallelPipe {
+  UpperPipe(DataProcessor *next, boost::asio::thread_pool *pool, size_t window)
+    : ParallelPipe(next, [] (bufferlist& in, uint64_t offset, bufferlist& out) {
+                     std::string s = in.to_str();
+                     if (s.find('x') != s.npos) {
+                       return -EIO;
+                     }
+                     for (auto& c : s) {
+                       c = toupper(c);
+                     }
+                     out.append(s);
+                     return 0;
+                   }, pool, window)
+  {}
+
+  int process(bufferlist&& data, uint64_t offset) override {
+    if (data.length() == 0) {
+      int r = drain();
+      if (r < 0) {
+        return r;
+      }
+      return Pipe::process({}, offset);
+    }
+    return submit(std::move(data), offset);
+  }
+};
+
+TEST(PutObj_Parallel, Sync)
+{
+  MockProcessor mock;
+  UpperPipe pipe(&mock, nullptr, 2);
+
+  ASSERT_EQ(0, pipe.process(string_buf("ab"), 0));
+  ASSERT_EQ(1u, mock.ops.size()); // no pool, done as submitted
+  EXPECT_EQ(Op({"AB", 0}), mock.ops[0]);
+  ASSERT_EQ(-EIO, pipe.process(string_buf("xy"), 2));
+}
+
+TEST(PutObj_Parallel, InOrder)
+{
+  boost::asio::thread_pool pool(4);
+  MockProcessor mock;
+  UpperPipe pipe(&mock, &pool, 3);
+
+  const char* chunks[] = {"aa", "bb", "cc", "dd", "ee", "ff", "gg"};
+  uint64_t offset = 0;
+  for (auto chunk : chunks) {
+    ASSERT_EQ(0, pipe.process(string_buf(chunk), offset));
+    offset += strlen(chunk);
+    ASSERT_GE(mock.ops.size() + 3, offset / 2); // at most 3 in flight
+  }
+  ASSERT_EQ(0, pipe.process({}, offset)); // flush
+  ASSERT_EQ(8u, mock.ops.size());
+  EXPECT_EQ(Op({"AA", 0}), mock.ops[0]);
+  EXPECT_EQ(Op({"BB", 2}), mock.ops[1]);
+  EXPECT_EQ(Op({"CC", 4}), mock.ops[2]);
+  EXPECT_EQ(Op({"DD", 6}), mock.ops[3]);
+  EXPECT_EQ(Op({"EE", 8}), mock.ops[4]);
+  EXPECT_EQ(Op({"FF", 10}), mock.ops[5]);
+  EXPECT_EQ(Op({"GG", 12}), mock.ops[6]);
+  EXPECT_EQ(Op({"", 14}), mock.ops[7]);
+}
+
+TEST(PutObj_Parallel, Error)
+{
+  boost::asio::thread_pool pool(2);
+  MockProcessor mock;
+  UpperPipe pipe(&mock, &pool, 4);
+
+  ASSERT_EQ(0, pipe.process(string_buf("aa"), 0));
+  int r = pipe.process(string_buf("xx"), 2);
+  if (r == 0) {
+    r = pipe.process(string_buf("bb"), 4);
+  }
+  if (r == 0) {
+    r = pipe.process({}, 6);
+  }
+  ASSERT_EQ(-EIO, r);
+  ASSERT_EQ(1u, mock.ops.size()); // nothing passed on past the error
+  EXPECT_EQ(Op({"AA", 0}), mock.ops[0]);
+}
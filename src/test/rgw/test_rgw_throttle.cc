@@ -217,4 +217,40 @@ TEST_F(Aio_Throttle, YieldingThrottleOverMax)
 }
 #endif // HAVE_BOOST_CONTEXT
 
+TEST(ReadWindow, NoGrowthOnShortWaits)
+{
+  using namespace std::chrono_literals;
+  ReadWindow window(4, 64, 1ms);
+  // a client that drains slowly only ever waits briefly, if at all
+  for (int i = 0; i < 16; i++) {
+    window.waited(0ms);
+    window.waited(999us);
+  }
+  EXPECT_EQ(4u, window.size());
+}
+
+TEST(ReadWindow, DoubleUpToMax)
+{
+  using namespace std::chrono_literals;
+  ReadWindow window(4, 24, 1ms);
+  EXPECT_EQ(24u, window.max_size());
+  window.waited(1ms);
+  EXPECT_EQ(8u, window.size());
+  window.waited(10ms);
+  EXPECT_EQ(16u, window.size());
+  window.waited(1ms);
+  EXPECT_EQ(24u, window.size());
+  window.waited(1s);
+  EXPECT_EQ(24u, window.size());
+}
+
+TEST(ReadWindow, FixedWithoutLargerMax)
+{
+  using namespace std::chrono_literals;
+  ReadWindow window(16, 8, 1ms);
+  EXPECT_EQ(16u, window.max_size());
+  window.waited(1s);
+  EXPECT_EQ(16u, window.size());
+}
+
 } // namespace rgw
@@ -8,6 +8,8 @@
 #include "common/ceph_context.h"
 #include "global/global_context.h"
 #include "auth/AuthRegistry.h"
+#include "auth/cephx/CephxProtocol.h"
+#include "common/Clock.h"
 
 #include <sstream>
 
@@ -243,3 +245,45 @@ TEST(AuthRegistry, con_modes)
   // back to normalish, for the benefit of the next test(s)
   cct->_set_module_type(CEPH_ENTITY_TYPE_CLIENT);  
 }
+
+TEST(CephXServiceTicketCache, find)
+{
+  CephXServiceTicketCache cache;
+  const utime_t now = ceph_clock_now();
+
+  CephXTicketBlob ticket;
+  ticket.secret_id = 3;
+  ticket.blob.append("encrypted ticket");
+  CephXServiceTicketInfo info;
+  info.ticket.global_id = 42;
+  info.ticket.init_timestamps(now, 60);
+
+  CephXServiceTicketInfo found;
+  ASSERT_FALSE(cache.find(CEPH_ENTITY_TYPE_OSD, ticket, now, &found));
+  cache.add(CEPH_ENTITY_TYPE_OSD, ticket, info, now, 600, 16);
+  ASSERT_TRUE(cache.find(CEPH_ENTITY_TYPE_OSD, ticket, now, &found));
+  ASSERT_EQ(42u, found.ticket.global_id);
+
+  // only the very same ticket, for the same service, matches
+  ASSERT_FALSE(cache.find(CEPH_ENTITY_TYPE_MDS, ticket, now, &found));
+  CephXTicketBlob other = ticket;
+  other.secret_id = 4;
+  ASSERT_FALSE(cache.find(CEPH_ENTITY_TYPE_OSD, other, now, &found));
+  other = ticket;
+  other.blob.append("x");
+  ASSERT_FALSE(cache.find(CEPH_ENTITY_TYPE_OSD, other, now, &found));
+
+  // never past the ticket's expiration, even with a longer ttl
+  ASSERT_FALSE(cache.find(CEPH_ENTITY_TYPE_OSD, ticket, now + utime_t(61, 0),
+			  &found));
+
+  // nor past the ttl
+  cache.add(CEPH_ENTITY_TYPE_OSD, ticket, info, now, 10, 16);
+  ASSERT_FALSE(cache.find(CEPH_ENTITY_TYPE_OSD, ticket, now + utime_t(11, 0),
+			  &found));
+
+  // a size of 0 disables it
+  CephXServiceTicketCache disabled;
+  disabled.add(CEPH_ENTITY_TYPE_OSD, ticket, info, now, 600, 0);
+  ASSERT_FALSE(disabled.find(CEPH_ENTITY_TYPE_OSD, ticket, now, &found));
+}
@@ -267,6 +267,39 @@ TEST(denc, vector)
   }
 }
 
+TEST(denc, vector_of_ints)
+{
+  // copied in bulk, but encoded as the list of the same ints is
+  std::vector<int64_t> v;
+  std::list<int64_t> l;
+  for (int64_t i = -500; i < 500; i++) {
+    v.push_back(i * 0x10001);
+    l.push_back(i * 0x10001);
+  }
+  test_denc(v);
+  bufferlist vbl, lbl;
+  encode(v, vbl);
+  encode(l, lbl);
+  ASSERT_TRUE(vbl.contents_equal(lbl));
+
+  // a segmented buffer, decoded into a vector that isn't empty
+  bufferlist bl;
+  bl.append(vbl.c_str(), 100);
+  bl.append(vbl.c_str() + 100, vbl.length() - 100);
+  std::vector<int64_t> out(3, 42);
+  auto p = bl.cbegin();
+  decode(out, p);
+  ASSERT_EQ(v, out);
+
+  // a truncated one
+  bufferlist truncated;
+  truncated.substr_of(vbl, 0, vbl.length() - 1);
+  p = truncated.cbegin();
+  ASSERT_THROW(decode(out, p), buffer::end_of_buffer);
+  auto bpi = truncated.front().begin();
+  ASSERT_THROW(denc(out, bpi), buffer::end_of_buffer);
+}
+
 template<typename T>
 using default_list = std::list<T>;
 
@@ -281,3 +281,44 @@ TEST(PageSet, FreeHoles)
   pages.get_range(0, 8, range);
   ASSERT_EQ(0u, range.size());
 }
+
+TEST(PageSet, AllocShared)
+{
+  PageSet pages(2);
+  PageSet::page_vector range;
+  pages.alloc_range(0, 4, range);
+  std::fill(range[0]->data, range[0]->data + 2, 'a');
+  std::fill(range[1]->data, range[1]->data + 2, 'b');
+  range.clear();
+
+  // hold a ref to the first page, as a read would
+  PageSet::page_vector held;
+  pages.get_range(0, 2, held);
+  ASSERT_EQ(1u, held.size());
+  Page *first = held[0].get();
+
+  // writing to it gets a copy, the reader's page doesn't change
+  pages.alloc_range(0, 4, range);
+  ASSERT_EQ(2u, range.size());
+  ASSERT_NE(first, range[0].get());
+  ASSERT_EQ('a', range[0]->data[1]);
+  range[0]->data[1] = 'c';
+  ASSERT_EQ('a', held[0]->data[1]);
+  Page *second = range[1].get();
+  range.clear();
+
+  // the copy replaced it in the set, and the unshared page stayed
+  pages.get_range(0, 4, range);
+  ASSERT_EQ(2u, range.size());
+  ASSERT_EQ('c', range[0]->data[1]);
+  ASSERT_EQ(second, range[1].get());
+  range.clear();
+
+  // once unshared, it's written in place
+  held.clear();
+  pages.get_range(0, 2, held);
+  first = held[0].get();
+  held.clear();
+  pages.alloc_range(0, 2, range);
+  ASSERT_EQ(first, range[0].get());
+}
@@ -70,3 +70,57 @@ TEST(Striper, GetNumObj)
   numobjs = Striper::get_num_objects(l, size);
   ASSERT_EQ(6u, numobjs);
 }
+
+TEST(Striper, ExtentsMatchMap)
+{
+  file_layout_t l;
+  l.object_size = 1 << 20;
+  l.pool_id = 3;
+
+  for (auto su : {4096u, 65536u, 1u << 20}) {
+    for (auto sc : {1u, 3u, 16u}) {
+      l.stripe_unit = su;
+      l.stripe_count = sc;
+      for (auto off : {0ull, 1234ull, 5ull << 20, 123456789ull}) {
+	for (auto len : {1ull, 4096ull, 100000ull, 9ull << 20}) {
+	  std::map<object_t, std::vector<ObjectExtent> > m;
+	  Striper::file_to_extents(g_ceph_context, "foo.%016llx", &l,
+				   off, len, off + len / 2, m, 7);
+	  std::vector<ObjectExtent> expected;
+	  Striper::assimilate_extents(m, expected);
+
+	  std::vector<ObjectExtent> ex;
+	  Striper::file_to_extents(g_ceph_context, "foo.%016llx", &l,
+				   off, len, off + len / 2, ex, 7);
+	  ASSERT_EQ(expected.size(), ex.size());
+	  for (size_t i = 0; i < ex.size(); ++i) {
+	    ASSERT_EQ(expected[i].oid, ex[i].oid);
+	    ASSERT_EQ(expected[i].objectno, ex[i].objectno);
+	    ASSERT_EQ(expected[i].offset, ex[i].offset);
+	    ASSERT_EQ(expected[i].length, ex[i].length);
+	    ASSERT_EQ(expected[i].truncate_size, ex[i].truncate_size);
+	    ASSERT_EQ(expected[i].oloc, ex[i].oloc);
+	    ASSERT_EQ(expected[i].buffer_extents, ex[i].buffer_extents);
+	  }
+	}
+      }
+    }
+  }
+}
+
+TEST(Striper, ExtentsAppend)
+{
+  file_layout_t l;
+  l.object_size = 262144;
+  l.stripe_unit = 4096;
+  l.stripe_count = 3;
+
+  vector<ObjectExtent> ex;
+  Striper::file_to_extents(g_ceph_context, 1, &l, 0, 4096, 0, ex);
+  ASSERT_EQ(1u, ex.size());
+  Striper::file_to_extents(g_ceph_context, 1, &l, 4096, 8192, 0, ex);
+  ASSERT_EQ(3u, ex.size());
+  ASSERT_EQ(0u, ex[0].objectno);
+  ASSERT_EQ(1u, ex[1].objectno);
+  ASSERT_EQ(2u, ex[2].objectno);
+}
@@ -379,19 +379,20 @@ class RadosDump
       int write_section(sectiontype_t type, const T& obj, int fd) {
         if (dry_run)
           return 0;
-        bufferlist blhdr, bl, blftr;
+        bufferlist bl;
+        write_section(type, obj, &bl);
+        return bl.write_fd(fd);
+      }
+    // append the section to a buffer instead, to be written out later
+    template <typename T>
+      void write_section(sectiontype_t type, const T& obj, bufferlist *out) {
+        bufferlist bl;
         obj.encode(bl);
         header hdr(type, bl.length());
-        hdr.encode(blhdr);
+        hdr.encode(*out);
+        out->claim_append(bl);
         footer ft;
-        ft.encode(blftr);
-
-        int ret = blhdr.write_fd(fd);
-        if (ret) return ret;
-        ret = bl.write_fd(fd);
-        if (ret) return ret;
-        ret = blftr.write_fd(fd);
-        return ret;
+        ft.encode(*out);
       }
 
     int write_simple(sectiontype_t type, int fd)
@@ -399,11 +400,14 @@ class RadosDump
       if (dry_run)
         return 0;
       bufferlist hbl;
-
-      header hdr(type, 0);
-      hdr.encode(hbl);
+      write_simple(type, &hbl);
       return hbl.write_fd(fd);
     }
+    void write_simple(sectiontype_t type, bufferlist *out)
+    {
+      header hdr(type, 0);
+      hdr.encode(*out);
+    }
 };
 
 #endif
@@ -19,6 +19,7 @@
 #include "include/encoding.h"
 #include "include/ceph_features.h"
 #include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
 #include "common/Formatter.h"
 #include "common/errno.h"
 #include "msg/Message.h"
@@ -72,6 +73,8 @@ void usage(ostream &out)
   out << "  count_tests         print number of generated test objects (to stdout)\n";
   out << "  select_test <n>     select generated test object as in-memory object\n";
   out << "  is_deterministic    exit w/ success if type encodes deterministically\n";
+  out << "  bench <num>         time <num> decodes of the encoded data and encodes\n"
+      << "                      of the resulting object (to stdout)\n";
 }
 struct Dencoder {
   virtual ~Dencoder() {}
@@ -458,6 +461,39 @@ int main(int argc, const char **argv)
       }
       int n = atoi(*i);
       err = den->select_generated(n);
+    } else if (*i == string("bench")) {
+      if (!den) {
+	cerr << "must first select type with 'type <name>'" << std::endl;
+	exit(1);
+      }
+      ++i;
+      if (i == args.end()) {
+	cerr << "expecting iteration count" << std::endl;
+	exit(1);
+      }
+      int n = atoi(*i);
+      if (n <= 0) {
+	cerr << "expecting a positive iteration count" << std::endl;
+	exit(1);
+      }
+      auto start = ceph::mono_clock::now();
+      for (int k = 0; k < n && err.empty(); k++) {
+	err = den->decode(encbl, skip);
+      }
+      auto decoded = ceph::mono_clock::now();
+      for (int k = 0; k < n && err.empty(); k++) {
+	bufferlist bl;
+	den->encode(bl, features | CEPH_FEATURE_RESERVED);
+      }
+      auto encoded = ceph::mono_clock::now();
+      if (err.empty()) {
+	using std::chrono::nanoseconds;
+	cout << "decode " << std::chrono::duration_cast<nanoseconds>(
+		  decoded - start).count() / n << " ns/op, "
+	     << "encode " << std::chrono::duration_cast<nanoseconds>(
+		  encoded - decoded).count() / n << " ns/op, "
+	     << encbl.length() << " bytes" << std::endl;
+      }
     } else if (*i == string("is_deterministic")) {
       if (!den) {
 	cerr << "must first select type with 'type <name>'" << std::endl;
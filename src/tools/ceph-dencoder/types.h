@@ -118,6 +118,8 @@ TYPE(ScrubMap)
 TYPE_FEATUREFUL(obj_list_watch_response_t)
 TYPE(clone_info)
 TYPE(obj_list_snap_response_t)
+TYPE(pg_omap_read_t)
+TYPE(pg_omap_read_result_t)
 TYPE(pool_pg_num_history_t)
 
 #include "osd/ECUtil.h"
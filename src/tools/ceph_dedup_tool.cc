@@ -45,6 +45,7 @@
 #include "include/stringify.h"
 #include "global/signal_handler.h"
 #include "common/rabin.h"
+#include "common/CDC.h"
 
 using namespace librados;
 unsigned default_op_size = 1 << 22;
@@ -58,13 +59,15 @@ void usage()
   cout << " usage: [--op <estimate|chunk_scrub|add_chunk_ref|get_chunk_ref>] [--pool <pool_name> ] " << std::endl;
   cout << "   --object <object_name> " << std::endl;
   cout << "   --chunk-size <size> chunk-size (byte) " << std::endl;
-  cout << "   --chunk-algorithm <fixed|rabin> " << std::endl;
+  cout << "   --chunk-algorithm <fixed|rabin|fastcdc> " << std::endl;
   cout << "   --fingerprint-algorithm <sha1> " << std::endl;
   cout << "   --chunk-pool <pool name> " << std::endl;
   cout << "   --max-thread <threads> " << std::endl;
   cout << "   --report-perioid <seconds> " << std::endl;
   cout << "   --max-read-size <bytes> " << std::endl;
   cout << std::endl;
+  cout << "   ***fastcdc cuts chunks of --chunk-size (rounded to a power of 2) on average*** " << std::endl;
+  cout << std::endl;
   cout << "   ***these options are for rabin chunk*** " << std::endl;
   cout << "   **rabin_hash = (rabin_hash * rabin_prime + new_byte - old_byte * pow) % (mod_prime) ** " << std::endl;
   cout << "   **default_chunk_mask = 7 ** " << std::endl;
@@ -148,13 +151,18 @@ class EstimateDedupRatio : public EstimateThread
   uint64_t chunk_size;
   map< string, pair <uint64_t, uint64_t> > local_chunk_statistics; // < key, <count, chunk_size> >
   RabinChunk rabin;
+  std::unique_ptr<CDC> cdc;
 
 public:
   EstimateDedupRatio(IoCtx& io_ctx, int n, int m, ObjectCursor begin, ObjectCursor end, 
 		string chunk_algo, string fp_algo, uint64_t chunk_size, int32_t timeout,
 		uint64_t num_objects, uint64_t max_read_size):
     EstimateThread(io_ctx, n, m, begin, end, timeout, num_objects, max_read_size), 
-		chunk_algo(chunk_algo), fp_algo(fp_algo), chunk_size(chunk_size) { }
+		chunk_algo(chunk_algo), fp_algo(fp_algo), chunk_size(chunk_size) {
+    if (chunk_algo == "fastcdc") {
+      cdc = CDC::create(chunk_algo, cbits(chunk_size) - 1);
+    }
+  }
 
   void* entry() {
     estimate_dedup_ratio();
@@ -165,6 +173,7 @@ public:
   map< string, pair <uint64_t, uint64_t> > &get_chunk_statistics() { return local_chunk_statistics; }
   uint64_t fixed_chunk(string oid, uint64_t offset);
   uint64_t rabin_chunk(string oid, uint64_t offset);
+  uint64_t cdc_chunk(string oid, uint64_t offset);
   void add_chunk_fp_to_stat(bufferlist &chunk);
   void set_rabin_options(uint64_t mod_prime, uint32_t rabin_prime, uint64_t pow, 
 			 uint64_t chunk_mask_bit, uint32_t window_size, uint32_t min_chunk, 
@@ -312,6 +321,8 @@ void EstimateDedupRatio::estimate_dedup_ratio()
 	  next_offset = fixed_chunk(oid, offset);
 	} else if (chunk_algo == "rabin") {
 	  next_offset = rabin_chunk(oid, offset);
+	} else if (chunk_algo == "fastcdc") {
+	  next_offset = cdc_chunk(oid, offset);
 	} else {
 	  ceph_assert(0 == "no support chunk algorithm"); 
 	}
@@ -417,6 +428,30 @@ uint64_t EstimateDedupRatio::rabin_chunk(string oid, uint64_t offset)
   return outdata.length();
 }
 
+uint64_t EstimateDedupRatio::cdc_chunk(string oid, uint64_t offset)
+{
+  unsigned op_size = max_read_size;
+  int ret;
+  bufferlist outdata;
+  ret = io_ctx.read(oid, outdata, op_size, offset);
+  if (ret <= 0) {
+    return 0;
+  }
+
+  vector<pair<uint64_t, uint64_t>> chunks;
+  cdc->calc_chunks(outdata, &chunks);
+  for (auto p : chunks) {
+    bufferlist chunk;
+    chunk.substr_of(outdata, p.first, p.second);
+    add_chunk_fp_to_stat(chunk);
+  }
+
+  if (outdata.length() < op_size) {
+    return 0;
+  }
+  return outdata.length();
+}
+
 void EstimateDedupRatio::set_rabin_options(uint64_t mod_prime, uint32_t rabin_prime, uint64_t pow, 
 					  uint64_t chunk_mask_bit, uint32_t window_size, 
 					  uint32_t min_chunk, uint64_t max_chunk) 
@@ -559,7 +594,8 @@ int estimate_dedup_ratio(const std::map < std::string, std::string > &opts,
   i = opts.find("chunk-algorithm");
   if (i != opts.end()) {
     chunk_algo = i->second.c_str();
-    if (chunk_algo != "fixed" && chunk_algo != "rabin") {
+    if (chunk_algo != "fixed" && chunk_algo != "rabin" &&
+	chunk_algo != "fastcdc") {
       usage_exit();
     }
   } else {
@@ -581,6 +617,12 @@ int estimate_dedup_ratio(const std::map < std::string, std::string > &opts,
     if (rados_sistrtoll(i, &chunk_size)) {
       return -EINVAL;
     }
+    if (chunk_algo == "fastcdc" &&
+	(chunk_size < 64 || chunk_size > (1ull << CDC::MAX_BITS))) {
+      cerr << "chunk size must be between 64 and " << (1ull << CDC::MAX_BITS)
+	   << " with fastcdc" << std::endl;
+      return -EINVAL;
+    }
   } else {
     if (chunk_algo != "rabin") {
       usage_exit();
@@ -26,6 +26,7 @@
 #include "include/stringify.h"
 #include "mgr/mgr_commands.h"
 #include "mon/AuthMonitor.h"
+#include "mon/FullMapCompression.h"
 #include "mon/MonitorDBStore.h"
 #include "mon/Paxos.h"
 #include "mon/MonMap.h"
@@ -234,6 +235,17 @@ void usage(const char *n, po::options_description &d)
     << std::endl;
 }
 
+// read a full osdmap, decompressing it if the mon compressed it
+static int get_full_osdmap(MonitorDBStore& store, version_t ver,
+			   bufferlist& bl)
+{
+  int r = store.get("osdmap", store.combine_strings("full", ver), bl);
+  if (r < 0) {
+    return r;
+  }
+  return decompress_full_map(g_ceph_context, bl);
+}
+
 int update_osdmap(MonitorDBStore& store, version_t ver, bool copy,
 		  std::shared_ptr<CrushWrapper> crush,
 		  MonitorDBStore::Transaction* t) {
@@ -242,7 +254,7 @@ int update_osdmap(MonitorDBStore& store, version_t ver, bool copy,
   // full
   bufferlist bl;
   int r = 0;
-  r = store.get(prefix, store.combine_strings("full", ver), bl);
+  r = get_full_osdmap(store, ver, bl);
   if (r) {
     std::cerr << "Error getting full map: " << cpp_strerror(r) << std::endl;
     return r;
@@ -255,7 +267,10 @@ int update_osdmap(MonitorDBStore& store, version_t ver, bool copy,
   }
   bl.clear();
   // be consistent with OSDMonitor::update_from_paxos()
-  osdmap.encode(bl, CEPH_FEATURES_ALL|CEPH_FEATURE_RESERVED);
+  r = osdmap.encode(bl, CEPH_FEATURES_ALL|CEPH_FEATURE_RESERVED);
+  if (r < 0) {
+    return r;
+  }
   t->put(prefix, store.combine_strings("full", osdmap.get_epoch()), bl);
 
   // incremental
@@ -321,7 +336,7 @@ int rewrite_transaction(MonitorDBStore& store, int version,
   std::shared_ptr<CrushWrapper> crush(new CrushWrapper);
   if (crush_file.empty()) {
     bufferlist bl;
-    r = store.get(prefix, store.combine_strings("full", good_version), bl);
+    r = get_full_osdmap(store, good_version, bl);
     if (r) {
       std::cerr << "Error getting map: " << cpp_strerror(r) << std::endl;
       return r;
@@ -557,7 +572,7 @@ static int update_creating_pgs(MonitorDBStore& st)
 {
   bufferlist bl;
   auto last_osdmap_epoch = st.get("osdmap", "last_committed");
-  int r = st.get("osdmap", st.combine_strings("full", last_osdmap_epoch), bl);
+  int r = get_full_osdmap(st, last_osdmap_epoch, bl);
   if (r < 0) {
     cerr << "unable to load osdmap e" << last_osdmap_epoch << std::endl;
     return r;
@@ -870,10 +885,10 @@ int main(int argc, char **argv) {
     bufferlist bl;
     r = 0;
     if (map_type == "osdmap") {
-      r = st.get(map_type, st.combine_strings("full", v), bl);
+      r = get_full_osdmap(st, v, bl);
     } else if (map_type == "crushmap") {
       bufferlist tmp;
-      r = st.get("osdmap", st.combine_strings("full", v), tmp);
+      r = get_full_osdmap(st, v, tmp);
       if (r >= 0) {
         OSDMap osdmap;
         osdmap.decode(tmp);
@@ -18,6 +18,8 @@
 #include <boost/optional.hpp>
 
 #include <stdlib.h>
+#include <atomic>
+#include <thread>
 
 #include "common/Formatter.h"
 #include "common/errno.h"
@@ -71,6 +73,14 @@ CompatSet get_test_compat_set() {
 #endif
 
 const ssize_t max_read = 1024 * 1024;
+// an import transaction of this many bytes is queued even if it has
+// fewer than import_batch_size objects
+const uint64_t max_import_batch_bytes = 64 * 1024 * 1024;
+// the objects read for an export window hold no more than this much
+// data between them, unless a single object does
+const uint64_t max_export_window_bytes = 64 * 1024 * 1024;
+unsigned export_threads = 1;
+unsigned import_batch_size = 1;
 const int fd_none = INT_MIN;
 bool outistty;
 bool dry_run;
@@ -615,19 +625,26 @@ void get_omap_batch(ObjectMap::ObjectMapIterator &iter, map<string, bufferlist>
   }
 }
 
-int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj)
+int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid,
+				 const ghobject_t &obj, bufferlist *out, int fd)
 {
   struct stat st;
   mysize_t total;
   footer ft;
 
+  auto flush = [this, out, fd]() {
+    if (fd == fd_none)
+      return 0;
+    int r = dry_run ? 0 : out->write_fd(fd);
+    out->clear();
+    return r;
+  };
+
   auto ch = store->open_collection(cid);
   int ret = store->stat(ch, obj, &st);
   if (ret < 0)
     return ret;
 
-  cerr << "Read " << obj << std::endl;
-
   total = st.st_size;
   if (debug)
     cerr << "size=" << total << std::endl;
@@ -650,8 +667,9 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
 
   // NOTE: we include whiteouts, lost, etc.
 
-  ret = write_section(TYPE_OBJECT_BEGIN, objb, file_fd);
-  if (ret < 0)
+  write_section(TYPE_OBJECT_BEGIN, objb, out);
+  ret = flush();
+  if (ret)
     return ret;
 
   uint64_t offset = 0;
@@ -675,8 +693,10 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
     total -= ret;
     offset += ret;
 
-    ret = write_section(TYPE_DATA, dblock, file_fd);
-    if (ret) return ret;
+    write_section(TYPE_DATA, dblock, out);
+    ret = flush();
+    if (ret)
+      return ret;
   }
 
   //Handle attrs for this object
@@ -684,9 +704,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   ret = store->getattrs(ch, obj, aset);
   if (ret) return ret;
   attr_section as(aset);
-  ret = write_section(TYPE_ATTRS, as, file_fd);
-  if (ret)
-    return ret;
+  write_section(TYPE_ATTRS, as, out);
 
   if (debug) {
     cerr << "attrs size " << aset.size() << std::endl;
@@ -701,9 +719,7 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
 
   omap_hdr_section ohs(hdrbuf);
-  ret = write_section(TYPE_OMAP_HDR, ohs, file_fd);
-  if (ret)
-    return ret;
+  write_section(TYPE_OMAP_HDR, ohs, out);
 
   ObjectMap::ObjectMapIterator iter = store->get_omap_iterator(ch, obj);
   if (!iter) {
@@ -713,26 +729,24 @@ int ObjectStoreTool::export_file(ObjectStore *store, coll_t cid, ghobject_t &obj
   }
   iter->seek_to_first();
   int mapcount = 0;
-  map<string, bufferlist> out;
+  map<string, bufferlist> oset;
   while(iter->valid()) {
-    get_omap_batch(iter, out);
+    get_omap_batch(iter, oset);
 
-    if (out.empty()) break;
+    if (oset.empty()) break;
 
-    mapcount += out.size();
-    omap_section oms(out);
-    ret = write_section(TYPE_OMAP, oms, file_fd);
+    mapcount += oset.size();
+    omap_section oms(oset);
+    write_section(TYPE_OMAP, oms, out);
+    ret = flush();
     if (ret)
       return ret;
   }
   if (debug)
     cerr << "omap map size " << mapcount << std::endl;
 
-  ret = write_simple(TYPE_OBJECT_END, file_fd);
-  if (ret)
-    return ret;
-
-  return 0;
+  write_simple(TYPE_OBJECT_END, out);
+  return flush();
 }
 
 int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
@@ -745,16 +759,69 @@ int ObjectStoreTool::export_files(ObjectStore *store, coll_t coll)
       &objects, &next);
     if (r < 0)
       return r;
-    for (vector<ghobject_t>::iterator i = objects.begin();
-	 i != objects.end();
-	 ++i) {
-      ceph_assert(!i->hobj.is_meta());
-      if (i->is_pgmeta() || i->hobj.is_temp() || !i->is_no_gen()) {
-	continue;
+    objects.erase(
+      std::remove_if(objects.begin(), objects.end(),
+		     [](const ghobject_t& o) {
+		       ceph_assert(!o.hobj.is_meta());
+		       return o.is_pgmeta() || o.hobj.is_temp() || !o.is_no_gen();
+		     }),
+      objects.end());
+
+    if (export_threads == 1) {
+      // stream each object out as it is read
+      for (auto& obj : objects) {
+	cerr << "Read " << obj << std::endl;
+	bufferlist out;
+	r = export_file(store, coll, obj, &out, file_fd);
+	if (r)
+	  return r;
+      }
+      continue;
+    }
+
+    // read a window of objects with export_threads threads, then write
+    // them out in order. the window is up to 4 objects a thread, and
+    // max_export_window_bytes of data
+    const size_t window = export_threads * 4;
+    size_t n = 0;
+    for (size_t first = 0; first < objects.size(); first += n) {
+      uint64_t bytes = 0;
+      for (n = 0; n < window && first + n < objects.size(); n++) {
+	struct stat st;
+	uint64_t size = 0;
+	if (store->stat(ch, objects[first + n], &st) == 0)
+	  size = st.st_size;
+	if (n && bytes + size > max_export_window_bytes)
+	  break;
+	bytes += size;
+      }
+      vector<bufferlist> out(n);
+      vector<int> rets(n, 0);
+      std::atomic<size_t> next_read = {0};
+      auto reader = [&]() {
+	for (size_t k = next_read++; k < n; k = next_read++) {
+	  rets[k] = export_file(store, coll, objects[first + k], &out[k],
+				fd_none);
+	}
+      };
+      vector<std::thread> readers;
+      for (unsigned k = 1; k < std::min<size_t>(export_threads, n); k++) {
+	readers.emplace_back(reader);
+      }
+      reader();
+      for (auto& t : readers) {
+	t.join();
+      }
+      for (size_t k = 0; k < n; k++) {
+	if (rets[k] < 0)
+	  return rets[k];
+	cerr << "Read " << objects[first + k] << std::endl;
+	if (!dry_run) {
+	  r = out[k].write_fd(file_fd);
+	  if (r)
+	    return r;
+	}
       }
-      r = export_file(store, coll, *i);
-      if (r < 0)
-        return r;
     }
   }
   return 0;
@@ -1018,7 +1085,8 @@ int dump_attrs(
 int get_attrs(
   ObjectStore *store, coll_t coll, ghobject_t hoid,
   ObjectStore::Transaction *t, bufferlist &bl,
-  OSDriver &driver, SnapMapper &snap_mapper)
+  OSDriver &driver, SnapMapper &snap_mapper,
+  const set<ghobject_t> &batched)
 {
   auto ebliter = bl.cbegin();
   attr_section as;
@@ -1043,10 +1111,10 @@ int get_attrs(
 	ghobject_t clone = hoid;
 	clone.hobj.snap = p.first;
 	set<snapid_t> snaps(p.second.begin(), p.second.end());
-	if (!store->exists(ch, clone)) {
+	if (!batched.count(clone) && !store->exists(ch, clone)) {
 	  // no clone, skip.  this is probably a cache pool.  this works
-	  // because we use a separate transaction per object and clones
-	  // come before head in the archive.
+	  // because clones come before head in the archive, and are either
+	  // in the store already or in the batch the head is added to.
 	  if (debug)
 	    cerr << "\tskipping missing " << clone << " (snaps "
 		 << snaps << ")" << std::endl;
@@ -1201,10 +1269,10 @@ int ObjectStoreTool::get_object(ObjectStore *store,
 				SnapMapper& mapper,
 				coll_t coll,
 				bufferlist &bl, OSDMap &origmap,
-				bool *skipped_objects)
+				bool *skipped_objects,
+				ObjectStore::Transaction *t,
+				set<ghobject_t> *batched)
 {
-  ObjectStore::Transaction tran;
-  ObjectStore::Transaction *t = &tran;
   auto ebliter = bl.cbegin();
   object_begin ob;
   ob.decode(ebliter);
@@ -1215,7 +1283,6 @@ int ObjectStoreTool::get_object(ObjectStore *store,
   }
   ceph_assert(g_ceph_context);
 
-  auto ch = store->open_collection(coll);
   if (ob.hoid.hobj.nspace != g_ceph_context->_conf->osd_hit_set_namespace) {
     object_t oid = ob.hoid.hobj.oid;
     object_locator_t loc(ob.hoid.hobj);
@@ -1268,7 +1335,7 @@ int ObjectStoreTool::get_object(ObjectStore *store,
       break;
     case TYPE_ATTRS:
       if (dry_run) break;
-      ret = get_attrs(store, coll, ob.hoid, t, ebl, driver, mapper);
+      ret = get_attrs(store, coll, ob.hoid, t, ebl, driver, mapper, *batched);
       if (ret) return ret;
       break;
     case TYPE_OMAP_HDR:
@@ -1289,12 +1356,8 @@ int ObjectStoreTool::get_object(ObjectStore *store,
       return -EFAULT;
     }
   }
-  if (!dry_run) {
-    wait_until_done(t, [&] {
-      store->queue_transaction(ch, std::move(*t));
-      ch->flush();
-    });
-  }
+  if (!dry_run)
+    batched->insert(ob.hoid);
   return 0;
 }
 
@@ -1675,6 +1738,20 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
   cout << "Importing pgid " << pgid;
   cout << std::endl;
 
+  // the objects are queued import_batch_size at a time
+  ObjectStore::Transaction objects_t;
+  set<ghobject_t> batched;
+  auto queue_objects = [&] {
+    if (batched.empty())
+      return;
+    wait_until_done(&objects_t, [&] {
+      store->queue_transaction(ch, std::move(objects_t));
+      ch->flush();
+    });
+    objects_t = ObjectStore::Transaction();
+    batched.clear();
+  };
+
   bool done = false;
   bool found_metadata = false;
   metadata_section ms;
@@ -1694,8 +1771,11 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
     case TYPE_OBJECT_BEGIN:
       ceph_assert(found_metadata);
       ret = get_object(store, driver, mapper, coll, ebl, ms.osdmap,
-		       &skipped_objects);
+		       &skipped_objects, &objects_t, &batched);
       if (ret) return ret;
+      if (batched.size() >= import_batch_size ||
+	  objects_t.get_num_bytes() >= max_import_batch_bytes)
+	queue_objects();
       break;
     case TYPE_PG_METADATA:
       ret = get_pg_metadata(store, ebl, ms, sb, pgid);
@@ -1787,6 +1867,7 @@ int ObjectStoreTool::do_import(ObjectStore *store, OSDSuperblock& sb,
     cerr << "Missing metadata section" << std::endl;
     return -EFAULT;
   }
+  queue_objects();
 
   ObjectStore::Transaction t;
   if (!dry_run) {
@@ -3103,6 +3184,10 @@ int main(int argc, char **argv)
     ("dry-run", "Don't modify the objectstore")
     ("namespace", po::value<string>(&argnspace), "Specify namespace when searching for objects")
     ("rmtype", po::value<string>(&rmtypestr), "Specify corrupting object removal 'snapmap' or 'nosnapmap' - TESTING USE ONLY")
+    ("export-threads", po::value<unsigned>(&export_threads)->default_value(1),
+     "Number of threads reading objects for export and export-remove")
+    ("import-batch-size", po::value<unsigned>(&import_batch_size)->default_value(1),
+     "Number of objects import writes to the objectstore in each transaction")
     ;
 
   po::options_description positional("Positional options");
@@ -3143,6 +3228,11 @@ int main(int argc, char **argv)
   if (op == "dump-import")
     op = "dump-export";
 
+  if (export_threads == 0 || import_batch_size == 0) {
+    cerr << "--export-threads and --import-batch-size must be at least 1" << std::endl;
+    return 1;
+  }
+
   debug = (vm.count("debug") > 0);
 
   force = (vm.count("force") > 0);
@@ -35,9 +35,13 @@ class ObjectStoreTool : public RadosDump
 				bufferlist &bl);
     int get_object(
       ObjectStore *store, OSDriver& driver, SnapMapper& mapper, coll_t coll,
-      bufferlist &bl, OSDMap &curmap, bool *skipped_objects);
+      bufferlist &bl, OSDMap &curmap, bool *skipped_objects,
+      ObjectStore::Transaction *t, std::set<ghobject_t> *batched);
+    // with an fd, out is written to it a section at a time; without,
+    // out gets the whole object
     int export_file(
-        ObjectStore *store, coll_t cid, ghobject_t &obj);
+        ObjectStore *store, coll_t cid, const ghobject_t &obj,
+        bufferlist *out, int fd);
     int export_files(ObjectStore *store, coll_t coll);
 };
 
@@ -203,6 +203,7 @@ void usage()
   cout << "      [--num-rep n]\n";
   cout << "      [--pool-id n]      specifies pool id\n";
   cout << "      [--batches b]      split the CRUSH mapping into b > 1 rounds\n";
+  cout << "      [--threads n]      map the inputs with n threads\n";
   cout << "      [--weight|-w devno weight]\n";
   cout << "                         where weight is 0 to 1.0\n";
   cout << "      [--simulate]       simulate placements using a random\n";
@@ -215,6 +216,8 @@ void usage()
   cout << "   --show-mappings       show mappings\n";
   cout << "   --show-bad-mappings   show bad mappings\n";
   cout << "   --show-choose-tries   show choose tries histogram\n";
+  cout << "   --show-imbalance      show how far the rule's failure domains are\n";
+  cout << "                         from their expected share\n";
   cout << "   --output-name name\n";
   cout << "                         prepend the data file(s) generated during the\n";
   cout << "                         testing routine with name\n";
@@ -229,6 +232,7 @@ void usage()
   cout << "   --set-subtree-class <bucket-name> <class>\n";
   cout << "                         set class for all items beneath bucket-name\n";
   cout << "   --compare <otherfile> compare two maps using --test parameters\n";
+  cout << "      [--show-movement]  show the share of placements that move\n";
   cout << "\n";
   cout << "Options for the output stage\n";
   cout << "\n";
@@ -527,6 +531,11 @@ int main(int argc, const char **argv)
     } else if (ceph_argparse_flag(args, i, "--show_choose_tries", (char*)NULL)) {
       display = true;
       tester.set_output_choose_tries(true);
+    } else if (ceph_argparse_flag(args, i, "--show_imbalance", (char*)NULL)) {
+      display = true;
+      tester.set_output_imbalance(true);
+    } else if (ceph_argparse_flag(args, i, "--show_movement", (char*)NULL)) {
+      tester.set_output_movement(true);
     } else if (ceph_argparse_witharg(args, i, &val, "-c", "--compile", (char*)NULL)) {
       srcfn = val;
       compile = true;
@@ -795,6 +804,16 @@ int main(int argc, const char **argv)
 	return EXIT_FAILURE;
       }
       tester.set_batches(x);
+    } else if (ceph_argparse_witharg(args, i, &x, err, "--threads", (char*)NULL)) {
+      if (!err.str().empty()) {
+	cerr << err.str() << std::endl;
+	return EXIT_FAILURE;
+      }
+      if (x < 1) {
+	cerr << "--threads must be at least 1" << std::endl;
+	return EXIT_FAILURE;
+      }
+      tester.set_num_threads(x);
     } else if (ceph_argparse_witharg(args, i, &y, err, "--mark-down-ratio", (char*)NULL)) {
       if (!err.str().empty()) {
         cerr << err.str() << std::endl;
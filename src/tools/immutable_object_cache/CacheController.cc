@@ -72,7 +72,9 @@ void CacheController::run() {
 
     m_cache_server = new CacheServer(m_cct, controller_path,
       std::bind(&CacheController::handle_request, this,
-                std::placeholders::_1, std::placeholders::_2));
+                std::placeholders::_1, std::placeholders::_2),
+      std::bind(&CacheController::handle_close, this,
+                std::placeholders::_1));
 
     int ret = m_cache_server->run();
     if (ret != 0) {
@@ -103,7 +105,7 @@ void CacheController::handle_request(CacheSession* session,
         reinterpret_cast <ObjectCacheReadData*> (req);
       int ret = m_object_cache_store->lookup_object(
         req_read_data->pool_namespace, req_read_data->pool_id,
-        req_read_data->snap_id, req_read_data->oid, cache_path);
+        req_read_data->snap_id, req_read_data->oid, cache_path, session);
       ObjectCacheRequest* reply = nullptr;
       if (ret != OBJ_CACHE_PROMOTED) {
         reply = new ObjectCacheReadRadosData(RBDSC_READ_RADOS, req->seq);
@@ -120,5 +122,10 @@ void CacheController::handle_request(CacheSession* session,
   }
 }
 
+void CacheController::handle_close(CacheSession* session) {
+  ldout(m_cct, 20) << dendl;
+  m_object_cache_store->close_reader(session);
+}
+
 }  // namespace immutable_obj_cache
 }  // namespace ceph
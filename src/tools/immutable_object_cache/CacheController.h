@@ -27,6 +27,8 @@ class CacheController {
 
   void handle_request(CacheSession* session, ObjectCacheRequest* msg);
 
+  void handle_close(CacheSession* session);
+
  private:
   CacheServer *m_cache_server;
   std::vector<const char*> m_args;
@@ -17,8 +17,9 @@ namespace ceph {
 namespace immutable_obj_cache {
 
 CacheServer::CacheServer(CephContext* cct, const std::string& file,
-                         ProcessMsg processmsg)
+                         ProcessMsg processmsg, ProcessClose processclose)
   : cct(cct), m_server_process_msg(processmsg),
+    m_server_process_close(processclose),
     m_local_path(file), m_acceptor(m_io_service) {}
 
 CacheServer::~CacheServer() {
@@ -77,7 +78,7 @@ void CacheServer::accept() {
   CacheSessionPtr new_session = nullptr;
 
   new_session.reset(new CacheSession(m_io_service,
-                    m_server_process_msg, cct));
+                    m_server_process_msg, m_server_process_close, cct));
 
   m_acceptor.async_accept(new_session->socket(),
       boost::bind(&CacheServer::handle_accept, this, new_session,
@@ -19,7 +19,8 @@ namespace immutable_obj_cache {
 
 class CacheServer {
  public:
-  CacheServer(CephContext* cct, const std::string& file, ProcessMsg processmsg);
+  CacheServer(CephContext* cct, const std::string& file, ProcessMsg processmsg,
+              ProcessClose processclose = ProcessClose());
   ~CacheServer();
 
   int run();
@@ -35,6 +36,7 @@ class CacheServer {
   CephContext* cct;
   boost::asio::io_service m_io_service;
   ProcessMsg m_server_process_msg;
+  ProcessClose m_server_process_close;
   stream_protocol::endpoint m_local_path;
   stream_protocol::acceptor m_acceptor;
 };
@@ -17,14 +17,20 @@ namespace immutable_obj_cache {
 
 CacheSession::CacheSession(io_service& io_service,
                            ProcessMsg processmsg,
+                           ProcessClose processclose,
                            CephContext* cct)
     : m_dm_socket(io_service),
-      m_server_process_msg(processmsg), m_cct(cct) {
+      m_server_process_msg(processmsg),
+      m_server_process_close(processclose), m_cct(cct) {
   m_bp_header = buffer::create(get_header_size());
 }
 
 CacheSession::~CacheSession() {
   close();
+  // the client, and so its image, is gone
+  if (m_server_process_close) {
+    m_server_process_close(this);
+  }
 }
 
 stream_protocol::socket& CacheSession::socket() {
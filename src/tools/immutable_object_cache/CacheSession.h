@@ -20,7 +20,7 @@ namespace immutable_obj_cache {
 class CacheSession : public std::enable_shared_from_this<CacheSession> {
  public:
   CacheSession(io_service& io_service, ProcessMsg process_msg,
-                CephContext* ctx);
+               ProcessClose process_close, CephContext* ctx);
   ~CacheSession();
   stream_protocol::socket& socket();
   void close();
@@ -39,6 +39,7 @@ class CacheSession : public std::enable_shared_from_this<CacheSession> {
  private:
   stream_protocol::socket m_dm_socket;
   ProcessMsg m_server_process_msg;
+  ProcessClose m_server_process_close;
   CephContext* m_cct;
 
   bufferptr m_bp_header;
@@ -18,7 +18,9 @@ namespace immutable_obj_cache {
 
 ObjectCacheStore::ObjectCacheStore(CephContext *cct)
       : m_cct(cct), m_rados(new librados::Rados()),
-        m_ioctx_map_lock("ceph::cache::ObjectCacheStore::m_ioctx_map_lock") {
+        m_ioctx_map_lock("ceph::cache::ObjectCacheStore::m_ioctx_map_lock"),
+        m_perf_counters_lock(
+          "ceph::cache::ObjectCacheStore::m_perf_counters_lock") {
 
   m_cache_root_dir =
     m_cct->_conf.get_val<std::string>("immutable_object_cache_path");
@@ -36,12 +38,22 @@ ObjectCacheStore::ObjectCacheStore(CephContext *cct)
   uint64_t max_inflight_ops =
     m_cct->_conf.get_val<uint64_t>("immutable_object_cache_max_inflight_ops");
 
+  uint64_t promote_hits =
+    m_cct->_conf.get_val<uint64_t>("immutable_object_cache_promote_hits");
+
+  double promote_window =
+    m_cct->_conf.get_val<double>("immutable_object_cache_promote_window");
+
   m_policy = new SimplePolicy(m_cct, cache_max_size, max_inflight_ops,
-                              cache_watermark);
+                              cache_watermark, promote_hits, promote_window);
 }
 
 ObjectCacheStore::~ObjectCacheStore() {
   delete m_policy;
+
+  for (auto& it : m_perf_counters) {
+    remove_perf_counters(it.second.perf_counters);
+  }
 }
 
 int ObjectCacheStore::init(bool reset) {
@@ -91,9 +103,67 @@ int ObjectCacheStore::init_cache() {
   return 0;
 }
 
+std::string ObjectCacheStore::get_perf_counters_name(
+    const std::string& pool_nspace, uint64_t pool_id,
+    const std::string& object_name) {
+  // the data objects of an image are named <prefix>.<object number>
+  std::string image = object_name.substr(0, object_name.rfind('.'));
+  return "immutable_object_cache-" + std::to_string(pool_id) + "-" +
+         pool_nspace + "-" + image;
+}
+
+PerfCounters* ObjectCacheStore::get_perf_counters(const std::string& name,
+                                                  const void* reader) {
+  ceph_assert(m_perf_counters_lock.is_locked());
+  auto& image_perf = m_perf_counters[name];
+  image_perf.readers.insert(reader);
+  if (image_perf.perf_counters) {
+    return image_perf.perf_counters;
+  }
+
+  ldout(m_cct, 20) << "adding perf counters: " << name << dendl;
+  PerfCountersBuilder plb(m_cct, name, l_immutable_obj_cache_first,
+                          l_immutable_obj_cache_last);
+  plb.add_u64_counter(l_immutable_obj_cache_hit, "hit",
+                      "Reads served from the cache");
+  plb.add_u64_counter(l_immutable_obj_cache_miss, "miss",
+                      "Reads sent to the cluster");
+  plb.add_u64_counter(l_immutable_obj_cache_promote, "promote",
+                      "Objects promoted to the cache");
+  plb.add_u64_counter(l_immutable_obj_cache_promote_bytes, "promote_bytes",
+                      "Data promoted to the cache", nullptr, 0,
+                      unit_t(UNIT_BYTES));
+  PerfCounters *perf_counters = plb.create_perf_counters();
+  m_cct->get_perfcounters_collection()->add(perf_counters);
+  image_perf.perf_counters = perf_counters;
+  return perf_counters;
+}
+
+void ObjectCacheStore::remove_perf_counters(PerfCounters* perf_counters) {
+  m_cct->get_perfcounters_collection()->remove(perf_counters);
+  delete perf_counters;
+}
+
+void ObjectCacheStore::close_reader(const void* reader) {
+  Mutex::Locker locker(m_perf_counters_lock);
+  for (auto it = m_perf_counters.begin(); it != m_perf_counters.end();) {
+    auto& image_perf = it->second;
+    if (image_perf.readers.erase(reader) == 0 ||
+        !image_perf.readers.empty()) {
+      ++it;
+      continue;
+    }
+    // the image isn't open anywhere else
+    ldout(m_cct, 20) << "removing perf counters: " << it->first << dendl;
+    remove_perf_counters(image_perf.perf_counters);
+    it = m_perf_counters.erase(it);
+  }
+}
+
 int ObjectCacheStore::do_promote(std::string pool_nspace,
                                   uint64_t pool_id, uint64_t snap_id,
-                                  std::string object_name) {
+                                  std::string object_name,
+                                  std::string perf_counters_name) {
   ldout(m_cct, 20) << "to promote object: " << object_name
                    << " from pool id: " << pool_id
                    << " namespace: " << pool_nspace
@@ -122,15 +192,17 @@ int ObjectCacheStore::do_promote(std::string pool_nspace,
 
   librados::bufferlist* read_buf = new librados::bufferlist();
 
-  auto ctx = new FunctionContext([this, read_buf, cache_file_name](int ret) {
-    handle_promote_callback(ret, read_buf, cache_file_name);
-  });
+  auto ctx = new FunctionContext(
+    [this, read_buf, cache_file_name, perf_counters_name](int ret) {
+      handle_promote_callback(ret, read_buf, cache_file_name,
+                              perf_counters_name);
+    });
 
   return promote_object(&ioctx, object_name, read_buf, ctx);
 }
 
 int ObjectCacheStore::handle_promote_callback(int ret, bufferlist* read_buf,
-  std::string cache_file_name) {
+  std::string cache_file_name, std::string perf_counters_name) {
   ldout(m_cct, 20) << " cache_file_name: " << cache_file_name << dendl;
 
   // rados read error
@@ -171,6 +243,17 @@ int ObjectCacheStore::handle_promote_callback(int ret, bufferlist* read_buf,
   m_policy->update_status(cache_file_name, OBJ_CACHE_PROMOTED, read_buf->length());
   ceph_assert(OBJ_CACHE_PROMOTED == m_policy->get_status(cache_file_name));
 
+  {
+    // unless the image was closed since
+    Mutex::Locker locker(m_perf_counters_lock);
+    auto it = m_perf_counters.find(perf_counters_name);
+    if (it != m_perf_counters.end()) {
+      it->second.perf_counters->inc(l_immutable_obj_cache_promote);
+      it->second.perf_counters->inc(l_immutable_obj_cache_promote_bytes,
+                                    read_buf->length());
+    }
+  }
+
   delete read_buf;
 
   evict_objects();
@@ -181,7 +264,8 @@ int ObjectCacheStore::handle_promote_callback(int ret, bufferlist* read_buf,
 int ObjectCacheStore::lookup_object(std::string pool_nspace,
                                     uint64_t pool_id, uint64_t snap_id,
                                     std::string object_name,
-                                    std::string& target_cache_file_path) {
+                                    std::string& target_cache_file_path,
+                                    const void* reader) {
   ldout(m_cct, 20) << "object name = " << object_name
                    << " in pool ID : " << pool_id << dendl;
 
@@ -190,10 +274,21 @@ int ObjectCacheStore::lookup_object(std::string pool_nspace,
                                             pool_id, snap_id, object_name));
 
   cache_status_t ret = m_policy->lookup_object(cache_file_name);
+  std::string perf_counters_name = get_perf_counters_name(pool_nspace,
+                                                         pool_id, object_name);
+  {
+    Mutex::Locker locker(m_perf_counters_lock);
+    get_perf_counters(perf_counters_name, reader)->inc(
+      ret == OBJ_CACHE_PROMOTED ? l_immutable_obj_cache_hit :
+                                  l_immutable_obj_cache_miss);
+  }
 
   switch (ret) {
     case OBJ_CACHE_NONE: {
-      pret = do_promote(pool_nspace, pool_id, snap_id, object_name);
+      // the promotion reads the object in the background, this read goes
+      // to the cluster meanwhile
+      pret = do_promote(pool_nspace, pool_id, snap_id, object_name,
+                        perf_counters_name);
       if (pret < 0) {
         lderr(m_cct) << "fail to start promote" << dendl;
       }
@@ -6,6 +6,7 @@
 
 #include "common/ceph_context.h"
 #include "common/Mutex.h"
+#include "common/perf_counters.h"
 #include "include/rados/librados.hpp"
 
 #include "SimplePolicy.h"
@@ -18,6 +19,15 @@ class Context;
 namespace ceph {
 namespace immutable_obj_cache {
 
+enum {
+  l_immutable_obj_cache_first = 28000,
+  l_immutable_obj_cache_hit,
+  l_immutable_obj_cache_miss,
+  l_immutable_obj_cache_promote,
+  l_immutable_obj_cache_promote_bytes,
+  l_immutable_obj_cache_last,
+};
+
 typedef shared_ptr<librados::Rados> RadosRef;
 typedef shared_ptr<librados::IoCtx> IoCtxRef;
 
@@ -28,10 +38,14 @@ class ObjectCacheStore {
   int init(bool reset);
   int shutdown();
   int init_cache();
+  // reader is who reads the image, to drop its perf counters when all of
+  // its readers are closed
   int lookup_object(std::string pool_nspace,
                     uint64_t pool_id, uint64_t snap_id,
                     std::string object_name,
-                    std::string& target_cache_file_path);
+                    std::string& target_cache_file_path,
+                    const void* reader = nullptr);
+  void close_reader(const void* reader);
 
  private:
   std::string get_cache_file_name(std::string pool_nspace, uint64_t pool_id,
@@ -40,11 +54,18 @@ class ObjectCacheStore {
                                   bool mkdir = false);
   int evict_objects();
   int do_promote(std::string pool_nspace, uint64_t pool_id,
-                 uint64_t snap_id, std::string object_name);
+                 uint64_t snap_id, std::string object_name,
+                 std::string perf_counters_name);
   int promote_object(librados::IoCtx*, std::string object_name,
                      librados::bufferlist* read_buf,
                      Context* on_finish);
-  int handle_promote_callback(int, bufferlist*, std::string);
+  int handle_promote_callback(int, bufferlist*, std::string, std::string);
+  std::string get_perf_counters_name(const std::string& pool_nspace,
+                                     uint64_t pool_id,
+                                     const std::string& object_name);
+  PerfCounters* get_perf_counters(const std::string& name,
+                                  const void* reader);
+  void remove_perf_counters(PerfCounters* perf_counters);
   int do_evict(std::string cache_file);
 
   CephContext *m_cct;
@@ -52,6 +73,13 @@ class ObjectCacheStore {
   std::map<uint64_t, librados::IoCtx> m_ioctx_map;
   Mutex m_ioctx_map_lock;
   Policy* m_policy;
+  struct image_perf_t {
+    PerfCounters* perf_counters = nullptr;
+    std::set<const void*> readers;
+  };
+  // by image, as told by the prefix of the object names
+  std::map<std::string, image_perf_t> m_perf_counters;
+  Mutex m_perf_counters_lock;
   std::string m_cache_root_dir;
 };
 
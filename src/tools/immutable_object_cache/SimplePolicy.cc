@@ -13,15 +13,23 @@
 namespace ceph {
 namespace immutable_obj_cache {
 
+// how many objects the admission keeps the accesses of
+static constexpr size_t MAX_TRACKED_ACCESSES = 1 << 16;
+
 SimplePolicy::SimplePolicy(CephContext *cct, uint64_t cache_size,
-                           uint64_t max_inflight, double watermark)
+                           uint64_t max_inflight, double watermark,
+                           uint64_t promote_hits, double promote_window)
   : cct(cct), m_watermark(watermark), m_max_inflight_ops(max_inflight),
     m_max_cache_size(cache_size),
-    m_cache_map_lock("rbd::cache::SimplePolicy::m_cache_map_lock") {
+    m_cache_map_lock("rbd::cache::SimplePolicy::m_cache_map_lock"),
+    m_promote_hits(promote_hits),
+    m_promote_window(ceph::make_timespan(promote_window)) {
 
   ldout(cct, 20) << "max cache size= " << m_max_cache_size
                  << " ,watermark= " << m_watermark
-                 << " ,max inflight ops= " << m_max_inflight_ops << dendl;
+                 << " ,max inflight ops= " << m_max_inflight_ops
+                 << " ,promote hits= " << m_promote_hits
+                 << " ,promote window= " << promote_window << dendl;
 
   m_cache_size = 0;
 
@@ -49,6 +57,10 @@ cache_status_t SimplePolicy::alloc_entry(std::string file_name) {
 
   if ((m_cache_size < m_max_cache_size) &&
       (inflight_ops < m_max_inflight_ops)) {
+    if (!admit(file_name)) {
+      ldout(cct, 20) << "object is not accessed enough: " << file_name << dendl;
+      return OBJ_CACHE_SKIP;
+    }
     Entry* entry = new Entry();
     ceph_assert(entry != nullptr);
     m_cache_map[file_name] = entry;
@@ -61,6 +73,43 @@ cache_status_t SimplePolicy::alloc_entry(std::string file_name) {
   return OBJ_CACHE_SKIP;
 }
 
+// count a miss of an object, and tell if it's been missed often enough
+// within the window to be promoted, so that a single scan of an image
+// doesn't push everything else out of the cache
+bool SimplePolicy::admit(const std::string& file_name) {
+  ceph_assert(m_cache_map_lock.is_wlocked());
+
+  if (m_promote_hits <= 1) {
+    return true;
+  }
+
+  auto now = ceph::coarse_mono_clock::now();
+  while (!m_access_list.empty()) {
+    auto it = m_accesses.find(m_access_list.front());
+    ceph_assert(it != m_accesses.end());
+    if (m_accesses.size() < MAX_TRACKED_ACCESSES &&
+        (m_promote_window == ceph::timespan::zero() ||
+         now - it->second.first < m_promote_window)) {
+      break;
+    }
+    m_accesses.erase(it);
+    m_access_list.pop_front();
+  }
+
+  auto& access = m_accesses[file_name];
+  if (access.hits == 0) {
+    access.first = now;
+    access.pos = m_access_list.insert(m_access_list.end(), file_name);
+  }
+  if (++access.hits < m_promote_hits) {
+    return false;
+  }
+
+  m_access_list.erase(access.pos);
+  m_accesses.erase(file_name);
+  return true;
+}
+
 cache_status_t SimplePolicy::lookup_object(std::string file_name) {
   ldout(cct, 20) << "lookup: " << file_name << dendl;
 
@@ -168,18 +217,17 @@ void SimplePolicy::get_evict_list(std::list<std::string>* obj_list) {
   ldout(cct, 20) << dendl;
 
   RWLock::WLocker locker(m_cache_map_lock);
-  // check free ratio, pop entries from LRU
-  if ((double)m_cache_size / m_max_cache_size > (1 - m_watermark)) {
-    // TODO(dehao): make this configurable
-    int evict_num = m_cache_map.size() * 0.1;
-    for (int i = 0; i < evict_num; i++) {
-      Entry* entry = reinterpret_cast<Entry*>(m_promoted_lru.lru_expire());
-      if (entry == nullptr) {
-        continue;
-      }
-      std::string file_name = entry->file_name;
-      obj_list->push_back(file_name);
+  // pop entries from LRU until what they take brings the cache back
+  // under the watermark
+  uint64_t max_used = m_max_cache_size * (1 - m_watermark);
+  uint64_t evict_size = 0;
+  while (m_cache_size - evict_size > max_used) {
+    Entry* entry = reinterpret_cast<Entry*>(m_promoted_lru.lru_expire());
+    if (entry == nullptr) {
+      break;
     }
+    evict_size += std::min<uint64_t>(entry->size, m_cache_size - evict_size);
+    obj_list->push_back(entry->file_name);
   }
 }
 
@@ -5,11 +5,13 @@
 #define CEPH_CACHE_SIMPLE_POLICY_H
 
 #include "common/ceph_context.h"
+#include "common/ceph_time.h"
 #include "common/RWLock.h"
 #include "common/Mutex.h"
 #include "include/lru.h"
 #include "Policy.h"
 
+#include <list>
 #include <unordered_map>
 #include <string>
 
@@ -19,7 +21,8 @@ namespace immutable_obj_cache {
 class SimplePolicy : public Policy {
  public:
   SimplePolicy(CephContext *cct, uint64_t block_num, uint64_t max_inflight,
-               double watermark);
+               double watermark, uint64_t promote_hits = 1,
+               double promote_window = 0);
   ~SimplePolicy();
 
   cache_status_t lookup_object(std::string file_name);
@@ -40,6 +43,7 @@ class SimplePolicy : public Policy {
 
  private:
   cache_status_t alloc_entry(std::string file_name);
+  bool admit(const std::string& file_name);
 
   class Entry : public LRUObject {
    public:
@@ -61,6 +65,18 @@ class SimplePolicy : public Policy {
   std::atomic<uint64_t> m_cache_size;
 
   LRU m_promoted_lru;
+
+  // the objects missed fewer than m_promote_hits times, oldest first,
+  // protected by m_cache_map_lock
+  struct Access {
+    uint64_t hits = 0;
+    ceph::coarse_mono_time first;
+    std::list<std::string>::iterator pos;
+  };
+  uint64_t m_promote_hits;
+  ceph::timespan m_promote_window;
+  std::unordered_map<std::string, Access> m_accesses;
+  std::list<std::string> m_access_list;
 };
 
 }  // namespace immutable_obj_cache
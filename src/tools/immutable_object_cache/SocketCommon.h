@@ -23,6 +23,7 @@ class ObjectCacheRequest;
 class CacheSession;
 
 typedef std::function<void(CacheSession*, ObjectCacheRequest*)> ProcessMsg;
+typedef std::function<void(CacheSession*)> ProcessClose;
 
 }  // namespace immutable_obj_cache
 }  // namespace ceph
@@ -510,6 +510,13 @@ int main(int argc, const char **argv)
       
       cout << "pool " << p->first
 	   << " pg_num " << p->second.get_pg_num() << std::endl;
+      vector<vector<int>> pool_up, pool_acting;
+      vector<int> pool_up_primary, pool_acting_primary;
+      if (!test_random) {
+	osdmap.pg_range_to_up_acting_osds(
+	  p->first, 0, p->second.get_pg_num(),
+	  &pool_up, &pool_up_primary, &pool_acting, &pool_acting_primary);
+      }
       for (unsigned i = 0; i < p->second.get_pg_num(); ++i) {
 	pg_t pgid = pg_t(i, p->first);
 
@@ -523,12 +530,15 @@ int main(int argc, const char **argv)
 	  primary = osds[0];
 	} else if (test_map_pgs_dump_all) {
          osdmap.pg_to_raw_osds(pgid, &raw, &calced_primary);
-         osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
-                                &acting, &acting_primary);
+	 up = pool_up[i];
+	 up_primary = pool_up_primary[i];
+	 acting = pool_acting[i];
+	 acting_primary = pool_acting_primary[i];
 	 osds = acting;
 	 primary = acting_primary;
        } else {
-	  osdmap.pg_to_acting_osds(pgid, &osds, &primary);
+	  osds = pool_acting[i];
+	  primary = pool_acting_primary[i];
 	}
 	size[osds.size()]++;
 	if ((unsigned)max_size < osds.size())
@@ -688,7 +698,11 @@ int main(int argc, const char **argv)
   }
   if (modified) {
     bl.clear();
-    osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    r = osdmap.encode(bl, CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED);
+    if (r < 0) {
+      cerr << me << ": error encoding osdmap: " << cpp_strerror(r) << std::endl;
+      exit(1);
+    }
 
     // write it out
     cout << me << ": writing epoch " << osdmap.get_epoch()
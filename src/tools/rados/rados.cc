@@ -214,6 +214,9 @@ void usage(ostream& out)
 "        Set number of concurrent I/O operations\n"
 "   --show-time\n"
 "        prefix output with date/time\n"
+"   --rate=N\n"
+"        start N ops per second rather than one whenever one completes,\n"
+"        measuring latencies from when the ops were due to start\n"
 "   --no-verify\n"
 "        do not verify contents of read objects\n"
 "   --write-object\n"
@@ -1865,6 +1868,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   int run_length = 0;
 
   bool show_time = false;
+  unsigned bench_rate = 0;
   bool wildcard = false;
 
   std::string run_name;
@@ -2024,6 +2028,12 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
   if (i != opts.end()) {
     show_time = true;
   }
+  i = opts.find("rate");
+  if (i != opts.end()) {
+    if (rados_sistrtoll(i, &bench_rate)) {
+      return -EINVAL;
+    }
+  }
   i = opts.find("no-cleanup");
   if (i != opts.end()) {
     cleanup = false;
@@ -3181,6 +3191,7 @@ static int rados_tool_common(const std::map < std::string, std::string > &opts,
     }
     RadosBencher bencher(g_ceph_context, rados, io_ctx);
     bencher.set_show_time(show_time);
+    bencher.set_rate(bench_rate);
     bencher.set_write_destination(static_cast<OpWriteDest>(bench_write_dest));
 
     ostream *outstream = NULL;
@@ -3954,6 +3965,8 @@ int main(int argc, const char **argv)
       opts["object-size"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--max-objects", (char*)NULL)) {
       opts["max-objects"] = val;
+    } else if (ceph_argparse_witharg(args, i, &val, "--rate", (char*)NULL)) {
+      opts["rate"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "--offset", (char*)NULL)) {
       opts["offset"] = val;
     } else if (ceph_argparse_witharg(args, i, &val, "-o", (char*)NULL)) {
@@ -32,6 +32,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 
+#include <array>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -68,6 +69,7 @@ struct Config {
   int nbds_max = 0;
   int max_part = 255;
   int timeout = -1;
+  int num_connections = 1;
 
   bool exclusive = false;
   bool readonly = false;
@@ -95,6 +97,8 @@ static void usage()
             << "  --max_part <limit>      Override for module param max_part\n"
             << "  --exclusive             Forbid writes by other clients\n"
             << "  --timeout <seconds>     Set nbd request timeout\n"
+            << "  --num-connections <n>   Number of connections to the device,\n"
+            << "                          each served by its own threads\n"
             << "\n"
             << "List options:\n"
             << "  --format plain|json|xml Output format (default: plain)\n"
@@ -116,6 +120,10 @@ static Command cmd = None;
 
 #define RBD_NBD_BLKSIZE 512UL
 
+#ifndef NBD_FLAG_CAN_MULTI_CONN
+#define NBD_FLAG_CAN_MULTI_CONN (1 << 8)
+#endif
+
 #define HELP_INFO 1
 #define VERSION_INFO 2
 
@@ -359,20 +367,19 @@ private:
 
       dout(20) << __func__ << ": got: " << *ctx << dendl;
 
-      int r = safe_write(fd, &ctx->reply, sizeof(struct nbd_reply));
+      // send the header and the data read in one go, without copying the
+      // latter
+      bufferlist reply;
+      reply.append((const char *)&ctx->reply, sizeof(struct nbd_reply));
+      if (ctx->command == NBD_CMD_READ && ctx->reply.error == htonl(0)) {
+	reply.claim_append(ctx->data);
+      }
+      int r = reply.write_fd(fd);
       if (r < 0) {
-	derr << *ctx << ": failed to write reply header: " << cpp_strerror(r)
+	derr << *ctx << ": failed to write reply: " << cpp_strerror(r)
 	     << dendl;
         return;
       }
-      if (ctx->command == NBD_CMD_READ && ctx->reply.error == htonl(0)) {
-	r = ctx->data.write_fd(fd);
-        if (r < 0) {
-	  derr << *ctx << ": failed to write replay data: " << cpp_strerror(r)
-	       << dendl;
-          return;
-	}
-      }
       dout(20) << *ctx << ": finish" << dendl;
     }
     dout(20) << __func__ << ": terminated" << dendl;
@@ -658,7 +665,8 @@ static int do_map(int argc, const char *argv[], Config *cfg)
   unsigned long size;
 
   int index = 0;
-  int fd[2];
+  // one socket pair per connection, the kernel's end first
+  std::vector<std::array<int, 2>> fds;
 
   librbd::image_info_t info;
 
@@ -699,9 +707,13 @@ static int do_map(int argc, const char *argv[], Config *cfg)
   common_init_finish(g_ceph_context);
   global_init_chdir(g_ceph_context);
 
-  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == -1) {
-    r = -errno;
-    goto close_ret;
+  for (int i = 0; i < cfg->num_connections; ++i) {
+    std::array<int, 2> fd;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fd.data()) == -1) {
+      r = -errno;
+      goto close_fd;
+    }
+    fds.push_back(fd);
   }
 
   r = rados.init_with_context(g_ceph_context);
@@ -770,7 +782,7 @@ static int do_map(int argc, const char *argv[], Config *cfg)
         goto close_fd;
       }
 
-      r = ioctl(nbd, NBD_SET_SOCK, fd[0]);
+      r = ioctl(nbd, NBD_SET_SOCK, fds[0][0]);
       if (r < 0) {
         close(nbd);
         ++index;
@@ -797,7 +809,7 @@ static int do_map(int argc, const char *argv[], Config *cfg)
       goto close_fd;
     }
 
-    r = ioctl(nbd, NBD_SET_SOCK, fd[0]);
+    r = ioctl(nbd, NBD_SET_SOCK, fds[0][0]);
     if (r < 0) {
       r = -errno;
       cerr << "rbd-nbd: the device " << cfg->devpath << " is busy" << std::endl;
@@ -806,7 +818,22 @@ static int do_map(int argc, const char *argv[], Config *cfg)
     }
   }
 
+  // the kernel gives each connection its own hardware queue
+  for (size_t i = 1; i < fds.size(); ++i) {
+    r = ioctl(nbd, NBD_SET_SOCK, fds[i][0]);
+    if (r < 0) {
+      r = -errno;
+      cerr << "rbd-nbd: failed to add connection " << i << " to "
+           << cfg->devpath << ": " << cpp_strerror(r) << std::endl;
+      goto close_nbd;
+    }
+  }
+
   flags = NBD_FLAG_SEND_FLUSH | NBD_FLAG_SEND_TRIM | NBD_FLAG_HAS_FLAGS;
+  if (fds.size() > 1) {
+    // a flush flushes the whole image, whichever connection it comes on
+    flags |= NBD_FLAG_CAN_MULTI_CONN;
+  }
   if (!cfg->snapname.empty() || cfg->readonly) {
     flags |= NBD_FLAG_READ_ONLY;
     read_only = 1;
@@ -872,9 +899,11 @@ static int do_map(int argc, const char *argv[], Config *cfg)
     }
 
     {
-      NBDServer server(fd[1], image);
-
-      server.start();
+      std::vector<std::unique_ptr<NBDServer>> servers;
+      for (auto& fd : fds) {
+        servers.emplace_back(new NBDServer(fd[1], image));
+        servers.back()->start();
+      }
 
       init_async_signal_handler();
       register_async_signal_handler(SIGHUP, sighup_handler);
@@ -900,9 +929,10 @@ close_nbd:
   }
   close(nbd);
 close_fd:
-  close(fd[0]);
-  close(fd[1]);
-close_ret:
+  for (auto& fd : fds) {
+    close(fd[0]);
+    close(fd[1]);
+  }
   image.close();
   io_ctx.close();
   rados.shutdown();
@@ -1079,6 +1109,16 @@ static int parse_args(vector<const char*>& args, std::ostream *err_msg,
         return -EINVAL;
       }
       cfg->set_max_part = true;
+    } else if (ceph_argparse_witharg(args, i, &cfg->num_connections, err,
+                                     "--num-connections", (char *)NULL)) {
+      if (!err.str().empty()) {
+        *err_msg << "rbd-nbd: " << err.str();
+        return -EINVAL;
+      }
+      if (cfg->num_connections < 1) {
+        *err_msg << "rbd-nbd: Invalid argument for num-connections!";
+        return -EINVAL;
+      }
     } else if (ceph_argparse_flag(args, i, "--read-only", (char *)NULL)) {
       cfg->readonly = true;
     } else if (ceph_argparse_flag(args, i, "--exclusive", (char *)NULL)) {
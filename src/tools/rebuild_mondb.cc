@@ -268,7 +268,10 @@ int update_osdmap(ObjectStore& fs, OSDSuperblock& sb, MonitorDBStore& ms)
         if (inc.have_crc) {
           crc = inc.full_crc;
           bufferlist fbl;
-          osdmap.encode(fbl, features);
+          int r = osdmap.encode(fbl, features);
+          if (r < 0) {
+            return r;
+          }
           if (osdmap.get_crc() != inc.full_crc) {
             cerr << "mismatched inc crc: "
                  << osdmap.get_crc() << " != " << inc.full_crc << std::endl;
@@ -299,7 +302,10 @@ int update_osdmap(ObjectStore& fs, OSDSuperblock& sb, MonitorDBStore& ms)
         }
         uint32_t saved_crc = osdmap.get_crc();
         bufferlist fbl;
-        osdmap.encode(fbl, features);
+        int r = osdmap.encode(fbl, features);
+        if (r < 0) {
+          return r;
+        }
         if (osdmap.get_crc() != saved_crc) {
           cerr << "mismatched full crc: "
                << saved_crc << " != " << osdmap.get_crc() << std::endl;